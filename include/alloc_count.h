@@ -0,0 +1,28 @@
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Per-thread heap allocation counters for allocation-budget tests.
+ *
+ * Built with -DTNT_ALLOC_COUNT on glibc, alloc_count.c interposes malloc,
+ * calloc, realloc and free for the whole process (calls made from other
+ * libraries included) and counts each call in thread-local counters, so a test can
+ * assert that a code path allocates nothing.  In normal builds nothing is
+ * interposed and the counters stay zero.  `make alloc-test` builds and
+ * runs tests/sim/test_alloc_budget this way. */
+
+typedef struct {
+    uint64_t allocs;               /* malloc, calloc and realloc calls */
+    uint64_t frees;                /* free of a non-NULL pointer */
+    uint64_t bytes;                /* Bytes requested by those allocs */
+} tnt_alloc_counts_t;
+
+/* True when this build counts allocations. */
+bool tnt_alloc_count_enabled(void);
+
+/* Counters of the calling thread since it started. */
+void tnt_alloc_count_get(tnt_alloc_counts_t *out);
+
+#endif /* ALLOC_COUNT_H */
@@ -13,16 +13,53 @@ typedef struct {
     char client_ip[INET6_ADDRSTRLEN];
 } accepted_session_t;
 
-/* Read TNT_ACCESS_TOKEN from the environment.  Idempotent.  Call once
+/* Pool-backed allocation for the hand-off envelope.  The accept loop gets
+ * one from bootstrap_accepted_session_new(); bootstrap_run() returns it. */
+accepted_session_t *bootstrap_accepted_session_new(void);
+void bootstrap_accepted_session_free(accepted_session_t *accepted);
+
+/* Read TNT_ACCESS_TOKEN, the per-phase handshake deadlines and the
+ * pending-handshake cap from the environment.  Idempotent.  Call once
  * during startup, before bootstrap_run() can fire on any accepted
  * session. */
 void bootstrap_init(void);
 
+/* Handshake phases, each with its own deadline (TNT_KEX_TIMEOUT,
+ * TNT_AUTH_TIMEOUT, TNT_CHANNEL_TIMEOUT).  A connection still in a phase
+ * when its deadline passes has its socket shut down from the timer wheel,
+ * which also unblocks a thread stuck inside libssh. */
+typedef enum {
+    BOOTSTRAP_PHASE_KEX = 0,
+    BOOTSTRAP_PHASE_AUTH,
+    BOOTSTRAP_PHASE_CHANNEL,
+    BOOTSTRAP_PHASE_COUNT
+} bootstrap_phase_t;
+
+const char *bootstrap_phase_name(bootstrap_phase_t phase);
+
+/* Number of connections that hit the deadline of `phase`. */
+unsigned long bootstrap_phase_timeouts(bootstrap_phase_t phase);
+
+/* Pending-handshake slots.  The accept loop reserves one before handing a
+ * socket to bootstrap_run(); false means TNT_MAX_PENDING_HANDSHAKES
+ * connections are already between accept and a ready channel, so stalled
+ * handshakes can never occupy every TNT_MAX_CONNECTIONS slot.
+ * bootstrap_run() releases the slot itself; the accept loop releases it
+ * only if the thread never starts. */
+bool bootstrap_handshake_reserve(void);
+void bootstrap_handshake_release(void);
+int bootstrap_pending_handshakes(void);
+
 /* Read the peer IP off an accepted ssh_session into ip_buf.  Sets ip_buf
  * to "unknown" when the address family is unrecognised or getpeername()
  * fails.  ip_buf must be at least INET6_ADDRSTRLEN bytes. */
 void bootstrap_peer_ip(ssh_session session, char *ip_buf, size_t buf_size);
 
+/* Same formatting for an address already returned by accept(), so the
+ * listener can apply rate limits before any libssh session exists. */
+void bootstrap_format_ip(const struct sockaddr_storage *addr, char *ip_buf,
+                         size_t buf_size);
+
 /* pthread entry point for the per-connection bootstrap thread.
  *
  * Steps performed before handing control to input_run_session():
@@ -0,0 +1,97 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "common.h"
+#include <stdio.h>
+
+/* Opt-in capture of interactive session traffic for replay.
+ *
+ * With TNT_CAPTURE=1 every interactive session's input bytes, PTY size
+ * changes and their timing are appended to one file in the state
+ * directory, capture-<unix time>-<pid>.tntcap, until it reaches
+ * TNT_CAPTURE_MAX_MB.  Output is not recorded.  Text typed in INSERT mode,
+ * at the name prompt and after the first space of a `:` command is
+ * anonymised as it is read: letters and digits become random ones of the
+ * same kind and each UTF-8 character becomes a fixed one of the same byte
+ * length, so line lengths, paste sizes and rendering cost survive but the
+ * words do not.  Keys, escape sequences and command names are kept.
+ * tests/loadgen/tnt_replay plays a capture back against a server.
+ *
+ * File format: the 8-byte magic "TNTCAP1\n", then records of
+ *   type (1 byte), session id, ms since the session's previous record
+ *   (since capture start for OPEN), and a body:
+ *     OPEN    width, height
+ *     INPUT   length, bytes
+ *     RESIZE  width, height
+ *     CLOSE   (none)
+ * Every number after the type is an unsigned LEB128 varint.  Records of
+ * different sessions interleave roughly in time order; a reader orders
+ * them by their reconstructed times. */
+
+#define CAPTURE_MAGIC "TNTCAP1\n"
+#define CAPTURE_MAGIC_LEN 8
+/* Input read within the same millisecond is merged up to this size. */
+#define CAPTURE_INPUT_BATCH 256
+
+typedef enum {
+    CAPTURE_REC_OPEN = 1,
+    CAPTURE_REC_INPUT = 2,
+    CAPTURE_REC_RESIZE = 3,
+    CAPTURE_REC_CLOSE = 4
+} capture_record_type_t;
+
+/* Per-session state, owned by the session thread. */
+typedef struct {
+    uint32_t id;                     /* 0 when the session is not captured */
+    uint64_t last_ms;                /* Time of its previous record */
+    uint64_t rng;
+    unsigned char esc_state;
+    unsigned char utf8_left;         /* Continuation bytes still to replace */
+    unsigned char utf8_len;
+    bool command_args;               /* Past the command name */
+    uint64_t batch_ms;
+    size_t batch_len;
+    unsigned char batch[CAPTURE_INPUT_BATCH];
+} capture_session_t;
+
+/* Read TNT_CAPTURE / TNT_CAPTURE_MAX_MB and open the capture file if
+ * capture is on.  Returns 0, or -1 if the file could not be created. */
+int capture_init(void);
+void capture_shutdown(void);
+bool capture_active(void);
+
+/* Hooks for the session loop.  All are no-ops for uncaptured sessions. */
+void capture_session_open(capture_session_t *session, int width, int height);
+void capture_session_input(capture_session_t *session, client_mode_t mode,
+                           const void *data, size_t len);
+void capture_session_resize(capture_session_t *session, int width,
+                            int height);
+void capture_session_close(capture_session_t *session);
+
+/* Anonymise `len` input bytes in place as read in `mode`. */
+void capture_anonymize(capture_session_t *session, client_mode_t mode,
+                       unsigned char *data, size_t len);
+
+/* One decoded record; `data` points into the reader's buffer. */
+typedef struct {
+    capture_record_type_t type;
+    uint32_t session;
+    uint64_t delta_ms;
+    int width;
+    int height;
+    const unsigned char *data;
+    size_t len;
+} capture_record_t;
+
+typedef struct {
+    FILE *fp;
+    unsigned char data[65536];
+} capture_reader_t;
+
+/* Returns 0 after checking the magic, or -1. */
+int capture_reader_open(capture_reader_t *reader, FILE *fp);
+/* Returns 1 with the next record, 0 at a clean end of file, -1 if the
+ * file is corrupt or truncated mid-record. */
+int capture_reader_next(capture_reader_t *reader, capture_record_t *record);
+
+#endif /* CAPTURE_H */
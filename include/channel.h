@@ -0,0 +1,87 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Byte stream under an interactive session.
+ *
+ * input_run_session() and the client output path read, poll and write
+ * through these calls rather than ssh_channel_*, so a session can run over
+ * the libssh backend (channel_ssh.c) or the in-memory one in
+ * channel_fake.h.  Return values follow libssh: a byte count, 0 for a
+ * timeout with nothing to read (poll) or end of stream (read), or one of
+ * the negative codes below. */
+
+#define TNT_CHANNEL_ERROR (-1)
+#define TNT_CHANNEL_AGAIN (-2)         /* read_timeout: timed out */
+
+struct client;
+
+typedef struct {
+    /* Up to `len` bytes; a negative timeout blocks until data or EOF. */
+    int (*read_timeout)(void *ctx, void *buf, uint32_t len, int timeout_ms);
+    /* Bytes ready to read, 0 on timeout, or TNT_CHANNEL_ERROR. */
+    int (*poll_timeout)(void *ctx, int timeout_ms);
+    int (*write)(void *ctx, const void *data, uint32_t len);
+    /* Bytes the peer will accept before it reads more. */
+    uint32_t (*window_size)(void *ctx);
+    bool (*is_open)(void *ctx);
+    int (*keepalive)(void *ctx);
+    /* Close the stream and free what the backend owns. */
+    void (*close)(void *ctx);
+    /* poll_timeout also returns 0 early once client_wake() is called, so
+     * the session loop may block with a negative timeout. */
+    bool wakeable;
+} tnt_channel_ops_t;
+
+typedef struct {
+    const tnt_channel_ops_t *ops;      /* NULL until a backend is attached */
+    void *ctx;
+} tnt_channel_t;
+
+/* Attach the libssh backend over client->session and client->channel. */
+void tnt_channel_use_ssh(tnt_channel_t *channel, struct client *client);
+
+static inline int tnt_channel_read_timeout(tnt_channel_t *channel, void *buf,
+                                           uint32_t len, int timeout_ms) {
+    return channel->ops->read_timeout(channel->ctx, buf, len, timeout_ms);
+}
+
+static inline int tnt_channel_read(tnt_channel_t *channel, void *buf,
+                                   uint32_t len) {
+    return channel->ops->read_timeout(channel->ctx, buf, len, -1);
+}
+
+static inline int tnt_channel_poll_timeout(tnt_channel_t *channel,
+                                           int timeout_ms) {
+    return channel->ops->poll_timeout(channel->ctx, timeout_ms);
+}
+
+static inline int tnt_channel_write(tnt_channel_t *channel, const void *data,
+                                    uint32_t len) {
+    return channel->ops->write(channel->ctx, data, len);
+}
+
+static inline uint32_t tnt_channel_window_size(tnt_channel_t *channel) {
+    return channel->ops->window_size(channel->ctx);
+}
+
+static inline bool tnt_channel_is_open(tnt_channel_t *channel) {
+    return channel->ops && channel->ops->is_open(channel->ctx);
+}
+
+static inline int tnt_channel_keepalive(tnt_channel_t *channel) {
+    return channel->ops->keepalive(channel->ctx);
+}
+
+static inline void tnt_channel_close(tnt_channel_t *channel) {
+    if (channel->ops) {
+        channel->ops->close(channel->ctx);
+        channel->ops = NULL;
+        channel->ctx = NULL;
+    }
+}
+
+#endif /* CHANNEL_H */
@@ -0,0 +1,76 @@
+#ifndef CHANNEL_FAKE_H
+#define CHANNEL_FAKE_H
+
+#include "channel.h"
+#include <pthread.h>
+
+/* In-memory channel backend for simulations and tests.
+ *
+ * The driver feeds input bytes, grants write window the way an SSH peer
+ * acks data, and hangs up.  Writes stop at the window, so a session whose
+ * peer never acks backs up into its outbox exactly as over a slow link.
+ *
+ * Timeouts are virtual.  With no yield callback, poll and read return at
+ * once.  With one, a poll that finds no input returns 0 once so the
+ * session loop can run its idle work, and the next one calls the yield
+ * callback; the driver uses it to park the session until its next turn.  A
+ * read with a timeout keeps yielding until input arrives or the timer
+ * service clock passes the deadline. */
+
+typedef struct tnt_fake_channel tnt_fake_channel_t;
+
+/* Called on the session thread with no fake lock held. */
+typedef void (*tnt_fake_yield_fn)(tnt_fake_channel_t *fake, void *arg);
+
+struct tnt_fake_channel {
+    pthread_mutex_t lock;
+    unsigned char *input;
+    size_t input_len;
+    size_t input_pos;
+    size_t input_capacity;
+    bool open;
+    bool idle_returned;             /* Poll reported idle since last yield */
+    uint32_t window;                /* Bytes writable before the next ack */
+    uint32_t window_max;
+    uint64_t bytes_written;
+    uint64_t writes;
+    uint64_t keepalives;
+    char *capture;                  /* Ring of the newest written bytes */
+    size_t capture_size;
+    uint64_t capture_total;
+    tnt_fake_yield_fn yield;
+    void *yield_arg;
+};
+
+/* `window_max` is both the initial window and the most ack can restore;
+ * `capture_size` bytes of output are kept for inspection (0 for none).
+ * Returns 0 or -1. */
+int tnt_fake_channel_init(tnt_fake_channel_t *fake, uint32_t window_max,
+                          size_t capture_size);
+void tnt_fake_channel_destroy(tnt_fake_channel_t *fake);
+
+/* Attach `fake` as the backend of `channel`.  Closing the channel marks
+ * the fake closed; the fake itself stays owned by the caller. */
+void tnt_channel_use_fake(tnt_channel_t *channel, tnt_fake_channel_t *fake);
+
+void tnt_fake_channel_set_yield(tnt_fake_channel_t *fake,
+                                tnt_fake_yield_fn yield, void *arg);
+
+/* Queue bytes for the session to read.  Returns 0 or -1. */
+int tnt_fake_channel_feed(tnt_fake_channel_t *fake, const void *data,
+                          size_t len);
+/* The peer consumed `bytes`: grow the window, up to window_max. */
+void tnt_fake_channel_ack(tnt_fake_channel_t *fake, uint32_t bytes);
+/* The peer went away: reads see EOF, polls an error. */
+void tnt_fake_channel_hangup(tnt_fake_channel_t *fake);
+
+bool tnt_fake_channel_is_open(tnt_fake_channel_t *fake);
+/* Input fed but not yet read. */
+size_t tnt_fake_channel_pending(tnt_fake_channel_t *fake);
+
+/* Copy the newest captured output, oldest byte first, NUL-terminated.
+ * Returns the length copied. */
+size_t tnt_fake_channel_captured(tnt_fake_channel_t *fake, char *buf,
+                                 size_t buf_size);
+
+#endif /* CHANNEL_FAKE_H */
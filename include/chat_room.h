@@ -4,6 +4,9 @@
 #include "common.h"
 #include "message.h"
 
+/* Broadcast times kept for delivery latency, indexed by update_seq. */
+#define ROOM_BROADCAST_STAMPS 64
+
 /* Forward declaration */
 struct client;
 
@@ -16,6 +19,10 @@ typedef struct {
     message_t *messages;
     int message_count;
     uint64_t update_seq;
+    uint64_t broadcast_us[ROOM_BROADCAST_STAMPS]; /* metrics_now_us() */
+    /* Called for every member after a broadcast, so session loops that
+     * block on I/O notice the update; NULL leaves them to poll. */
+    void (*wake_client)(struct client *client);
 } chat_room_t;
 
 /* Global chat room instance */
@@ -48,4 +55,10 @@ int room_get_client_count(chat_room_t *room);
 /* Get room update sequence */
 uint64_t room_get_update_seq(chat_room_t *room);
 
+/* Copy the broadcast times of updates after `after_seq` up to `upto_seq`,
+ * oldest first.  Updates that fell out of the stamp ring are skipped.
+ * Returns the number copied, at most `max`. */
+int room_broadcast_stamps(chat_room_t *room, uint64_t after_seq,
+                          uint64_t upto_seq, uint64_t *stamps, int max);
+
 #endif /* CHAT_ROOM_H */
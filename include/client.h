@@ -5,9 +5,8 @@
 
 /* Send `len` bytes to the client over its SSH channel.
  *
- * Exec sessions write synchronously so command output and exit status remain
- * ordered.  Interactive sessions enqueue into a bounded per-client outbox and
- * flush opportunistically from the same client's session loop, so a closed SSH
+ * Output is enqueued into a bounded per-client outbox and flushed
+ * opportunistically from the same client's session loop, so a closed SSH
  * window cannot block unrelated room activity.  Returns -1 if the channel is
  * gone, a write fails, or the bounded outbox is full. */
 int client_send(client_t *client, const char *data, size_t len);
@@ -21,6 +20,15 @@ int client_flush_output(client_t *client);
  * avoids writing to another client's SSH channel from the sender's thread. */
 void client_queue_bell(client_t *client);
 
+/* Per-session wakeup fd for the session loop (see client_t.wake_fds).
+ * client_wake_open() returns -1 if no fd could be created; the loop then
+ * falls back to a poll timeout.  client_wake() may be called from any
+ * thread and is a no-op without an open fd; client_wake_clear() drains it
+ * from the session thread.  The fd is closed by the final client_release(). */
+int client_wake_open(client_t *client);
+void client_wake(client_t *client);
+void client_wake_clear(client_t *client);
+
 /* Send one queued bell, if present, from the client's own session loop.
  * Returns 0 when no bell was pending or it was written successfully. */
 int client_flush_pending_bells(client_t *client);
@@ -29,6 +37,60 @@ int client_flush_pending_bells(client_t *client);
  * fit in 2048 bytes; truncation or encoding errors return -1. */
 int client_printf(client_t *client, const char *fmt, ...);
 
+/* Replace the text shown by the command-output pager.  The copy is sized to
+ * the text (capped at MAX_COMMAND_OUTPUT_LEN - 1); NULL closes it. */
+int client_set_command_output(client_t *client, const char *text);
+bool client_has_command_output(const client_t *client);
+/* Current pager text, or "" when none is open. */
+const char *client_command_output(const client_t *client);
+
+/* Record a heap buffer resize for `stats --memory`. */
+void client_mem_set(client_t *client, client_mem_kind_t kind, size_t bytes);
+/* Refresh the history accounting after a tnt_line_history_push(). */
+void client_note_history(client_t *client);
+/* Total bytes attributed to the client, including client_t itself.  When
+ * `bytes` is non-NULL it receives the per-buffer breakdown. */
+size_t client_memory_usage(client_t *client, size_t bytes[CLIENT_MEM_COUNT]);
+
+/* Delivery latency: the session thread calls this after queuing a frame
+ * that shows room updates, passing the oldest update's broadcast time.  The
+ * flush that drains the outbox records the queued -> flushed histogram. */
+void client_note_room_frame(client_t *client, uint64_t queued_us,
+                            uint64_t oldest_broadcast_us);
+
+typedef struct {
+    uint64_t enqueue_us;             /* Broadcast -> frame queued */
+    uint64_t flush_us;               /* Frame queued -> outbox drained */
+    uint64_t delivery_us;            /* Broadcast -> outbox drained */
+} client_latency_t;
+
+/* Worst figures seen by this client since it connected. */
+void client_latency_worst(client_t *client, client_latency_t *out);
+
+/* Add to one of the `sessions` activity counters. */
+static inline void client_usage_add(client_t *client, client_usage_kind_t kind,
+                                    uint64_t n) {
+    atomic_fetch_add_explicit(&client->usage[kind], n, memory_order_relaxed);
+}
+/* Store this thread's CLOCK_THREAD_CPUTIME_ID in CLIENT_USAGE_CPU_NS.
+ * Must be called from the client's own session thread. */
+void client_sample_cpu(client_t *client);
+/* Copy the activity counters. */
+void client_usage(client_t *client, uint64_t usage[CLIENT_USAGE_COUNT]);
+
+/* Release buffers an idle session can rebuild on demand: a drained outbox,
+ * the render buffer and the input-line state.  Must be called from the
+ * client's own session thread. */
+void client_trim_idle_memory(client_t *client);
+
+/* Zeroed client_t from the per-connection pool.  The final client_release()
+ * returns it. */
+client_t *client_new(void);
+
+/* Pool-backed channel callback structs, shared with the bootstrap code. */
+struct ssh_channel_callbacks_struct *client_channel_callbacks_new(void);
+void client_channel_callbacks_free(struct ssh_channel_callbacks_struct *cb);
+
 /* Reference counting for safe cross-thread cleanup.
  *
  * Lifecycle: bootstrap_run() creates the client_t with ref_count = 1
@@ -22,6 +22,7 @@
 #define TNT_EXIT_ERROR 1
 #define TNT_EXIT_USAGE 64
 #define TNT_EXIT_UNAVAILABLE 69
+#define TNT_EXIT_TEMPFAIL 75
 #define TNT_EXIT_CONFIG 78
 
 /* Configuration constants */
@@ -31,10 +32,19 @@
 #define MAX_EXEC_COMMAND_LEN 1024
 #define MAX_COMMAND_OUTPUT_LEN 8192
 #define CLIENT_OUTBOX_CAPACITY (128 * 1024)
+#define CLIENT_OUTBOX_INITIAL_CAPACITY 4096
 #define CLIENT_OUTBOX_FLUSH_BUDGET 32768
+#define CLIENT_IDLE_TRIM_SECONDS 30
+#define CLIENT_KEEPALIVE_INTERVAL_MS 15000
+#define CLIENT_REDRAW_MIN_INTERVAL_MS 100
 #define LOG_FILE "messages.log"
 #define MAX_LOG_SIZE (10 * 1024 * 1024)  /* 10 MiB */
 #define HOST_KEY_FILE "host_key"
+#define HOST_KEY_ED25519_FILE "host_key_ed25519"
+#define HOST_KEY_ECDSA_FILE "host_key_ecdsa"
+#define HANDOFF_SOCKET_FILE "handoff.sock"  /* Listener handoff to a new process */
+#define CONTROL_SOCKET_FILE "control.sock"  /* Local exec commands for tntctl --local */
+#define TNT_LISTEN_BACKLOG 512  /* Pending connections queued by the kernel */
 #define TNT_DEFAULT_STATE_DIR "."
 
 /* Backward-compatible names for older modules while config_defaults owns the
@@ -12,7 +12,26 @@
 #define TNT_DEFAULT_MAX_CONN_PER_IP 5
 #define TNT_DEFAULT_MAX_CONN_RATE_PER_IP 10
 #define TNT_DEFAULT_RATE_LIMIT_ENABLED 1
+#define TNT_DEFAULT_RATE_LIMIT_TABLE_SIZE 16384
+#define TNT_DEFAULT_RATE_LIMIT_TTL 600
+#define TNT_DEFAULT_RATE_LIMIT_V4_PREFIX 32
+#define TNT_DEFAULT_RATE_LIMIT_V6_PREFIX 128
 #define TNT_DEFAULT_IDLE_TIMEOUT 1800
+#define TNT_DEFAULT_SESSION_STACK_KB 128
+#define TNT_DEFAULT_MAX_PENDING_HANDSHAKES 16
+#define TNT_DEFAULT_KEX_TIMEOUT 10
+#define TNT_DEFAULT_AUTH_TIMEOUT 30
+#define TNT_DEFAULT_CHANNEL_TIMEOUT 10
+#define TNT_DEFAULT_ACCEPTORS 0
+#define TNT_DEFAULT_DRAIN_TIMEOUT 600
+#define TNT_DEFAULT_CONTROL_SOCKET 0
+#define TNT_DEFAULT_POST_RATE 60
+#define TNT_DEFAULT_POST_BURST 10
+#define TNT_DEFAULT_POST_IP_RATE 240
+#define TNT_DEFAULT_POST_IP_BURST 40
+#define TNT_DEFAULT_LOCK_PROFILE 0
+#define TNT_DEFAULT_CAPTURE 0
+#define TNT_DEFAULT_CAPTURE_MAX_MB 256
 
 #define TNT_MIN_PORT 1
 #define TNT_MAX_PORT 65535
@@ -20,8 +39,36 @@
 #define TNT_MAX_CONFIGURED_CLIENTS 1024
 #define TNT_MIN_RATE_LIMIT_ENABLED 0
 #define TNT_MAX_RATE_LIMIT_ENABLED 1
+#define TNT_MIN_RATE_LIMIT_TABLE_SIZE 256
+#define TNT_MAX_RATE_LIMIT_TABLE_SIZE 4194304
+#define TNT_MIN_RATE_LIMIT_TTL 60
+#define TNT_MAX_RATE_LIMIT_TTL 86400
+#define TNT_MIN_RATE_LIMIT_V4_PREFIX 8
+#define TNT_MAX_RATE_LIMIT_V4_PREFIX 32
+#define TNT_MIN_RATE_LIMIT_V6_PREFIX 16
+#define TNT_MAX_RATE_LIMIT_V6_PREFIX 128
 #define TNT_MIN_IDLE_TIMEOUT 0
 #define TNT_MAX_IDLE_TIMEOUT 86400
+#define TNT_MIN_SESSION_STACK_KB 64
+#define TNT_MAX_SESSION_STACK_KB 8192
+#define TNT_MIN_HANDSHAKE_TIMEOUT 1
+#define TNT_MAX_HANDSHAKE_TIMEOUT 600
+#define TNT_MIN_ACCEPTORS 0
+#define TNT_MAX_ACCEPTORS 64
+#define TNT_MIN_DRAIN_TIMEOUT 0
+#define TNT_MAX_DRAIN_TIMEOUT 86400
+#define TNT_MIN_CONTROL_SOCKET 0
+#define TNT_MAX_CONTROL_SOCKET 1
+#define TNT_MIN_POST_RATE 0
+#define TNT_MAX_POST_RATE 60000
+#define TNT_MIN_POST_BURST 1
+#define TNT_MAX_POST_BURST 10000
+#define TNT_MIN_LOCK_PROFILE 0
+#define TNT_MAX_LOCK_PROFILE 1
+#define TNT_MIN_CAPTURE 0
+#define TNT_MAX_CAPTURE 1
+#define TNT_MIN_CAPTURE_MAX_MB 1
+#define TNT_MAX_CAPTURE_MAX_MB 65536
 #define TNT_MIN_SSH_LOG_LEVEL 0
 #define TNT_MAX_SSH_LOG_LEVEL 4
 
@@ -37,7 +84,26 @@ extern const tnt_int_config_spec_t TNT_CONFIG_MAX_CONNECTIONS;
 extern const tnt_int_config_spec_t TNT_CONFIG_MAX_CONN_PER_IP;
 extern const tnt_int_config_spec_t TNT_CONFIG_MAX_CONN_RATE_PER_IP;
 extern const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT;
+extern const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_TABLE_SIZE;
+extern const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_TTL;
+extern const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_V4_PREFIX;
+extern const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_V6_PREFIX;
 extern const tnt_int_config_spec_t TNT_CONFIG_IDLE_TIMEOUT;
+extern const tnt_int_config_spec_t TNT_CONFIG_SESSION_STACK_KB;
+extern const tnt_int_config_spec_t TNT_CONFIG_MAX_PENDING_HANDSHAKES;
+extern const tnt_int_config_spec_t TNT_CONFIG_KEX_TIMEOUT;
+extern const tnt_int_config_spec_t TNT_CONFIG_AUTH_TIMEOUT;
+extern const tnt_int_config_spec_t TNT_CONFIG_CHANNEL_TIMEOUT;
+extern const tnt_int_config_spec_t TNT_CONFIG_ACCEPTORS;
+extern const tnt_int_config_spec_t TNT_CONFIG_DRAIN_TIMEOUT;
+extern const tnt_int_config_spec_t TNT_CONFIG_CONTROL_SOCKET;
+extern const tnt_int_config_spec_t TNT_CONFIG_POST_RATE;
+extern const tnt_int_config_spec_t TNT_CONFIG_POST_BURST;
+extern const tnt_int_config_spec_t TNT_CONFIG_POST_IP_RATE;
+extern const tnt_int_config_spec_t TNT_CONFIG_POST_IP_BURST;
+extern const tnt_int_config_spec_t TNT_CONFIG_LOCK_PROFILE;
+extern const tnt_int_config_spec_t TNT_CONFIG_CAPTURE;
+extern const tnt_int_config_spec_t TNT_CONFIG_CAPTURE_MAX_MB;
 extern const tnt_int_config_spec_t TNT_CONFIG_SSH_LOG_LEVEL;
 
 int tnt_config_env_int(const tnt_int_config_spec_t *spec);
@@ -0,0 +1,37 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stddef.h>
+
+/* Local control socket.
+ *
+ * With TNT_CONTROL_SOCKET=1 the server answers exec commands on a UNIX
+ * socket in the state directory, so local monitoring skips the SSH
+ * handshake.  The socket is mode 0600 and peers running as another uid
+ * are refused.
+ *
+ * Protocol: the client sends "TNT-CONTROL 1 LOGIN\n" followed by one
+ * "COMMAND\n" line, where LOGIN is the post identity or "-" for none.  The
+ * server answers "STATUS\n" with the exec exit status, then the command
+ * output, and closes the connection. */
+
+/* Writes `len` bytes of command output.  Returns 0 or -1. */
+typedef int (*control_write_fn)(void *sink, const char *data, size_t len);
+
+/* Runs one command and returns its exit status.  `login` is NULL when the
+ * client sent none. */
+typedef int (*control_handler_fn)(const char *login, const char *command,
+                                  control_write_fn write_fn, void *sink,
+                                  void *ctx);
+
+/* Listen on `path` from a detached thread that serves one connection at a
+ * time.  Returns 0 or -1 if the socket cannot be created. */
+int control_server_start(const char *path, control_handler_fn handler,
+                         void *ctx);
+
+/* Run `command` on the server at `path`, copying its output to `out_fd`.
+ * Returns the remote exit status, or -1 if no server answered. */
+int control_request(const char *path, const char *login, const char *command,
+                    int out_fd);
+
+#endif /* CONTROL_H */
@@ -1,17 +1,64 @@
 #ifndef EXEC_H
 #define EXEC_H
 
+#include "post_limit.h"
 #include "ssh_server.h"  /* for client_t */
 
-/* Dispatch the non-interactive SSH exec command stored in
- * client->exec_command.  Returns the exit status to send back to the
- * SSH client:
+/* Output sink for exec commands.  Returns 0 when all `len` bytes were
+ * written, -1 otherwise. */
+typedef int (*exec_write_fn)(void *sink, const char *data, size_t len);
+
+typedef struct {
+    exec_write_fn write;
+    void *sink;
+    ui_lang_t lang;
+    const char *login;        /* post identity; NULL or invalid = anonymous */
+    const char *client_ip;    /* post rate-limit source; NULL = local */
+    const client_t *sender;   /* skipped by @mention bells; may be NULL */
+    bool local;               /* control socket: may flip runtime switches */
+} exec_context_t;
+
+/* Server counters shared by `stats` and the metrics endpoint. */
+typedef struct {
+    int online_users;
+    int message_count;
+    int client_capacity;
+    int active_connections;
+    int pending_handshakes;
+    unsigned long kex_timeouts;
+    unsigned long auth_timeouts;
+    unsigned long channel_timeouts;
+    unsigned long posts_throttled[POST_KIND_COUNT];
+    long uptime_seconds;
+} exec_stats_t;
+
+/* Snapshot the counters; takes the room read lock briefly. */
+void exec_stats_collect(exec_stats_t *stats);
+
+/* Append `stats` in the Prometheus text exposition format. */
+void exec_stats_append_metrics(const exec_stats_t *stats, char *buffer,
+                               size_t buf_size, size_t *pos);
+
+/* Run one exec command line and write its output through ctx->write.
+ * Returns the exit status:
  *   TNT_EXIT_OK     = success
  *   TNT_EXIT_ERROR  = runtime error (I/O, OOM, persistence failure)
  *   TNT_EXIT_USAGE  = usage error (unknown command, bad args)
+ *   TNT_EXIT_TEMPFAIL = `post` refused by the posting rate limit
+ *
+ * Reads g_room and shared client state; callable from any thread. */
+int exec_run(const exec_context_t *ctx, const char *command);
+
+/* Serve one SSH exec request on an authenticated session: run `command`
+ * (NULL when the request was too long), stream its output, then send the
+ * exit status, EOF and close and wait briefly for the peer's close.  No
+ * client_t is created and the room is never joined.  Returns the exit
+ * status sent (see exec_run()).
  *
- * Reads g_room and shared client state.  Safe to call once per
- * exec-mode session before the channel is closed. */
-int exec_dispatch(client_t *client);
+ * Leaves `session` non-blocking; the caller still frees the channel and
+ * the session. */
+int exec_session_run(ssh_session session, ssh_channel channel,
+                     const char *login, const char *client_ip,
+                     const char *command);
 
 #endif /* EXEC_H */
@@ -7,7 +7,11 @@ typedef enum {
     TNT_EXEC_COMMAND_HELP,
     TNT_EXEC_COMMAND_HEALTH,
     TNT_EXEC_COMMAND_USERS,
+    TNT_EXEC_COMMAND_SESSIONS,
     TNT_EXEC_COMMAND_STATS,
+    TNT_EXEC_COMMAND_METRICS,
+    TNT_EXEC_COMMAND_LOCKS,
+    TNT_EXEC_COMMAND_TRACE,
     TNT_EXEC_COMMAND_TAIL,
     TNT_EXEC_COMMAND_DUMP,
     TNT_EXEC_COMMAND_POST,
@@ -18,6 +22,8 @@ typedef enum {
 bool exec_catalog_match(const char *line, tnt_exec_command_id_t *id,
                         const char **args);
 bool exec_catalog_args_valid(tnt_exec_command_id_t id, const char *args);
+/* True when whitespace-separated `args` contains `flag` as a whole token. */
+bool exec_catalog_has_flag(const char *args, const char *flag);
 void exec_catalog_append_help(char *buffer, size_t buf_size, size_t *pos,
                               ui_lang_t lang);
 void exec_catalog_append_command_list(char *buffer, size_t buf_size,
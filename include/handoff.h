@@ -0,0 +1,33 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+/* Listener handoff for zero-downtime restarts.
+ *
+ * A running server offers its listening sockets on a UNIX socket in the
+ * state directory.  A new process started with --takeover connects,
+ * receives the descriptors with SCM_RIGHTS and acknowledges; only then does
+ * the old process stop accepting.  The listening sockets are never closed,
+ * so connections arriving during the switch queue in the kernel backlog
+ * instead of being refused.
+ *
+ * Protocol: client sends "TNT-HANDOFF 1\n", server answers with the fds,
+ * client answers "OK\n".  A client that drops before acknowledging leaves
+ * the server accepting and still offering the handoff. */
+
+/* Copies up to `max` listening fds into `fds` and returns the count. */
+typedef int (*handoff_export_fn)(int *fds, int max, void *ctx);
+
+/* Called once, from the handoff thread, after a new process has the fds. */
+typedef void (*handoff_done_fn)(void *ctx);
+
+/* Listen on `path` (mode 0600, same-uid peers only) from a detached
+ * thread.  The thread exits after one successful handoff.  Returns 0 or
+ * -1 if the socket cannot be created. */
+int handoff_server_start(const char *path, handoff_export_fn export_fn,
+                         handoff_done_fn done_fn, void *ctx);
+
+/* Take over the listeners offered at `path`.  Stores at most `max` fds and
+ * returns how many, or -1 if no server answered. */
+int handoff_request(const char *path, int *fds, int max);
+
+#endif /* HANDOFF_H */
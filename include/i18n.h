@@ -23,6 +23,7 @@ typedef enum {
     I18N_WELCOME_FALLBACK_FORMAT,
     I18N_INSERT_HINT_WIDE,
     I18N_INSERT_HINT_NARROW,
+    I18N_POST_THROTTLED_HINT,
     I18N_NORMAL_LATEST,
     I18N_NORMAL_NEW_MESSAGES,
     I18N_HELP_TITLE,
@@ -46,6 +47,7 @@ typedef enum {
     I18N_USERS_TITLE,
     I18N_MSG_SENT_FORMAT,
     I18N_MSG_USER_NOT_FOUND_FORMAT,
+    I18N_MSG_THROTTLED_FORMAT,
     I18N_REPLY_NO_TARGET,
     I18N_INBOX_TITLE,
     I18N_INBOX_EMPTY,
@@ -77,6 +79,9 @@ typedef enum {
     I18N_EXEC_POST_INVALID_UTF8,
     I18N_EXEC_POST_TOO_LONG,
     I18N_EXEC_POST_PERSIST_FAILED,
+    I18N_EXEC_POST_THROTTLED,
+    I18N_EXEC_LOCKS_LOCAL_ONLY,
+    I18N_EXEC_TRACE_LOCAL_ONLY,
     I18N_EXEC_COMMAND_TOO_LONG,
     I18N_EXEC_UNKNOWN_COMMAND_FORMAT,
     I18N_TEXT_COUNT
@@ -10,14 +10,14 @@ void input_init(void);
 /* Run the interactive session for an already-bootstrapped client_t.
  *
  * Sequence:
- *   1. If client->exec_command is set, dispatch it via exec_dispatch and
- *      return (no chat-room join).
- *   2. Read the desired username from the channel.
- *   3. Add the client to g_room and broadcast a system join message.
- *   4. Optionally show the MOTD if state-dir/motd.txt exists.
- *   5. Drive the keyboard / room-update / keepalive / idle-timeout loop
+ *   1. Read the desired username from the channel.
+ *   2. Add the client to g_room and broadcast a system join message.
+ *   3. Optionally show the MOTD if state-dir/motd.txt exists.
+ *   4. Drive the keyboard / room-update / keepalive / idle-timeout loop
  *      until the client disconnects.
- *   6. Broadcast a system leave message and release all refs / counters.
+ *   5. Broadcast a system leave message and release all refs / counters.
+ *
+ * Exec requests never get here; see exec_session_run().
  *
  * Owns the client_t after entry: callers must NOT touch it once this
  * returns.  Always returns regardless of how the session ended. */
@@ -0,0 +1,55 @@
+#ifndef INPUT_RENDER_H
+#define INPUT_RENDER_H
+
+#include "common.h"
+
+/* What the INSERT-mode input line last put on the terminal.  Only valid
+ * while the line is drawn from column 3 without horizontal scrolling or a
+ * length gauge, and while nothing else has repainted the bottom row; any
+ * other renderer must reset it. */
+typedef struct {
+    char shown[MAX_MESSAGE_LEN];
+    size_t shown_len;
+    int shown_width;
+    int cols;
+    int rows;
+    bool valid;
+} tnt_input_render_state_t;
+
+typedef enum {
+    TNT_INPUT_RENDER_FULL = 0,       /* Repaint the whole row */
+    TNT_INPUT_RENDER_APPEND,         /* Emit input[offset..] at the cursor */
+    TNT_INPUT_RENDER_ERASE,          /* Move left `width` columns, clear to EOL */
+    TNT_INPUT_RENDER_UNCHANGED
+} tnt_input_render_op_t;
+
+typedef struct {
+    tnt_input_render_op_t op;
+    size_t offset;
+    int width;
+} tnt_input_render_plan_t;
+
+void tnt_input_render_reset(tnt_input_render_state_t *state);
+
+/* True when the line is long enough to show the remaining-bytes gauge. */
+bool tnt_input_render_wants_gauge(size_t input_len);
+
+/* Decide the cheapest update from the last drawn line to `input` on a
+ * cols x rows terminal.  Only pure appends and trailing erasures that keep
+ * the line unscrolled and gauge-free are drawn incrementally. */
+tnt_input_render_plan_t tnt_input_render_plan(
+    const tnt_input_render_state_t *state, const char *input,
+    size_t input_len, int cols, int rows);
+
+/* Record the result of an incremental update returned by the planner. */
+void tnt_input_render_apply(tnt_input_render_state_t *state,
+                            const tnt_input_render_plan_t *plan,
+                            const char *input, size_t input_len);
+
+/* Record a full repaint.  The state only stays valid when the whole line
+ * fit without scrolling or a gauge, i.e. the cursor ends after the text. */
+void tnt_input_render_full(tnt_input_render_state_t *state, const char *input,
+                           size_t input_len, int input_width, int cols,
+                           int rows);
+
+#endif /* INPUT_RENDER_H */
@@ -0,0 +1,31 @@
+#ifndef LINE_HISTORY_H
+#define LINE_HISTORY_H
+
+#include "common.h"
+
+#define TNT_LINE_HISTORY_SIZE 16
+
+/* Per-session recall history (INSERT messages, COMMAND lines).  Entries are
+ * allocated on push and sized to the stored line, so a session that never
+ * sends anything carries only the pointer array. */
+typedef struct {
+    char *lines[TNT_LINE_HISTORY_SIZE];  /* Oldest first */
+    int count;
+    int pos;                             /* Recall cursor; == count at rest */
+} tnt_line_history_t;
+
+/* Append `line`, truncated to max_len - 1 bytes on a UTF-8 boundary, dropping
+ * the oldest entry when full.  Resets the recall cursor.  Returns -1 on
+ * allocation failure, leaving the history unchanged. */
+int tnt_line_history_push(tnt_line_history_t *history, const char *line,
+                          size_t max_len);
+
+/* Entry `index` (0 = oldest) or NULL when out of range. */
+const char *tnt_line_history_get(const tnt_line_history_t *history, int index);
+
+void tnt_line_history_clear(tnt_line_history_t *history);
+
+/* Heap bytes owned by the stored entries. */
+size_t tnt_line_history_bytes(const tnt_line_history_t *history);
+
+#endif /* LINE_HISTORY_H */
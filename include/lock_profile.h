@@ -0,0 +1,109 @@
+#ifndef LOCK_PROFILE_H
+#define LOCK_PROFILE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Opt-in contention profiling for the shared locks.
+ *
+ * Call sites take profiled locks through the LOCK_PROFILE_* macros, which
+ * record the file:line.  While profiling is off a lock costs one relaxed
+ * load and an unlock one thread-local load on top of the pthread call.
+ * While on, each acquisition records its wait and hold time in per-lock
+ * histograms and per-call-site totals.  Switch it with TNT_LOCK_PROFILE=1
+ * or `locks --on` / `locks --off` on the local control socket. */
+
+typedef enum {
+    LOCK_ID_ROOM,                  /* g_room->lock */
+    LOCK_ID_MESSAGE_FILE,          /* g_message_file_lock */
+    LOCK_ID_COUNT
+} lock_id_t;
+
+#define LOCK_PROFILE_STR2(x) #x
+#define LOCK_PROFILE_STR(x) LOCK_PROFILE_STR2(x)
+#define LOCK_PROFILE_SITE __FILE__ ":" LOCK_PROFILE_STR(__LINE__)
+
+#define LOCK_PROFILE_RDLOCK(lock, id) \
+    lock_profile_rdlock((lock), (id), LOCK_PROFILE_SITE)
+#define LOCK_PROFILE_WRLOCK(lock, id) \
+    lock_profile_wrlock((lock), (id), LOCK_PROFILE_SITE)
+#define LOCK_PROFILE_RWUNLOCK(lock) lock_profile_rwunlock(lock)
+#define LOCK_PROFILE_MUTEX_LOCK(lock, id) \
+    lock_profile_mutex_lock((lock), (id), LOCK_PROFILE_SITE)
+#define LOCK_PROFILE_MUTEX_UNLOCK(lock) lock_profile_mutex_unlock(lock)
+
+extern atomic_bool g_lock_profile_enabled;
+/* Profiled locks this thread holds; unlocks only look further when > 0. */
+extern _Thread_local int t_lock_profile_depth;
+
+void lock_profile_set_enabled(bool enabled);
+bool lock_profile_enabled(void);
+/* Clear all histograms and call-site totals. */
+void lock_profile_reset(void);
+
+/* Slow paths behind the inline wrappers. */
+uint64_t lock_profile_now_us(void);
+void lock_profile_acquired(lock_id_t id, bool write, const void *lock,
+                           const char *site, uint64_t wait_start_us);
+void lock_profile_released(const void *lock);
+
+/* Text report: per-lock totals and wait/hold quantiles, then the call
+ * sites with the most cumulative wait. */
+void lock_profile_append_text(char *buffer, size_t buf_size, size_t *pos);
+/* The same as one JSON object followed by a newline. */
+void lock_profile_append_json(char *buffer, size_t buf_size, size_t *pos);
+
+static inline void lock_profile_rdlock(pthread_rwlock_t *lock, lock_id_t id,
+                                       const char *site) {
+    if (atomic_load_explicit(&g_lock_profile_enabled, memory_order_relaxed)) {
+        uint64_t start = lock_profile_now_us();
+
+        pthread_rwlock_rdlock(lock);
+        lock_profile_acquired(id, false, lock, site, start);
+        return;
+    }
+    pthread_rwlock_rdlock(lock);
+}
+
+static inline void lock_profile_wrlock(pthread_rwlock_t *lock, lock_id_t id,
+                                       const char *site) {
+    if (atomic_load_explicit(&g_lock_profile_enabled, memory_order_relaxed)) {
+        uint64_t start = lock_profile_now_us();
+
+        pthread_rwlock_wrlock(lock);
+        lock_profile_acquired(id, true, lock, site, start);
+        return;
+    }
+    pthread_rwlock_wrlock(lock);
+}
+
+static inline void lock_profile_rwunlock(pthread_rwlock_t *lock) {
+    if (t_lock_profile_depth > 0) {
+        lock_profile_released(lock);
+    }
+    pthread_rwlock_unlock(lock);
+}
+
+static inline void lock_profile_mutex_lock(pthread_mutex_t *lock,
+                                           lock_id_t id, const char *site) {
+    if (atomic_load_explicit(&g_lock_profile_enabled, memory_order_relaxed)) {
+        uint64_t start = lock_profile_now_us();
+
+        pthread_mutex_lock(lock);
+        lock_profile_acquired(id, true, lock, site, start);
+        return;
+    }
+    pthread_mutex_lock(lock);
+}
+
+static inline void lock_profile_mutex_unlock(pthread_mutex_t *lock) {
+    if (t_lock_profile_depth > 0) {
+        lock_profile_released(lock);
+    }
+    pthread_mutex_unlock(lock);
+}
+
+#endif /* LOCK_PROFILE_H */
@@ -0,0 +1,18 @@
+#ifndef MESSAGE_FORMAT_H
+#define MESSAGE_FORMAT_H
+
+#include "common.h"
+#include "message.h"
+#include "theme.h"
+
+/* True when `content` contains "@username". */
+bool message_mentions_user(const char *content, const char *username);
+
+/* Format one room message as a coloured history line no wider than `width`
+ * columns.  Messages from or mentioning `my_username` are marked for that
+ * viewer. */
+void message_format_colored(const message_t *msg, char *buffer,
+                            size_t buf_size, int width,
+                            const char *my_username, const theme_t *theme);
+
+#endif /* MESSAGE_FORMAT_H */
@@ -0,0 +1,91 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Process-wide counters, gauges and histograms for the hot paths.
+ *
+ * Counters and histograms are sharded: each thread adds to its own
+ * cache-line-aligned shard with a relaxed atomic, and readers sum the
+ * shards.  Updating never takes a lock or allocates, so call sites can sit
+ * inside client_send() or the render loop.  Gauges are single atomics. */
+
+typedef enum {
+    METRIC_MESSAGES_POSTED,
+    METRIC_MESSAGES_BROADCAST,
+    METRIC_MESSAGE_SAVE_FAILURES,
+    METRIC_CLIENT_BYTES_QUEUED,
+    METRIC_CLIENT_BYTES_FLUSHED,
+    METRIC_CLIENT_SEND_FAILURES,
+    METRIC_CONN_REJECTED_TABLE_FULL,
+    METRIC_CONN_REJECTED_PER_IP,
+    METRIC_CONN_REJECTED_BLOCKED,
+    METRIC_CONN_REJECTED_RATE,
+    METRIC_CONN_REJECTED_GLOBAL,
+    METRIC_AUTH_FAILURE_BLOCKS,
+    METRIC_MODULE_EVENTS_DROPPED,
+    METRIC_MODULE_RESPONSES_DROPPED,
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+typedef enum {
+    METRIC_GAUGE_OUTBOX_HIGH_WATER,
+    METRIC_GAUGE_MODULE_QUEUE_DEPTH,
+    METRIC_GAUGE_COUNT
+} metric_gauge_t;
+
+typedef enum {
+    METRIC_HIST_MESSAGE_SAVE_US,
+    METRIC_HIST_RENDER_US,
+    METRIC_HIST_RENDER_BYTES,
+    METRIC_HIST_DELIVERY_ENQUEUE_US,  /* room_broadcast() -> frame queued */
+    METRIC_HIST_DELIVERY_FLUSH_US,    /* Frame queued -> outbox drained */
+    METRIC_HIST_COUNT
+} metric_hist_t;
+
+/* Finite upper bounds per histogram; one more bucket holds the rest. */
+#define METRICS_HIST_BOUNDS 12
+
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    uint64_t gauges[METRIC_GAUGE_COUNT];
+    struct {
+        uint64_t buckets[METRICS_HIST_BOUNDS + 1];  /* Not cumulative */
+        uint64_t count;
+        uint64_t sum;
+    } hists[METRIC_HIST_COUNT];
+} metrics_snapshot_t;
+
+void metrics_add(metric_counter_t id, uint64_t n);
+static inline void metrics_inc(metric_counter_t id) { metrics_add(id, 1); }
+
+void metrics_gauge_set(metric_gauge_t id, uint64_t value);
+/* Raise the gauge to `value` if it is higher (high-water marks). */
+void metrics_gauge_max(metric_gauge_t id, uint64_t value);
+
+void metrics_observe(metric_hist_t id, uint64_t value);
+
+/* Monotonic microseconds, for timing an observation. */
+uint64_t metrics_now_us(void);
+
+/* Sum all shards.  Concurrent updates may or may not be included. */
+void metrics_snapshot(metrics_snapshot_t *snap);
+
+/* Upper bound of the bucket holding quantile `q` (0..1) of a snapshot
+ * histogram; 0 when it is empty, UINT64_MAX past the last bound. */
+uint64_t metrics_hist_quantile(const metrics_snapshot_t *snap,
+                               metric_hist_t id, double q);
+
+/* Zero everything.  Only for tests; not safe against concurrent updates. */
+void metrics_reset(void);
+
+/* Append the registry in the Prometheus text exposition format. */
+void metrics_append_prometheus(const metrics_snapshot_t *snap, char *buffer,
+                               size_t buf_size, size_t *pos);
+
+/* Append the registry as one JSON object followed by a newline. */
+void metrics_append_json(const metrics_snapshot_t *snap, char *buffer,
+                         size_t buf_size, size_t *pos);
+
+#endif /* METRICS_H */
@@ -0,0 +1,42 @@
+#ifndef METRICS_HTTP_H
+#define METRICS_HTTP_H
+
+#include <stddef.h>
+
+/* Minimal HTTP/1.1 responder for health checks and metrics scraping.
+ *
+ * It runs on its own thread with a small poll() loop, answers GET and HEAD
+ * only, keeps connections alive for scrapers that reuse them, and never
+ * touches the SSH stack.  There is no authentication: bind it to loopback
+ * or a trusted network. */
+
+#define METRICS_HTTP_MAX_CLIENTS 16
+#define METRICS_HTTP_BODY_MAX 65536
+
+/* Fill `body` (capacity `body_size`) for `path`, with any query string
+ * removed, and store its length.  Returns the HTTP status to send: 200, or
+ * 404 for unknown paths. */
+typedef int (*metrics_http_handler_fn)(const char *path, char *body,
+                                       size_t body_size, size_t *body_len,
+                                       void *ctx);
+
+/* Parse "HOST:PORT", "[IPV6]:PORT" or a bare "PORT" (loopback).  Returns 0
+ * or -1 when the text is malformed or the port is out of range. */
+int metrics_http_parse_listen(const char *text, char *host, size_t host_size,
+                              int *port);
+
+/* Bind `listen_spec` now and serve it from a detached thread.  Returns 0,
+ * or -1 with a message on stderr if the address cannot be bound. */
+int metrics_http_start(const char *listen_spec, metrics_http_handler_fn handler,
+                       void *ctx);
+
+/* Close the listener and every connection, and wait for the thread to
+ * exit, so another process can bind the address.  A no-op when no
+ * endpoint is running. */
+void metrics_http_stop(void);
+
+/* Port actually bound by the last successful metrics_http_start(); useful
+ * when the spec asked for port 0. */
+int metrics_http_bound_port(void);
+
+#endif /* METRICS_HTTP_H */
@@ -0,0 +1,76 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include "common.h"
+
+/* Fixed-size object pool with a bounded free list.
+ *
+ * Per-connection structures (client_t, bootstrap contexts, channel callback
+ * structs) are recycled through a pool instead of going back to malloc on
+ * every disconnect, so reconnect storms reuse the same memory rather than
+ * churning and fragmenting the heap.  At most `max_free` idle objects are
+ * kept; anything beyond that is returned to the allocator. */
+typedef struct tnt_pool_node {
+    struct tnt_pool_node *next;
+} tnt_pool_node_t;
+
+typedef struct tnt_pool {
+    const char *name;
+    size_t object_size;
+    size_t max_free;
+    pthread_mutex_t lock;
+    tnt_pool_node_t *free_list;
+    size_t free_count;
+    size_t in_use;
+    unsigned long reused;
+    unsigned long allocated;
+    atomic_bool registered;
+    struct tnt_pool *next_pool;
+} tnt_pool_t;
+
+#define TNT_POOL_DEFAULT_MAX_FREE 64
+
+#define TNT_POOL_INITIALIZER(pool_name, type, max_idle) \
+    { (pool_name), sizeof(type), (max_idle), PTHREAD_MUTEX_INITIALIZER, \
+      NULL, 0, 0, 0, 0, false, NULL }
+
+/* Zero-filled object, reused from the free list when possible. */
+void *tnt_pool_alloc(tnt_pool_t *pool);
+void tnt_pool_free(tnt_pool_t *pool, void *object);
+
+/* Byte buffers in power-of-two size classes from TNT_BUFFER_POOL_MIN to
+ * TNT_BUFFER_POOL_MAX.  *capacity receives the usable size, which may exceed
+ * min_size; pass it back unchanged to tnt_buffer_pool_free().  Requests above
+ * the largest class fall through to plain malloc. */
+#define TNT_BUFFER_POOL_MIN (4 * 1024)
+#define TNT_BUFFER_POOL_MAX (256 * 1024)
+#define TNT_BUFFER_POOL_MAX_FREE 16
+
+void *tnt_buffer_pool_alloc(size_t min_size, size_t *capacity);
+void tnt_buffer_pool_free(void *buffer, size_t capacity);
+
+/* Swap `buffer` for one holding at least min_size bytes, preserving the
+ * first `keep` bytes.  Returns NULL (leaving the old buffer intact) on
+ * allocation failure. */
+void *tnt_buffer_pool_resize(void *buffer, size_t capacity, size_t keep,
+                             size_t min_size, size_t *new_capacity);
+
+/* True when a buffer of `capacity` already is the size class min_size maps
+ * to, so a resize would only swap it for an identical one.  Above the
+ * largest class, a buffer is kept until half of it would do. */
+bool tnt_buffer_pool_fits(size_t capacity, size_t min_size);
+
+typedef struct {
+    const char *name;
+    size_t object_size;
+    size_t free_count;
+    size_t in_use;
+    unsigned long reused;
+    unsigned long allocated;
+} tnt_pool_stats_t;
+
+/* Snapshot every pool used so far, including one entry per buffer class.
+ * Returns the number of entries written (at most max_entries). */
+int tnt_pool_collect_stats(tnt_pool_stats_t *out, int max_entries);
+
+#endif /* OBJECT_POOL_H */
@@ -0,0 +1,43 @@
+#ifndef POST_LIMIT_H
+#define POST_LIMIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Token buckets bounding how fast one poster can make the room fan out.
+ *
+ * Every public message, whisper, exec `post` and module message takes one
+ * token from the poster's bucket (TNT_POST_RATE per minute, burst
+ * TNT_POST_BURST) and one from its source IP's bucket (TNT_POST_IP_RATE,
+ * TNT_POST_IP_BURST).  A rate of 0 disables that bucket.  Buckets live in
+ * fixed-size tables; idle ones are recycled, so memory does not grow with
+ * the number of distinct posters. */
+
+typedef enum {
+    POST_KIND_PUBLIC,
+    POST_KIND_WHISPER,
+    POST_KIND_EXEC,
+    POST_KIND_MODULE,
+    POST_KIND_COUNT
+} post_kind_t;
+
+/* Read the TNT_POST_* settings.  Call once at startup; calling again
+ * resets all buckets and counters. */
+void post_limit_init(void);
+
+/* Take a token for one post by `user` from `ip`.  Either may be NULL or
+ * empty to skip that bucket (e.g. no IP for the local control socket).
+ * Returns false, and counts a rejection for `kind`, when either bucket is
+ * empty; nothing is taken then. */
+bool post_limit_allow(post_kind_t kind, const char *user, const char *ip);
+
+/* Rejected posts of `kind` since post_limit_init(). */
+unsigned long post_limit_rejected(post_kind_t kind);
+
+/* Stable lowercase name ("public", "whisper", "exec", "module"). */
+const char *post_limit_kind_name(post_kind_t kind);
+
+/* Test hook: replace the millisecond monotonic clock.  NULL restores it. */
+void post_limit_set_time_source(uint64_t (*now_fn)(void));
+
+#endif /* POST_LIMIT_H */
@@ -2,9 +2,18 @@
 #define RATELIMIT_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
 
 /* Read TNT_MAX_CONNECTIONS / TNT_MAX_CONN_PER_IP / TNT_MAX_CONN_RATE_PER_IP /
- * TNT_RATE_LIMIT from the environment.  Idempotent, call once at startup. */
+ * TNT_RATE_LIMIT and the TNT_RATE_LIMIT_* table settings from the
+ * environment.  Call once at startup; calling again drops all per-IP state.
+ *
+ * Per-IP state lives in a sharded open-addressing table keyed by the binary
+ * address.  IPv4 addresses can be aggregated to a /N (TNT_RATE_LIMIT_V4_PREFIX)
+ * and IPv6 to a /N (TNT_RATE_LIMIT_V6_PREFIX) so that rotating through a
+ * subnet does not dodge the limits.  Idle entries expire after
+ * TNT_RATE_LIMIT_TTL seconds. */
 void ratelimit_init(void);
 
 /* Per-IP entry point: returns false if the IP has hit any limit (concurrent,
@@ -24,4 +33,12 @@ void ratelimit_decrement_total(void);
 /* Read-only accessor for stats subcommand. */
 int  ratelimit_get_active_total(void);
 
+/* Number of live (non-expired) per-IP entries, and total slot capacity. */
+size_t ratelimit_tracked_entries(void);
+size_t ratelimit_table_capacity(void);
+
+/* Test hook: replace the clock used for windows, blocks and expiry.
+ * NULL restores time(). */
+void ratelimit_set_time_source(time_t (*now_fn)(void));
+
 #endif /* RATELIMIT_H */
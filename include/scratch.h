@@ -0,0 +1,29 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include "common.h"
+
+#define TNT_SCRATCH_CAPACITY (64 * 1024)
+
+/* Per-thread scratch arena for large temporaries (render buffers, command
+ * output, log lines) that used to live on session thread stacks.  Usage is
+ * strictly LIFO: take a mark, allocate, and release back to the mark before
+ * returning.  The arena is allocated on first use and freed at thread exit
+ * or by tnt_scratch_trim() once nothing is outstanding. */
+typedef size_t tnt_scratch_mark_t;
+
+tnt_scratch_mark_t tnt_scratch_mark(void);
+
+/* Uninitialized, 16-byte aligned, or NULL when the arena is exhausted. */
+void *tnt_scratch_alloc(size_t size);
+
+void tnt_scratch_release(tnt_scratch_mark_t mark);
+
+/* Free this thread's arena if no allocation is outstanding. */
+void tnt_scratch_trim(void);
+
+/* Bytes in use and the peak for the calling thread. */
+size_t tnt_scratch_used(void);
+size_t tnt_scratch_high_water(void);
+
+#endif /* SCRATCH_H */
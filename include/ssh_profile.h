@@ -0,0 +1,63 @@
+#ifndef SSH_PROFILE_H
+#define SSH_PROFILE_H
+
+#include "common.h"
+
+/* Host key types and handshake algorithm profiles.
+ *
+ * Host key signing dominates server CPU per handshake: an Ed25519 signature
+ * costs a few tens of microseconds, RSA-4096 several milliseconds.  TNT
+ * therefore keeps one key file per type under the state directory and
+ * offers the cheap types first, while still loading an existing RSA key so
+ * clients that pinned its fingerprint keep working. */
+#define TNT_HOST_KEYS_DEFAULT "auto"
+#define TNT_SSH_PROFILE_DEFAULT "default"
+
+typedef enum {
+    TNT_HOST_KEY_ED25519 = 1u << 0,
+    TNT_HOST_KEY_ECDSA = 1u << 1,
+    TNT_HOST_KEY_RSA = 1u << 2,
+} tnt_host_key_kind_t;
+
+#define TNT_HOST_KEY_ALL \
+    (TNT_HOST_KEY_ED25519 | TNT_HOST_KEY_ECDSA | TNT_HOST_KEY_RSA)
+
+typedef struct {
+    tnt_host_key_kind_t kind;
+    const char *name;       /* Token used in TNT_HOST_KEYS */
+    const char *file_name;  /* Relative to the state directory */
+    const char *label;      /* Human-readable type for log lines */
+    const char *algorithm;  /* Signature algorithm clients negotiate */
+} tnt_host_key_info_t;
+
+/* Host key types in preference order (cheapest signature first). */
+size_t tnt_host_key_info_count(void);
+const tnt_host_key_info_t *tnt_host_key_info_at(size_t index);
+
+/* Parse a comma-separated list such as "ed25519,rsa".  "auto" yields
+ * *required = ED25519 and *optional = the other types, meaning they are
+ * loaded when their key file already exists but never generated.  An
+ * explicit list makes every listed type required and nothing optional. */
+bool tnt_host_keys_parse(const char *text, unsigned int *required,
+                         unsigned int *optional);
+
+/* Algorithm preference lists applied to the SSH bind.  NULL fields keep
+ * the libssh defaults. */
+typedef struct {
+    const char *name;
+    const char *description;
+    const char *key_exchange;
+    const char *ciphers;
+    const char *hmac;
+    const char *hostkey_algorithms;
+} tnt_ssh_profile_t;
+
+const tnt_ssh_profile_t *tnt_ssh_profile_find(const char *name);
+size_t tnt_ssh_profile_count(void);
+const tnt_ssh_profile_t *tnt_ssh_profile_at(size_t index);
+
+/* True if the profile's host key algorithms can use a key in `loaded`. */
+bool tnt_ssh_profile_accepts_host_keys(const tnt_ssh_profile_t *profile,
+                                       unsigned int loaded);
+
+#endif /* SSH_PROFILE_H */
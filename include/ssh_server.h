@@ -2,7 +2,12 @@
 #define SSH_SERVER_H
 
 #include "common.h"
+#include "capture.h"
+#include "channel.h"
 #include "chat_room.h"
+#include "input_render.h"
+#include "line_history.h"
+#include "timer_wheel.h"
 #include <arpa/inet.h>
 #include <libssh/libssh.h>
 #include <libssh/server.h>
@@ -20,6 +25,39 @@ typedef struct {
     bool unread;
 } whisper_t;
 
+/* Per-client heap accounting, reported by `stats --memory`.  Each slot is
+ * updated by whoever resizes the buffer and read without locks. */
+typedef enum {
+    CLIENT_MEM_OUTBOX,
+    CLIENT_MEM_RENDER,
+    CLIENT_MEM_HISTORY,
+    CLIENT_MEM_OUTPUT,
+    CLIENT_MEM_WHISPERS,
+    CLIENT_MEM_INPUT,
+    CLIENT_MEM_COUNT
+} client_mem_kind_t;
+
+/* Per-session activity counters, reported by `sessions`.  Updated with
+ * relaxed atomics by the session thread (or the channel write path) and
+ * read without locks. */
+typedef enum {
+    CLIENT_USAGE_CPU_NS,             /* Session thread CPU time, sampled */
+    CLIENT_USAGE_BYTES_RECEIVED,
+    CLIENT_USAGE_BYTES_SENT,
+    CLIENT_USAGE_FRAMES,             /* Full-screen frames rendered */
+    CLIENT_USAGE_COMMANDS,           /* `:` commands run */
+    CLIENT_USAGE_RESIZES,            /* PTY window-change requests */
+    CLIENT_USAGE_COUNT
+} client_usage_kind_t;
+
+/* Deadlines the timer wheel reports to the owning session loop. */
+enum {
+    CLIENT_TIMER_KEEPALIVE = 1u << 0,
+    CLIENT_TIMER_IDLE_TRIM = 1u << 1,
+    CLIENT_TIMER_IDLE_TIMEOUT = 1u << 2,
+    CLIENT_TIMER_REDRAW = 1u << 3
+};
+
 typedef enum {
     TNT_COMMAND_OUTPUT_NONE,
     TNT_COMMAND_OUTPUT_GENERIC,
@@ -30,6 +68,7 @@ typedef enum {
 typedef struct client {
     ssh_session session;             /* SSH session */
     ssh_channel channel;             /* SSH channel */
+    tnt_channel_t io;                /* Session I/O: ssh or in-memory backend */
     char username[MAX_USERNAME_LEN];
     char client_ip[INET6_ADDRSTRLEN];
     _Atomic int width;
@@ -41,23 +80,18 @@ typedef struct client {
     int help_scroll_pos;
     bool show_help;
     char command_input[256];
-    char command_history[16][256];
-    int command_history_count;
-    int command_history_pos;
+    tnt_line_history_t command_history;
     /* INSERT mode chat-message history.  Last 16 messages this client
      * sent, oldest first.  Up/Down in INSERT mode walks through it. */
-    char insert_history[16][MAX_MESSAGE_LEN];
-    int insert_history_count;
-    int insert_history_pos;
-    char command_output[MAX_COMMAND_OUTPUT_LEN];
+    tnt_line_history_t insert_history;
+    char *command_output;            /* Pager text, NULL when none is open */
     int command_output_scroll;
     tnt_command_output_kind_t command_output_kind;
     bool show_motd;                  /* command_output holds MOTD text */
-    char exec_command[MAX_EXEC_COMMAND_LEN];
-    bool exec_command_too_long;
     char ssh_login[MAX_USERNAME_LEN];
+    bool post_throttled;             /* Last Enter hit the posting limit */
     time_t connect_time;
-    time_t last_active;
+    _Atomic uint64_t last_active_ms; /* Timer-wheel clock at last keystroke */
     atomic_bool redraw_pending;
     _Atomic int pending_bells;       /* Bell nudges for this client's loop */
     _Atomic int unread_mentions;     /* @-mentions received since last reset */
@@ -70,10 +104,28 @@ typedef struct client {
     size_t outbox_capacity;
     char *render_buffer;             /* Reused main-screen render buffer */
     size_t render_buffer_capacity;
+    message_t *render_snapshot;      /* Reused copy of the rows on screen */
+    size_t render_snapshot_capacity;
+    tnt_input_render_state_t *input_render; /* Last drawn INSERT input line */
+    bool memory_trimmed;             /* Idle trim ran since last activity */
+    _Atomic unsigned int timer_events; /* CLIENT_TIMER_* bits, set by the wheel */
+    uint64_t last_redraw_ms;
+    tnt_timer_t keepalive_timer;
+    tnt_timer_t idle_timer;
+    tnt_timer_t redraw_timer;
+    /* Session-loop wakeup: readable end in wake_fds[0] (the same fd twice
+     * for an eventfd).  Timers, broadcasts and bells write to it so the
+     * loop can block without a poll timeout. */
+    int wake_fds[2];
+    bool wake_open;
+    atomic_bool wake_signalled;      /* A wakeup is unread; skip the write */
+    ssh_event io_event;              /* Session + wake fd, owned by channel_ssh.c */
     /* Per-client whisper inbox.  Protected separately from SSH channel I/O
-     * so slow writes do not block in-memory private-message delivery. */
-    whisper_t whisper_inbox[WHISPER_INBOX_SIZE];
+     * so slow writes do not block in-memory private-message delivery.
+     * Allocated on the first whisper and grown up to WHISPER_INBOX_SIZE. */
+    whisper_t *whisper_inbox;
     int whisper_inbox_count;
+    int whisper_inbox_capacity;
     bool mute_joins;
     pthread_t thread;
     atomic_bool connected;
@@ -83,6 +135,17 @@ typedef struct client {
     pthread_mutex_t whisper_lock;    /* Serialize whisper inbox access */
     bool channel_callback_ref;       /* client.c owns one ref while callbacks are installed */
     struct ssh_channel_callbacks_struct *channel_cb;
+    _Atomic size_t mem_bytes[CLIENT_MEM_COUNT];
+    /* Delivery latency (stats --latency).  The session thread owns
+     * latency_seen_seq; the frame_* stamps are protected by io_lock. */
+    uint64_t latency_seen_seq;       /* Last room update timed for this client */
+    uint64_t frame_queued_us;        /* Room frame awaiting flush, 0 if none */
+    uint64_t frame_broadcast_us;     /* Oldest broadcast in that frame */
+    _Atomic uint64_t worst_enqueue_us;
+    _Atomic uint64_t worst_flush_us;
+    _Atomic uint64_t worst_delivery_us;
+    _Atomic uint64_t usage[CLIENT_USAGE_COUNT];
+    capture_session_t capture;       /* TNT_CAPTURE state; session thread */
 } client_t;
 
 /* Initialize SSH server */
@@ -94,4 +157,8 @@ int ssh_server_start(int listen_fd);
 /* Read-only accessor for the server start time (used by exec stats). */
 time_t ssh_server_start_time(void);
 
+/* True once ssh_server_init() took the listeners from a running server;
+ * that server has stopped accepting, so this one must not give up. */
+bool ssh_server_took_over(void);
+
 #endif /* SSH_SERVER_H */
@@ -0,0 +1,88 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "common.h"
+
+/* Hierarchical timer wheel.
+ *
+ * Sessions register keepalive, idle and deferred-redraw deadlines here
+ * instead of reading the clock on every loop iteration.  Four levels of 64
+ * slots cover about 9.7 days at the default 50 ms tick; longer delays are
+ * clamped and re-armed by the callback.  tnt_timer_arm() deadlines never
+ * fire early and fire at most one tick late; callback re-arms stay on the
+ * tick grid so periodic timers do not drift.
+ *
+ * Callbacks run on the thread calling tnt_timer_wheel_advance() with the
+ * wheel lock held, so once tnt_timer_cancel() returns the callback is
+ * neither running nor scheduled.  They must be short and must not call
+ * back into the wheel; the return value re-arms the timer instead
+ * (0 = done, otherwise the next delay in milliseconds).
+ *
+ * The service wheel is realtime: its thread sleeps until the next timer is
+ * due, so the wheel may lag the clock, and arming measures from
+ * tnt_monotonic_ms() rather than from the last advance. */
+#define TNT_TIMER_WHEEL_LEVELS 4
+#define TNT_TIMER_WHEEL_SLOT_BITS 6
+#define TNT_TIMER_WHEEL_SLOTS (1 << TNT_TIMER_WHEEL_SLOT_BITS)
+#define TNT_TIMER_DEFAULT_TICK_MS 50
+
+typedef uint64_t (*tnt_timer_fn)(void *arg, uint64_t now_ms);
+
+typedef struct tnt_timer {
+    struct tnt_timer *next;
+    struct tnt_timer *prev;
+    uint64_t expires_tick;
+    tnt_timer_fn fn;
+    void *arg;
+    bool pending;
+} tnt_timer_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t tick_ms;
+    uint64_t base_ms;
+    uint64_t current_tick;           /* Next tick to be processed */
+    _Atomic uint64_t now_ms;         /* Clock as of the last advance */
+    bool realtime;                   /* Arm and read against tnt_monotonic_ms() */
+    size_t pending;
+    unsigned long fired;
+    tnt_timer_t slots[TNT_TIMER_WHEEL_LEVELS][TNT_TIMER_WHEEL_SLOTS];
+} tnt_timer_wheel_t;
+
+/* Monotonic clock in milliseconds. */
+uint64_t tnt_monotonic_ms(void);
+
+int tnt_timer_wheel_init(tnt_timer_wheel_t *wheel, uint64_t tick_ms,
+                         uint64_t now_ms);
+void tnt_timer_wheel_destroy(tnt_timer_wheel_t *wheel);
+
+void tnt_timer_init(tnt_timer_t *timer, tnt_timer_fn fn, void *arg);
+
+/* Arm (or re-arm) `timer` to fire `delay_ms` after the wheel clock. */
+void tnt_timer_arm(tnt_timer_wheel_t *wheel, tnt_timer_t *timer,
+                   uint64_t delay_ms);
+
+/* Returns true if the timer was pending. */
+bool tnt_timer_cancel(tnt_timer_wheel_t *wheel, tnt_timer_t *timer);
+
+/* Run every timer due at `now_ms`.  Returns the number of callbacks run. */
+size_t tnt_timer_wheel_advance(tnt_timer_wheel_t *wheel, uint64_t now_ms);
+
+/* Clock as of the last advance; tnt_monotonic_ms() for realtime wheels. */
+uint64_t tnt_timer_wheel_now_ms(tnt_timer_wheel_t *wheel);
+/* Earliest clock time at which tnt_timer_wheel_advance() has a timer to
+ * fire or to move down a level, or UINT64_MAX when nothing is pending. */
+uint64_t tnt_timer_wheel_next_due_ms(tnt_timer_wheel_t *wheel);
+size_t tnt_timer_wheel_pending(tnt_timer_wheel_t *wheel);
+
+/* Process-wide realtime wheel driven by a background thread that sleeps
+ * until the next timer is due; arming an earlier timer wakes it. */
+int tnt_timer_service_start(void);
+/* The same wheel with no thread: its clock starts at `now_ms` and only
+ * moves when the caller runs tnt_timer_wheel_advance(tnt_timer_service(),
+ * ...).  For simulations on a virtual clock. */
+int tnt_timer_service_start_manual(uint64_t now_ms);
+void tnt_timer_service_stop(void);
+tnt_timer_wheel_t *tnt_timer_service(void);
+
+#endif /* TIMER_WHEEL_H */
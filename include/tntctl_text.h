@@ -19,6 +19,8 @@ typedef enum {
     TNTCTL_TEXT_OUT_OF_MEMORY,
     TNTCTL_TEXT_HOST_KEY_OPTION_TOO_LONG,
     TNTCTL_TEXT_KNOWN_HOSTS_OPTION_TOO_LONG,
+    TNTCTL_TEXT_INVALID_STATE_DIR,
+    TNTCTL_TEXT_CONTROL_UNAVAILABLE_FORMAT,
     TNTCTL_TEXT_COUNT
 } tntctl_text_id_t;
 
@@ -0,0 +1,94 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* On-demand event tracing for latency spikes.
+ *
+ * Each thread appends timestamped events to its own fixed-size ring, so
+ * recording takes no lock and never blocks another thread.  Rings are
+ * handed back to a pool when a thread exits and reused by the next one;
+ * every event carries the id of the thread that wrote it.  While tracing is
+ * off a trace point costs one relaxed load.  `trace start` / `trace stop`
+ * on the local control socket switch it; stop writes the rings to the state
+ * directory as Chrome trace-event JSON. */
+
+typedef enum {
+    TRACE_EV_ACCEPT,               /* Admission of one accepted socket */
+    TRACE_EV_KEX,                  /* Bootstrap key exchange */
+    TRACE_EV_AUTH,                 /* Bootstrap authentication */
+    TRACE_EV_CHANNEL,              /* Bootstrap channel, PTY and shell */
+    TRACE_EV_ROOM_JOIN,
+    TRACE_EV_BROADCAST,
+    TRACE_EV_RENDER,               /* arg: frame bytes */
+    TRACE_EV_FLUSH,                /* arg: bytes written */
+    TRACE_EV_MESSAGE_SAVE,
+    TRACE_EV_MODULE_DELIVER,       /* arg: module event id */
+    TRACE_EV_MODULE_RESPONSE,      /* arg: module event id */
+    TRACE_EV_COUNT
+} trace_event_id_t;
+
+/* Events kept per thread ring; older ones are overwritten. */
+#define TRACE_RING_EVENTS 4096
+/* Rings in the pool.  Threads that find none free are not traced. */
+#define TRACE_MAX_RINGS 128
+
+extern atomic_bool g_trace_enabled;
+
+/* Slow paths behind the inline wrappers. */
+uint64_t trace_now_us(void);
+void trace_record(trace_event_id_t id, uint64_t start_us, uint64_t arg);
+
+/* Start of a span: the current time, or 0 while tracing is off. */
+static inline uint64_t trace_begin(void) {
+    if (atomic_load_explicit(&g_trace_enabled, memory_order_relaxed)) {
+        return trace_now_us();
+    }
+    return 0;
+}
+
+/* Close a span opened with trace_begin(); a 0 start records nothing. */
+static inline void trace_end(trace_event_id_t id, uint64_t start_us,
+                             uint64_t arg) {
+    if (start_us != 0) {
+        trace_record(id, start_us, arg);
+    }
+}
+
+/* A point-in-time event. */
+static inline void trace_instant(trace_event_id_t id, uint64_t arg) {
+    if (atomic_load_explicit(&g_trace_enabled, memory_order_relaxed)) {
+        trace_record(id, 0, arg);
+    }
+}
+
+/* Discard earlier events and start recording.  Returns false if tracing
+ * was already on. */
+bool trace_start(void);
+/* Stop recording.  Returns false if tracing was already off. */
+bool trace_stop(void);
+bool trace_active(void);
+
+typedef struct {
+    bool active;
+    uint64_t events;               /* Events held in the rings */
+    uint64_t overwritten;          /* Events lost to ring wrap-around */
+    unsigned int rings;            /* Rings holding events */
+    uint64_t untraced;             /* Events dropped: no free ring */
+} trace_status_t;
+
+void trace_get_status(trace_status_t *status);
+
+/* Write the events recorded since the last trace_start() as one Chrome
+ * trace-event JSON object.  Returns 0 or -1 on a write error. */
+int trace_write_json(FILE *fp);
+
+/* Write the trace to `trace-<unix time>.json` in the state directory and
+ * store that path in `path`.  Returns 0 or -1. */
+int trace_dump(char *path, size_t path_size);
+
+#endif /* TRACE_H */
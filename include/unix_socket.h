@@ -0,0 +1,38 @@
+#ifndef UNIX_SOCKET_H
+#define UNIX_SOCKET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Most descriptors carried by one tnt_unix_send_fds() message. */
+#define TNT_UNIX_MAX_FDS 64
+
+/* Bind and listen on a UNIX stream socket at `path`, replacing any stale
+ * socket file, and chmod it to `mode`.  Returns the fd or -1 with errno
+ * set (ENAMETOOLONG if `path` does not fit sockaddr_un). */
+int tnt_unix_listen(const char *path, unsigned int mode);
+
+/* Accept one connection on `listen_fd`, retrying interrupted and aborted
+ * accepts.  Running out of descriptors or memory (EMFILE, ENFILE, ENOBUFS,
+ * ENOMEM) is logged with `what`, backed off and retried, so a connection
+ * flood cannot end the accept loop.  Returns the fd, or -1 when the
+ * listener itself failed. */
+int tnt_unix_accept(int listen_fd, const char *what);
+
+/* Connect to the UNIX stream socket at `path`.  Returns the fd or -1. */
+int tnt_unix_connect(const char *path);
+
+/* True when the peer of a connected UNIX socket runs as our effective uid.
+ * Platforms without peer credentials rely on the socket file mode and
+ * always return true. */
+bool tnt_unix_peer_is_self(int fd);
+
+/* Pass up to TNT_UNIX_MAX_FDS descriptors with SCM_RIGHTS.  The message
+ * carries one data byte holding the count.  Returns 0 or -1. */
+int tnt_unix_send_fds(int sock, const int *fds, int count);
+
+/* Receive descriptors sent by tnt_unix_send_fds().  Stores at most `max`
+ * (extras are closed) and returns how many, or -1 on error or EOF. */
+int tnt_unix_recv_fds(int sock, int *fds, int max);
+
+#endif /* UNIX_SOCKET_H */
@@ -1,6 +1,7 @@
 #!/bin/bash
 # TNT Health Check Script
 # Verifies the server is running and accepting connections
+# Set TNT_METRICS_LISTEN to probe the HTTP /health endpoint instead of SSH
 
 PORT="${1:-2222}"
 TIMEOUT="${2:-5}"
@@ -35,18 +36,34 @@ else
     exit 1
 fi
 
-# Try to connect via SSH
-echo -n "Connection test: "
-timeout $TIMEOUT ssh -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o ConnectTimeout=$TIMEOUT -p $PORT test@localhost exit 2>/dev/null &
-CONNECT_PID=$!
-wait $CONNECT_PID
-CONNECT_RESULT=$?
-
-if [ $CONNECT_RESULT -eq 0 ] || [ $CONNECT_RESULT -eq 255 ]; then
-    # Exit code 255 means SSH connection was established but auth failed, which is expected
-    echo -e "${GREEN}✓${NC} SSH connection successful"
+# Prefer the HTTP health endpoint when tnt runs with --metrics-listen
+METRICS_LISTEN="${TNT_METRICS_LISTEN:-}"
+if [ -n "$METRICS_LISTEN" ] && command -v curl > /dev/null 2>&1; then
+    case "$METRICS_LISTEN" in
+        *:*) METRICS_URL="http://$METRICS_LISTEN/health" ;;
+        *) METRICS_URL="http://127.0.0.1:$METRICS_LISTEN/health" ;;
+    esac
+    echo -n "Health endpoint: "
+    if [ "$(curl -fsS --max-time "$TIMEOUT" "$METRICS_URL" 2>/dev/null)" = "ok" ]; then
+        echo -e "${GREEN}✓${NC} $METRICS_URL answered ok"
+    else
+        echo -e "${RED}✗${NC} $METRICS_URL did not answer ok"
+        exit 1
+    fi
 else
-    echo -e "${YELLOW}⚠${NC} SSH connection timeout or failed (but port is listening)"
+    # Try to connect via SSH
+    echo -n "Connection test: "
+    timeout $TIMEOUT ssh -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o ConnectTimeout=$TIMEOUT -p $PORT test@localhost exit 2>/dev/null &
+    CONNECT_PID=$!
+    wait $CONNECT_PID
+    CONNECT_RESULT=$?
+
+    if [ $CONNECT_RESULT -eq 0 ] || [ $CONNECT_RESULT -eq 255 ]; then
+        # Exit code 255 means SSH connection was established but auth failed, which is expected
+        echo -e "${GREEN}✓${NC} SSH connection successful"
+    else
+        echo -e "${YELLOW}⚠${NC} SSH connection timeout or failed (but port is listening)"
+    fi
 fi
 
 # Check log file
@@ -0,0 +1,63 @@
+#include "alloc_count.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(TNT_ALLOC_COUNT) && defined(__GLIBC__)
+
+/* glibc's allocator entry points, which the definitions below forward to.
+ * Defining malloc and friends in the executable takes precedence over
+ * libc's for every caller in the process. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+/* Initial-exec TLS in the executable, so touching it never allocates. */
+static _Thread_local tnt_alloc_counts_t t_counts;
+
+void *malloc(size_t size) {
+    t_counts.allocs++;
+    t_counts.bytes += size;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    t_counts.allocs++;
+    t_counts.bytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    t_counts.allocs++;
+    t_counts.bytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    if (ptr) {
+        t_counts.frees++;
+    }
+    __libc_free(ptr);
+}
+
+bool tnt_alloc_count_enabled(void) {
+    return true;
+}
+
+void tnt_alloc_count_get(tnt_alloc_counts_t *out) {
+    *out = t_counts;
+}
+
+#else
+
+bool tnt_alloc_count_enabled(void) {
+    return false;
+}
+
+void tnt_alloc_count_get(tnt_alloc_counts_t *out) {
+    out->allocs = 0;
+    out->frees = 0;
+    out->bytes = 0;
+}
+
+#endif
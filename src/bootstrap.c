@@ -1,9 +1,14 @@
 #include "bootstrap.h"
 #include "client.h"
 #include "common.h"
+#include "config_defaults.h"
+#include "exec.h"
 #include "input.h"
+#include "object_pool.h"
 #include "ratelimit.h"
 #include "theme.h"
+#include "timer_wheel.h"
+#include "trace.h"
 #include <arpa/inet.h>
 #include <errno.h>
 #include <libssh/callbacks.h>
@@ -19,7 +24,8 @@
 #include <time.h>
 
 /* Per-connection bootstrap state.  Kept private to this translation unit:
- * its lifetime ends inside bootstrap_run() once a client_t takes over. */
+ * its lifetime ends inside bootstrap_run() once a client_t takes over, or
+ * when an exec request finishes. */
 typedef struct {
     char client_ip[INET6_ADDRSTRLEN];
     char requested_user[MAX_USERNAME_LEN];
@@ -32,11 +38,33 @@ typedef struct {
     bool channel_ready;  /* Set when shell/exec request received */
     ssh_channel channel;  /* Channel created in callback */
     struct ssh_channel_callbacks_struct *channel_cb;  /* Channel callbacks */
+    int fd;                       /* Socket, shut down on deadline */
+    bootstrap_phase_t phase;
+    uint64_t phase_deadline_ms;
+    atomic_bool deadline_expired; /* Set by the timer wheel */
+    tnt_timer_t deadline_timer;
+    uint64_t phase_trace_us;      /* trace_begin() of the current phase */
 } session_context_t;
 
+static tnt_pool_t g_accepted_session_pool =
+    TNT_POOL_INITIALIZER("accepted_session", accepted_session_t,
+                         TNT_POOL_DEFAULT_MAX_FREE);
+static tnt_pool_t g_session_context_pool =
+    TNT_POOL_INITIALIZER("session_context", session_context_t,
+                         TNT_POOL_DEFAULT_MAX_FREE);
+
 /* Configured access token; empty string means "no auth required". */
 static char g_access_token[256] = "";
 
+static int g_phase_timeout_s[BOOTSTRAP_PHASE_COUNT] = {
+    TNT_DEFAULT_KEX_TIMEOUT,
+    TNT_DEFAULT_AUTH_TIMEOUT,
+    TNT_DEFAULT_CHANNEL_TIMEOUT,
+};
+static _Atomic unsigned long g_phase_timeouts[BOOTSTRAP_PHASE_COUNT];
+static int g_max_pending_handshakes = TNT_DEFAULT_MAX_PENDING_HANDSHAKES;
+static atomic_int g_pending_handshakes = 0;
+
 void bootstrap_init(void) {
     const char *token_env = getenv("TNT_ACCESS_TOKEN");
     if (token_env != NULL) {
@@ -45,6 +73,135 @@ void bootstrap_init(void) {
     } else {
         g_access_token[0] = '\0';
     }
+
+    g_phase_timeout_s[BOOTSTRAP_PHASE_KEX] =
+        tnt_config_env_int(&TNT_CONFIG_KEX_TIMEOUT);
+    g_phase_timeout_s[BOOTSTRAP_PHASE_AUTH] =
+        tnt_config_env_int(&TNT_CONFIG_AUTH_TIMEOUT);
+    g_phase_timeout_s[BOOTSTRAP_PHASE_CHANNEL] =
+        tnt_config_env_int(&TNT_CONFIG_CHANNEL_TIMEOUT);
+    g_max_pending_handshakes =
+        tnt_config_env_int(&TNT_CONFIG_MAX_PENDING_HANDSHAKES);
+}
+
+const char *bootstrap_phase_name(bootstrap_phase_t phase) {
+    static const char *const names[BOOTSTRAP_PHASE_COUNT] = {
+        "kex", "auth", "channel"
+    };
+
+    return (unsigned int)phase < BOOTSTRAP_PHASE_COUNT ? names[phase]
+                                                       : "unknown";
+}
+
+unsigned long bootstrap_phase_timeouts(bootstrap_phase_t phase) {
+    if ((unsigned int)phase >= BOOTSTRAP_PHASE_COUNT) {
+        return 0;
+    }
+    return atomic_load(&g_phase_timeouts[phase]);
+}
+
+bool bootstrap_handshake_reserve(void) {
+    int pending = atomic_load(&g_pending_handshakes);
+
+    do {
+        if (pending >= g_max_pending_handshakes) {
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak(&g_pending_handshakes, &pending,
+                                           pending + 1));
+    return true;
+}
+
+void bootstrap_handshake_release(void) {
+    atomic_fetch_sub(&g_pending_handshakes, 1);
+}
+
+int bootstrap_pending_handshakes(void) {
+    return atomic_load(&g_pending_handshakes);
+}
+
+/* Timer-wheel callback: runs on the timer thread when a phase overruns.
+ * Shutting the socket down makes any libssh call blocked on it return. */
+static uint64_t handshake_deadline_fire(void *arg, uint64_t now_ms) {
+    session_context_t *ctx = arg;
+
+    (void)now_ms;
+    atomic_store(&ctx->deadline_expired, true);
+    if (ctx->fd >= 0) {
+        shutdown(ctx->fd, SHUT_RDWR);
+    }
+    return 0;
+}
+
+static const trace_event_id_t g_phase_trace[BOOTSTRAP_PHASE_COUNT] = {
+    TRACE_EV_KEX, TRACE_EV_AUTH, TRACE_EV_CHANNEL
+};
+
+static void handshake_phase_trace_end(session_context_t *ctx) {
+    trace_end(g_phase_trace[ctx->phase], ctx->phase_trace_us, 0);
+    ctx->phase_trace_us = 0;
+}
+
+static void handshake_phase_begin(session_context_t *ctx,
+                                  bootstrap_phase_t phase) {
+    uint64_t timeout_ms = (uint64_t)g_phase_timeout_s[phase] * 1000u;
+    tnt_timer_wheel_t *wheel = tnt_timer_service();
+
+    handshake_phase_trace_end(ctx);
+    ctx->phase = phase;
+    ctx->phase_trace_us = trace_begin();
+    ctx->phase_deadline_ms = tnt_monotonic_ms() + timeout_ms;
+    atomic_store(&ctx->deadline_expired, false);
+    if (wheel) {
+        tnt_timer_arm(wheel, &ctx->deadline_timer, timeout_ms);
+    }
+}
+
+static void handshake_phase_end(session_context_t *ctx) {
+    tnt_timer_wheel_t *wheel = tnt_timer_service();
+
+    handshake_phase_trace_end(ctx);
+    if (wheel) {
+        tnt_timer_cancel(wheel, &ctx->deadline_timer);
+    }
+}
+
+/* Milliseconds left in the current phase, 0 once it has expired. */
+static int handshake_phase_remaining_ms(session_context_t *ctx) {
+    uint64_t now = tnt_monotonic_ms();
+
+    if (atomic_load(&ctx->deadline_expired) || now >= ctx->phase_deadline_ms) {
+        return 0;
+    }
+    return (int)(ctx->phase_deadline_ms - now);
+}
+
+static void handshake_phase_timed_out(session_context_t *ctx) {
+    atomic_fetch_add(&g_phase_timeouts[ctx->phase], 1);
+    fprintf(stderr, "Handshake %s phase timed out for %s\n",
+            bootstrap_phase_name(ctx->phase), ctx->client_ip);
+}
+
+accepted_session_t *bootstrap_accepted_session_new(void) {
+    return tnt_pool_alloc(&g_accepted_session_pool);
+}
+
+void bootstrap_accepted_session_free(accepted_session_t *accepted) {
+    tnt_pool_free(&g_accepted_session_pool, accepted);
+}
+
+void bootstrap_format_ip(const struct sockaddr_storage *addr, char *ip_buf,
+                         size_t buf_size) {
+    if (addr->ss_family == AF_INET) {
+        const struct sockaddr_in *s = (const struct sockaddr_in *)addr;
+        inet_ntop(AF_INET, &s->sin_addr, ip_buf, buf_size);
+    } else if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *s = (const struct sockaddr_in6 *)addr;
+        inet_ntop(AF_INET6, &s->sin6_addr, ip_buf, buf_size);
+    } else {
+        strncpy(ip_buf, "unknown", buf_size - 1);
+    }
+    ip_buf[buf_size - 1] = '\0';
 }
 
 void bootstrap_peer_ip(ssh_session session, char *ip_buf, size_t buf_size) {
@@ -53,19 +210,11 @@ void bootstrap_peer_ip(ssh_session session, char *ip_buf, size_t buf_size) {
     socklen_t addr_len = sizeof(addr);
 
     if (getpeername(fd, (struct sockaddr *)&addr, &addr_len) == 0) {
-        if (addr.ss_family == AF_INET) {
-            struct sockaddr_in *s = (struct sockaddr_in *)&addr;
-            inet_ntop(AF_INET, &s->sin_addr, ip_buf, buf_size);
-        } else if (addr.ss_family == AF_INET6) {
-            struct sockaddr_in6 *s = (struct sockaddr_in6 *)&addr;
-            inet_ntop(AF_INET6, &s->sin6_addr, ip_buf, buf_size);
-        } else {
-            strncpy(ip_buf, "unknown", buf_size - 1);
-        }
+        bootstrap_format_ip(&addr, ip_buf, buf_size);
     } else {
         strncpy(ip_buf, "unknown", buf_size - 1);
+        ip_buf[buf_size - 1] = '\0';
     }
-    ip_buf[buf_size - 1] = '\0';
 }
 
 /* Constant-time string comparison to prevent timing side-channel attacks.
@@ -181,14 +330,18 @@ static void destroy_session_context(session_context_t *ctx) {
         return;
     }
 
-    if (ctx->channel_cb) {
-        free(ctx->channel_cb);
-    }
-
-    free(ctx);
+    client_channel_callbacks_free(ctx->channel_cb);
+    tnt_pool_free(&g_session_context_pool, ctx);
 }
 
 static void cleanup_failed_session(ssh_session session, session_context_t *ctx) {
+    /* Disarm the deadline before libssh closes the fd it would shut down */
+    if (ctx) {
+        handshake_phase_end(ctx);
+        ctx->fd = -1;
+    }
+    bootstrap_handshake_release();
+
     if (ctx && ctx->channel) {
         if (ctx->channel_cb) {
             ssh_remove_channel_callbacks(ctx->channel, ctx->channel_cb);
@@ -315,7 +468,7 @@ static int channel_exec_request(ssh_session session, ssh_channel channel,
 static void setup_session_channel_callbacks(ssh_channel channel,
                                             session_context_t *ctx) {
     /* Allocate channel callbacks on heap to persist */
-    ctx->channel_cb = calloc(1, sizeof(struct ssh_channel_callbacks_struct));
+    ctx->channel_cb = client_channel_callbacks_new();
     if (!ctx->channel_cb) {
         return;
     }
@@ -331,6 +484,28 @@ static void setup_session_channel_callbacks(ssh_channel channel,
     ssh_set_channel_callbacks(channel, ctx->channel_cb);
 }
 
+/* Exec requests never join the room, so they skip client_t and the
+ * interactive session loop; the context only lives until the command ends. */
+static void run_exec_session(ssh_session session, ssh_channel channel,
+                             session_context_t *ctx) {
+    if (ctx->channel_cb) {
+        ssh_remove_channel_callbacks(channel, ctx->channel_cb);
+    }
+    ctx->fd = -1;
+    ctx->channel = NULL;
+    bootstrap_handshake_release();
+
+    exec_session_run(session, channel, ctx->requested_user, ctx->client_ip,
+                     ctx->exec_command_too_long ? NULL : ctx->exec_command);
+
+    ssh_channel_free(channel);
+    ssh_disconnect(session);
+    ssh_free(session);
+    ratelimit_release_ip(ctx->client_ip);
+    destroy_session_context(ctx);
+    ratelimit_decrement_total();
+}
+
 void *bootstrap_run(void *arg) {
     accepted_session_t *accepted = (accepted_session_t *)arg;
     ssh_session session;
@@ -340,7 +515,7 @@ void *bootstrap_run(void *arg) {
     ssh_channel channel;
     client_t *client = NULL;
     bool timed_out = false;
-    time_t start_time;
+    long kex_timeout;
     char accepted_ip[INET6_ADDRSTRLEN] = "";
 
     if (!accepted) {
@@ -351,10 +526,11 @@ void *bootstrap_run(void *arg) {
     if (accepted->client_ip[0] != '\0') {
         snprintf(accepted_ip, sizeof(accepted_ip), "%s", accepted->client_ip);
     }
-    free(accepted);
+    bootstrap_accepted_session_free(accepted);
 
-    ctx = calloc(1, sizeof(session_context_t));
+    ctx = tnt_pool_alloc(&g_session_context_pool);
     if (!ctx) {
+        bootstrap_handshake_release();
         ratelimit_release_ip(accepted_ip);
         ssh_disconnect(session);
         ssh_free(session);
@@ -377,6 +553,10 @@ void *bootstrap_run(void *arg) {
     ctx->channel_ready = false;
     ctx->channel = NULL;
     ctx->channel_cb = NULL;
+    ctx->fd = ssh_get_fd(session);
+    ctx->phase = BOOTSTRAP_PHASE_KEX;
+    atomic_store(&ctx->deadline_expired, false);
+    tnt_timer_init(&ctx->deadline_timer, handshake_deadline_fire, ctx);
 
     memset(&server_cb, 0, sizeof(server_cb));
     ssh_callbacks_init(&server_cb);
@@ -387,12 +567,24 @@ void *bootstrap_run(void *arg) {
     server_cb.channel_open_request_session_function = channel_open_request_session;
     ssh_set_server_callbacks(session, &server_cb);
 
+    /* libssh's own blocking timeout bounds the exchange as well; it is
+     * reset afterwards so established sessions keep blocking writes. */
+    kex_timeout = g_phase_timeout_s[BOOTSTRAP_PHASE_KEX];
+    ssh_options_set(session, SSH_OPTIONS_TIMEOUT, &kex_timeout);
+    handshake_phase_begin(ctx, BOOTSTRAP_PHASE_KEX);
     if (ssh_handle_key_exchange(session) != SSH_OK) {
-        fprintf(stderr, "Key exchange failed from %s: %s\n",
-                ctx->client_ip, ssh_get_error(session));
+        if (handshake_phase_remaining_ms(ctx) == 0) {
+            handshake_phase_timed_out(ctx);
+        } else {
+            fprintf(stderr, "Key exchange failed from %s: %s\n",
+                    ctx->client_ip, ssh_get_error(session));
+        }
         cleanup_failed_session(session, ctx);
         return NULL;
     }
+    handshake_phase_end(ctx);
+    kex_timeout = 0;
+    ssh_options_set(session, SSH_OPTIONS_TIMEOUT, &kex_timeout);
 
     event = ssh_event_new();
     if (!event) {
@@ -409,25 +601,43 @@ void *bootstrap_run(void *arg) {
         return NULL;
     }
 
-    start_time = time(NULL);
-    while ((!ctx->auth_success || ctx->channel == NULL || !ctx->channel_ready) &&
-           !timed_out) {
-        int rc = ssh_event_dopoll(event, 1000);
+    handshake_phase_begin(ctx, BOOTSTRAP_PHASE_AUTH);
+    while (!ctx->auth_success || ctx->channel == NULL || !ctx->channel_ready) {
+        int remaining;
+        int rc;
+
+        if (ctx->auth_success && ctx->phase == BOOTSTRAP_PHASE_AUTH) {
+            handshake_phase_begin(ctx, BOOTSTRAP_PHASE_CHANNEL);
+        }
 
+        remaining = handshake_phase_remaining_ms(ctx);
+        if (remaining == 0) {
+            timed_out = true;
+            break;
+        }
+
+        rc = ssh_event_dopoll(event, remaining < 1000 ? remaining : 1000);
         if (rc == SSH_ERROR) {
+            if (handshake_phase_remaining_ms(ctx) == 0) {
+                timed_out = true;
+                break;
+            }
             fprintf(stderr, "Event poll error from %s: %s\n",
                     ctx->client_ip, ssh_get_error(session));
             break;
         }
-
-        if (time(NULL) - start_time > 10) {
-            timed_out = true;
-        }
     }
+    handshake_phase_end(ctx);
 
     ssh_event_free(event);
     event = NULL;
 
+    if (timed_out) {
+        handshake_phase_timed_out(ctx);
+        cleanup_failed_session(session, ctx);
+        return NULL;
+    }
+
     if (!ctx->auth_success) {
         fprintf(stderr, "Authentication failed or timed out from %s\n",
                 ctx->client_ip);
@@ -436,14 +646,19 @@ void *bootstrap_run(void *arg) {
     }
 
     channel = ctx->channel;
-    if (!channel || !ctx->channel_ready || timed_out) {
+    if (!channel || !ctx->channel_ready) {
         fprintf(stderr, "Failed to open/setup channel from %s\n",
                 ctx->client_ip);
         cleanup_failed_session(session, ctx);
         return NULL;
     }
 
-    client = calloc(1, sizeof(client_t));
+    if (ctx->exec_command[0] != '\0' || ctx->exec_command_too_long) {
+        run_exec_session(session, channel, ctx);
+        return NULL;
+    }
+
+    client = client_new();
     if (!client) {
         cleanup_failed_session(session, ctx);
         return NULL;
@@ -471,13 +686,6 @@ void *bootstrap_run(void *arg) {
         snprintf(client->client_ip, sizeof(client->client_ip), "%s",
                  ctx->client_ip);
     }
-    if (ctx->exec_command[0] != '\0') {
-        strncpy(client->exec_command, ctx->exec_command,
-                sizeof(client->exec_command) - 1);
-        client->exec_command[sizeof(client->exec_command) - 1] = '\0';
-    }
-    client->exec_command_too_long = ctx->exec_command_too_long;
-
     if (client_install_channel_callbacks(client) < 0) {
         /* Nullify session/channel ownership so client_release won't
          * double-free what cleanup_failed_session is about to free. */
@@ -487,13 +695,15 @@ void *bootstrap_run(void *arg) {
         cleanup_failed_session(session, ctx);
         return NULL;
     }
+    tnt_channel_use_ssh(&client->io, client);
 
     if (ctx->channel_cb) {
         ssh_remove_channel_callbacks(channel, ctx->channel_cb);
-        free(ctx->channel_cb);
+        client_channel_callbacks_free(ctx->channel_cb);
         ctx->channel_cb = NULL;
     }
     destroy_session_context(ctx);
+    bootstrap_handshake_release();
 
     input_run_session(client);
     return NULL;
@@ -0,0 +1,440 @@
+#include "capture.h"
+#include "config_defaults.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+    CAPTURE_ESC_NONE,
+    CAPTURE_ESC_START,               /* After ESC */
+    CAPTURE_ESC_CSI,                 /* ESC [ ... until a final byte */
+    CAPTURE_ESC_SS3                  /* ESC O and one more byte */
+};
+
+/* Largest encoded record: type, four varints and a full batch. */
+#define CAPTURE_RECORD_MAX (1 + 4 * 10 + CAPTURE_INPUT_BATCH)
+
+static pthread_mutex_t g_capture_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *g_capture_fp;
+static atomic_bool g_capture_on = false;
+static uint64_t g_capture_start_ms;
+static uint64_t g_capture_bytes;
+static uint64_t g_capture_limit;
+static uint32_t g_capture_next_id;
+static uint64_t g_capture_key;
+
+/* UTF-8 characters that stand in for anonymised ones, by byte length. */
+static const unsigned char g_utf8_fill[5][4] = {
+    {0},
+    {0},
+    {0xC3, 0xA9},                    /* é */
+    {0xE4, 0xB8, 0xAD},              /* 中 */
+    {0xF0, 0x9F, 0x98, 0x80}         /* 😀 */
+};
+
+static uint64_t capture_now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Per-run secret, so the same text anonymises differently each run. */
+static uint64_t capture_random_key(void) {
+    uint64_t key = 0;
+    int fd = open("/dev/urandom", O_RDONLY);
+
+    if (fd >= 0) {
+        if (read(fd, &key, sizeof(key)) != (ssize_t)sizeof(key)) {
+            key = 0;
+        }
+        close(fd);
+    }
+    if (key == 0) {
+        key = (uint64_t)time(NULL) * 0x9e3779b97f4a7c15ULL ^
+              (uint64_t)getpid() ^ capture_now_ms();
+    }
+    return key;
+}
+
+static size_t put_varint(unsigned char *out, uint64_t value) {
+    size_t n = 0;
+
+    do {
+        unsigned char byte = (unsigned char)(value & 0x7f);
+
+        value >>= 7;
+        out[n++] = value ? (unsigned char)(byte | 0x80) : byte;
+    } while (value);
+    return n;
+}
+
+/* Append one encoded record.  Stops the capture at the size limit. */
+static void capture_write(const unsigned char *rec, size_t len) {
+    pthread_mutex_lock(&g_capture_lock);
+    if (g_capture_fp) {
+        if (g_capture_bytes + len > g_capture_limit) {
+            fclose(g_capture_fp);
+            g_capture_fp = NULL;
+            atomic_store(&g_capture_on, false);
+            fprintf(stderr, "Capture stopped: TNT_CAPTURE_MAX_MB reached\n");
+        } else if (fwrite(rec, 1, len, g_capture_fp) != len) {
+            fclose(g_capture_fp);
+            g_capture_fp = NULL;
+            atomic_store(&g_capture_on, false);
+            fprintf(stderr, "Capture stopped: write failed\n");
+        } else {
+            g_capture_bytes += len;
+        }
+    }
+    pthread_mutex_unlock(&g_capture_lock);
+}
+
+static size_t capture_record_head(unsigned char *rec,
+                                  capture_record_type_t type,
+                                  capture_session_t *session,
+                                  uint64_t at_ms) {
+    size_t n = 0;
+    uint64_t since = session->last_ms;
+
+    rec[n++] = (unsigned char)type;
+    n += put_varint(rec + n, session->id);
+    n += put_varint(rec + n, at_ms > since ? at_ms - since : 0);
+    session->last_ms = at_ms > since ? at_ms : since;
+    return n;
+}
+
+static void capture_flush_batch(capture_session_t *session) {
+    unsigned char rec[CAPTURE_RECORD_MAX];
+    size_t n;
+
+    if (session->batch_len == 0) {
+        return;
+    }
+    n = capture_record_head(rec, CAPTURE_REC_INPUT, session,
+                            session->batch_ms);
+    n += put_varint(rec + n, session->batch_len);
+    memcpy(rec + n, session->batch, session->batch_len);
+    n += session->batch_len;
+    session->batch_len = 0;
+    capture_write(rec, n);
+}
+
+static void capture_size_record(capture_session_t *session,
+                                capture_record_type_t type, int width,
+                                int height) {
+    unsigned char rec[CAPTURE_RECORD_MAX];
+    size_t n = capture_record_head(rec, type, session, capture_now_ms());
+
+    n += put_varint(rec + n, width > 0 ? (uint64_t)width : 0);
+    n += put_varint(rec + n, height > 0 ? (uint64_t)height : 0);
+    capture_write(rec, n);
+}
+
+int capture_init(void) {
+    char filename[64];
+    char path[PATH_MAX];
+    int fd;
+
+    if (!tnt_config_env_int(&TNT_CONFIG_CAPTURE)) {
+        return 0;
+    }
+
+    snprintf(filename, sizeof(filename), "capture-%lld-%ld.tntcap",
+             (long long)time(NULL), (long)getpid());
+    if (tnt_state_path(path, sizeof(path), filename) < 0) {
+        return -1;
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create capture file %s\n", path);
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_capture_lock);
+    g_capture_fp = fdopen(fd, "wb");
+    if (!g_capture_fp) {
+        pthread_mutex_unlock(&g_capture_lock);
+        close(fd);
+        return -1;
+    }
+    g_capture_limit =
+        (uint64_t)tnt_config_env_int(&TNT_CONFIG_CAPTURE_MAX_MB) << 20;
+    g_capture_bytes = 0;
+    g_capture_start_ms = capture_now_ms();
+    g_capture_key = capture_random_key();
+    pthread_mutex_unlock(&g_capture_lock);
+
+    capture_write((const unsigned char *)CAPTURE_MAGIC, CAPTURE_MAGIC_LEN);
+    atomic_store(&g_capture_on, true);
+    fprintf(stderr, "Capturing session input to %s\n", path);
+    return 0;
+}
+
+void capture_shutdown(void) {
+    pthread_mutex_lock(&g_capture_lock);
+    atomic_store(&g_capture_on, false);
+    if (g_capture_fp) {
+        fclose(g_capture_fp);
+        g_capture_fp = NULL;
+    }
+    pthread_mutex_unlock(&g_capture_lock);
+}
+
+bool capture_active(void) {
+    return atomic_load(&g_capture_on);
+}
+
+void capture_session_open(capture_session_t *session, int width,
+                          int height) {
+    memset(session, 0, sizeof(*session));
+    if (!atomic_load(&g_capture_on)) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_capture_lock);
+    session->id = ++g_capture_next_id;
+    session->last_ms = g_capture_start_ms;
+    session->rng = g_capture_key ^ ((uint64_t)session->id << 32);
+    pthread_mutex_unlock(&g_capture_lock);
+
+    capture_size_record(session, CAPTURE_REC_OPEN, width, height);
+}
+
+void capture_session_input(capture_session_t *session, client_mode_t mode,
+                           const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    uint64_t now;
+
+    if (session->id == 0 || len == 0) {
+        return;
+    }
+
+    now = capture_now_ms();
+    if (session->batch_len > 0 && session->batch_ms != now) {
+        capture_flush_batch(session);
+    }
+    while (len > 0) {
+        size_t n = CAPTURE_INPUT_BATCH - session->batch_len;
+
+        if (n > len) {
+            n = len;
+        }
+        if (session->batch_len == 0) {
+            session->batch_ms = now;
+        }
+        memcpy(session->batch + session->batch_len, bytes, n);
+        capture_anonymize(session, mode, session->batch + session->batch_len,
+                          n);
+        session->batch_len += n;
+        bytes += n;
+        len -= n;
+        if (session->batch_len == CAPTURE_INPUT_BATCH) {
+            capture_flush_batch(session);
+        }
+    }
+}
+
+void capture_session_resize(capture_session_t *session, int width,
+                            int height) {
+    if (session->id == 0) {
+        return;
+    }
+    capture_flush_batch(session);
+    capture_size_record(session, CAPTURE_REC_RESIZE, width, height);
+}
+
+void capture_session_close(capture_session_t *session) {
+    unsigned char rec[CAPTURE_RECORD_MAX];
+    size_t n;
+
+    if (session->id == 0) {
+        return;
+    }
+    capture_flush_batch(session);
+    n = capture_record_head(rec, CAPTURE_REC_CLOSE, session,
+                            capture_now_ms());
+    capture_write(rec, n);
+
+    pthread_mutex_lock(&g_capture_lock);
+    if (g_capture_fp) {
+        fflush(g_capture_fp);
+    }
+    pthread_mutex_unlock(&g_capture_lock);
+    session->id = 0;
+}
+
+void capture_anonymize(capture_session_t *session, client_mode_t mode,
+                       unsigned char *data, size_t len) {
+    if (mode != MODE_COMMAND) {
+        session->command_args = false;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char b = data[i];
+        bool hide;
+
+        switch (session->esc_state) {
+            case CAPTURE_ESC_START:
+                session->esc_state = b == '[' ? CAPTURE_ESC_CSI
+                                     : b == 'O' ? CAPTURE_ESC_SS3
+                                                : CAPTURE_ESC_NONE;
+                continue;
+            case CAPTURE_ESC_CSI:
+                if (b >= 0x40 && b <= 0x7e) {
+                    session->esc_state = CAPTURE_ESC_NONE;
+                }
+                continue;
+            case CAPTURE_ESC_SS3:
+                session->esc_state = CAPTURE_ESC_NONE;
+                continue;
+            default:
+                break;
+        }
+        if (b == 0x1b) {
+            session->esc_state = CAPTURE_ESC_START;
+            session->utf8_left = 0;
+            continue;
+        }
+        if (session->utf8_left > 0) {
+            if ((b & 0xC0) == 0x80) {
+                data[i] = g_utf8_fill[session->utf8_len]
+                                     [session->utf8_len - session->utf8_left];
+                session->utf8_left--;
+                continue;
+            }
+            session->utf8_left = 0;
+        }
+
+        hide = mode == MODE_INSERT ||
+               (mode == MODE_COMMAND && session->command_args);
+        /* Follow the mode switches input.c makes, so a command typed
+         * within one read is still hidden after its name. */
+        if (mode == MODE_NORMAL && (b == ':' || b == '/')) {
+            mode = MODE_COMMAND;
+            session->command_args = b == '/';    /* Opens as "search " */
+        } else if (mode == MODE_NORMAL &&
+                   (b == 'i' || b == 'a' || b == 'A' || b == 'o' ||
+                    b == 'O')) {
+            mode = MODE_INSERT;
+        } else if (mode == MODE_COMMAND && (b == '\r' || b == '\n')) {
+            mode = MODE_NORMAL;
+            session->command_args = false;
+        } else if (mode == MODE_COMMAND && b == ' ') {
+            session->command_args = true;
+        }
+        if (!hide) {
+            continue;
+        }
+
+        if (b >= 'a' && b <= 'z') {
+            data[i] = (unsigned char)('a' + splitmix64(&session->rng) % 26);
+        } else if (b >= 'A' && b <= 'Z') {
+            data[i] = (unsigned char)('A' + splitmix64(&session->rng) % 26);
+        } else if (b >= '0' && b <= '9') {
+            data[i] = (unsigned char)('0' + splitmix64(&session->rng) % 10);
+        } else if (b >= 0xC2 && b <= 0xF4) {
+            unsigned char n = b <= 0xDF ? 2 : b <= 0xEF ? 3 : 4;
+
+            data[i] = g_utf8_fill[n][0];
+            session->utf8_len = n;
+            session->utf8_left = (unsigned char)(n - 1);
+        }
+    }
+}
+
+/* Returns 1 with a value, 0 at end of file before any byte, -1 if the
+ * value is cut short or too long. */
+static int read_varint(FILE *fp, uint64_t *out) {
+    uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(fp);
+
+        if (c == EOF) {
+            return shift == 0 ? 0 : -1;
+        }
+        value |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *out = value;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+static int read_field(FILE *fp, uint64_t *out, uint64_t max) {
+    return read_varint(fp, out) == 1 && *out <= max ? 0 : -1;
+}
+
+int capture_reader_open(capture_reader_t *reader, FILE *fp) {
+    char magic[CAPTURE_MAGIC_LEN];
+
+    reader->fp = fp;
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+        memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int capture_reader_next(capture_reader_t *reader, capture_record_t *record) {
+    uint64_t session;
+    uint64_t width;
+    uint64_t height;
+    uint64_t len;
+    int type = fgetc(reader->fp);
+
+    if (type == EOF) {
+        return 0;
+    }
+    if (type < CAPTURE_REC_OPEN || type > CAPTURE_REC_CLOSE ||
+        read_field(reader->fp, &session, UINT32_MAX) < 0 ||
+        read_field(reader->fp, &record->delta_ms, UINT64_MAX) < 0) {
+        return -1;
+    }
+
+    record->type = (capture_record_type_t)type;
+    record->session = (uint32_t)session;
+    record->width = 0;
+    record->height = 0;
+    record->data = NULL;
+    record->len = 0;
+
+    switch (record->type) {
+        case CAPTURE_REC_OPEN:
+        case CAPTURE_REC_RESIZE:
+            if (read_field(reader->fp, &width, 65535) < 0 ||
+                read_field(reader->fp, &height, 65535) < 0) {
+                return -1;
+            }
+            record->width = (int)width;
+            record->height = (int)height;
+            break;
+        case CAPTURE_REC_INPUT:
+            if (read_field(reader->fp, &len, sizeof(reader->data)) < 0 ||
+                fread(reader->data, 1, (size_t)len, reader->fp) != len) {
+                return -1;
+            }
+            record->data = reader->data;
+            record->len = (size_t)len;
+            break;
+        case CAPTURE_REC_CLOSE:
+            break;
+    }
+    return 1;
+}
@@ -0,0 +1,296 @@
+#include "channel_fake.h"
+#include "timer_wheel.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Virtual when a simulation drives the timer service by hand. */
+static uint64_t fake_now_ms(void) {
+    tnt_timer_wheel_t *wheel = tnt_timer_service();
+
+    return wheel ? tnt_timer_wheel_now_ms(wheel) : tnt_monotonic_ms();
+}
+
+/* Drops fake->lock around the callback.  Returns false if there is none. */
+static bool fake_yield_locked(tnt_fake_channel_t *fake) {
+    tnt_fake_yield_fn yield = fake->yield;
+    void *arg = fake->yield_arg;
+
+    if (!yield) {
+        return false;
+    }
+    pthread_mutex_unlock(&fake->lock);
+    yield(fake, arg);
+    pthread_mutex_lock(&fake->lock);
+    fake->idle_returned = false;
+    return true;
+}
+
+static int fake_read_timeout(void *ctx, void *buf, uint32_t len,
+                             int timeout_ms) {
+    tnt_fake_channel_t *fake = ctx;
+    uint64_t deadline = timeout_ms >= 0 ? fake_now_ms() + (uint64_t)timeout_ms
+                                        : UINT64_MAX;
+    int rc;
+
+    pthread_mutex_lock(&fake->lock);
+    for (;;) {
+        size_t avail = fake->input_len - fake->input_pos;
+
+        if (avail > 0) {
+            size_t n = avail < len ? avail : len;
+
+            if (n > INT_MAX) {
+                n = INT_MAX;
+            }
+            memcpy(buf, fake->input + fake->input_pos, n);
+            fake->input_pos += n;
+            if (fake->input_pos == fake->input_len) {
+                fake->input_pos = 0;
+                fake->input_len = 0;
+            }
+            rc = (int)n;
+            break;
+        }
+        if (!fake->open) {
+            rc = 0;
+            break;
+        }
+        if ((timeout_ms >= 0 && fake_now_ms() >= deadline) ||
+            !fake_yield_locked(fake)) {
+            rc = TNT_CHANNEL_AGAIN;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fake->lock);
+    return rc;
+}
+
+static int fake_poll_timeout(void *ctx, int timeout_ms) {
+    tnt_fake_channel_t *fake = ctx;
+    int rc;
+
+    (void)timeout_ms;
+    pthread_mutex_lock(&fake->lock);
+    for (;;) {
+        size_t avail = fake->input_len - fake->input_pos;
+
+        if (!fake->open) {
+            rc = TNT_CHANNEL_ERROR;
+            break;
+        }
+        if (avail > 0) {
+            rc = avail > INT_MAX ? INT_MAX : (int)avail;
+            break;
+        }
+        if (!fake->idle_returned || !fake->yield) {
+            fake->idle_returned = true;
+            rc = 0;
+            break;
+        }
+        fake_yield_locked(fake);
+    }
+    pthread_mutex_unlock(&fake->lock);
+    return rc;
+}
+
+static int fake_write(void *ctx, const void *data, uint32_t len) {
+    tnt_fake_channel_t *fake = ctx;
+    const char *bytes = data;
+    uint32_t n;
+
+    pthread_mutex_lock(&fake->lock);
+    if (!fake->open) {
+        pthread_mutex_unlock(&fake->lock);
+        return TNT_CHANNEL_ERROR;
+    }
+
+    n = len < fake->window ? len : fake->window;
+    if (n > INT_MAX) {
+        n = INT_MAX;
+    }
+    fake->window -= n;
+    fake->bytes_written += n;
+    fake->writes++;
+
+    if (fake->capture_size > 0) {
+        size_t skip = n > fake->capture_size ? n - fake->capture_size : 0;
+
+        fake->capture_total += skip;
+        for (size_t i = skip; i < n; i++) {
+            fake->capture[fake->capture_total % fake->capture_size] = bytes[i];
+            fake->capture_total++;
+        }
+    }
+    pthread_mutex_unlock(&fake->lock);
+    return (int)n;
+}
+
+static uint32_t fake_window_size(void *ctx) {
+    tnt_fake_channel_t *fake = ctx;
+    uint32_t window;
+
+    pthread_mutex_lock(&fake->lock);
+    window = fake->open ? fake->window : 0;
+    pthread_mutex_unlock(&fake->lock);
+    return window;
+}
+
+static bool fake_is_open(void *ctx) {
+    return tnt_fake_channel_is_open(ctx);
+}
+
+static int fake_keepalive(void *ctx) {
+    tnt_fake_channel_t *fake = ctx;
+    int rc;
+
+    pthread_mutex_lock(&fake->lock);
+    fake->keepalives++;
+    rc = fake->open ? 0 : -1;
+    pthread_mutex_unlock(&fake->lock);
+    return rc;
+}
+
+static void fake_close(void *ctx) {
+    tnt_fake_channel_hangup(ctx);
+}
+
+static const tnt_channel_ops_t g_fake_channel_ops = {
+    .read_timeout = fake_read_timeout,
+    .poll_timeout = fake_poll_timeout,
+    .write = fake_write,
+    .window_size = fake_window_size,
+    .is_open = fake_is_open,
+    .keepalive = fake_keepalive,
+    .close = fake_close,
+};
+
+int tnt_fake_channel_init(tnt_fake_channel_t *fake, uint32_t window_max,
+                          size_t capture_size) {
+    memset(fake, 0, sizeof(*fake));
+    if (capture_size > 0) {
+        fake->capture = malloc(capture_size);
+        if (!fake->capture) {
+            return -1;
+        }
+        fake->capture_size = capture_size;
+    }
+    pthread_mutex_init(&fake->lock, NULL);
+    fake->open = true;
+    fake->window = window_max;
+    fake->window_max = window_max;
+    return 0;
+}
+
+void tnt_fake_channel_destroy(tnt_fake_channel_t *fake) {
+    if (!fake) return;
+
+    pthread_mutex_destroy(&fake->lock);
+    free(fake->input);
+    free(fake->capture);
+    memset(fake, 0, sizeof(*fake));
+}
+
+void tnt_channel_use_fake(tnt_channel_t *channel, tnt_fake_channel_t *fake) {
+    channel->ops = &g_fake_channel_ops;
+    channel->ctx = fake;
+}
+
+void tnt_fake_channel_set_yield(tnt_fake_channel_t *fake,
+                                tnt_fake_yield_fn yield, void *arg) {
+    pthread_mutex_lock(&fake->lock);
+    fake->yield = yield;
+    fake->yield_arg = arg;
+    pthread_mutex_unlock(&fake->lock);
+}
+
+int tnt_fake_channel_feed(tnt_fake_channel_t *fake, const void *data,
+                          size_t len) {
+    int rc = 0;
+
+    pthread_mutex_lock(&fake->lock);
+    if (fake->input_pos > 0) {
+        memmove(fake->input, fake->input + fake->input_pos,
+                fake->input_len - fake->input_pos);
+        fake->input_len -= fake->input_pos;
+        fake->input_pos = 0;
+    }
+    if (fake->input_len + len > fake->input_capacity) {
+        size_t capacity = fake->input_capacity ? fake->input_capacity : 64;
+        unsigned char *grown;
+
+        while (capacity < fake->input_len + len) {
+            capacity *= 2;
+        }
+        grown = realloc(fake->input, capacity);
+        if (!grown) {
+            rc = -1;
+            goto out;
+        }
+        fake->input = grown;
+        fake->input_capacity = capacity;
+    }
+    memcpy(fake->input + fake->input_len, data, len);
+    fake->input_len += len;
+
+out:
+    pthread_mutex_unlock(&fake->lock);
+    return rc;
+}
+
+void tnt_fake_channel_ack(tnt_fake_channel_t *fake, uint32_t bytes) {
+    pthread_mutex_lock(&fake->lock);
+    if (bytes > fake->window_max - fake->window) {
+        fake->window = fake->window_max;
+    } else {
+        fake->window += bytes;
+    }
+    pthread_mutex_unlock(&fake->lock);
+}
+
+void tnt_fake_channel_hangup(tnt_fake_channel_t *fake) {
+    pthread_mutex_lock(&fake->lock);
+    fake->open = false;
+    pthread_mutex_unlock(&fake->lock);
+}
+
+bool tnt_fake_channel_is_open(tnt_fake_channel_t *fake) {
+    bool open;
+
+    pthread_mutex_lock(&fake->lock);
+    open = fake->open;
+    pthread_mutex_unlock(&fake->lock);
+    return open;
+}
+
+size_t tnt_fake_channel_pending(tnt_fake_channel_t *fake) {
+    size_t pending;
+
+    pthread_mutex_lock(&fake->lock);
+    pending = fake->input_len - fake->input_pos;
+    pthread_mutex_unlock(&fake->lock);
+    return pending;
+}
+
+size_t tnt_fake_channel_captured(tnt_fake_channel_t *fake, char *buf,
+                                 size_t buf_size) {
+    size_t kept;
+    size_t start;
+
+    if (!buf || buf_size == 0) return 0;
+
+    pthread_mutex_lock(&fake->lock);
+    kept = fake->capture_total < fake->capture_size
+               ? (size_t)fake->capture_total
+               : fake->capture_size;
+    if (kept > buf_size - 1) {
+        kept = buf_size - 1;
+    }
+    start = (size_t)(fake->capture_total - kept);
+    for (size_t i = 0; i < kept; i++) {
+        buf[i] = fake->capture[(start + i) % fake->capture_size];
+    }
+    buf[kept] = '\0';
+    pthread_mutex_unlock(&fake->lock);
+    return kept;
+}
@@ -0,0 +1,141 @@
+#include "channel.h"
+#include "client.h"
+#include "ssh_server.h"
+#include <libssh/libssh.h>
+#include <poll.h>
+#include <stdio.h>
+
+/* libssh backend: ctx is the client, which keeps owning the raw session and
+ * channel so the libssh callbacks in client.c can still reach them. */
+
+static int ssh_io_read_timeout(void *ctx, void *buf, uint32_t len,
+                               int timeout_ms) {
+    client_t *client = ctx;
+
+    if (timeout_ms < 0) {
+        return ssh_channel_read(client->channel, buf, len, 0);
+    }
+    return ssh_channel_read_timeout(client->channel, buf, len, 0, timeout_ms);
+}
+
+/* Drain inside the callback: ssh_event_dopoll() only returns after a
+ * handler ran, and a still-readable fd would make the next poll spin. */
+static int ssh_io_wake_ready(socket_t fd, int revents, void *userdata) {
+    (void)fd;
+    (void)revents;
+    client_wake_clear(userdata);
+    return 0;
+}
+
+/* One ssh_event per session watches both the socket and the wake fd, so a
+ * blocking poll ends on input, a timer, a broadcast or a bell. */
+static ssh_event ssh_io_event(client_t *client) {
+    ssh_event event;
+
+    if (client->io_event) {
+        return client->io_event;
+    }
+    event = ssh_event_new();
+    if (!event) {
+        return NULL;
+    }
+    if (ssh_event_add_session(event, client->session) != SSH_OK) {
+        ssh_event_free(event);
+        return NULL;
+    }
+    if (ssh_event_add_fd(event, client->wake_fds[0], POLLIN,
+                         ssh_io_wake_ready, client) != SSH_OK) {
+        ssh_event_remove_session(event, client->session);
+        ssh_event_free(event);
+        return NULL;
+    }
+    client->io_event = event;
+    return event;
+}
+
+static int ssh_io_poll_timeout(void *ctx, int timeout_ms) {
+    client_t *client = ctx;
+    ssh_event event;
+    int rc;
+
+    if (!client->wake_open) {
+        return ssh_channel_poll_timeout(client->channel, timeout_ms, 0);
+    }
+    rc = ssh_channel_poll(client->channel, 0);
+    if (rc != 0 || timeout_ms == 0) {
+        return rc;
+    }
+    event = ssh_io_event(client);
+    if (!event) {
+        fprintf(stderr, "Failed to create session event for %s\n",
+                client->client_ip);
+        return TNT_CHANNEL_ERROR;
+    }
+    if (ssh_event_dopoll(event, timeout_ms) == SSH_ERROR) {
+        return TNT_CHANNEL_ERROR;
+    }
+    return ssh_channel_poll(client->channel, 0);
+}
+
+static int ssh_io_write(void *ctx, const void *data, uint32_t len) {
+    client_t *client = ctx;
+
+    return ssh_channel_write(client->channel, data, len);
+}
+
+static uint32_t ssh_io_window_size(void *ctx) {
+    client_t *client = ctx;
+
+    return ssh_channel_window_size(client->channel);
+}
+
+static bool ssh_io_is_open(void *ctx) {
+    client_t *client = ctx;
+
+    return client->channel && ssh_channel_is_open(client->channel);
+}
+
+static int ssh_io_keepalive(void *ctx) {
+    client_t *client = ctx;
+
+    return ssh_send_keepalive(client->session) == SSH_OK ? 0 : -1;
+}
+
+static void ssh_io_close(void *ctx) {
+    client_t *client = ctx;
+
+    if (client->io_event) {
+        ssh_event_remove_fd(client->io_event, client->wake_fds[0]);
+        ssh_event_remove_session(client->io_event, client->session);
+        ssh_event_free(client->io_event);
+        client->io_event = NULL;
+    }
+    if (client->channel) {
+        if (ssh_channel_is_open(client->channel)) {
+            ssh_channel_close(client->channel);
+        }
+        ssh_channel_free(client->channel);
+        client->channel = NULL;
+    }
+    if (client->session) {
+        ssh_disconnect(client->session);
+        ssh_free(client->session);
+        client->session = NULL;
+    }
+}
+
+static const tnt_channel_ops_t g_ssh_channel_ops = {
+    .read_timeout = ssh_io_read_timeout,
+    .poll_timeout = ssh_io_poll_timeout,
+    .write = ssh_io_write,
+    .window_size = ssh_io_window_size,
+    .is_open = ssh_io_is_open,
+    .keepalive = ssh_io_keepalive,
+    .close = ssh_io_close,
+    .wakeable = true,
+};
+
+void tnt_channel_use_ssh(tnt_channel_t *channel, struct client *client) {
+    channel->ops = &g_ssh_channel_ops;
+    channel->ctx = client;
+}
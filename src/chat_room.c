@@ -1,5 +1,8 @@
 #include "chat_room.h"
 #include "config_defaults.h"
+#include "lock_profile.h"
+#include "metrics.h"
+#include "trace.h"
 
 /* Global chat room instance */
 chat_room_t *g_room = NULL;
@@ -32,12 +35,12 @@ chat_room_t* room_create(void) {
 void room_destroy(chat_room_t *room) {
     if (!room) return;
 
-    pthread_rwlock_wrlock(&room->lock);
+    LOCK_PROFILE_WRLOCK(&room->lock, LOCK_ID_ROOM);
 
     free(room->clients);
     free(room->messages);
 
-    pthread_rwlock_unlock(&room->lock);
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
     pthread_rwlock_destroy(&room->lock);
 
     free(room);
@@ -45,22 +48,22 @@ void room_destroy(chat_room_t *room) {
 
 /* Add client to room */
 int room_add_client(chat_room_t *room, struct client *client) {
-    pthread_rwlock_wrlock(&room->lock);
+    LOCK_PROFILE_WRLOCK(&room->lock, LOCK_ID_ROOM);
 
     if (room->client_count >= room->client_capacity) {
-        pthread_rwlock_unlock(&room->lock);
+        LOCK_PROFILE_RWUNLOCK(&room->lock);
         return -1;
     }
 
     room->clients[room->client_count++] = client;
 
-    pthread_rwlock_unlock(&room->lock);
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
     return 0;
 }
 
 /* Remove client from room */
 void room_remove_client(chat_room_t *room, struct client *client) {
-    pthread_rwlock_wrlock(&room->lock);
+    LOCK_PROFILE_WRLOCK(&room->lock, LOCK_ID_ROOM);
 
     for (int i = 0; i < room->client_count; i++) {
         if (room->clients[i] == client) {
@@ -73,7 +76,7 @@ void room_remove_client(chat_room_t *room, struct client *client) {
         }
     }
 
-    pthread_rwlock_unlock(&room->lock);
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
 }
 
 /* Add message to room history (caller must hold write lock) */
@@ -89,19 +92,33 @@ static void room_add_message(chat_room_t *room, const message_t *msg) {
 
 /* Broadcast message to all clients */
 void room_broadcast(chat_room_t *room, const message_t *msg) {
-    pthread_rwlock_wrlock(&room->lock);
+    uint64_t trace_us = trace_begin();
+
+    LOCK_PROFILE_WRLOCK(&room->lock, LOCK_ID_ROOM);
 
     room_add_message(room, msg);
     room->update_seq++;
+    room->broadcast_us[room->update_seq % ROOM_BROADCAST_STAMPS] =
+        metrics_now_us();
+
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
 
-    pthread_rwlock_unlock(&room->lock);
+    if (room->wake_client) {
+        LOCK_PROFILE_RDLOCK(&room->lock, LOCK_ID_ROOM);
+        for (int i = 0; i < room->client_count; i++) {
+            room->wake_client(room->clients[i]);
+        }
+        LOCK_PROFILE_RWUNLOCK(&room->lock);
+    }
+    metrics_inc(METRIC_MESSAGES_BROADCAST);
+    trace_end(TRACE_EV_BROADCAST, trace_us, 0);
 }
 
 /* Get message by index (thread-safe value copy) */
 bool room_get_message(chat_room_t *room, int index, message_t *out) {
     if (!room || !out) return false;
 
-    pthread_rwlock_rdlock(&room->lock);
+    LOCK_PROFILE_RDLOCK(&room->lock, LOCK_ID_ROOM);
 
     bool found = false;
     if (index >= 0 && index < room->message_count) {
@@ -109,32 +126,57 @@ bool room_get_message(chat_room_t *room, int index, message_t *out) {
         found = true;
     }
 
-    pthread_rwlock_unlock(&room->lock);
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
     return found;
 }
 
 /* Get total message count */
 int room_get_message_count(chat_room_t *room) {
-    pthread_rwlock_rdlock(&room->lock);
+    LOCK_PROFILE_RDLOCK(&room->lock, LOCK_ID_ROOM);
     int count = room->message_count;
-    pthread_rwlock_unlock(&room->lock);
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
     return count;
 }
 
 /* Get online client count */
 int room_get_client_count(chat_room_t *room) {
-    pthread_rwlock_rdlock(&room->lock);
+    LOCK_PROFILE_RDLOCK(&room->lock, LOCK_ID_ROOM);
     int count = room->client_count;
-    pthread_rwlock_unlock(&room->lock);
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
     return count;
 }
 
 uint64_t room_get_update_seq(chat_room_t *room) {
     uint64_t seq;
 
-    pthread_rwlock_rdlock(&room->lock);
+    LOCK_PROFILE_RDLOCK(&room->lock, LOCK_ID_ROOM);
     seq = room->update_seq;
-    pthread_rwlock_unlock(&room->lock);
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
 
     return seq;
 }
+
+int room_broadcast_stamps(chat_room_t *room, uint64_t after_seq,
+                          uint64_t upto_seq, uint64_t *stamps, int max) {
+    uint64_t first;
+    int count = 0;
+
+    if (!room || !stamps || max <= 0) return 0;
+
+    LOCK_PROFILE_RDLOCK(&room->lock, LOCK_ID_ROOM);
+    if (upto_seq > room->update_seq) {
+        upto_seq = room->update_seq;
+    }
+    first = after_seq + 1;
+    /* The ring only holds the newest ROOM_BROADCAST_STAMPS updates. */
+    if (room->update_seq >= ROOM_BROADCAST_STAMPS &&
+        first <= room->update_seq - ROOM_BROADCAST_STAMPS) {
+        first = room->update_seq - ROOM_BROADCAST_STAMPS + 1;
+    }
+    for (uint64_t seq = first; seq <= upto_seq && count < max; seq++) {
+        stamps[count++] = room->broadcast_us[seq % ROOM_BROADCAST_STAMPS];
+    }
+    LOCK_PROFILE_RWUNLOCK(&room->lock);
+
+    return count;
+}
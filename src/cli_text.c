@@ -18,7 +18,14 @@ void cli_text_append_help(char *buffer, size_t buf_size, size_t *pos,
         "      --max-conn-rate-per-ip N Per-IP connection-rate limit\n"
         "      --rate-limit 0|1         Disable/enable rate-based blocking\n"
         "      --idle-timeout SECONDS   Idle disconnect timeout\n"
+        "      --session-stack-kb KB    Session thread stack size (default: %d)\n"
+        "      --acceptors N            Accept threads, 0 = one per CPU\n"
+        "      --takeover               Take listeners over from a running tnt\n"
+        "      --control-socket         Serve exec commands on control.sock\n"
+        "      --metrics-listen ADDR    HTTP /health and /metrics on ADDR:PORT\n"
         "      --ssh-log-level LEVEL    libssh log level 0..4\n"
+        "      --host-keys LIST         Host key types: auto or ed25519,ecdsa,rsa\n"
+        "      --ssh-profile NAME       Algorithm profile: default, fast, modern\n"
         "      --log-check FILE         Check messages.log v1 records\n"
         "      --log-recover FILE       Write valid records to stdout\n"
         "  -V, --version                Show version\n"
@@ -44,7 +51,14 @@ void cli_text_append_help(char *buffer, size_t buf_size, size_t *pos,
         "      --max-conn-rate-per-ip N 单 IP 连接速率限制\n"
         "      --rate-limit 0|1         禁用/启用速率封禁\n"
         "      --idle-timeout SECONDS   空闲断开时间\n"
+        "      --session-stack-kb KB    会话线程栈大小 (默认: %d)\n"
+        "      --acceptors N            接受连接的线程数, 0 = 每个 CPU 一个\n"
+        "      --takeover               从运行中的 tnt 接管监听套接字\n"
+        "      --control-socket         在 control.sock 上提供 exec 命令\n"
+        "      --metrics-listen ADDR    在 ADDR:PORT 提供 HTTP /health 和 /metrics\n"
         "      --ssh-log-level LEVEL    libssh 日志级别 0..4\n"
+        "      --host-keys LIST         主机密钥类型: auto 或 ed25519,ecdsa,rsa\n"
+        "      --ssh-profile NAME       算法配置: default, fast, modern\n"
         "      --log-check FILE         检查 messages.log v1 记录\n"
         "      --log-recover FILE       将有效记录写入 stdout\n"
         "  -V, --version                显示版本\n"
@@ -66,6 +80,7 @@ void cli_text_append_help(char *buffer, size_t buf_size, size_t *pos,
     buffer_appendf(buffer, buf_size, pos, i18n_string(help_format, lang),
                    TNT_VERSION, program, TNT_DEFAULT_PORT,
                    TNT_DEFAULT_MAX_CONNECTIONS,
+                   TNT_DEFAULT_SESSION_STACK_KB,
                    TNT_DEFAULT_MAX_CONNECTIONS,
                    TNT_DEFAULT_IDLE_TIMEOUT);
 }
@@ -1,40 +1,81 @@
 #include "client.h"
 #include "common.h"
+#include "metrics.h"
+#include "object_pool.h"
+#include "scratch.h"
+#include "trace.h"
 #include <libssh/callbacks.h>
 #include <libssh/libssh.h>
 #include <libssh/server.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+static tnt_pool_t g_client_pool =
+    TNT_POOL_INITIALIZER("client", client_t, TNT_POOL_DEFAULT_MAX_FREE);
+static tnt_pool_t g_channel_cb_pool =
+    TNT_POOL_INITIALIZER("channel_callbacks",
+                         struct ssh_channel_callbacks_struct,
+                         TNT_POOL_DEFAULT_MAX_FREE);
+
+client_t *client_new(void) {
+    return tnt_pool_alloc(&g_client_pool);
+}
+
+struct ssh_channel_callbacks_struct *client_channel_callbacks_new(void) {
+    return tnt_pool_alloc(&g_channel_cb_pool);
+}
+
+void client_channel_callbacks_free(struct ssh_channel_callbacks_struct *cb) {
+    tnt_pool_free(&g_channel_cb_pool, cb);
+}
 
 static int client_send_fail(client_t *client) {
+    metrics_inc(METRIC_CLIENT_SEND_FAILURES);
     if (client) {
         client->connected = false;
     }
     return -1;
 }
 
-static bool client_is_exec(const client_t *client) {
-    return client && (client->exec_command[0] != '\0' ||
-                      client->exec_command_too_long);
+void client_mem_set(client_t *client, client_mem_kind_t kind, size_t bytes) {
+    if (!client || kind < 0 || kind >= CLIENT_MEM_COUNT) return;
+    atomic_store_explicit(&client->mem_bytes[kind], bytes,
+                          memory_order_relaxed);
+}
+
+size_t client_memory_usage(client_t *client, size_t bytes[CLIENT_MEM_COUNT]) {
+    size_t total = sizeof(client_t);
+
+    if (!client) return 0;
+    for (int i = 0; i < CLIENT_MEM_COUNT; i++) {
+        size_t value = atomic_load_explicit(&client->mem_bytes[i],
+                                            memory_order_relaxed);
+        if (bytes) bytes[i] = value;
+        total += value;
+    }
+    return total;
 }
 
 static int client_write_direct_locked(client_t *client, const char *data,
-                                      size_t len, size_t budget,
-                                      bool fail_on_closed_window) {
+                                      size_t len, size_t budget) {
     size_t total = 0;
 
     while (total < len) {
         size_t remaining = len - total;
-        uint32_t window = ssh_channel_window_size(client->channel);
+        uint32_t window = tnt_channel_window_size(&client->io);
 
         if (window == 0) {
-            if (!fail_on_closed_window) {
-                break;
-            }
-            return client_send_fail(client);
+            break;
         }
 
         uint32_t chunk = (remaining > 32768) ? 32768 : (uint32_t)remaining;
@@ -45,11 +86,13 @@ static int client_write_direct_locked(client_t *client, const char *data,
             chunk = (uint32_t)budget;
         }
 
-        int sent = ssh_channel_write(client->channel, data + total, chunk);
+        int sent = tnt_channel_write(&client->io, data + total, chunk);
         if (sent <= 0) {
             return client_send_fail(client);
         }
         total += (size_t)sent;
+        metrics_add(METRIC_CLIENT_BYTES_FLUSHED, (uint64_t)sent);
+        client_usage_add(client, CLIENT_USAGE_BYTES_SENT, (uint64_t)sent);
 
         if (budget > 0) {
             budget -= (size_t)sent;
@@ -62,8 +105,40 @@ static int client_write_direct_locked(client_t *client, const char *data,
     return (int)total;
 }
 
+static void latency_raise(_Atomic uint64_t *worst, uint64_t value) {
+    uint64_t seen = atomic_load_explicit(worst, memory_order_relaxed);
+
+    while (value > seen &&
+           !atomic_compare_exchange_weak_explicit(worst, &seen, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+/* The outbox just drained: close out the pending room frame, if any. */
+static void client_frame_flushed_locked(client_t *client) {
+    uint64_t now;
+    uint64_t flush_us;
+
+    if (client->frame_queued_us == 0) {
+        return;
+    }
+    now = metrics_now_us();
+    flush_us = now > client->frame_queued_us ?
+               now - client->frame_queued_us : 0;
+    metrics_observe(METRIC_HIST_DELIVERY_FLUSH_US, flush_us);
+    latency_raise(&client->worst_flush_us, flush_us);
+    if (now > client->frame_broadcast_us) {
+        latency_raise(&client->worst_delivery_us,
+                      now - client->frame_broadcast_us);
+    }
+    client->frame_queued_us = 0;
+    client->frame_broadcast_us = 0;
+}
+
 static int client_flush_output_locked(client_t *client, size_t budget) {
     size_t pending;
+    uint64_t trace_us;
     int sent;
 
     if (!client->outbox || client->outbox_pos >= client->outbox_len) {
@@ -75,16 +150,21 @@ static int client_flush_output_locked(client_t *client, size_t budget) {
     }
 
     pending = client->outbox_len - client->outbox_pos;
+    trace_us = trace_begin();
     sent = client_write_direct_locked(client, client->outbox + client->outbox_pos,
-                                      pending, budget, false);
+                                      pending, budget);
     if (sent < 0) {
         return -1;
     }
+    if (sent > 0) {
+        trace_end(TRACE_EV_FLUSH, trace_us, (uint64_t)sent);
+    }
 
     client->outbox_pos += (size_t)sent;
     if (client->outbox_pos >= client->outbox_len) {
         client->outbox_pos = 0;
         client->outbox_len = 0;
+        client_frame_flushed_locked(client);
     }
 
     return 0;
@@ -106,6 +186,35 @@ static int client_compact_outbox(client_t *client) {
     return 0;
 }
 
+/* Grow the outbox by doubling from CLIENT_OUTBOX_INITIAL_CAPACITY, never
+ * past CLIENT_OUTBOX_CAPACITY.  Caller has compacted, so outbox_pos is 0. */
+static int client_reserve_outbox_locked(client_t *client, size_t needed) {
+    size_t capacity = 0;
+
+    if (needed <= client->outbox_capacity) {
+        return 0;
+    }
+    if (needed > CLIENT_OUTBOX_CAPACITY) {
+        return -1;
+    }
+    if (needed < CLIENT_OUTBOX_INITIAL_CAPACITY) {
+        needed = CLIENT_OUTBOX_INITIAL_CAPACITY;
+    }
+
+    /* Buffer-pool size classes double, matching the growth policy. */
+    char *grown = tnt_buffer_pool_resize(client->outbox,
+                                         client->outbox_capacity,
+                                         client->outbox_len, needed,
+                                         &capacity);
+    if (!grown) {
+        return -1;
+    }
+    client->outbox = grown;
+    client->outbox_capacity = capacity;
+    client_mem_set(client, CLIENT_MEM_OUTBOX, capacity);
+    return 0;
+}
+
 static int client_enqueue_output_locked(client_t *client, const char *data,
                                         size_t len) {
     if (len == 0) {
@@ -116,23 +225,15 @@ static int client_enqueue_output_locked(client_t *client, const char *data,
         return client_send_fail(client);
     }
 
-    if (!client->outbox) {
-        client->outbox = malloc(CLIENT_OUTBOX_CAPACITY);
-        if (!client->outbox) {
-            return client_send_fail(client);
-        }
-        client->outbox_capacity = CLIENT_OUTBOX_CAPACITY;
-        client->outbox_len = 0;
-        client->outbox_pos = 0;
-    }
-
     client_compact_outbox(client);
-    if (client->outbox_len + len > client->outbox_capacity) {
+    if (client_reserve_outbox_locked(client, client->outbox_len + len) != 0) {
         return client_send_fail(client);
     }
 
     memcpy(client->outbox + client->outbox_len, data, len);
     client->outbox_len += len;
+    metrics_add(METRIC_CLIENT_BYTES_QUEUED, len);
+    metrics_gauge_max(METRIC_GAUGE_OUTBOX_HIGH_WATER, client->outbox_len);
     return 0;
 }
 
@@ -145,30 +246,92 @@ int client_send(client_t *client, const char *data, size_t len) {
 
     pthread_mutex_lock(&client->io_lock);
 
-    if (!client->connected || !client->channel) {
+    if (!client->connected || !client->io.ops) {
         pthread_mutex_unlock(&client->io_lock);
         return -1;
     }
 
-    if (client_is_exec(client)) {
-        rc = client_write_direct_locked(client, data, len, 0, true);
-        if (rc >= 0 && (size_t)rc == len) {
-            rc = 0;
-        } else if (rc >= 0) {
-            rc = client_send_fail(client);
-        }
-        ssh_blocking_flush(client->session, 1000);
-    } else {
-        rc = client_enqueue_output_locked(client, data, len);
-        if (rc == 0) {
-            rc = client_flush_output_locked(client, CLIENT_OUTBOX_FLUSH_BUDGET);
-        }
+    rc = client_enqueue_output_locked(client, data, len);
+    if (rc == 0) {
+        rc = client_flush_output_locked(client, CLIENT_OUTBOX_FLUSH_BUDGET);
     }
 
     pthread_mutex_unlock(&client->io_lock);
     return rc;
 }
 
+void client_note_history(client_t *client) {
+    if (!client) return;
+    client_mem_set(client, CLIENT_MEM_HISTORY,
+                   tnt_line_history_bytes(&client->command_history) +
+                   tnt_line_history_bytes(&client->insert_history));
+}
+
+int client_set_command_output(client_t *client, const char *text) {
+    if (!client) return -1;
+
+    free(client->command_output);
+    client->command_output = NULL;
+    client_mem_set(client, CLIENT_MEM_OUTPUT, 0);
+    if (!text) {
+        return 0;
+    }
+
+    size_t len = strnlen(text, MAX_COMMAND_OUTPUT_LEN - 1);
+    client->command_output = malloc(len + 1);
+    if (!client->command_output) {
+        return -1;
+    }
+    memcpy(client->command_output, text, len);
+    client->command_output[len] = '\0';
+    client_mem_set(client, CLIENT_MEM_OUTPUT, len + 1);
+    return 0;
+}
+
+bool client_has_command_output(const client_t *client) {
+    return client && client->command_output &&
+           client->command_output[0] != '\0';
+}
+
+const char *client_command_output(const client_t *client) {
+    return client && client->command_output ? client->command_output : "";
+}
+
+void client_trim_idle_memory(client_t *client) {
+    if (!client) return;
+
+    pthread_mutex_lock(&client->io_lock);
+    if (client->outbox && client->outbox_pos >= client->outbox_len) {
+        tnt_buffer_pool_free(client->outbox, client->outbox_capacity);
+        client->outbox = NULL;
+        client->outbox_capacity = 0;
+        client->outbox_len = 0;
+        client->outbox_pos = 0;
+        client_mem_set(client, CLIENT_MEM_OUTBOX, 0);
+    }
+    pthread_mutex_unlock(&client->io_lock);
+
+    /* The render buffer and input-line state belong to the session thread,
+     * which is the only caller.  Both are rebuilt on the next repaint. */
+    tnt_buffer_pool_free(client->render_buffer,
+                         client->render_buffer_capacity);
+    client->render_buffer = NULL;
+    client->render_buffer_capacity = 0;
+    tnt_buffer_pool_free(client->render_snapshot,
+                         client->render_snapshot_capacity);
+    client->render_snapshot = NULL;
+    client->render_snapshot_capacity = 0;
+    client_mem_set(client, CLIENT_MEM_RENDER, 0);
+
+    free(client->input_render);
+    client->input_render = NULL;
+    client_mem_set(client, CLIENT_MEM_INPUT, 0);
+
+    tnt_scratch_trim();
+
+    client->memory_trimmed = true;
+}
+
 int client_flush_output(client_t *client) {
     int rc;
 
@@ -176,7 +339,7 @@ int client_flush_output(client_t *client) {
 
     pthread_mutex_lock(&client->io_lock);
 
-    if (!client->connected || !client->channel) {
+    if (!client->connected || !client->io.ops) {
         pthread_mutex_unlock(&client->io_lock);
         return -1;
     }
@@ -186,11 +349,116 @@ int client_flush_output(client_t *client) {
     return rc;
 }
 
+void client_note_room_frame(client_t *client, uint64_t queued_us,
+                            uint64_t oldest_broadcast_us) {
+    if (!client || queued_us == 0) return;
+
+    if (queued_us > oldest_broadcast_us) {
+        latency_raise(&client->worst_enqueue_us,
+                      queued_us - oldest_broadcast_us);
+    }
+
+    pthread_mutex_lock(&client->io_lock);
+    /* An earlier frame still draining keeps its older stamps; the flush
+     * that empties the outbox delivers both. */
+    if (client->frame_queued_us == 0) {
+        client->frame_queued_us = queued_us;
+        client->frame_broadcast_us = oldest_broadcast_us;
+    }
+    if (!client->outbox || client->outbox_pos >= client->outbox_len) {
+        client_frame_flushed_locked(client);
+    }
+    pthread_mutex_unlock(&client->io_lock);
+}
+
+void client_latency_worst(client_t *client, client_latency_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!client) return;
+    out->enqueue_us = atomic_load_explicit(&client->worst_enqueue_us,
+                                           memory_order_relaxed);
+    out->flush_us = atomic_load_explicit(&client->worst_flush_us,
+                                         memory_order_relaxed);
+    out->delivery_us = atomic_load_explicit(&client->worst_delivery_us,
+                                            memory_order_relaxed);
+}
+
+void client_sample_cpu(client_t *client) {
+    struct timespec ts;
+
+    if (!client || clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return;
+    atomic_store_explicit(&client->usage[CLIENT_USAGE_CPU_NS],
+                          (uint64_t)ts.tv_sec * 1000000000u +
+                          (uint64_t)ts.tv_nsec,
+                          memory_order_relaxed);
+}
+
+void client_usage(client_t *client, uint64_t usage[CLIENT_USAGE_COUNT]) {
+    for (int i = 0; i < CLIENT_USAGE_COUNT; i++) {
+        usage[i] = client ? atomic_load_explicit(&client->usage[i],
+                                                 memory_order_relaxed) : 0;
+    }
+}
+
 void client_queue_bell(client_t *client) {
     if (!client) return;
 
     atomic_store(&client->pending_bells, 1);
     client->redraw_pending = true;
+    client_wake(client);
+}
+
+int client_wake_open(client_t *client) {
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (fd < 0) {
+        return -1;
+    }
+    client->wake_fds[0] = fd;
+    client->wake_fds[1] = fd;
+#else
+    if (pipe(client->wake_fds) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(client->wake_fds[i], F_SETFL,
+              fcntl(client->wake_fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(client->wake_fds[i], F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    atomic_store(&client->wake_signalled, false);
+    client->wake_open = true;
+    return 0;
+}
+
+void client_wake(client_t *client) {
+    uint64_t one = 1;
+    ssize_t n;
+
+    if (!client || !client->wake_open ||
+        atomic_exchange(&client->wake_signalled, true)) {
+        return;
+    }
+    /* eventfd wants 8 bytes; a pipe takes them just as well.  A full pipe
+     * already holds a wakeup, so EAGAIN is fine. */
+    do {
+        n = write(client->wake_fds[1], &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+}
+
+void client_wake_clear(client_t *client) {
+    uint64_t buf[8];
+    ssize_t n;
+
+    if (!client->wake_open) {
+        return;
+    }
+    /* Clear the flag first so a wake that races the drain still writes. */
+    atomic_store(&client->wake_signalled, false);
+    do {
+        n = read(client->wake_fds[0], buf, sizeof(buf));
+    } while (n > 0 || (n < 0 && errno == EINTR));
 }
 
 int client_flush_pending_bells(client_t *client) {
@@ -223,25 +491,28 @@ void client_release(client_t *client) {
         if (client->channel && client->channel_cb) {
             ssh_remove_channel_callbacks(client->channel, client->channel_cb);
         }
-        if (client->channel) {
-            if (ssh_channel_is_open(client->channel)) {
-                ssh_channel_close(client->channel);
+        tnt_channel_close(&client->io);
+        if (client->wake_open) {
+            close(client->wake_fds[0]);
+            if (client->wake_fds[1] != client->wake_fds[0]) {
+                close(client->wake_fds[1]);
             }
-            ssh_channel_free(client->channel);
-        }
-        if (client->session) {
-            ssh_disconnect(client->session);
-            ssh_free(client->session);
         }
-        if (client->channel_cb) {
-            free(client->channel_cb);
-        }
-        free(client->outbox);
-        free(client->render_buffer);
+        client_channel_callbacks_free(client->channel_cb);
+        tnt_buffer_pool_free(client->outbox, client->outbox_capacity);
+        tnt_buffer_pool_free(client->render_buffer,
+                             client->render_buffer_capacity);
+        tnt_buffer_pool_free(client->render_snapshot,
+                             client->render_snapshot_capacity);
+        free(client->input_render);
+        free(client->command_output);
+        free(client->whisper_inbox);
+        tnt_line_history_clear(&client->command_history);
+        tnt_line_history_clear(&client->insert_history);
         pthread_mutex_destroy(&client->io_lock);
         pthread_mutex_destroy(&client->whisper_lock);
         pthread_mutex_destroy(&client->ref_lock);
-        free(client);
+        tnt_pool_free(&g_client_pool, client);
     }
 }
 
@@ -252,7 +523,7 @@ void client_release_session(client_t *client) {
         ssh_remove_channel_callbacks(client->channel, client->channel_cb);
     }
     if (client->channel_cb) {
-        free(client->channel_cb);
+        client_channel_callbacks_free(client->channel_cb);
         client->channel_cb = NULL;
     }
 
@@ -300,6 +571,8 @@ static int client_channel_window_change(ssh_session session, ssh_channel channel
     client->width = w;
     client->height = h;
     client->redraw_pending = true;
+    client_usage_add(client, CLIENT_USAGE_RESIZES, 1);
+    capture_session_resize(&client->capture, w, h);
     return SSH_OK;
 }
 
@@ -310,12 +583,7 @@ static void client_channel_eof(ssh_session session, ssh_channel channel,
 
     client_t *client = (client_t *)userdata;
     if (client) {
-        /* Exec clients commonly half-close stdin immediately after sending
-         * the command.  Keep stdout usable so the exec handler can return
-         * output and an exit status. */
-        if (client->exec_command[0] == '\0') {
-            client->connected = false;
-        }
+        client->connected = false;
     }
 }
 
@@ -338,7 +606,7 @@ int client_install_channel_callbacks(client_t *client) {
     client_addref(client);
     client->channel_callback_ref = true;
 
-    client->channel_cb = calloc(1, sizeof(struct ssh_channel_callbacks_struct));
+    client->channel_cb = client_channel_callbacks_new();
     if (!client->channel_cb) {
         client->channel_callback_ref = false;
         client_release(client);
@@ -353,7 +621,7 @@ int client_install_channel_callbacks(client_t *client) {
         client_channel_window_change;
 
     if (ssh_set_channel_callbacks(client->channel, client->channel_cb) != SSH_OK) {
-        free(client->channel_cb);
+        client_channel_callbacks_free(client->channel_cb);
         client->channel_cb = NULL;
         client->channel_callback_ref = false;
         client_release(client);
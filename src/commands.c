@@ -10,8 +10,11 @@
 #include "command_catalog.h"
 #include "common.h"
 #include "i18n.h"
+#include "lock_profile.h"
 #include "manual.h"
 #include "message.h"
+#include "post_limit.h"
+#include "scratch.h"
 #include "system_message.h"
 #include "theme.h"
 #include "tui.h"
@@ -65,8 +68,27 @@ static void client_append_whisper(client_t *owner, const char *from,
     if (!owner || !from || !to || !content) return;
 
     pthread_mutex_lock(&owner->whisper_lock);
+    if (owner->whisper_inbox_count >= owner->whisper_inbox_capacity &&
+        owner->whisper_inbox_capacity < WHISPER_INBOX_SIZE) {
+        int capacity = owner->whisper_inbox_capacity > 0
+                       ? owner->whisper_inbox_capacity * 2 : 2;
+        if (capacity > WHISPER_INBOX_SIZE) {
+            capacity = WHISPER_INBOX_SIZE;
+        }
+        whisper_t *grown = realloc(owner->whisper_inbox,
+                                   (size_t)capacity * sizeof(whisper_t));
+        if (!grown) {
+            pthread_mutex_unlock(&owner->whisper_lock);
+            return;
+        }
+        owner->whisper_inbox = grown;
+        owner->whisper_inbox_capacity = capacity;
+        client_mem_set(owner, CLIENT_MEM_WHISPERS,
+                       (size_t)capacity * sizeof(whisper_t));
+    }
+
     int slot;
-    if (owner->whisper_inbox_count < WHISPER_INBOX_SIZE) {
+    if (owner->whisper_inbox_count < owner->whisper_inbox_capacity) {
         slot = owner->whisper_inbox_count++;
     } else {
         memmove(&owner->whisper_inbox[0],
@@ -98,7 +120,15 @@ static void send_private_message(client_t *client, const char *target_name,
     bool found = false;
     client_t *target = NULL;
 
-    pthread_rwlock_rdlock(&g_room->lock);
+    if (!post_limit_allow(POST_KIND_WHISPER, client->username,
+                          client->client_ip)) {
+        buffer_appendf(output, buf_size, pos,
+                       i18n_text(client->ui_lang, I18N_MSG_THROTTLED_FORMAT),
+                       target_name);
+        return;
+    }
+
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
     for (int i = 0; i < g_room->client_count; i++) {
         if (strcmp(g_room->clients[i]->username, target_name) == 0) {
             target = g_room->clients[i];
@@ -107,7 +137,7 @@ static void send_private_message(client_t *client, const char *target_name,
             break;
         }
     }
-    pthread_rwlock_unlock(&g_room->lock);
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
 
     if (target) {
         client_append_whisper(target, client->username, target_name,
@@ -137,15 +167,23 @@ static void send_private_message(client_t *client, const char *target_name,
 
 static void append_inbox_output(client_t *client, char *output,
                                 size_t buf_size, size_t *pos) {
-    whisper_t snapshot[WHISPER_INBOX_SIZE];
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    whisper_t *snapshot = tnt_scratch_alloc(WHISPER_INBOX_SIZE *
+                                            sizeof(whisper_t));
     int snap_count;
     int unread_count;
 
+    if (!snapshot) {
+        return;
+    }
+
     pthread_mutex_lock(&client->whisper_lock);
     snap_count = client->whisper_inbox_count;
     unread_count = client->unread_whispers;
-    memcpy(snapshot, client->whisper_inbox,
-           snap_count * sizeof(whisper_t));
+    if (snap_count > 0) {
+        memcpy(snapshot, client->whisper_inbox,
+               snap_count * sizeof(whisper_t));
+    }
     for (int i = 0; i < snap_count; i++) {
         client->whisper_inbox[i].unread = false;
     }
@@ -190,29 +228,39 @@ static void append_inbox_output(client_t *client, char *output,
                        "  %s \033[90m%s\033[0m  \033[35m%s\033[0m: %s\n",
                        marker, ts, peer, snapshot[i].content);
     }
+    tnt_scratch_release(scratch);
 }
 
 static void clear_inbox(client_t *client) {
     pthread_mutex_lock(&client->whisper_lock);
-    memset(client->whisper_inbox, 0, sizeof(client->whisper_inbox));
+    free(client->whisper_inbox);
+    client->whisper_inbox = NULL;
     client->whisper_inbox_count = 0;
+    client->whisper_inbox_capacity = 0;
+    client_mem_set(client, CLIENT_MEM_WHISPERS, 0);
     client->unread_whispers = 0;
     client->last_whisper_peer[0] = '\0';
     pthread_mutex_unlock(&client->whisper_lock);
 }
 
 bool commands_refresh_active_output(client_t *client) {
-    char output[MAX_COMMAND_OUTPUT_LEN] = {0};
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    char *output;
     size_t pos = 0;
 
     if (!client || client->command_output_kind != TNT_COMMAND_OUTPUT_INBOX) {
         return false;
     }
 
-    append_inbox_output(client, output, sizeof(output), &pos);
-    snprintf(client->command_output, sizeof(client->command_output), "%s",
-             output);
+    output = tnt_scratch_alloc(MAX_COMMAND_OUTPUT_LEN);
+    if (!output) {
+        return false;
+    }
+    output[0] = '\0';
+    append_inbox_output(client, output, MAX_COMMAND_OUTPUT_LEN, &pos);
+    client_set_command_output(client, output);
     client->command_output_scroll = 0;
+    tnt_scratch_release(scratch);
     return true;
 }
 
@@ -221,10 +269,18 @@ void commands_dispatch(client_t *client) {
     strncpy(cmd_buf, client->command_input, sizeof(cmd_buf) - 1);
     cmd_buf[sizeof(cmd_buf) - 1] = '\0';
     char *cmd = cmd_buf;
-    char output[MAX_COMMAND_OUTPUT_LEN] = {0};
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    const size_t output_size = MAX_COMMAND_OUTPUT_LEN;
+    char *output = tnt_scratch_alloc(output_size);
     tnt_command_output_kind_t output_kind = TNT_COMMAND_OUTPUT_GENERIC;
     size_t pos = 0;
 
+    if (!output) {
+        client->command_input[0] = '\0';
+        return;
+    }
+    output[0] = '\0';
+
     /* Trim whitespace */
     while (*cmd == ' ') cmd++;
     size_t cmd_len = strlen(cmd);
@@ -240,18 +296,12 @@ void commands_dispatch(client_t *client) {
         while (*cmd == ' ') cmd++;
     }
 
-    /* Save to command history */
+    /* Count it and save to command history */
     if (cmd[0] != '\0') {
-        int max_hist = 16;
-        if (client->command_history_count >= max_hist) {
-            memmove(&client->command_history[0], &client->command_history[1],
-                    (max_hist - 1) * sizeof(client->command_history[0]));
-            client->command_history_count = max_hist - 1;
-        }
-        snprintf(client->command_history[client->command_history_count],
-                 sizeof(client->command_history[0]), "%s", cmd);
-        client->command_history_count++;
-        client->command_history_pos = client->command_history_count;
+        client_usage_add(client, CLIENT_USAGE_COMMANDS, 1);
+        tnt_line_history_push(&client->command_history, cmd,
+                              sizeof(client->command_input));
+        client_note_history(client);
     }
 
     if (cmd[0] == '\0') {
@@ -259,6 +309,7 @@ void commands_dispatch(client_t *client) {
         client->mode = MODE_NORMAL;
         client->command_input[0] = '\0';
         tui_render_screen(client);
+        tnt_scratch_release(scratch);
         return;
     }
 
@@ -266,23 +317,23 @@ void commands_dispatch(client_t *client) {
     const char *arg = "";
     if (!command_catalog_match(cmd, &command_id, &arg)) {
         const char *suggestion = command_catalog_suggest(cmd);
-        buffer_appendf(output, sizeof(output), &pos,
+        buffer_appendf(output, output_size, &pos,
                        i18n_text(client->ui_lang,
                                  I18N_UNKNOWN_COMMAND_FORMAT),
                        cmd);
         if (suggestion) {
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            i18n_text(client->ui_lang,
                                      I18N_DID_YOU_MEAN_FORMAT),
                            suggestion);
         }
-        buffer_appendf(output, sizeof(output), &pos, "%s",
+        buffer_appendf(output, output_size, &pos, "%s",
                        i18n_text(client->ui_lang, I18N_UNKNOWN_GUIDANCE));
         goto cmd_done;
     }
 
     if (!command_catalog_args_valid(command_id, arg)) {
-        append_command_usage(output, sizeof(output), &pos, command_id,
+        append_command_usage(output, output_size, &pos, command_id,
                              client->ui_lang);
         goto cmd_done;
     }
@@ -292,9 +343,9 @@ void commands_dispatch(client_t *client) {
         char self_gutter[32];
         snprintf(self_gutter, sizeof(self_gutter), "%s▎\033[0m", theme->accent);
 
-        pthread_rwlock_rdlock(&g_room->lock);
+        LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
         int total = g_room->client_count;
-        buffer_appendf(output, sizeof(output), &pos,
+        buffer_appendf(output, output_size, &pos,
                        "%s%s\033[0m  \033[2;37m· %d\033[0m\n",
                        theme->accent_bold,
                        i18n_text(client->ui_lang, I18N_USERS_TITLE), total);
@@ -313,33 +364,33 @@ void commands_dispatch(client_t *client) {
                          dur / 3600, (dur % 3600) / 60);
             }
             /* 1-column gutter: ▎ for you, blank for others */
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            "%s  \033[37m%s\033[0m  \033[2;37m· %s\033[0m\n",
                            is_self ? self_gutter : " ",
                            g_room->clients[i]->username, dur_str);
         }
-        pthread_rwlock_unlock(&g_room->lock);
+        LOCK_PROFILE_RWUNLOCK(&g_room->lock);
 
     } else if (command_id == TNT_COMMAND_HELP) {
-        manual_append_interactive_panel(output, sizeof(output), &pos,
+        manual_append_interactive_panel(output, output_size, &pos,
                                         client->ui_lang);
 
     } else if (command_id == TNT_COMMAND_LANG) {
         ui_lang_t next_lang;
 
         if (!arg || arg[0] == '\0') {
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            i18n_text(client->ui_lang,
                                      I18N_LANG_CURRENT_FORMAT),
                            i18n_ui_lang_code(client->ui_lang));
         } else if (i18n_try_parse_ui_lang(arg, &next_lang)) {
             client->ui_lang = next_lang;
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            i18n_text(client->ui_lang,
                                      I18N_LANG_SET_FORMAT),
                            i18n_ui_lang_code(client->ui_lang));
         } else {
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            i18n_text(client->ui_lang,
                                      I18N_LANG_UNSUPPORTED_FORMAT),
                            arg);
@@ -356,11 +407,11 @@ void commands_dispatch(client_t *client) {
         while (*rest == ' ') rest++;
 
         if (target_name[0] == '\0' || rest[0] == '\0') {
-            append_command_usage(output, sizeof(output), &pos,
+            append_command_usage(output, output_size, &pos,
                                  TNT_COMMAND_MSG, client->ui_lang);
         } else {
             send_private_message(client, target_name, rest, output,
-                                 sizeof(output), &pos);
+                                 output_size, &pos);
         }
 
     } else if (command_id == TNT_COMMAND_REPLY) {
@@ -369,7 +420,7 @@ void commands_dispatch(client_t *client) {
 
         while (*message == ' ') message++;
         if (message[0] == '\0') {
-            append_command_usage(output, sizeof(output), &pos,
+            append_command_usage(output, output_size, &pos,
                                  TNT_COMMAND_REPLY, client->ui_lang);
         } else {
             pthread_mutex_lock(&client->whisper_lock);
@@ -378,12 +429,12 @@ void commands_dispatch(client_t *client) {
             pthread_mutex_unlock(&client->whisper_lock);
 
             if (target_name[0] == '\0') {
-                buffer_appendf(output, sizeof(output), &pos, "%s",
+                buffer_appendf(output, output_size, &pos, "%s",
                                i18n_text(client->ui_lang,
                                          I18N_REPLY_NO_TARGET));
             } else {
                 send_private_message(client, target_name, message, output,
-                                     sizeof(output), &pos);
+                                     output_size, &pos);
             }
         }
 
@@ -393,14 +444,14 @@ void commands_dispatch(client_t *client) {
         if (strcmp(inbox_arg, "clear") == 0) {
             clear_inbox(client);
             output_kind = TNT_COMMAND_OUTPUT_INBOX;
-            buffer_appendf(output, sizeof(output), &pos, "%s",
+            buffer_appendf(output, output_size, &pos, "%s",
                            i18n_text(client->ui_lang,
                                      I18N_INBOX_CLEARED));
-            buffer_appendf(output, sizeof(output), &pos, "\n");
-            append_inbox_output(client, output, sizeof(output), &pos);
+            buffer_appendf(output, output_size, &pos, "\n");
+            append_inbox_output(client, output, output_size, &pos);
         } else {
             output_kind = TNT_COMMAND_OUTPUT_INBOX;
-            append_inbox_output(client, output, sizeof(output), &pos);
+            append_inbox_output(client, output, output_size, &pos);
         }
 
     } else if (command_id == TNT_COMMAND_NICK) {
@@ -408,10 +459,10 @@ void commands_dispatch(client_t *client) {
         while (*new_name == ' ') new_name++;
 
         if (new_name[0] == '\0') {
-            append_command_usage(output, sizeof(output), &pos,
+            append_command_usage(output, output_size, &pos,
                                  TNT_COMMAND_NICK, client->ui_lang);
         } else if (!is_valid_username(new_name)) {
-            buffer_appendf(output, sizeof(output), &pos, "%s",
+            buffer_appendf(output, output_size, &pos, "%s",
                            i18n_text(client->ui_lang, I18N_NICK_INVALID));
         } else {
             char validated_name[MAX_USERNAME_LEN];
@@ -425,7 +476,7 @@ void commands_dispatch(client_t *client) {
              * concurrent :nick from another client. */
             char old_name[MAX_USERNAME_LEN];
             bool taken = false;
-            pthread_rwlock_wrlock(&g_room->lock);
+            LOCK_PROFILE_WRLOCK(&g_room->lock, LOCK_ID_ROOM);
             snprintf(old_name, sizeof(old_name), "%s", client->username);
             if (strcmp(validated_name, old_name) != 0) {
                 for (int i = 0; i < g_room->client_count; i++) {
@@ -440,15 +491,15 @@ void commands_dispatch(client_t *client) {
             if (!taken) {
                 snprintf(client->username, MAX_USERNAME_LEN, "%s", validated_name);
             }
-            pthread_rwlock_unlock(&g_room->lock);
+            LOCK_PROFILE_RWUNLOCK(&g_room->lock);
 
             if (taken) {
-                buffer_appendf(output, sizeof(output), &pos,
+                buffer_appendf(output, output_size, &pos,
                                i18n_text(client->ui_lang,
                                          I18N_NICK_TAKEN_FORMAT),
                                validated_name);
             } else if (strcmp(validated_name, old_name) == 0) {
-                buffer_appendf(output, sizeof(output), &pos, "%s",
+                buffer_appendf(output, output_size, &pos, "%s",
                                i18n_text(client->ui_lang,
                                          I18N_NICK_UNCHANGED));
             } else {
@@ -458,7 +509,7 @@ void commands_dispatch(client_t *client) {
                 room_broadcast(g_room, &nick_msg);
                 message_save(&nick_msg);
 
-                buffer_appendf(output, sizeof(output), &pos,
+                buffer_appendf(output, output_size, &pos,
                                i18n_text(client->ui_lang,
                                          I18N_NICK_CHANGED_FORMAT),
                                old_name, client->username);
@@ -472,7 +523,7 @@ void commands_dispatch(client_t *client) {
             char *endp;
             long val = strtol(arg, &endp, 10);
             if (*endp != '\0' || val < 1 || val > 50) {
-                append_command_usage(output, sizeof(output), &pos,
+                append_command_usage(output, output_size, &pos,
                                      TNT_COMMAND_LAST, client->ui_lang);
                 goto cmd_done;
             }
@@ -490,11 +541,11 @@ void commands_dispatch(client_t *client) {
         }
         int start = visible_count > n ? visible_count - n : 0;
         int last_count = visible_count - start;
-        buffer_appendf(output, sizeof(output), &pos,
+        buffer_appendf(output, output_size, &pos,
                        i18n_text(client->ui_lang, I18N_LAST_HEADER_FORMAT),
                        last_count);
         if (last_count == 0) {
-            buffer_appendf(output, sizeof(output), &pos, "%s",
+            buffer_appendf(output, output_size, &pos, "%s",
                            i18n_text(client->ui_lang, I18N_LAST_EMPTY));
         }
         for (int i = 0; i < last_count; i++) {
@@ -503,7 +554,7 @@ void commands_dispatch(client_t *client) {
             struct tm tmi;
             localtime_r(&msg->timestamp, &tmi);
             strftime(ts, sizeof(ts), "%m-%d %H:%M", &tmi);
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            "[%s] %s: %s\n", ts, msg->username, msg->content);
         }
         free(last_msgs);
@@ -512,7 +563,7 @@ void commands_dispatch(client_t *client) {
         const char *query = arg;
         while (*query == ' ') query++;
         if (*query == '\0') {
-            append_command_usage(output, sizeof(output), &pos,
+            append_command_usage(output, output_size, &pos,
                                  TNT_COMMAND_SEARCH, client->ui_lang);
         } else {
             message_t *found = NULL;
@@ -526,12 +577,12 @@ void commands_dispatch(client_t *client) {
             }
             int start = visible_count > 15 ? visible_count - 15 : 0;
             int display_count = visible_count - start;
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            i18n_text(client->ui_lang,
                                      I18N_SEARCH_HEADER_FORMAT),
                            query, display_count);
             if (display_count == 0) {
-                buffer_appendf(output, sizeof(output), &pos, "%s",
+                buffer_appendf(output, output_size, &pos, "%s",
                                i18n_text(client->ui_lang,
                                          I18N_SEARCH_EMPTY));
             }
@@ -541,21 +592,21 @@ void commands_dispatch(client_t *client) {
                 struct tm tmi;
                 localtime_r(&msg->timestamp, &tmi);
                 strftime(ts, sizeof(ts), "%m-%d %H:%M", &tmi);
-                buffer_appendf(output, sizeof(output), &pos,
+                buffer_appendf(output, output_size, &pos,
                                "[%s] ", ts);
-                append_highlighted(output, sizeof(output), &pos,
+                append_highlighted(output, output_size, &pos,
                                    msg->username, query);
-                buffer_appendf(output, sizeof(output), &pos, ": ");
-                append_highlighted(output, sizeof(output), &pos,
+                buffer_appendf(output, output_size, &pos, ": ");
+                append_highlighted(output, output_size, &pos,
                                    msg->content, query);
-                buffer_appendf(output, sizeof(output), &pos, "\n");
+                buffer_appendf(output, output_size, &pos, "\n");
             }
             free(found);
         }
 
     } else if (command_id == TNT_COMMAND_MUTE_JOINS) {
         client->mute_joins = !client->mute_joins;
-        buffer_appendf(output, sizeof(output), &pos,
+        buffer_appendf(output, output_size, &pos,
                        i18n_text(client->ui_lang, I18N_MUTE_JOINS_FORMAT),
                        i18n_text(client->ui_lang,
                                  client->mute_joins ?
@@ -570,7 +621,7 @@ void commands_dispatch(client_t *client) {
             char names[256] = {0};
             size_t npos = 0;
             theme_append_names(names, sizeof(names), &npos);
-            buffer_appendf(output, sizeof(output), &pos,
+            buffer_appendf(output, output_size, &pos,
                            i18n_text(client->ui_lang,
                                      I18N_THEME_CURRENT_FORMAT),
                            theme_resolve(client->theme_index)->name, names);
@@ -578,7 +629,7 @@ void commands_dispatch(client_t *client) {
             const theme_t *chosen = theme_find(name);
             if (chosen) {
                 client->theme_index = (int)(chosen - theme_at(0));
-                buffer_appendf(output, sizeof(output), &pos,
+                buffer_appendf(output, output_size, &pos,
                                i18n_text(client->ui_lang,
                                          I18N_THEME_SET_FORMAT),
                                chosen->name);
@@ -586,7 +637,7 @@ void commands_dispatch(client_t *client) {
                 char names[256] = {0};
                 size_t npos = 0;
                 theme_append_names(names, sizeof(names), &npos);
-                buffer_appendf(output, sizeof(output), &pos,
+                buffer_appendf(output, output_size, &pos,
                                i18n_text(client->ui_lang,
                                          I18N_THEME_UNSUPPORTED_FORMAT),
                                name, names);
@@ -595,17 +646,19 @@ void commands_dispatch(client_t *client) {
 
     } else if (command_id == TNT_COMMAND_QUIT) {
         client->connected = false;
+        tnt_scratch_release(scratch);
         return;
 
     } else if (command_id == TNT_COMMAND_CLEAR) {
-        buffer_appendf(output, sizeof(output), &pos, "%s",
+        buffer_appendf(output, output_size, &pos, "%s",
                        i18n_text(client->ui_lang, I18N_CLEAR_DONE));
     }
 
 cmd_done:
-    snprintf(client->command_output, sizeof(client->command_output), "%s", output);
+    client_set_command_output(client, output);
     client->command_output_scroll = 0;
     client->command_output_kind = output_kind;
     client->command_input[0] = '\0';
     tui_render_command_output(client);
+    tnt_scratch_release(scratch);
 }
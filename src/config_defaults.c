@@ -38,6 +38,34 @@ const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT = {
     TNT_MAX_RATE_LIMIT_ENABLED,
 };
 
+const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_TABLE_SIZE = {
+    "TNT_RATE_LIMIT_TABLE_SIZE",
+    TNT_DEFAULT_RATE_LIMIT_TABLE_SIZE,
+    TNT_MIN_RATE_LIMIT_TABLE_SIZE,
+    TNT_MAX_RATE_LIMIT_TABLE_SIZE,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_TTL = {
+    "TNT_RATE_LIMIT_TTL",
+    TNT_DEFAULT_RATE_LIMIT_TTL,
+    TNT_MIN_RATE_LIMIT_TTL,
+    TNT_MAX_RATE_LIMIT_TTL,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_V4_PREFIX = {
+    "TNT_RATE_LIMIT_V4_PREFIX",
+    TNT_DEFAULT_RATE_LIMIT_V4_PREFIX,
+    TNT_MIN_RATE_LIMIT_V4_PREFIX,
+    TNT_MAX_RATE_LIMIT_V4_PREFIX,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_RATE_LIMIT_V6_PREFIX = {
+    "TNT_RATE_LIMIT_V6_PREFIX",
+    TNT_DEFAULT_RATE_LIMIT_V6_PREFIX,
+    TNT_MIN_RATE_LIMIT_V6_PREFIX,
+    TNT_MAX_RATE_LIMIT_V6_PREFIX,
+};
+
 const tnt_int_config_spec_t TNT_CONFIG_IDLE_TIMEOUT = {
     "TNT_IDLE_TIMEOUT",
     TNT_DEFAULT_IDLE_TIMEOUT,
@@ -45,6 +73,111 @@ const tnt_int_config_spec_t TNT_CONFIG_IDLE_TIMEOUT = {
     TNT_MAX_IDLE_TIMEOUT,
 };
 
+const tnt_int_config_spec_t TNT_CONFIG_SESSION_STACK_KB = {
+    "TNT_SESSION_STACK_KB",
+    TNT_DEFAULT_SESSION_STACK_KB,
+    TNT_MIN_SESSION_STACK_KB,
+    TNT_MAX_SESSION_STACK_KB,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_MAX_PENDING_HANDSHAKES = {
+    "TNT_MAX_PENDING_HANDSHAKES",
+    TNT_DEFAULT_MAX_PENDING_HANDSHAKES,
+    TNT_MIN_CONFIGURED_CLIENTS,
+    TNT_MAX_CONFIGURED_CLIENTS,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_KEX_TIMEOUT = {
+    "TNT_KEX_TIMEOUT",
+    TNT_DEFAULT_KEX_TIMEOUT,
+    TNT_MIN_HANDSHAKE_TIMEOUT,
+    TNT_MAX_HANDSHAKE_TIMEOUT,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_AUTH_TIMEOUT = {
+    "TNT_AUTH_TIMEOUT",
+    TNT_DEFAULT_AUTH_TIMEOUT,
+    TNT_MIN_HANDSHAKE_TIMEOUT,
+    TNT_MAX_HANDSHAKE_TIMEOUT,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_CHANNEL_TIMEOUT = {
+    "TNT_CHANNEL_TIMEOUT",
+    TNT_DEFAULT_CHANNEL_TIMEOUT,
+    TNT_MIN_HANDSHAKE_TIMEOUT,
+    TNT_MAX_HANDSHAKE_TIMEOUT,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_ACCEPTORS = {
+    "TNT_ACCEPTORS",
+    TNT_DEFAULT_ACCEPTORS,
+    TNT_MIN_ACCEPTORS,
+    TNT_MAX_ACCEPTORS,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_DRAIN_TIMEOUT = {
+    "TNT_DRAIN_TIMEOUT",
+    TNT_DEFAULT_DRAIN_TIMEOUT,
+    TNT_MIN_DRAIN_TIMEOUT,
+    TNT_MAX_DRAIN_TIMEOUT,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_CONTROL_SOCKET = {
+    "TNT_CONTROL_SOCKET",
+    TNT_DEFAULT_CONTROL_SOCKET,
+    TNT_MIN_CONTROL_SOCKET,
+    TNT_MAX_CONTROL_SOCKET,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_POST_RATE = {
+    "TNT_POST_RATE",
+    TNT_DEFAULT_POST_RATE,
+    TNT_MIN_POST_RATE,
+    TNT_MAX_POST_RATE,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_POST_BURST = {
+    "TNT_POST_BURST",
+    TNT_DEFAULT_POST_BURST,
+    TNT_MIN_POST_BURST,
+    TNT_MAX_POST_BURST,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_POST_IP_RATE = {
+    "TNT_POST_IP_RATE",
+    TNT_DEFAULT_POST_IP_RATE,
+    TNT_MIN_POST_RATE,
+    TNT_MAX_POST_RATE,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_POST_IP_BURST = {
+    "TNT_POST_IP_BURST",
+    TNT_DEFAULT_POST_IP_BURST,
+    TNT_MIN_POST_BURST,
+    TNT_MAX_POST_BURST,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_LOCK_PROFILE = {
+    "TNT_LOCK_PROFILE",
+    TNT_DEFAULT_LOCK_PROFILE,
+    TNT_MIN_LOCK_PROFILE,
+    TNT_MAX_LOCK_PROFILE,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_CAPTURE = {
+    "TNT_CAPTURE",
+    TNT_DEFAULT_CAPTURE,
+    TNT_MIN_CAPTURE,
+    TNT_MAX_CAPTURE,
+};
+
+const tnt_int_config_spec_t TNT_CONFIG_CAPTURE_MAX_MB = {
+    "TNT_CAPTURE_MAX_MB",
+    TNT_DEFAULT_CAPTURE_MAX_MB,
+    TNT_MIN_CAPTURE_MAX_MB,
+    TNT_MAX_CAPTURE_MAX_MB,
+};
+
 const tnt_int_config_spec_t TNT_CONFIG_SSH_LOG_LEVEL = {
     "TNT_SSH_LOG_LEVEL",
     0,
@@ -0,0 +1,281 @@
+#include "control.h"
+#include "common.h"
+#include "unix_socket.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define CONTROL_GREETING "TNT-CONTROL 1 "
+#define CONTROL_IO_TIMEOUT_MS 5000
+#define CONTROL_MAX_REQUEST \
+    (sizeof(CONTROL_GREETING) + MAX_USERNAME_LEN + MAX_EXEC_COMMAND_LEN + 2)
+
+typedef struct {
+    int listen_fd;
+    control_handler_fn handler;
+    void *ctx;
+} control_server_t;
+
+/* Command output is collected first so the status line can lead. */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} control_reply_t;
+
+static int reply_write(void *sink, const char *data, size_t len) {
+    control_reply_t *reply = sink;
+
+    if (len > reply->cap - reply->len) {
+        size_t cap = reply->cap ? reply->cap : 4096;
+        char *grown;
+
+        while (len > cap - reply->len) {
+            cap *= 2;
+        }
+        grown = realloc(reply->data, cap);
+        if (!grown) {
+            return -1;
+        }
+        reply->data = grown;
+        reply->cap = cap;
+    }
+    memcpy(reply->data + reply->len, data, len);
+    reply->len += len;
+    return 0;
+}
+
+static int wait_readable(int fd) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int rc;
+
+    do {
+        rc = poll(&pfd, 1, CONTROL_IO_TIMEOUT_MS);
+    } while (rc < 0 && errno == EINTR);
+    return rc > 0 ? 0 : -1;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Read the two request lines into `buf`.  Returns 0 with both newlines
+ * replaced by NULs and *command pointing at the second line, or -1. */
+static int read_request(int conn, char *buf, size_t buf_size,
+                        char **command) {
+    size_t got = 0;
+    char *first = NULL;
+
+    while (got < buf_size - 1) {
+        ssize_t n;
+
+        if (wait_readable(conn) < 0) {
+            return -1;
+        }
+        n = read(conn, buf + got, buf_size - 1 - got);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        got += (size_t)n;
+        buf[got] = '\0';
+
+        if (!first) {
+            first = strchr(buf, '\n');
+        }
+        if (first) {
+            char *second = strchr(first + 1, '\n');
+            if (second) {
+                *first = '\0';
+                *second = '\0';
+                *command = first + 1;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+static void serve_one(control_server_t *server, int conn) {
+    char request[CONTROL_MAX_REQUEST];
+    char header[16];
+    control_reply_t reply = { 0 };
+    struct timeval timeout = { CONTROL_IO_TIMEOUT_MS / 1000, 0 };
+    const char *login;
+    char *command = NULL;
+    int status;
+    int len;
+
+    if (!tnt_unix_peer_is_self(conn)) {
+        fprintf(stderr, "Control request refused: peer runs as another user\n");
+        return;
+    }
+    if (read_request(conn, request, sizeof(request), &command) < 0 ||
+        strncmp(request, CONTROL_GREETING, sizeof(CONTROL_GREETING) - 1) != 0) {
+        return;
+    }
+
+    login = request + sizeof(CONTROL_GREETING) - 1;
+    if (strcmp(login, "-") == 0 || login[0] == '\0') {
+        login = NULL;
+    }
+
+    status = server->handler(login, command, reply_write, &reply, server->ctx);
+
+    /* A stalled reader must not wedge the control thread. */
+    setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    len = snprintf(header, sizeof(header), "%d\n", status);
+    if (write_all(conn, header, (size_t)len) == 0 && reply.len > 0) {
+        write_all(conn, reply.data, reply.len);
+    }
+    free(reply.data);
+}
+
+static void *control_thread(void *arg) {
+    control_server_t *server = arg;
+
+    while (1) {
+        int conn = tnt_unix_accept(server->listen_fd, "Control socket error");
+
+        if (conn < 0) {
+            break;
+        }
+
+        serve_one(server, conn);
+        close(conn);
+    }
+
+    close(server->listen_fd);
+    free(server);
+    return NULL;
+}
+
+int control_server_start(const char *path, control_handler_fn handler,
+                         void *ctx) {
+    control_server_t *server;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int rc;
+
+    if (!path || !handler) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    server = calloc(1, sizeof(*server));
+    if (!server) {
+        return -1;
+    }
+    server->listen_fd = tnt_unix_listen(path, 0600);
+    if (server->listen_fd < 0) {
+        int saved = errno;
+        free(server);
+        errno = saved;
+        return -1;
+    }
+    server->handler = handler;
+    server->ctx = ctx;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create(&thread, &attr, control_thread, server);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        close(server->listen_fd);
+        unlink(path);
+        free(server);
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+int control_request(const char *path, const char *login, const char *command,
+                    int out_fd) {
+    char buf[4096];
+    int status = 0;
+    bool have_status = false;
+    int sock;
+
+    if (!command || strchr(command, '\n') ||
+        (login && (login[0] == '\0' || strchr(login, '\n')))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    sock = tnt_unix_connect(path);
+    if (sock < 0) {
+        return -1;
+    }
+
+    if (write_all(sock, CONTROL_GREETING, sizeof(CONTROL_GREETING) - 1) < 0 ||
+        write_all(sock, login ? login : "-", strlen(login ? login : "-")) < 0 ||
+        write_all(sock, "\n", 1) < 0 ||
+        write_all(sock, command, strlen(command)) < 0 ||
+        write_all(sock, "\n", 1) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    while (1) {
+        ssize_t n;
+        size_t off = 0;
+
+        if (wait_readable(sock) < 0) {
+            break;
+        }
+        n = read(sock, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        /* The status line is at most a few digits; parse it as it arrives. */
+        while (!have_status && off < (size_t)n) {
+            char c = buf[off++];
+            if (c == '\n') {
+                have_status = true;
+            } else if (c >= '0' && c <= '9' && status < 1000) {
+                status = status * 10 + (c - '0');
+            } else {
+                close(sock);
+                errno = EPROTO;
+                return -1;
+            }
+        }
+        if (off < (size_t)n && write_all(out_fd, buf + off, (size_t)n - off) < 0) {
+            break;
+        }
+    }
+
+    close(sock);
+    if (!have_status) {
+        errno = EPROTO;
+        return -1;
+    }
+    return status;
+}
@@ -1,4 +1,5 @@
 #include "exec.h"
+#include "bootstrap.h"
 #include "chat_room.h"
 #include "client.h"
 #include "common.h"
@@ -6,11 +7,19 @@
 #include "i18n.h"
 #include "input.h"
 #include "json_text.h"
+#include "lock_profile.h"
 #include "message.h"
+#include "metrics.h"
 #include "module_runtime.h"
+#include "object_pool.h"
+#include "post_limit.h"
 #include "ratelimit.h"
+#include "timer_wheel.h"
+#include "trace.h"
 #include "utf8.h"
 #include <ctype.h>
+#include <libssh/callbacks.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +27,8 @@
 
 #define TNT_DUMP_DEFAULT_RECORDS 100
 #define TNT_DUMP_MAX_RECORDS 10000
+#define EXEC_SESSION_STALL_MS 10000   /* max wait for the peer's window */
+#define EXEC_SESSION_LINGER_MS 2000   /* max wait for the peer's close */
 
 /* `notify_mentions` is shared with the interactive INSERT-mode send path.
  * Declared in input.h. */
@@ -61,15 +72,14 @@ static void trim_ascii_whitespace(char *text) {
     }
 }
 
-static void resolve_exec_username(const client_t *client, char *buffer,
+static void resolve_exec_username(const char *login, char *buffer,
                                   size_t buf_size) {
     if (!buffer || buf_size == 0) {
         return;
     }
 
-    if (client && client->ssh_login[0] != '\0' &&
-        is_valid_username(client->ssh_login)) {
-        snprintf(buffer, buf_size, "%s", client->ssh_login);
+    if (login && login[0] != '\0' && is_valid_username(login)) {
+        snprintf(buffer, buf_size, "%s", login);
     } else {
         snprintf(buffer, buf_size, "%s", "anonymous");
     }
@@ -79,35 +89,58 @@ static void resolve_exec_username(const client_t *client, char *buffer,
     }
 }
 
-static int exec_command_help(client_t *client) {
+static int exec_write(const exec_context_t *ctx, const char *data,
+                      size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    return ctx->write(ctx->sink, data, len);
+}
+
+static int exec_printf(const exec_context_t *ctx, const char *fmt, ...) {
+    char buffer[2048];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+
+    if (len < 0 || len >= (int)sizeof(buffer)) {
+        return -1;
+    }
+    return exec_write(ctx, buffer, (size_t)len);
+}
+
+static int exec_command_help(const exec_context_t *ctx) {
     char help_text[1024];
     size_t pos = 0;
 
     help_text[0] = '\0';
     exec_catalog_append_help(help_text, sizeof(help_text), &pos,
-                             client->ui_lang);
-    return client_send(client, help_text, pos) == 0 ? TNT_EXIT_OK
-                                                   : TNT_EXIT_ERROR;
+                             ctx->lang);
+    return exec_write(ctx, help_text, pos) == 0 ? TNT_EXIT_OK
+                                                 : TNT_EXIT_ERROR;
 }
 
-static int exec_command_usage(client_t *client, tnt_exec_command_id_t id) {
+static int exec_command_usage(const exec_context_t *ctx, tnt_exec_command_id_t id) {
     char usage[128];
     size_t pos = 0;
 
     usage[0] = '\0';
     exec_catalog_append_usage(usage, sizeof(usage), &pos, id,
-                              client->ui_lang);
-    client_printf(client, "%s", usage);
+                              ctx->lang);
+    exec_printf(ctx, "%s", usage);
     return TNT_EXIT_USAGE;
 }
 
-static int exec_command_health(client_t *client) {
+static int exec_command_health(const exec_context_t *ctx) {
     static const char ok[] = "ok\n";
-    return client_send(client, ok, sizeof(ok) - 1) == 0 ? TNT_EXIT_OK
-                                                       : TNT_EXIT_ERROR;
+    return exec_write(ctx, ok, sizeof(ok) - 1) == 0 ? TNT_EXIT_OK
+                                                     : TNT_EXIT_ERROR;
 }
 
-static int exec_command_users(client_t *client, bool json) {
+static int exec_command_users(const exec_context_t *ctx, bool json) {
     int count;
     char (*usernames)[MAX_USERNAME_LEN] = NULL;
     char *output;
@@ -115,13 +148,13 @@ static int exec_command_users(client_t *client, bool json) {
     size_t pos = 0;
     int rc;
 
-    pthread_rwlock_rdlock(&g_room->lock);
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
     count = g_room->client_count;
     if (count > 0) {
         usernames = calloc((size_t)count, sizeof(*usernames));
         if (!usernames) {
-            pthread_rwlock_unlock(&g_room->lock);
-            client_printf(client, "users: out of memory\n");
+            LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+            exec_printf(ctx, "users: out of memory\n");
             return TNT_EXIT_ERROR;
         }
 
@@ -130,7 +163,7 @@ static int exec_command_users(client_t *client, bool json) {
                      g_room->clients[i]->username);
         }
     }
-    pthread_rwlock_unlock(&g_room->lock);
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
 
     output_size = json ? ((size_t)count * (MAX_USERNAME_LEN * 2 + 8) + 8)
                        : ((size_t)count * (MAX_USERNAME_LEN + 1) + 1);
@@ -141,7 +174,7 @@ static int exec_command_users(client_t *client, bool json) {
     output = calloc(output_size, 1);
     if (!output) {
         free(usernames);
-        client_printf(client, "users: out of memory\n");
+        exec_printf(ctx, "users: out of memory\n");
         return TNT_EXIT_ERROR;
     }
 
@@ -160,40 +193,321 @@ static int exec_command_users(client_t *client, bool json) {
         }
     }
 
-    rc = client_send(client, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
+    rc = exec_write(ctx, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
     free(output);
     free(usernames);
     return rc;
 }
 
-static int exec_command_stats(client_t *client, bool json) {
-    int online_users;
-    int message_count;
-    int client_capacity;
-    int active_connections;
+#define EXEC_SESSIONS_DEFAULT 10
+#define EXEC_SESSIONS_MAX 100000
+
+typedef struct {
+    char username[MAX_USERNAME_LEN];
+    char client_ip[INET6_ADDRSTRLEN];
+    time_t connect_time;
+    int width;
+    int height;
+    uint64_t usage[CLIENT_USAGE_COUNT];
+} exec_session_row_t;
+
+/* Parse `[N] [-n N] [--net] [--json]` in any order. */
+static int parse_sessions_args(const char *args, int *limit, bool *by_net,
+                               bool *json) {
+    char copy[128];
+    char *save = NULL;
+    bool have_limit = false;
+
+    *limit = EXEC_SESSIONS_DEFAULT;
+    *by_net = false;
+    *json = false;
+    if (!args || args[0] == '\0') {
+        return 0;
+    }
+    if (strlen(args) >= sizeof(copy)) {
+        return -1;
+    }
+    snprintf(copy, sizeof(copy), "%s", args);
+
+    for (char *tok = strtok_r(copy, " \t", &save); tok;
+         tok = strtok_r(NULL, " \t", &save)) {
+        char *end = NULL;
+        long value;
+
+        if (strcmp(tok, "--json") == 0 && !*json) {
+            *json = true;
+            continue;
+        }
+        if (strcmp(tok, "--net") == 0 && !*by_net) {
+            *by_net = true;
+            continue;
+        }
+        if (strcmp(tok, "-n") == 0) {
+            tok = strtok_r(NULL, " \t", &save);
+            if (!tok) {
+                return -1;
+            }
+        }
+        value = strtol(tok, &end, 10);
+        if (have_limit || end == tok || *end != '\0' ||
+            value < 1 || value > EXEC_SESSIONS_MAX) {
+            return -1;
+        }
+        *limit = (int)value;
+        have_limit = true;
+    }
+    return 0;
+}
+
+static uint64_t session_row_bytes(const exec_session_row_t *row) {
+    return row->usage[CLIENT_USAGE_BYTES_RECEIVED] +
+           row->usage[CLIENT_USAGE_BYTES_SENT];
+}
+
+/* Descending, CPU first and bytes as the tie-break, or the other way. */
+static int compare_sessions_cpu(const void *a, const void *b) {
+    const exec_session_row_t *x = a;
+    const exec_session_row_t *y = b;
+    uint64_t xc = x->usage[CLIENT_USAGE_CPU_NS];
+    uint64_t yc = y->usage[CLIENT_USAGE_CPU_NS];
+
+    if (xc != yc) return xc < yc ? 1 : -1;
+    if (session_row_bytes(x) != session_row_bytes(y)) {
+        return session_row_bytes(x) < session_row_bytes(y) ? 1 : -1;
+    }
+    return 0;
+}
+
+static int compare_sessions_net(const void *a, const void *b) {
+    const exec_session_row_t *x = a;
+    const exec_session_row_t *y = b;
+
+    if (session_row_bytes(x) != session_row_bytes(y)) {
+        return session_row_bytes(x) < session_row_bytes(y) ? 1 : -1;
+    }
+    return compare_sessions_cpu(a, b);
+}
+
+static int exec_command_sessions(const exec_context_t *ctx, const char *args) {
+    exec_session_row_t *rows = NULL;
     time_t now = time(NULL);
-    long uptime_seconds;
-    char buffer[512];
-    int len;
+    int limit;
+    bool by_net;
+    bool json;
+    int count;
+    int shown;
+    char *output;
+    size_t output_size;
+    size_t pos = 0;
+    int rc;
+
+    if (parse_sessions_args(args, &limit, &by_net, &json) < 0) {
+        return exec_command_usage(ctx, TNT_EXEC_COMMAND_SESSIONS);
+    }
+
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
+    count = g_room->client_count;
+    if (count > 0) {
+        rows = calloc((size_t)count, sizeof(*rows));
+        if (!rows) {
+            LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+            exec_printf(ctx, "sessions: out of memory\n");
+            return TNT_EXIT_ERROR;
+        }
+        for (int i = 0; i < count; i++) {
+            client_t *member = g_room->clients[i];
+            snprintf(rows[i].username, sizeof(rows[i].username), "%s",
+                     member->username);
+            snprintf(rows[i].client_ip, sizeof(rows[i].client_ip), "%s",
+                     member->client_ip);
+            rows[i].connect_time = member->connect_time;
+            rows[i].width = member->width;
+            rows[i].height = member->height;
+            client_usage(member, rows[i].usage);
+        }
+    }
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+
+    if (count > 1) {
+        qsort(rows, (size_t)count, sizeof(*rows),
+              by_net ? compare_sessions_net : compare_sessions_cpu);
+    }
+    shown = count < limit ? count : limit;
+
+    output_size = 256 + (size_t)shown * (MAX_USERNAME_LEN * 2 +
+                                         INET6_ADDRSTRLEN + 256);
+    output = calloc(output_size, 1);
+    if (!output) {
+        free(rows);
+        exec_printf(ctx, "sessions: out of memory\n");
+        return TNT_EXIT_ERROR;
+    }
 
-    pthread_rwlock_rdlock(&g_room->lock);
-    online_users = g_room->client_count;
-    message_count = g_room->message_count;
-    client_capacity = g_room->client_capacity;
-    pthread_rwlock_unlock(&g_room->lock);
+    if (json) {
+        buffer_appendf(output, output_size, &pos,
+                       "{\"status\":\"ok\",\"sessions\":%d,\"sort\":\"%s\","
+                       "\"top\":[",
+                       count, by_net ? "net" : "cpu");
+    } else {
+        buffer_appendf(output, output_size, &pos,
+                       "status ok\nsessions %d\nsort %s\n",
+                       count, by_net ? "net" : "cpu");
+    }
+    for (int i = 0; i < shown; i++) {
+        const exec_session_row_t *row = &rows[i];
+        long long age = now > row->connect_time ?
+                        (long long)(now - row->connect_time) : 0;
+
+        if (json) {
+            buffer_appendf(output, output_size, &pos, "%s{\"username\":",
+                           i > 0 ? "," : "");
+            tnt_json_append_string(output, output_size, &pos, row->username);
+            buffer_appendf(output, output_size, &pos, ",\"ip\":");
+            tnt_json_append_string(output, output_size, &pos,
+                                   row->client_ip);
+            buffer_appendf(output, output_size, &pos,
+                           ",\"age_s\":%lld,\"cpu_us\":%llu,"
+                           "\"bytes_received\":%llu,\"bytes_sent\":%llu,"
+                           "\"frames\":%llu,\"commands\":%llu,"
+                           "\"resizes\":%llu,\"width\":%d,\"height\":%d}",
+                           age,
+                           (unsigned long long)
+                               (row->usage[CLIENT_USAGE_CPU_NS] / 1000u),
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_BYTES_RECEIVED],
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_BYTES_SENT],
+                           (unsigned long long)row->usage[CLIENT_USAGE_FRAMES],
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_COMMANDS],
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_RESIZES],
+                           row->width, row->height);
+        } else {
+            buffer_appendf(output, output_size, &pos,
+                           "session %s %s age_s=%lld cpu_us=%llu "
+                           "bytes_received=%llu bytes_sent=%llu frames=%llu "
+                           "commands=%llu resizes=%llu size=%dx%d\n",
+                           row->username, row->client_ip, age,
+                           (unsigned long long)
+                               (row->usage[CLIENT_USAGE_CPU_NS] / 1000u),
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_BYTES_RECEIVED],
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_BYTES_SENT],
+                           (unsigned long long)row->usage[CLIENT_USAGE_FRAMES],
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_COMMANDS],
+                           (unsigned long long)
+                               row->usage[CLIENT_USAGE_RESIZES],
+                           row->width, row->height);
+        }
+    }
+    if (json) {
+        buffer_append_bytes(output, output_size, &pos, "]}\n", 3);
+    }
 
-    active_connections = ratelimit_get_active_total();
+    rc = exec_write(ctx, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
+    free(output);
+    free(rows);
+    return rc;
+}
 
+void exec_stats_collect(exec_stats_t *stats) {
+    time_t now = time(NULL);
     time_t start = ssh_server_start_time();
-    uptime_seconds = (start > 0 && now >= start) ? (long)(now - start) : 0;
+
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
+    stats->online_users = g_room->client_count;
+    stats->message_count = g_room->message_count;
+    stats->client_capacity = g_room->client_capacity;
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+
+    stats->active_connections = ratelimit_get_active_total();
+    stats->pending_handshakes = bootstrap_pending_handshakes();
+    stats->kex_timeouts = bootstrap_phase_timeouts(BOOTSTRAP_PHASE_KEX);
+    stats->auth_timeouts = bootstrap_phase_timeouts(BOOTSTRAP_PHASE_AUTH);
+    stats->channel_timeouts = bootstrap_phase_timeouts(BOOTSTRAP_PHASE_CHANNEL);
+    for (int i = 0; i < POST_KIND_COUNT; i++) {
+        stats->posts_throttled[i] = post_limit_rejected((post_kind_t)i);
+    }
+    stats->uptime_seconds =
+        (start > 0 && now >= start) ? (long)(now - start) : 0;
+}
+
+void exec_stats_append_metrics(const exec_stats_t *stats, char *buffer,
+                               size_t buf_size, size_t *pos) {
+    buffer_appendf(buffer, buf_size, pos,
+                   "# HELP tnt_online_users Users in the chat room.\n"
+                   "# TYPE tnt_online_users gauge\n"
+                   "tnt_online_users %d\n"
+                   "# HELP tnt_messages Messages held in room history.\n"
+                   "# TYPE tnt_messages gauge\n"
+                   "tnt_messages %d\n"
+                   "# HELP tnt_client_capacity Allocated room client slots.\n"
+                   "# TYPE tnt_client_capacity gauge\n"
+                   "tnt_client_capacity %d\n"
+                   "# HELP tnt_active_connections Admitted TCP connections.\n"
+                   "# TYPE tnt_active_connections gauge\n"
+                   "tnt_active_connections %d\n"
+                   "# HELP tnt_pending_handshakes Connections still in the "
+                   "SSH handshake.\n"
+                   "# TYPE tnt_pending_handshakes gauge\n"
+                   "tnt_pending_handshakes %d\n"
+                   "# HELP tnt_handshake_timeouts_total Handshakes dropped at a "
+                   "phase deadline.\n"
+                   "# TYPE tnt_handshake_timeouts_total counter\n"
+                   "tnt_handshake_timeouts_total{phase=\"kex\"} %lu\n"
+                   "tnt_handshake_timeouts_total{phase=\"auth\"} %lu\n"
+                   "tnt_handshake_timeouts_total{phase=\"channel\"} %lu\n"
+                   "# HELP tnt_uptime_seconds Seconds since the server "
+                   "started.\n"
+                   "# TYPE tnt_uptime_seconds gauge\n"
+                   "tnt_uptime_seconds %ld\n",
+                   stats->online_users, stats->message_count,
+                   stats->client_capacity, stats->active_connections,
+                   stats->pending_handshakes, stats->kex_timeouts,
+                   stats->auth_timeouts, stats->channel_timeouts,
+                   stats->uptime_seconds);
+
+    buffer_appendf(buffer, buf_size, pos,
+                   "# HELP tnt_posts_throttled_total Posts refused by the "
+                   "posting rate limit.\n"
+                   "# TYPE tnt_posts_throttled_total counter\n");
+    for (int i = 0; i < POST_KIND_COUNT; i++) {
+        buffer_appendf(buffer, buf_size, pos,
+                       "tnt_posts_throttled_total{kind=\"%s\"} %lu\n",
+                       post_limit_kind_name((post_kind_t)i),
+                       stats->posts_throttled[i]);
+    }
+}
+
+static int exec_command_stats(const exec_context_t *ctx, bool json) {
+    exec_stats_t stats;
+    char buffer[1024];
+    int len;
+
+    exec_stats_collect(&stats);
 
     if (json) {
         len = snprintf(buffer, sizeof(buffer),
                        "{\"status\":\"ok\",\"online_users\":%d,"
                        "\"message_count\":%d,\"client_capacity\":%d,"
-                       "\"active_connections\":%d,\"uptime_seconds\":%ld}\n",
-                       online_users, message_count, client_capacity,
-                       active_connections, uptime_seconds);
+                       "\"active_connections\":%d,\"uptime_seconds\":%ld,"
+                       "\"pending_handshakes\":%d,"
+                       "\"handshake_timeouts\":{\"kex\":%lu,\"auth\":%lu,"
+                       "\"channel\":%lu},"
+                       "\"posts_throttled\":{\"public\":%lu,\"whisper\":%lu,"
+                       "\"exec\":%lu,\"module\":%lu}}\n",
+                       stats.online_users, stats.message_count,
+                       stats.client_capacity, stats.active_connections,
+                       stats.uptime_seconds, stats.pending_handshakes,
+                       stats.kex_timeouts, stats.auth_timeouts,
+                       stats.channel_timeouts,
+                       stats.posts_throttled[POST_KIND_PUBLIC],
+                       stats.posts_throttled[POST_KIND_WHISPER],
+                       stats.posts_throttled[POST_KIND_EXEC],
+                       stats.posts_throttled[POST_KIND_MODULE]);
     } else {
         len = snprintf(buffer, sizeof(buffer),
                        "status ok\n"
@@ -201,18 +515,438 @@ static int exec_command_stats(client_t *client, bool json) {
                        "message_count %d\n"
                        "client_capacity %d\n"
                        "active_connections %d\n"
-                       "uptime_seconds %ld\n",
-                       online_users, message_count, client_capacity,
-                       active_connections, uptime_seconds);
+                       "uptime_seconds %ld\n"
+                       "pending_handshakes %d\n"
+                       "handshake_timeouts_kex %lu\n"
+                       "handshake_timeouts_auth %lu\n"
+                       "handshake_timeouts_channel %lu\n"
+                       "posts_throttled_public %lu\n"
+                       "posts_throttled_whisper %lu\n"
+                       "posts_throttled_exec %lu\n"
+                       "posts_throttled_module %lu\n",
+                       stats.online_users, stats.message_count,
+                       stats.client_capacity, stats.active_connections,
+                       stats.uptime_seconds, stats.pending_handshakes,
+                       stats.kex_timeouts, stats.auth_timeouts,
+                       stats.channel_timeouts,
+                       stats.posts_throttled[POST_KIND_PUBLIC],
+                       stats.posts_throttled[POST_KIND_WHISPER],
+                       stats.posts_throttled[POST_KIND_EXEC],
+                       stats.posts_throttled[POST_KIND_MODULE]);
     }
 
     if (len < 0 || len >= (int)sizeof(buffer)) {
-        client_printf(client, "stats: output overflow\n");
+        exec_printf(ctx, "stats: output overflow\n");
+        return TNT_EXIT_ERROR;
+    }
+
+    return exec_write(ctx, buffer, (size_t)len) == 0 ? TNT_EXIT_OK
+                                                      : TNT_EXIT_ERROR;
+}
+
+#define EXEC_METRICS_OUTPUT_MAX 32768
+
+/* Text output matches GET /metrics; JSON carries only the registry, since
+ * `stats --json` already has the room counters. */
+static int exec_command_metrics(const exec_context_t *ctx, bool json) {
+    metrics_snapshot_t snap;
+    char *output = malloc(EXEC_METRICS_OUTPUT_MAX);
+    size_t pos = 0;
+    int rc;
+
+    if (!output) {
+        exec_printf(ctx, "metrics: out of memory\n");
+        return TNT_EXIT_ERROR;
+    }
+    output[0] = '\0';
+
+    metrics_snapshot(&snap);
+    if (json) {
+        metrics_append_json(&snap, output, EXEC_METRICS_OUTPUT_MAX, &pos);
+    } else {
+        exec_stats_t stats;
+
+        exec_stats_collect(&stats);
+        exec_stats_append_metrics(&stats, output, EXEC_METRICS_OUTPUT_MAX,
+                                  &pos);
+        metrics_append_prometheus(&snap, output, EXEC_METRICS_OUTPUT_MAX,
+                                  &pos);
+    }
+
+    if (pos >= EXEC_METRICS_OUTPUT_MAX - 1) {
+        free(output);
+        exec_printf(ctx, "metrics: output overflow\n");
         return TNT_EXIT_ERROR;
     }
+    rc = exec_write(ctx, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
+    free(output);
+    return rc;
+}
 
-    return client_send(client, buffer, (size_t)len) == 0 ? TNT_EXIT_OK
-                                                        : TNT_EXIT_ERROR;
+#define EXEC_LOCKS_OUTPUT_MAX 8192
+
+/* Reading the profile is open like `stats`; switching it changes the cost
+ * of every lock, so that is left to the local operator. */
+static int exec_command_locks(const exec_context_t *ctx, const char *args) {
+    bool on = exec_catalog_has_flag(args, "--on");
+    bool off = exec_catalog_has_flag(args, "--off");
+    bool reset = exec_catalog_has_flag(args, "--reset");
+    bool json = exec_catalog_has_flag(args, "--json");
+    char *output;
+    size_t pos = 0;
+    int rc;
+
+    if ((int)on + (int)off + (int)reset + (int)json > 1) {
+        return exec_command_usage(ctx, TNT_EXEC_COMMAND_LOCKS);
+    }
+    if (on || off || reset) {
+        if (!ctx->local) {
+            exec_printf(ctx, "%s",
+                        i18n_text(ctx->lang, I18N_EXEC_LOCKS_LOCAL_ONLY));
+            return TNT_EXIT_USAGE;
+        }
+        if (reset) {
+            lock_profile_reset();
+        } else {
+            lock_profile_set_enabled(on);
+        }
+        return exec_printf(ctx, "lock_profile %s\n",
+                           reset ? "reset" : (on ? "on" : "off")) == 0
+                   ? TNT_EXIT_OK
+                   : TNT_EXIT_ERROR;
+    }
+
+    output = malloc(EXEC_LOCKS_OUTPUT_MAX);
+    if (!output) {
+        exec_printf(ctx, "locks: out of memory\n");
+        return TNT_EXIT_ERROR;
+    }
+    output[0] = '\0';
+    if (json) {
+        lock_profile_append_json(output, EXEC_LOCKS_OUTPUT_MAX, &pos);
+    } else {
+        lock_profile_append_text(output, EXEC_LOCKS_OUTPUT_MAX, &pos);
+    }
+    rc = exec_write(ctx, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
+    free(output);
+    return rc;
+}
+
+static int exec_command_trace(const exec_context_t *ctx, const char *args) {
+    bool start = args && strcmp(args, "start") == 0;
+    bool stop = args && strcmp(args, "stop") == 0;
+    trace_status_t status;
+    char path[PATH_MAX];
+
+    if (args && args[0] != '\0' && !start && !stop) {
+        return exec_command_usage(ctx, TNT_EXEC_COMMAND_TRACE);
+    }
+    if ((start || stop) && !ctx->local) {
+        exec_printf(ctx, "%s", i18n_text(ctx->lang,
+                                         I18N_EXEC_TRACE_LOCAL_ONLY));
+        return TNT_EXIT_USAGE;
+    }
+
+    if (start) {
+        trace_start();
+        return exec_printf(ctx, "trace on\n") == 0 ? TNT_EXIT_OK
+                                                    : TNT_EXIT_ERROR;
+    }
+    if (stop) {
+        trace_stop();
+        if (trace_dump(path, sizeof(path)) < 0) {
+            exec_printf(ctx, "trace: cannot write trace file\n");
+            return TNT_EXIT_ERROR;
+        }
+        trace_get_status(&status);
+        return exec_printf(ctx, "trace off\nfile %s\nevents %llu\n", path,
+                           (unsigned long long)status.events) == 0
+                   ? TNT_EXIT_OK
+                   : TNT_EXIT_ERROR;
+    }
+
+    trace_get_status(&status);
+    return exec_printf(ctx,
+                       "trace %s\nevents %llu\nthreads %u\n"
+                       "overwritten %llu\nuntraced %llu\n",
+                       status.active ? "on" : "off",
+                       (unsigned long long)status.events, status.rings,
+                       (unsigned long long)status.overwritten,
+                       (unsigned long long)status.untraced) == 0
+               ? TNT_EXIT_OK
+               : TNT_EXIT_ERROR;
+}
+
+typedef struct {
+    char username[MAX_USERNAME_LEN];
+    char client_ip[INET6_ADDRSTRLEN];
+    size_t bytes[CLIENT_MEM_COUNT];
+    size_t total;
+} exec_client_memory_t;
+
+static const char *const client_mem_names[CLIENT_MEM_COUNT] = {
+    "outbox", "render", "history", "output", "whispers", "input"
+};
+
+#define EXEC_MAX_POOL_STATS 16
+
+static int exec_command_memory(const exec_context_t *ctx, bool json) {
+    exec_client_memory_t *rows = NULL;
+    tnt_pool_stats_t pools[EXEC_MAX_POOL_STATS];
+    int pool_count;
+    int count;
+    size_t total = 0;
+    char *output;
+    size_t output_size;
+    size_t pos = 0;
+    int rc;
+
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
+    count = g_room->client_count;
+    if (count > 0) {
+        rows = calloc((size_t)count, sizeof(*rows));
+        if (!rows) {
+            LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+            exec_printf(ctx, "stats: out of memory\n");
+            return TNT_EXIT_ERROR;
+        }
+        for (int i = 0; i < count; i++) {
+            client_t *member = g_room->clients[i];
+            snprintf(rows[i].username, sizeof(rows[i].username), "%s",
+                     member->username);
+            snprintf(rows[i].client_ip, sizeof(rows[i].client_ip), "%s",
+                     member->client_ip);
+            rows[i].total = client_memory_usage(member, rows[i].bytes);
+            total += rows[i].total;
+        }
+    }
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+
+    pool_count = tnt_pool_collect_stats(pools, EXEC_MAX_POOL_STATS);
+
+    output_size = 256 + (size_t)pool_count * 160 +
+                  (size_t)count * (MAX_USERNAME_LEN * 2 +
+                                   INET6_ADDRSTRLEN + 256);
+    output = calloc(output_size, 1);
+    if (!output) {
+        free(rows);
+        exec_printf(ctx, "stats: out of memory\n");
+        return TNT_EXIT_ERROR;
+    }
+
+    if (json) {
+        buffer_appendf(output, output_size, &pos,
+                       "{\"status\":\"ok\",\"clients\":%d,"
+                       "\"client_struct_bytes\":%zu,\"total_bytes\":%zu,"
+                       "\"per_client\":[",
+                       count, sizeof(client_t), total);
+        for (int i = 0; i < count; i++) {
+            buffer_appendf(output, output_size, &pos, "%s{\"username\":",
+                           i > 0 ? "," : "");
+            tnt_json_append_string(output, output_size, &pos,
+                                   rows[i].username);
+            buffer_appendf(output, output_size, &pos, ",\"ip\":");
+            tnt_json_append_string(output, output_size, &pos,
+                                   rows[i].client_ip);
+            buffer_appendf(output, output_size, &pos, ",\"total_bytes\":%zu",
+                           rows[i].total);
+            for (int k = 0; k < CLIENT_MEM_COUNT; k++) {
+                buffer_appendf(output, output_size, &pos, ",\"%s\":%zu",
+                               client_mem_names[k], rows[i].bytes[k]);
+            }
+            buffer_append_bytes(output, output_size, &pos, "}", 1);
+        }
+        buffer_appendf(output, output_size, &pos, "],\"pools\":[");
+        for (int i = 0; i < pool_count; i++) {
+            buffer_appendf(output, output_size, &pos,
+                           "%s{\"name\":\"%s\",\"object_size\":%zu,"
+                           "\"in_use\":%zu,\"free\":%zu,\"reused\":%lu,"
+                           "\"allocated\":%lu}",
+                           i > 0 ? "," : "", pools[i].name,
+                           pools[i].object_size, pools[i].in_use,
+                           pools[i].free_count, pools[i].reused,
+                           pools[i].allocated);
+        }
+        buffer_append_bytes(output, output_size, &pos, "]}\n", 3);
+    } else {
+        buffer_appendf(output, output_size, &pos,
+                       "status ok\n"
+                       "clients %d\n"
+                       "client_struct_bytes %zu\n"
+                       "total_bytes %zu\n",
+                       count, sizeof(client_t), total);
+        for (int i = 0; i < count; i++) {
+            buffer_appendf(output, output_size, &pos, "client %s %s %zu",
+                           rows[i].username, rows[i].client_ip,
+                           rows[i].total);
+            for (int k = 0; k < CLIENT_MEM_COUNT; k++) {
+                buffer_appendf(output, output_size, &pos, " %s=%zu",
+                               client_mem_names[k], rows[i].bytes[k]);
+            }
+            buffer_append_bytes(output, output_size, &pos, "\n", 1);
+        }
+        for (int i = 0; i < pool_count; i++) {
+            buffer_appendf(output, output_size, &pos,
+                           "pool %s size=%zu in_use=%zu free=%zu reused=%lu "
+                           "allocated=%lu\n",
+                           pools[i].name, pools[i].object_size,
+                           pools[i].in_use, pools[i].free_count,
+                           pools[i].reused, pools[i].allocated);
+        }
+    }
+
+    rc = exec_write(ctx, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
+    free(output);
+    free(rows);
+    return rc;
+}
+
+typedef struct {
+    char username[MAX_USERNAME_LEN];
+    char client_ip[INET6_ADDRSTRLEN];
+    client_latency_t worst;
+} exec_client_latency_t;
+
+#define EXEC_LATENCY_HISTS 2
+#define EXEC_LATENCY_QUANTILES 3
+
+static const metric_hist_t exec_latency_hists[EXEC_LATENCY_HISTS] = {
+    METRIC_HIST_DELIVERY_ENQUEUE_US,
+    METRIC_HIST_DELIVERY_FLUSH_US
+};
+static const char *const exec_latency_names[EXEC_LATENCY_HISTS] = {
+    "delivery_enqueue_us", "delivery_flush_us"
+};
+static const double exec_latency_quantiles[EXEC_LATENCY_QUANTILES] = {0.5, 0.9, 0.99};
+static const char *const exec_latency_quantile_names[EXEC_LATENCY_QUANTILES] = {
+    "p50", "p90", "p99"
+};
+
+/* Quantiles are bucket upper bounds; past the last bound prints inf/null. */
+static void exec_append_latency_bound(char *output, size_t output_size,
+                                      size_t *pos, uint64_t value,
+                                      bool json) {
+    if (value == UINT64_MAX) {
+        buffer_appendf(output, output_size, pos, "%s", json ? "null" : "inf");
+    } else {
+        buffer_appendf(output, output_size, pos, "%llu",
+                       (unsigned long long)value);
+    }
+}
+
+static int exec_command_latency(const exec_context_t *ctx, bool json) {
+    exec_client_latency_t *rows = NULL;
+    metrics_snapshot_t snap;
+    int count;
+    char *output;
+    size_t output_size;
+    size_t pos = 0;
+    int rc;
+
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
+    count = g_room->client_count;
+    if (count > 0) {
+        rows = calloc((size_t)count, sizeof(*rows));
+        if (!rows) {
+            LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+            exec_printf(ctx, "stats: out of memory\n");
+            return TNT_EXIT_ERROR;
+        }
+        for (int i = 0; i < count; i++) {
+            client_t *member = g_room->clients[i];
+            snprintf(rows[i].username, sizeof(rows[i].username), "%s",
+                     member->username);
+            snprintf(rows[i].client_ip, sizeof(rows[i].client_ip), "%s",
+                     member->client_ip);
+            client_latency_worst(member, &rows[i].worst);
+        }
+    }
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+
+    metrics_snapshot(&snap);
+
+    output_size = 1024 + (size_t)count * (MAX_USERNAME_LEN * 2 +
+                                          INET6_ADDRSTRLEN + 160);
+    output = calloc(output_size, 1);
+    if (!output) {
+        free(rows);
+        exec_printf(ctx, "stats: out of memory\n");
+        return TNT_EXIT_ERROR;
+    }
+
+    if (json) {
+        buffer_appendf(output, output_size, &pos, "{\"status\":\"ok\"");
+        for (size_t h = 0; h < EXEC_LATENCY_HISTS; h++) {
+            metric_hist_t id = exec_latency_hists[h];
+
+            buffer_appendf(output, output_size, &pos,
+                           ",\"%s\":{\"count\":%llu,\"sum\":%llu",
+                           exec_latency_names[h],
+                           (unsigned long long)snap.hists[id].count,
+                           (unsigned long long)snap.hists[id].sum);
+            for (size_t q = 0; q < EXEC_LATENCY_QUANTILES; q++) {
+                buffer_appendf(output, output_size, &pos, ",\"%s\":",
+                               exec_latency_quantile_names[q]);
+                exec_append_latency_bound(
+                    output, output_size, &pos,
+                    metrics_hist_quantile(&snap, id,
+                                          exec_latency_quantiles[q]),
+                    true);
+            }
+            buffer_append_bytes(output, output_size, &pos, "}", 1);
+        }
+        buffer_appendf(output, output_size, &pos, ",\"per_client\":[");
+        for (int i = 0; i < count; i++) {
+            buffer_appendf(output, output_size, &pos, "%s{\"username\":",
+                           i > 0 ? "," : "");
+            tnt_json_append_string(output, output_size, &pos,
+                                   rows[i].username);
+            buffer_appendf(output, output_size, &pos, ",\"ip\":");
+            tnt_json_append_string(output, output_size, &pos,
+                                   rows[i].client_ip);
+            buffer_appendf(output, output_size, &pos,
+                           ",\"worst_enqueue_us\":%llu,"
+                           "\"worst_flush_us\":%llu,"
+                           "\"worst_delivery_us\":%llu}",
+                           (unsigned long long)rows[i].worst.enqueue_us,
+                           (unsigned long long)rows[i].worst.flush_us,
+                           (unsigned long long)rows[i].worst.delivery_us);
+        }
+        buffer_append_bytes(output, output_size, &pos, "]}\n", 3);
+    } else {
+        buffer_appendf(output, output_size, &pos, "status ok\n");
+        for (size_t h = 0; h < EXEC_LATENCY_HISTS; h++) {
+            metric_hist_t id = exec_latency_hists[h];
+
+            buffer_appendf(output, output_size, &pos, "%s count %llu",
+                           exec_latency_names[h],
+                           (unsigned long long)snap.hists[id].count);
+            for (size_t q = 0; q < EXEC_LATENCY_QUANTILES; q++) {
+                buffer_appendf(output, output_size, &pos, " %s ",
+                               exec_latency_quantile_names[q]);
+                exec_append_latency_bound(
+                    output, output_size, &pos,
+                    metrics_hist_quantile(&snap, id,
+                                          exec_latency_quantiles[q]),
+                    false);
+            }
+            buffer_append_bytes(output, output_size, &pos, "\n", 1);
+        }
+        for (int i = 0; i < count; i++) {
+            buffer_appendf(output, output_size, &pos,
+                           "client %s %s worst_enqueue_us=%llu "
+                           "worst_flush_us=%llu worst_delivery_us=%llu\n",
+                           rows[i].username, rows[i].client_ip,
+                           (unsigned long long)rows[i].worst.enqueue_us,
+                           (unsigned long long)rows[i].worst.flush_us,
+                           (unsigned long long)rows[i].worst.delivery_us);
+        }
+    }
+
+    rc = exec_write(ctx, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
+    free(output);
+    free(rows);
+    return rc;
 }
 
 static int parse_tail_count(const char *args, int *count) {
@@ -302,7 +1036,7 @@ static int parse_dump_count(const char *args, int *count) {
     return 0;
 }
 
-static int exec_command_tail(client_t *client, const char *args) {
+static int exec_command_tail(const exec_context_t *ctx, const char *args) {
     int requested = 20;
     int total_messages;
     int start;
@@ -314,10 +1048,10 @@ static int exec_command_tail(client_t *client, const char *args) {
     int rc;
 
     if (parse_tail_count(args, &requested) < 0) {
-        return exec_command_usage(client, TNT_EXEC_COMMAND_TAIL);
+        return exec_command_usage(ctx, TNT_EXEC_COMMAND_TAIL);
     }
 
-    pthread_rwlock_rdlock(&g_room->lock);
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
     total_messages = g_room->message_count;
     start = total_messages - requested;
     if (start < 0) {
@@ -328,20 +1062,20 @@ static int exec_command_tail(client_t *client, const char *args) {
     if (count > 0) {
         snapshot = calloc((size_t)count, sizeof(message_t));
         if (!snapshot) {
-            pthread_rwlock_unlock(&g_room->lock);
-            client_printf(client, "tail: out of memory\n");
+            LOCK_PROFILE_RWUNLOCK(&g_room->lock);
+            exec_printf(ctx, "tail: out of memory\n");
             return TNT_EXIT_ERROR;
         }
         memcpy(snapshot, &g_room->messages[start], (size_t)count * sizeof(message_t));
     }
-    pthread_rwlock_unlock(&g_room->lock);
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
 
     output_size = (size_t)(count > 0 ? count : 1) *
                   (MAX_USERNAME_LEN + MAX_MESSAGE_LEN + 48);
     output = calloc(output_size, 1);
     if (!output) {
         free(snapshot);
-        client_printf(client, "tail: out of memory\n");
+        exec_printf(ctx, "tail: out of memory\n");
         return TNT_EXIT_ERROR;
     }
 
@@ -352,34 +1086,34 @@ static int exec_command_tail(client_t *client, const char *args) {
                        timestamp, snapshot[i].username, snapshot[i].content);
     }
 
-    rc = client_send(client, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
+    rc = exec_write(ctx, output, pos) == 0 ? TNT_EXIT_OK : TNT_EXIT_ERROR;
     free(output);
     free(snapshot);
     return rc;
 }
 
-static int exec_command_dump(client_t *client, const char *args) {
+static int exec_command_dump(const exec_context_t *ctx, const char *args) {
     int requested = 0;
     char *output = NULL;
     size_t output_len = 0;
     int rc;
 
     if (parse_dump_count(args, &requested) < 0) {
-        return exec_command_usage(client, TNT_EXEC_COMMAND_DUMP);
+        return exec_command_usage(ctx, TNT_EXEC_COMMAND_DUMP);
     }
 
     if (message_dump_text(&output, &output_len, requested) < 0) {
-        client_printf(client, "dump: failed to read message log\n");
+        exec_printf(ctx, "dump: failed to read message log\n");
         return TNT_EXIT_ERROR;
     }
 
-    rc = client_send(client, output, output_len) == 0 ? TNT_EXIT_OK
-                                                     : TNT_EXIT_ERROR;
+    rc = exec_write(ctx, output, output_len) == 0 ? TNT_EXIT_OK
+                                                   : TNT_EXIT_ERROR;
     free(output);
     return rc;
 }
 
-static int exec_command_post(client_t *client, const char *args) {
+static int exec_command_post(const exec_context_t *ctx, const char *args) {
     char content[MAX_MESSAGE_LEN];
     char username[MAX_USERNAME_LEN];
     message_t msg = {
@@ -387,12 +1121,12 @@ static int exec_command_post(client_t *client, const char *args) {
     };
 
     if (!args || args[0] == '\0') {
-        return exec_command_usage(client, TNT_EXEC_COMMAND_POST);
+        return exec_command_usage(ctx, TNT_EXEC_COMMAND_POST);
     }
 
     if (strlen(args) >= sizeof(content)) {
-        client_printf(client, "%s",
-                      i18n_text(client->ui_lang, I18N_EXEC_POST_TOO_LONG));
+        exec_printf(ctx, "%s",
+                    i18n_text(ctx->lang, I18N_EXEC_POST_TOO_LONG));
         return TNT_EXIT_USAGE;
     }
 
@@ -401,19 +1135,24 @@ static int exec_command_post(client_t *client, const char *args) {
     trim_ascii_whitespace(content);
 
     if (content[0] == '\0') {
-        client_printf(client, "%s",
-                      i18n_text(client->ui_lang, I18N_EXEC_POST_EMPTY));
+        exec_printf(ctx, "%s",
+                    i18n_text(ctx->lang, I18N_EXEC_POST_EMPTY));
         return TNT_EXIT_USAGE;
     }
 
     if (!utf8_is_valid_string(content)) {
-        client_printf(client, "%s",
-                      i18n_text(client->ui_lang,
-                                I18N_EXEC_POST_INVALID_UTF8));
+        exec_printf(ctx, "%s",
+                    i18n_text(ctx->lang, I18N_EXEC_POST_INVALID_UTF8));
         return TNT_EXIT_ERROR;
     }
 
-    resolve_exec_username(client, username, sizeof(username));
+    resolve_exec_username(ctx->login, username, sizeof(username));
+
+    if (!post_limit_allow(POST_KIND_EXEC, username, ctx->client_ip)) {
+        exec_printf(ctx, "%s",
+                    i18n_text(ctx->lang, I18N_EXEC_POST_THROTTLED));
+        return TNT_EXIT_TEMPFAIL;
+    }
 
     if (strncmp(content, "/me ", 4) == 0 && content[4] != '\0') {
         msg.username[0] = '*';
@@ -431,63 +1170,75 @@ static int exec_command_post(client_t *client, const char *args) {
 
     if (message_save(&msg) < 0) {
         fprintf(stderr, "post: failed to persist message\n");
-        client_printf(client, "%s",
-                      i18n_text(client->ui_lang,
-                                I18N_EXEC_POST_PERSIST_FAILED));
+        exec_printf(ctx, "%s",
+                    i18n_text(ctx->lang, I18N_EXEC_POST_PERSIST_FAILED));
         return TNT_EXIT_ERROR;
     }
 
     room_broadcast(g_room, &msg);
-    notify_mentions(msg.content, client);
+    notify_mentions(msg.content, ctx->sender);
     tnt_module_runtime_publish_message_created(&msg);
 
-    if (client_send(client, "posted\n", 7) != 0) {
+    if (exec_write(ctx, "posted\n", 7) != 0) {
         return TNT_EXIT_ERROR;
     }
 
     return TNT_EXIT_OK;
 }
 
-int exec_dispatch(client_t *client) {
+int exec_run(const exec_context_t *ctx, const char *command) {
     char command_copy[MAX_EXEC_COMMAND_LEN];
     tnt_exec_command_id_t command_id;
     const char *args = NULL;
 
-    if (client->exec_command_too_long) {
-        client_printf(client, "%s",
-                      i18n_text(client->ui_lang,
-                                I18N_EXEC_COMMAND_TOO_LONG));
-        return TNT_EXIT_USAGE;
-    }
-
-    strncpy(command_copy, client->exec_command, sizeof(command_copy) - 1);
+    strncpy(command_copy, command ? command : "", sizeof(command_copy) - 1);
     command_copy[sizeof(command_copy) - 1] = '\0';
     trim_ascii_whitespace(command_copy);
 
     if (command_copy[0] == '\0') {
-        return exec_command_help(client);
+        return exec_command_help(ctx);
     }
 
     if (exec_catalog_match(command_copy, &command_id, &args)) {
         if (!exec_catalog_args_valid(command_id, args)) {
-            return exec_command_usage(client, command_id);
+            return exec_command_usage(ctx, command_id);
         }
 
         switch (command_id) {
             case TNT_EXEC_COMMAND_HELP:
-                return exec_command_help(client);
+                return exec_command_help(ctx);
             case TNT_EXEC_COMMAND_HEALTH:
-                return exec_command_health(client);
+                return exec_command_health(ctx);
             case TNT_EXEC_COMMAND_USERS:
-                return exec_command_users(client, args != NULL);
+                return exec_command_users(ctx, args != NULL);
+            case TNT_EXEC_COMMAND_SESSIONS:
+                return exec_command_sessions(ctx, args);
             case TNT_EXEC_COMMAND_STATS:
-                return exec_command_stats(client, args != NULL);
+                if (exec_catalog_has_flag(args, "--memory") &&
+                    exec_catalog_has_flag(args, "--latency")) {
+                    return exec_command_usage(ctx, command_id);
+                }
+                if (exec_catalog_has_flag(args, "--memory")) {
+                    return exec_command_memory(
+                        ctx, exec_catalog_has_flag(args, "--json"));
+                }
+                if (exec_catalog_has_flag(args, "--latency")) {
+                    return exec_command_latency(
+                        ctx, exec_catalog_has_flag(args, "--json"));
+                }
+                return exec_command_stats(ctx, args != NULL);
+            case TNT_EXEC_COMMAND_METRICS:
+                return exec_command_metrics(ctx, args != NULL);
+            case TNT_EXEC_COMMAND_LOCKS:
+                return exec_command_locks(ctx, args);
+            case TNT_EXEC_COMMAND_TRACE:
+                return exec_command_trace(ctx, args);
             case TNT_EXEC_COMMAND_TAIL:
-                return exec_command_tail(client, args);
+                return exec_command_tail(ctx, args);
             case TNT_EXEC_COMMAND_DUMP:
-                return exec_command_dump(client, args);
+                return exec_command_dump(ctx, args);
             case TNT_EXEC_COMMAND_POST:
-                return exec_command_post(client, args);
+                return exec_command_post(ctx, args);
             case TNT_EXEC_COMMAND_EXIT:
                 return TNT_EXIT_OK;
             case TNT_EXEC_COMMAND_COUNT:
@@ -501,9 +1252,142 @@ int exec_dispatch(client_t *client) {
             break;
         }
     }
-    client_printf(client,
-                  i18n_text(client->ui_lang,
-                            I18N_EXEC_UNKNOWN_COMMAND_FORMAT),
-                  command_copy);
+    exec_printf(ctx,
+                i18n_text(ctx->lang, I18N_EXEC_UNKNOWN_COMMAND_FORMAT),
+                command_copy);
     return TNT_EXIT_USAGE;
 }
+
+/* An exec request runs on its own small state instead of a client_t: the
+ * session is switched to non-blocking mode and one ssh_event drives window
+ * adjustments while output streams, then the exit-status / EOF / close
+ * sequence, so a slow peer costs at most one bounded wait. */
+typedef struct {
+    ssh_channel channel;
+    ssh_event event;
+    struct ssh_channel_callbacks_struct callbacks;
+    bool peer_closed;
+    bool failed;
+} exec_session_t;
+
+static void exec_session_channel_close(ssh_session session,
+                                       ssh_channel channel, void *userdata) {
+    (void)session;
+    (void)channel;
+    ((exec_session_t *)userdata)->peer_closed = true;
+}
+
+/* Wait for channel events until `deadline_ms`.  Returns false once the
+ * deadline passed or the session failed. */
+static bool exec_session_poll(exec_session_t *exec, uint64_t deadline_ms) {
+    uint64_t now = tnt_monotonic_ms();
+
+    if (now >= deadline_ms) {
+        return false;
+    }
+    if (ssh_event_dopoll(exec->event, (int)(deadline_ms - now)) == SSH_ERROR) {
+        exec->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static int exec_session_write(void *sink, const char *data, size_t len) {
+    exec_session_t *exec = (exec_session_t *)sink;
+    uint64_t stall_deadline = tnt_monotonic_ms() + EXEC_SESSION_STALL_MS;
+    size_t total = 0;
+
+    while (total < len) {
+        uint32_t window;
+        uint32_t chunk;
+        int sent;
+
+        if (exec->failed || exec->peer_closed ||
+            !ssh_channel_is_open(exec->channel)) {
+            exec->failed = true;
+            return -1;
+        }
+
+        window = ssh_channel_window_size(exec->channel);
+        chunk = (len - total > 32768) ? 32768 : (uint32_t)(len - total);
+        if (chunk > window) {
+            chunk = window;
+        }
+        sent = chunk > 0 ? ssh_channel_write(exec->channel, data + total, chunk)
+                         : 0;
+        if (sent < 0) {
+            exec->failed = true;
+            return -1;
+        }
+        if (sent == 0) {
+            /* Window closed: wait for the peer to consume output */
+            if (!exec_session_poll(exec, stall_deadline)) {
+                exec->failed = true;
+                return -1;
+            }
+            continue;
+        }
+        total += (size_t)sent;
+        stall_deadline = tnt_monotonic_ms() + EXEC_SESSION_STALL_MS;
+    }
+
+    return 0;
+}
+
+int exec_session_run(ssh_session session, ssh_channel channel,
+                     const char *login, const char *client_ip,
+                     const char *command) {
+    exec_session_t exec;
+    exec_context_t ctx;
+    uint64_t deadline;
+    int exit_status;
+
+    memset(&exec, 0, sizeof(exec));
+    exec.channel = channel;
+    exec.event = ssh_event_new();
+    if (!exec.event || ssh_event_add_session(exec.event, session) != SSH_OK) {
+        if (exec.event) {
+            ssh_event_free(exec.event);
+        }
+        return TNT_EXIT_ERROR;
+    }
+
+    ssh_callbacks_init(&exec.callbacks);
+    exec.callbacks.userdata = &exec;
+    exec.callbacks.channel_close_function = exec_session_channel_close;
+    ssh_set_channel_callbacks(channel, &exec.callbacks);
+    ssh_set_blocking(session, 0);
+
+    ctx = (exec_context_t){
+        .write = exec_session_write,
+        .sink = &exec,
+        .lang = i18n_default_ui_lang(),
+        .login = login,
+        .client_ip = client_ip,
+        .sender = NULL,
+    };
+
+    if (!command) {
+        exec_printf(&ctx, "%s",
+                    i18n_text(ctx.lang, I18N_EXEC_COMMAND_TOO_LONG));
+        exit_status = TNT_EXIT_USAGE;
+    } else {
+        exit_status = exec_run(&ctx, command);
+    }
+
+    /* Queue exit-status, EOF and close together, then wait once for the
+     * peer's close, which also means it has read everything before it. */
+    if (!exec.failed && !exec.peer_closed) {
+        ssh_channel_request_send_exit_status(channel, exit_status);
+        ssh_channel_send_eof(channel);
+        ssh_channel_close(channel);
+        deadline = tnt_monotonic_ms() + EXEC_SESSION_LINGER_MS;
+        while (!exec.peer_closed && exec_session_poll(&exec, deadline)) {
+        }
+    }
+
+    ssh_remove_channel_callbacks(channel, &exec.callbacks);
+    ssh_event_remove_session(exec.event, session);
+    ssh_event_free(exec.event);
+    return exit_status;
+}
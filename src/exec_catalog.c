@@ -12,55 +12,101 @@ typedef struct {
     bool no_args;
     bool optional_json;
     bool requires_args;
+    const char *flags;           /* Extra space-separated option flags */
 } exec_catalog_entry_t;
 
 static const exec_catalog_entry_t entries[] = {
     {TNT_EXEC_COMMAND_HELP, "help", "--help",
      "help", "help", I18N_STRING("Show this help", "显示此帮助"),
-     true, false, false},
+     true, false, false, NULL},
     {TNT_EXEC_COMMAND_HEALTH, "health", NULL,
      "health", "health",
      I18N_STRING("Print service health", "输出服务健康状态"),
-     true, false, false},
+     true, false, false, NULL},
     {TNT_EXEC_COMMAND_USERS, "users", NULL,
      "users [--json]", "users [--json]",
      I18N_STRING("List online users", "列出在线用户"),
-     false, true, false},
+     false, true, false, NULL},
+    {TNT_EXEC_COMMAND_SESSIONS, "sessions", NULL,
+     "sessions [N]", "sessions [N] [--net] [--json]",
+     I18N_STRING("Top sessions by CPU time", "按 CPU 时间列出会话"),
+     false, false, false, NULL},
+    {TNT_EXEC_COMMAND_SESSIONS, "sessions", NULL,
+     "sessions --net", "sessions [N] [--net] [--json]",
+     I18N_STRING("Top sessions by bytes in and out",
+                 "按收发字节数列出会话"),
+     false, false, false, NULL},
     {TNT_EXEC_COMMAND_STATS, "stats", NULL,
-     "stats [--json]", "stats [--json]",
+     "stats [--json]", "stats [--json] | stats --memory|--latency [--json]",
      I18N_STRING("Print room statistics", "输出房间统计"),
-     false, true, false},
+     false, true, false, "--memory --latency"},
+    {TNT_EXEC_COMMAND_STATS, "stats", NULL,
+     "stats --memory", "stats [--json] | stats --memory|--latency [--json]",
+     I18N_STRING("Print per-client memory use", "输出每个客户端的内存占用"),
+     false, true, false, "--memory --latency"},
+    {TNT_EXEC_COMMAND_STATS, "stats", NULL,
+     "stats --latency", "stats [--json] | stats --memory|--latency [--json]",
+     I18N_STRING("Print message delivery latency", "输出消息投递延迟"),
+     false, true, false, "--memory --latency"},
+    {TNT_EXEC_COMMAND_METRICS, "metrics", NULL,
+     "metrics [--json]", "metrics [--json]",
+     I18N_STRING("Print hot-path counters and histograms",
+                 "输出热路径计数器与直方图"),
+     false, true, false, NULL},
+    {TNT_EXEC_COMMAND_LOCKS, "locks", NULL,
+     "locks [--json]", "locks [--json] | locks --on|--off|--reset",
+     I18N_STRING("Print lock contention profile", "输出锁竞争分析"),
+     false, true, false, "--on --off --reset"},
+    {TNT_EXEC_COMMAND_LOCKS, "locks", NULL,
+     "locks --reset", "locks [--json] | locks --on|--off|--reset",
+     I18N_STRING("Clear it; --on/--off switch it (local socket)",
+                 "清空；--on/--off 开关（本地套接字）"),
+     false, true, false, "--on --off --reset"},
+    {TNT_EXEC_COMMAND_TRACE, "trace", NULL,
+     "trace", "trace [start|stop]",
+     I18N_STRING("Print event trace status", "输出事件追踪状态"),
+     false, false, false, NULL},
+    {TNT_EXEC_COMMAND_TRACE, "trace", NULL,
+     "trace start", "trace [start|stop]",
+     I18N_STRING("Record trace events (local socket)",
+                 "开始记录追踪事件（本地套接字）"),
+     false, false, false, NULL},
+    {TNT_EXEC_COMMAND_TRACE, "trace", NULL,
+     "trace stop", "trace [start|stop]",
+     I18N_STRING("Stop and write Chrome trace JSON to the state dir",
+                 "停止并将 Chrome 追踪 JSON 写入状态目录"),
+     false, false, false, NULL},
     {TNT_EXEC_COMMAND_TAIL, "tail", NULL,
      "tail [N]", "tail [N] | tail -n N",
      I18N_STRING("Print recent messages", "输出最近消息"),
-     false, false, false},
+     false, false, false, NULL},
     {TNT_EXEC_COMMAND_TAIL, "tail", NULL,
      "tail -n N", "tail [N] | tail -n N",
      I18N_STRING("Print recent messages", "输出最近消息"),
-     false, false, false},
+     false, false, false, NULL},
     {TNT_EXEC_COMMAND_DUMP, "dump", NULL,
      "dump [N]", "dump [N] | dump -n N | dump --all",
      I18N_STRING("Export persisted messages", "导出持久化消息"),
-     false, false, false},
+     false, false, false, NULL},
     {TNT_EXEC_COMMAND_DUMP, "dump", NULL,
      "dump -n N", "dump [N] | dump -n N | dump --all",
      I18N_STRING("Export persisted messages", "导出持久化消息"),
-     false, false, false},
+     false, false, false, NULL},
     {TNT_EXEC_COMMAND_DUMP, "dump", NULL,
      "dump --all", "dump [N] | dump -n N | dump --all",
      I18N_STRING("Export persisted messages", "导出持久化消息"),
-     false, false, false},
+     false, false, false, NULL},
     {TNT_EXEC_COMMAND_POST, "post", NULL,
      "post MESSAGE", "post MESSAGE",
      I18N_STRING("Post a message non-interactively", "非交互发送消息"),
-     false, false, true},
+     false, false, true, NULL},
     {TNT_EXEC_COMMAND_POST, "post", NULL,
      "post \"/me act\"", "post MESSAGE",
      I18N_STRING("Post an action message", "发送动作消息"),
-     false, false, true},
+     false, false, true, NULL},
     {TNT_EXEC_COMMAND_EXIT, "exit", NULL,
      "exit", "exit", I18N_STRING("Exit successfully", "成功退出"),
-     true, false, false}
+     true, false, false, NULL}
 };
 
 static const exec_catalog_entry_t *entry_for_id(tnt_exec_command_id_t id) {
@@ -126,6 +172,49 @@ bool exec_catalog_match(const char *line, tnt_exec_command_id_t *id,
     return false;
 }
 
+/* Return the length of the whitespace-delimited token starting at `p`. */
+static size_t token_length(const char *p) {
+    size_t len = 0;
+
+    while (p[len] && p[len] != ' ' && p[len] != '\t') {
+        len++;
+    }
+    return len;
+}
+
+static bool token_listed(const char *token, size_t len, const char *list) {
+    for (const char *p = skip_spaces(list); p && *p;) {
+        size_t item_len = token_length(p);
+        if (item_len == len && strncmp(p, token, len) == 0) {
+            return true;
+        }
+        p = skip_spaces(p + item_len);
+    }
+    return false;
+}
+
+/* Every token is --json or one of `flags`, each at most once. */
+static bool flags_valid(const char *args, const char *flags) {
+    for (const char *p = skip_spaces(args); p && *p;) {
+        size_t len = token_length(p);
+        bool known = (len == 6 && strncmp(p, "--json", 6) == 0) ||
+                     token_listed(p, len, flags);
+
+        if (!known || token_listed(p, len, p + len)) {
+            return false;
+        }
+        p = skip_spaces(p + len);
+    }
+    return true;
+}
+
+bool exec_catalog_has_flag(const char *args, const char *flag) {
+    if (!args || !flag || flag[0] == '\0') {
+        return false;
+    }
+    return token_listed(flag, strlen(flag), args);
+}
+
 bool exec_catalog_args_valid(tnt_exec_command_id_t id, const char *args) {
     const exec_catalog_entry_t *entry = entry_for_id(id);
 
@@ -136,7 +225,10 @@ bool exec_catalog_args_valid(tnt_exec_command_id_t id, const char *args) {
         return !args || args[0] == '\0';
     }
     if (entry->optional_json) {
-        return !args || strcmp(args, "--json") == 0;
+        if (!args || strcmp(args, "--json") == 0) {
+            return true;
+        }
+        return entry->flags && flags_valid(args, entry->flags);
     }
     if (entry->requires_args) {
         return args && args[0] != '\0';
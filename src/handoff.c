@@ -0,0 +1,194 @@
+#include "handoff.h"
+#include "unix_socket.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define HANDOFF_GREETING "TNT-HANDOFF 1\n"
+#define HANDOFF_ACK "OK\n"
+#define HANDOFF_IO_TIMEOUT_MS 5000
+
+typedef struct {
+    int listen_fd;
+    handoff_export_fn export_fn;
+    handoff_done_fn done_fn;
+    void *ctx;
+} handoff_server_t;
+
+/* Read exactly `len` bytes within the I/O timeout.  Returns 0 or -1. */
+static int read_exact(int fd, char *buf, size_t len) {
+    size_t got = 0;
+
+    while (got < len) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        ssize_t n;
+        int rc = poll(&pfd, 1, HANDOFF_IO_TIMEOUT_MS);
+
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return -1;
+        }
+        n = read(fd, buf + got, len - got);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Serve one takeover attempt.  Returns true once the peer acknowledged. */
+static bool serve_one(handoff_server_t *server, int conn) {
+    char greeting[sizeof(HANDOFF_GREETING) - 1];
+    char ack[sizeof(HANDOFF_ACK) - 1];
+    int fds[TNT_UNIX_MAX_FDS];
+    int count;
+
+    if (!tnt_unix_peer_is_self(conn)) {
+        fprintf(stderr, "Handoff refused: peer runs as another user\n");
+        return false;
+    }
+    if (read_exact(conn, greeting, sizeof(greeting)) < 0 ||
+        memcmp(greeting, HANDOFF_GREETING, sizeof(greeting)) != 0) {
+        fprintf(stderr, "Handoff refused: bad greeting\n");
+        return false;
+    }
+
+    count = server->export_fn(fds, TNT_UNIX_MAX_FDS, server->ctx);
+    if (count <= 0 || tnt_unix_send_fds(conn, fds, count) < 0) {
+        fprintf(stderr, "Handoff failed: could not send listeners\n");
+        return false;
+    }
+
+    /* Until the ack arrives the new process may still fail; keep serving. */
+    if (read_exact(conn, ack, sizeof(ack)) < 0 ||
+        memcmp(ack, HANDOFF_ACK, sizeof(ack)) != 0) {
+        fprintf(stderr, "Handoff aborted by the new process\n");
+        return false;
+    }
+    return true;
+}
+
+static void *handoff_thread(void *arg) {
+    handoff_server_t *server = arg;
+
+    while (1) {
+        int conn = tnt_unix_accept(server->listen_fd, "Handoff socket error");
+        bool done;
+
+        if (conn < 0) {
+            break;
+        }
+
+        done = serve_one(server, conn);
+        close(conn);
+        if (done) {
+            /* The socket path now belongs to the new process. */
+            close(server->listen_fd);
+            server->done_fn(server->ctx);
+            free(server);
+            return NULL;
+        }
+    }
+
+    close(server->listen_fd);
+    free(server);
+    return NULL;
+}
+
+int handoff_server_start(const char *path, handoff_export_fn export_fn,
+                         handoff_done_fn done_fn, void *ctx) {
+    handoff_server_t *server;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int rc;
+
+    if (!path || !export_fn || !done_fn) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    server = calloc(1, sizeof(*server));
+    if (!server) {
+        return -1;
+    }
+    server->listen_fd = tnt_unix_listen(path, 0600);
+    if (server->listen_fd < 0) {
+        int saved = errno;
+        free(server);
+        errno = saved;
+        return -1;
+    }
+    server->export_fn = export_fn;
+    server->done_fn = done_fn;
+    server->ctx = ctx;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create(&thread, &attr, handoff_thread, server);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        close(server->listen_fd);
+        unlink(path);
+        free(server);
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+int handoff_request(const char *path, int *fds, int max) {
+    int sock = tnt_unix_connect(path);
+    int count;
+
+    if (sock < 0) {
+        return -1;
+    }
+
+    if (write_all(sock, HANDOFF_GREETING, sizeof(HANDOFF_GREETING) - 1) < 0) {
+        close(sock);
+        return -1;
+    }
+    count = tnt_unix_recv_fds(sock, fds, max);
+    if (count <= 0) {
+        close(sock);
+        return -1;
+    }
+    if (write_all(sock, HANDOFF_ACK, sizeof(HANDOFF_ACK) - 1) < 0) {
+        for (int i = 0; i < count; i++) {
+            close(fds[i]);
+        }
+        close(sock);
+        return -1;
+    }
+    close(sock);
+    return count;
+}
@@ -33,6 +33,10 @@ static const i18n_string_t text_catalog[I18N_TEXT_COUNT] = {
         "Enter · Esc",
         "Enter · Esc"
     ),
+    [I18N_POST_THROTTLED_HINT] = I18N_STRING(
+        "Sending too fast · wait, then Enter again",
+        "发送过快 · 稍候再按 Enter"
+    ),
     [I18N_NORMAL_LATEST] = I18N_STRING(
         "G latest",
         "G 最新"
@@ -125,6 +129,10 @@ static const i18n_string_t text_catalog[I18N_TEXT_COUNT] = {
         "User '%s' not found\n",
         "未找到用户 '%s'\n"
     ),
+    [I18N_MSG_THROTTLED_FORMAT] = I18N_STRING(
+        "Sending too fast; private message to %s not sent\n",
+        "发送过快，未发送给 %s 的私信\n"
+    ),
     [I18N_REPLY_NO_TARGET] = I18N_STRING(
         "No private message to reply to\n",
         "没有可回复的私信\n"
@@ -259,6 +267,19 @@ static const i18n_string_t text_catalog[I18N_TEXT_COUNT] = {
         "post: failed to persist message\n",
         "post: 消息持久化失败\n"
     ),
+    [I18N_EXEC_POST_THROTTLED] = I18N_STRING(
+        "post: posting too fast, retry later\n",
+        "post: 发送过快，请稍后重试\n"
+    ),
+    [I18N_EXEC_LOCKS_LOCAL_ONLY] = I18N_STRING(
+        "locks: --on, --off and --reset need the control socket "
+        "(tntctl --local)\n",
+        "locks: --on、--off 和 --reset 需通过控制套接字（tntctl --local）\n"
+    ),
+    [I18N_EXEC_TRACE_LOCAL_ONLY] = I18N_STRING(
+        "trace: start and stop need the control socket (tntctl --local)\n",
+        "trace: start 和 stop 需通过控制套接字（tntctl --local）\n"
+    ),
     [I18N_EXEC_COMMAND_TOO_LONG] = I18N_STRING(
         "exec: command too long\n",
         "exec: 命令过长\n"
@@ -1,24 +1,28 @@
 #include "input.h"
+#include "capture.h"
 #include "chat_room.h"
 #include "client.h"
 #include "command_catalog.h"
 #include "commands.h"
 #include "config_defaults.h"
 #include "common.h"
-#include "exec.h"
 #include "history_view.h"
 #include "i18n.h"
 #include "input_buffer.h"
+#include "lock_profile.h"
 #include "message.h"
+#include "message_format.h"
+#include "metrics.h"
 #include "module_runtime.h"
+#include "post_limit.h"
 #include "ratelimit.h"
+#include "scratch.h"
 #include "system_message.h"
 #include "theme.h"
+#include "timer_wheel.h"
+#include "trace.h"
 #include "tui.h"
 #include "utf8.h"
-#include <libssh/callbacks.h>
-#include <libssh/libssh.h>
-#include <libssh/server.h>
 #include <strings.h>  /* strncasecmp */
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,13 +32,127 @@
 static int g_idle_timeout = TNT_DEFAULT_IDLE_TIMEOUT;
 static ui_lang_t g_default_ui_lang = UI_LANG_EN;
 
+/* Poll interval for sessions without a wake fd (client_wake_open()). */
 #define MAIN_LOOP_POLL_TIMEOUT_MS 250
+/* How often a busy session loop refreshes its CPU-time sample; it also
+ * samples before blocking. */
+#define SESSION_CPU_SAMPLE_MS 250
 
 void input_init(void) {
     g_idle_timeout = tnt_config_env_int(&TNT_CONFIG_IDLE_TIMEOUT);
     g_default_ui_lang = i18n_default_ui_lang();
 }
 
+/* Session deadlines live on the shared timer wheel.  Callbacks only set
+ * bits in client->timer_events and wake the session loop; the session
+ * thread acts on them, since libssh channels must not be touched from the
+ * timer thread. */
+static uint64_t session_now_ms(void) {
+    tnt_timer_wheel_t *wheel = tnt_timer_service();
+
+    return wheel ? tnt_timer_wheel_now_ms(wheel) : tnt_monotonic_ms();
+}
+
+static uint64_t session_idle_ms(client_t *client, uint64_t now_ms) {
+    uint64_t last = atomic_load_explicit(&client->last_active_ms,
+                                         memory_order_relaxed);
+
+    return now_ms > last ? now_ms - last : 0;
+}
+
+static uint64_t session_keepalive_fire(void *arg, uint64_t now_ms) {
+    client_t *client = arg;
+    uint64_t idle = session_idle_ms(client, now_ms);
+
+    if (idle < CLIENT_KEEPALIVE_INTERVAL_MS) {
+        return CLIENT_KEEPALIVE_INTERVAL_MS - idle;
+    }
+    atomic_fetch_or(&client->timer_events, CLIENT_TIMER_KEEPALIVE);
+    client_wake(client);
+    return CLIENT_KEEPALIVE_INTERVAL_MS;
+}
+
+/* One timer covers both idle deadlines; it sleeps until the nearer one. */
+static uint64_t session_idle_fire(void *arg, uint64_t now_ms) {
+    client_t *client = arg;
+    uint64_t idle = session_idle_ms(client, now_ms);
+    uint64_t trim_ms = (uint64_t)CLIENT_IDLE_TRIM_SECONDS * 1000u;
+    uint64_t next = trim_ms;
+
+    if (idle >= trim_ms) {
+        atomic_fetch_or(&client->timer_events, CLIENT_TIMER_IDLE_TRIM);
+        client_wake(client);
+    } else {
+        next = trim_ms - idle;
+    }
+
+    if (g_idle_timeout > 0) {
+        uint64_t timeout_ms = (uint64_t)g_idle_timeout * 1000u;
+        if (idle >= timeout_ms) {
+            atomic_fetch_or(&client->timer_events, CLIENT_TIMER_IDLE_TIMEOUT);
+            client_wake(client);
+            return timeout_ms;
+        }
+        if (timeout_ms - idle < next) {
+            next = timeout_ms - idle;
+        }
+    }
+
+    return next;
+}
+
+static uint64_t session_redraw_fire(void *arg, uint64_t now_ms) {
+    client_t *client = arg;
+
+    (void)now_ms;
+    atomic_fetch_or(&client->timer_events, CLIENT_TIMER_REDRAW);
+    client_wake(client);
+    return 0;
+}
+
+static void session_timers_start(client_t *client) {
+    tnt_timer_wheel_t *wheel = tnt_timer_service();
+    uint64_t idle_delay = (uint64_t)CLIENT_IDLE_TRIM_SECONDS * 1000u;
+
+    atomic_store(&client->last_active_ms, session_now_ms());
+    tnt_timer_init(&client->keepalive_timer, session_keepalive_fire, client);
+    tnt_timer_init(&client->idle_timer, session_idle_fire, client);
+    tnt_timer_init(&client->redraw_timer, session_redraw_fire, client);
+
+    if (g_idle_timeout > 0 &&
+        (uint64_t)g_idle_timeout * 1000u < idle_delay) {
+        idle_delay = (uint64_t)g_idle_timeout * 1000u;
+    }
+    tnt_timer_arm(wheel, &client->keepalive_timer,
+                  CLIENT_KEEPALIVE_INTERVAL_MS);
+    tnt_timer_arm(wheel, &client->idle_timer, idle_delay);
+}
+
+static void session_timers_stop(client_t *client) {
+    tnt_timer_wheel_t *wheel = tnt_timer_service();
+
+    tnt_timer_cancel(wheel, &client->keepalive_timer);
+    tnt_timer_cancel(wheel, &client->idle_timer);
+    tnt_timer_cancel(wheel, &client->redraw_timer);
+}
+
+/* Count input for `sessions` and hand it to TNT_CAPTURE. */
+static void session_note_input(client_t *client, const void *buf, int n) {
+    client_usage_add(client, CLIENT_USAGE_BYTES_RECEIVED, (uint64_t)n);
+    capture_session_input(&client->capture, client->mode, buf, (size_t)n);
+}
+
+/* Channel reads for this session. */
+static int session_read_timeout(client_t *client, void *buf, uint32_t len,
+                                int timeout_ms) {
+    int n = tnt_channel_read_timeout(&client->io, buf, len, timeout_ms);
+
+    if (n > 0) {
+        session_note_input(client, buf, n);
+    }
+    return n;
+}
+
 static int read_username(client_t *client) {
     char username[MAX_USERNAME_LEN] = {0};
     int pos = 0;
@@ -45,11 +163,11 @@ static int read_username(client_t *client) {
     client_printf(client, "%s", prompt);
 
     while (1) {
-        int n = ssh_channel_read_timeout(client->channel, buf, 1, 0, 60000); /* 60 sec timeout */
+        int n = session_read_timeout(client, buf, 1, 60000); /* 60 sec timeout */
 
-        if (n == SSH_AGAIN) {
+        if (n == TNT_CHANNEL_AGAIN) {
             /* Timeout */
-            if (!ssh_channel_is_open(client->channel)) {
+            if (!tnt_channel_is_open(&client->io)) {
                 return -1;
             }
             continue;
@@ -106,7 +224,7 @@ static int read_username(client_t *client) {
             }
             buf[0] = b;
             if (len > 1) {
-                int read_bytes = ssh_channel_read_timeout(client->channel, &buf[1], len - 1, 0, 5000);
+                int read_bytes = session_read_timeout(client, &buf[1], len - 1, 5000);
                 if (read_bytes != len - 1) {
                     /* Incomplete or timed-out UTF-8 continuation */
                     continue;
@@ -151,37 +269,18 @@ static int read_username(client_t *client) {
 }
 
 void notify_mentions(const char *content, const client_t *sender) {
-    pthread_rwlock_rdlock(&g_room->lock);
-    int count = g_room->client_count;
-    client_t **targets = NULL;
-    int target_count = 0;
-
-    if (count > 0) {
-        targets = calloc((size_t)count, sizeof(*targets));
-        if (!targets) {
-            pthread_rwlock_unlock(&g_room->lock);
-            return;
-        }
-    }
-
-    for (int i = 0; i < count; i++) {
+    /* Marking a mention is a few atomic stores, so it is done in place
+     * under the read lock; room members cannot be freed while it is held. */
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
+    for (int i = 0; i < g_room->client_count; i++) {
         client_t *c = g_room->clients[i];
         if (c == sender) continue;
-        char mention[MAX_USERNAME_LEN + 2];
-        snprintf(mention, sizeof(mention), "@%s", c->username);
-        if (strstr(content, mention) != NULL) {
-            client_addref(c);
-            targets[target_count++] = c;
+        if (message_mentions_user(content, c->username)) {
+            c->unread_mentions++;
+            client_queue_bell(c);
         }
     }
-    pthread_rwlock_unlock(&g_room->lock);
-
-    for (int i = 0; i < target_count; i++) {
-        targets[i]->unread_mentions++;
-        client_queue_bell(targets[i]);
-        client_release(targets[i]);
-    }
-    free(targets);
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
 }
 
 static int read_channel_exact(client_t *client, char *buf, size_t len,
@@ -189,9 +288,9 @@ static int read_channel_exact(client_t *client, char *buf, size_t len,
     size_t got = 0;
 
     while (got < len) {
-        int n = ssh_channel_read_timeout(client->channel, buf + got,
-                                         len - got, 0, timeout_ms);
-        if (n == SSH_AGAIN || n <= 0) {
+        int n = session_read_timeout(client, buf + got, len - got,
+                                     timeout_ms);
+        if (n == TNT_CHANNEL_AGAIN || n <= 0) {
             break;
         }
         got += (size_t)n;
@@ -206,13 +305,13 @@ static int normal_visible_message_count(const client_t *client) {
     }
 
     int count = 0;
-    pthread_rwlock_rdlock(&g_room->lock);
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
     for (int i = 0; i < g_room->message_count; i++) {
         if (!system_message_is_join_leave(&g_room->messages[i])) {
             count++;
         }
     }
-    pthread_rwlock_unlock(&g_room->lock);
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
     return count;
 }
 
@@ -244,7 +343,7 @@ static void dismiss_command_output(client_t *client) {
     if (!client) return;
 
     was_motd = client->show_motd;
-    client->command_output[0] = '\0';
+    client_set_command_output(client, NULL);
     client->command_output_scroll = 0;
     client->command_output_kind = TNT_COMMAND_OUTPUT_NONE;
     client->show_motd = false;
@@ -315,7 +414,7 @@ static pager_action_t pager_apply_key(client_t *client, unsigned char key,
         return PAGER_ACTION_REFRESH;
     } else if (key == 27) {
         char seq[3];
-        int n = ssh_channel_read_timeout(client->channel, seq, 1, 0, 50);
+        int n = session_read_timeout(client, seq, 1, 50);
         if (n != 1) {
             return PAGER_ACTION_CLOSE;
         }
@@ -323,7 +422,7 @@ static pager_action_t pager_apply_key(client_t *client, unsigned char key,
             return PAGER_ACTION_NONE;
         }
 
-        n = ssh_channel_read_timeout(client->channel, &seq[1], 1, 0, 50);
+        n = session_read_timeout(client, &seq[1], 1, 50);
         if (n != 1) {
             return PAGER_ACTION_NONE;
         }
@@ -341,7 +440,7 @@ static pager_action_t pager_apply_key(client_t *client, unsigned char key,
             *scroll_pos = 999;
             return PAGER_ACTION_SCROLL;
         } else if (seq[1] >= '1' && seq[1] <= '6') {
-            n = ssh_channel_read_timeout(client->channel, &seq[2], 1, 0, 50);
+            n = session_read_timeout(client, &seq[2], 1, 50);
             if (n == 1 && seq[2] == '~') {
                 if (seq[1] == '5') {        /* PageUp */
                     pager_scroll_by(scroll_pos, -page);
@@ -467,7 +566,8 @@ static void command_tab_complete(client_t *client) {
     }
 
     const char *cands[64];
-    char namebufs[64][MAX_USERNAME_LEN];
+    char (*namebufs)[MAX_USERNAME_LEN] = NULL;
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
     size_t ncand = 0;
 
     if (strcasecmp(cmd, "theme") == 0 || strcasecmp(cmd, "color") == 0) {
@@ -480,14 +580,18 @@ static void command_tab_complete(client_t *client) {
         cands[ncand++] = "en";
         cands[ncand++] = "zh";
     } else if (strcasecmp(cmd, "msg") == 0 || strcasecmp(cmd, "w") == 0) {
-        pthread_rwlock_rdlock(&g_room->lock);
+        namebufs = tnt_scratch_alloc(64 * sizeof(*namebufs));
+        if (!namebufs) {
+            return;
+        }
+        LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
         for (int i = 0; i < g_room->client_count && ncand < 64; i++) {
             snprintf(namebufs[ncand], MAX_USERNAME_LEN, "%s",
                      g_room->clients[i]->username);
             cands[ncand] = namebufs[ncand];
             ncand++;
         }
-        pthread_rwlock_unlock(&g_room->lock);
+        LOCK_PROFILE_RWUNLOCK(&g_room->lock);
     } else {
         return;
     }
@@ -498,11 +602,13 @@ static void command_tab_complete(client_t *client) {
                              sizeof(lcp));
     if (n == 0) {
         client_send(client, "\a", 1);
+        tnt_scratch_release(scratch);
         return;
     }
     if (n == 1) {
         snprintf(buf, cap, "%s %s ", cmd, out[0]);
         tui_render_command_input(client);
+        tnt_scratch_release(scratch);
         return;
     }
     if (strlen(lcp) > strlen(argregion)) {
@@ -511,6 +617,7 @@ static void command_tab_complete(client_t *client) {
     char hint[512];
     build_candidate_hint(hint, sizeof(hint), out, n, 12);
     tui_render_command_hint(client, hint);
+    tnt_scratch_release(scratch);
 }
 
 /* Handle a single key press.  Returns true if the key was fully consumed
@@ -524,7 +631,7 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
             tui_render_screen(client);
             return true;
         }
-        if (client->command_output[0] != '\0') {
+        if (client_has_command_output(client)) {
             dismiss_command_output(client);
             return true;
         }
@@ -566,7 +673,7 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
 
     /* Handle command output / MOTD display.  MOTD remains a simple notice;
      * command output behaves like a small pager so long results can be read. */
-    if (client->command_output[0] != '\0') {
+    if (client_has_command_output(client)) {
         pager_action_t action;
 
         if (client->show_motd) {
@@ -593,32 +700,32 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
         case MODE_INSERT:
             if (key == 27) {  /* ESC — may also be the start of an arrow seq */
                 char seq[2];
-                int n = ssh_channel_read_timeout(client->channel, seq, 1, 0, 50);
+                int n = session_read_timeout(client, seq, 1, 50);
                 if (n == 1 && seq[0] == '[') {
-                    n = ssh_channel_read_timeout(client->channel, &seq[1], 1, 0, 50);
+                    n = session_read_timeout(client, &seq[1], 1, 50);
                     if (n == 1) {
                         if (seq[1] == 'A') {  /* Up — walk back through sent history */
-                            if (client->insert_history_count > 0 &&
-                                client->insert_history_pos > 0) {
-                                client->insert_history_pos--;
+                            if (client->insert_history.count > 0 &&
+                                client->insert_history.pos > 0) {
+                                client->insert_history.pos--;
                                 strncpy(input,
-                                        client->insert_history[client->insert_history_pos],
+                                        client->insert_history.lines[client->insert_history.pos],
                                         MAX_MESSAGE_LEN - 1);
                                 input[MAX_MESSAGE_LEN - 1] = '\0';
                                 tui_render_input(client, input);
                             }
                             return true;
                         } else if (seq[1] == 'B') {  /* Down — walk forward */
-                            if (client->insert_history_pos <
-                                client->insert_history_count - 1) {
-                                client->insert_history_pos++;
+                            if (client->insert_history.pos <
+                                client->insert_history.count - 1) {
+                                client->insert_history.pos++;
                                 strncpy(input,
-                                        client->insert_history[client->insert_history_pos],
+                                        client->insert_history.lines[client->insert_history.pos],
                                         MAX_MESSAGE_LEN - 1);
                                 input[MAX_MESSAGE_LEN - 1] = '\0';
                             } else {
-                                client->insert_history_pos =
-                                    client->insert_history_count;
+                                client->insert_history.pos =
+                                    client->insert_history.count;
                                 input[0] = '\0';
                             }
                             tui_render_input(client, input);
@@ -640,8 +747,8 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
                                 tnt_input_utf8_state_t paste_utf8 = {0};
                                 while (1) {
                                     char b;
-                                    int k = ssh_channel_read_timeout(
-                                        client->channel, &b, 1, 0, 5000);
+                                    int k = session_read_timeout(
+                                        client, &b, 1, 5000);
                                     if (k != 1) break;
                                     if (b == '\033') {
                                         char tail[5];
@@ -706,19 +813,21 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
                 return true;
             } else if (key == '\r' || key == '\n') {  /* Enter */
                 if (input[0] != '\0') {
-                    /* Record into the per-client INSERT history ring */
-                    int max_hist = (int)(sizeof(client->insert_history) /
-                                         sizeof(client->insert_history[0]));
-                    if (client->insert_history_count >= max_hist) {
-                        memmove(&client->insert_history[0],
-                                &client->insert_history[1],
-                                (max_hist - 1) * sizeof(client->insert_history[0]));
-                        client->insert_history_count = max_hist - 1;
+                    if (!post_limit_allow(POST_KIND_PUBLIC, client->username,
+                                          client->client_ip)) {
+                        /* Keep the text so Enter can retry it */
+                        client->post_throttled = true;
+                        tui_render_screen(client);
+                        tui_render_input(client, input);
+                        client_send(client, "\a", 1);
+                        return true;
                     }
-                    snprintf(client->insert_history[client->insert_history_count],
-                             sizeof(client->insert_history[0]), "%s", input);
-                    client->insert_history_count++;
-                    client->insert_history_pos = client->insert_history_count;
+                    client->post_throttled = false;
+
+                    /* Record into the per-client INSERT history ring */
+                    tnt_line_history_push(&client->insert_history, input,
+                                          MAX_MESSAGE_LEN);
+                    client_note_history(client);
 
                     message_t msg = {
                         .timestamp = time(NULL),
@@ -784,7 +893,7 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
                     const char *prefix = input + at_idx + 1;
                     size_t plen = strlen(prefix);
                     char match[MAX_USERNAME_LEN] = "";
-                    pthread_rwlock_rdlock(&g_room->lock);
+                    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
                     for (int i = 0; i < g_room->client_count; i++) {
                         const char *uname = g_room->clients[i]->username;
                         if (plen == 0
@@ -794,7 +903,7 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
                             break;
                         }
                     }
-                    pthread_rwlock_unlock(&g_room->lock);
+                    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
                     if (match[0] != '\0') {
                         /* Replace "@<prefix>" with "@<match> " (trailing
                          * space so the next word starts cleanly). */
@@ -871,9 +980,9 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
                 return true;
             } else if (key == 27) {
                 char seq[4];
-                int n = ssh_channel_read_timeout(client->channel, seq, 1, 0, 50);
+                int n = session_read_timeout(client, seq, 1, 50);
                 if (n == 1 && seq[0] == '[') {
-                    n = ssh_channel_read_timeout(client->channel, &seq[1], 1, 0, 50);
+                    n = session_read_timeout(client, &seq[1], 1, 50);
                     if (n == 1) {
                         if (seq[1] == 'A') {          /* Up arrow */
                             normal_scroll_by(client, -1);
@@ -885,8 +994,7 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
                         } else if (seq[1] == 'F') {   /* End */
                             normal_scroll_to_latest(client);
                         } else if (seq[1] >= '1' && seq[1] <= '6') {
-                            n = ssh_channel_read_timeout(client->channel,
-                                                         &seq[2], 1, 0, 50);
+                            n = session_read_timeout(client, &seq[2], 1, 50);
                             if (n == 1 && seq[2] == '~') {
                                 if (seq[1] == '5') {        /* PageUp */
                                     normal_scroll_by(client, -nm_msg_height);
@@ -917,30 +1025,30 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
         case MODE_COMMAND:
             if (key == 27) {  /* ESC - check for arrow key sequences */
                 char seq[2];
-                int n = ssh_channel_read_timeout(client->channel, seq, 1, 0, 50);
+                int n = session_read_timeout(client, seq, 1, 50);
                 if (n == 1 && seq[0] == '[') {
-                    n = ssh_channel_read_timeout(client->channel, &seq[1], 1, 0, 50);
+                    n = session_read_timeout(client, &seq[1], 1, 50);
                     if (n == 1) {
                         if (seq[1] == 'A') {  /* Up arrow */
-                            if (client->command_history_count > 0 &&
-                                client->command_history_pos > 0) {
-                                client->command_history_pos--;
+                            if (client->command_history.count > 0 &&
+                                client->command_history.pos > 0) {
+                                client->command_history.pos--;
                                 strncpy(client->command_input,
-                                        client->command_history[client->command_history_pos],
+                                        client->command_history.lines[client->command_history.pos],
                                         sizeof(client->command_input) - 1);
                                 client->command_input[sizeof(client->command_input) - 1] = '\0';
                                 tui_render_command_input(client);
                             }
                             return true;
                         } else if (seq[1] == 'B') {  /* Down arrow */
-                            if (client->command_history_pos < client->command_history_count - 1) {
-                                client->command_history_pos++;
+                            if (client->command_history.pos < client->command_history.count - 1) {
+                                client->command_history.pos++;
                                 strncpy(client->command_input,
-                                        client->command_history[client->command_history_pos],
+                                        client->command_history.lines[client->command_history.pos],
                                         sizeof(client->command_input) - 1);
                                 client->command_input[sizeof(client->command_input) - 1] = '\0';
                             } else {
-                                client->command_history_pos = client->command_history_count;
+                                client->command_history.pos = client->command_history.count;
                                 client->command_input[0] = '\0';
                             }
                             tui_render_command_input(client);
@@ -986,50 +1094,102 @@ static bool handle_key(client_t *client, unsigned char key, char *input) {
     return false;  /* Key not consumed */
 }
 
+/* Load motd.txt into the pager.  Returns true when a MOTD was shown. */
+static bool show_motd_file(client_t *client) {
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    const size_t motd_size = MAX_COMMAND_OUTPUT_LEN - 64;
+    char *motd_path = tnt_scratch_alloc(PATH_MAX);
+    char *motd_buf = tnt_scratch_alloc(motd_size);
+    bool shown = false;
+
+    if (motd_path && motd_buf &&
+        tnt_state_path(motd_path, PATH_MAX, "motd.txt") == 0) {
+        FILE *motd_fp = fopen(motd_path, "r");
+        if (motd_fp) {
+            size_t motd_len = fread(motd_buf, 1, motd_size - 1, motd_fp);
+            fclose(motd_fp);
+            if (motd_len > 0) {
+                motd_buf[motd_len] = '\0';
+                client_set_command_output(client, motd_buf);
+                client->command_output_scroll = 0;
+                client->command_output_kind = TNT_COMMAND_OUTPUT_NONE;
+                client->show_motd = true;
+                tui_render_motd(client);
+                shown = true;
+            }
+        }
+    }
+
+    tnt_scratch_release(scratch);
+    return shown;
+}
+
+/* A frame showing room updates up to `upto_seq` was just queued: time
+ * broadcast -> queued for each update this client has not been timed on. */
+static void session_note_room_frame(client_t *client, uint64_t upto_seq) {
+    uint64_t stamps[ROOM_BROADCAST_STAMPS];
+    uint64_t now;
+    int count;
+
+    if (upto_seq <= client->latency_seen_seq) {
+        return;
+    }
+    count = room_broadcast_stamps(g_room, client->latency_seen_seq, upto_seq,
+                                  stamps, ROOM_BROADCAST_STAMPS);
+    client->latency_seen_seq = upto_seq;
+    if (count == 0) {
+        return;
+    }
+
+    now = metrics_now_us();
+    for (int i = 0; i < count; i++) {
+        metrics_observe(METRIC_HIST_DELIVERY_ENQUEUE_US,
+                        now > stamps[i] ? now - stamps[i] : 0);
+    }
+    client_note_room_frame(client, now, stamps[0]);
+}
+
 void input_run_session(client_t *client) {
     char input[MAX_MESSAGE_LEN] = {0};
     char buf[4];
     bool joined_room = false;
     bool bracketed_paste_enabled = false;
+    bool room_update_deferred = false;
+    bool input_pending = false;
     uint64_t seen_update_seq;
-    time_t last_keepalive = time(NULL);
+    uint64_t cpu_sampled_ms = 0;
+    uint64_t join_trace_us;
 
     /* Terminal size already set from PTY request */
     client->mode = MODE_INSERT;
     client->follow_tail = true;
     client->ui_lang = g_default_ui_lang;
     client->connected = true;
-    client->command_history_count = 0;
-    client->command_history_pos = 0;
     client->command_output_scroll = 0;
     client->command_output_kind = TNT_COMMAND_OUTPUT_NONE;
     client->connect_time = time(NULL);
-    client->last_active = time(NULL);
-
-    /* Check for exec command */
-    if (client->exec_command[0] != '\0' || client->exec_command_too_long) {
-        int exit_status = exec_dispatch(client);
-        ssh_channel_request_send_exit_status(client->channel, exit_status);
-        ssh_blocking_flush(client->session, 1000);
-        ssh_channel_send_eof(client->channel);
-        ssh_blocking_flush(client->session, 1000);
-        ssh_channel_close(client->channel);
-        ssh_blocking_flush(client->session, 1000);
-        goto cleanup;
-    }
+    capture_session_open(&client->capture, client->width, client->height);
 
     /* Read username */
     if (read_username(client) < 0) {
         goto cleanup;
     }
 
+    /* Without a wake fd the loop polls every MAIN_LOOP_POLL_TIMEOUT_MS. */
+    if (client->io.ops->wakeable && client_wake_open(client) < 0) {
+        fprintf(stderr, "Failed to create wake fd for %s, polling instead\n",
+                client->client_ip);
+    }
+
     /* Add to room */
+    join_trace_us = trace_begin();
     if (room_add_client(g_room, client) < 0) {
         client_printf(client, "%s", i18n_text(client->ui_lang,
                                               I18N_ROOM_FULL));
         goto cleanup;
     }
     joined_room = true;
+    session_timers_start(client);
 
     /* Enable xterm bracketed-paste mode only for interactive chat, so
      * multi-line pastes arrive framed by ESC[200~...ESC[201~ instead of
@@ -1042,56 +1202,56 @@ void input_run_session(client_t *client) {
     system_message_make_join(&join_msg, client->username, client->ui_lang);
     room_broadcast(g_room, &join_msg);
     message_save(&join_msg);
+    trace_end(TRACE_EV_ROOM_JOIN, join_trace_us, 0);
 
     /* Show MOTD if motd.txt exists in state directory */
-    {
-        char motd_path[PATH_MAX];
-        if (tnt_state_path(motd_path, sizeof(motd_path), "motd.txt") == 0) {
-            FILE *motd_fp = fopen(motd_path, "r");
-            if (motd_fp) {
-                char motd_buf[sizeof(client->command_output) - 64];
-                size_t motd_len = fread(motd_buf, 1, sizeof(motd_buf) - 1, motd_fp);
-                fclose(motd_fp);
-                if (motd_len > 0) {
-                    motd_buf[motd_len] = '\0';
-                    snprintf(client->command_output,
-                             sizeof(client->command_output),
-                             "%s", motd_buf);
-                    client->command_output_scroll = 0;
-                    client->command_output_kind = TNT_COMMAND_OUTPUT_NONE;
-                    client->show_motd = true;
-                    tui_render_motd(client);
-                    seen_update_seq = room_get_update_seq(g_room);
-                    goto main_loop;
-                }
-            }
-        }
+    if (show_motd_file(client)) {
+        seen_update_seq = room_get_update_seq(g_room);
+        client->latency_seen_seq = seen_update_seq;
+        goto main_loop;
     }
 
     /* Render initial screen */
     tui_render_screen(client);
     seen_update_seq = room_get_update_seq(g_room);
+    client->latency_seen_seq = seen_update_seq;
 
 main_loop:
 
     /* Main input loop */
-    while (client->connected && ssh_channel_is_open(client->channel)) {
+    while (client->connected && tnt_channel_is_open(&client->io)) {
+        uint64_t loop_ms = session_now_ms();
+        int poll_ms = MAIN_LOOP_POLL_TIMEOUT_MS;
+
+        /* Timers, broadcasts and bells wake the poll, so it can block.
+         * After input, one non-blocking pass runs the idle branch first. */
+        if (client->wake_open) {
+            poll_ms = input_pending ? 0 : -1;
+        }
+
+        if (poll_ms < 0 || loop_ms - cpu_sampled_ms >= SESSION_CPU_SAMPLE_MS) {
+            client_sample_cpu(client);
+            cpu_sampled_ms = loop_ms;
+        }
+
         if (client_flush_output(client) != 0) {
             break;
         }
 
-        int ready = ssh_channel_poll_timeout(client->channel,
-                                             MAIN_LOOP_POLL_TIMEOUT_MS, 0);
+        int ready = tnt_channel_poll_timeout(&client->io, poll_ms);
 
-        if (ready == SSH_ERROR) {
+        if (ready == TNT_CHANNEL_ERROR) {
             break;
         }
 
         if (ready == 0) {
             bool room_updated = false;
+            bool redraw_due;
             uint64_t current_update_seq = room_get_update_seq(g_room);
+            unsigned int events = atomic_exchange(&client->timer_events, 0);
 
-            if (!ssh_channel_is_open(client->channel)) {
+            input_pending = false;
+            if (!tnt_channel_is_open(&client->io)) {
                 break;
             }
 
@@ -1106,45 +1266,73 @@ main_loop:
             if (current_update_seq != seen_update_seq) {
                 seen_update_seq = current_update_seq;
                 room_updated = true;
+                /* Updates that arrive behind help or the pager are not
+                 * delivered to the screen, so they are not timed. */
+                if (client->show_help || client_has_command_output(client)) {
+                    client->latency_seen_seq = current_update_seq;
+                }
             }
 
             if (client->command_output_kind == TNT_COMMAND_OUTPUT_INBOX &&
-                client->command_output[0] != '\0' &&
+                client_has_command_output(client) &&
                 client->unread_whispers > 0) {
                 commands_refresh_active_output(client);
                 client->redraw_pending = true;
             }
 
-            if (client->redraw_pending ||
-                (room_updated && !client->show_help &&
-                 client->command_output[0] == '\0')) {
+            redraw_due = client->redraw_pending ||
+                         (events & CLIENT_TIMER_REDRAW) ||
+                         (room_updated && !client->show_help &&
+                          !client_has_command_output(client));
+
+            /* Bursts of room updates redraw at most once per interval;
+             * the wheel brings the deferred redraw back. */
+            if (redraw_due && !client->redraw_pending &&
+                !(events & CLIENT_TIMER_REDRAW)) {
+                uint64_t now_ms = session_now_ms();
+                if (now_ms - client->last_redraw_ms <
+                    CLIENT_REDRAW_MIN_INTERVAL_MS) {
+                    tnt_timer_arm(tnt_timer_service(), &client->redraw_timer,
+                                  CLIENT_REDRAW_MIN_INTERVAL_MS -
+                                  (now_ms - client->last_redraw_ms));
+                    room_update_deferred |= room_updated;
+                    redraw_due = false;
+                }
+            }
+
+            if (redraw_due) {
                 client->redraw_pending = false;
+                client->last_redraw_ms = session_now_ms();
+                room_update_deferred = false;
 
                 if (client->show_help) {
                     tui_render_help(client);
                 } else if (client->show_motd) {
                     tui_render_motd(client);
-                } else if (client->command_output[0] != '\0') {
+                } else if (client_has_command_output(client)) {
                     tui_render_command_output(client);
                 } else {
-                    if (room_updated && client->mode == MODE_NORMAL &&
-                        client->follow_tail) {
+                    if ((room_updated || room_update_deferred) &&
+                        client->mode == MODE_NORMAL && client->follow_tail) {
                         normal_scroll_to_latest(client);
                     }
                     tui_render_screen(client);
                     if (client->mode == MODE_INSERT && input[0] != '\0') {
                         tui_render_input(client, input);
                     }
+                    session_note_room_frame(client, current_update_seq);
                 }
-            } else if (time(NULL) - last_keepalive >= 15) {
-                if (ssh_send_keepalive(client->session) != SSH_OK) {
+            } else if (events & CLIENT_TIMER_KEEPALIVE) {
+                if (tnt_channel_keepalive(&client->io) != 0) {
                     break;
                 }
-                last_keepalive = time(NULL);
             }
 
-            if (g_idle_timeout > 0 && joined_room &&
-                time(NULL) - client->last_active >= g_idle_timeout) {
+            if ((events & CLIENT_TIMER_IDLE_TRIM) && !client->memory_trimmed) {
+                client_trim_idle_memory(client);
+            }
+
+            if (events & CLIENT_TIMER_IDLE_TIMEOUT) {
                 client_printf(client,
                               i18n_text(client->ui_lang,
                                         I18N_IDLE_TIMEOUT_FORMAT),
@@ -1154,15 +1342,21 @@ main_loop:
             continue;
         }
 
-        int n = ssh_channel_read(client->channel, buf, 1, 0);
+        int n = tnt_channel_read(&client->io, buf, 1);
 
         if (n <= 0) {
             /* EOF or error */
             break;
         }
+        session_note_input(client, buf, n);
+        input_pending = true;
 
-        last_keepalive = time(NULL);
-        client->last_active = last_keepalive;
+        atomic_store_explicit(&client->last_active_ms, session_now_ms(),
+                              memory_order_relaxed);
+        atomic_fetch_and(&client->timer_events,
+                         ~(unsigned int)(CLIENT_TIMER_IDLE_TRIM |
+                                         CLIENT_TIMER_IDLE_TIMEOUT));
+        client->memory_trimmed = false;
 
         unsigned char b = buf[0];
 
@@ -1173,7 +1367,7 @@ main_loop:
         if (!key_consumed) {
             /* Add character to input (INSERT mode only) */
             if (client->mode == MODE_INSERT && !client->show_help &&
-                client->command_output[0] == '\0') {
+                !client_has_command_output(client)) {
                 if (b >= 32 && b < 127) {  /* ASCII printable */
                     int status = tnt_input_append_ascii(input,
                                                         MAX_MESSAGE_LEN, b);
@@ -1190,7 +1384,7 @@ main_loop:
                     }
                     buf[0] = b;
                     if (char_len > 1) {
-                        int read_bytes = ssh_channel_read_timeout(client->channel, &buf[1], char_len - 1, 0, 5000);
+                        int read_bytes = session_read_timeout(client, &buf[1], char_len - 1, 5000);
                         if (read_bytes != char_len - 1) {
                             /* Incomplete or timed-out UTF-8 continuation */
                             continue;
@@ -1210,7 +1404,7 @@ main_loop:
                     }
                 }
             } else if (client->mode == MODE_COMMAND && !client->show_help &&
-                       client->command_output[0] == '\0') {
+                       !client_has_command_output(client)) {
                 if (b >= 32 && b < 127) {  /* ASCII printable */
                     int status = tnt_input_append_ascii(
                         client->command_input, sizeof(client->command_input),
@@ -1225,8 +1419,8 @@ main_loop:
                     if (char_len <= 0 || char_len > 4) continue;
                     buf[0] = b;
                     if (char_len > 1) {
-                        int read_bytes = ssh_channel_read_timeout(
-                            client->channel, &buf[1], char_len - 1, 0, 5000);
+                        int read_bytes = session_read_timeout(
+                            client, &buf[1], char_len - 1, 5000);
                         if (read_bytes != char_len - 1) continue;
                     }
                     if (!utf8_is_valid_sequence(buf, char_len)) continue;
@@ -1244,8 +1438,10 @@ main_loop:
     }
 
 cleanup:
-    if (bracketed_paste_enabled && client->channel &&
-        ssh_channel_is_open(client->channel)) {
+    session_timers_stop(client);
+    capture_session_close(&client->capture);
+
+    if (bracketed_paste_enabled && tnt_channel_is_open(&client->io)) {
         client_send(client, "\033[?2004l", 8);
     }
 
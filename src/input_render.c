@@ -0,0 +1,108 @@
+#include "input_render.h"
+#include "utf8.h"
+
+/* Columns used by the "› " prompt plus the cell the cursor rests on. */
+#define INPUT_RENDER_PROMPT_COLS 3
+
+static int input_render_avail(int cols) {
+    int avail = cols - INPUT_RENDER_PROMPT_COLS;
+    return avail < 1 ? 1 : avail;
+}
+
+void tnt_input_render_reset(tnt_input_render_state_t *state) {
+    if (!state) return;
+    state->valid = false;
+    state->shown_len = 0;
+    state->shown_width = 0;
+    state->shown[0] = '\0';
+}
+
+bool tnt_input_render_wants_gauge(size_t input_len) {
+    return input_len > (MAX_MESSAGE_LEN * 8) / 10;
+}
+
+tnt_input_render_plan_t tnt_input_render_plan(
+    const tnt_input_render_state_t *state, const char *input,
+    size_t input_len, int cols, int rows) {
+    tnt_input_render_plan_t plan = { TNT_INPUT_RENDER_FULL, 0, 0 };
+
+    if (!state || !state->valid || !input || state->cols != cols ||
+        state->rows != rows || tnt_input_render_wants_gauge(input_len)) {
+        return plan;
+    }
+
+    if (input_len >= state->shown_len) {
+        if (memcmp(input, state->shown, state->shown_len) != 0) {
+            return plan;
+        }
+        if (input_len == state->shown_len) {
+            plan.op = TNT_INPUT_RENDER_UNCHANGED;
+            return plan;
+        }
+
+        int added = utf8_string_width(input + state->shown_len);
+        if (state->shown_width + added > input_render_avail(cols)) {
+            return plan;
+        }
+        plan.op = TNT_INPUT_RENDER_APPEND;
+        plan.offset = state->shown_len;
+        plan.width = added;
+        return plan;
+    }
+
+    if (memcmp(input, state->shown, input_len) != 0) {
+        return plan;
+    }
+
+    plan.op = TNT_INPUT_RENDER_ERASE;
+    plan.offset = input_len;
+    plan.width = utf8_string_width(state->shown + input_len);
+    return plan;
+}
+
+void tnt_input_render_apply(tnt_input_render_state_t *state,
+                            const tnt_input_render_plan_t *plan,
+                            const char *input, size_t input_len) {
+    if (!state || !plan) return;
+
+    switch (plan->op) {
+        case TNT_INPUT_RENDER_APPEND:
+            memcpy(state->shown + state->shown_len, input + state->shown_len,
+                   input_len - state->shown_len);
+            state->shown_len = input_len;
+            state->shown[input_len] = '\0';
+            state->shown_width += plan->width;
+            break;
+        case TNT_INPUT_RENDER_ERASE:
+            state->shown_len = plan->offset;
+            state->shown[plan->offset] = '\0';
+            state->shown_width -= plan->width;
+            break;
+        case TNT_INPUT_RENDER_FULL:
+            tnt_input_render_reset(state);
+            break;
+        case TNT_INPUT_RENDER_UNCHANGED:
+            break;
+    }
+}
+
+void tnt_input_render_full(tnt_input_render_state_t *state, const char *input,
+                           size_t input_len, int input_width, int cols,
+                           int rows) {
+    if (!state) return;
+
+    if (!input || input_len >= sizeof(state->shown) ||
+        tnt_input_render_wants_gauge(input_len) ||
+        input_width > input_render_avail(cols)) {
+        tnt_input_render_reset(state);
+        return;
+    }
+
+    memcpy(state->shown, input, input_len);
+    state->shown[input_len] = '\0';
+    state->shown_len = input_len;
+    state->shown_width = input_width;
+    state->cols = cols;
+    state->rows = rows;
+    state->valid = true;
+}
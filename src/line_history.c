@@ -0,0 +1,58 @@
+#include "line_history.h"
+
+int tnt_line_history_push(tnt_line_history_t *history, const char *line,
+                          size_t max_len) {
+    if (!history || !line || max_len == 0) return -1;
+
+    size_t len = strlen(line);
+    if (len >= max_len) {
+        len = max_len - 1;
+        /* Do not split a UTF-8 sequence at the cut. */
+        while (len > 0 && ((unsigned char)line[len] & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+
+    if (history->count >= TNT_LINE_HISTORY_SIZE) {
+        free(history->lines[0]);
+        memmove(&history->lines[0], &history->lines[1],
+                (TNT_LINE_HISTORY_SIZE - 1) * sizeof(history->lines[0]));
+        history->count = TNT_LINE_HISTORY_SIZE - 1;
+    }
+
+    history->lines[history->count++] = copy;
+    history->pos = history->count;
+    return 0;
+}
+
+const char *tnt_line_history_get(const tnt_line_history_t *history,
+                                 int index) {
+    if (!history || index < 0 || index >= history->count) return NULL;
+    return history->lines[index];
+}
+
+void tnt_line_history_clear(tnt_line_history_t *history) {
+    if (!history) return;
+
+    for (int i = 0; i < history->count; i++) {
+        free(history->lines[i]);
+        history->lines[i] = NULL;
+    }
+    history->count = 0;
+    history->pos = 0;
+}
+
+size_t tnt_line_history_bytes(const tnt_line_history_t *history) {
+    size_t total = 0;
+
+    if (!history) return 0;
+    for (int i = 0; i < history->count; i++) {
+        total += strlen(history->lines[i]) + 1;
+    }
+    return total;
+}
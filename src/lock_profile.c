@@ -0,0 +1,345 @@
+#include "lock_profile.h"
+#include "common.h"
+#include <string.h>
+#include <time.h>
+
+#define LOCK_PROFILE_BUCKETS 16    /* <=1us, <=2us, ... <=16384us, more */
+#define LOCK_PROFILE_MAX_HELD 8    /* Nested profiled locks per thread */
+#define LOCK_PROFILE_SITES 256     /* Power of two */
+#define LOCK_PROFILE_TOP_SITES 10
+
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_us;
+    _Atomic uint64_t max_us;
+    _Atomic uint64_t buckets[LOCK_PROFILE_BUCKETS];
+} lock_hist_t;
+
+typedef struct {
+    _Atomic uint64_t reads;
+    _Atomic uint64_t writes;
+    lock_hist_t wait;
+    lock_hist_t hold;
+} lock_stats_t;
+
+typedef struct {
+    _Atomic(const char *) site;
+    _Atomic int lock_id;
+    _Atomic uint64_t count;
+    _Atomic uint64_t wait_us;
+    _Atomic uint64_t wait_max_us;
+    _Atomic uint64_t hold_us;
+} lock_site_t;
+
+typedef struct {
+    const void *lock;
+    const char *site;
+    lock_id_t id;
+    uint64_t acquired_us;
+} lock_held_t;
+
+atomic_bool g_lock_profile_enabled = false;
+_Thread_local int t_lock_profile_depth = 0;
+
+static lock_stats_t g_lock_stats[LOCK_ID_COUNT];
+static lock_site_t g_sites[LOCK_PROFILE_SITES];
+static _Atomic uint64_t g_sites_dropped;
+static _Thread_local lock_held_t t_held[LOCK_PROFILE_MAX_HELD];
+
+static const char *const g_lock_names[LOCK_ID_COUNT] = {
+    "room", "message_file"
+};
+
+void lock_profile_set_enabled(bool enabled) {
+    atomic_store(&g_lock_profile_enabled, enabled);
+}
+
+bool lock_profile_enabled(void) {
+    return atomic_load(&g_lock_profile_enabled);
+}
+
+uint64_t lock_profile_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void atomic_max(_Atomic uint64_t *slot, uint64_t value) {
+    uint64_t seen = atomic_load_explicit(slot, memory_order_relaxed);
+
+    while (value > seen &&
+           !atomic_compare_exchange_weak_explicit(slot, &seen, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+static void hist_record(lock_hist_t *hist, uint64_t us) {
+    size_t bucket = 0;
+
+    while (bucket < LOCK_PROFILE_BUCKETS - 1 && us > (1ull << bucket)) {
+        bucket++;
+    }
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_us, us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->buckets[bucket], 1, memory_order_relaxed);
+    atomic_max(&hist->max_us, us);
+}
+
+/* Find or claim the slot for `site`.  Sites are string literals, so the
+ * pointer is the key. */
+static lock_site_t *site_slot(const char *site, lock_id_t id) {
+    size_t start = ((uintptr_t)site >> 3) * 0x9e3779b97f4a7c15ULL >> 56;
+
+    for (size_t i = 0; i < LOCK_PROFILE_SITES; i++) {
+        lock_site_t *slot = &g_sites[(start + i) & (LOCK_PROFILE_SITES - 1)];
+        const char *seen = atomic_load_explicit(&slot->site,
+                                                memory_order_acquire);
+
+        if (seen == site) {
+            return slot;
+        }
+        if (!seen) {
+            if (atomic_compare_exchange_strong(&slot->site, &seen, site)) {
+                atomic_store(&slot->lock_id, (int)id);
+                return slot;
+            }
+            if (seen == site) {
+                return slot;
+            }
+        }
+    }
+    atomic_fetch_add_explicit(&g_sites_dropped, 1, memory_order_relaxed);
+    return NULL;
+}
+
+void lock_profile_acquired(lock_id_t id, bool write, const void *lock,
+                           const char *site, uint64_t wait_start_us) {
+    uint64_t now = lock_profile_now_us();
+    uint64_t wait = now - wait_start_us;
+    lock_stats_t *stats;
+    lock_site_t *slot;
+
+    if ((unsigned)id >= LOCK_ID_COUNT) {
+        return;
+    }
+    stats = &g_lock_stats[id];
+    atomic_fetch_add_explicit(write ? &stats->writes : &stats->reads, 1,
+                              memory_order_relaxed);
+    hist_record(&stats->wait, wait);
+
+    slot = site_slot(site, id);
+    if (slot) {
+        atomic_fetch_add_explicit(&slot->count, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&slot->wait_us, wait, memory_order_relaxed);
+        atomic_max(&slot->wait_max_us, wait);
+    }
+
+    if (t_lock_profile_depth < LOCK_PROFILE_MAX_HELD) {
+        t_held[t_lock_profile_depth++] = (lock_held_t){
+            .lock = lock, .site = site, .id = id, .acquired_us = now,
+        };
+    }
+}
+
+void lock_profile_released(const void *lock) {
+    for (int i = t_lock_profile_depth - 1; i >= 0; i--) {
+        lock_held_t held = t_held[i];
+        uint64_t hold;
+        lock_site_t *slot;
+
+        if (held.lock != lock) {
+            continue;
+        }
+        memmove(&t_held[i], &t_held[i + 1],
+                (size_t)(t_lock_profile_depth - i - 1) * sizeof(t_held[0]));
+        t_lock_profile_depth--;
+
+        hold = lock_profile_now_us() - held.acquired_us;
+        hist_record(&g_lock_stats[held.id].hold, hold);
+        slot = site_slot(held.site, held.id);
+        if (slot) {
+            atomic_fetch_add_explicit(&slot->hold_us, hold,
+                                      memory_order_relaxed);
+        }
+        return;
+    }
+}
+
+void lock_profile_reset(void) {
+    for (size_t i = 0; i < LOCK_ID_COUNT; i++) {
+        lock_hist_t *hists[2] = {&g_lock_stats[i].wait, &g_lock_stats[i].hold};
+
+        atomic_store(&g_lock_stats[i].reads, 0);
+        atomic_store(&g_lock_stats[i].writes, 0);
+        for (size_t h = 0; h < 2; h++) {
+            atomic_store(&hists[h]->count, 0);
+            atomic_store(&hists[h]->sum_us, 0);
+            atomic_store(&hists[h]->max_us, 0);
+            for (size_t b = 0; b < LOCK_PROFILE_BUCKETS; b++) {
+                atomic_store(&hists[h]->buckets[b], 0);
+            }
+        }
+    }
+    for (size_t i = 0; i < LOCK_PROFILE_SITES; i++) {
+        atomic_store(&g_sites[i].count, 0);
+        atomic_store(&g_sites[i].wait_us, 0);
+        atomic_store(&g_sites[i].wait_max_us, 0);
+        atomic_store(&g_sites[i].hold_us, 0);
+        atomic_store(&g_sites[i].site, NULL);
+    }
+    atomic_store(&g_sites_dropped, 0);
+}
+
+/* Upper bound of the bucket holding quantile `q` (percent); 0 if empty. */
+static uint64_t hist_quantile(const lock_hist_t *hist, unsigned q) {
+    uint64_t count = atomic_load(&hist->count);
+    uint64_t rank;
+    uint64_t seen = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+    rank = (count * q + 99) / 100;
+    for (size_t b = 0; b < LOCK_PROFILE_BUCKETS - 1; b++) {
+        seen += atomic_load(&hist->buckets[b]);
+        if (seen >= rank) {
+            return 1ull << b;
+        }
+    }
+    return atomic_load(&hist->max_us);
+}
+
+/* Indices of up to LOCK_PROFILE_TOP_SITES sites, most total wait first. */
+static size_t top_sites(size_t out[LOCK_PROFILE_TOP_SITES]) {
+    size_t found = 0;
+
+    while (found < LOCK_PROFILE_TOP_SITES) {
+        size_t best = LOCK_PROFILE_SITES;
+        uint64_t best_wait = 0;
+
+        for (size_t i = 0; i < LOCK_PROFILE_SITES; i++) {
+            uint64_t wait = atomic_load(&g_sites[i].wait_us);
+            bool taken = false;
+
+            if (!atomic_load(&g_sites[i].site) ||
+                atomic_load(&g_sites[i].count) == 0) {
+                continue;
+            }
+            for (size_t k = 0; k < found; k++) {
+                taken = taken || out[k] == i;
+            }
+            if (!taken && (best == LOCK_PROFILE_SITES || wait > best_wait)) {
+                best = i;
+                best_wait = wait;
+            }
+        }
+        if (best == LOCK_PROFILE_SITES) {
+            break;
+        }
+        out[found++] = best;
+    }
+    return found;
+}
+
+static const char *site_lock_name(const lock_site_t *site) {
+    int id = atomic_load(&site->lock_id);
+
+    return id >= 0 && id < LOCK_ID_COUNT ? g_lock_names[id] : "unknown";
+}
+
+void lock_profile_append_text(char *buffer, size_t buf_size, size_t *pos) {
+    size_t top[LOCK_PROFILE_TOP_SITES];
+    size_t count = top_sites(top);
+
+    buffer_appendf(buffer, buf_size, pos, "lock_profile %s\n",
+                   lock_profile_enabled() ? "on" : "off");
+    for (size_t i = 0; i < LOCK_ID_COUNT; i++) {
+        const lock_stats_t *s = &g_lock_stats[i];
+
+        buffer_appendf(
+            buffer, buf_size, pos,
+            "lock %s reads %llu writes %llu "
+            "wait_us_total %llu wait_us_p50 %llu wait_us_p99 %llu "
+            "wait_us_max %llu hold_us_total %llu hold_us_p50 %llu "
+            "hold_us_p99 %llu hold_us_max %llu\n",
+            g_lock_names[i], (unsigned long long)atomic_load(&s->reads),
+            (unsigned long long)atomic_load(&s->writes),
+            (unsigned long long)atomic_load(&s->wait.sum_us),
+            (unsigned long long)hist_quantile(&s->wait, 50),
+            (unsigned long long)hist_quantile(&s->wait, 99),
+            (unsigned long long)atomic_load(&s->wait.max_us),
+            (unsigned long long)atomic_load(&s->hold.sum_us),
+            (unsigned long long)hist_quantile(&s->hold, 50),
+            (unsigned long long)hist_quantile(&s->hold, 99),
+            (unsigned long long)atomic_load(&s->hold.max_us));
+    }
+    for (size_t i = 0; i < count; i++) {
+        const lock_site_t *site = &g_sites[top[i]];
+
+        buffer_appendf(buffer, buf_size, pos,
+                       "site %s %s acquisitions %llu wait_us_total %llu "
+                       "wait_us_max %llu hold_us_total %llu\n",
+                       atomic_load(&site->site), site_lock_name(site),
+                       (unsigned long long)atomic_load(&site->count),
+                       (unsigned long long)atomic_load(&site->wait_us),
+                       (unsigned long long)atomic_load(&site->wait_max_us),
+                       (unsigned long long)atomic_load(&site->hold_us));
+    }
+}
+
+static void append_hist_json(char *buffer, size_t buf_size, size_t *pos,
+                             const char *name, const lock_hist_t *hist) {
+    buffer_appendf(buffer, buf_size, pos,
+                   "\"%s\":{\"count\":%llu,\"total\":%llu,\"max\":%llu,"
+                   "\"p50\":%llu,\"p99\":%llu,\"buckets\":[",
+                   name, (unsigned long long)atomic_load(&hist->count),
+                   (unsigned long long)atomic_load(&hist->sum_us),
+                   (unsigned long long)atomic_load(&hist->max_us),
+                   (unsigned long long)hist_quantile(hist, 50),
+                   (unsigned long long)hist_quantile(hist, 99));
+    for (size_t b = 0; b < LOCK_PROFILE_BUCKETS; b++) {
+        buffer_appendf(buffer, buf_size, pos, "%s%llu", b ? "," : "",
+                       (unsigned long long)atomic_load(&hist->buckets[b]));
+    }
+    buffer_appendf(buffer, buf_size, pos, "]}");
+}
+
+void lock_profile_append_json(char *buffer, size_t buf_size, size_t *pos) {
+    size_t top[LOCK_PROFILE_TOP_SITES];
+    size_t count = top_sites(top);
+
+    buffer_appendf(buffer, buf_size, pos, "{\"enabled\":%s,\"locks\":[",
+                   lock_profile_enabled() ? "true" : "false");
+    for (size_t i = 0; i < LOCK_ID_COUNT; i++) {
+        const lock_stats_t *s = &g_lock_stats[i];
+
+        buffer_appendf(buffer, buf_size, pos,
+                       "%s{\"name\":\"%s\",\"reads\":%llu,\"writes\":%llu,",
+                       i ? "," : "", g_lock_names[i],
+                       (unsigned long long)atomic_load(&s->reads),
+                       (unsigned long long)atomic_load(&s->writes));
+        append_hist_json(buffer, buf_size, pos, "wait_us", &s->wait);
+        buffer_appendf(buffer, buf_size, pos, ",");
+        append_hist_json(buffer, buf_size, pos, "hold_us", &s->hold);
+        buffer_appendf(buffer, buf_size, pos, "}");
+    }
+    buffer_appendf(buffer, buf_size, pos, "],\"sites\":[");
+    for (size_t i = 0; i < count; i++) {
+        const lock_site_t *site = &g_sites[top[i]];
+
+        buffer_appendf(buffer, buf_size, pos,
+                       "%s{\"site\":\"%s\",\"lock\":\"%s\","
+                       "\"acquisitions\":%llu,\"wait_us_total\":%llu,"
+                       "\"wait_us_max\":%llu,\"hold_us_total\":%llu}",
+                       i ? "," : "", atomic_load(&site->site),
+                       site_lock_name(site),
+                       (unsigned long long)atomic_load(&site->count),
+                       (unsigned long long)atomic_load(&site->wait_us),
+                       (unsigned long long)atomic_load(&site->wait_max_us),
+                       (unsigned long long)atomic_load(&site->hold_us));
+    }
+    buffer_appendf(buffer, buf_size, pos, "],\"sites_dropped\":%llu}\n",
+                   (unsigned long long)atomic_load(&g_sites_dropped));
+}
@@ -1,12 +1,20 @@
+#include "capture.h"
 #include "chat_room.h"
 #include "cli_text.h"
+#include "client.h"
 #include "config_defaults.h"
 #include "common.h"
+#include "control.h"
+#include "exec.h"
 #include "i18n.h"
 #include "message.h"
 #include "message_log_tool.h"
+#include "metrics.h"
+#include "metrics_http.h"
 #include "module_runtime.h"
+#include "ssh_profile.h"
 #include "ssh_server.h"
+#include <errno.h>
 #include <signal.h>
 #include <unistd.h>
 
@@ -21,6 +29,106 @@ static void signal_handler(int sig) {
     _exit(0);
 }
 
+/* Control-socket commands run through the same exec dispatcher as SSH
+ * exec sessions, with the client's login as the post identity. */
+static int run_control_command(const char *login, const char *command,
+                               control_write_fn write_fn, void *sink,
+                               void *ctx) {
+    exec_context_t exec_ctx = {
+        .write = write_fn,
+        .sink = sink,
+        .lang = i18n_default_ui_lang(),
+        .login = login,
+        .sender = NULL,
+        .local = true,
+    };
+
+    (void)ctx;
+    return exec_run(&exec_ctx, command);
+}
+
+static int start_control_socket(void) {
+    char path[PATH_MAX] = CONTROL_SOCKET_FILE;
+
+    if (!tnt_config_env_int(&TNT_CONFIG_CONTROL_SOCKET)) {
+        return 0;
+    }
+    if (tnt_state_path(path, sizeof(path), CONTROL_SOCKET_FILE) < 0 ||
+        control_server_start(path, run_control_command, NULL) < 0) {
+        fprintf(stderr, "Failed to open control socket %s: %s\n", path,
+                strerror(errno));
+        return -1;
+    }
+    printf("Control socket: %s\n", path);
+    return 0;
+}
+
+/* The metrics endpoint reads the same counters as `stats` without going
+ * through an SSH session. */
+static int serve_metrics(const char *path, char *body, size_t body_size,
+                         size_t *body_len, void *ctx) {
+    size_t pos = 0;
+
+    (void)ctx;
+    body[0] = '\0';
+    if (strcmp(path, "/health") == 0) {
+        buffer_appendf(body, body_size, &pos, "ok\n");
+    } else if (strcmp(path, "/metrics") == 0) {
+        exec_stats_t stats;
+        metrics_snapshot_t snap;
+
+        exec_stats_collect(&stats);
+        exec_stats_append_metrics(&stats, body, body_size, &pos);
+        metrics_snapshot(&snap);
+        metrics_append_prometheus(&snap, body, body_size, &pos);
+    } else {
+        return 404;
+    }
+    *body_len = pos;
+    return 200;
+}
+
+/* After --takeover the replaced server releases the metrics address from
+ * its handoff thread, which may lag our bind by a moment. */
+#define METRICS_TAKEOVER_RETRY_MS 5000
+#define METRICS_TAKEOVER_RETRY_STEP_MS 100
+
+static int start_metrics_endpoint(void) {
+    const char *spec = getenv("TNT_METRICS_LISTEN");
+    int waited_ms = 0;
+
+    if (!spec || spec[0] == '\0') {
+        return 0;
+    }
+    while (metrics_http_start(spec, serve_metrics, NULL) < 0) {
+        struct timespec step = { 0, METRICS_TAKEOVER_RETRY_STEP_MS * 1000000L };
+
+        if (errno != EADDRINUSE || !ssh_server_took_over() ||
+            waited_ms >= METRICS_TAKEOVER_RETRY_MS) {
+            return -1;
+        }
+        nanosleep(&step, NULL);
+        waited_ms += METRICS_TAKEOVER_RETRY_STEP_MS;
+    }
+    printf("Metrics endpoint: %s (port %d)\n", spec,
+           metrics_http_bound_port());
+    return 0;
+}
+
+/* Control socket and metrics endpoint.  After a takeover both are still
+ * attempted when one fails. */
+static int start_local_endpoints(void) {
+    int rc = start_control_socket();
+
+    if (rc < 0 && !ssh_server_took_over()) {
+        return -1;
+    }
+    if (start_metrics_endpoint() < 0) {
+        rc = -1;
+    }
+    return rc;
+}
+
 static bool is_config_token(const char *value) {
     const unsigned char *p = (const unsigned char *)value;
 
@@ -174,6 +282,50 @@ int main(int argc, char **argv) {
                 return rc;
             }
             i++;
+        } else if (strcmp(argv[i], "--session-stack-kb") == 0) {
+            if (!require_option_arg(argc, argv, i, lang)) {
+                return TNT_EXIT_USAGE;
+            }
+            int rc = set_numeric_env_option(&TNT_CONFIG_SESSION_STACK_KB,
+                                            argv[i], argv[i + 1], lang);
+            if (rc != TNT_EXIT_OK) {
+                return rc;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--acceptors") == 0) {
+            if (!require_option_arg(argc, argv, i, lang)) {
+                return TNT_EXIT_USAGE;
+            }
+            int rc = set_numeric_env_option(&TNT_CONFIG_ACCEPTORS,
+                                            argv[i], argv[i + 1], lang);
+            if (rc != TNT_EXIT_OK) {
+                return rc;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--takeover") == 0) {
+            if (set_env_option("TNT_TAKEOVER", "1") != 0) {
+                return TNT_EXIT_ERROR;
+            }
+        } else if (strcmp(argv[i], "--metrics-listen") == 0) {
+            char host[256];
+            int metrics_port;
+            if (!require_option_arg(argc, argv, i, lang)) {
+                return TNT_EXIT_USAGE;
+            }
+            if (metrics_http_parse_listen(argv[i + 1], host, sizeof(host),
+                                          &metrics_port) < 0) {
+                fprintf(stderr, cli_text_invalid_value_format(lang),
+                        argv[i], argv[i + 1]);
+                return TNT_EXIT_USAGE;
+            }
+            if (set_env_option("TNT_METRICS_LISTEN", argv[i + 1]) != 0) {
+                return TNT_EXIT_ERROR;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--control-socket") == 0) {
+            if (set_env_option("TNT_CONTROL_SOCKET", "1") != 0) {
+                return TNT_EXIT_ERROR;
+            }
         } else if (strcmp(argv[i], "--ssh-log-level") == 0) {
             if (!require_option_arg(argc, argv, i, lang)) {
                 return TNT_EXIT_USAGE;
@@ -184,6 +336,34 @@ int main(int argc, char **argv) {
                 return rc;
             }
             i++;
+        } else if (strcmp(argv[i], "--host-keys") == 0) {
+            unsigned int required;
+            unsigned int optional;
+            if (!require_option_arg(argc, argv, i, lang)) {
+                return TNT_EXIT_USAGE;
+            }
+            if (!tnt_host_keys_parse(argv[i + 1], &required, &optional)) {
+                fprintf(stderr, cli_text_invalid_value_format(lang),
+                        argv[i], argv[i + 1]);
+                return TNT_EXIT_USAGE;
+            }
+            if (set_env_option("TNT_HOST_KEYS", argv[i + 1]) != 0) {
+                return TNT_EXIT_ERROR;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--ssh-profile") == 0) {
+            if (!require_option_arg(argc, argv, i, lang)) {
+                return TNT_EXIT_USAGE;
+            }
+            if (!tnt_ssh_profile_find(argv[i + 1])) {
+                fprintf(stderr, cli_text_invalid_value_format(lang),
+                        argv[i], argv[i + 1]);
+                return TNT_EXIT_USAGE;
+            }
+            if (set_env_option("TNT_SSH_PROFILE", argv[i + 1]) != 0) {
+                return TNT_EXIT_ERROR;
+            }
+            i++;
         } else if (strcmp(argv[i], "--log-check") == 0) {
             if (i + 1 >= argc || argv[i + 1][0] == '\0') {
                 fprintf(stderr, cli_text_option_requires_arg_format(lang),
@@ -202,7 +382,7 @@ int main(int argc, char **argv) {
             printf("tnt %s\n", TNT_VERSION);
             return TNT_EXIT_OK;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
-            char output[2048] = {0};
+            char output[4096] = {0};
             size_t pos = 0;
 
             cli_text_append_help(output, sizeof(output), &pos, argv[0], lang);
@@ -251,6 +431,7 @@ int main(int argc, char **argv) {
         tnt_module_runtime_shutdown();
         return TNT_EXIT_ERROR;
     }
+    g_room->wake_client = client_wake;
 
     /* Initialize server */
     if (ssh_server_init(port) < 0) {
@@ -260,9 +441,23 @@ int main(int argc, char **argv) {
         return TNT_EXIT_ERROR;
     }
 
+    if (start_local_endpoints() < 0) {
+        /* The replaced server already stopped accepting; exiting now would
+         * take the SSH port down with us. */
+        if (ssh_server_took_over()) {
+            fprintf(stderr, "Warning: listeners were taken over; continuing "
+                            "without the endpoint above\n");
+        } else {
+            tnt_module_runtime_shutdown();
+            room_destroy(g_room);
+            return TNT_EXIT_ERROR;
+        }
+    }
+
     /* Start server (blocking) */
     int ret = ssh_server_start(0);
 
+    capture_shutdown();
     tnt_module_runtime_shutdown();
     room_destroy(g_room);
     return ret;
@@ -6,7 +6,11 @@
 #endif
 
 #include "message.h"
+#include "lock_profile.h"
 #include "message_log.h"
+#include "metrics.h"
+#include "scratch.h"
+#include "trace.h"
 #include "utf8.h"
 #include <errno.h>
 #include <unistd.h>
@@ -14,6 +18,18 @@
 
 static pthread_mutex_t g_message_file_lock = PTHREAD_MUTEX_INITIALIZER;
 
+#define CHUNK_SIZE 4096
+
+/* Path and line buffers for log I/O.  These run on session threads, so they
+ * come from the per-thread scratch arena rather than the stack. */
+typedef struct {
+    char log_path[PATH_MAX];
+    char backup_path[PATH_MAX + 4];
+    char line[MESSAGE_LOG_MAX_LINE];
+    char chunk[CHUNK_SIZE];
+    char record[MAX_USERNAME_LEN + MAX_MESSAGE_LEN + 48];
+} message_io_scratch_t;
+
 static void discard_line_remainder(FILE *fp) {
     int c;
 
@@ -68,8 +84,9 @@ void message_init(void) {
 /* Load messages from log file - Optimized for large files.
  * Holds g_message_file_lock for the duration of the read so concurrent
  * message_save() calls from chat threads cannot interleave a partial line. */
-int message_load(message_t **messages, int max_messages) {
-    char log_path[PATH_MAX];
+static int load_messages(message_io_scratch_t *io, message_t **messages,
+                         int max_messages) {
+    char *log_path = io ? io->log_path : NULL;
 
     /* Always allocate the message array */
     message_t *msg_array = calloc(max_messages, sizeof(message_t));
@@ -77,17 +94,17 @@ int message_load(message_t **messages, int max_messages) {
         return 0;
     }
 
-    if (tnt_state_path(log_path, sizeof(log_path), LOG_FILE) < 0) {
+    if (!io || tnt_state_path(log_path, sizeof(io->log_path), LOG_FILE) < 0) {
         *messages = msg_array;
         return 0;
     }
 
-    pthread_mutex_lock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_LOCK(&g_message_file_lock, LOCK_ID_MESSAGE_FILE);
 
     FILE *fp = fopen(log_path, "r");
     if (!fp) {
         /* File doesn't exist yet, no messages */
-        pthread_mutex_unlock(&g_message_file_lock);
+        LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
         *messages = msg_array;
         return 0;
     }
@@ -95,7 +112,7 @@ int message_load(message_t **messages, int max_messages) {
     /* Seek to end */
     if (fseek(fp, 0, SEEK_END) != 0) {
         fclose(fp);
-        pthread_mutex_unlock(&g_message_file_lock);
+        LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
         *messages = msg_array;
         return 0;
     }
@@ -103,7 +120,7 @@ int message_load(message_t **messages, int max_messages) {
     long file_size = ftell(fp);
     if (file_size <= 0) {
         fclose(fp);
-        pthread_mutex_unlock(&g_message_file_lock);
+        LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
         *messages = msg_array;
         return 0;
     }
@@ -121,9 +138,8 @@ int message_load(message_t **messages, int max_messages) {
     }
 
     /* Read backwards in chunks for performance */
-    #define CHUNK_SIZE 4096
-    char chunk[CHUNK_SIZE];
-    
+    char *chunk = io->chunk;
+
     while (pos >= 0 && newlines_found < max_messages) {
         long read_size = (pos >= CHUNK_SIZE) ? CHUNK_SIZE : (pos + 1);
         long read_pos = pos - read_size + 1;
@@ -152,15 +168,15 @@ int message_load(message_t **messages, int max_messages) {
     fseek(fp, 0, SEEK_SET);
 
 read_messages:;
-    char line[MESSAGE_LOG_MAX_LINE];
+    char *line = io->line;
     int count = 0;
     time_t now = time(NULL);
 
     /* Now read forward */
-    while (fgets(line, sizeof(line), fp) && count < max_messages) {
+    while (fgets(line, sizeof(io->line), fp) && count < max_messages) {
         /* Check for oversized lines */
         size_t line_len = strlen(line);
-        if (line_len >= sizeof(line) - 1 && line[line_len - 1] != '\n') {
+        if (line_len >= sizeof(io->line) - 1 && line[line_len - 1] != '\n') {
             discard_line_remainder(fp);
             continue;
         }
@@ -174,28 +190,36 @@ read_messages:;
     }
 
     fclose(fp);
-    pthread_mutex_unlock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
     *messages = msg_array;
     return count;
 }
 
+int message_load(message_t **messages, int max_messages) {
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    int count = load_messages(tnt_scratch_alloc(sizeof(message_io_scratch_t)),
+                              messages, max_messages);
+
+    tnt_scratch_release(scratch);
+    return count;
+}
+
 /* Save a message to log file */
-int message_save(const message_t *msg) {
-    char log_path[PATH_MAX];
+static int save_message(message_io_scratch_t *io, const message_t *msg) {
+    char *log_path = io ? io->log_path : NULL;
     message_t safe_msg;
-    char record[MAX_USERNAME_LEN + MAX_MESSAGE_LEN + 48];
     size_t record_len = 0;
     int rc = 0;
 
-    if (tnt_state_path(log_path, sizeof(log_path), LOG_FILE) < 0) {
+    if (!io || tnt_state_path(log_path, sizeof(io->log_path), LOG_FILE) < 0) {
         return -1;
     }
 
-    pthread_mutex_lock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_LOCK(&g_message_file_lock, LOCK_ID_MESSAGE_FILE);
 
     FILE *fp = fopen(log_path, "a");
     if (!fp) {
-        pthread_mutex_unlock(&g_message_file_lock);
+        LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
         return -1;
     }
 
@@ -219,9 +243,9 @@ int message_save(const message_t *msg) {
         }
     }
 
-    if (message_log_format_record(&safe_msg, record, sizeof(record),
+    if (message_log_format_record(&safe_msg, io->record, sizeof(io->record),
                                   &record_len) < 0 ||
-        fwrite(record, 1, record_len, fp) != record_len ||
+        fwrite(io->record, 1, record_len, fp) != record_len ||
         fflush(fp) != 0) {
         rc = -1;
     }
@@ -231,44 +255,59 @@ int message_save(const message_t *msg) {
     fclose(fp);
 
     if (file_size > MAX_LOG_SIZE) {
-        char backup_path[PATH_MAX + 4];
-        snprintf(backup_path, sizeof(backup_path), "%s.1", log_path);
-        rename(log_path, backup_path);
+        snprintf(io->backup_path, sizeof(io->backup_path), "%s.1", log_path);
+        rename(log_path, io->backup_path);
     }
 
-    pthread_mutex_unlock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
+    return rc;
+}
+
+int message_save(const message_t *msg) {
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    uint64_t start_us = metrics_now_us();
+    uint64_t trace_us = trace_begin();
+    int rc = save_message(tnt_scratch_alloc(sizeof(message_io_scratch_t)),
+                          msg);
+
+    trace_end(TRACE_EV_MESSAGE_SAVE, trace_us, 0);
+    metrics_observe(METRIC_HIST_MESSAGE_SAVE_US, metrics_now_us() - start_us);
+    metrics_inc(rc == 0 ? METRIC_MESSAGES_POSTED
+                        : METRIC_MESSAGE_SAVE_FAILURES);
+    tnt_scratch_release(scratch);
     return rc;
 }
 
 /* Search log file for messages whose username or content contains query.
  * Case-insensitive. Returns the last max_results matches (most recent); caller frees *results. */
-int message_search(const char *query, message_t **results, int max_results) {
-    char log_path[PATH_MAX];
+static int search_messages(message_io_scratch_t *io, const char *query,
+                           message_t **results, int max_results) {
+    char *log_path = io ? io->log_path : NULL;
 
     message_t *res = calloc(max_results, sizeof(message_t));
     if (!res) return 0;
 
-    if (!query || query[0] == '\0' ||
-        tnt_state_path(log_path, sizeof(log_path), LOG_FILE) < 0) {
+    if (!io || !query || query[0] == '\0' ||
+        tnt_state_path(log_path, sizeof(io->log_path), LOG_FILE) < 0) {
         *results = res;
         return 0;
     }
 
-    pthread_mutex_lock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_LOCK(&g_message_file_lock, LOCK_ID_MESSAGE_FILE);
     FILE *fp = fopen(log_path, "r");
     if (!fp) {
-        pthread_mutex_unlock(&g_message_file_lock);
+        LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
         *results = res;
         return 0;
     }
 
-    char line[MESSAGE_LOG_MAX_LINE];
+    char *line = io->line;
     int count = 0;
     time_t now = time(NULL);
 
-    while (fgets(line, sizeof(line), fp)) {
+    while (fgets(line, sizeof(io->line), fp)) {
         size_t line_len = strlen(line);
-        if (line_len >= sizeof(line) - 1 && line[line_len - 1] != '\n') {
+        if (line_len >= sizeof(io->line) - 1 && line[line_len - 1] != '\n') {
             discard_line_remainder(fp);
             continue;
         }
@@ -288,13 +327,23 @@ int message_search(const char *query, message_t **results, int max_results) {
     }
 
     fclose(fp);
-    pthread_mutex_unlock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
     *results = res;
     return (count < max_results) ? count : max_results;
 }
 
-int message_dump_text(char **output, size_t *output_len, int max_records) {
-    char log_path[PATH_MAX];
+int message_search(const char *query, message_t **results, int max_results) {
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    int count = search_messages(tnt_scratch_alloc(sizeof(message_io_scratch_t)),
+                                query, results, max_results);
+
+    tnt_scratch_release(scratch);
+    return count;
+}
+
+static int dump_messages(message_io_scratch_t *io, char **output,
+                         size_t *output_len, int max_records) {
+    char *log_path = io ? io->log_path : NULL;
     char *buf = NULL;
     size_t capacity = 0;
     size_t len = 0;
@@ -312,7 +361,7 @@ int message_dump_text(char **output, size_t *output_len, int max_records) {
     }
     *output_len = 0;
 
-    if (tnt_state_path(log_path, sizeof(log_path), LOG_FILE) < 0) {
+    if (!io || tnt_state_path(log_path, sizeof(io->log_path), LOG_FILE) < 0) {
         free(*output);
         *output = NULL;
         return -1;
@@ -327,11 +376,11 @@ int message_dump_text(char **output, size_t *output_len, int max_records) {
         }
     }
 
-    pthread_mutex_lock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_LOCK(&g_message_file_lock, LOCK_ID_MESSAGE_FILE);
     FILE *fp = fopen(log_path, "r");
     if (!fp) {
         int saved_errno = errno;
-        pthread_mutex_unlock(&g_message_file_lock);
+        LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
         free(ring);
         if (saved_errno != ENOENT) {
             free(*output);
@@ -341,11 +390,11 @@ int message_dump_text(char **output, size_t *output_len, int max_records) {
         return 0;
     }
 
-    char line[MESSAGE_LOG_MAX_LINE];
+    char *line = io->line;
     time_t now = time(NULL);
-    while (fgets(line, sizeof(line), fp)) {
+    while (fgets(line, sizeof(io->line), fp)) {
         size_t line_len = strlen(line);
-        if (line_len >= sizeof(line) - 1 && line[line_len - 1] != '\n') {
+        if (line_len >= sizeof(io->line) - 1 && line[line_len - 1] != '\n') {
             discard_line_remainder(fp);
             continue;
         }
@@ -366,7 +415,7 @@ int message_dump_text(char **output, size_t *output_len, int max_records) {
     }
 
     fclose(fp);
-    pthread_mutex_unlock(&g_message_file_lock);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_message_file_lock);
 
     if (rc == 0 && max_records > 0 && seen > 0) {
         int count = seen < max_records ? seen : max_records;
@@ -405,6 +454,15 @@ int message_dump_text(char **output, size_t *output_len, int max_records) {
     return 0;
 }
 
+int message_dump_text(char **output, size_t *output_len, int max_records) {
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    int rc = dump_messages(tnt_scratch_alloc(sizeof(message_io_scratch_t)),
+                           output, output_len, max_records);
+
+    tnt_scratch_release(scratch);
+    return rc;
+}
+
 /* Format a message for display */
 void message_format(const message_t *msg, char *buffer, size_t buf_size, int width) {
     struct tm tm_info;
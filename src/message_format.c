@@ -0,0 +1,137 @@
+#include "message_format.h"
+#include "system_message.h"
+#include "utf8.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const char *username_color(const char *name) {
+    static const char *colors[] = {
+        "\033[31m", "\033[32m", "\033[33m",
+        "\033[34m", "\033[35m", "\033[36m",
+    };
+    unsigned int h = 5381;
+    for (const char *p = name; *p; p++)
+        h = h * 33 + (unsigned char)*p;
+    return colors[h % 6];
+}
+
+bool message_mentions_user(const char *content, const char *username) {
+    char mention[MAX_USERNAME_LEN + 2];
+
+    if (!content || !username || username[0] == '\0') {
+        return false;
+    }
+    snprintf(mention, sizeof(mention), "@%s", username);
+    return strstr(content, mention) != NULL;
+}
+
+void message_format_colored(const message_t *msg, char *buffer,
+                            size_t buf_size, int width,
+                            const char *my_username, const theme_t *theme) {
+    struct tm tm_info;
+    localtime_r(&msg->timestamp, &tm_info);
+    char time_str[32];
+    strftime(time_str, sizeof(time_str), "%H:%M", &tm_info);
+
+    /* Is this message from the local user?  Used to draw a 1-column gutter
+     * marker so they can scan their own contributions when scrolling. */
+    bool is_self = false;
+    if (my_username && my_username[0] != '\0' &&
+        !system_message_is_system(msg)) {
+        if (strcmp(msg->username, "*") == 0) {
+            /* /me message: content starts with the actor's username */
+            size_t un_len = strlen(my_username);
+            if (strncmp(msg->content, my_username, un_len) == 0 &&
+                (msg->content[un_len] == ' ' || msg->content[un_len] == '\0')) {
+                is_self = true;
+            }
+        } else if (strcmp(msg->username, my_username) == 0) {
+            is_self = true;
+        }
+    }
+    /* Always 1 column wide so all messages align vertically.  The self-marker
+     * uses the viewer's accent theme. */
+    char gutter_buf[32];
+    const char *gutter;
+    if (is_self) {
+        snprintf(gutter_buf, sizeof(gutter_buf), "%s▎\033[0m", theme->accent);
+        gutter = gutter_buf;
+    } else {
+        gutter = " ";
+    }
+
+    bool mentioned = my_username && !system_message_is_system(msg) &&
+                     message_mentions_user(msg->content, my_username);
+    const char *hl_start = mentioned ? "\033[1;33m" : "";
+    const char *hl_end = mentioned ? "\033[0m" : "";
+
+    if (system_message_is_system(msg)) {
+        snprintf(buffer, buf_size,
+                 "%s\033[90m--> %s\033[0m", gutter, msg->content);
+    } else if (strcmp(msg->username, "*") == 0) {
+        snprintf(buffer, buf_size,
+                 "%s\033[90m%s\033[0m %s* %s\033[0m",
+                 gutter, time_str, theme->accent_italic, msg->content);
+    } else {
+        snprintf(buffer, buf_size,
+                 "%s\033[90m%s\033[0m %s%s\033[0m: %s%s%s",
+                 gutter, time_str, username_color(msg->username),
+                 msg->username, hl_start, msg->content, hl_end);
+    }
+
+    /* Plain-text version for width calculation — gutter is 1 column. */
+    char plain[MAX_MESSAGE_LEN + 128];
+    if (system_message_is_system(msg)) {
+        snprintf(plain, sizeof(plain), " --> %s", msg->content);
+    } else if (strcmp(msg->username, "*") == 0) {
+        snprintf(plain, sizeof(plain), " %s * %s", time_str, msg->content);
+    } else {
+        snprintf(plain, sizeof(plain), " %s %s: %s",
+                 time_str, msg->username, msg->content);
+    }
+
+    if (utf8_string_width(plain) > width) {
+        /* Rebuild with truncated content — prefix_plain also includes the
+         * 1-column gutter so the budget math comes out right. */
+        int prefix_width;
+        char prefix_plain[256];
+        if (system_message_is_system(msg)) {
+            snprintf(prefix_plain, sizeof(prefix_plain), " --> ");
+        } else if (strcmp(msg->username, "*") == 0) {
+            snprintf(prefix_plain, sizeof(prefix_plain), " %s * ", time_str);
+        } else {
+            snprintf(prefix_plain, sizeof(prefix_plain), " %s %s: ",
+                     time_str, msg->username);
+        }
+        prefix_width = utf8_string_width(prefix_plain);
+        int content_width = width - prefix_width;
+        if (content_width < 4) content_width = 4;
+
+        char truncated_content[MAX_MESSAGE_LEN + 2]; /* room for "* " */
+        if (system_message_is_system(msg)) {
+            strncpy(truncated_content, msg->content, sizeof(truncated_content) - 1);
+            truncated_content[sizeof(truncated_content) - 1] = '\0';
+        } else if (strcmp(msg->username, "*") == 0) {
+            snprintf(truncated_content, sizeof(truncated_content), "* %s", msg->content);
+        } else {
+            strncpy(truncated_content, msg->content, sizeof(truncated_content) - 1);
+            truncated_content[sizeof(truncated_content) - 1] = '\0';
+        }
+        utf8_truncate(truncated_content, content_width);
+
+        if (system_message_is_system(msg)) {
+            snprintf(buffer, buf_size,
+                     "%s\033[90m--> %s\033[0m", gutter, truncated_content);
+        } else if (strcmp(msg->username, "*") == 0) {
+            snprintf(buffer, buf_size,
+                     "%s\033[90m%s\033[0m %s%s\033[0m",
+                     gutter, time_str, theme->accent_italic, truncated_content);
+        } else {
+            snprintf(buffer, buf_size,
+                     "%s\033[90m%s\033[0m %s%s\033[0m: %s%s%s",
+                     gutter, time_str, username_color(msg->username),
+                     msg->username, hl_start, truncated_content, hl_end);
+        }
+    }
+}
@@ -0,0 +1,351 @@
+#include "metrics.h"
+#include "common.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+#define METRICS_SHARDS 16          /* Power of two */
+
+typedef struct {
+    const char *name;              /* Prometheus name */
+    const char *label;             /* `key="value"` or NULL */
+    const char *json;              /* JSON key */
+    const char *help;              /* Printed once per name */
+} metric_desc_t;
+
+typedef struct {
+    const char *name;
+    const char *json;
+    const char *help;
+    uint64_t bounds[METRICS_HIST_BOUNDS];
+} hist_desc_t;
+
+/* Entries sharing a name must be adjacent. */
+static const metric_desc_t g_counter_desc[METRIC_COUNTER_COUNT] = {
+    [METRIC_MESSAGES_POSTED] = {
+        "tnt_messages_posted_total", NULL, "messages_posted",
+        "Messages persisted to the log."},
+    [METRIC_MESSAGES_BROADCAST] = {
+        "tnt_messages_broadcast_total", NULL, "messages_broadcast",
+        "Messages added to the room for fanout."},
+    [METRIC_MESSAGE_SAVE_FAILURES] = {
+        "tnt_message_save_failures_total", NULL, "message_save_failures",
+        "Messages that could not be persisted."},
+    [METRIC_CLIENT_BYTES_QUEUED] = {
+        "tnt_client_bytes_queued_total", NULL, "client_bytes_queued",
+        "Bytes queued to client outboxes."},
+    [METRIC_CLIENT_BYTES_FLUSHED] = {
+        "tnt_client_bytes_flushed_total", NULL, "client_bytes_flushed",
+        "Bytes written from client outboxes to SSH channels."},
+    [METRIC_CLIENT_SEND_FAILURES] = {
+        "tnt_client_send_failures_total", NULL, "client_send_failures",
+        "Client sends that failed and disconnected the client."},
+    [METRIC_CONN_REJECTED_TABLE_FULL] = {
+        "tnt_connections_rejected_total", "reason=\"table_full\"",
+        "connections_rejected_table_full",
+        "Connections refused by the connection limiter."},
+    [METRIC_CONN_REJECTED_PER_IP] = {
+        "tnt_connections_rejected_total", "reason=\"per_ip\"",
+        "connections_rejected_per_ip", NULL},
+    [METRIC_CONN_REJECTED_BLOCKED] = {
+        "tnt_connections_rejected_total", "reason=\"blocked\"",
+        "connections_rejected_blocked", NULL},
+    [METRIC_CONN_REJECTED_RATE] = {
+        "tnt_connections_rejected_total", "reason=\"rate\"",
+        "connections_rejected_rate", NULL},
+    [METRIC_CONN_REJECTED_GLOBAL] = {
+        "tnt_connections_rejected_total", "reason=\"global\"",
+        "connections_rejected_global", NULL},
+    [METRIC_AUTH_FAILURE_BLOCKS] = {
+        "tnt_auth_failure_blocks_total", NULL, "auth_failure_blocks",
+        "IPs blocked after repeated authentication failures."},
+    [METRIC_MODULE_EVENTS_DROPPED] = {
+        "tnt_module_events_dropped_total", NULL, "module_events_dropped",
+        "Module events dropped because the queue was full."},
+    [METRIC_MODULE_RESPONSES_DROPPED] = {
+        "tnt_module_responses_dropped_total", NULL, "module_responses_dropped",
+        "Module responses dropped as invalid or over the response limit."},
+};
+
+static const metric_desc_t g_gauge_desc[METRIC_GAUGE_COUNT] = {
+    [METRIC_GAUGE_OUTBOX_HIGH_WATER] = {
+        "tnt_client_outbox_high_water_bytes", NULL, "client_outbox_high_water",
+        "Largest client outbox backlog seen."},
+    [METRIC_GAUGE_MODULE_QUEUE_DEPTH] = {
+        "tnt_module_queue_depth", NULL, "module_queue_depth",
+        "Module events waiting to be delivered."},
+};
+
+static const hist_desc_t g_hist_desc[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_MESSAGE_SAVE_US] = {
+        "tnt_message_save_seconds", "message_save_us",
+        "Time to persist one message.",
+        {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000, 250000}},
+    [METRIC_HIST_RENDER_US] = {
+        "tnt_render_seconds", "render_us",
+        "Time to build and queue one full-screen frame.",
+        {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 50000, 250000}},
+    [METRIC_HIST_RENDER_BYTES] = {
+        "tnt_render_frame_bytes", "render_bytes",
+        "Bytes in one full-screen frame.",
+        {256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072,
+         262144, 524288}},
+    [METRIC_HIST_DELIVERY_ENQUEUE_US] = {
+        "tnt_delivery_enqueue_seconds", "delivery_enqueue_us",
+        "Time from room broadcast to a recipient frame being queued.",
+        {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+         250000, 1000000}},
+    [METRIC_HIST_DELIVERY_FLUSH_US] = {
+        "tnt_delivery_flush_seconds", "delivery_flush_us",
+        "Time from a frame being queued to the outbox draining.",
+        {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+         250000, 1000000}},
+};
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t counters[METRIC_COUNTER_COUNT];
+    struct {
+        _Atomic uint64_t buckets[METRICS_HIST_BOUNDS + 1];
+        _Atomic uint64_t sum;
+    } hists[METRIC_HIST_COUNT];
+} metrics_shard_t;
+
+static metrics_shard_t g_shards[METRICS_SHARDS];
+static _Atomic uint64_t g_gauges[METRIC_GAUGE_COUNT];
+static atomic_uint g_next_shard;
+static _Thread_local metrics_shard_t *t_shard;
+
+static metrics_shard_t *metrics_shard(void) {
+    if (!t_shard) {
+        unsigned index = atomic_fetch_add_explicit(&g_next_shard, 1,
+                                                   memory_order_relaxed);
+        t_shard = &g_shards[index & (METRICS_SHARDS - 1)];
+    }
+    return t_shard;
+}
+
+void metrics_add(metric_counter_t id, uint64_t n) {
+    if ((unsigned)id >= METRIC_COUNTER_COUNT) {
+        return;
+    }
+    atomic_fetch_add_explicit(&metrics_shard()->counters[id], n,
+                              memory_order_relaxed);
+}
+
+void metrics_gauge_set(metric_gauge_t id, uint64_t value) {
+    if ((unsigned)id >= METRIC_GAUGE_COUNT) {
+        return;
+    }
+    atomic_store_explicit(&g_gauges[id], value, memory_order_relaxed);
+}
+
+void metrics_gauge_max(metric_gauge_t id, uint64_t value) {
+    uint64_t seen;
+
+    if ((unsigned)id >= METRIC_GAUGE_COUNT) {
+        return;
+    }
+    seen = atomic_load_explicit(&g_gauges[id], memory_order_relaxed);
+    while (value > seen &&
+           !atomic_compare_exchange_weak_explicit(&g_gauges[id], &seen, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void metrics_observe(metric_hist_t id, uint64_t value) {
+    const uint64_t *bounds;
+    metrics_shard_t *shard;
+    size_t bucket = 0;
+
+    if ((unsigned)id >= METRIC_HIST_COUNT) {
+        return;
+    }
+    bounds = g_hist_desc[id].bounds;
+    while (bucket < METRICS_HIST_BOUNDS && value > bounds[bucket]) {
+        bucket++;
+    }
+    shard = metrics_shard();
+    atomic_fetch_add_explicit(&shard->hists[id].buckets[bucket], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->hists[id].sum, value,
+                              memory_order_relaxed);
+}
+
+uint64_t metrics_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+void metrics_snapshot(metrics_snapshot_t *snap) {
+    memset(snap, 0, sizeof(*snap));
+
+    for (size_t s = 0; s < METRICS_SHARDS; s++) {
+        metrics_shard_t *shard = &g_shards[s];
+
+        for (size_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+            snap->counters[i] += atomic_load_explicit(&shard->counters[i],
+                                                      memory_order_relaxed);
+        }
+        for (size_t h = 0; h < METRIC_HIST_COUNT; h++) {
+            for (size_t b = 0; b <= METRICS_HIST_BOUNDS; b++) {
+                uint64_t n = atomic_load_explicit(
+                    &shard->hists[h].buckets[b], memory_order_relaxed);
+                snap->hists[h].buckets[b] += n;
+                snap->hists[h].count += n;
+            }
+            snap->hists[h].sum += atomic_load_explicit(
+                &shard->hists[h].sum, memory_order_relaxed);
+        }
+    }
+    for (size_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        snap->gauges[i] = atomic_load_explicit(&g_gauges[i],
+                                               memory_order_relaxed);
+    }
+}
+
+uint64_t metrics_hist_quantile(const metrics_snapshot_t *snap,
+                               metric_hist_t id, double q) {
+    uint64_t rank;
+    uint64_t seen = 0;
+
+    if ((unsigned)id >= METRIC_HIST_COUNT || snap->hists[id].count == 0) {
+        return 0;
+    }
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    rank = (uint64_t)(q * (double)snap->hists[id].count);
+    if ((double)rank < q * (double)snap->hists[id].count || rank < 1) {
+        rank++;
+    }
+
+    for (size_t b = 0; b < METRICS_HIST_BOUNDS; b++) {
+        seen += snap->hists[id].buckets[b];
+        if (seen >= rank) {
+            return g_hist_desc[id].bounds[b];
+        }
+    }
+    return UINT64_MAX;
+}
+
+void metrics_reset(void) {
+    for (size_t s = 0; s < METRICS_SHARDS; s++) {
+        for (size_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+            atomic_store(&g_shards[s].counters[i], 0);
+        }
+        for (size_t h = 0; h < METRIC_HIST_COUNT; h++) {
+            for (size_t b = 0; b <= METRICS_HIST_BOUNDS; b++) {
+                atomic_store(&g_shards[s].hists[h].buckets[b], 0);
+            }
+            atomic_store(&g_shards[s].hists[h].sum, 0);
+        }
+    }
+    for (size_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        atomic_store(&g_gauges[i], 0);
+    }
+}
+
+static void append_scalar_metrics(const metric_desc_t *desc, size_t count,
+                                  const uint64_t *values, const char *type,
+                                  char *buffer, size_t buf_size, size_t *pos) {
+    for (size_t i = 0; i < count; i++) {
+        if (desc[i].help) {
+            buffer_appendf(buffer, buf_size, pos,
+                           "# HELP %s %s\n# TYPE %s %s\n", desc[i].name,
+                           desc[i].help, desc[i].name, type);
+        }
+        if (desc[i].label) {
+            buffer_appendf(buffer, buf_size, pos, "%s{%s} %llu\n",
+                           desc[i].name, desc[i].label,
+                           (unsigned long long)values[i]);
+        } else {
+            buffer_appendf(buffer, buf_size, pos, "%s %llu\n", desc[i].name,
+                           (unsigned long long)values[i]);
+        }
+    }
+}
+
+/* Histograms observe microseconds or bytes; `_seconds` names are scaled. */
+static void append_hist_value(char *buffer, size_t buf_size, size_t *pos,
+                              bool seconds, uint64_t value) {
+    if (seconds) {
+        buffer_appendf(buffer, buf_size, pos, "%llu.%06llu",
+                       (unsigned long long)(value / 1000000u),
+                       (unsigned long long)(value % 1000000u));
+    } else {
+        buffer_appendf(buffer, buf_size, pos, "%llu",
+                       (unsigned long long)value);
+    }
+}
+
+void metrics_append_prometheus(const metrics_snapshot_t *snap, char *buffer,
+                               size_t buf_size, size_t *pos) {
+    append_scalar_metrics(g_counter_desc, METRIC_COUNTER_COUNT,
+                          snap->counters, "counter", buffer, buf_size, pos);
+    append_scalar_metrics(g_gauge_desc, METRIC_GAUGE_COUNT, snap->gauges,
+                          "gauge", buffer, buf_size, pos);
+
+    for (size_t h = 0; h < METRIC_HIST_COUNT; h++) {
+        const hist_desc_t *desc = &g_hist_desc[h];
+        bool seconds = strstr(desc->name, "_seconds") != NULL;
+        uint64_t cumulative = 0;
+
+        buffer_appendf(buffer, buf_size, pos,
+                       "# HELP %s %s\n# TYPE %s histogram\n", desc->name,
+                       desc->help, desc->name);
+        for (size_t b = 0; b < METRICS_HIST_BOUNDS; b++) {
+            cumulative += snap->hists[h].buckets[b];
+            buffer_appendf(buffer, buf_size, pos, "%s_bucket{le=\"",
+                           desc->name);
+            append_hist_value(buffer, buf_size, pos, seconds,
+                              desc->bounds[b]);
+            buffer_appendf(buffer, buf_size, pos, "\"} %llu\n",
+                           (unsigned long long)cumulative);
+        }
+        buffer_appendf(buffer, buf_size, pos,
+                       "%s_bucket{le=\"+Inf\"} %llu\n%s_sum ", desc->name,
+                       (unsigned long long)snap->hists[h].count, desc->name);
+        append_hist_value(buffer, buf_size, pos, seconds, snap->hists[h].sum);
+        buffer_appendf(buffer, buf_size, pos, "\n%s_count %llu\n", desc->name,
+                       (unsigned long long)snap->hists[h].count);
+    }
+}
+
+void metrics_append_json(const metrics_snapshot_t *snap, char *buffer,
+                         size_t buf_size, size_t *pos) {
+    buffer_appendf(buffer, buf_size, pos, "{\"counters\":{");
+    for (size_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        buffer_appendf(buffer, buf_size, pos, "%s\"%s\":%llu", i ? "," : "",
+                       g_counter_desc[i].json,
+                       (unsigned long long)snap->counters[i]);
+    }
+    buffer_appendf(buffer, buf_size, pos, "},\"gauges\":{");
+    for (size_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        buffer_appendf(buffer, buf_size, pos, "%s\"%s\":%llu", i ? "," : "",
+                       g_gauge_desc[i].json,
+                       (unsigned long long)snap->gauges[i]);
+    }
+    buffer_appendf(buffer, buf_size, pos, "},\"histograms\":{");
+    for (size_t h = 0; h < METRIC_HIST_COUNT; h++) {
+        const hist_desc_t *desc = &g_hist_desc[h];
+
+        buffer_appendf(buffer, buf_size, pos,
+                       "%s\"%s\":{\"count\":%llu,\"sum\":%llu,\"le\":[",
+                       h ? "," : "", desc->json,
+                       (unsigned long long)snap->hists[h].count,
+                       (unsigned long long)snap->hists[h].sum);
+        for (size_t b = 0; b < METRICS_HIST_BOUNDS; b++) {
+            buffer_appendf(buffer, buf_size, pos, "%s%llu", b ? "," : "",
+                           (unsigned long long)desc->bounds[b]);
+        }
+        buffer_appendf(buffer, buf_size, pos, "],\"buckets\":[");
+        for (size_t b = 0; b <= METRICS_HIST_BOUNDS; b++) {
+            buffer_appendf(buffer, buf_size, pos, "%s%llu", b ? "," : "",
+                           (unsigned long long)snap->hists[h].buckets[b]);
+        }
+        buffer_appendf(buffer, buf_size, pos, "]}");
+    }
+    buffer_appendf(buffer, buf_size, pos, "}}\n");
+}
@@ -0,0 +1,586 @@
+#include "metrics_http.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define METRICS_HTTP_REQUEST_MAX 2048
+#define METRICS_HTTP_IDLE_MS 10000
+#define METRICS_HTTP_BACKLOG 16
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  /* SIGPIPE is ignored process-wide instead */
+#endif
+
+typedef struct {
+    int fd;
+    char in[METRICS_HTTP_REQUEST_MAX];
+    size_t in_len;
+    char *out;
+    size_t out_len;
+    size_t out_pos;
+    bool keep_alive;
+    int64_t last_active_ms;
+} metrics_conn_t;
+
+typedef struct {
+    int listen_fd;
+    int wake_fds[2];                 /* Written by metrics_http_stop() */
+    metrics_http_handler_fn handler;
+    void *ctx;
+    char body[METRICS_HTTP_BODY_MAX];
+    metrics_conn_t conns[METRICS_HTTP_MAX_CLIENTS];
+} metrics_server_t;
+
+static atomic_int g_bound_port;
+/* The running endpoint; start and stop are serialized by g_server_lock. */
+static pthread_mutex_t g_server_lock = PTHREAD_MUTEX_INITIALIZER;
+static metrics_server_t *g_server;
+static pthread_t g_server_thread;
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void set_fd_flags(int fd) {
+    int flags = fcntl(fd, F_GETFD);
+
+    if (flags >= 0) {
+        fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+    flags = fcntl(fd, F_GETFL);
+    if (flags >= 0) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
+static bool parse_port(const char *text, int *port) {
+    char *end = NULL;
+    long value;
+
+    if (!text || text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+    errno = 0;
+    value = strtol(text, &end, 10);
+    if (errno != 0 || *end != '\0' || value < 0 || value > 65535) {
+        return false;
+    }
+    *port = (int)value;
+    return true;
+}
+
+int metrics_http_parse_listen(const char *text, char *host, size_t host_size,
+                              int *port) {
+    const char *host_start;
+    const char *host_end;
+    const char *port_text;
+    size_t host_len;
+
+    if (!text || !host || host_size == 0 || !port) {
+        return -1;
+    }
+
+    if (text[0] == '[') {
+        host_start = text + 1;
+        host_end = strchr(host_start, ']');
+        if (!host_end || host_end[1] != ':') {
+            return -1;
+        }
+        port_text = host_end + 2;
+    } else {
+        host_end = strrchr(text, ':');
+        if (!host_end) {
+            /* A bare port keeps the endpoint on loopback. */
+            if (!parse_port(text, port) ||
+                snprintf(host, host_size, "127.0.0.1") >= (int)host_size) {
+                return -1;
+            }
+            return 0;
+        }
+        host_start = text;
+        if (memchr(text, ':', (size_t)(host_end - text))) {
+            return -1;  /* unbracketed IPv6 */
+        }
+        port_text = host_end + 1;
+    }
+
+    host_len = (size_t)(host_end - host_start);
+    if (host_len == 0 || host_len >= host_size || !parse_port(port_text, port)) {
+        return -1;
+    }
+    memcpy(host, host_start, host_len);
+    host[host_len] = '\0';
+    return 0;
+}
+
+static int open_listener(const char *host, int port) {
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    char port_text[16];
+    int fd = -1;
+    int rc;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    snprintf(port_text, sizeof(port_text), "%d", port);
+
+    rc = getaddrinfo(host, port_text, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to resolve metrics address %s: %s\n", host,
+                gai_strerror(rc));
+        return -1;
+    }
+
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        int one = 1;
+
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        set_fd_flags(fd);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+            listen(fd, METRICS_HTTP_BACKLOG) == 0) {
+            struct sockaddr_storage bound;
+            socklen_t len = sizeof(bound);
+
+            if (getsockname(fd, (struct sockaddr *)&bound, &len) == 0) {
+                int bound_port = bound.ss_family == AF_INET6
+                    ? ntohs(((struct sockaddr_in6 *)&bound)->sin6_port)
+                    : ntohs(((struct sockaddr_in *)&bound)->sin_port);
+                atomic_store(&g_bound_port, bound_port);
+            }
+            break;
+        }
+        rc = errno;
+        close(fd);
+        fd = -1;
+        errno = rc;
+    }
+
+    freeaddrinfo(res);
+    return fd;
+}
+
+static void conn_close(metrics_conn_t *conn) {
+    close(conn->fd);
+    free(conn->out);
+    conn->fd = -1;
+    conn->in_len = 0;
+    conn->out = NULL;
+    conn->out_len = 0;
+    conn->out_pos = 0;
+}
+
+static const char *status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        default: return "Internal Server Error";
+    }
+}
+
+/* True when the header block (after the request line) carries
+ * "Connection: <token>". */
+static bool has_connection_token(const char *headers, const char *token) {
+    size_t token_len = strlen(token);
+    const char *line = headers;
+
+    while (line && *line) {
+        const char *end = strstr(line, "\r\n");
+
+        if (!end) {
+            end = line + strlen(line);
+        }
+        if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char *value = line + 11;
+
+            while (value < end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            return (size_t)(end - value) >= token_len &&
+                   strncasecmp(value, token, token_len) == 0;
+        }
+        line = *end ? end + 2 : NULL;
+    }
+    return false;
+}
+
+/* Queue a response whose body is already in server->body.  Returns 0, or
+ * -1 if it could not be allocated. */
+static int queue_response(metrics_server_t *server, metrics_conn_t *conn,
+                          int status, size_t body_len, bool head_only) {
+    char header[256];
+    int header_len;
+
+    if (status != 200 && body_len == 0) {
+        body_len = (size_t)snprintf(server->body, sizeof(server->body),
+                                    "%s\n", status_text(status));
+    }
+
+    header_len = snprintf(header, sizeof(header),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Content-Type: text/plain; version=0.0.4; "
+                          "charset=utf-8\r\n"
+                          "Content-Length: %zu\r\n"
+                          "Connection: %s\r\n"
+                          "\r\n",
+                          status, status_text(status), body_len,
+                          conn->keep_alive ? "keep-alive" : "close");
+    if (head_only) {
+        body_len = 0;
+    }
+
+    conn->out = malloc((size_t)header_len + body_len);
+    if (!conn->out) {
+        return -1;
+    }
+    memcpy(conn->out, header, (size_t)header_len);
+    memcpy(conn->out + header_len, server->body, body_len);
+    conn->out_len = (size_t)header_len + body_len;
+    conn->out_pos = 0;
+    return 0;
+}
+
+/* Answer the request whose head (through the CRLF of its last header line)
+ * is conn->in[0..head_len).  Returns 0 or -1. */
+static int handle_request(metrics_server_t *server, metrics_conn_t *conn,
+                          size_t head_len) {
+    char method[8];
+    char path[256];
+    char version[16];
+    const char *headers;
+    size_t body_len = 0;
+    bool head_only = false;
+    int status;
+    int rc;
+
+    conn->in[head_len] = '\0';
+    headers = strstr(conn->in, "\r\n");
+    headers = headers ? headers + 2 : "";
+
+    if (sscanf(conn->in, "%7s %255s %15s", method, path, version) != 3 ||
+        strncmp(version, "HTTP/1.", 7) != 0) {
+        status = 400;
+        conn->keep_alive = false;
+    } else {
+        char *query = strchr(path, '?');
+
+        if (query) {
+            *query = '\0';
+        }
+        conn->keep_alive = strcmp(version, "HTTP/1.0") == 0
+            ? has_connection_token(headers, "keep-alive")
+            : !has_connection_token(headers, "close");
+
+        if (strcmp(method, "GET") == 0 || strcmp(method, "HEAD") == 0) {
+            head_only = method[0] == 'H';
+            status = server->handler(path, server->body, sizeof(server->body),
+                                     &body_len, server->ctx);
+            if (body_len > sizeof(server->body)) {
+                body_len = 0;
+                status = 500;
+            }
+        } else {
+            /* A request body may follow; do not try to skip it. */
+            status = 405;
+            conn->keep_alive = false;
+        }
+    }
+
+    rc = queue_response(server, conn, status, body_len, head_only);
+
+    /* Keep pipelined bytes that follow the blank line. */
+    conn->in_len -= head_len + 2;
+    memmove(conn->in, conn->in + head_len + 2, conn->in_len);
+    return rc;
+}
+
+/* Returns false when the connection should be closed. */
+static bool conn_flush(metrics_conn_t *conn) {
+    while (conn->out_pos < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + conn->out_pos,
+                         conn->out_len - conn->out_pos, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        conn->out_pos += (size_t)n;
+        conn->last_active_ms = now_ms();
+    }
+    free(conn->out);
+    conn->out = NULL;
+    conn->out_len = 0;
+    conn->out_pos = 0;
+    return conn->keep_alive;
+}
+
+/* Answer every complete request buffered on `conn` while output drains
+ * immediately.  Returns false when the connection should be closed. */
+static bool conn_process(metrics_server_t *server, metrics_conn_t *conn) {
+    while (!conn->out) {
+        char *end;
+
+        conn->in[conn->in_len] = '\0';
+        end = strstr(conn->in, "\r\n\r\n");
+        if (!end) {
+            if (conn->in_len < sizeof(conn->in) - 1) {
+                return true;
+            }
+            conn->in_len = 0;
+            conn->keep_alive = false;
+            return queue_response(server, conn, 431, 0, false) == 0 &&
+                   conn_flush(conn);
+        }
+        if (handle_request(server, conn, (size_t)(end - conn->in) + 2) < 0 ||
+            !conn_flush(conn)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void conn_read(metrics_server_t *server, metrics_conn_t *conn) {
+    ssize_t n = recv(conn->fd, conn->in + conn->in_len,
+                     sizeof(conn->in) - 1 - conn->in_len, 0);
+
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+    if (n <= 0) {
+        conn_close(conn);
+        return;
+    }
+    conn->in_len += (size_t)n;
+    conn->last_active_ms = now_ms();
+    if (!conn_process(server, conn)) {
+        conn_close(conn);
+    }
+}
+
+static void accept_clients(metrics_server_t *server) {
+    for (int i = 0; i < METRICS_HTTP_MAX_CLIENTS; i++) {
+        metrics_conn_t *conn = &server->conns[i];
+        int fd;
+
+        if (conn->fd >= 0) {
+            continue;
+        }
+        fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return;
+        }
+        set_fd_flags(fd);
+        conn->fd = fd;
+        conn->in_len = 0;
+        conn->keep_alive = true;
+        conn->last_active_ms = now_ms();
+    }
+}
+
+static void *metrics_thread(void *arg) {
+    metrics_server_t *server = arg;
+    struct pollfd pfds[METRICS_HTTP_MAX_CLIENTS + 2];
+    int slot[METRICS_HTTP_MAX_CLIENTS + 2];
+
+    while (1) {
+        int nfds = 0;
+        int free_slots = 0;
+        int64_t now;
+
+        for (int i = 0; i < METRICS_HTTP_MAX_CLIENTS; i++) {
+            metrics_conn_t *conn = &server->conns[i];
+
+            if (conn->fd < 0) {
+                free_slots++;
+                continue;
+            }
+            pfds[nfds].fd = conn->fd;
+            pfds[nfds].events = conn->out ? POLLOUT : POLLIN;
+            pfds[nfds].revents = 0;
+            slot[nfds++] = i;
+        }
+        /* Leave new connections in the backlog while every slot is busy. */
+        if (free_slots > 0) {
+            pfds[nfds].fd = server->listen_fd;
+            pfds[nfds].events = POLLIN;
+            pfds[nfds].revents = 0;
+            slot[nfds++] = -1;
+        }
+        pfds[nfds].fd = server->wake_fds[0];
+        pfds[nfds].events = POLLIN;
+        pfds[nfds].revents = 0;
+        slot[nfds++] = -2;
+
+        if (poll(pfds, (nfds_t)nfds, 1000) < 0 && errno != EINTR) {
+            fprintf(stderr, "Metrics endpoint poll failed: %s\n",
+                    strerror(errno));
+            break;
+        }
+        if (pfds[nfds - 1].revents != 0) {
+            break;
+        }
+
+        for (int i = 0; i < nfds; i++) {
+            metrics_conn_t *conn;
+
+            if (pfds[i].revents == 0) {
+                continue;
+            }
+            if (slot[i] < 0) {
+                accept_clients(server);
+                continue;
+            }
+            conn = &server->conns[slot[i]];
+            if (pfds[i].revents & (POLLERR | POLLNVAL)) {
+                conn_close(conn);
+            } else if (conn->out) {
+                if (!conn_flush(conn) ||
+                    (!conn->out && !conn_process(server, conn))) {
+                    conn_close(conn);
+                }
+            } else {
+                conn_read(server, conn);
+            }
+        }
+
+        now = now_ms();
+        for (int i = 0; i < METRICS_HTTP_MAX_CLIENTS; i++) {
+            metrics_conn_t *conn = &server->conns[i];
+
+            if (conn->fd >= 0 &&
+                now - conn->last_active_ms > METRICS_HTTP_IDLE_MS) {
+                conn_close(conn);
+            }
+        }
+    }
+
+    for (int i = 0; i < METRICS_HTTP_MAX_CLIENTS; i++) {
+        if (server->conns[i].fd >= 0) {
+            conn_close(&server->conns[i]);
+        }
+    }
+    close(server->listen_fd);
+    server->listen_fd = -1;
+    /* metrics_http_stop() frees the server after joining. */
+    return NULL;
+}
+
+static void server_free(metrics_server_t *server) {
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    close(server->wake_fds[0]);
+    close(server->wake_fds[1]);
+    free(server);
+}
+
+int metrics_http_start(const char *listen_spec, metrics_http_handler_fn handler,
+                       void *ctx) {
+    metrics_server_t *server;
+    char host[256];
+    int port;
+    int rc;
+
+    if (!handler ||
+        metrics_http_parse_listen(listen_spec, host, sizeof(host), &port) < 0) {
+        fprintf(stderr, "Invalid metrics listen address: %s\n",
+                listen_spec ? listen_spec : "(null)");
+        return -1;
+    }
+
+    server = calloc(1, sizeof(*server));
+    if (!server) {
+        fprintf(stderr, "Failed to allocate metrics endpoint\n");
+        return -1;
+    }
+    for (int i = 0; i < METRICS_HTTP_MAX_CLIENTS; i++) {
+        server->conns[i].fd = -1;
+    }
+    server->handler = handler;
+    server->ctx = ctx;
+    if (pipe(server->wake_fds) < 0) {
+        fprintf(stderr, "Failed to create metrics wake pipe: %s\n",
+                strerror(errno));
+        free(server);
+        return -1;
+    }
+    set_fd_flags(server->wake_fds[0]);
+    set_fd_flags(server->wake_fds[1]);
+    server->listen_fd = open_listener(host, port);
+    if (server->listen_fd < 0) {
+        rc = errno;
+        fprintf(stderr, "Failed to listen for metrics on %s: %s\n",
+                listen_spec, strerror(rc));
+        server_free(server);
+        errno = rc;
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_server_lock);
+    if (g_server) {
+        pthread_mutex_unlock(&g_server_lock);
+        fprintf(stderr, "Metrics endpoint is already running\n");
+        server_free(server);
+        return -1;
+    }
+    rc = pthread_create(&g_server_thread, NULL, metrics_thread, server);
+    if (rc != 0) {
+        pthread_mutex_unlock(&g_server_lock);
+        fprintf(stderr, "Failed to start metrics thread: %s\n", strerror(rc));
+        server_free(server);
+        return -1;
+    }
+    g_server = server;
+    pthread_mutex_unlock(&g_server_lock);
+    return 0;
+}
+
+void metrics_http_stop(void) {
+    ssize_t ignored;
+
+    pthread_mutex_lock(&g_server_lock);
+    if (!g_server) {
+        pthread_mutex_unlock(&g_server_lock);
+        return;
+    }
+    ignored = write(g_server->wake_fds[1], "x", 1);
+    (void)ignored;
+    pthread_join(g_server_thread, NULL);
+    server_free(g_server);
+    g_server = NULL;
+    pthread_mutex_unlock(&g_server_lock);
+}
+
+int metrics_http_bound_port(void) {
+    return atomic_load(&g_bound_port);
+}
@@ -3,7 +3,11 @@
 #include "chat_room.h"
 #include "common.h"
 #include "json_text.h"
+#include "metrics.h"
 #include "module_protocol.h"
+#include "post_limit.h"
+#include "scratch.h"
+#include "trace.h"
 #include "utf8.h"
 
 #include <errno.h>
@@ -36,11 +40,6 @@ typedef struct module_process {
     bool active;
 } module_process_t;
 
-typedef struct module_event_node {
-    message_t msg;
-    struct module_event_node *next;
-} module_event_node_t;
-
 typedef enum module_response_action {
     MODULE_RESPONSE_CONTINUE,
     MODULE_RESPONSE_DONE,
@@ -54,8 +53,9 @@ static bool g_thread_started = false;
 static bool g_running = false;
 static pthread_mutex_t g_queue_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t g_queue_cond = PTHREAD_COND_INITIALIZER;
-static module_event_node_t *g_queue_head = NULL;
-static module_event_node_t *g_queue_tail = NULL;
+/* Fixed ring of pending message events, so publishing never allocates. */
+static message_t g_queue[TNT_MODULE_QUEUE_LIMIT];
+static int g_queue_head = 0;
 static int g_queue_len = 0;
 
 static bool is_safe_relative_entrypoint(const char *entrypoint) {
@@ -411,52 +411,45 @@ static int start_module_process(const char *module_dir,
 }
 
 static void enqueue_message(const message_t *msg) {
-    module_event_node_t *node;
-
     if (!msg) return;
 
     pthread_mutex_lock(&g_queue_lock);
     if (!g_running || g_queue_len >= TNT_MODULE_QUEUE_LIMIT) {
+        bool full = g_queue_len >= TNT_MODULE_QUEUE_LIMIT;
+
         pthread_mutex_unlock(&g_queue_lock);
-        if (g_queue_len >= TNT_MODULE_QUEUE_LIMIT) {
+        if (full) {
+            metrics_inc(METRIC_MODULE_EVENTS_DROPPED);
             fprintf(stderr, "module runtime: event queue full, dropping\n");
         }
         return;
     }
 
-    node = calloc(1, sizeof(*node));
-    if (!node) {
-        pthread_mutex_unlock(&g_queue_lock);
-        return;
-    }
-    node->msg = *msg;
-
-    if (g_queue_tail) {
-        g_queue_tail->next = node;
-    } else {
-        g_queue_head = node;
-    }
-    g_queue_tail = node;
+    g_queue[(g_queue_head + g_queue_len) % TNT_MODULE_QUEUE_LIMIT] = *msg;
     g_queue_len++;
+    metrics_gauge_set(METRIC_GAUGE_MODULE_QUEUE_DEPTH, (uint64_t)g_queue_len);
     pthread_cond_signal(&g_queue_cond);
     pthread_mutex_unlock(&g_queue_lock);
 }
 
-static module_event_node_t *dequeue_message(void) {
-    module_event_node_t *node;
+/* Copy the oldest event into *msg.  Returns false once shut down. */
+static bool dequeue_message(message_t *msg) {
+    bool found = false;
 
     pthread_mutex_lock(&g_queue_lock);
-    while (g_running && !g_queue_head) {
+    while (g_running && g_queue_len == 0) {
         pthread_cond_wait(&g_queue_cond, &g_queue_lock);
     }
-    node = g_queue_head;
-    if (node) {
-        g_queue_head = node->next;
-        if (!g_queue_head) g_queue_tail = NULL;
+    if (g_queue_len > 0) {
+        *msg = g_queue[g_queue_head];
+        g_queue_head = (g_queue_head + 1) % TNT_MODULE_QUEUE_LIMIT;
         g_queue_len--;
+        metrics_gauge_set(METRIC_GAUGE_MODULE_QUEUE_DEPTH,
+                          (uint64_t)g_queue_len);
+        found = true;
     }
     pthread_mutex_unlock(&g_queue_lock);
-    return node;
+    return found;
 }
 
 static void publish_module_message(const module_process_t *module,
@@ -471,6 +464,11 @@ static void publish_module_message(const module_process_t *module,
              TNT_MODULE_NAME_MAX, module->manifest.name);
     snprintf(msg.content, sizeof(msg.content), "%s", plain_text);
 
+    /* Dropped posts show up in `stats` as posts_throttled_module */
+    if (!post_limit_allow(POST_KIND_MODULE, msg.username, NULL)) {
+        return;
+    }
+
     if (message_save(&msg) < 0) {
         fprintf(stderr, "module runtime: failed to persist module message\n");
         return;
@@ -503,11 +501,9 @@ static module_response_action_t handle_module_response(module_process_t *module,
     return MODULE_RESPONSE_INVALID;
 }
 
-static void deliver_message_to_module(module_process_t *module,
-                                      const message_t *msg,
-                                      uint64_t event_id) {
-    char event[TNT_MODULE_LINE_MAX] = "";
-    char line[TNT_MODULE_LINE_MAX];
+static void exchange_message_event(module_process_t *module,
+                                   const message_t *msg, uint64_t event_id,
+                                   char *event, char *line) {
     char message_id[64];
     size_t pos = 0;
     int responses = 0;
@@ -516,7 +512,7 @@ static void deliver_message_to_module(module_process_t *module,
 
     snprintf(message_id, sizeof(message_id), "local-%llu",
              (unsigned long long)event_id);
-    if (tnt_module_append_message_created(event, sizeof(event), &pos,
+    if (tnt_module_append_message_created(event, TNT_MODULE_LINE_MAX, &pos,
                                           message_id, msg) < 0 ||
         write(module->stdin_fd, event, strlen(event)) !=
             (ssize_t)strlen(event)) {
@@ -527,7 +523,7 @@ static void deliver_message_to_module(module_process_t *module,
     }
 
     while (1) {
-        int n = read_line_timeout(module->stdout_fd, line, sizeof(line),
+        int n = read_line_timeout(module->stdout_fd, line, TNT_MODULE_LINE_MAX,
                                   TNT_MODULE_RESPONSE_TIMEOUT_MS);
         if (n == 0) {
             return;
@@ -540,6 +536,7 @@ static void deliver_message_to_module(module_process_t *module,
         }
         responses++;
         if (responses > TNT_MODULE_MAX_RESPONSES_PER_EVENT) {
+            metrics_inc(METRIC_MODULE_RESPONSES_DROPPED);
             fprintf(stderr,
                     "module runtime: disabling %s after too many responses\n",
                     module->manifest.name);
@@ -547,12 +544,16 @@ static void deliver_message_to_module(module_process_t *module,
             return;
         }
 
+        uint64_t trace_us = trace_begin();
         module_response_action_t action = handle_module_response(module, line);
+
+        trace_end(TRACE_EV_MODULE_RESPONSE, trace_us, event_id);
         if (action == MODULE_RESPONSE_DONE) {
             module->invalid_responses = 0;
             return;
         }
         if (action == MODULE_RESPONSE_INVALID) {
+            metrics_inc(METRIC_MODULE_RESPONSES_DROPPED);
             module->invalid_responses++;
             if (module->invalid_responses >= TNT_MODULE_MAX_INVALID_RESPONSES) {
                 fprintf(stderr,
@@ -566,21 +567,37 @@ static void deliver_message_to_module(module_process_t *module,
     }
 }
 
+static void deliver_message_to_module(module_process_t *module,
+                                      const message_t *msg,
+                                      uint64_t event_id) {
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    char *event = tnt_scratch_alloc(TNT_MODULE_LINE_MAX);
+    char *line = tnt_scratch_alloc(TNT_MODULE_LINE_MAX);
+    uint64_t trace_us = trace_begin();
+
+    if (event && line) {
+        event[0] = '\0';
+        exchange_message_event(module, msg, event_id, event, line);
+    }
+    trace_end(TRACE_EV_MODULE_DELIVER, trace_us, event_id);
+    tnt_scratch_release(scratch);
+}
+
 static void *module_worker_main(void *arg) {
     uint64_t event_id = 0;
     (void)arg;
 
     while (g_running) {
-        module_event_node_t *node = dequeue_message();
-        if (!node) {
+        message_t msg;
+
+        if (!dequeue_message(&msg)) {
             continue;
         }
 
         event_id++;
         for (int i = 0; i < g_module_count; i++) {
-            deliver_message_to_module(&g_modules[i], &node->msg, event_id);
+            deliver_message_to_module(&g_modules[i], &msg, event_id);
         }
-        free(node);
     }
 
     return NULL;
@@ -648,8 +665,6 @@ int tnt_module_runtime_init(void) {
 }
 
 void tnt_module_runtime_shutdown(void) {
-    module_event_node_t *node;
-
     pthread_mutex_lock(&g_queue_lock);
     g_running = false;
     pthread_cond_broadcast(&g_queue_cond);
@@ -660,12 +675,9 @@ void tnt_module_runtime_shutdown(void) {
         g_thread_started = false;
     }
 
-    while ((node = g_queue_head) != NULL) {
-        g_queue_head = node->next;
-        free(node);
-    }
-    g_queue_tail = NULL;
+    g_queue_head = 0;
     g_queue_len = 0;
+    metrics_gauge_set(METRIC_GAUGE_MODULE_QUEUE_DEPTH, 0);
 
     for (int i = 0; i < g_module_count; i++) {
         close_module_process(&g_modules[i]);
@@ -0,0 +1,191 @@
+#include "object_pool.h"
+
+#define BUFFER_CLASS_COUNT 7  /* 4 KiB .. 256 KiB */
+
+static pthread_mutex_t g_pool_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static tnt_pool_t *g_pool_list = NULL;
+
+static tnt_pool_t g_buffer_pools[BUFFER_CLASS_COUNT] = {
+    { "buffer-4k", 4 * 1024, TNT_BUFFER_POOL_MAX_FREE,
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, false, NULL },
+    { "buffer-8k", 8 * 1024, TNT_BUFFER_POOL_MAX_FREE,
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, false, NULL },
+    { "buffer-16k", 16 * 1024, TNT_BUFFER_POOL_MAX_FREE,
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, false, NULL },
+    { "buffer-32k", 32 * 1024, TNT_BUFFER_POOL_MAX_FREE,
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, false, NULL },
+    { "buffer-64k", 64 * 1024, TNT_BUFFER_POOL_MAX_FREE,
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, false, NULL },
+    { "buffer-128k", 128 * 1024, TNT_BUFFER_POOL_MAX_FREE,
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, false, NULL },
+    { "buffer-256k", 256 * 1024, TNT_BUFFER_POOL_MAX_FREE,
+      PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0, false, NULL },
+};
+
+/* Pools join the stats list on first use.  Lock order is list, then pool. */
+static void pool_register(tnt_pool_t *pool) {
+    if (atomic_load_explicit(&pool->registered, memory_order_acquire)) {
+        return;
+    }
+    pthread_mutex_lock(&g_pool_list_lock);
+    if (!atomic_load_explicit(&pool->registered, memory_order_relaxed)) {
+        pool->next_pool = g_pool_list;
+        g_pool_list = pool;
+        atomic_store_explicit(&pool->registered, true, memory_order_release);
+    }
+    pthread_mutex_unlock(&g_pool_list_lock);
+}
+
+/* Take an object without zeroing it. */
+static void *pool_take(tnt_pool_t *pool) {
+    tnt_pool_node_t *node;
+
+    pool_register(pool);
+    pthread_mutex_lock(&pool->lock);
+    node = pool->free_list;
+    if (node) {
+        pool->free_list = node->next;
+        pool->free_count--;
+        pool->reused++;
+    } else {
+        pool->allocated++;
+    }
+    pool->in_use++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (node) {
+        return node;
+    }
+
+    void *object = malloc(pool->object_size < sizeof(tnt_pool_node_t)
+                          ? sizeof(tnt_pool_node_t) : pool->object_size);
+    if (!object) {
+        pthread_mutex_lock(&pool->lock);
+        pool->in_use--;
+        pool->allocated--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return object;
+}
+
+void *tnt_pool_alloc(tnt_pool_t *pool) {
+    if (!pool) return NULL;
+
+    void *object = pool_take(pool);
+    if (object) {
+        memset(object, 0, pool->object_size);
+    }
+    return object;
+}
+
+void tnt_pool_free(tnt_pool_t *pool, void *object) {
+    if (!pool || !object) return;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->in_use > 0) {
+        pool->in_use--;
+    }
+    if (pool->free_count < pool->max_free) {
+        tnt_pool_node_t *node = object;
+        node->next = pool->free_list;
+        pool->free_list = node;
+        pool->free_count++;
+        object = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(object);
+}
+
+static tnt_pool_t *buffer_class_for(size_t size) {
+    size_t class_size = TNT_BUFFER_POOL_MIN;
+
+    for (int i = 0; i < BUFFER_CLASS_COUNT; i++) {
+        if (size <= class_size) {
+            return &g_buffer_pools[i];
+        }
+        class_size *= 2;
+    }
+    return NULL;
+}
+
+void *tnt_buffer_pool_alloc(size_t min_size, size_t *capacity) {
+    tnt_pool_t *pool = buffer_class_for(min_size);
+    void *buffer;
+
+    if (!pool) {
+        buffer = malloc(min_size);
+        if (buffer && capacity) *capacity = min_size;
+        return buffer;
+    }
+
+    buffer = pool_take(pool);
+    if (buffer && capacity) {
+        *capacity = pool->object_size;
+    }
+    return buffer;
+}
+
+void tnt_buffer_pool_free(void *buffer, size_t capacity) {
+    if (!buffer) return;
+
+    tnt_pool_t *pool = buffer_class_for(capacity);
+    if (!pool || pool->object_size != capacity) {
+        free(buffer);
+        return;
+    }
+    tnt_pool_free(pool, buffer);
+}
+
+void *tnt_buffer_pool_resize(void *buffer, size_t capacity, size_t keep,
+                             size_t min_size, size_t *new_capacity) {
+    size_t resized_capacity = 0;
+    void *resized = tnt_buffer_pool_alloc(min_size, &resized_capacity);
+
+    if (!resized) {
+        return NULL;
+    }
+    if (buffer && keep > 0) {
+        memcpy(resized, buffer,
+               keep < resized_capacity ? keep : resized_capacity);
+    }
+    tnt_buffer_pool_free(buffer, capacity);
+    if (new_capacity) {
+        *new_capacity = resized_capacity;
+    }
+    return resized;
+}
+
+bool tnt_buffer_pool_fits(size_t capacity, size_t min_size) {
+    if (capacity < min_size) {
+        return false;
+    }
+
+    tnt_pool_t *pool = buffer_class_for(min_size);
+    if (pool) {
+        return pool->object_size == capacity;
+    }
+    return capacity / 2 < min_size;
+}
+
+int tnt_pool_collect_stats(tnt_pool_stats_t *out, int max_entries) {
+    int count = 0;
+
+    if (!out || max_entries <= 0) return 0;
+
+    pthread_mutex_lock(&g_pool_list_lock);
+    for (tnt_pool_t *pool = g_pool_list; pool && count < max_entries;
+         pool = pool->next_pool) {
+        pthread_mutex_lock(&pool->lock);
+        out[count].name = pool->name;
+        out[count].object_size = pool->object_size;
+        out[count].free_count = pool->free_count;
+        out[count].in_use = pool->in_use;
+        out[count].reused = pool->reused;
+        out[count].allocated = pool->allocated;
+        pthread_mutex_unlock(&pool->lock);
+        count++;
+    }
+    pthread_mutex_unlock(&g_pool_list_lock);
+    return count;
+}
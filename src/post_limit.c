@@ -0,0 +1,213 @@
+#include "post_limit.h"
+#include "config_defaults.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define POST_LIMIT_SLOTS 1024      /* Per table; power of two */
+#define POST_LIMIT_PROBE 16        /* Slots searched per key */
+#define POST_LIMIT_KEY_LEN 80      /* "module:" + username, or an address */
+/* Tokens are counted in 1/60000 of a post, so a per-minute rate refills
+ * exactly `rate` units per millisecond. */
+#define POST_TOKEN 60000
+
+typedef struct {
+    char key[POST_LIMIT_KEY_LEN];
+    int64_t tokens;                /* In POST_TOKEN units */
+    uint64_t last_ms;
+} post_bucket_t;
+
+/* One table per bucket family.  A slot is reusable once its bucket would
+ * have refilled to the burst, since forgetting it then changes nothing. */
+typedef struct {
+    pthread_mutex_t lock;
+    post_bucket_t slots[POST_LIMIT_SLOTS];
+    int rate;                      /* Posts per minute; 0 = off */
+    int burst;
+} post_table_t;
+
+static post_table_t g_user_table = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static post_table_t g_ip_table = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static _Atomic unsigned long g_rejected[POST_KIND_COUNT];
+static uint64_t g_hash_seed = 0;
+static uint64_t (*g_now_fn)(void) = NULL;
+
+static const char *const g_kind_names[POST_KIND_COUNT] = {
+    "public", "whisper", "exec", "module"
+};
+
+static uint64_t post_limit_now(void) {
+    struct timespec ts;
+
+    if (g_now_fn) {
+        return g_now_fn();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void table_reset(post_table_t *table, int rate, int burst) {
+    pthread_mutex_lock(&table->lock);
+    memset(table->slots, 0, sizeof(table->slots));
+    table->rate = rate;
+    table->burst = burst;
+    pthread_mutex_unlock(&table->lock);
+}
+
+void post_limit_init(void) {
+    /* Per-process seed so posters cannot aim collisions at one chain. */
+    g_hash_seed = (uint64_t)time(NULL) * 0x9e3779b97f4a7c15ULL ^
+                  (uint64_t)getpid();
+
+    table_reset(&g_user_table, tnt_config_env_int(&TNT_CONFIG_POST_RATE),
+                tnt_config_env_int(&TNT_CONFIG_POST_BURST));
+    table_reset(&g_ip_table, tnt_config_env_int(&TNT_CONFIG_POST_IP_RATE),
+                tnt_config_env_int(&TNT_CONFIG_POST_IP_BURST));
+    for (int i = 0; i < POST_KIND_COUNT; i++) {
+        atomic_store(&g_rejected[i], 0);
+    }
+}
+
+void post_limit_set_time_source(uint64_t (*now_fn)(void)) {
+    g_now_fn = now_fn;
+}
+
+static uint64_t key_hash(const char *key) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ g_hash_seed;
+
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+static int64_t bucket_level(const post_table_t *table,
+                            const post_bucket_t *bucket, uint64_t now) {
+    int64_t cap = (int64_t)table->burst * POST_TOKEN;
+    uint64_t elapsed = now > bucket->last_ms ? now - bucket->last_ms : 0;
+    uint64_t refill = elapsed * (uint64_t)table->rate;
+
+    /* rate >= 1, so a long idle gap is full before elapsed * rate can wrap */
+    if (elapsed >= (uint64_t)cap || refill >= (uint64_t)cap ||
+        bucket->tokens + (int64_t)refill >= cap) {
+        return cap;
+    }
+    return bucket->tokens + (int64_t)refill;
+}
+
+/* Find `key`'s bucket, claiming an idle or the stalest slot in its probe
+ * window when it has none.  Called with the table lock held. */
+static post_bucket_t *table_lookup(post_table_t *table, const char *key,
+                                   uint64_t now) {
+    int64_t cap = (int64_t)table->burst * POST_TOKEN;
+    size_t start = (size_t)key_hash(key) & (POST_LIMIT_SLOTS - 1);
+    post_bucket_t *idle = NULL;
+    post_bucket_t *stalest = NULL;
+    post_bucket_t *reuse;
+
+    for (size_t i = 0; i < POST_LIMIT_PROBE; i++) {
+        post_bucket_t *slot =
+            &table->slots[(start + i) & (POST_LIMIT_SLOTS - 1)];
+
+        if (slot->key[0] == '\0') {
+            if (!idle) {
+                idle = slot;
+            }
+            continue;
+        }
+        if (strcmp(slot->key, key) == 0) {
+            return slot;
+        }
+        if (!idle && bucket_level(table, slot, now) >= cap) {
+            idle = slot;
+        }
+        if (!stalest || slot->last_ms < stalest->last_ms) {
+            stalest = slot;
+        }
+    }
+
+    reuse = idle ? idle : stalest;
+    snprintf(reuse->key, sizeof(reuse->key), "%s", key);
+    reuse->tokens = cap;
+    reuse->last_ms = now;
+    return reuse;
+}
+
+/* Take one token from `key`'s bucket.  Returns false when it is empty. */
+static bool table_take(post_table_t *table, const char *key, uint64_t now) {
+    post_bucket_t *bucket;
+    bool allowed;
+
+    if (!key || key[0] == '\0') {
+        return true;
+    }
+
+    pthread_mutex_lock(&table->lock);
+    if (table->rate <= 0) {
+        pthread_mutex_unlock(&table->lock);
+        return true;
+    }
+    bucket = table_lookup(table, key, now);
+    bucket->tokens = bucket_level(table, bucket, now);
+    bucket->last_ms = now;
+    allowed = bucket->tokens >= POST_TOKEN;
+    if (allowed) {
+        bucket->tokens -= POST_TOKEN;
+    }
+    pthread_mutex_unlock(&table->lock);
+    return allowed;
+}
+
+static void table_refund(post_table_t *table, const char *key, uint64_t now) {
+    if (!key || key[0] == '\0') {
+        return;
+    }
+
+    pthread_mutex_lock(&table->lock);
+    if (table->rate > 0) {
+        post_bucket_t *bucket = table_lookup(table, key, now);
+        int64_t cap = (int64_t)table->burst * POST_TOKEN;
+
+        bucket->tokens += POST_TOKEN;
+        if (bucket->tokens > cap) {
+            bucket->tokens = cap;
+        }
+    }
+    pthread_mutex_unlock(&table->lock);
+}
+
+bool post_limit_allow(post_kind_t kind, const char *user, const char *ip) {
+    uint64_t now = post_limit_now();
+
+    if (kind < 0 || kind >= POST_KIND_COUNT) {
+        return false;
+    }
+
+    if (table_take(&g_user_table, user, now)) {
+        if (table_take(&g_ip_table, ip, now)) {
+            return true;
+        }
+        table_refund(&g_user_table, user, now);
+    }
+
+    atomic_fetch_add(&g_rejected[kind], 1);
+    return false;
+}
+
+unsigned long post_limit_rejected(post_kind_t kind) {
+    if (kind < 0 || kind >= POST_KIND_COUNT) {
+        return 0;
+    }
+    return atomic_load(&g_rejected[kind]);
+}
+
+const char *post_limit_kind_name(post_kind_t kind) {
+    if (kind < 0 || kind >= POST_KIND_COUNT) {
+        return "unknown";
+    }
+    return g_kind_names[kind];
+}
@@ -1,30 +1,51 @@
 #include "ratelimit.h"
 #include "config_defaults.h"
 #include "common.h"
+#include "metrics.h"
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
-#define MAX_TRACKED_IPS 256
+#define RATELIMIT_SHARDS 16      /* Power of two */
+#define RATELIMIT_KEY_LEN 16     /* IPv6 width; IPv4 is stored v4-mapped */
 #define RATE_LIMIT_WINDOW 60   /* seconds */
 #define MAX_AUTH_FAILURES 5    /* auth failures before block */
 #define BLOCK_DURATION 300     /* seconds to block after too many failures */
 
+/* One tracked address (or prefix, when aggregation is on). */
 typedef struct {
-    char ip[INET6_ADDRSTRLEN];
-    time_t window_start;
+    uint8_t key[RATELIMIT_KEY_LEN];
+    bool used;
+    bool is_blocked;
     int recent_connection_count;
     int active_connections;
     int auth_failure_count;
-    bool is_blocked;
+    time_t window_start;
     time_t block_until;
+    time_t last_seen;
 } ip_rate_limit_t;
 
-static ip_rate_limit_t g_rate_limits[MAX_TRACKED_IPS];
-static pthread_mutex_t g_rate_limit_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Open-addressing (linear probing) table.  Entries are never removed in
+ * place: expired ones are reused by the next insert on their probe chain,
+ * and the shard is rebuilt once occupancy passes 3/4. */
+typedef struct {
+    pthread_mutex_t lock;
+    ip_rate_limit_t *slots;
+    size_t capacity;   /* Power of two */
+    size_t used;       /* Slots ever filled since the last rebuild */
+} ratelimit_shard_t;
+
+static ratelimit_shard_t g_shards[RATELIMIT_SHARDS];
+static bool g_shards_ready = false;
+static uint64_t g_hash_seed = 0;
+static time_t (*g_now_fn)(void) = NULL;
+
 static int g_total_connections = 0;
 static pthread_mutex_t g_conn_count_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -32,6 +53,46 @@ static int g_max_connections = TNT_DEFAULT_MAX_CONNECTIONS;
 static int g_max_conn_per_ip = TNT_DEFAULT_MAX_CONN_PER_IP;
 static int g_max_conn_rate_per_ip = TNT_DEFAULT_MAX_CONN_RATE_PER_IP;
 static int g_rate_limit_enabled = TNT_DEFAULT_RATE_LIMIT_ENABLED;
+static int g_table_size = TNT_DEFAULT_RATE_LIMIT_TABLE_SIZE;
+static int g_entry_ttl = TNT_DEFAULT_RATE_LIMIT_TTL;
+static int g_v4_prefix = TNT_DEFAULT_RATE_LIMIT_V4_PREFIX;
+static int g_v6_prefix = TNT_DEFAULT_RATE_LIMIT_V6_PREFIX;
+
+static time_t ratelimit_now(void) {
+    return g_now_fn ? g_now_fn() : time(NULL);
+}
+
+static void shards_free(void) {
+    for (int i = 0; i < RATELIMIT_SHARDS; i++) {
+        free(g_shards[i].slots);
+        g_shards[i].slots = NULL;
+        g_shards[i].capacity = 0;
+        g_shards[i].used = 0;
+        if (g_shards_ready) {
+            pthread_mutex_destroy(&g_shards[i].lock);
+        }
+    }
+    g_shards_ready = false;
+}
+
+static void shards_alloc(void) {
+    size_t per_shard = 16;
+
+    while (per_shard * RATELIMIT_SHARDS < (size_t)g_table_size) {
+        per_shard <<= 1;
+    }
+
+    for (int i = 0; i < RATELIMIT_SHARDS; i++) {
+        pthread_mutex_init(&g_shards[i].lock, NULL);
+        g_shards[i].slots = calloc(per_shard, sizeof(ip_rate_limit_t));
+        g_shards[i].capacity = g_shards[i].slots ? per_shard : 0;
+        g_shards[i].used = 0;
+        if (!g_shards[i].slots) {
+            fprintf(stderr, "Warning: rate-limit shard allocation failed\n");
+        }
+    }
+    g_shards_ready = true;
+}
 
 void ratelimit_init(void) {
     g_max_connections =
@@ -42,88 +103,270 @@ void ratelimit_init(void) {
         tnt_config_env_int(&TNT_CONFIG_MAX_CONN_RATE_PER_IP);
     g_rate_limit_enabled =
         tnt_config_env_int(&TNT_CONFIG_RATE_LIMIT);
+    g_table_size = tnt_config_env_int(&TNT_CONFIG_RATE_LIMIT_TABLE_SIZE);
+    g_entry_ttl = tnt_config_env_int(&TNT_CONFIG_RATE_LIMIT_TTL);
+    g_v4_prefix = tnt_config_env_int(&TNT_CONFIG_RATE_LIMIT_V4_PREFIX);
+    g_v6_prefix = tnt_config_env_int(&TNT_CONFIG_RATE_LIMIT_V6_PREFIX);
+
+    /* Per-process seed so peers cannot aim collisions at one chain. */
+    g_hash_seed = (uint64_t)time(NULL) * 0x9e3779b97f4a7c15ULL ^
+                  (uint64_t)getpid() ^ (uint64_t)(uintptr_t)&g_hash_seed;
+
+    shards_free();
+    shards_alloc();
 }
 
-/* Caller MUST hold g_rate_limit_lock. */
-static ip_rate_limit_t* get_rate_limit_entry(const char *ip) {
-    /* Look for existing entry */
-    for (int i = 0; i < MAX_TRACKED_IPS; i++) {
-        if (strcmp(g_rate_limits[i].ip, ip) == 0) {
-            return &g_rate_limits[i];
-        }
+void ratelimit_set_time_source(time_t (*now_fn)(void)) {
+    g_now_fn = now_fn;
+}
+
+static void ensure_shards(void) {
+    if (!g_shards_ready) {
+        ratelimit_init();
     }
+}
+
+static void mask_prefix(uint8_t key[RATELIMIT_KEY_LEN], int first_bit,
+                        int prefix_bits) {
+    int keep = first_bit + prefix_bits;
+
+    for (int bit = keep; bit < RATELIMIT_KEY_LEN * 8; bit++) {
+        key[bit / 8] &= (uint8_t)~(0x80u >> (bit % 8));
+    }
+}
+
+/* Binary key for an address string, with prefix aggregation applied.
+ * Unparseable strings ("unknown") all share the all-zero key. */
+static void ratelimit_key(const char *ip, uint8_t key[RATELIMIT_KEY_LEN]) {
+    static const uint8_t v4_mapped[12] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+    };
+    struct in_addr v4;
+    struct in6_addr v6;
+
+    memset(key, 0, RATELIMIT_KEY_LEN);
+    if (!ip) {
+        return;
+    }
+    if (inet_pton(AF_INET, ip, &v4) == 1) {
+        memcpy(key, v4_mapped, sizeof(v4_mapped));
+        memcpy(key + 12, &v4, 4);
+    } else if (inet_pton(AF_INET6, ip, &v6) == 1) {
+        memcpy(key, &v6, RATELIMIT_KEY_LEN);
+    } else {
+        return;
+    }
+
+    if (memcmp(key, v4_mapped, sizeof(v4_mapped)) == 0) {
+        mask_prefix(key, 96, g_v4_prefix);
+    } else {
+        mask_prefix(key, 0, g_v6_prefix);
+    }
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t key_hash(const uint8_t key[RATELIMIT_KEY_LEN]) {
+    uint64_t hi;
+    uint64_t lo;
+
+    memcpy(&hi, key, sizeof(hi));
+    memcpy(&lo, key + 8, sizeof(lo));
+    return mix64(mix64(hi ^ g_hash_seed) ^ lo);
+}
+
+static ratelimit_shard_t *shard_for(uint64_t hash) {
+    return &g_shards[hash >> 60 & (RATELIMIT_SHARDS - 1)];
+}
+
+/* An entry can be dropped once nothing depends on it any more. */
+static bool entry_expired(const ip_rate_limit_t *entry, time_t now) {
+    if (entry->active_connections > 0) {
+        return false;
+    }
+    if (entry->is_blocked && now < entry->block_until) {
+        return false;
+    }
+    return now - entry->last_seen >= g_entry_ttl;
+}
 
-    /* Find empty slot */
-    for (int i = 0; i < MAX_TRACKED_IPS; i++) {
-        if (g_rate_limits[i].ip[0] == '\0') {
-            strncpy(g_rate_limits[i].ip, ip, sizeof(g_rate_limits[i].ip) - 1);
-            g_rate_limits[i].window_start = time(NULL);
-            g_rate_limits[i].recent_connection_count = 0;
-            g_rate_limits[i].active_connections = 0;
-            g_rate_limits[i].auth_failure_count = 0;
-            g_rate_limits[i].is_blocked = false;
-            g_rate_limits[i].block_until = 0;
-            return &g_rate_limits[i];
+static void shard_place(ip_rate_limit_t *slots, size_t capacity,
+                        const ip_rate_limit_t *entry) {
+    size_t mask = capacity - 1;
+    size_t i = (size_t)key_hash(entry->key) & mask;
+
+    while (slots[i].used) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = *entry;
+}
+
+/* Rebuild the shard without expired entries.  If live entries alone still
+ * exceed the load limit, idle entries are dropped oldest first (halving
+ * the age cutoff each pass); entries with active connections never are.
+ * Caller holds the shard lock. */
+static void shard_rebuild(ratelimit_shard_t *shard, time_t now) {
+    size_t limit = shard->capacity / 4 * 3;
+    time_t cutoff = g_entry_ttl;
+    ip_rate_limit_t *slots;
+    size_t live;
+
+    slots = calloc(shard->capacity, sizeof(*slots));
+    if (!slots) {
+        return;
+    }
+
+    for (;;) {
+        live = 0;
+        for (size_t i = 0; i < shard->capacity; i++) {
+            const ip_rate_limit_t *e = &shard->slots[i];
+            if (e->used && e->active_connections == 0 &&
+                now - e->last_seen >= cutoff &&
+                (cutoff == 0 || !e->is_blocked || now >= e->block_until)) {
+                continue;
+            }
+            live += e->used ? 1 : 0;
+        }
+        if (live <= limit || cutoff == 0) {
+            break;
         }
+        cutoff /= 2;
     }
 
-    /* Reuse the oldest inactive entry first so active IP accounting stays intact. */
-    int oldest_idx = -1;
-    time_t oldest_time = 0;
-    for (int i = 0; i < MAX_TRACKED_IPS; i++) {
-        if (g_rate_limits[i].active_connections != 0) {
+    for (size_t i = 0; i < shard->capacity; i++) {
+        const ip_rate_limit_t *e = &shard->slots[i];
+        if (!e->used ||
+            (e->active_connections == 0 && now - e->last_seen >= cutoff &&
+             (cutoff == 0 || !e->is_blocked || now >= e->block_until))) {
             continue;
         }
-        if (oldest_idx < 0 || g_rate_limits[i].window_start < oldest_time) {
-            oldest_time = g_rate_limits[i].window_start;
-            oldest_idx = i;
-        }
+        shard_place(slots, shard->capacity, e);
     }
 
-    if (oldest_idx < 0) {
-        /* All slots have active connections — evicting will corrupt their
-         * concurrency accounting.  Pick the oldest entry but warn. */
-        oldest_idx = 0;
-        oldest_time = g_rate_limits[0].window_start;
-        for (int i = 1; i < MAX_TRACKED_IPS; i++) {
-            if (g_rate_limits[i].window_start < oldest_time) {
-                oldest_time = g_rate_limits[i].window_start;
-                oldest_idx = i;
+    free(shard->slots);
+    shard->slots = slots;
+    shard->used = live;
+}
+
+static void entry_reset(ip_rate_limit_t *entry,
+                        const uint8_t key[RATELIMIT_KEY_LEN], time_t now) {
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->key, key, RATELIMIT_KEY_LEN);
+    entry->used = true;
+    entry->window_start = now;
+    entry->last_seen = now;
+}
+
+/* Find the entry for `key`, creating it if asked.  Returns NULL only when
+ * not found and not creating, or when every slot is pinned by an active
+ * connection.  Caller holds the shard lock. */
+static ip_rate_limit_t *shard_lookup(ratelimit_shard_t *shard,
+                                     const uint8_t key[RATELIMIT_KEY_LEN],
+                                     uint64_t hash, time_t now, bool create) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t mask = shard->capacity - 1;
+        size_t i = (size_t)hash & mask;
+        ip_rate_limit_t *reuse = NULL;
+        ip_rate_limit_t *empty = NULL;
+
+        if (shard->capacity == 0) {
+            return NULL;
+        }
+
+        for (size_t n = 0; n < shard->capacity; n++, i = (i + 1) & mask) {
+            ip_rate_limit_t *e = &shard->slots[i];
+
+            if (!e->used) {
+                empty = e;
+                break;
+            }
+            if (memcmp(e->key, key, RATELIMIT_KEY_LEN) == 0) {
+                return e;
             }
+            if (!reuse && entry_expired(e, now)) {
+                reuse = e;
+            }
+        }
+
+        if (!create) {
+            return NULL;
+        }
+        if (reuse) {
+            entry_reset(reuse, key, now);
+            return reuse;
+        }
+        if (empty && shard->used + 1 <= shard->capacity / 4 * 3) {
+            shard->used++;
+            entry_reset(empty, key, now);
+            return empty;
+        }
+        if (attempt == 0) {
+            shard_rebuild(shard, now);
+            continue;
+        }
+        if (empty) {
+            /* Over the load target but every entry is still needed. */
+            shard->used++;
+            entry_reset(empty, key, now);
+            return empty;
         }
-        fprintf(stderr, "Warning: rate-limit table full, evicting active IP %s "
-                "(%d active connections lost)\n",
-                g_rate_limits[oldest_idx].ip,
-                g_rate_limits[oldest_idx].active_connections);
     }
 
-    /* Reset and reuse */
-    strncpy(g_rate_limits[oldest_idx].ip, ip, sizeof(g_rate_limits[oldest_idx].ip) - 1);
-    g_rate_limits[oldest_idx].ip[sizeof(g_rate_limits[oldest_idx].ip) - 1] = '\0';
-    g_rate_limits[oldest_idx].window_start = time(NULL);
-    g_rate_limits[oldest_idx].recent_connection_count = 0;
-    g_rate_limits[oldest_idx].active_connections = 0;
-    g_rate_limits[oldest_idx].auth_failure_count = 0;
-    g_rate_limits[oldest_idx].is_blocked = false;
-    g_rate_limits[oldest_idx].block_until = 0;
-    return &g_rate_limits[oldest_idx];
+    return NULL;
+}
+
+/* Lock the shard for `ip` and return its entry (NULL when not tracked and
+ * `create` is false, or the shard is full).  The caller must unlock
+ * *shard_out in every case. */
+static ip_rate_limit_t *ratelimit_acquire(const char *ip, time_t now,
+                                          bool create,
+                                          ratelimit_shard_t **shard_out) {
+    uint8_t key[RATELIMIT_KEY_LEN];
+    uint64_t hash;
+    ratelimit_shard_t *shard;
+
+    ensure_shards();
+    ratelimit_key(ip, key);
+    hash = key_hash(key);
+    shard = shard_for(hash);
+
+    pthread_mutex_lock(&shard->lock);
+    *shard_out = shard;
+    return shard_lookup(shard, key, hash, now, create);
 }
 
 bool ratelimit_check_ip(const char *ip) {
-    time_t now = time(NULL);
+    time_t now = ratelimit_now();
+    ratelimit_shard_t *shard;
+    ip_rate_limit_t *entry = ratelimit_acquire(ip, now, true, &shard);
 
-    pthread_mutex_lock(&g_rate_limit_lock);
-    ip_rate_limit_t *entry = get_rate_limit_entry(ip);
+    if (!entry) {
+        pthread_mutex_unlock(&shard->lock);
+        metrics_inc(METRIC_CONN_REJECTED_TABLE_FULL);
+        fprintf(stderr, "Rate-limit table full, rejecting %s\n", ip);
+        return false;
+    }
+    entry->last_seen = now;
 
     if (entry->active_connections >= g_max_conn_per_ip) {
-        pthread_mutex_unlock(&g_rate_limit_lock);
+        pthread_mutex_unlock(&shard->lock);
+        metrics_inc(METRIC_CONN_REJECTED_PER_IP);
         fprintf(stderr, "Concurrent IP limit reached for %s\n", ip);
         return false;
     }
 
     if (g_rate_limit_enabled && entry->is_blocked && now < entry->block_until) {
-        pthread_mutex_unlock(&g_rate_limit_lock);
-        fprintf(stderr, "Blocked IP %s (blocked until %ld)\n", ip, (long)entry->block_until);
+        time_t until = entry->block_until;
+        pthread_mutex_unlock(&shard->lock);
+        metrics_inc(METRIC_CONN_REJECTED_BLOCKED);
+        fprintf(stderr, "Blocked IP %s (blocked until %ld)\n", ip, (long)until);
         return false;
     }
 
@@ -142,48 +385,90 @@ bool ratelimit_check_ip(const char *ip) {
         if (entry->recent_connection_count > g_max_conn_rate_per_ip) {
             entry->is_blocked = true;
             entry->block_until = now + BLOCK_DURATION;
-            pthread_mutex_unlock(&g_rate_limit_lock);
+            pthread_mutex_unlock(&shard->lock);
+            metrics_inc(METRIC_CONN_REJECTED_RATE);
             fprintf(stderr, "Rate limit exceeded for IP %s\n", ip);
             return false;
         }
     }
 
     entry->active_connections++;
-    pthread_mutex_unlock(&g_rate_limit_lock);
+    pthread_mutex_unlock(&shard->lock);
     return true;
 }
 
 void ratelimit_record_auth_failure(const char *ip) {
-    time_t now = time(NULL);
+    time_t now = ratelimit_now();
+    ratelimit_shard_t *shard;
+    ip_rate_limit_t *entry;
+    int failures = 0;
 
     if (!g_rate_limit_enabled) {
         return;
     }
 
-    pthread_mutex_lock(&g_rate_limit_lock);
-    ip_rate_limit_t *entry = get_rate_limit_entry(ip);
-
-    entry->auth_failure_count++;
-    if (entry->auth_failure_count >= MAX_AUTH_FAILURES) {
-        entry->is_blocked = true;
-        entry->block_until = now + BLOCK_DURATION;
-        fprintf(stderr, "IP %s blocked due to %d auth failures\n", ip, entry->auth_failure_count);
+    entry = ratelimit_acquire(ip, now, true, &shard);
+    if (entry) {
+        entry->last_seen = now;
+        entry->auth_failure_count++;
+        failures = entry->auth_failure_count;
+        if (failures >= MAX_AUTH_FAILURES) {
+            entry->is_blocked = true;
+            entry->block_until = now + BLOCK_DURATION;
+        }
     }
+    pthread_mutex_unlock(&shard->lock);
 
-    pthread_mutex_unlock(&g_rate_limit_lock);
+    if (failures >= MAX_AUTH_FAILURES) {
+        metrics_inc(METRIC_AUTH_FAILURE_BLOCKS);
+        fprintf(stderr, "IP %s blocked due to %d auth failures\n", ip, failures);
+    }
 }
 
 void ratelimit_release_ip(const char *ip) {
+    time_t now;
+    ratelimit_shard_t *shard;
+    ip_rate_limit_t *entry;
+
     if (!ip || ip[0] == '\0') {
         return;
     }
 
-    pthread_mutex_lock(&g_rate_limit_lock);
-    ip_rate_limit_t *entry = get_rate_limit_entry(ip);
-    if (entry->active_connections > 0) {
+    now = ratelimit_now();
+    entry = ratelimit_acquire(ip, now, false, &shard);
+    if (entry && entry->active_connections > 0) {
         entry->active_connections--;
+        entry->last_seen = now;
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+size_t ratelimit_tracked_entries(void) {
+    time_t now = ratelimit_now();
+    size_t count = 0;
+
+    ensure_shards();
+    for (int s = 0; s < RATELIMIT_SHARDS; s++) {
+        pthread_mutex_lock(&g_shards[s].lock);
+        for (size_t i = 0; i < g_shards[s].capacity; i++) {
+            const ip_rate_limit_t *e = &g_shards[s].slots[i];
+            if (e->used && !entry_expired(e, now)) {
+                count++;
+            }
+        }
+        pthread_mutex_unlock(&g_shards[s].lock);
+    }
+    return count;
+}
+
+size_t ratelimit_table_capacity(void) {
+    size_t capacity = 0;
+
+    ensure_shards();
+    for (int s = 0; s < RATELIMIT_SHARDS; s++) {
+        capacity += g_shards[s].capacity;
     }
-    pthread_mutex_unlock(&g_rate_limit_lock);
+    return capacity;
 }
 
 bool ratelimit_check_and_increment_total(void) {
@@ -191,6 +476,7 @@ bool ratelimit_check_and_increment_total(void) {
 
     if (g_total_connections >= g_max_connections) {
         pthread_mutex_unlock(&g_conn_count_lock);
+        metrics_inc(METRIC_CONN_REJECTED_GLOBAL);
         return false;
     }
 
@@ -0,0 +1,81 @@
+#include "scratch.h"
+
+#define SCRATCH_ALIGN 16
+
+typedef struct {
+    char *base;
+    size_t used;
+    size_t high_water;
+} scratch_arena_t;
+
+static _Thread_local scratch_arena_t t_arena;
+static pthread_key_t g_arena_key;
+static pthread_once_t g_arena_key_once = PTHREAD_ONCE_INIT;
+
+/* _Thread_local storage has no destructor, so a pthread key frees the block
+ * when the thread exits. */
+static void arena_key_destroy(void *base) {
+    free(base);
+}
+
+static void arena_key_create(void) {
+    pthread_key_create(&g_arena_key, arena_key_destroy);
+}
+
+tnt_scratch_mark_t tnt_scratch_mark(void) {
+    return t_arena.used;
+}
+
+void *tnt_scratch_alloc(size_t size) {
+    size_t rounded;
+    void *ptr;
+
+    if (size == 0 || size > TNT_SCRATCH_CAPACITY) {
+        return NULL;
+    }
+
+    rounded = (size + SCRATCH_ALIGN - 1) & ~(size_t)(SCRATCH_ALIGN - 1);
+    if (rounded > TNT_SCRATCH_CAPACITY - t_arena.used) {
+        return NULL;
+    }
+
+    if (!t_arena.base) {
+        pthread_once(&g_arena_key_once, arena_key_create);
+        t_arena.base = malloc(TNT_SCRATCH_CAPACITY);
+        if (!t_arena.base) {
+            return NULL;
+        }
+        pthread_setspecific(g_arena_key, t_arena.base);
+    }
+
+    ptr = t_arena.base + t_arena.used;
+    t_arena.used += rounded;
+    if (t_arena.used > t_arena.high_water) {
+        t_arena.high_water = t_arena.used;
+    }
+    return ptr;
+}
+
+void tnt_scratch_release(tnt_scratch_mark_t mark) {
+    if (mark < t_arena.used) {
+        t_arena.used = mark;
+    }
+}
+
+void tnt_scratch_trim(void) {
+    if (!t_arena.base || t_arena.used != 0) {
+        return;
+    }
+
+    free(t_arena.base);
+    t_arena.base = NULL;
+    pthread_setspecific(g_arena_key, NULL);
+}
+
+size_t tnt_scratch_used(void) {
+    return t_arena.used;
+}
+
+size_t tnt_scratch_high_water(void) {
+    return t_arena.high_water;
+}
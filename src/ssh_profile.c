@@ -0,0 +1,141 @@
+#include "ssh_profile.h"
+
+static const tnt_host_key_info_t g_host_keys[] = {
+    { TNT_HOST_KEY_ED25519, "ed25519", HOST_KEY_ED25519_FILE, "Ed25519",
+      "ssh-ed25519" },
+    { TNT_HOST_KEY_ECDSA, "ecdsa", HOST_KEY_ECDSA_FILE, "ECDSA P-256",
+      "ecdsa-sha2-nistp256" },
+    { TNT_HOST_KEY_RSA, "rsa", HOST_KEY_FILE, "RSA 4096-bit",
+      "rsa-sha2-" },
+};
+
+/* "fast" puts the cheapest primitives first without dropping the common
+ * fallbacks: X25519 key exchange, AES-GCM (hardware accelerated on most
+ * servers) ahead of ChaCha20, encrypt-then-MAC SHA-256, and Ed25519 host
+ * key signatures.  "modern" removes the RSA/NIST fallbacks entirely. */
+static const tnt_ssh_profile_t g_profiles[] = {
+    {
+        "default",
+        "libssh defaults",
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+    },
+    {
+        "fast",
+        "cheapest handshake first, common fallbacks kept",
+        "curve25519-sha256,curve25519-sha256@libssh.org,"
+        "ecdh-sha2-nistp256,diffie-hellman-group14-sha256",
+        "aes128-gcm@openssh.com,chacha20-poly1305@openssh.com,"
+        "aes256-gcm@openssh.com,aes128-ctr,aes256-ctr",
+        "hmac-sha2-256-etm@openssh.com,hmac-sha2-256,"
+        "hmac-sha2-512-etm@openssh.com,hmac-sha2-512",
+        "ssh-ed25519,ecdsa-sha2-nistp256,rsa-sha2-256,rsa-sha2-512",
+    },
+    {
+        "modern",
+        "X25519, AEAD ciphers and Ed25519 only",
+        "curve25519-sha256,curve25519-sha256@libssh.org",
+        "chacha20-poly1305@openssh.com,aes128-gcm@openssh.com,"
+        "aes256-gcm@openssh.com",
+        "hmac-sha2-256-etm@openssh.com,hmac-sha2-512-etm@openssh.com",
+        "ssh-ed25519",
+    },
+};
+
+size_t tnt_host_key_info_count(void) {
+    return sizeof(g_host_keys) / sizeof(g_host_keys[0]);
+}
+
+const tnt_host_key_info_t *tnt_host_key_info_at(size_t index) {
+    return index < tnt_host_key_info_count() ? &g_host_keys[index] : NULL;
+}
+
+static const tnt_host_key_info_t *host_key_find(const char *name, size_t len) {
+    for (size_t i = 0; i < tnt_host_key_info_count(); i++) {
+        if (strlen(g_host_keys[i].name) == len &&
+            strncmp(g_host_keys[i].name, name, len) == 0) {
+            return &g_host_keys[i];
+        }
+    }
+    return NULL;
+}
+
+bool tnt_host_keys_parse(const char *text, unsigned int *required,
+                         unsigned int *optional) {
+    unsigned int mask = 0;
+    const char *p = text;
+
+    if (!text || !required || !optional) {
+        return false;
+    }
+
+    if (strcmp(text, "auto") == 0) {
+        *required = TNT_HOST_KEY_ED25519;
+        *optional = TNT_HOST_KEY_ALL & ~(unsigned int)TNT_HOST_KEY_ED25519;
+        return true;
+    }
+
+    while (*p) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        const tnt_host_key_info_t *info = host_key_find(p, len);
+
+        if (!info) {
+            return false;
+        }
+        mask |= (unsigned int)info->kind;
+        if (!end) {
+            break;
+        }
+        p = end + 1;
+        if (*p == '\0') {
+            return false;
+        }
+    }
+
+    if (mask == 0) {
+        return false;
+    }
+    *required = mask;
+    *optional = 0;
+    return true;
+}
+
+size_t tnt_ssh_profile_count(void) {
+    return sizeof(g_profiles) / sizeof(g_profiles[0]);
+}
+
+const tnt_ssh_profile_t *tnt_ssh_profile_at(size_t index) {
+    return index < tnt_ssh_profile_count() ? &g_profiles[index] : NULL;
+}
+
+const tnt_ssh_profile_t *tnt_ssh_profile_find(const char *name) {
+    if (!name) {
+        return NULL;
+    }
+    for (size_t i = 0; i < tnt_ssh_profile_count(); i++) {
+        if (strcmp(g_profiles[i].name, name) == 0) {
+            return &g_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+bool tnt_ssh_profile_accepts_host_keys(const tnt_ssh_profile_t *profile,
+                                       unsigned int loaded) {
+    if (!profile || loaded == 0) {
+        return false;
+    }
+    if (!profile->hostkey_algorithms) {
+        return true;
+    }
+    for (size_t i = 0; i < tnt_host_key_info_count(); i++) {
+        if ((loaded & (unsigned int)g_host_keys[i].kind) &&
+            strstr(profile->hostkey_algorithms, g_host_keys[i].algorithm)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,10 +1,21 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  /* for accept4() on glibc */
+#endif
 #include "ssh_server.h"
 #include "bootstrap.h"
+#include "capture.h"
 #include "commands.h"
 #include "config_defaults.h"
 #include "exec.h"
+#include "handoff.h"
 #include "input.h"
+#include "lock_profile.h"
+#include "metrics_http.h"
+#include "post_limit.h"
 #include "ratelimit.h"
+#include "ssh_profile.h"
+#include "timer_wheel.h"
+#include "trace.h"
 #include "tui.h"
 #include "utf8.h"
 #include <libssh/libssh.h>
@@ -13,32 +24,62 @@
 #include <libssh/callbacks.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netdb.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #include <signal.h>
 #include <ctype.h>
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <limits.h>
 
-#define TNT_SESSION_THREAD_STACK_SIZE ((size_t)1024 * 1024)
-
-/* Global SSH bind instance */
+/* Global SSH bind instance.  It carries host keys and algorithm options
+ * only; the listening sockets are ours so connections can be admitted before
+ * libssh allocates anything for them. */
 static ssh_bind g_sshbind = NULL;
 static int g_listen_port = TNT_DEFAULT_PORT;
 
+/* Upper bound for TNT_ACCEPTORS=0 (one acceptor per online CPU). */
+#define ACCEPTORS_AUTO_MAX 8
+
+/* Acceptor threads.  With SO_REUSEPORT each has its own listening socket and
+ * the kernel spreads new connections across them; without it they share
+ * listen_fds[0] and poll the same queue.  Sockets inherited from systemd or
+ * a previous process are spread over the acceptors the same way. */
+static int g_listen_fds[TNT_MAX_ACCEPTORS];
+static int g_acceptor_count = 0;
+static const char *g_listen_source = "";
+static bool g_took_over = false;      /* Listeners came from --takeover */
+static pthread_attr_t g_session_attr;
+
+/* Set once the listeners were handed to a new process.  Acceptors wake on
+ * g_wake_pipe, return, and the process drains its sessions. */
+static atomic_bool g_draining = false;
+static atomic_int g_acceptors_running = 0;
+static int g_wake_pipe[2] = { -1, -1 };
+
+/* ssh_bind_accept_fd() imports the host keys into the shared bind on first
+ * use and copies them into each session; it does no network I/O, so one
+ * lock around it costs little and keeps the bind single-writer. */
+static pthread_mutex_t g_bind_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static time_t g_server_start_time = 0;
 
 time_t ssh_server_start_time(void) {
     return g_server_start_time;
 }
 
+bool ssh_server_took_over(void) {
+    return g_took_over;
+}
+
 /* Configuration from environment variables.  Rate-limiting moved to ratelimit.{c,h},
  * the access token to bootstrap.{c,h}, and the idle timeout to input.{c,h}. */
 
-static int generate_rsa_host_key(ssh_key *key) {
+static int generate_host_key(const tnt_host_key_info_t *info, ssh_key *key) {
 #if defined(LIBSSH_VERSION_INT) && LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 12, 0)
     ssh_pki_ctx pki_ctx = ssh_pki_ctx_new();
     int rsa_bits = 4096;
@@ -47,26 +88,96 @@ static int generate_rsa_host_key(ssh_key *key) {
     if (!pki_ctx) {
         return -1;
     }
-    if (ssh_pki_ctx_options_set(pki_ctx, SSH_PKI_OPTION_RSA_KEY_SIZE,
+    if (info->kind == TNT_HOST_KEY_RSA &&
+        ssh_pki_ctx_options_set(pki_ctx, SSH_PKI_OPTION_RSA_KEY_SIZE,
                                 &rsa_bits) < 0) {
         ssh_pki_ctx_free(pki_ctx);
         return -1;
     }
 
-    rc = ssh_pki_generate_key(SSH_KEYTYPE_RSA, pki_ctx, key);
+    switch (info->kind) {
+    case TNT_HOST_KEY_ED25519:
+        rc = ssh_pki_generate_key(SSH_KEYTYPE_ED25519, pki_ctx, key);
+        break;
+    case TNT_HOST_KEY_ECDSA:
+        rc = ssh_pki_generate_key(SSH_KEYTYPE_ECDSA_P256, pki_ctx, key);
+        break;
+    default:
+        rc = ssh_pki_generate_key(SSH_KEYTYPE_RSA, pki_ctx, key);
+        break;
+    }
     ssh_pki_ctx_free(pki_ctx);
     return rc;
 #else
-    return ssh_pki_generate(SSH_KEYTYPE_RSA, 4096, key);
+    switch (info->kind) {
+    case TNT_HOST_KEY_ED25519:
+        return ssh_pki_generate(SSH_KEYTYPE_ED25519, 0, key);
+    case TNT_HOST_KEY_ECDSA:
+        return ssh_pki_generate(SSH_KEYTYPE_ECDSA_P256, 256, key);
+    default:
+        return ssh_pki_generate(SSH_KEYTYPE_RSA, 4096, key);
+    }
 #endif
 }
 
-/* Generate or load SSH host key */
-static int setup_host_key(ssh_bind sshbind) {
+/* Generate a key of the given type and atomically install it at `path`. */
+static int write_host_key(const tnt_host_key_info_t *info, const char *path) {
+    char temp_key_file[PATH_MAX];
+    ssh_key key;
+    mode_t old_umask;
+
+    printf("Generating new %s host key...\n", info->label);
+    if (generate_host_key(info, &key) < 0) {
+        fprintf(stderr, "Failed to generate %s key\n", info->label);
+        return -1;
+    }
+
+    /* Create temporary file with secure permissions (atomic operation) */
+    if (snprintf(temp_key_file, sizeof(temp_key_file), "%s.tmp.%d",
+                 path, getpid()) >= (int)sizeof(temp_key_file)) {
+        fprintf(stderr, "Temporary key path is too long\n");
+        ssh_key_free(key);
+        return -1;
+    }
+
+    /* Set umask to ensure restrictive permissions before file creation */
+    old_umask = umask(0077);
+
+    /* Export key to temporary file */
+    if (ssh_pki_export_privkey_file(key, NULL, NULL, NULL, temp_key_file) < 0) {
+        fprintf(stderr, "Failed to export host key\n");
+        ssh_key_free(key);
+        umask(old_umask);
+        return -1;
+    }
+
+    ssh_key_free(key);
+
+    /* Restore original umask */
+    umask(old_umask);
+
+    /* Ensure restrictive permissions */
+    chmod(temp_key_file, 0600);
+
+    /* Atomically replace the old key file (if any) */
+    if (rename(temp_key_file, path) < 0) {
+        fprintf(stderr, "Failed to rename temporary key file\n");
+        unlink(temp_key_file);
+        return -1;
+    }
+    return 0;
+}
+
+/* Load one host key, generating it first if it is required and missing.
+ * Returns 1 if loaded, 0 if skipped, -1 on error. */
+static int setup_one_host_key(ssh_bind sshbind, const tnt_host_key_info_t *info,
+                              bool required) {
     struct stat st;
     char host_key_path[PATH_MAX];
+    bool exists = false;
 
-    if (tnt_state_path(host_key_path, sizeof(host_key_path), HOST_KEY_FILE) < 0) {
+    if (tnt_state_path(host_key_path, sizeof(host_key_path),
+                       info->file_name) < 0) {
         fprintf(stderr, "State directory path is too long\n");
         return -1;
     }
@@ -88,79 +199,419 @@ static int setup_host_key(ssh_bind sshbind) {
                 fprintf(stderr, "Warning: Fixing insecure key file permissions\n");
                 chmod(host_key_path, 0600);
             }
+            exists = true;
+        }
+    }
 
-            /* Load existing key */
-            if (ssh_bind_options_set(sshbind, SSH_BIND_OPTIONS_RSAKEY, host_key_path) < 0) {
-                fprintf(stderr, "Failed to load host key: %s\n", ssh_get_error(sshbind));
-                return -1;
-            }
+    if (!exists) {
+        if (!required) {
             return 0;
         }
+        if (write_host_key(info, host_key_path) < 0) {
+            return -1;
+        }
     }
 
-    /* Generate new key */
-    printf("Generating new RSA 4096-bit host key...\n");
-    ssh_key key;
-    if (generate_rsa_host_key(&key) < 0) {
-        fprintf(stderr, "Failed to generate RSA key\n");
+    /* HOSTKEY detects the type, so each key fills its own slot */
+    if (ssh_bind_options_set(sshbind, SSH_BIND_OPTIONS_HOSTKEY, host_key_path) < 0) {
+        fprintf(stderr, "Failed to load %s host key: %s\n", info->label,
+                ssh_get_error(sshbind));
         return -1;
     }
+    return 1;
+}
 
-    /* Create temporary file with secure permissions (atomic operation) */
-    char temp_key_file[PATH_MAX];
-    if (snprintf(temp_key_file, sizeof(temp_key_file), "%s.tmp.%d",
-                 host_key_path, getpid()) >= (int)sizeof(temp_key_file)) {
-        fprintf(stderr, "Temporary key path is too long\n");
-        ssh_key_free(key);
+/* Generate or load SSH host keys.  Returns the mask of loaded types. */
+static int setup_host_keys(ssh_bind sshbind) {
+    const char *spec = getenv("TNT_HOST_KEYS");
+    unsigned int required;
+    unsigned int optional;
+    unsigned int loaded = 0;
+
+    if (!spec || spec[0] == '\0') {
+        spec = TNT_HOST_KEYS_DEFAULT;
+    }
+    if (!tnt_host_keys_parse(spec, &required, &optional)) {
+        fprintf(stderr, "Invalid TNT_HOST_KEYS: %s\n", spec);
         return -1;
     }
 
-    /* Set umask to ensure restrictive permissions before file creation */
-    mode_t old_umask = umask(0077);
+    for (size_t i = 0; i < tnt_host_key_info_count(); i++) {
+        const tnt_host_key_info_t *info = tnt_host_key_info_at(i);
+        unsigned int kind = (unsigned int)info->kind;
+        int rc;
 
-    /* Export key to temporary file */
-    if (ssh_pki_export_privkey_file(key, NULL, NULL, NULL, temp_key_file) < 0) {
-        fprintf(stderr, "Failed to export host key\n");
-        ssh_key_free(key);
-        umask(old_umask);
+        if (!((required | optional) & kind)) {
+            continue;
+        }
+        rc = setup_one_host_key(sshbind, info, (required & kind) != 0);
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc > 0) {
+            loaded |= kind;
+        }
+    }
+
+    return (int)loaded;
+}
+
+/* Apply the TNT_SSH_PROFILE algorithm preferences to the bind. */
+static int apply_ssh_profile(ssh_bind sshbind, unsigned int loaded_keys) {
+    const char *name = getenv("TNT_SSH_PROFILE");
+    const tnt_ssh_profile_t *profile;
+
+    if (!name || name[0] == '\0') {
+        name = TNT_SSH_PROFILE_DEFAULT;
+    }
+    profile = tnt_ssh_profile_find(name);
+    if (!profile) {
+        fprintf(stderr, "Unknown TNT_SSH_PROFILE: %s\n", name);
+        return -1;
+    }
+    if (!tnt_ssh_profile_accepts_host_keys(profile, loaded_keys)) {
+        fprintf(stderr, "SSH profile '%s' cannot use any loaded host key "
+                "(check TNT_HOST_KEYS)\n", profile->name);
         return -1;
     }
 
-    ssh_key_free(key);
+    const struct {
+        enum ssh_bind_options_e option;
+        const char *value;
+        const char *label;
+    } options[] = {
+        { SSH_BIND_OPTIONS_KEY_EXCHANGE, profile->key_exchange, "key exchange" },
+        { SSH_BIND_OPTIONS_CIPHERS_C_S, profile->ciphers, "ciphers" },
+        { SSH_BIND_OPTIONS_CIPHERS_S_C, profile->ciphers, "ciphers" },
+        { SSH_BIND_OPTIONS_HMAC_C_S, profile->hmac, "MACs" },
+        { SSH_BIND_OPTIONS_HMAC_S_C, profile->hmac, "MACs" },
+        { SSH_BIND_OPTIONS_HOSTKEY_ALGORITHMS, profile->hostkey_algorithms,
+          "host key algorithms" },
+    };
+
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+        if (!options[i].value) {
+            continue;
+        }
+        if (ssh_bind_options_set(sshbind, options[i].option,
+                                 options[i].value) < 0) {
+            fprintf(stderr, "SSH profile '%s': unsupported %s: %s\n",
+                    profile->name, options[i].label, ssh_get_error(sshbind));
+            return -1;
+        }
+    }
 
-    /* Restore original umask */
-    umask(old_umask);
+    return 0;
+}
 
-    /* Ensure restrictive permissions */
-    chmod(temp_key_file, 0600);
+static void set_cloexec(int fd) {
+    int flags = fcntl(fd, F_GETFD);
 
-    /* Atomically replace the old key file (if any) */
-    if (rename(temp_key_file, host_key_path) < 0) {
-        fprintf(stderr, "Failed to rename temporary key file\n");
-        unlink(temp_key_file);
+    if (flags >= 0) {
+        fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+}
+
+#define LISTEN_REUSEPORT 0x1  /* Join the port's SO_REUSEPORT group */
+#define LISTEN_PROBE     0x2  /* Bind only, to see whether the port is free */
+
+/* Open a listening socket for bind_addr:port.  Returns the fd or -1. */
+static int open_listen_socket(const char *bind_addr, int port, int flags) {
+    bool reuseport = (flags & LISTEN_REUSEPORT) != 0;
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    char port_text[16];
+    int fd = -1;
+    int rc;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    snprintf(port_text, sizeof(port_text), "%d", port);
+
+    rc = getaddrinfo(bind_addr, port_text, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to resolve bind address %s: %s\n", bind_addr,
+                gai_strerror(rc));
         return -1;
     }
 
-    /* Load the newly created key */
-    if (ssh_bind_options_set(sshbind, SSH_BIND_OPTIONS_RSAKEY, host_key_path) < 0) {
-        fprintf(stderr, "Failed to load host key: %s\n", ssh_get_error(sshbind));
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        int one = 1;
+
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        set_cloexec(fd);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+        if (reuseport &&
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+            rc = errno;
+            close(fd);
+            fd = -1;
+            errno = rc;
+            break;
+        }
+#else
+        if (reuseport) {
+            close(fd);
+            fd = -1;
+            errno = ENOPROTOOPT;
+            break;
+        }
+#endif
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+            ((flags & LISTEN_PROBE) || listen(fd, TNT_LISTEN_BACKLOG) == 0)) {
+            break;
+        }
+        rc = errno;
+        close(fd);
+        fd = -1;
+        errno = rc;
+    }
+
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int acceptor_count_from_config(void) {
+    int count = tnt_config_env_int(&TNT_CONFIG_ACCEPTORS);
+
+    if (count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        count = cpus > 0 ? (int)cpus : 1;
+        if (count > ACCEPTORS_AUTO_MAX) {
+            count = ACCEPTORS_AUTO_MAX;
+        }
+    }
+    return count;
+}
+
+static void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+
+    if (flags >= 0) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
+/* Spread inherited listening sockets over the acceptors: at least one
+ * acceptor per socket, more share them round-robin. */
+static void adopt_listeners(const int *fds, int count, int acceptors,
+                            const char *source) {
+    if (acceptors < count) {
+        acceptors = count;
+    }
+    if (acceptors > TNT_MAX_ACCEPTORS) {
+        acceptors = TNT_MAX_ACCEPTORS;
+    }
+    for (int i = 0; i < acceptors; i++) {
+        g_listen_fds[i] = fds[i % count];
+    }
+    g_acceptor_count = acceptors;
+    g_listen_source = source;
+}
+
+/* systemd socket activation: LISTEN_FDS descriptors starting at fd 3,
+ * meant for us when LISTEN_PID matches. */
+static int activated_listeners(int *fds, int max) {
+    const char *pid_text = getenv("LISTEN_PID");
+    const char *fds_text = getenv("LISTEN_FDS");
+    int count = 0;
+    long n;
+
+    if (!pid_text || !fds_text || strtol(pid_text, NULL, 10) != (long)getpid()) {
+        return 0;
+    }
+    n = strtol(fds_text, NULL, 10);
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+
+    for (long i = 0; i < n && count < max; i++) {
+        int fd = 3 + (int)i;
+#ifdef SO_ACCEPTCONN
+        int listening = 0;
+        socklen_t len = sizeof(listening);
+
+        if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0 ||
+            !listening) {
+            fprintf(stderr, "Ignoring activated fd %d: not a listening socket\n",
+                    fd);
+            continue;
+        }
+#endif
+        set_cloexec(fd);
+        fds[count++] = fd;
+    }
+    return count;
+}
+
+/* Open one SO_REUSEPORT socket per acceptor.  A single acceptor, or a
+ * platform without SO_REUSEPORT, gets one plain socket that every acceptor
+ * shares.  Returns 0, or -1 with errno set if nothing could be bound. */
+static int open_listeners(const char *bind_addr, int port, int count) {
+    bool reuseport = false;
+
+    g_acceptor_count = count;
+    g_listen_source = "";
+
+    if (count > 1) {
+        /* A second server on this port would silently join our group and
+         * take half the connections; make sure nobody listens yet. */
+        int probe = open_listen_socket(bind_addr, port, LISTEN_PROBE);
+
+        if (probe < 0) {
+            return -1;
+        }
+        close(probe);
+
+        g_listen_fds[0] = open_listen_socket(bind_addr, port, LISTEN_REUSEPORT);
+        if (g_listen_fds[0] >= 0) {
+            reuseport = true;
+            g_listen_source = "SO_REUSEPORT";
+        } else if (errno != ENOPROTOOPT && errno != EINVAL) {
+            return -1;
+        }
+    }
+    if (!reuseport) {
+        g_listen_fds[0] = open_listen_socket(bind_addr, port, 0);
+        if (g_listen_fds[0] < 0) {
+            return -1;
+        }
+    }
+
+    for (int i = 1; i < count; i++) {
+        g_listen_fds[i] = reuseport
+                              ? open_listen_socket(bind_addr, port,
+                                                   LISTEN_REUSEPORT)
+                              : -1;
+        if (g_listen_fds[i] < 0) {
+            /* Not fatal: this acceptor shares the first socket. */
+            g_listen_fds[i] = g_listen_fds[0];
+        }
+    }
+    return 0;
+}
+
+/* Listening sockets come from systemd, from the process being replaced
+ * (--takeover), or are opened here, in that order. */
+static int setup_listeners(const char *bind_addr, int port) {
+    int acceptors = acceptor_count_from_config();
+    int fds[TNT_MAX_ACCEPTORS];
+    int count = activated_listeners(fds, TNT_MAX_ACCEPTORS);
+
+    if (count > 0) {
+        adopt_listeners(fds, count, acceptors, "socket activation");
+    } else if (env_int("TNT_TAKEOVER", 0, 0, 1)) {
+        char path[PATH_MAX];
+
+        if (tnt_state_path(path, sizeof(path), HANDOFF_SOCKET_FILE) == 0) {
+            count = handoff_request(path, fds, TNT_MAX_ACCEPTORS);
+        }
+        if (count > 0) {
+            adopt_listeners(fds, count, acceptors, "taken over");
+            g_took_over = true;
+        } else {
+            fprintf(stderr, "No running server to take over; binding port %d\n",
+                    port);
+        }
+    }
+    if (count <= 0 && open_listeners(bind_addr, port, acceptors) < 0) {
         return -1;
     }
 
+    for (int i = 0; i < g_acceptor_count; i++) {
+        set_nonblocking(g_listen_fds[i]);
+    }
     return 0;
 }
 
+/* Distinct listening fds (acceptors may share one).  Returns the count. */
+static int distinct_listeners(int *fds, int max) {
+    int count = 0;
+
+    for (int i = 0; i < g_acceptor_count && count < max; i++) {
+        bool seen = false;
+
+        for (int j = 0; j < count; j++) {
+            if (fds[j] == g_listen_fds[i]) {
+                seen = true;
+                break;
+            }
+        }
+        if (!seen) {
+            fds[count++] = g_listen_fds[i];
+        }
+    }
+    return count;
+}
+
+static int export_listeners(int *fds, int max, void *ctx) {
+    (void)ctx;
+    return distinct_listeners(fds, max);
+}
+
+/* Runs on the handoff thread once the new process holds the listeners. */
+static void stop_accepting(void *ctx) {
+    ssize_t ignored;
+
+    (void)ctx;
+    fprintf(stderr, "Listeners handed to a new process; no longer accepting\n");
+    atomic_store(&g_draining, true);
+    /* The new process binds the metrics address next. */
+    metrics_http_stop();
+    /* Never read: the pipe stays readable and wakes every acceptor. */
+    ignored = write(g_wake_pipe[1], "x", 1);
+    (void)ignored;
+}
+
+static int accept_client_fd(int listen_fd, struct sockaddr_storage *addr) {
+    socklen_t addr_len = sizeof(*addr);
+    int fd;
+
+#if defined(__linux__) && defined(SOCK_CLOEXEC)
+    fd = accept4(listen_fd, (struct sockaddr *)addr, &addr_len, SOCK_CLOEXEC);
+#else
+    fd = accept(listen_fd, (struct sockaddr *)addr, &addr_len);
+    if (fd >= 0) {
+        set_cloexec(fd);
+    }
+#endif
+    return fd;
+}
+
 /* Initialize SSH server */
 int ssh_server_init(int port) {
     /* Initialize rate-limit / connection-count subsystem */
     ratelimit_init();
 
+    /* Posting token buckets (TNT_POST_*) */
+    post_limit_init();
+
+    /* Lock contention profiling (TNT_LOCK_PROFILE), off by default */
+    lock_profile_set_enabled(tnt_config_env_int(&TNT_CONFIG_LOCK_PROFILE));
+
+    /* Session input capture for tnt_replay (TNT_CAPTURE), off by default */
+    if (capture_init() < 0) {
+        return -1;
+    }
+
     /* Initialize bootstrap (reads TNT_ACCESS_TOKEN) */
     bootstrap_init();
 
     /* Idle timeout stays here until input.c is extracted in PR2-M5 */
     /* Initialize idle-timeout subsystem */
     input_init();
+
+    /* Keepalive, idle and deferred-redraw deadlines for every session */
+    if (tnt_timer_service_start() < 0) {
+        return -1;
+    }
     g_listen_port = port;
     g_server_start_time = time(NULL);
 
@@ -170,28 +621,25 @@ int ssh_server_init(int port) {
         return -1;
     }
 
-    /* Set up host key */
-    if (setup_host_key(g_sshbind) < 0) {
+    /* Set up host keys and the algorithm profile that prefers them */
+    int host_keys = setup_host_keys(g_sshbind);
+    if (host_keys < 0 ||
+        apply_ssh_profile(g_sshbind, (unsigned int)host_keys) < 0) {
         ssh_bind_free(g_sshbind);
         return -1;
     }
 
-    /* Bind to port */
-    ssh_bind_options_set(g_sshbind, SSH_BIND_OPTIONS_BINDPORT, &port);
+    /* Configurable SSH log level (default: SSH_LOG_WARNING=1) */
+    int verbosity = env_int("TNT_SSH_LOG_LEVEL", SSH_LOG_WARNING, 0, 4);
+    ssh_bind_options_set(g_sshbind, SSH_BIND_OPTIONS_LOG_VERBOSITY, &verbosity);
 
     /* Configurable bind address (default: 0.0.0.0) */
     const char *bind_addr = getenv("TNT_BIND_ADDR");
     if (!bind_addr) {
         bind_addr = "0.0.0.0";
     }
-    ssh_bind_options_set(g_sshbind, SSH_BIND_OPTIONS_BINDADDR, bind_addr);
-
-    /* Configurable SSH log level (default: SSH_LOG_WARNING=1) */
-    int verbosity = env_int("TNT_SSH_LOG_LEVEL", SSH_LOG_WARNING, 0, 4);
-    ssh_bind_options_set(g_sshbind, SSH_BIND_OPTIONS_LOG_VERBOSITY, &verbosity);
-
-    if (ssh_bind_listen(g_sshbind) < 0) {
-        fprintf(stderr, "Failed to bind to port %d: %s\n", port, ssh_get_error(g_sshbind));
+    if (setup_listeners(bind_addr, port) < 0) {
+        fprintf(stderr, "Failed to bind to port %d: %s\n", port, strerror(errno));
         ssh_bind_free(g_sshbind);
         return -1;
     }
@@ -199,90 +647,253 @@ int ssh_server_init(int port) {
     return 0;
 }
 
+/* Admit one accepted socket and hand it to a session thread.  Every
+ * rejection path closes fd and returns what it reserved. */
+static void admit_connection(int fd, const struct sockaddr_storage *peer) {
+    char client_ip[INET6_ADDRSTRLEN];
+    ssh_session session;
+    accepted_session_t *accepted;
+    pthread_t thread;
+    uint64_t trace_us = trace_begin();
+    int rc;
+
+    bootstrap_format_ip(peer, client_ip, sizeof(client_ip));
+
+    /* Admission runs on the raw socket: rejected peers cost one
+     * accept() and close(), never a libssh session. */
+    if (!bootstrap_handshake_reserve()) {
+        fprintf(stderr, "Too many pending handshakes, rejecting %s\n",
+                client_ip);
+        close(fd);
+        return;
+    }
+
+    if (!ratelimit_check_and_increment_total()) {
+        fprintf(stderr, "Max connections reached, rejecting %s\n", client_ip);
+        bootstrap_handshake_release();
+        close(fd);
+        return;
+    }
+
+    if (!ratelimit_check_ip(client_ip)) {
+        bootstrap_handshake_release();
+        ratelimit_decrement_total();
+        close(fd);
+        return;
+    }
+
+    session = ssh_new();
+    if (!session) {
+        fprintf(stderr, "Failed to create SSH session\n");
+        bootstrap_handshake_release();
+        ratelimit_release_ip(client_ip);
+        ratelimit_decrement_total();
+        close(fd);
+        return;
+    }
+
+    pthread_mutex_lock(&g_bind_lock);
+    rc = ssh_bind_accept_fd(g_sshbind, session, fd);
+    if (rc != SSH_OK) {
+        fprintf(stderr, "Error accepting connection: %s\n", ssh_get_error(g_sshbind));
+    }
+    pthread_mutex_unlock(&g_bind_lock);
+    if (rc != SSH_OK) {
+        /* The session closes fd only if it already adopted it. */
+        if (ssh_get_fd(session) != fd) {
+            close(fd);
+        }
+        ssh_free(session);
+        bootstrap_handshake_release();
+        ratelimit_release_ip(client_ip);
+        ratelimit_decrement_total();
+        return;
+    }
+
+    accepted = bootstrap_accepted_session_new();
+    if (!accepted) {
+        bootstrap_handshake_release();
+        ratelimit_release_ip(client_ip);
+        ratelimit_decrement_total();
+        ssh_disconnect(session);
+        ssh_free(session);
+        return;
+    }
+
+    accepted->session = session;
+    snprintf(accepted->client_ip, sizeof(accepted->client_ip), "%s",
+             client_ip);
+
+    if (pthread_create(&thread, &g_session_attr, bootstrap_run, accepted) != 0) {
+        fprintf(stderr, "Thread creation failed: %s\n", strerror(errno));
+        bootstrap_accepted_session_free(accepted);
+        bootstrap_handshake_release();
+        ratelimit_release_ip(client_ip);
+        ratelimit_decrement_total();
+        ssh_disconnect(session);
+        ssh_free(session);
+        return;
+    }
+    trace_end(TRACE_EV_ACCEPT, trace_us, 0);
+}
+
+static void *acceptor_run(void *arg) {
+    int listen_fd = *(const int *)arg;
+    struct pollfd pfds[2] = {
+        { listen_fd, POLLIN, 0 },
+        { g_wake_pipe[0], POLLIN, 0 },
+    };
+
+    while (!atomic_load(&g_draining)) {
+        struct sockaddr_storage peer;
+        int fd;
+
+        if (poll(pfds, 2, -1) < 0) {
+            continue;
+        }
+        if (pfds[1].revents) {
+            break;
+        }
+
+        /* Acceptors sharing a socket all wake; the losers get EAGAIN. */
+        fd = accept_client_fd(listen_fd, &peer);
+        if (fd < 0) {
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+                errno == ENOMEM) {
+                /* Out of descriptors: back off instead of spinning. */
+                struct timespec delay = { 0, 10 * 1000000L };
+                fprintf(stderr, "Error accepting connection: %s\n", strerror(errno));
+                nanosleep(&delay, NULL);
+            } else if (errno != EINTR && errno != ECONNABORTED &&
+                       errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "Error accepting connection: %s\n", strerror(errno));
+            }
+            continue;
+        }
+
+#ifndef __linux__
+        /* BSDs copy O_NONBLOCK from the listener; libssh wants blocking. */
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+#endif
+        admit_connection(fd, &peer);
+    }
+
+    atomic_fetch_sub(&g_acceptors_running, 1);
+    return NULL;
+}
+
+/* After a handoff: close our copies of the listeners (the new process keeps
+ * them open) and give open sessions TNT_DRAIN_TIMEOUT seconds to end. */
+static int drain_sessions(void) {
+    struct timespec delay = { 0, 200 * 1000000L };
+    int fds[TNT_MAX_ACCEPTORS];
+    int count;
+    int timeout = tnt_config_env_int(&TNT_CONFIG_DRAIN_TIMEOUT);
+    uint64_t deadline;
+
+    while (atomic_load(&g_acceptors_running) > 0) {
+        nanosleep(&delay, NULL);
+    }
+    count = distinct_listeners(fds, TNT_MAX_ACCEPTORS);
+    for (int i = 0; i < count; i++) {
+        close(fds[i]);
+    }
+
+    fprintf(stderr, "Draining %d session(s), up to %d s\n",
+            ratelimit_get_active_total(), timeout);
+    deadline = tnt_monotonic_ms() + (uint64_t)timeout * 1000u;
+    while (ratelimit_get_active_total() > 0 && tnt_monotonic_ms() < deadline) {
+        nanosleep(&delay, NULL);
+    }
+
+    if (ratelimit_get_active_total() > 0) {
+        /* Session threads still use the room; leave like SIGTERM does. */
+        fprintf(stderr, "Drain timeout, closing %d session(s)\n",
+                ratelimit_get_active_total());
+        fflush(stderr);
+        _exit(0);
+    }
+    fprintf(stderr, "Drain complete\n");
+    return 0;
+}
+
 /* Start SSH server (blocking) */
 int ssh_server_start(int unused) {
     (void)unused;
     const char *public_host = getenv("TNT_PUBLIC_HOST");
-    pthread_attr_t attr;
+    pthread_attr_t acceptor_attr;
     if (!public_host || public_host[0] == '\0') {
         public_host = "localhost";
     }
 
     printf("TNT chat server listening on port %d (SSH)\n", g_listen_port);
     printf("Connect with: ssh -p %d %s\n", g_listen_port, public_host);
+    printf("Accepting on %d thread%s%s%s%s\n", g_acceptor_count,
+           g_acceptor_count == 1 ? "" : "s",
+           g_listen_source[0] ? " (" : "", g_listen_source,
+           g_listen_source[0] ? ")" : "");
     fflush(stdout);
 
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pipe(g_wake_pipe) < 0) {
+        fprintf(stderr, "Failed to create acceptor wake pipe: %s\n",
+                strerror(errno));
+        return -1;
+    }
+    set_cloexec(g_wake_pipe[0]);
+    set_cloexec(g_wake_pipe[1]);
+    {
+        char path[PATH_MAX];
+
+        /* Offer the listeners to a future `tnt --takeover` */
+        if (tnt_state_path(path, sizeof(path), HANDOFF_SOCKET_FILE) < 0 ||
+            handoff_server_start(path, export_listeners, stop_accepting,
+                                 NULL) < 0) {
+            fprintf(stderr, "Warning: listener handoff unavailable: %s\n",
+                    strerror(errno));
+        }
+    }
+
+    pthread_attr_init(&g_session_attr);
+    pthread_attr_setdetachstate(&g_session_attr, PTHREAD_CREATE_DETACHED);
     {
-        size_t stack_size = TNT_SESSION_THREAD_STACK_SIZE;
+        /* Large temporaries live in per-thread scratch arenas, so session
+         * threads only need room for call frames and libssh. */
+        size_t stack_size =
+            (size_t)tnt_config_env_int(&TNT_CONFIG_SESSION_STACK_KB) * 1024;
 #ifdef PTHREAD_STACK_MIN
-        if (stack_size < PTHREAD_STACK_MIN) {
-            stack_size = PTHREAD_STACK_MIN;
+        if (stack_size < (size_t)PTHREAD_STACK_MIN) {
+            stack_size = (size_t)PTHREAD_STACK_MIN;
         }
 #endif
-        if (pthread_attr_setstacksize(&attr, stack_size) != 0) {
+        if (pthread_attr_setstacksize(&g_session_attr, stack_size) != 0) {
             fprintf(stderr, "Warning: could not set session thread stack size\n");
         }
     }
 
-    while (1) {
-        ssh_session session = ssh_new();
-        char client_ip[INET6_ADDRSTRLEN];
-        accepted_session_t *accepted;
+    /* Acceptors only loop over accept() and admission; the default stack
+     * is more than they need but they are few. */
+    pthread_attr_init(&acceptor_attr);
+    pthread_attr_setdetachstate(&acceptor_attr, PTHREAD_CREATE_DETACHED);
+    atomic_store(&g_acceptors_running, g_acceptor_count);
+    for (int i = 1; i < g_acceptor_count; i++) {
         pthread_t thread;
 
-        if (!session) {
-            fprintf(stderr, "Failed to create SSH session\n");
-            continue;
-        }
-
-        /* Accept connection */
-        if (ssh_bind_accept(g_sshbind, session) != SSH_OK) {
-            fprintf(stderr, "Error accepting connection: %s\n", ssh_get_error(g_sshbind));
-            ssh_free(session);
-            continue;
-        }
-
-        bootstrap_peer_ip(session, client_ip, sizeof(client_ip));
-
-        /* Check total connection limit */
-        if (!ratelimit_check_and_increment_total()) {
-            fprintf(stderr, "Max connections reached, rejecting %s\n", client_ip);
-            ssh_disconnect(session);
-            ssh_free(session);
-            continue;
-        }
-
-        if (!ratelimit_check_ip(client_ip)) {
-            ratelimit_decrement_total();
-            ssh_disconnect(session);
-            ssh_free(session);
-            continue;
-        }
-
-        accepted = calloc(1, sizeof(*accepted));
-        if (!accepted) {
-            ratelimit_release_ip(client_ip);
-            ratelimit_decrement_total();
-            ssh_disconnect(session);
-            ssh_free(session);
-            continue;
-        }
-
-        accepted->session = session;
-        snprintf(accepted->client_ip, sizeof(accepted->client_ip), "%s",
-                 client_ip);
-
-        if (pthread_create(&thread, &attr, bootstrap_run, accepted) != 0) {
-            fprintf(stderr, "Thread creation failed: %s\n", strerror(errno));
-            free(accepted);
-            ratelimit_release_ip(client_ip);
-            ratelimit_decrement_total();
-            ssh_disconnect(session);
-            ssh_free(session);
-            continue;
+        if (pthread_create(&thread, &acceptor_attr, acceptor_run,
+                           &g_listen_fds[i]) != 0) {
+            fprintf(stderr, "Warning: could not start acceptor %d: %s\n", i,
+                    strerror(errno));
+            atomic_fetch_sub(&g_acceptors_running, 1);
+            /* Leave the SO_REUSEPORT group so the kernel stops routing
+             * connections to a queue nobody accepts from. */
+            if (g_listen_fds[i] != g_listen_fds[0]) {
+                close(g_listen_fds[i]);
+                g_listen_fds[i] = g_listen_fds[0];
+            }
         }
     }
-    /* Unreachable — the while(1) loop only exits via signal/_exit(). */
+    pthread_attr_destroy(&acceptor_attr);
+
+    /* The calling thread is acceptor 0.  It returns only after a handoff. */
+    acceptor_run(&g_listen_fds[0]);
+    return drain_sessions();
 }
@@ -0,0 +1,494 @@
+#include "timer_wheel.h"
+
+#define SLOT_MASK ((uint64_t)TNT_TIMER_WHEEL_SLOTS - 1)
+#define MAX_DELAY_TICKS \
+    (((uint64_t)1 << (TNT_TIMER_WHEEL_SLOT_BITS * TNT_TIMER_WHEEL_LEVELS)) - 1)
+
+/* The process-wide service wheel and the thread that drives it. */
+static tnt_timer_wheel_t g_service_wheel;
+static pthread_t g_service_thread;
+static atomic_bool g_service_running = false;
+static bool g_service_threaded = false;
+static pthread_mutex_t g_service_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_service_cond;
+static uint64_t g_service_sleep_until = UINT64_MAX;
+static bool g_service_kicked = false;
+
+static void timer_service_note_due(uint64_t due_ms);
+
+uint64_t tnt_monotonic_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void list_unlink(tnt_timer_t *timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+static void list_append(tnt_timer_t *head, tnt_timer_t *timer) {
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+/* Place a timer by its distance from the current tick.  Caller holds lock. */
+static void wheel_place(tnt_timer_wheel_t *wheel, tnt_timer_t *timer) {
+    uint64_t delta;
+    int level = 0;
+
+    if (timer->expires_tick < wheel->current_tick) {
+        timer->expires_tick = wheel->current_tick;
+    }
+    delta = timer->expires_tick - wheel->current_tick;
+    if (delta > MAX_DELAY_TICKS) {
+        delta = MAX_DELAY_TICKS;
+        timer->expires_tick = wheel->current_tick + delta;
+    }
+
+    while (level < TNT_TIMER_WHEEL_LEVELS - 1 &&
+           delta >= ((uint64_t)1 << (TNT_TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+
+    list_append(&wheel->slots[level][(timer->expires_tick >>
+                                      (TNT_TIMER_WHEEL_SLOT_BITS * level)) &
+                                     SLOT_MASK],
+                timer);
+}
+
+static void wheel_cascade(tnt_timer_wheel_t *wheel, int level, uint64_t tick) {
+    tnt_timer_t *head = &wheel->slots[level][(tick >>
+                                              (TNT_TIMER_WHEEL_SLOT_BITS * level)) &
+                                             SLOT_MASK];
+
+    while (head->next != head) {
+        tnt_timer_t *timer = head->next;
+
+        list_unlink(timer);
+        wheel_place(wheel, timer);
+    }
+}
+
+/* First tick at or after current_tick whose processing fires a timer or
+ * cascades a non-empty slot, or UINT64_MAX.  Level-0 timers are all due
+ * within one lap of the wheel; higher levels are only visited on their
+ * block boundaries.  Caller holds lock. */
+static uint64_t wheel_next_tick(tnt_timer_wheel_t *wheel) {
+    uint64_t best = UINT64_MAX;
+
+    if (wheel->pending == 0) {
+        return best;
+    }
+
+    for (uint64_t i = 0; i < TNT_TIMER_WHEEL_SLOTS; i++) {
+        uint64_t tick = wheel->current_tick + i;
+        tnt_timer_t *head = &wheel->slots[0][tick & SLOT_MASK];
+
+        if (head->next != head) {
+            best = tick;
+            break;
+        }
+    }
+
+    for (int level = 1; level < TNT_TIMER_WHEEL_LEVELS; level++) {
+        int shift = TNT_TIMER_WHEEL_SLOT_BITS * level;
+        uint64_t step = (uint64_t)1 << shift;
+        uint64_t tick = (wheel->current_tick + step - 1) & ~(step - 1);
+
+        for (int i = 0; i < TNT_TIMER_WHEEL_SLOTS && tick < best;
+             i++, tick += step) {
+            tnt_timer_t *head = &wheel->slots[level][(tick >> shift) &
+                                                     SLOT_MASK];
+
+            if (head->next != head) {
+                best = tick;
+                break;
+            }
+        }
+    }
+
+    return best;
+}
+
+static size_t wheel_tick(tnt_timer_wheel_t *wheel, uint64_t now_ms) {
+    uint64_t tick = wheel->current_tick;
+    tnt_timer_t *head;
+    size_t fired = 0;
+
+    /* Pull the next block of each higher level down once its turn comes. */
+    for (int level = TNT_TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+        uint64_t mask = ((uint64_t)1 << (TNT_TIMER_WHEEL_SLOT_BITS * level)) - 1;
+        if ((tick & mask) == 0) {
+            wheel_cascade(wheel, level, tick);
+        }
+    }
+
+    head = &wheel->slots[0][tick & SLOT_MASK];
+    wheel->current_tick = tick + 1;
+
+    while (head->next != head) {
+        tnt_timer_t *timer = head->next;
+        uint64_t again;
+
+        list_unlink(timer);
+        timer->pending = false;
+        wheel->pending--;
+        wheel->fired++;
+        fired++;
+
+        again = timer->fn ? timer->fn(timer->arg, now_ms) : 0;
+        if (again > 0) {
+            /* Re-arm on the tick grid so periodic timers keep their cadence,
+             * but count from now_ms when catching up after a stall. */
+            uint64_t next_tick = (now_ms - wheel->base_ms) / wheel->tick_ms;
+            if (next_tick < tick) {
+                next_tick = tick;
+            }
+            timer->expires_tick = next_tick +
+                                  (again + wheel->tick_ms - 1) / wheel->tick_ms;
+            timer->pending = true;
+            wheel->pending++;
+            wheel_place(wheel, timer);
+        }
+    }
+
+    return fired;
+}
+
+int tnt_timer_wheel_init(tnt_timer_wheel_t *wheel, uint64_t tick_ms,
+                         uint64_t now_ms) {
+    if (!wheel || tick_ms == 0) {
+        return -1;
+    }
+
+    memset(wheel, 0, sizeof(*wheel));
+    if (pthread_mutex_init(&wheel->lock, NULL) != 0) {
+        return -1;
+    }
+    wheel->tick_ms = tick_ms;
+    wheel->base_ms = now_ms;
+    atomic_store(&wheel->now_ms, now_ms);
+
+    for (int level = 0; level < TNT_TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TNT_TIMER_WHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot].next = &wheel->slots[level][slot];
+            wheel->slots[level][slot].prev = &wheel->slots[level][slot];
+        }
+    }
+
+    return 0;
+}
+
+void tnt_timer_wheel_destroy(tnt_timer_wheel_t *wheel) {
+    if (!wheel) {
+        return;
+    }
+
+    pthread_mutex_lock(&wheel->lock);
+    for (int level = 0; level < TNT_TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TNT_TIMER_WHEEL_SLOTS; slot++) {
+            tnt_timer_t *head = &wheel->slots[level][slot];
+            while (head->next != head) {
+                tnt_timer_t *timer = head->next;
+                list_unlink(timer);
+                timer->pending = false;
+            }
+        }
+    }
+    wheel->pending = 0;
+    pthread_mutex_unlock(&wheel->lock);
+    pthread_mutex_destroy(&wheel->lock);
+}
+
+void tnt_timer_init(tnt_timer_t *timer, tnt_timer_fn fn, void *arg) {
+    if (!timer) {
+        return;
+    }
+
+    memset(timer, 0, sizeof(*timer));
+    timer->fn = fn;
+    timer->arg = arg;
+}
+
+void tnt_timer_arm(tnt_timer_wheel_t *wheel, tnt_timer_t *timer,
+                   uint64_t delay_ms) {
+    uint64_t start;
+    uint64_t due_ms;
+
+    if (!wheel || !timer) {
+        return;
+    }
+
+    pthread_mutex_lock(&wheel->lock);
+    if (timer->pending) {
+        list_unlink(timer);
+    } else {
+        timer->pending = true;
+        wheel->pending++;
+    }
+    /* current_tick is already past the wheel clock, so rounding the delay
+     * up keeps the deadline at or after now + delay_ms.  A realtime wheel
+     * can lag the clock while its thread sleeps; count from the clock. */
+    start = wheel->current_tick;
+    if (wheel->realtime) {
+        uint64_t now_ms = tnt_monotonic_ms();
+        uint64_t now_tick = now_ms > wheel->base_ms
+                            ? (now_ms - wheel->base_ms) / wheel->tick_ms : 0;
+
+        if (now_tick + 1 > start) {
+            start = now_tick + 1;
+        }
+    }
+    timer->expires_tick = start +
+                          (delay_ms + wheel->tick_ms - 1) / wheel->tick_ms;
+    wheel_place(wheel, timer);
+    due_ms = wheel->base_ms + timer->expires_tick * wheel->tick_ms;
+    pthread_mutex_unlock(&wheel->lock);
+
+    if (wheel == &g_service_wheel) {
+        timer_service_note_due(due_ms);
+    }
+}
+
+bool tnt_timer_cancel(tnt_timer_wheel_t *wheel, tnt_timer_t *timer) {
+    bool was_pending = false;
+
+    if (!wheel || !timer) {
+        return false;
+    }
+
+    pthread_mutex_lock(&wheel->lock);
+    if (timer->pending) {
+        list_unlink(timer);
+        timer->pending = false;
+        wheel->pending--;
+        was_pending = true;
+    }
+    pthread_mutex_unlock(&wheel->lock);
+
+    return was_pending;
+}
+
+size_t tnt_timer_wheel_advance(tnt_timer_wheel_t *wheel, uint64_t now_ms) {
+    uint64_t target;
+    size_t fired = 0;
+
+    if (!wheel) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&wheel->lock);
+    if (now_ms < wheel->base_ms) {
+        now_ms = wheel->base_ms;
+    }
+    atomic_store(&wheel->now_ms, now_ms);
+    target = (now_ms - wheel->base_ms) / wheel->tick_ms;
+
+    while (wheel->current_tick <= target) {
+        /* Skip straight to the next tick with work; a realtime wheel may
+         * be many idle ticks behind the clock. */
+        uint64_t next = wheel_next_tick(wheel);
+
+        if (next > target) {
+            wheel->current_tick = target + 1;
+            break;
+        }
+        wheel->current_tick = next;
+        fired += wheel_tick(wheel, now_ms);
+    }
+    pthread_mutex_unlock(&wheel->lock);
+
+    return fired;
+}
+
+uint64_t tnt_timer_wheel_now_ms(tnt_timer_wheel_t *wheel) {
+    if (!wheel) {
+        return 0;
+    }
+    return wheel->realtime ? tnt_monotonic_ms() : atomic_load(&wheel->now_ms);
+}
+
+uint64_t tnt_timer_wheel_next_due_ms(tnt_timer_wheel_t *wheel) {
+    uint64_t tick;
+
+    if (!wheel) {
+        return UINT64_MAX;
+    }
+
+    pthread_mutex_lock(&wheel->lock);
+    tick = wheel_next_tick(wheel);
+    pthread_mutex_unlock(&wheel->lock);
+
+    return tick == UINT64_MAX ? UINT64_MAX
+                              : wheel->base_ms + tick * wheel->tick_ms;
+}
+
+size_t tnt_timer_wheel_pending(tnt_timer_wheel_t *wheel) {
+    size_t pending;
+
+    if (!wheel) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&wheel->lock);
+    pending = wheel->pending;
+    pthread_mutex_unlock(&wheel->lock);
+
+    return pending;
+}
+
+/* Wait until the monotonic time `due_ms` or a signal.  Caller holds
+ * g_service_lock. */
+static void timer_service_wait_until(uint64_t due_ms) {
+    struct timespec ts;
+    uint64_t now_ms = tnt_monotonic_ms();
+
+    if (due_ms <= now_ms) {
+        return;
+    }
+#ifdef __APPLE__
+    /* No monotonic condition variables: wait out the same span on the
+     * realtime clock. */
+    {
+        uint64_t delay_ms = due_ms - now_ms;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += (time_t)(delay_ms / 1000u);
+        ts.tv_nsec += (long)(delay_ms % 1000u) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+    }
+#else
+    ts.tv_sec = (time_t)(due_ms / 1000u);
+    ts.tv_nsec = (long)(due_ms % 1000u) * 1000000L;
+#endif
+    pthread_cond_timedwait(&g_service_cond, &g_service_lock, &ts);
+}
+
+/* Called after arming a service timer: wake the thread if it planned to
+ * sleep past `due_ms`. */
+static void timer_service_note_due(uint64_t due_ms) {
+    pthread_mutex_lock(&g_service_lock);
+    if (g_service_threaded && due_ms < g_service_sleep_until) {
+        g_service_kicked = true;
+        pthread_cond_signal(&g_service_cond);
+    }
+    pthread_mutex_unlock(&g_service_lock);
+}
+
+static void *timer_service_main(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_service_lock);
+    while (atomic_load(&g_service_running)) {
+        uint64_t due_ms;
+
+        /* While awake every arm counts as a kick, so a timer armed after
+         * next_due was read is not slept through. */
+        g_service_sleep_until = UINT64_MAX;
+        g_service_kicked = false;
+        pthread_mutex_unlock(&g_service_lock);
+
+        tnt_timer_wheel_advance(&g_service_wheel, tnt_monotonic_ms());
+        due_ms = tnt_timer_wheel_next_due_ms(&g_service_wheel);
+
+        pthread_mutex_lock(&g_service_lock);
+        if (!atomic_load(&g_service_running) || g_service_kicked) {
+            continue;
+        }
+        g_service_sleep_until = due_ms;
+        if (due_ms == UINT64_MAX) {
+            pthread_cond_wait(&g_service_cond, &g_service_lock);
+        } else {
+            timer_service_wait_until(due_ms);
+        }
+    }
+    pthread_mutex_unlock(&g_service_lock);
+
+    return NULL;
+}
+
+int tnt_timer_service_start(void) {
+    pthread_condattr_t cond_attr;
+
+    if (atomic_load(&g_service_running)) {
+        return 0;
+    }
+
+    if (tnt_timer_wheel_init(&g_service_wheel, TNT_TIMER_DEFAULT_TICK_MS,
+                             tnt_monotonic_ms()) < 0) {
+        fprintf(stderr, "Failed to initialize timer wheel\n");
+        return -1;
+    }
+    g_service_wheel.realtime = true;
+
+    pthread_condattr_init(&cond_attr);
+#ifndef __APPLE__
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(&g_service_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    atomic_store(&g_service_running, true);
+    pthread_mutex_lock(&g_service_lock);
+    g_service_threaded = true;
+    pthread_mutex_unlock(&g_service_lock);
+    if (pthread_create(&g_service_thread, NULL, timer_service_main, NULL) != 0) {
+        fprintf(stderr, "Failed to start timer thread\n");
+        pthread_mutex_lock(&g_service_lock);
+        g_service_threaded = false;
+        pthread_mutex_unlock(&g_service_lock);
+        atomic_store(&g_service_running, false);
+        pthread_cond_destroy(&g_service_cond);
+        tnt_timer_wheel_destroy(&g_service_wheel);
+        return -1;
+    }
+
+    return 0;
+}
+
+int tnt_timer_service_start_manual(uint64_t now_ms) {
+    if (atomic_load(&g_service_running)) {
+        return 0;
+    }
+
+    if (tnt_timer_wheel_init(&g_service_wheel, TNT_TIMER_DEFAULT_TICK_MS,
+                             now_ms) < 0) {
+        fprintf(stderr, "Failed to initialize timer wheel\n");
+        return -1;
+    }
+
+    g_service_threaded = false;
+    atomic_store(&g_service_running, true);
+    return 0;
+}
+
+void tnt_timer_service_stop(void) {
+    if (!atomic_exchange(&g_service_running, false)) {
+        return;
+    }
+
+    if (g_service_threaded) {
+        pthread_mutex_lock(&g_service_lock);
+        pthread_cond_signal(&g_service_cond);
+        pthread_mutex_unlock(&g_service_lock);
+        pthread_join(g_service_thread, NULL);
+        pthread_mutex_lock(&g_service_lock);
+        g_service_threaded = false;
+        pthread_mutex_unlock(&g_service_lock);
+        pthread_cond_destroy(&g_service_cond);
+    }
+    tnt_timer_wheel_destroy(&g_service_wheel);
+}
+
+tnt_timer_wheel_t *tnt_timer_service(void) {
+    return atomic_load(&g_service_running) ? &g_service_wheel : NULL;
+}
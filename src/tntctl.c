@@ -1,11 +1,13 @@
 #include "common.h"
 #include "config_defaults.h"
+#include "control.h"
 #include "exec_catalog.h"
 #include "i18n.h"
 #include "tntctl_text.h"
 
 #include <ctype.h>
 #include <errno.h>
+#include <pwd.h>
 #include <stdio.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -145,6 +147,34 @@ static int run_ssh(char **ssh_argv) {
     return TNT_EXIT_ERROR;
 }
 
+/* Talk to control.sock in the state directory instead of forking ssh.
+ * Like ssh, the post identity defaults to the local user name. */
+static int run_local(const char *login, const char *command, ui_lang_t lang) {
+    char path[PATH_MAX];
+    int rc;
+
+    if (!login) {
+        struct passwd *pw = getpwuid(geteuid());
+        login = pw ? pw->pw_name : NULL;
+    }
+
+    if (tnt_state_path(path, sizeof(path), CONTROL_SOCKET_FILE) < 0) {
+        print_error(lang, TNTCTL_TEXT_INVALID_STATE_DIR);
+        return TNT_EXIT_USAGE;
+    }
+
+    fflush(stdout);
+    rc = control_request(path, login, command, STDOUT_FILENO);
+    if (rc < 0) {
+        fprintf(stderr, "tntctl: ");
+        fprintf(stderr, tntctl_text(lang, TNTCTL_TEXT_CONTROL_UNAVAILABLE_FORMAT),
+                path);
+        fprintf(stderr, ": %s\n", strerror(errno));
+        return TNT_EXIT_UNAVAILABLE;
+    }
+    return rc;
+}
+
 int main(int argc, char **argv) {
     const char *port = TNT_DEFAULT_PORT_TEXT;
     const char *login = NULL;
@@ -159,6 +189,7 @@ int main(int argc, char **argv) {
     char **ssh_argv = NULL;
     int ssh_argc = 0;
     int rc;
+    bool local = false;
     ui_lang_t lang = i18n_default_ui_lang();
 
     for (i = 1; i < argc; i++) {
@@ -201,6 +232,16 @@ int main(int argc, char **argv) {
                 return TNT_EXIT_USAGE;
             }
             known_hosts = argv[++i];
+        } else if (strcmp(argv[i], "--local") == 0) {
+            local = true;
+        } else if (strcmp(argv[i], "-d") == 0 ||
+                   strcmp(argv[i], "--state-dir") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0' ||
+                setenv("TNT_STATE_DIR", argv[i + 1], 1) != 0) {
+                print_error(lang, TNTCTL_TEXT_INVALID_STATE_DIR);
+                return TNT_EXIT_USAGE;
+            }
+            i++;
         } else if (argv[i][0] == '-') {
             print_error_format(lang, TNTCTL_TEXT_UNKNOWN_OPTION_FORMAT,
                                argv[i]);
@@ -211,6 +252,19 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (local) {
+        if (i >= argc || !is_known_exec_command(argv[i])) {
+            print_error(lang, TNTCTL_TEXT_UNKNOWN_COMMAND);
+            return TNT_EXIT_USAGE;
+        }
+        if (build_remote_command(remote_command, sizeof(remote_command), argc,
+                                 argv, i) < 0) {
+            print_error(lang, TNTCTL_TEXT_INVALID_REMOTE_COMMAND);
+            return TNT_EXIT_USAGE;
+        }
+        return run_local(login, remote_command, lang);
+    }
+
     if (i >= argc) {
         print_error(lang, TNTCTL_TEXT_MISSING_HOST);
         print_usage(stderr, lang);
@@ -50,6 +50,12 @@ static const i18n_string_t text_catalog[TNTCTL_TEXT_COUNT] = {
     ),
     [TNTCTL_TEXT_KNOWN_HOSTS_OPTION_TOO_LONG] = I18N_STRING(
         "known_hosts option too long", "known_hosts 选项过长"
+    ),
+    [TNTCTL_TEXT_INVALID_STATE_DIR] = I18N_STRING(
+        "invalid state directory", "状态目录无效"
+    ),
+    [TNTCTL_TEXT_CONTROL_UNAVAILABLE_FORMAT] = I18N_STRING(
+        "cannot reach control socket %s", "无法连接控制套接字 %s"
     )
 };
 typedef char text_catalog_must_cover_enum[
@@ -60,6 +66,7 @@ void tntctl_text_append_usage(char *buffer, size_t buf_size, size_t *pos,
                               ui_lang_t lang) {
     static const i18n_string_t before_commands = I18N_STRING(
         "Usage: tntctl [options] host command [args...]\n"
+        "       tntctl --local [-d DIR] [-l USER] command [args...]\n"
         "\n"
         "Options:\n"
         "  -p, --port PORT        SSH port (default: " TNT_DEFAULT_PORT_TEXT ")\n"
@@ -67,12 +74,15 @@ void tntctl_text_append_usage(char *buffer, size_t buf_size, size_t *pos,
         "  --host-key-checking MODE\n"
         "                         OpenSSH host-key mode: yes, accept-new, no\n"
         "  --known-hosts FILE     OpenSSH known_hosts file\n"
+        "  --local                Use control.sock instead of ssh\n"
+        "  -d, --state-dir DIR    State directory of the local server\n"
         "  -V, --version          Print version and exit\n"
         "  -h, --help             Print this help and exit\n"
         "\n"
         "Commands:\n"
         "  ",
         "用法: tntctl [options] host command [args...]\n"
+        "      tntctl --local [-d DIR] [-l USER] command [args...]\n"
         "\n"
         "选项:\n"
         "  -p, --port PORT        SSH 端口 (默认: " TNT_DEFAULT_PORT_TEXT ")\n"
@@ -80,6 +90,8 @@ void tntctl_text_append_usage(char *buffer, size_t buf_size, size_t *pos,
         "  --host-key-checking MODE\n"
         "                         OpenSSH 主机密钥模式: yes, accept-new, no\n"
         "  --known-hosts FILE     OpenSSH known_hosts 文件\n"
+        "  --local                通过 control.sock 而不是 ssh 连接\n"
+        "  -d, --state-dir DIR    本机服务器的状态目录\n"
         "  -V, --version          输出版本并退出\n"
         "  -h, --help             输出此帮助并退出\n"
         "\n"
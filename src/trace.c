@@ -0,0 +1,281 @@
+#include "trace.h"
+#include "common.h"
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    uint64_t ts_us;
+    uint64_t arg;
+    uint32_t dur_us;
+    uint32_t tid;
+    uint16_t id;
+    bool instant;
+} trace_record_t;
+
+typedef struct {
+    trace_record_t events[TRACE_RING_EVENTS];
+    _Atomic uint64_t head;         /* Events written this generation */
+    _Atomic unsigned int generation;
+    bool in_use;                   /* Owned by a live thread; g_pool_lock */
+} trace_ring_t;
+
+static const struct {
+    const char *name;
+    const char *arg;               /* Name of the argument, or NULL */
+} g_trace_desc[TRACE_EV_COUNT] = {
+    [TRACE_EV_ACCEPT] = {"accept", NULL},
+    [TRACE_EV_KEX] = {"bootstrap_kex", NULL},
+    [TRACE_EV_AUTH] = {"bootstrap_auth", NULL},
+    [TRACE_EV_CHANNEL] = {"bootstrap_channel", NULL},
+    [TRACE_EV_ROOM_JOIN] = {"room_join", NULL},
+    [TRACE_EV_BROADCAST] = {"room_broadcast", NULL},
+    [TRACE_EV_RENDER] = {"render", "bytes"},
+    [TRACE_EV_FLUSH] = {"outbox_flush", "bytes"},
+    [TRACE_EV_MESSAGE_SAVE] = {"message_save", NULL},
+    [TRACE_EV_MODULE_DELIVER] = {"module_deliver", "event"},
+    [TRACE_EV_MODULE_RESPONSE] = {"module_response", "event"},
+};
+
+atomic_bool g_trace_enabled = false;
+
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_ring_key;
+static trace_ring_t *g_rings[TRACE_MAX_RINGS];
+static unsigned int g_ring_count;      /* g_pool_lock */
+
+static _Atomic unsigned int g_generation;
+static _Atomic uint64_t g_start_us;
+static _Atomic uint64_t g_untraced;
+static atomic_uint g_next_tid;
+
+static _Thread_local trace_ring_t *t_ring;
+static _Thread_local uint32_t t_tid;
+/* Generation in which this thread found the pool exhausted. */
+static _Thread_local unsigned int t_no_ring_generation = UINT_MAX;
+
+/* Thread exit: hand the ring back with its events intact. */
+static void trace_ring_release(void *arg) {
+    trace_ring_t *ring = arg;
+
+    pthread_mutex_lock(&g_pool_lock);
+    ring->in_use = false;
+    pthread_mutex_unlock(&g_pool_lock);
+}
+
+static void trace_key_init(void) {
+    pthread_key_create(&g_ring_key, trace_ring_release);
+}
+
+static trace_ring_t *trace_ring_acquire(void) {
+    trace_ring_t *ring = NULL;
+
+    pthread_once(&g_key_once, trace_key_init);
+
+    pthread_mutex_lock(&g_pool_lock);
+    for (unsigned int i = 0; i < g_ring_count; i++) {
+        if (!g_rings[i]->in_use) {
+            ring = g_rings[i];
+            break;
+        }
+    }
+    if (!ring && g_ring_count < TRACE_MAX_RINGS) {
+        ring = calloc(1, sizeof(*ring));
+        if (ring) {
+            g_rings[g_ring_count++] = ring;
+        }
+    }
+    if (ring) {
+        ring->in_use = true;
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+
+    if (ring && pthread_setspecific(g_ring_key, ring) != 0) {
+        trace_ring_release(ring);
+        ring = NULL;
+    }
+    return ring;
+}
+
+uint64_t trace_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+void trace_record(trace_event_id_t id, uint64_t start_us, uint64_t arg) {
+    unsigned int generation = atomic_load_explicit(&g_generation,
+                                                   memory_order_acquire);
+    trace_ring_t *ring = t_ring;
+    trace_record_t *event;
+    uint64_t now = trace_now_us();
+    uint64_t head;
+
+    /* A span still open when tracing stopped is dropped. */
+    if ((unsigned int)id >= TRACE_EV_COUNT ||
+        !atomic_load_explicit(&g_trace_enabled, memory_order_relaxed)) {
+        return;
+    }
+    if (!ring) {
+        if (t_no_ring_generation == generation ||
+            !(ring = trace_ring_acquire())) {
+            t_no_ring_generation = generation;
+            atomic_fetch_add_explicit(&g_untraced, 1, memory_order_relaxed);
+            return;
+        }
+        t_ring = ring;
+        if (t_tid == 0) {
+            t_tid = atomic_fetch_add_explicit(&g_next_tid, 1,
+                                              memory_order_relaxed) + 1;
+        }
+    }
+
+    /* Only the owning thread moves head, so a restart is applied here. */
+    if (atomic_load_explicit(&ring->generation, memory_order_relaxed) !=
+        generation) {
+        atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->generation, generation,
+                              memory_order_release);
+    }
+
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    event = &ring->events[head % TRACE_RING_EVENTS];
+    event->instant = start_us == 0;
+    event->ts_us = event->instant ? now : start_us;
+    event->dur_us = event->instant || now < start_us ?
+                    0 : (uint32_t)(now - start_us);
+    event->arg = arg;
+    event->tid = t_tid;
+    event->id = (uint16_t)id;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+bool trace_start(void) {
+    if (atomic_load(&g_trace_enabled)) {
+        return false;
+    }
+    atomic_store(&g_untraced, 0);
+    atomic_store(&g_start_us, trace_now_us());
+    atomic_fetch_add_explicit(&g_generation, 1, memory_order_release);
+    atomic_store(&g_trace_enabled, true);
+    return true;
+}
+
+bool trace_stop(void) {
+    return atomic_exchange(&g_trace_enabled, false);
+}
+
+bool trace_active(void) {
+    return atomic_load(&g_trace_enabled);
+}
+
+void trace_get_status(trace_status_t *status) {
+    unsigned int generation = atomic_load(&g_generation);
+
+    memset(status, 0, sizeof(*status));
+    status->active = trace_active();
+    status->untraced = atomic_load(&g_untraced);
+
+    pthread_mutex_lock(&g_pool_lock);
+    for (unsigned int i = 0; i < g_ring_count; i++) {
+        trace_ring_t *ring = g_rings[i];
+        uint64_t head;
+
+        if (atomic_load_explicit(&ring->generation, memory_order_acquire) !=
+            generation) {
+            continue;
+        }
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == 0) {
+            continue;
+        }
+        status->rings++;
+        if (head > TRACE_RING_EVENTS) {
+            status->events += TRACE_RING_EVENTS;
+            status->overwritten += head - TRACE_RING_EVENTS;
+        } else {
+            status->events += head;
+        }
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+}
+
+static void trace_write_event(FILE *fp, const trace_record_t *event,
+                              uint64_t start_us) {
+    const char *arg_name = g_trace_desc[event->id].arg;
+    uint64_t ts = event->ts_us > start_us ? event->ts_us - start_us : 0;
+
+    fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"tnt\",\"ph\":\"%s\","
+                "\"ts\":%llu,",
+            g_trace_desc[event->id].name, event->instant ? "i" : "X",
+            (unsigned long long)ts);
+    if (event->instant) {
+        fputs("\"s\":\"t\",", fp);
+    } else {
+        fprintf(fp, "\"dur\":%u,", event->dur_us);
+    }
+    fprintf(fp, "\"pid\":1,\"tid\":%u", event->tid);
+    if (arg_name) {
+        fprintf(fp, ",\"args\":{\"%s\":%llu}", arg_name,
+                (unsigned long long)event->arg);
+    }
+    fputc('}', fp);
+}
+
+int trace_write_json(FILE *fp) {
+    unsigned int generation = atomic_load(&g_generation);
+    uint64_t start_us = atomic_load(&g_start_us);
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"tnt\"}}", fp);
+
+    /* Holding the pool lock keeps exiting threads from handing a ring to a
+     * new thread mid-dump; recording threads do not take it. */
+    pthread_mutex_lock(&g_pool_lock);
+    for (unsigned int i = 0; i < g_ring_count; i++) {
+        trace_ring_t *ring = g_rings[i];
+        uint64_t head;
+        uint64_t first;
+
+        if (atomic_load_explicit(&ring->generation, memory_order_acquire) !=
+            generation) {
+            continue;
+        }
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        for (uint64_t n = first; n < head; n++) {
+            trace_write_event(fp, &ring->events[n % TRACE_RING_EVENTS],
+                              start_us);
+        }
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+
+    fputs("\n]}\n", fp);
+    return ferror(fp) ? -1 : 0;
+}
+
+int trace_dump(char *path, size_t path_size) {
+    char filename[64];
+    FILE *fp;
+    int rc;
+
+    snprintf(filename, sizeof(filename), "trace-%lld.json",
+             (long long)time(NULL));
+    if (tnt_state_path(path, path_size, filename) < 0) {
+        return -1;
+    }
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    rc = trace_write_json(fp);
+    if (fclose(fp) != 0) {
+        rc = -1;
+    }
+    return rc;
+}
@@ -1,167 +1,81 @@
 #include "tui.h"
 #include "client.h"
+#include "message_format.h"
 #include "ssh_server.h"
 #include "chat_room.h"
 #include "help_text.h"
 #include "history_view.h"
 #include "i18n.h"
+#include "lock_profile.h"
+#include "metrics.h"
+#include "object_pool.h"
+#include "scratch.h"
 #include "system_message.h"
 #include "theme.h"
+#include "trace.h"
 #include "tui_status.h"
 #include "utf8.h"
 #include <unistd.h>
 
-static const char *username_color(const char *name) {
-    static const char *colors[] = {
-        "\033[31m", "\033[32m", "\033[33m",
-        "\033[34m", "\033[35m", "\033[36m",
-    };
-    unsigned int h = 5381;
-    for (const char *p = name; *p; p++)
-        h = h * 33 + (unsigned char)*p;
-    return colors[h % 6];
-}
-
 static char *client_render_buffer(client_t *client, size_t min_size) {
     if (!client || min_size == 0) {
         return NULL;
     }
 
-    if (client->render_buffer_capacity >= min_size) {
+    /* Reuse while the size class holds; give memory back only once a large
+     * terminal shrinks into a smaller class. */
+    if (tnt_buffer_pool_fits(client->render_buffer_capacity, min_size)) {
         return client->render_buffer;
     }
 
-    char *grown = realloc(client->render_buffer, min_size);
-    if (!grown) {
-        return NULL;
+    size_t capacity = 0;
+    char *resized = tnt_buffer_pool_resize(client->render_buffer,
+                                           client->render_buffer_capacity,
+                                           0, min_size, &capacity);
+    if (!resized) {
+        return client->render_buffer_capacity >= min_size
+               ? client->render_buffer : NULL;
     }
 
-    client->render_buffer = grown;
-    client->render_buffer_capacity = min_size;
+    client->render_buffer = resized;
+    client->render_buffer_capacity = capacity;
+    client_mem_set(client, CLIENT_MEM_RENDER,
+                   capacity + client->render_snapshot_capacity);
     return client->render_buffer;
 }
 
-static void format_message_colored(const message_t *msg, char *buffer,
-                                   size_t buf_size, int width,
-                                   const char *my_username,
-                                   const theme_t *theme) {
-    struct tm tm_info;
-    localtime_r(&msg->timestamp, &tm_info);
-    char time_str[32];
-    strftime(time_str, sizeof(time_str), "%H:%M", &tm_info);
-
-    /* Is this message from the local user?  Used to draw a 1-column gutter
-     * marker so they can scan their own contributions when scrolling. */
-    bool is_self = false;
-    if (my_username && my_username[0] != '\0' &&
-        !system_message_is_system(msg)) {
-        if (strcmp(msg->username, "*") == 0) {
-            /* /me message: content starts with the actor's username */
-            size_t un_len = strlen(my_username);
-            if (strncmp(msg->content, my_username, un_len) == 0 &&
-                (msg->content[un_len] == ' ' || msg->content[un_len] == '\0')) {
-                is_self = true;
-            }
-        } else if (strcmp(msg->username, my_username) == 0) {
-            is_self = true;
-        }
+/* Room messages a frame shows, copied out of the room lock.  Kept between
+ * frames like the render buffer so steady-state repaints do not allocate. */
+static message_t *client_render_snapshot(client_t *client, int messages) {
+    size_t min_size = (size_t)messages * sizeof(message_t);
+
+    if (messages <= 0) {
+        return NULL;
     }
-    /* Always 1 column wide so all messages align vertically.  The self-marker
-     * uses the viewer's accent theme. */
-    char gutter_buf[32];
-    const char *gutter;
-    if (is_self) {
-        snprintf(gutter_buf, sizeof(gutter_buf), "%s▎\033[0m", theme->accent);
-        gutter = gutter_buf;
-    } else {
-        gutter = " ";
+    if (tnt_buffer_pool_fits(client->render_snapshot_capacity, min_size)) {
+        return client->render_snapshot;
     }
 
-    bool mentioned = false;
-    if (my_username && my_username[0] != '\0' &&
-        !system_message_is_system(msg)) {
-        char mention[MAX_USERNAME_LEN + 2];
-        snprintf(mention, sizeof(mention), "@%s", my_username);
-        if (strstr(msg->content, mention) != NULL) {
-            mentioned = true;
-        }
+    size_t capacity = 0;
+    message_t *resized = tnt_buffer_pool_resize(
+        client->render_snapshot, client->render_snapshot_capacity, 0,
+        min_size, &capacity);
+    if (!resized) {
+        return client->render_snapshot_capacity >= min_size
+               ? client->render_snapshot : NULL;
     }
-    const char *hl_start = mentioned ? "\033[1;33m" : "";
-    const char *hl_end = mentioned ? "\033[0m" : "";
 
-    if (system_message_is_system(msg)) {
-        snprintf(buffer, buf_size,
-                 "%s\033[90m--> %s\033[0m", gutter, msg->content);
-    } else if (strcmp(msg->username, "*") == 0) {
-        snprintf(buffer, buf_size,
-                 "%s\033[90m%s\033[0m %s* %s\033[0m",
-                 gutter, time_str, theme->accent_italic, msg->content);
-    } else {
-        snprintf(buffer, buf_size,
-                 "%s\033[90m%s\033[0m %s%s\033[0m: %s%s%s",
-                 gutter, time_str, username_color(msg->username),
-                 msg->username, hl_start, msg->content, hl_end);
-    }
-
-    /* Plain-text version for width calculation — gutter is 1 column. */
-    char plain[MAX_MESSAGE_LEN + 128];
-    if (system_message_is_system(msg)) {
-        snprintf(plain, sizeof(plain), " --> %s", msg->content);
-    } else if (strcmp(msg->username, "*") == 0) {
-        snprintf(plain, sizeof(plain), " %s * %s", time_str, msg->content);
-    } else {
-        snprintf(plain, sizeof(plain), " %s %s: %s",
-                 time_str, msg->username, msg->content);
-    }
-
-    if (utf8_string_width(plain) > width) {
-        /* Rebuild with truncated content — prefix_plain also includes the
-         * 1-column gutter so the budget math comes out right. */
-        int prefix_width;
-        char prefix_plain[256];
-        if (system_message_is_system(msg)) {
-            snprintf(prefix_plain, sizeof(prefix_plain), " --> ");
-        } else if (strcmp(msg->username, "*") == 0) {
-            snprintf(prefix_plain, sizeof(prefix_plain), " %s * ", time_str);
-        } else {
-            snprintf(prefix_plain, sizeof(prefix_plain), " %s %s: ",
-                     time_str, msg->username);
-        }
-        prefix_width = utf8_string_width(prefix_plain);
-        int content_width = width - prefix_width;
-        if (content_width < 4) content_width = 4;
-
-        char truncated_content[MAX_MESSAGE_LEN];
-        if (system_message_is_system(msg)) {
-            strncpy(truncated_content, msg->content, sizeof(truncated_content) - 1);
-            truncated_content[sizeof(truncated_content) - 1] = '\0';
-        } else if (strcmp(msg->username, "*") == 0) {
-            snprintf(truncated_content, sizeof(truncated_content), "* %s", msg->content);
-        } else {
-            strncpy(truncated_content, msg->content, sizeof(truncated_content) - 1);
-            truncated_content[sizeof(truncated_content) - 1] = '\0';
-        }
-        utf8_truncate(truncated_content, content_width);
-
-        if (system_message_is_system(msg)) {
-            snprintf(buffer, buf_size,
-                     "%s\033[90m--> %s\033[0m", gutter, truncated_content);
-        } else if (strcmp(msg->username, "*") == 0) {
-            snprintf(buffer, buf_size,
-                     "%s\033[90m%s\033[0m %s%s\033[0m",
-                     gutter, time_str, theme->accent_italic, truncated_content);
-        } else {
-            snprintf(buffer, buf_size,
-                     "%s\033[90m%s\033[0m %s%s\033[0m: %s%s%s",
-                     gutter, time_str, username_color(msg->username),
-                     msg->username, hl_start, truncated_content, hl_end);
-        }
-    }
+    client->render_snapshot = resized;
+    client->render_snapshot_capacity = capacity;
+    client_mem_set(client, CLIENT_MEM_RENDER,
+                   client->render_buffer_capacity + capacity);
+    return client->render_snapshot;
 }
 
 /* Clear the screen */
 void tui_clear_screen(client_t *client) {
     if (!client || !client->connected) return;
+    tnt_input_render_reset(client->input_render);
     const char *clear = ANSI_CLEAR ANSI_HOME;
     client_send(client, clear, strlen(clear));
 }
@@ -175,6 +89,7 @@ void tui_clear_screen(client_t *client) {
  * `==` rules. */
 void tui_render_welcome(client_t *client) {
     if (!client || !client->connected) return;
+    tnt_input_render_reset(client->input_render);
 
     int rw = client->width;
     int rh = client->height;
@@ -212,54 +127,57 @@ void tui_render_welcome(client_t *client) {
     if (left_pad < 0) left_pad = 0;
 
     /* ~5 KiB is plenty for the framed banner even on the largest terminals. */
-    char buf[4096];
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    const size_t buf_size = 4096;
+    char *buf = tnt_scratch_alloc(buf_size);
     size_t pos = 0;
+    if (!buf) return;
 
-    buffer_appendf(buf, sizeof(buf), &pos, ANSI_CLEAR ANSI_HOME);
+    buffer_appendf(buf, buf_size, &pos, ANSI_CLEAR ANSI_HOME);
     for (int i = 0; i < top_pad; i++) {
-        buffer_appendf(buf, sizeof(buf), &pos, "\r\n");
+        buffer_appendf(buf, buf_size, &pos, "\r\n");
     }
 
     /* Top border: ╭───…───╮ */
-    for (int i = 0; i < left_pad; i++) buffer_append_bytes(buf, sizeof(buf), &pos, " ", 1);
-    buffer_append_bytes(buf, sizeof(buf), &pos, "\033[36m", 5);
-    buffer_append_bytes(buf, sizeof(buf), &pos, "╭", strlen("╭"));
-    for (int i = 0; i < inner_w; i++) buffer_append_bytes(buf, sizeof(buf), &pos, "─", strlen("─"));
-    buffer_append_bytes(buf, sizeof(buf), &pos, "╮", strlen("╮"));
-    buffer_append_bytes(buf, sizeof(buf), &pos, "\033[0m", 4);
-    buffer_appendf(buf, sizeof(buf), &pos, "\r\n");
+    for (int i = 0; i < left_pad; i++) buffer_append_bytes(buf, buf_size, &pos, " ", 1);
+    buffer_append_bytes(buf, buf_size, &pos, "\033[36m", 5);
+    buffer_append_bytes(buf, buf_size, &pos, "╭", strlen("╭"));
+    for (int i = 0; i < inner_w; i++) buffer_append_bytes(buf, buf_size, &pos, "─", strlen("─"));
+    buffer_append_bytes(buf, buf_size, &pos, "╮", strlen("╮"));
+    buffer_append_bytes(buf, buf_size, &pos, "\033[0m", 4);
+    buffer_appendf(buf, buf_size, &pos, "\r\n");
 
     /* Three content lines with surrounding │ borders, centred inside the frame. */
     const char *lines[3] = {line1, line2, line3};
     int widths[3] = {utf8_string_width(line1), w2, w3};
     const char *line_color[3] = {"\033[1;36m", "\033[0m", "\033[2;37m"};
     for (int li = 0; li < 3; li++) {
-        for (int i = 0; i < left_pad; i++) buffer_append_bytes(buf, sizeof(buf), &pos, " ", 1);
-        buffer_append_bytes(buf, sizeof(buf), &pos, "\033[36m", 5);
-        buffer_append_bytes(buf, sizeof(buf), &pos, "│", strlen("│"));
-        buffer_append_bytes(buf, sizeof(buf), &pos, "\033[0m", 4);
+        for (int i = 0; i < left_pad; i++) buffer_append_bytes(buf, buf_size, &pos, " ", 1);
+        buffer_append_bytes(buf, buf_size, &pos, "\033[36m", 5);
+        buffer_append_bytes(buf, buf_size, &pos, "│", strlen("│"));
+        buffer_append_bytes(buf, buf_size, &pos, "\033[0m", 4);
 
         int pad_total = inner_w - widths[li];
         int pad_left = pad_total / 2;
         int pad_right = pad_total - pad_left;
-        for (int i = 0; i < pad_left; i++) buffer_append_bytes(buf, sizeof(buf), &pos, " ", 1);
-        buffer_appendf(buf, sizeof(buf), &pos, "%s%s\033[0m", line_color[li], lines[li]);
-        for (int i = 0; i < pad_right; i++) buffer_append_bytes(buf, sizeof(buf), &pos, " ", 1);
+        for (int i = 0; i < pad_left; i++) buffer_append_bytes(buf, buf_size, &pos, " ", 1);
+        buffer_appendf(buf, buf_size, &pos, "%s%s\033[0m", line_color[li], lines[li]);
+        for (int i = 0; i < pad_right; i++) buffer_append_bytes(buf, buf_size, &pos, " ", 1);
 
-        buffer_append_bytes(buf, sizeof(buf), &pos, "\033[36m", 5);
-        buffer_append_bytes(buf, sizeof(buf), &pos, "│", strlen("│"));
-        buffer_append_bytes(buf, sizeof(buf), &pos, "\033[0m", 4);
-        buffer_appendf(buf, sizeof(buf), &pos, "\r\n");
+        buffer_append_bytes(buf, buf_size, &pos, "\033[36m", 5);
+        buffer_append_bytes(buf, buf_size, &pos, "│", strlen("│"));
+        buffer_append_bytes(buf, buf_size, &pos, "\033[0m", 4);
+        buffer_appendf(buf, buf_size, &pos, "\r\n");
     }
 
     /* Bottom border: ╰───…───╯ */
-    for (int i = 0; i < left_pad; i++) buffer_append_bytes(buf, sizeof(buf), &pos, " ", 1);
-    buffer_append_bytes(buf, sizeof(buf), &pos, "\033[36m", 5);
-    buffer_append_bytes(buf, sizeof(buf), &pos, "╰", strlen("╰"));
-    for (int i = 0; i < inner_w; i++) buffer_append_bytes(buf, sizeof(buf), &pos, "─", strlen("─"));
-    buffer_append_bytes(buf, sizeof(buf), &pos, "╯", strlen("╯"));
-    buffer_append_bytes(buf, sizeof(buf), &pos, "\033[0m", 4);
-    buffer_appendf(buf, sizeof(buf), &pos, "\r\n");
+    for (int i = 0; i < left_pad; i++) buffer_append_bytes(buf, buf_size, &pos, " ", 1);
+    buffer_append_bytes(buf, buf_size, &pos, "\033[36m", 5);
+    buffer_append_bytes(buf, buf_size, &pos, "╰", strlen("╰"));
+    for (int i = 0; i < inner_w; i++) buffer_append_bytes(buf, buf_size, &pos, "─", strlen("─"));
+    buffer_append_bytes(buf, buf_size, &pos, "╯", strlen("╯"));
+    buffer_append_bytes(buf, buf_size, &pos, "\033[0m", 4);
+    buffer_appendf(buf, buf_size, &pos, "\r\n");
 
     /* Newcomer guide: a single dim, centered "getting started" line below the
      * banner, shown to everyone before the name prompt. */
@@ -269,21 +187,25 @@ void tui_render_welcome(client_t *client) {
         if (guide_width <= rw) {
             int guide_pad = (rw - guide_width) / 2;
             if (guide_pad < 0) guide_pad = 0;
-            buffer_appendf(buf, sizeof(buf), &pos, "\r\n");
+            buffer_appendf(buf, buf_size, &pos, "\r\n");
             for (int i = 0; i < guide_pad; i++) {
-                buffer_append_bytes(buf, sizeof(buf), &pos, " ", 1);
+                buffer_append_bytes(buf, buf_size, &pos, " ", 1);
             }
-            buffer_appendf(buf, sizeof(buf), &pos, "\033[2;37m%s\033[0m", guide);
+            buffer_appendf(buf, buf_size, &pos, "\033[2;37m%s\033[0m", guide);
         }
     }
-    buffer_appendf(buf, sizeof(buf), &pos, "\r\n\r\n");
+    buffer_appendf(buf, buf_size, &pos, "\r\n\r\n");
 
     client_send(client, buf, pos);
+    tnt_scratch_release(scratch);
 }
 
 /* Render the main screen */
 void tui_render_screen(client_t *client) {
     if (!client || !client->connected) return;
+    uint64_t start_us = metrics_now_us();
+    uint64_t trace_us = trace_begin();
+    tnt_input_render_reset(client->input_render);
 
     int render_width = client->width;
     int render_height = client->height;
@@ -298,133 +220,76 @@ void tui_render_screen(client_t *client) {
     size_t pos = 0;
     buffer[0] = '\0';
 
-    /* First pass under lock: compute indices and counts */
-    pthread_rwlock_rdlock(&g_room->lock);
-    int online = g_room->client_count;
-    int msg_count = g_room->message_count;
-    pthread_rwlock_unlock(&g_room->lock);
-    int raw_msg_count = msg_count;
-
-    /* Calculate which messages to show.  The initial slice is capped by
-     * message count; the lock-held copy below tightens "latest" slices so
-     * date dividers cannot push the newest messages off-screen. */
+    /* Copy the rows this frame shows into the client's snapshot under one
+     * read lock, then format them with the lock released. */
     int msg_height = history_view_height(render_height);
+    int snapshot_capacity = msg_height < MAX_MESSAGES ? msg_height
+                                                      : MAX_MESSAGES;
+    message_t *msg_snapshot = client_render_snapshot(client,
+                                                     snapshot_capacity);
+    int snapshot_count = 0;
+
+    LOCK_PROFILE_RDLOCK(&g_room->lock, LOCK_ID_ROOM);
+    int online = g_room->client_count;
+    int raw_msg_count = g_room->message_count;
+    int msg_count = raw_msg_count;
+    if (client->mute_joins) {
+        msg_count = 0;
+        for (int i = 0; i < raw_msg_count; i++) {
+            if (!system_message_is_join_leave(&g_room->messages[i])) {
+                msg_count++;
+            }
+        }
+    }
 
-    int start = 0;
+    /* Which messages to show, counted among the visible ones.  "Latest"
+     * slices are tightened below so date dividers cannot push the newest
+     * messages off-screen. */
     int latest_scroll_start = history_view_max_scroll(msg_count, msg_height);
     bool anchor_latest = client->mode != MODE_NORMAL ||
                          client->follow_tail ||
                          client->scroll_pos >= latest_scroll_start;
+    int start = latest_scroll_start;
     if (client->mode == MODE_NORMAL) {
         start = client->scroll_pos;
         if (start > latest_scroll_start) {
             start = latest_scroll_start;
         }
         if (start < 0) start = 0;
-    } else {
-        /* INSERT mode: show latest */
-        start = latest_scroll_start;
     }
-
     int end = start + msg_height;
     if (end > msg_count) end = msg_count;
-
-    message_t *visible_messages = NULL;
-    message_t *msg_snapshot = NULL;
-    int snapshot_count = 0;
-
-    if (client->mute_joins && msg_count > 0) {
-        visible_messages = calloc(MAX_MESSAGES, sizeof(message_t));
-        if (visible_messages) {
-            int visible_count = 0;
-
-            pthread_rwlock_rdlock(&g_room->lock);
-            online = g_room->client_count;
-            raw_msg_count = g_room->message_count;
-            for (int i = 0; i < g_room->message_count; i++) {
-                if (!system_message_is_join_leave(&g_room->messages[i])) {
-                    visible_messages[visible_count++] = g_room->messages[i];
-                }
-            }
-            pthread_rwlock_unlock(&g_room->lock);
-
-            msg_count = visible_count;
-            latest_scroll_start = history_view_max_scroll(msg_count, msg_height);
-            anchor_latest = client->mode != MODE_NORMAL ||
-                            client->follow_tail ||
-                            client->scroll_pos >= latest_scroll_start;
-            if (client->mode == MODE_NORMAL) {
-                start = client->scroll_pos;
-                if (start > latest_scroll_start) {
-                    start = latest_scroll_start;
-                }
-                if (start < 0) start = 0;
-            } else {
-                start = latest_scroll_start;
-            }
-            end = start + msg_height;
-            if (end > msg_count) end = msg_count;
-            if (anchor_latest) {
-                start = history_view_latest_start_for_height(
-                    visible_messages, msg_count, msg_height);
-                end = msg_count;
-            }
-            snapshot_count = end - start;
-            if (snapshot_count > 0) {
-                msg_snapshot = visible_messages + start;
-            }
-        }
+    if (anchor_latest) {
+        start = msg_count > snapshot_capacity ? msg_count - snapshot_capacity
+                                              : 0;
+        end = msg_count;
     }
 
-    if (!visible_messages) {
-        /* Allocate snapshot outside the lock to avoid blocking writers */
-        int snapshot_capacity = msg_height;
-        snapshot_count = end - start;
+    if (msg_snapshot) {
+        int visible = 0;
 
-        if (snapshot_count > 0 && snapshot_capacity > 0) {
-            msg_snapshot = calloc(snapshot_capacity, sizeof(message_t));
-        }
+        for (int i = 0; i < raw_msg_count && visible < end &&
+                        snapshot_count < snapshot_capacity; i++) {
+            const message_t *msg = &g_room->messages[i];
 
-        /* Second pass under lock: copy messages */
-        if (msg_snapshot) {
-            pthread_rwlock_rdlock(&g_room->lock);
-            /* Re-clamp in case msg_count changed */
-            int actual_count = g_room->message_count;
-            int actual_start = start;
-            int actual_end = end;
-            if (anchor_latest) {
-                actual_end = actual_count;
-                actual_start = history_view_latest_start_for_height(
-                    g_room->messages, actual_count, msg_height);
-            } else {
-                actual_end = (actual_end <= actual_count) ? actual_end : actual_count;
-                actual_start = (actual_start < actual_end) ? actual_start : actual_end;
+            if (client->mute_joins && system_message_is_join_leave(msg)) {
+                continue;
             }
-            int actual_snapshot = actual_end - actual_start;
-            if (actual_snapshot > 0 && actual_snapshot <= snapshot_capacity) {
-                memcpy(msg_snapshot, &g_room->messages[actual_start],
-                       actual_snapshot * sizeof(message_t));
-                start = actual_start;
-                end = actual_end;
-                snapshot_count = actual_snapshot;
-            } else {
-                snapshot_count = 0;
+            if (visible >= start) {
+                msg_snapshot[snapshot_count++] = *msg;
             }
-            pthread_rwlock_unlock(&g_room->lock);
+            visible++;
         }
     }
+    LOCK_PROFILE_RWUNLOCK(&g_room->lock);
 
-    /* Now render using snapshot (no lock held) */
+    if (anchor_latest && snapshot_count > 0) {
+        int first = history_view_latest_start_for_height(
+            msg_snapshot, snapshot_count, msg_height);
 
-    /* If mute_joins is set, remove join/leave messages from snapshot in place */
-    if (client->mute_joins && msg_snapshot && !anchor_latest) {
-        int filtered = 0;
-        for (int i = 0; i < snapshot_count; i++) {
-            if (!system_message_is_join_leave(&msg_snapshot[i])) {
-                msg_snapshot[filtered++] = msg_snapshot[i];
-            }
-        }
-        snapshot_count = filtered;
+        msg_snapshot += first;
+        snapshot_count -= first;
+        start += first;
     }
 
     /* Move to top (Home) - Do NOT clear screen to prevent flicker */
@@ -580,8 +445,12 @@ void tui_render_screen(client_t *client) {
      * push other content off the bottom. */
     int rows_written = 0;
     if (msg_snapshot) {
+        tnt_scratch_mark_t scratch = tnt_scratch_mark();
+        const size_t msg_line_size = 2048;
+        char *msg_line = tnt_scratch_alloc(msg_line_size);
         char last_date[11] = "";  /* "YYYY-MM-DD" */
-        for (int i = 0; i < snapshot_count && rows_written < msg_height; i++) {
+        for (int i = 0; msg_line && i < snapshot_count &&
+                        rows_written < msg_height; i++) {
             char this_date[11];
             struct tm tmi;
             localtime_r(&msg_snapshot[i].timestamp, &tmi);
@@ -604,12 +473,12 @@ void tui_render_screen(client_t *client) {
                 if (rows_written >= msg_height) break;
             }
 
-            char msg_line[2048];
-            format_message_colored(&msg_snapshot[i], msg_line, sizeof(msg_line),
+            message_format_colored(&msg_snapshot[i], msg_line, msg_line_size,
                                    render_width, client->username, theme);
             buffer_appendf(buffer, buf_size, &pos, "%s\033[K\r\n", msg_line);
             rows_written++;
         }
+        tnt_scratch_release(scratch);
     }
 
     if (rows_written == 0) {
@@ -628,8 +497,6 @@ void tui_render_screen(client_t *client) {
         rows_written++;
     }
 
-    free(visible_messages ? visible_messages : msg_snapshot);
-
     /* Fill empty lines and clear them */
     for (int i = rows_written; i < msg_height; i++) {
         buffer_appendf(buffer, buf_size, &pos, "\033[K\r\n");
@@ -645,6 +512,10 @@ void tui_render_screen(client_t *client) {
     tui_status_append(buffer, buf_size, &pos, client, msg_count, start, end);
 
     client_send(client, buffer, pos);
+    client_usage_add(client, CLIENT_USAGE_FRAMES, 1);
+    metrics_observe(METRIC_HIST_RENDER_BYTES, pos);
+    metrics_observe(METRIC_HIST_RENDER_US, metrics_now_us() - start_us);
+    trace_end(TRACE_EV_RENDER, trace_us, pos);
 }
 
 /* Render the input line.
@@ -661,13 +532,49 @@ void tui_render_input(client_t *client, const char *input) {
     if (rh < 4) rh = 4;
 
     char buffer[2048];
-    int input_width = utf8_string_width(input);
     size_t input_bytes = strlen(input);
 
+    if (!client->input_render) {
+        client->input_render = calloc(1, sizeof(*client->input_render));
+        if (client->input_render) {
+            client_mem_set(client, CLIENT_MEM_INPUT,
+                           sizeof(*client->input_render));
+        }
+    }
+
+    /* Typing and erasing at the end of a short line only touches the
+     * glyphs that changed; everything else repaints the row. */
+    tnt_input_render_plan_t plan =
+        tnt_input_render_plan(client->input_render, input, input_bytes,
+                              rw, rh);
+    if (plan.op == TNT_INPUT_RENDER_UNCHANGED) {
+        return;
+    }
+    if (plan.op == TNT_INPUT_RENDER_APPEND) {
+        tnt_input_render_apply(client->input_render, &plan, input,
+                               input_bytes);
+        client_send(client, input + plan.offset, input_bytes - plan.offset);
+        return;
+    }
+    if (plan.op == TNT_INPUT_RENDER_ERASE) {
+        tnt_input_render_apply(client->input_render, &plan, input,
+                               input_bytes);
+        if (plan.width > 0) {
+            snprintf(buffer, sizeof(buffer), "\033[%dD" ANSI_CLEAR_LINE,
+                     plan.width);
+        } else {
+            snprintf(buffer, sizeof(buffer), ANSI_CLEAR_LINE);
+        }
+        client_send(client, buffer, strlen(buffer));
+        return;
+    }
+
+    int input_width = utf8_string_width(input);
+
     /* Decide whether to show the length gauge and how loud. */
     int gauge_width = 0;
     char gauge[64] = "";
-    if (input_bytes > (MAX_MESSAGE_LEN * 8) / 10) {  /* > 80 % */
+    if (tnt_input_render_wants_gauge(input_bytes)) {  /* > 80 % */
         size_t remaining = (input_bytes < MAX_MESSAGE_LEN)
                            ? (MAX_MESSAGE_LEN - 1 - input_bytes) : 0;
         const char *color =
@@ -718,11 +625,14 @@ void tui_render_input(client_t *client, const char *input) {
                  rh, display);
     }
 
+    tnt_input_render_full(client->input_render, input, input_bytes,
+                          input_width, rw, rh);
     client_send(client, buffer, strlen(buffer));
 }
 
 void tui_render_command_input(client_t *client) {
     if (!client || !client->connected) return;
+    tnt_input_render_reset(client->input_render);
 
     int rh = client->height;
     if (rh < 4) rh = 4;
@@ -740,6 +650,7 @@ void tui_render_command_input(client_t *client) {
 
 void tui_render_command_hint(client_t *client, const char *hint) {
     if (!client || !client->connected) return;
+    tnt_input_render_reset(client->input_render);
 
     int rw = client->width;
     int rh = client->height;
@@ -776,18 +687,26 @@ void tui_render_command_hint(client_t *client, const char *hint) {
 /* Render the command output screen */
 void tui_render_command_output(client_t *client) {
     if (!client || !client->connected) return;
+    tnt_input_render_reset(client->input_render);
 
     int rw = client->width;
     int rh = client->height;
     if (rw < 10) rw = 10;
     if (rh < 4) rh = 4;
 
-    char buffer[MAX_COMMAND_OUTPUT_LEN + 1024];
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    const size_t buffer_size = MAX_COMMAND_OUTPUT_LEN + 1024;
+    char *buffer = tnt_scratch_alloc(buffer_size);
+    char *output_copy = tnt_scratch_alloc(MAX_COMMAND_OUTPUT_LEN);
     size_t pos = 0;
+    if (!buffer || !output_copy) {
+        tnt_scratch_release(scratch);
+        return;
+    }
     buffer[0] = '\0';
 
     /* Clear screen */
-    buffer_appendf(buffer, sizeof(buffer), &pos, ANSI_CLEAR ANSI_HOME);
+    buffer_appendf(buffer, buffer_size, &pos, ANSI_CLEAR ANSI_HOME);
 
     /* Title */
     const char *title = i18n_text(client->ui_lang,
@@ -798,17 +717,17 @@ void tui_render_command_output(client_t *client) {
     int padding = rw - title_width;
     if (padding < 0) padding = 0;
 
-    buffer_appendf(buffer, sizeof(buffer), &pos, ANSI_REVERSE "%s",
+    buffer_appendf(buffer, buffer_size, &pos, ANSI_REVERSE "%s",
                    title_display);
     for (int i = 0; i < padding; i++) {
-        buffer_append_bytes(buffer, sizeof(buffer), &pos, " ", 1);
+        buffer_append_bytes(buffer, buffer_size, &pos, " ", 1);
     }
-    buffer_appendf(buffer, sizeof(buffer), &pos, ANSI_RESET "\r\n");
+    buffer_appendf(buffer, buffer_size, &pos, ANSI_RESET "\r\n");
 
     /* Command output - use a copy to avoid strtok corruption */
-    char output_copy[MAX_COMMAND_OUTPUT_LEN];
-    strncpy(output_copy, client->command_output, sizeof(output_copy) - 1);
-    output_copy[sizeof(output_copy) - 1] = '\0';
+    strncpy(output_copy, client_command_output(client),
+            MAX_COMMAND_OUTPUT_LEN - 1);
+    output_copy[MAX_COMMAND_OUTPUT_LEN - 1] = '\0';
 
     char *lines[256];
     int line_count = 0;
@@ -835,14 +754,14 @@ void tui_render_command_output(client_t *client) {
         char truncated[1024];
         utf8_ansi_truncate(lines[i], truncated, sizeof(truncated), rw);
 
-        buffer_appendf(buffer, sizeof(buffer), &pos, "%s\r\n", truncated);
+        buffer_appendf(buffer, buffer_size, &pos, "%s\r\n", truncated);
     }
 
     for (int i = end - start; i < content_height; i++) {
-        buffer_appendf(buffer, sizeof(buffer), &pos, "\033[K\r\n");
+        buffer_appendf(buffer, buffer_size, &pos, "\033[K\r\n");
     }
 
-    buffer_appendf(buffer, sizeof(buffer), &pos,
+    buffer_appendf(buffer, buffer_size, &pos,
                    i18n_text(client->ui_lang,
                              client->command_output_kind ==
                                      TNT_COMMAND_OUTPUT_INBOX
@@ -851,6 +770,8 @@ void tui_render_command_output(client_t *client) {
                    start + 1, max_scroll + 1);
 
     client_send(client, buffer, pos);
+    client_usage_add(client, CLIENT_USAGE_FRAMES, 1);
+    tnt_scratch_release(scratch);
 }
 
 /* Render the MOTD screen.
@@ -858,13 +779,14 @@ void tui_render_command_output(client_t *client) {
  * A framed banner with a title chip embedded in the top border and an
  * "any key to continue" hint embedded in the bottom border, MOTD body
  * left-padded inside.  Dismissed by handle_key like any other modal
- * (sets command_output[0]='\0' and show_motd=false).
+ * (clears command_output and sets show_motd=false).
  *
  * Lighter aesthetic than tui_render_command_output: no full-line reverse,
  * dim borders, two blank lines of breathing room above and below the
  * body so the announcement reads as a notice rather than a console dump. */
 void tui_render_motd(client_t *client) {
     if (!client || !client->connected) return;
+    tnt_input_render_reset(client->input_render);
 
     int rw = client->width;
     int rh = client->height;
@@ -873,9 +795,17 @@ void tui_render_motd(client_t *client) {
 
     const theme_t *theme = theme_resolve(client->theme_index);
 
-    char buffer[4096];
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    const size_t buffer_size = 4096;
+    const size_t body_size = 2048;
+    char *buffer = tnt_scratch_alloc(buffer_size);
+    char *body_copy = tnt_scratch_alloc(body_size);
     size_t pos = 0;
-    buffer_appendf(buffer, sizeof(buffer), &pos, ANSI_CLEAR ANSI_HOME);
+    if (!buffer || !body_copy) {
+        tnt_scratch_release(scratch);
+        return;
+    }
+    buffer_appendf(buffer, buffer_size, &pos, ANSI_CLEAR ANSI_HOME);
 
     /* Top border with a localized title chip. */
     const char *title = i18n_text(client->ui_lang, I18N_MOTD_TITLE);
@@ -883,21 +813,20 @@ void tui_render_motd(client_t *client) {
     int top_dash_fill = rw - 2 - title_w - 1;  /* 2 corners, 1 leading ─ */
     if (top_dash_fill < 0) top_dash_fill = 0;
 
-    buffer_appendf(buffer, sizeof(buffer), &pos, "%s╭─", theme->accent_dim);
-    buffer_appendf(buffer, sizeof(buffer), &pos, "\033[0m%s%s%s", theme->accent_bold,
+    buffer_appendf(buffer, buffer_size, &pos, "%s╭─", theme->accent_dim);
+    buffer_appendf(buffer, buffer_size, &pos, "\033[0m%s%s%s", theme->accent_bold,
                    title, theme->accent_dim);
     for (int i = 0; i < top_dash_fill; i++) {
-        buffer_append_bytes(buffer, sizeof(buffer), &pos, "─", strlen("─"));
+        buffer_append_bytes(buffer, buffer_size, &pos, "─", strlen("─"));
     }
-    buffer_appendf(buffer, sizeof(buffer), &pos, "╮\033[0m\r\n");
+    buffer_appendf(buffer, buffer_size, &pos, "╮\033[0m\r\n");
 
     /* Top breathing-room line */
-    buffer_appendf(buffer, sizeof(buffer), &pos, "\r\n");
+    buffer_appendf(buffer, buffer_size, &pos, "\r\n");
 
     /* Body lines (left-pad 2 cols, truncate to inner width) */
-    char body_copy[2048];
-    strncpy(body_copy, client->command_output, sizeof(body_copy) - 1);
-    body_copy[sizeof(body_copy) - 1] = '\0';
+    strncpy(body_copy, client_command_output(client), body_size - 1);
+    body_copy[body_size - 1] = '\0';
 
     int body_lines = 0;
     int max_body_lines = rh - 4;  /* top border + top pad + bottom pad + bottom border */
@@ -914,7 +843,7 @@ void tui_render_motd(client_t *client) {
         if (utf8_string_width(truncated) > avail) {
             utf8_truncate(truncated, avail);
         }
-        buffer_appendf(buffer, sizeof(buffer), &pos, "  %s\r\n", truncated);
+        buffer_appendf(buffer, buffer_size, &pos, "  %s\r\n", truncated);
         body_lines++;
         line = strtok(NULL, "\n");
     }
@@ -924,11 +853,11 @@ void tui_render_motd(client_t *client) {
     int filler_rows = rh - used_rows;
     if (filler_rows < 0) filler_rows = 0;
     for (int i = 0; i < filler_rows; i++) {
-        buffer_appendf(buffer, sizeof(buffer), &pos, "\r\n");
+        buffer_appendf(buffer, buffer_size, &pos, "\r\n");
     }
 
     /* Bottom breathing-room line */
-    buffer_appendf(buffer, sizeof(buffer), &pos, "\r\n");
+    buffer_appendf(buffer, buffer_size, &pos, "\r\n");
 
     /* Bottom border with a localized continue hint. */
     const char *footer = i18n_text(client->ui_lang,
@@ -937,31 +866,42 @@ void tui_render_motd(client_t *client) {
     int bot_dash_fill = rw - 2 - footer_w - 1;
     if (bot_dash_fill < 0) bot_dash_fill = 0;
 
-    buffer_appendf(buffer, sizeof(buffer), &pos, "%s╰─", theme->accent_dim);
-    buffer_appendf(buffer, sizeof(buffer), &pos, "\033[0;2;37m%s%s", footer,
+    buffer_appendf(buffer, buffer_size, &pos, "%s╰─", theme->accent_dim);
+    buffer_appendf(buffer, buffer_size, &pos, "\033[0;2;37m%s%s", footer,
                    theme->accent_dim);
     for (int i = 0; i < bot_dash_fill; i++) {
-        buffer_append_bytes(buffer, sizeof(buffer), &pos, "─", strlen("─"));
+        buffer_append_bytes(buffer, buffer_size, &pos, "─", strlen("─"));
     }
-    buffer_appendf(buffer, sizeof(buffer), &pos, "╯\033[0m");
+    buffer_appendf(buffer, buffer_size, &pos, "╯\033[0m");
 
     client_send(client, buffer, pos);
+    client_usage_add(client, CLIENT_USAGE_FRAMES, 1);
+    tnt_scratch_release(scratch);
 }
 /* Render the help screen */
 void tui_render_help(client_t *client) {
     if (!client || !client->connected) return;
+    tnt_input_render_reset(client->input_render);
 
     int rw = client->width;
     int rh = client->height;
     if (rw < 10) rw = 10;
     if (rh < 4) rh = 4;
 
-    char buffer[8192];
+    tnt_scratch_mark_t scratch = tnt_scratch_mark();
+    const size_t buffer_size = 8192;
+    const size_t help_size = 8192;
+    char *buffer = tnt_scratch_alloc(buffer_size);
+    char *help_copy = tnt_scratch_alloc(help_size);
     size_t pos = 0;
+    if (!buffer || !help_copy) {
+        tnt_scratch_release(scratch);
+        return;
+    }
     buffer[0] = '\0';
 
     /* Clear screen */
-    buffer_appendf(buffer, sizeof(buffer), &pos, ANSI_CLEAR ANSI_HOME);
+    buffer_appendf(buffer, buffer_size, &pos, ANSI_CLEAR ANSI_HOME);
 
     /* Title */
     const char *title = i18n_text(client->ui_lang, I18N_HELP_TITLE);
@@ -969,16 +909,15 @@ void tui_render_help(client_t *client) {
     int padding = rw - title_width;
     if (padding < 0) padding = 0;
 
-    buffer_appendf(buffer, sizeof(buffer), &pos, ANSI_REVERSE "%s", title);
+    buffer_appendf(buffer, buffer_size, &pos, ANSI_REVERSE "%s", title);
     for (int i = 0; i < padding; i++) {
-        buffer_append_bytes(buffer, sizeof(buffer), &pos, " ", 1);
+        buffer_append_bytes(buffer, buffer_size, &pos, " ", 1);
     }
-    buffer_appendf(buffer, sizeof(buffer), &pos, ANSI_RESET "\r\n");
+    buffer_appendf(buffer, buffer_size, &pos, ANSI_RESET "\r\n");
 
-    char help_copy[8192];
     size_t help_pos = 0;
     help_copy[0] = '\0';
-    help_text_append_full(help_copy, sizeof(help_copy), &help_pos,
+    help_text_append_full(help_copy, help_size, &help_pos,
                           client->ui_lang);
 
     /* Split into lines and display with scrolling */
@@ -1000,18 +939,20 @@ void tui_render_help(client_t *client) {
     if (end > line_count) end = line_count;
 
     for (int i = start; i < end && (i - start) < content_height - 1; i++) {
-        buffer_appendf(buffer, sizeof(buffer), &pos, "%s\r\n", lines[i]);
+        buffer_appendf(buffer, buffer_size, &pos, "%s\r\n", lines[i]);
     }
 
     /* Fill remaining lines */
     for (int i = end - start; i < content_height - 1; i++) {
-        buffer_append_bytes(buffer, sizeof(buffer), &pos, "\r\n", 2);
+        buffer_append_bytes(buffer, buffer_size, &pos, "\r\n", 2);
     }
 
     /* Status line */
-    buffer_appendf(buffer, sizeof(buffer), &pos,
+    buffer_appendf(buffer, buffer_size, &pos,
                    i18n_text(client->ui_lang, I18N_HELP_STATUS_FORMAT),
                    start + 1, max_scroll + 1);
 
     client_send(client, buffer, pos);
+    client_usage_add(client, CLIENT_USAGE_FRAMES, 1);
+    tnt_scratch_release(scratch);
 }
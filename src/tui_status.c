@@ -56,7 +56,13 @@ void tui_status_append(char *buffer, size_t buf_size, size_t *pos,
     if (!buffer || !pos || !client) return;
 
     if (client->mode == MODE_INSERT) {
-        if (client->width >= 58) {
+        if (client->post_throttled && client->width >= 48) {
+            buffer_appendf(buffer, buf_size, pos,
+                           "\033[2;37m›\033[0m  "
+                           "\033[33m%s\033[0m\033[K",
+                           i18n_text(client->ui_lang,
+                                     I18N_POST_THROTTLED_HINT));
+        } else if (client->width >= 58) {
             buffer_appendf(buffer, buf_size, pos,
                            "\033[2;37m›\033[0m  "
                            "\033[2;37m%s\033[0m"
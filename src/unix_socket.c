@@ -0,0 +1,239 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  /* for struct ucred / SO_PEERCRED on glibc */
+#endif
+#include "unix_socket.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Pause after a resource-exhaustion accept failure. */
+#define ACCEPT_BACKOFF_MS 100
+
+static int fill_addr(struct sockaddr_un *addr, const char *path) {
+    size_t len = path ? strlen(path) : 0;
+
+    if (len == 0 || len >= sizeof(addr->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, len + 1);
+    return 0;
+}
+
+static int unix_socket_new(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd >= 0) {
+        int flags = fcntl(fd, F_GETFD);
+        if (flags >= 0) {
+            fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+        }
+    }
+    return fd;
+}
+
+int tnt_unix_listen(const char *path, unsigned int mode) {
+    struct sockaddr_un addr;
+    int fd;
+    int saved;
+
+    if (fill_addr(&addr, path) < 0) {
+        return -1;
+    }
+    fd = unix_socket_new();
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* A socket file left by a crashed process would make bind() fail. */
+    if (unlink(path) < 0 && errno != ENOENT) {
+        saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        chmod(path, (mode_t)mode) < 0 || listen(fd, 8) < 0) {
+        saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+int tnt_unix_accept(int listen_fd, const char *what) {
+    while (1) {
+        int conn = accept(listen_fd, NULL, NULL);
+
+        if (conn >= 0) {
+            return conn;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        fprintf(stderr, "%s: %s\n", what, strerror(errno));
+        if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+            errno == ENOMEM) {
+            /* Out of descriptors: back off instead of spinning. */
+            struct timespec delay = { 0, ACCEPT_BACKOFF_MS * 1000000L };
+
+            nanosleep(&delay, NULL);
+            continue;
+        }
+        return -1;
+    }
+}
+
+int tnt_unix_connect(const char *path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if (fill_addr(&addr, path) < 0) {
+        return -1;
+    }
+    fd = unix_socket_new();
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+bool tnt_unix_peer_is_self(int fd) {
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        return false;
+    }
+    return cred.uid == geteuid();
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+    defined(__NetBSD__)
+    uid_t uid;
+    gid_t gid;
+
+    if (getpeereid(fd, &uid, &gid) < 0) {
+        return false;
+    }
+    return uid == geteuid();
+#else
+    (void)fd;
+    return true;
+#endif
+}
+
+int tnt_unix_send_fds(int sock, const int *fds, int count) {
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * TNT_UNIX_MAX_FDS)];
+    } control;
+    unsigned char count_byte = (unsigned char)count;
+    struct iovec iov = { &count_byte, 1 };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t sent;
+
+    if (!fds || count <= 0 || count > TNT_UNIX_MAX_FDS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&control, 0, sizeof(control));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)count);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * (size_t)count);
+
+    do {
+        sent = sendmsg(sock, &msg, 0);
+    } while (sent < 0 && errno == EINTR);
+    return sent == 1 ? 0 : -1;
+}
+
+int tnt_unix_recv_fds(int sock, int *fds, int max) {
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * TNT_UNIX_MAX_FDS)];
+    } control;
+    unsigned char count_byte = 0;
+    struct iovec iov = { &count_byte, 1 };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t got;
+    int stored = 0;
+    int received = 0;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    do {
+#ifdef MSG_CMSG_CLOEXEC
+        got = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+#else
+        got = recvmsg(sock, &msg, 0);
+#endif
+    } while (got < 0 && errno == EINTR);
+    if (got <= 0) {
+        return -1;
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        size_t n;
+
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < n; i++) {
+            int fd;
+
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(fd));
+            received++;
+            if (stored < max) {
+                int flags = fcntl(fd, F_GETFD);
+                if (flags >= 0) {
+                    fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+                }
+                fds[stored++] = fd;
+            } else {
+                close(fd);
+            }
+        }
+    }
+
+    if ((msg.msg_flags & MSG_CTRUNC) || received != (int)count_byte) {
+        for (int i = 0; i < stored; i++) {
+            close(fds[i]);
+        }
+        errno = EPROTO;
+        return -1;
+    }
+    return stored;
+}
@@ -0,0 +1,447 @@
+/* Micro-benchmarks for the hot pure functions on the message and render
+ * paths.
+ * Usage: ./bench_hotpath [--json] [--compare FILE] [--threshold PCT]
+ *                        [--time-ms N] [filter]
+ *
+ * Each benchmark runs over ASCII, CJK, emoji and mixed message corpora and
+ * reports ns/op and bytes/s.  --json prints one result object per line so a
+ * run can be saved as a baseline; --compare reads such a file and exits 1
+ * when any benchmark is slower than the baseline by more than PCT percent
+ * (default 10). */
+
+#include "../../include/history_view.h"
+#include "../../include/json_text.h"
+#include "../../include/message_format.h"
+#include "../../include/message_log.h"
+#include "../../include/theme.h"
+#include "../../include/utf8.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_RESULTS 64
+#define BENCH_HISTORY_MESSAGES 500
+#define BENCH_ROSTER 64
+/* Timed batches after calibration; the fastest is reported. */
+#define BENCH_REPEATS 3
+
+typedef struct {
+    const char *name;
+    char text[MAX_MESSAGE_LEN];
+    char colored[MAX_MESSAGE_LEN + 64];
+    char record[MESSAGE_LOG_MAX_LINE];
+    char json[MAX_MESSAGE_LEN * 2];
+    message_t msg;
+    size_t len;
+} bench_corpus_t;
+
+typedef struct {
+    const char *name;
+    /* Run `iters` operations on `corpus`; return bytes processed per op,
+     * or 0 when throughput does not apply. */
+    size_t (*run)(const bench_corpus_t *corpus, long iters);
+    bool per_corpus;
+} bench_case_t;
+
+typedef struct {
+    char name[96];
+    long iterations;
+    double ns_per_op;
+    double bytes_per_sec;
+} bench_result_t;
+
+static bench_corpus_t g_corpora[] = {
+    {.name = "ascii"},
+    {.name = "cjk"},
+    {.name = "emoji"},
+    {.name = "mixed"},
+};
+#define BENCH_CORPORA (sizeof(g_corpora) / sizeof(g_corpora[0]))
+
+static const char *g_phrases[BENCH_CORPORA] = {
+    "deploy finished on staging, can someone check the \"login\" page? ",
+    "今天的部署已经完成，请大家检查一下登录页面是否正常。",
+    "🚀🎉 shipped! 👍🏽 👨‍👩‍👧 ❤️ ",
+    "ok 好的 👍 merged #42, 谢谢 — see 日志 ",
+};
+
+static message_t g_history[BENCH_HISTORY_MESSAGES];
+static char g_roster[BENCH_ROSTER][MAX_USERNAME_LEN];
+static volatile size_t g_sink;
+static long g_min_ns = 100000000L;
+
+static long now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void build_corpora(void) {
+    time_t now = time(NULL);
+
+    for (size_t i = 0; i < BENCH_CORPORA; i++) {
+        bench_corpus_t *c = &g_corpora[i];
+        size_t phrase_len = strlen(g_phrases[i]);
+        size_t pos = 0;
+
+        /* Fill to a typical long chat line, ending on a whole phrase. */
+        while (pos + phrase_len < 400) {
+            memcpy(c->text + pos, g_phrases[i], phrase_len);
+            pos += phrase_len;
+        }
+        pos += (size_t)snprintf(c->text + pos, sizeof(c->text) - pos,
+                                "@user%d", BENCH_ROSTER - 1);
+        c->len = pos;
+
+        snprintf(c->colored, sizeof(c->colored),
+                 "\033[90m12:34\033[0m \033[32malice\033[0m: %s", c->text);
+
+        c->msg.timestamp = now - 60;
+        snprintf(c->msg.username, sizeof(c->msg.username), "alice");
+        snprintf(c->msg.content, sizeof(c->msg.content), "%s", c->text);
+        message_log_format_record(&c->msg, c->record, sizeof(c->record),
+                                  NULL);
+
+        pos = (size_t)snprintf(c->json, sizeof(c->json),
+                               "{\"type\":\"message\",\"id\":\"%zu\","
+                               "\"meta\":{\"room\":\"main\"},"
+                               "\"username\":\"alice\",\"content\":", i);
+        tnt_json_append_string(c->json, sizeof(c->json), &pos, c->text);
+        snprintf(c->json + pos, sizeof(c->json) - pos, "}");
+    }
+
+    /* A day boundary every 100 messages adds date separator rows. */
+    for (int i = 0; i < BENCH_HISTORY_MESSAGES; i++) {
+        message_t *m = &g_history[i];
+        const bench_corpus_t *c = &g_corpora[i % BENCH_CORPORA];
+
+        m->timestamp = now - (BENCH_HISTORY_MESSAGES - i) / 100 * 86400 -
+                       (BENCH_HISTORY_MESSAGES - i);
+        snprintf(m->username, sizeof(m->username), "user%d", i % 7);
+        snprintf(m->content, sizeof(m->content), "%.*s",
+                 (int)(i % 5 == 0 ? c->len : 60), c->text);
+    }
+
+    for (int i = 0; i < BENCH_ROSTER; i++) {
+        snprintf(g_roster[i], sizeof(g_roster[i]), "user%d", i);
+    }
+}
+
+static size_t run_utf8_string_width(const bench_corpus_t *c, long iters) {
+    for (long i = 0; i < iters; i++) {
+        g_sink += (size_t)utf8_string_width(c->text);
+    }
+    return c->len;
+}
+
+static size_t run_utf8_ansi_truncate(const bench_corpus_t *c, long iters) {
+    char out[sizeof(c->colored)];
+
+    for (long i = 0; i < iters; i++) {
+        utf8_ansi_truncate(c->colored, out, sizeof(out), 80);
+        g_sink += (unsigned char)out[0];
+    }
+    return strlen(c->colored);
+}
+
+static size_t run_utf8_is_valid_string(const bench_corpus_t *c, long iters) {
+    for (long i = 0; i < iters; i++) {
+        g_sink += utf8_is_valid_string(c->text);
+    }
+    return c->len;
+}
+
+static size_t run_message_log_parse_record(const bench_corpus_t *c,
+                                           long iters) {
+    time_t now = time(NULL);
+    message_t msg;
+
+    for (long i = 0; i < iters; i++) {
+        g_sink += message_log_parse_record(c->record, &msg, now);
+    }
+    return strlen(c->record);
+}
+
+static size_t run_message_log_format_record(const bench_corpus_t *c,
+                                            long iters) {
+    char out[MESSAGE_LOG_MAX_LINE];
+    size_t len = 0;
+
+    for (long i = 0; i < iters; i++) {
+        message_log_format_record(&c->msg, out, sizeof(out), &len);
+        g_sink += len;
+    }
+    return len;
+}
+
+static size_t run_message_format_colored(const bench_corpus_t *c,
+                                         long iters) {
+    char out[MAX_MESSAGE_LEN + 512];
+    const theme_t *theme = theme_default();
+
+    /* 100 columns: the long corpus lines take the truncation path. */
+    for (long i = 0; i < iters; i++) {
+        message_format_colored(&c->msg, out, sizeof(out), 100, "bob", theme);
+        g_sink += (unsigned char)out[1];
+    }
+    return c->len;
+}
+
+static size_t run_history_view_latest_start(const bench_corpus_t *c,
+                                            long iters) {
+    (void)c;
+    for (long i = 0; i < iters; i++) {
+        g_sink += (size_t)history_view_latest_start_for_height(
+            g_history, BENCH_HISTORY_MESSAGES, 40);
+    }
+    return 0;
+}
+
+static size_t run_tnt_json_append_string(const bench_corpus_t *c,
+                                         long iters) {
+    char out[MAX_MESSAGE_LEN * 2];
+
+    for (long i = 0; i < iters; i++) {
+        size_t pos = 0;
+
+        tnt_json_append_string(out, sizeof(out), &pos, c->text);
+        g_sink += pos;
+    }
+    return c->len;
+}
+
+static size_t run_tnt_json_get_string_field(const bench_corpus_t *c,
+                                            long iters) {
+    char out[MAX_MESSAGE_LEN];
+
+    for (long i = 0; i < iters; i++) {
+        g_sink += tnt_json_get_string_field(c->json, "content", out,
+                                            sizeof(out));
+    }
+    return strlen(c->json);
+}
+
+/* The per-client scan notify_mentions() runs under the room lock. */
+static size_t run_notify_mentions_scan(const bench_corpus_t *c, long iters) {
+    for (long i = 0; i < iters; i++) {
+        for (int u = 0; u < BENCH_ROSTER; u++) {
+            g_sink += message_mentions_user(c->text, g_roster[u]);
+        }
+    }
+    return c->len;
+}
+
+static const bench_case_t g_cases[] = {
+    {"utf8_string_width", run_utf8_string_width, true},
+    {"utf8_ansi_truncate", run_utf8_ansi_truncate, true},
+    {"utf8_is_valid_string", run_utf8_is_valid_string, true},
+    {"message_log_parse_record", run_message_log_parse_record, true},
+    {"message_log_format_record", run_message_log_format_record, true},
+    {"message_format_colored", run_message_format_colored, true},
+    {"history_view_latest_start", run_history_view_latest_start, false},
+    {"tnt_json_append_string", run_tnt_json_append_string, true},
+    {"tnt_json_get_string_field", run_tnt_json_get_string_field, true},
+    {"notify_mentions_scan", run_notify_mentions_scan, true},
+};
+
+/* Double the batch size until one batch runs for the minimum time, then
+ * keep the fastest of a few batches of that size. */
+static void bench_measure(const bench_case_t *bc, const bench_corpus_t *c,
+                          bench_result_t *result) {
+    long iters = 16;
+    long elapsed = 0;
+    size_t bytes = 0;
+
+    bc->run(c, iters);
+    for (;;) {
+        long start = now_ns();
+
+        bytes = bc->run(c, iters);
+        elapsed = now_ns() - start;
+        if (elapsed >= g_min_ns || iters >= (1L << 40)) {
+            break;
+        }
+        iters *= 2;
+    }
+    for (int r = 1; r < BENCH_REPEATS; r++) {
+        long start = now_ns();
+        long batch;
+
+        bc->run(c, iters);
+        batch = now_ns() - start;
+        if (batch < elapsed) {
+            elapsed = batch;
+        }
+    }
+
+    result->iterations = iters;
+    result->ns_per_op = (double)elapsed / (double)iters;
+    result->bytes_per_sec = bytes > 0
+                            ? (double)bytes * 1e9 / result->ns_per_op
+                            : 0.0;
+}
+
+/* Read the "name" and "ns_per_op" fields of a --json line. */
+static bool parse_result_line(const char *line, bench_result_t *out) {
+    const char *ns;
+
+    if (!tnt_json_get_string_field(line, "name", out->name,
+                                   sizeof(out->name))) {
+        return false;
+    }
+    ns = strstr(line, "\"ns_per_op\":");
+    return ns && sscanf(ns, "\"ns_per_op\":%lf", &out->ns_per_op) == 1;
+}
+
+static int load_baseline(const char *path, bench_result_t *base, int max) {
+    char line[512];
+    int count = 0;
+    FILE *fp = fopen(path, "r");
+
+    if (!fp) {
+        fprintf(stderr, "bench_hotpath: cannot open %s\n", path);
+        return -1;
+    }
+    while (count < max && fgets(line, sizeof(line), fp)) {
+        if (parse_result_line(line, &base[count])) {
+            count++;
+        }
+    }
+    fclose(fp);
+    return count;
+}
+
+static void print_json(const bench_result_t *r, bool last) {
+    char line[256];
+    size_t pos = 0;
+
+    pos += (size_t)snprintf(line, sizeof(line), "{\"name\":");
+    tnt_json_append_string(line, sizeof(line), &pos, r->name);
+    printf("%s,\"iterations\":%ld,\"ns_per_op\":%.2f,"
+           "\"bytes_per_sec\":%.0f}%s\n",
+           line, r->iterations, r->ns_per_op, r->bytes_per_sec,
+           last ? "" : ",");
+}
+
+static void print_text(const bench_result_t *r) {
+    if (r->bytes_per_sec > 0) {
+        printf("%-42s %12.1f ns/op %10.1f MB/s\n", r->name, r->ns_per_op,
+               r->bytes_per_sec / 1e6);
+    } else {
+        printf("%-42s %12.1f ns/op %10s\n", r->name, r->ns_per_op, "-");
+    }
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--json] [--compare FILE] [--threshold PCT] "
+            "[--time-ms N] [filter]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    static bench_result_t results[BENCH_MAX_RESULTS];
+    static bench_result_t base[BENCH_MAX_RESULTS];
+    bool json = false;
+    const char *compare = NULL;
+    const char *filter = NULL;
+    double threshold = 10.0;
+    int count = 0;
+    int base_count = 0;
+    int regressions = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            compare = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--time-ms") == 0 && i + 1 < argc) {
+            g_min_ns = atol(argv[++i]) * 1000000L;
+        } else if (argv[i][0] != '-' && !filter) {
+            filter = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (g_min_ns <= 0 || threshold <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (compare &&
+        (base_count = load_baseline(compare, base, BENCH_MAX_RESULTS)) < 0) {
+        return 2;
+    }
+
+    build_corpora();
+
+    for (size_t i = 0; i < sizeof(g_cases) / sizeof(g_cases[0]); i++) {
+        size_t runs = g_cases[i].per_corpus ? BENCH_CORPORA : 1;
+
+        for (size_t k = 0; k < runs && count < BENCH_MAX_RESULTS; k++) {
+            bench_result_t *r = &results[count];
+
+            if (g_cases[i].per_corpus) {
+                snprintf(r->name, sizeof(r->name), "%s/%s", g_cases[i].name,
+                         g_corpora[k].name);
+            } else {
+                snprintf(r->name, sizeof(r->name), "%s", g_cases[i].name);
+            }
+            if (filter && !strstr(r->name, filter)) {
+                continue;
+            }
+            bench_measure(&g_cases[i], &g_corpora[k], r);
+            count++;
+            if (!json && !compare) {
+                print_text(r);
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (json) {
+        printf("{\"benchmarks\":[\n");
+        for (int i = 0; i < count; i++) {
+            print_json(&results[i], i == count - 1);
+        }
+        printf("]}\n");
+        return 0;
+    }
+    if (!compare) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *old = NULL;
+        double delta;
+
+        for (int b = 0; b < base_count; b++) {
+            if (strcmp(base[b].name, results[i].name) == 0) {
+                old = &base[b];
+                break;
+            }
+        }
+        if (!old || old->ns_per_op <= 0) {
+            printf("%-42s %12.1f ns/op %12s\n", results[i].name,
+                   results[i].ns_per_op, "new");
+            continue;
+        }
+        delta = (results[i].ns_per_op - old->ns_per_op) * 100.0 /
+                old->ns_per_op;
+        printf("%-42s %12.1f ns/op %+8.1f%%%s\n", results[i].name,
+               results[i].ns_per_op, delta,
+               delta > threshold ? "  REGRESSED" : "");
+        if (delta > threshold) {
+            regressions++;
+        }
+    }
+    if (regressions > 0) {
+        printf("%d benchmark(s) slower than baseline by more than %.0f%%\n",
+               regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
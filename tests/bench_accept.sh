@@ -0,0 +1,137 @@
+#!/bin/sh
+# Accept throughput per acceptor count.
+# Usage: ./bench_accept.sh [seconds] [client_threads] [acceptor counts...]
+#
+# A local load generator opens TCP connections as fast as it can, waits for
+# the SSH banner, and closes.  Reports banners (accepted connections) per
+# second for each TNT_ACCEPTORS value; limits are raised so that admission,
+# not rejection, is measured.
+
+PORT=${PORT:-2222}
+DURATION=${1:-5}
+THREADS=${2:-16}
+BIN="../tnt"
+SERVER_PID=""
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-accept-bench.XXXXXX")
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v python3 >/dev/null 2>&1; then
+    echo "python3 not installed; skipping accept benchmark"
+    exit 0
+fi
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+for value in "$DURATION" "$THREADS"; do
+    case "$value" in
+        ''|*[!0-9]*|0)
+            echo "Error: seconds and client_threads must be positive integers"
+            exit 2
+            ;;
+    esac
+done
+
+if [ $# -gt 2 ]; then
+    shift 2
+else
+    set --
+fi
+if [ $# -eq 0 ]; then
+    CPUS=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+    set -- 1 "$CPUS"
+    [ "$CPUS" -eq 1 ] && set -- 1 2
+fi
+
+cat >"$STATE_DIR/load.py" <<'PYEOF'
+import socket
+import sys
+import threading
+import time
+
+port, duration, threads = int(sys.argv[1]), float(sys.argv[2]), int(sys.argv[3])
+counts = {"banners": 0, "failed": 0}
+lock = threading.Lock()
+deadline = time.time() + duration
+
+
+def run():
+    banners = failed = 0
+    while time.time() < deadline:
+        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        s.settimeout(5.0)
+        try:
+            s.connect(("127.0.0.1", port))
+            if s.recv(64).startswith(b"SSH-"):
+                banners += 1
+            else:
+                failed += 1
+        except OSError:
+            failed += 1
+        finally:
+            s.close()
+    with lock:
+        counts["banners"] += banners
+        counts["failed"] += failed
+
+
+workers = [threading.Thread(target=run) for _ in range(threads)]
+for w in workers:
+    w.start()
+for w in workers:
+    w.join()
+print("%d %d" % (counts["banners"], counts["failed"]))
+PYEOF
+
+run_case() {
+    acceptors=$1
+
+    TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=1024 TNT_MAX_CONN_PER_IP=1024 \
+        TNT_MAX_PENDING_HANDSHAKES=1024 TNT_ACCEPTORS="$acceptors" \
+        "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
+    SERVER_PID=$!
+
+    for _ in $(seq 1 60); do
+        if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+            break
+        fi
+        if grep -q "Accepting on" "$STATE_DIR/server.log"; then
+            break
+        fi
+        sleep 0.5
+    done
+    mode=$(sed -n 's/^Accepting on //p' "$STATE_DIR/server.log")
+    if [ -z "$mode" ]; then
+        echo "Server failed to start (acceptors=$acceptors)"
+        sed -n '1,40p' "$STATE_DIR/server.log"
+        return 1
+    fi
+
+    # shellcheck disable=SC2046
+    set -- $(python3 "$STATE_DIR/load.py" "$PORT" "$DURATION" "$THREADS")
+    kill "$SERVER_PID" 2>/dev/null || true
+    wait "$SERVER_PID" 2>/dev/null || true
+    SERVER_PID=""
+
+    awk -v a="$acceptors" -v mode="$mode" -v ok="${1:-0}" -v failed="${2:-0}" \
+        -v secs="$DURATION" 'BEGIN {
+            printf "%-10s %-28s %9d %7d %10.1f\n", a, mode, ok, failed, ok / secs
+        }'
+}
+
+echo "=== TNT Accept Benchmark (${DURATION}s, ${THREADS} client threads) ==="
+printf "%-10s %-28s %9s %7s %10s\n" "acceptors" "mode" "accepted" "failed" "conn/s"
+for acceptors in "$@"; do
+    run_case "$acceptors"
+done
@@ -0,0 +1,127 @@
+#!/bin/sh
+# `tntctl health` latency over SSH versus the local control socket.
+# Usage: ./bench_control.sh [requests]
+#
+# Starts one server with --control-socket and times `requests` sequential
+# `tntctl health` calls each way, reporting min/median/p90 wall time per
+# call and the server CPU time spent per call (from /proc).
+
+PORT=${PORT:-2222}
+COUNT=${1:-50}
+BIN="../tnt"
+CTL="../tntctl"
+SERVER_PID=""
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-control-bench.XXXXXX")
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v ssh >/dev/null 2>&1; then
+    echo "ssh not installed; skipping control socket benchmark"
+    exit 0
+fi
+
+case "$(date +%s%N 2>/dev/null)" in
+    ''|*[!0-9]*)
+        echo "date lacks nanosecond output; skipping control socket benchmark"
+        exit 0
+        ;;
+esac
+
+if [ ! -f "$BIN" ] || [ ! -f "$CTL" ]; then
+    echo "Error: $BIN or $CTL not found. Run make first."
+    exit 1
+fi
+
+case "$COUNT" in
+    ''|*[!0-9]*|0)
+        echo "Error: requests must be a positive integer"
+        exit 2
+        ;;
+esac
+
+CLK_TCK=$(getconf CLK_TCK 2>/dev/null || echo 100)
+
+now_us() {
+    echo $(($(date +%s%N) / 1000))
+}
+
+server_cpu_ticks() {
+    if [ -r "/proc/$SERVER_PID/stat" ]; then
+        sed 's/.*) //' "/proc/$SERVER_PID/stat" | awk '{print $12 + $13}'
+    else
+        echo 0
+    fi
+}
+
+TNT_RATE_LIMIT=0 TNT_MAX_CONN_PER_IP=1024 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" --control-socket \
+    >"$STATE_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+for _ in $(seq 1 60); do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    if [ -S "$STATE_DIR/control.sock" ] &&
+       grep -q "TNT chat server listening" "$STATE_DIR/server.log"; then
+        break
+    fi
+    sleep 0.5
+done
+if [ ! -S "$STATE_DIR/control.sock" ]; then
+    echo "Server failed to start"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+    exit 1
+fi
+
+# Prints "label ok min_ms median_ms p90_ms server_cpu_ms_per_call"
+run_case() {
+    label=$1
+    shift
+    : >"$STATE_DIR/samples"
+    failures=0
+
+    # Warm-up: host key loading and first-connection costs are not billed
+    "$@" >/dev/null 2>&1
+
+    cpu_before=$(server_cpu_ticks)
+    n=$COUNT
+    while [ "$n" -gt 0 ]; do
+        start=$(now_us)
+        out=$("$@" 2>/dev/null)
+        end=$(now_us)
+        if [ "$out" = "ok" ]; then
+            echo $((end - start)) >>"$STATE_DIR/samples"
+        else
+            failures=$((failures + 1))
+        fi
+        n=$((n - 1))
+    done
+    cpu_after=$(server_cpu_ticks)
+
+    sort -n "$STATE_DIR/samples" | awk -v label="$label" -v failed="$failures" \
+        -v ticks="$((cpu_after - cpu_before))" -v hz="$CLK_TCK" '
+        { v[NR] = $1 }
+        END {
+            if (NR == 0) { printf "%-8s %6d %6d\n", label, 0, failed; exit }
+            printf "%-8s %6d %6d %9.2f %9.2f %9.2f %12.3f\n", label, NR, failed,
+                   v[1] / 1000, v[int((NR + 1) / 2)] / 1000,
+                   v[int((NR * 9 + 9) / 10)] / 1000,
+                   ticks * 1000 / hz / NR
+        }'
+}
+
+echo "=== tntctl health latency ($COUNT calls each) ==="
+printf "%-8s %6s %6s %9s %9s %9s %12s\n" \
+    "path" "ok" "failed" "min_ms" "p50_ms" "p90_ms" "srv_cpu_ms"
+run_case ssh "$CTL" -p "$PORT" --host-key-checking no \
+    --known-hosts /dev/null localhost health
+run_case local "$CTL" --local -d "$STATE_DIR" health
@@ -0,0 +1,137 @@
+#!/bin/sh
+# SSH exec session cost: `tntctl post` round trip and exec sessions/sec.
+# Usage: ./bench_exec.sh [posts] [sessions] [concurrency]
+#
+# Times `posts` sequential `tntctl post` calls (min/median/p90 wall time),
+# then runs `sessions` `health` exec sessions spread over `concurrency`
+# parallel clients and reports sessions per second.  Set BIN to an older
+# build of tnt to compare before and after.
+
+PORT=${PORT:-2222}
+POSTS=${1:-50}
+SESSIONS=${2:-200}
+CONCURRENCY=${3:-4}
+BIN=${BIN:-../tnt}
+CTL="../tntctl"
+SERVER_PID=""
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-exec-bench.XXXXXX")
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v ssh >/dev/null 2>&1; then
+    echo "ssh not installed; skipping exec benchmark"
+    exit 0
+fi
+
+case "$(date +%s%N 2>/dev/null)" in
+    ''|*[!0-9]*)
+        echo "date lacks nanosecond output; skipping exec benchmark"
+        exit 0
+        ;;
+esac
+
+if [ ! -f "$BIN" ] || [ ! -f "$CTL" ]; then
+    echo "Error: $BIN or $CTL not found. Run make first."
+    exit 1
+fi
+
+for value in "$POSTS" "$SESSIONS" "$CONCURRENCY"; do
+    case "$value" in
+        ''|*[!0-9]*|0)
+            echo "Error: posts, sessions and concurrency must be positive integers"
+            exit 2
+            ;;
+    esac
+done
+
+SSH_OPTS="-n -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o BatchMode=yes -o LogLevel=ERROR -p $PORT"
+
+now_us() {
+    echo $(($(date +%s%N) / 1000))
+}
+
+TNT_RATE_LIMIT=0 TNT_POST_RATE=0 TNT_POST_IP_RATE=0 TNT_MAX_CONN_PER_IP=1024 TNT_MAX_CONNECTIONS=1024 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+READY=""
+for _ in $(seq 1 30); do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    # shellcheck disable=SC2086
+    READY=$(ssh $SSH_OPTS localhost health 2>/dev/null || true)
+    [ "$READY" = "ok" ] && break
+    sleep 0.5
+done
+if [ "$READY" != "ok" ]; then
+    echo "Server failed to start"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+    exit 1
+fi
+
+echo "=== tntctl post round trip ($POSTS calls) ==="
+: >"$STATE_DIR/samples"
+FAILED=0
+n=$POSTS
+while [ "$n" -gt 0 ]; do
+    start=$(now_us)
+    out=$("$CTL" -p "$PORT" --host-key-checking no --known-hosts /dev/null \
+        -l bench localhost post "bench message $n" 2>/dev/null)
+    end=$(now_us)
+    if [ "$out" = "posted" ]; then
+        echo $((end - start)) >>"$STATE_DIR/samples"
+    else
+        FAILED=$((FAILED + 1))
+    fi
+    n=$((n - 1))
+done
+printf "%6s %6s %9s %9s %9s\n" "ok" "failed" "min_ms" "p50_ms" "p90_ms"
+sort -n "$STATE_DIR/samples" | awk -v failed="$FAILED" '
+    { v[NR] = $1 }
+    END {
+        if (NR == 0) { printf "%6d %6d\n", 0, failed; exit }
+        printf "%6d %6d %9.2f %9.2f %9.2f\n", NR, failed, v[1] / 1000,
+               v[int((NR + 1) / 2)] / 1000, v[int((NR * 9 + 9) / 10)] / 1000
+    }'
+
+echo ""
+echo "=== exec sessions/sec ($SESSIONS health sessions, $CONCURRENCY clients) ==="
+PER_CLIENT=$(((SESSIONS + CONCURRENCY - 1) / CONCURRENCY))
+CLIENT_PIDS=""
+start=$(now_us)
+c=0
+while [ "$c" -lt "$CONCURRENCY" ]; do
+    (
+        ok=0
+        i=0
+        while [ "$i" -lt "$PER_CLIENT" ]; do
+            # shellcheck disable=SC2086
+            [ "$(ssh $SSH_OPTS localhost health 2>/dev/null)" = "ok" ] &&
+                ok=$((ok + 1))
+            i=$((i + 1))
+        done
+        echo "$ok" >"$STATE_DIR/client.$c"
+    ) &
+    CLIENT_PIDS="$CLIENT_PIDS $!"
+    c=$((c + 1))
+done
+for pid in $CLIENT_PIDS; do
+    wait "$pid"
+done
+end=$(now_us)
+OK=$(cat "$STATE_DIR"/client.* | awk '{ s += $1 } END { print s + 0 }')
+TOTAL=$((PER_CLIENT * CONCURRENCY))
+awk -v ok="$OK" -v total="$TOTAL" -v us="$((end - start))" 'BEGIN {
+    printf "%6s %6s %9s %12s\n", "ok", "failed", "secs", "sessions/s"
+    printf "%6d %6d %9.2f %12.1f\n", ok, total - ok, us / 1000000,
+           ok * 1000000 / us
+}'
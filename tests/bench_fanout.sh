@@ -0,0 +1,101 @@
+#!/bin/sh
+# Room fanout benchmark driven by the native load generator.
+# Usage: ./bench_fanout.sh [clients] [duration_seconds] [posts_per_second]
+#
+# Starts a server sized for `clients` interactive sessions, runs
+# loadgen/tnt_loadgen against it and prints its report: connect rate,
+# delivery latency of posted markers to every other session, bytes received
+# per client, and the server's RSS and CPU once a second.
+
+PORT=${PORT:-2222}
+CLIENTS=${1:-200}
+DURATION=${2:-10}
+RATE=${3:-20}
+THREADS=${THREADS:-4}
+BIN="../tnt"
+LOADGEN="loadgen/tnt_loadgen"
+SERVER_PID=""
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-fanout-bench.XXXXXX")
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+if [ ! -x "$LOADGEN" ]; then
+    echo "Error: $LOADGEN not found. Run make loadgen."
+    exit 1
+fi
+
+for value in "$CLIENTS" "$DURATION" "$RATE" "$THREADS"; do
+    case "$value" in
+        ''|*[!0-9]*|0)
+            echo "Error: clients, duration, rate and THREADS must be positive integers"
+            exit 2
+            ;;
+    esac
+done
+
+# The server accepts at most 1024 sessions.
+if [ "$CLIENTS" -gt 1024 ]; then
+    echo "Error: at most 1024 clients"
+    exit 2
+fi
+
+if [ "$(ulimit -n)" != "unlimited" ] && [ "$(ulimit -n)" -lt $((CLIENTS * 2 + 64)) ]; then
+    ulimit -n $((CLIENTS * 2 + 64)) 2>/dev/null || {
+        echo "Error: open file limit $(ulimit -n) is too low for $CLIENTS clients"
+        exit 2
+    }
+fi
+
+# Posting and connection limits would measure the limiter, not fanout.
+TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=$((CLIENTS + 16)) \
+    TNT_MAX_CONN_PER_IP=$((CLIENTS + 16)) TNT_POST_RATE=0 TNT_POST_IP_RATE=0 \
+    TNT_IDLE_TIMEOUT=0 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+started=0
+for _ in $(seq 1 60); do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    if grep -q "TNT chat server listening" "$STATE_DIR/server.log"; then
+        started=1
+        break
+    fi
+    sleep 0.5
+done
+if [ "$started" -ne 1 ]; then
+    echo "Server failed to start"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+    exit 1
+fi
+
+SERVER_CPU_ARG=""
+if [ -r "/proc/$SERVER_PID/stat" ]; then
+    SERVER_CPU_ARG="-s $SERVER_PID"
+fi
+
+echo "=== TNT Fanout Benchmark ==="
+# shellcheck disable=SC2086
+"$LOADGEN" -H 127.0.0.1 -p "$PORT" -c "$CLIENTS" -d "$DURATION" \
+    -r "$RATE" -t "$THREADS" $SERVER_CPU_ARG
+status=$?
+
+if [ "$status" -ne 0 ]; then
+    echo "Load generator reported failures (exit $status)"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+fi
+exit "$status"
@@ -0,0 +1,163 @@
+#!/bin/sh
+# SSH handshake cost per host key type and algorithm profile.
+# Usage: ./bench_handshake.sh [handshakes] [concurrency]
+#
+# Starts one server per configuration, drives `handshakes` exec sessions
+# running the cheap `health` command, and reports handshakes per second of
+# wall time and per second of server CPU time (i.e. per core).  Server CPU
+# is read from /proc, so client-side ssh cost on the same host is excluded.
+
+PORT=${PORT:-2222}
+COUNT=${1:-200}
+CONCURRENCY=${2:-4}
+BIN="../tnt"
+SERVER_PID=""
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-handshake-bench.XXXXXX")
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v ssh >/dev/null 2>&1; then
+    echo "ssh not installed; skipping handshake benchmark"
+    exit 0
+fi
+
+if [ ! -r /proc/self/stat ]; then
+    echo "/proc not available; skipping handshake benchmark"
+    exit 0
+fi
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+for value in "$COUNT" "$CONCURRENCY"; do
+    case "$value" in
+        ''|*[!0-9]*|0)
+            echo "Error: handshakes and concurrency must be positive integers"
+            exit 2
+            ;;
+    esac
+done
+
+CLK_TCK=$(getconf CLK_TCK 2>/dev/null || echo 100)
+SSH_OPTS="-o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o BatchMode=yes -o LogLevel=ERROR -p $PORT"
+
+now_ms() {
+    date +%s%3N
+}
+
+# utime + stime of the server, in clock ticks
+server_cpu_ticks() {
+    sed 's/.*) //' "/proc/$SERVER_PID/stat" | awk '{print $12 + $13}'
+}
+
+start_server() {
+    TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=1024 TNT_MAX_CONN_PER_IP=1024 \
+        TNT_HOST_KEYS="$1" TNT_SSH_PROFILE="$2" \
+        "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
+    SERVER_PID=$!
+
+    for _ in $(seq 1 60); do
+        if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+            break
+        fi
+        if grep -q "TNT chat server listening" "$STATE_DIR/server.log"; then
+            return 0
+        fi
+        sleep 0.5
+    done
+    echo "Server failed to start (keys=$1 profile=$2)"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+    return 1
+}
+
+stop_server() {
+    kill "$SERVER_PID" 2>/dev/null || true
+    wait "$SERVER_PID" 2>/dev/null || true
+    SERVER_PID=""
+}
+
+worker() {
+    n=$1
+    hostkey_alg=$2
+    failures=0
+    while [ "$n" -gt 0 ]; do
+        # shellcheck disable=SC2086
+        ssh $SSH_OPTS -o HostKeyAlgorithms="$hostkey_alg" localhost health \
+            >/dev/null 2>&1 || failures=$((failures + 1))
+        n=$((n - 1))
+    done
+    echo "$failures" >"$STATE_DIR/worker.$3"
+}
+
+run_case() {
+    label=$1
+    keys=$2
+    profile=$3
+    hostkey_alg=$4
+
+    start_server "$keys" "$profile" || return 1
+
+    # One warm-up connection so key loading is not billed to the run
+    # shellcheck disable=SC2086
+    ssh $SSH_OPTS -o HostKeyAlgorithms="$hostkey_alg" localhost health \
+        >/dev/null 2>&1
+
+    per_worker=$(( (COUNT + CONCURRENCY - 1) / CONCURRENCY ))
+    total=$((per_worker * CONCURRENCY))
+    cpu_before=$(server_cpu_ticks)
+    start=$(now_ms)
+
+    w=0
+    pids=""
+    while [ "$w" -lt "$CONCURRENCY" ]; do
+        worker "$per_worker" "$hostkey_alg" "$w" &
+        pids="$pids $!"
+        w=$((w + 1))
+    done
+    for pid in $pids; do
+        wait "$pid"
+    done
+
+    end=$(now_ms)
+    cpu_after=$(server_cpu_ticks)
+    stop_server
+
+    failures=$(cat "$STATE_DIR"/worker.* | awk '{s += $1} END {print s + 0}')
+    rm -f "$STATE_DIR"/worker.*
+
+    awk -v label="$label" -v total="$total" -v failed="$failures" \
+        -v wall_ms="$((end - start))" -v ticks="$((cpu_after - cpu_before))" \
+        -v hz="$CLK_TCK" 'BEGIN {
+            ok = total - failed
+            wall = wall_ms / 1000.0
+            cpu = ticks / hz
+            printf "%-18s %6d %6d %9.2f %9.2f %10.1f %12s %10s\n",
+                   label, ok, failed, wall, cpu,
+                   wall > 0 ? ok / wall : 0,
+                   cpu > 0 ? sprintf("%.1f", ok / cpu) : "n/a",
+                   ok > 0 ? sprintf("%.2f", cpu * 1000 / ok) : "n/a"
+        }'
+}
+
+echo "=== TNT SSH Handshake Benchmark ($COUNT handshakes, $CONCURRENCY clients) ==="
+echo "Generating host keys..."
+start_server "ed25519,ecdsa,rsa" default || exit 1
+stop_server
+
+printf "%-18s %6s %6s %9s %9s %10s %12s %10s\n" \
+    "config" "ok" "failed" "wall_s" "cpu_s" "hs/s" "hs/s/core" "cpu_ms/hs"
+run_case "rsa/default" rsa default rsa-sha2-512,rsa-sha2-256
+run_case "ecdsa/fast" ecdsa fast ecdsa-sha2-nistp256
+run_case "ed25519/default" ed25519 default ssh-ed25519
+run_case "ed25519/fast" ed25519 fast ssh-ed25519
+run_case "ed25519/modern" ed25519 modern ssh-ed25519
@@ -0,0 +1,95 @@
+#!/bin/sh
+# Replays a session capture against a fresh server.
+# Usage: ./bench_replay.sh capture_file [speed]
+#
+# Starts a server with limits lifted, runs loadgen/tnt_replay against it at
+# `speed` times the captured pace (0 = as fast as possible) and prints its
+# report: response latency per input, bytes received, and the server's
+# RSS and CPU once a second.  Record a capture by running a server with
+# TNT_CAPTURE=1; the file appears in its state directory.
+
+PORT=${PORT:-2222}
+CAPTURE=$1
+SPEED=${2:-1}
+THREADS=${THREADS:-4}
+BIN="../tnt"
+REPLAY="loadgen/tnt_replay"
+SERVER_PID=""
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-replay-bench.XXXXXX")
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if [ -z "$CAPTURE" ] || [ ! -r "$CAPTURE" ]; then
+    echo "Usage: $0 capture_file [speed]"
+    exit 2
+fi
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+if [ ! -x "$REPLAY" ]; then
+    echo "Error: $REPLAY not found. Run make replay."
+    exit 1
+fi
+
+case "$THREADS" in
+    ''|*[!0-9]*|0)
+        echo "Error: THREADS must be a positive integer"
+        exit 2
+        ;;
+esac
+
+if [ "$(ulimit -n)" != "unlimited" ] && [ "$(ulimit -n)" -lt 2112 ]; then
+    ulimit -n 2112 2>/dev/null || true
+fi
+
+# Captured sessions may overlap heavily when sped up; measure the server,
+# not its limiters.
+TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=1024 TNT_MAX_CONN_PER_IP=1024 \
+    TNT_POST_RATE=0 TNT_POST_IP_RATE=0 TNT_IDLE_TIMEOUT=0 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+started=0
+for _ in $(seq 1 60); do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    if grep -q "TNT chat server listening" "$STATE_DIR/server.log"; then
+        started=1
+        break
+    fi
+    sleep 0.5
+done
+if [ "$started" -ne 1 ]; then
+    echo "Server failed to start"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+    exit 1
+fi
+
+SERVER_CPU_ARG=""
+if [ -r "/proc/$SERVER_PID/stat" ]; then
+    SERVER_CPU_ARG="-s $SERVER_PID"
+fi
+
+echo "=== TNT Capture Replay ==="
+# shellcheck disable=SC2086
+"$REPLAY" -H 127.0.0.1 -p "$PORT" -x "$SPEED" -t "$THREADS" \
+    $SERVER_CPU_ARG "$CAPTURE"
+status=$?
+
+if [ "$status" -ne 0 ]; then
+    echo "Replay reported failures (exit $status)"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+fi
+exit "$status"
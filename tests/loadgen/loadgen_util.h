@@ -0,0 +1,152 @@
+/* Helpers shared by the SSH load tools: clock, latency histogram, server
+ * /proc sampling and option parsing. */
+
+#ifndef LOADGEN_UTIL_H
+#define LOADGEN_UTIL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* 16 exact microsecond buckets, then 8 per power of two. */
+#define LOADGEN_HIST_BUCKETS (16 + 8 * 44)
+
+typedef struct {
+    uint64_t counts[LOADGEN_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max_us;
+} loadgen_hist_t;
+
+typedef struct {
+    uint64_t cpu_ticks;
+    long rss_kb;
+} server_sample_t;
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+static inline int hist_bucket(uint64_t us) {
+    int exp = 63 - __builtin_clzll(us | 1);
+    int index;
+
+    if (us < 16) {
+        return (int)us;
+    }
+    index = 16 + (exp - 4) * 8 + (int)((us >> (exp - 3)) & 7);
+    return index < LOADGEN_HIST_BUCKETS ? index : LOADGEN_HIST_BUCKETS - 1;
+}
+
+/* Largest value that falls in bucket `index`. */
+static inline uint64_t hist_bucket_upper(int index) {
+    int exp;
+
+    if (index < 16) {
+        return (uint64_t)index;
+    }
+    exp = (index - 16) / 8 + 4;
+    return ((uint64_t)(8 + (index - 16) % 8 + 1) << (exp - 3)) - 1;
+}
+
+static inline void hist_add(loadgen_hist_t *hist, uint64_t us) {
+    hist->counts[hist_bucket(us)]++;
+    hist->total++;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+}
+
+static inline void hist_merge(loadgen_hist_t *into,
+                              const loadgen_hist_t *from) {
+    for (int i = 0; i < LOADGEN_HIST_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    if (from->max_us > into->max_us) {
+        into->max_us = from->max_us;
+    }
+}
+
+static inline double hist_quantile_ms(const loadgen_hist_t *hist, double q) {
+    uint64_t rank = (uint64_t)(q * (double)hist->total + 0.999999);
+    uint64_t seen = 0;
+
+    if (hist->total == 0) {
+        return 0.0;
+    }
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (int i = 0; i < LOADGEN_HIST_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= rank) {
+            uint64_t upper = hist_bucket_upper(i);
+
+            return (double)(upper < hist->max_us ? upper : hist->max_us) /
+                   1000.0;
+        }
+    }
+    return (double)hist->max_us / 1000.0;
+}
+
+/* CPU ticks and RSS of process `pid` from /proc. */
+static inline int read_server_sample(long pid, server_sample_t *sample) {
+    char path[64];
+    char line[1024];
+    FILE *fp;
+    const char *p;
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+
+    snprintf(path, sizeof(path), "/proc/%ld/stat", pid);
+    fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    p = fgets(line, sizeof(line), fp) ? strrchr(line, ')') : NULL;
+    fclose(fp);
+    /* Fields after the command name: state is 3rd, utime 14th, stime 15th */
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                            "%llu %llu", &utime, &stime) != 2) {
+        return -1;
+    }
+    sample->cpu_ticks = utime + stime;
+
+    snprintf(path, sizeof(path), "/proc/%ld/status", pid);
+    fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    sample->rss_kb = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "VmRSS: %ld", &sample->rss_kb) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+static inline int parse_positive(const char *text, long max, long *out) {
+    char *end = NULL;
+    long value = strtol(text, &end, 10);
+
+    if (!end || *end != '\0' || value <= 0 || value > max) {
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+#endif /* LOADGEN_UTIL_H */
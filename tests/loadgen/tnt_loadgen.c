@@ -0,0 +1,694 @@
+/* Multi-session SSH load generator for room fanout benchmarks.
+ * Usage: ./tnt_loadgen [-H host] [-p port] [-c clients] [-d seconds]
+ *                      [-r posts_per_second] [-t threads] [-s server_pid]
+ *                      [-C sessions]
+ *
+ * Opens `clients` interactive PTY sessions, answers the display-name
+ * prompt, then posts numbered markers at the given total rate from
+ * rotating sessions.  Every other session scans its rendered stream for
+ * the markers, so delivery latency is measured from the write on the
+ * posting socket to the first frame that shows the marker elsewhere.
+ * With -s, the server's RSS and CPU use are sampled from /proc once a
+ * second.
+ *
+ * With -C, no sessions are held: `sessions` interactive logins are
+ * churned across the worker threads instead, each answering the name
+ * prompt, waiting for the chat screen to render and disconnecting. */
+
+#include "loadgen_util.h"
+#include <libssh/libssh.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOADGEN_COLS 100
+#define LOADGEN_ROWS 40
+#define LOADGEN_PROMPT_TIMEOUT_MS 10000
+#define LOADGEN_DRAIN_MS 2000
+#define LOADGEN_READ_CHUNK 16384
+/* "~lg" + 8 digits + "~" */
+#define LOADGEN_MARKER_LEN 12
+/* Markers remembered per session; far more than fit on one screen. */
+#define LOADGEN_SEEN_WINDOW 1024
+/* Input-line prompt "›", drawn only once the chat screen is up. */
+#define LOADGEN_CHAT_PROMPT "\xe2\x80\xba"
+
+typedef struct {
+    ssh_session session;
+    ssh_channel channel;
+    int index;
+    bool ready;
+    bool dead;
+    uint64_t bytes_received;
+    char carry[LOADGEN_MARKER_LEN];
+    size_t carry_len;
+    uint32_t seen[LOADGEN_SEEN_WINDOW];    /* marker id + 1 per slot */
+} loadgen_client_t;
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    int first;
+    int count;
+    loadgen_hist_t connect_us;
+    loadgen_hist_t delivery_us;
+    uint64_t deliveries;
+    uint64_t posted;
+} loadgen_worker_t;
+
+typedef struct {
+    _Atomic uint64_t sent_ns;
+    _Atomic int poster;
+} loadgen_marker_t;
+
+static const char *g_host = "127.0.0.1";
+static unsigned int g_port = 2222;
+static int g_clients = 100;
+static int g_duration = 10;
+static double g_rate = 10.0;
+static int g_threads = 4;
+static long g_server_pid;
+static int g_churn;
+
+static loadgen_client_t *g_client_table;
+static loadgen_marker_t *g_markers;
+static uint32_t g_marker_capacity;
+static atomic_uint g_next_marker;
+static atomic_int g_connected;
+static atomic_int g_failed;
+static atomic_bool g_posting;
+static atomic_bool g_stop;
+static atomic_int g_churn_next;
+static pthread_barrier_t g_ready_barrier;
+
+static void client_close(loadgen_client_t *client) {
+    if (client->channel) {
+        ssh_channel_send_eof(client->channel);
+        ssh_channel_close(client->channel);
+        ssh_channel_free(client->channel);
+        client->channel = NULL;
+    }
+    if (client->session) {
+        ssh_disconnect(client->session);
+        ssh_free(client->session);
+        client->session = NULL;
+    }
+    client->dead = true;
+}
+
+static bool prompt_seen(const char *text) {
+    return strstr(text, "display name") || strstr(text, "用户名");
+}
+
+/* Connect, open a PTY shell and answer the name prompt. */
+static int client_connect(loadgen_client_t *client) {
+    char user[32];
+    char prompt[4096];
+    size_t prompt_len = 0;
+    long timeout_s = 10;
+    int verbosity = SSH_LOG_NOLOG;
+    uint64_t deadline;
+    int rc;
+
+    snprintf(user, sizeof(user), "lg%d", client->index);
+    client->session = ssh_new();
+    if (!client->session) {
+        return -1;
+    }
+    ssh_options_set(client->session, SSH_OPTIONS_HOST, g_host);
+    ssh_options_set(client->session, SSH_OPTIONS_PORT, &g_port);
+    ssh_options_set(client->session, SSH_OPTIONS_USER, user);
+    ssh_options_set(client->session, SSH_OPTIONS_TIMEOUT, &timeout_s);
+    ssh_options_set(client->session, SSH_OPTIONS_LOG_VERBOSITY, &verbosity);
+
+    if (ssh_connect(client->session) != SSH_OK) {
+        fprintf(stderr, "tnt_loadgen: %s: connect: %s\n", user,
+                ssh_get_error(client->session));
+        return -1;
+    }
+    rc = ssh_userauth_none(client->session, NULL);
+    if (rc != SSH_AUTH_SUCCESS) {
+        rc = ssh_userauth_password(client->session, NULL, "");
+    }
+    if (rc != SSH_AUTH_SUCCESS) {
+        fprintf(stderr, "tnt_loadgen: %s: authentication refused\n", user);
+        return -1;
+    }
+
+    client->channel = ssh_channel_new(client->session);
+    if (!client->channel ||
+        ssh_channel_open_session(client->channel) != SSH_OK ||
+        ssh_channel_request_pty_size(client->channel, "xterm-256color",
+                                     LOADGEN_COLS, LOADGEN_ROWS) != SSH_OK ||
+        ssh_channel_request_shell(client->channel) != SSH_OK) {
+        fprintf(stderr, "tnt_loadgen: %s: shell: %s\n", user,
+                ssh_get_error(client->session));
+        return -1;
+    }
+
+    deadline = now_ns() + (uint64_t)LOADGEN_PROMPT_TIMEOUT_MS * 1000000u;
+    prompt[0] = '\0';
+    while (!prompt_seen(prompt)) {
+        int n;
+
+        if (now_ns() > deadline || prompt_len + 1 >= sizeof(prompt)) {
+            fprintf(stderr, "tnt_loadgen: %s: no name prompt\n", user);
+            return -1;
+        }
+        n = ssh_channel_read_timeout(client->channel, prompt + prompt_len,
+                                     sizeof(prompt) - prompt_len - 1, 0,
+                                     100);
+        if (n == SSH_ERROR || ssh_channel_is_eof(client->channel)) {
+            fprintf(stderr, "tnt_loadgen: %s: closed before prompt\n", user);
+            return -1;
+        }
+        if (n > 0) {
+            prompt_len += (size_t)n;
+            prompt[prompt_len] = '\0';
+            client->bytes_received += (uint64_t)n;
+        }
+    }
+
+    snprintf(prompt, sizeof(prompt), "%s\r", user);
+    if (ssh_channel_write(client->channel, prompt,
+                          (uint32_t)strlen(prompt)) < 0) {
+        return -1;
+    }
+    client->ready = true;
+    return 0;
+}
+
+/* Read until the chat screen's input prompt has been rendered. */
+static int chat_screen_wait(loadgen_client_t *client) {
+    char buf[4096];
+    size_t len = 0;
+    uint64_t deadline = now_ns() +
+                        (uint64_t)LOADGEN_PROMPT_TIMEOUT_MS * 1000000u;
+
+    while (now_ns() <= deadline) {
+        size_t keep;
+        int n = ssh_channel_read_timeout(client->channel, buf + len,
+                                         sizeof(buf) - len - 1, 0, 100);
+
+        if (n == SSH_ERROR || ssh_channel_is_eof(client->channel)) {
+            fprintf(stderr, "tnt_loadgen: lg%d: closed before chat screen\n",
+                    client->index);
+            return -1;
+        }
+        if (n <= 0) {
+            continue;
+        }
+        client->bytes_received += (uint64_t)n;
+        len += (size_t)n;
+        buf[len] = '\0';
+        if (strstr(buf, LOADGEN_CHAT_PROMPT)) {
+            return 0;
+        }
+        /* Keep a partial prompt sequence split across reads. */
+        keep = len < sizeof(LOADGEN_CHAT_PROMPT) - 2
+               ? len : sizeof(LOADGEN_CHAT_PROMPT) - 2;
+        memmove(buf, buf + len - keep, keep);
+        len = keep;
+    }
+    fprintf(stderr, "tnt_loadgen: lg%d: chat screen never rendered\n",
+            client->index);
+    return -1;
+}
+
+static void note_marker(loadgen_worker_t *worker, loadgen_client_t *client,
+                        uint32_t id, uint64_t now) {
+    uint32_t *slot = &client->seen[id % LOADGEN_SEEN_WINDOW];
+    uint64_t sent;
+
+    if (id >= g_marker_capacity || *slot == id + 1) {
+        return;
+    }
+    sent = atomic_load(&g_markers[id].sent_ns);
+    if (sent == 0 || atomic_load(&g_markers[id].poster) == client->index) {
+        return;
+    }
+    *slot = id + 1;
+    worker->deliveries++;
+    hist_add(&worker->delivery_us, now > sent ? (now - sent) / 1000u : 0);
+}
+
+/* Find markers in new output; a marker may straddle two reads. */
+static void scan_output(loadgen_worker_t *worker, loadgen_client_t *client,
+                        const char *data, size_t len, uint64_t now) {
+    char buf[LOADGEN_MARKER_LEN + LOADGEN_READ_CHUNK];
+    size_t total = client->carry_len + len;
+    size_t keep;
+
+    memcpy(buf, client->carry, client->carry_len);
+    memcpy(buf + client->carry_len, data, len);
+
+    for (size_t i = 0; i + LOADGEN_MARKER_LEN <= total; i++) {
+        uint32_t id = 0;
+        bool digits = true;
+
+        if (buf[i] != '~' || buf[i + 1] != 'l' || buf[i + 2] != 'g' ||
+            buf[i + LOADGEN_MARKER_LEN - 1] != '~') {
+            continue;
+        }
+        for (int d = 3; d < LOADGEN_MARKER_LEN - 1; d++) {
+            if (buf[i + d] < '0' || buf[i + d] > '9') {
+                digits = false;
+                break;
+            }
+            id = id * 10 + (uint32_t)(buf[i + d] - '0');
+        }
+        if (digits) {
+            note_marker(worker, client, id, now);
+            i += LOADGEN_MARKER_LEN - 1;
+        }
+    }
+
+    keep = total < LOADGEN_MARKER_LEN - 1 ? total : LOADGEN_MARKER_LEN - 1;
+    memcpy(client->carry, buf + total - keep, keep);
+    client->carry_len = keep;
+}
+
+static void post_marker(loadgen_worker_t *worker, loadgen_client_t *client) {
+    uint32_t id = atomic_fetch_add(&g_next_marker, 1);
+    char line[LOADGEN_MARKER_LEN + 2];
+
+    if (id >= g_marker_capacity) {
+        return;
+    }
+    snprintf(line, sizeof(line), "~lg%08u~\r", id);
+    atomic_store(&g_markers[id].poster, client->index);
+    atomic_store(&g_markers[id].sent_ns, now_ns());
+    if (ssh_channel_write(client->channel, line,
+                          LOADGEN_MARKER_LEN + 1) < 0) {
+        client_close(client);
+        return;
+    }
+    worker->posted++;
+}
+
+static void *worker_main(void *arg) {
+    loadgen_worker_t *worker = arg;
+    struct pollfd *fds = calloc((size_t)worker->count + 1, sizeof(*fds));
+    char *chunk = malloc(LOADGEN_READ_CHUNK);
+    double worker_rate = g_rate / g_threads;
+    uint64_t interval_ns = worker_rate > 0
+                           ? (uint64_t)(1e9 / worker_rate) : 0;
+    uint64_t next_post;
+    int next_poster = 0;
+
+    for (int i = 0; i < worker->count; i++) {
+        loadgen_client_t *client = &g_client_table[worker->first + i];
+        uint64_t start = now_ns();
+
+        if (client_connect(client) == 0) {
+            hist_add(&worker->connect_us, (now_ns() - start) / 1000u);
+            atomic_fetch_add(&g_connected, 1);
+        } else {
+            client_close(client);
+            atomic_fetch_add(&g_failed, 1);
+        }
+    }
+    pthread_barrier_wait(&g_ready_barrier);
+    /* Stagger the workers' posts across one interval. */
+    next_post = now_ns() + interval_ns * (uint64_t)worker->id /
+                           (uint64_t)g_threads;
+
+    while (!atomic_load(&g_stop)) {
+        uint64_t now = now_ns();
+        bool any = false;
+        int nfds = 0;
+
+        if (interval_ns > 0 && atomic_load(&g_posting) && now >= next_post) {
+            for (int tries = 0; tries < worker->count; tries++) {
+                loadgen_client_t *client =
+                    &g_client_table[worker->first + next_poster];
+
+                next_poster = (next_poster + 1) % worker->count;
+                if (client->ready && !client->dead) {
+                    post_marker(worker, client);
+                    break;
+                }
+            }
+            next_post += interval_ns;
+            if (next_post < now) {
+                next_post = now + interval_ns;
+            }
+        }
+
+        for (int i = 0; i < worker->count; i++) {
+            loadgen_client_t *client = &g_client_table[worker->first + i];
+            int n;
+
+            if (!client->ready || client->dead) {
+                continue;
+            }
+            while ((n = ssh_channel_read_nonblocking(client->channel, chunk,
+                                                     LOADGEN_READ_CHUNK,
+                                                     0)) > 0) {
+                client->bytes_received += (uint64_t)n;
+                scan_output(worker, client, chunk, (size_t)n, now_ns());
+                any = true;
+            }
+            if (n == SSH_ERROR || ssh_channel_is_eof(client->channel)) {
+                client_close(client);
+                continue;
+            }
+            fds[nfds].fd = ssh_get_fd(client->session);
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+
+        if (!any) {
+            int wait_ms = 10;
+
+            if (interval_ns > 0 && atomic_load(&g_posting)) {
+                uint64_t left = next_post > now_ns()
+                                ? (next_post - now_ns()) / 1000000u : 0;
+
+                if (left < (uint64_t)wait_ms) {
+                    wait_ms = (int)left;
+                }
+            }
+            if (nfds > 0) {
+                poll(fds, (nfds_t)nfds, wait_ms);
+            } else {
+                sleep_ms(wait_ms);
+            }
+        }
+    }
+
+    for (int i = 0; i < worker->count; i++) {
+        client_close(&g_client_table[worker->first + i]);
+    }
+    free(chunk);
+    free(fds);
+    return NULL;
+}
+
+static void *churn_main(void *arg) {
+    loadgen_worker_t *worker = arg;
+    int index;
+
+    while ((index = atomic_fetch_add(&g_churn_next, 1)) < g_churn) {
+        loadgen_client_t client;
+        uint64_t start = now_ns();
+
+        memset(&client, 0, sizeof(client));
+        client.index = index;
+        if (client_connect(&client) == 0 && chat_screen_wait(&client) == 0) {
+            hist_add(&worker->connect_us, (now_ns() - start) / 1000u);
+            atomic_fetch_add(&g_connected, 1);
+        } else {
+            atomic_fetch_add(&g_failed, 1);
+        }
+        client_close(&client);
+    }
+    return NULL;
+}
+
+/* -C: log in and out `g_churn` times; nothing is held open. */
+static int churn_run(void) {
+    loadgen_worker_t *workers;
+    loadgen_hist_t connect_us = {0};
+    uint64_t start;
+    double seconds;
+    int failed;
+
+    if (g_threads > g_churn) {
+        g_threads = g_churn;
+    }
+    workers = calloc((size_t)g_threads, sizeof(*workers));
+    if (!workers) {
+        fprintf(stderr, "tnt_loadgen: out of memory\n");
+        return 1;
+    }
+    if (ssh_init() != SSH_OK) {
+        fprintf(stderr, "tnt_loadgen: ssh_init failed\n");
+        free(workers);
+        return 1;
+    }
+
+    start = now_ns();
+    for (int t = 0; t < g_threads; t++) {
+        workers[t].id = t;
+        if (pthread_create(&workers[t].thread, NULL, churn_main,
+                           &workers[t]) != 0) {
+            fprintf(stderr, "tnt_loadgen: cannot start worker thread\n");
+            return 1;
+        }
+    }
+    for (int t = 0; t < g_threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        hist_merge(&connect_us, &workers[t].connect_us);
+    }
+    seconds = (double)(now_ns() - start) / 1e9;
+    failed = atomic_load(&g_failed);
+
+    printf("churned=%d failed=%d seconds=%.2f rate=%.1f/s\n",
+           atomic_load(&g_connected), failed, seconds,
+           seconds > 0 ? (double)g_churn / seconds : 0.0);
+    printf("session_ms p50=%.1f p99=%.1f max=%.1f\n",
+           hist_quantile_ms(&connect_us, 0.50),
+           hist_quantile_ms(&connect_us, 0.99),
+           (double)connect_us.max_us / 1000.0);
+
+    ssh_finalize();
+    free(workers);
+    return failed == 0 ? 0 : 1;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-H host] [-p port] [-c clients] [-d seconds]\n"
+            "       [-r posts_per_second] [-t threads] [-s server_pid]\n"
+            "       [-C sessions]\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    loadgen_worker_t *workers;
+    loadgen_hist_t connect_us = {0};
+    loadgen_hist_t delivery_us = {0};
+    server_sample_t first_sample = {0};
+    server_sample_t last_sample = {0};
+    long clk_tck = sysconf(_SC_CLK_TCK);
+    long rss_max = 0;
+    bool sampling = false;
+    uint64_t connect_start;
+    double connect_seconds;
+    uint64_t run_start;
+    uint64_t deliveries = 0;
+    uint64_t posted = 0;
+    uint64_t bytes_min = UINT64_MAX;
+    uint64_t bytes_max = 0;
+    uint64_t bytes_total = 0;
+    int connected;
+    int opt;
+    long value;
+
+    while ((opt = getopt(argc, argv, "H:p:c:d:r:t:s:C:h")) != -1) {
+        switch (opt) {
+            case 'H':
+                g_host = optarg;
+                break;
+            case 'p':
+                if (parse_positive(optarg, 65535, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_port = (unsigned int)value;
+                break;
+            case 'c':
+                if (parse_positive(optarg, 100000, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_clients = (int)value;
+                break;
+            case 'd':
+                if (parse_positive(optarg, 86400, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_duration = (int)value;
+                break;
+            case 'r':
+                g_rate = atof(optarg);
+                if (g_rate < 0 || g_rate > 100000) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 't':
+                if (parse_positive(optarg, 1024, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_threads = (int)value;
+                break;
+            case 's':
+                if (parse_positive(optarg, 1L << 30, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_server_pid = value;
+                break;
+            case 'C':
+                if (parse_positive(optarg, 10000000, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_churn = (int)value;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (g_churn > 0) {
+        return churn_run();
+    }
+    if (g_threads > g_clients) {
+        g_threads = g_clients;
+    }
+
+    g_marker_capacity = (uint32_t)(g_rate * g_duration * 2) + 1024;
+    g_client_table = calloc((size_t)g_clients, sizeof(*g_client_table));
+    g_markers = calloc(g_marker_capacity, sizeof(*g_markers));
+    workers = calloc((size_t)g_threads, sizeof(*workers));
+    if (!g_client_table || !g_markers || !workers) {
+        fprintf(stderr, "tnt_loadgen: out of memory\n");
+        return 1;
+    }
+    if (ssh_init() != SSH_OK) {
+        fprintf(stderr, "tnt_loadgen: ssh_init failed\n");
+        return 1;
+    }
+
+    printf("clients=%d threads=%d rate=%.1f/s duration=%ds target=%s:%u\n",
+           g_clients, g_threads, g_rate, g_duration, g_host, g_port);
+    fflush(stdout);
+
+    pthread_barrier_init(&g_ready_barrier, NULL, (unsigned int)g_threads + 1);
+    connect_start = now_ns();
+    for (int t = 0; t < g_threads; t++) {
+        int base = g_clients / g_threads;
+        int extra = g_clients % g_threads;
+
+        workers[t].id = t;
+        workers[t].first = t * base + (t < extra ? t : extra);
+        workers[t].count = base + (t < extra ? 1 : 0);
+        for (int i = 0; i < workers[t].count; i++) {
+            g_client_table[workers[t].first + i].index =
+                workers[t].first + i;
+        }
+        if (pthread_create(&workers[t].thread, NULL, worker_main,
+                           &workers[t]) != 0) {
+            fprintf(stderr, "tnt_loadgen: cannot start worker thread\n");
+            return 1;
+        }
+    }
+    pthread_barrier_wait(&g_ready_barrier);
+    connect_seconds = (double)(now_ns() - connect_start) / 1e9;
+    connected = atomic_load(&g_connected);
+    printf("connected=%d failed=%d connect_seconds=%.2f "
+           "connect_rate=%.1f/s\n",
+           connected, atomic_load(&g_failed), connect_seconds,
+           connect_seconds > 0 ? connected / connect_seconds : 0.0);
+    fflush(stdout);
+
+    if (g_server_pid > 0 &&
+        read_server_sample(g_server_pid, &first_sample) == 0) {
+        sampling = true;
+        last_sample = first_sample;
+        rss_max = first_sample.rss_kb;
+    }
+
+    atomic_store(&g_posting, true);
+    run_start = now_ns();
+    for (int second = 1; second <= g_duration; second++) {
+        server_sample_t sample;
+
+        while (now_ns() < run_start + (uint64_t)second * 1000000000u) {
+            sleep_ms(20);
+        }
+        if (sampling && read_server_sample(g_server_pid, &sample) == 0) {
+            double cpu_pct = (double)(sample.cpu_ticks -
+                                      last_sample.cpu_ticks) * 100.0 /
+                             (double)clk_tck;
+
+            printf("t=%ds posted=%u server_rss_kb=%ld server_cpu_pct=%.1f\n",
+                   second, atomic_load(&g_next_marker), sample.rss_kb,
+                   cpu_pct);
+            if (sample.rss_kb > rss_max) {
+                rss_max = sample.rss_kb;
+            }
+            last_sample = sample;
+        } else {
+            printf("t=%ds posted=%u\n", second, atomic_load(&g_next_marker));
+        }
+        fflush(stdout);
+    }
+    atomic_store(&g_posting, false);
+    sleep_ms(LOADGEN_DRAIN_MS);
+    atomic_store(&g_stop, true);
+
+    for (int t = 0; t < g_threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        hist_merge(&connect_us, &workers[t].connect_us);
+        hist_merge(&delivery_us, &workers[t].delivery_us);
+        deliveries += workers[t].deliveries;
+        posted += workers[t].posted;
+    }
+    for (int i = 0; i < g_clients; i++) {
+        uint64_t bytes = g_client_table[i].bytes_received;
+
+        if (!g_client_table[i].ready) {
+            continue;
+        }
+        bytes_total += bytes;
+        if (bytes < bytes_min) {
+            bytes_min = bytes;
+        }
+        if (bytes > bytes_max) {
+            bytes_max = bytes;
+        }
+    }
+
+    printf("connect_ms p50=%.1f p99=%.1f max=%.1f\n",
+           hist_quantile_ms(&connect_us, 0.50),
+           hist_quantile_ms(&connect_us, 0.99),
+           (double)connect_us.max_us / 1000.0);
+    printf("posted=%llu deliveries=%llu expected=%llu\n",
+           (unsigned long long)posted, (unsigned long long)deliveries,
+           (unsigned long long)(connected > 1
+                                ? posted * (uint64_t)(connected - 1) : 0));
+    printf("delivery_ms p50=%.1f p90=%.1f p99=%.1f max=%.1f\n",
+           hist_quantile_ms(&delivery_us, 0.50),
+           hist_quantile_ms(&delivery_us, 0.90),
+           hist_quantile_ms(&delivery_us, 0.99),
+           (double)delivery_us.max_us / 1000.0);
+    printf("bytes_received_per_client avg=%llu min=%llu max=%llu\n",
+           (unsigned long long)(connected > 0 ? bytes_total /
+                                                (uint64_t)connected : 0),
+           (unsigned long long)(connected > 0 ? bytes_min : 0),
+           (unsigned long long)bytes_max);
+    if (sampling) {
+        printf("server rss_kb_max=%ld cpu_pct_avg=%.1f\n", rss_max,
+               (double)(last_sample.cpu_ticks - first_sample.cpu_ticks) *
+                   100.0 / (double)clk_tck / g_duration);
+    }
+
+    pthread_barrier_destroy(&g_ready_barrier);
+    ssh_finalize();
+    free(workers);
+    free(g_markers);
+    free(g_client_table);
+    return connected == g_clients ? 0 : 1;
+}
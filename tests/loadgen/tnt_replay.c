@@ -0,0 +1,662 @@
+/* Replays a session capture against a server.
+ * Usage: ./tnt_replay [-H host] [-p port] [-x speed] [-t threads]
+ *                     [-s server_pid] FILE
+ *
+ * FILE is a capture written by a server run with TNT_CAPTURE=1.  Every
+ * captured session is opened as an interactive PTY session of the
+ * captured size when it opened, and its input bytes and window changes
+ * are sent at their captured offsets divided by `speed` (1 = real time,
+ * 0 = as fast as possible).  The display name is part of the captured
+ * input, so the prompt is not answered separately.  Response latency is
+ * the time from an input write to the first output that follows it on
+ * the same session.  With -s, the server's RSS and CPU use are sampled
+ * from /proc once a second. */
+
+#include "../../include/capture.h"
+#include "loadgen_util.h"
+#include <libssh/libssh.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define REPLAY_DRAIN_MS 2000
+#define REPLAY_READ_CHUNK 16384
+/* Capture ids are dense; anything far beyond this is a corrupt file. */
+#define REPLAY_MAX_SESSIONS (1u << 24)
+
+typedef struct {
+    uint64_t at_ms;                  /* Since capture start */
+    size_t seq;                      /* File order, to keep sorting stable */
+    uint32_t session;
+    capture_record_type_t type;
+    int width;
+    int height;
+    size_t offset;                   /* Into g_input */
+    size_t len;
+} replay_event_t;
+
+typedef struct {
+    ssh_session session;
+    ssh_channel channel;
+    uint32_t id;
+    bool seen;                       /* OPEN record read */
+    bool open;
+    uint64_t last_ms;                /* Reconstructed time while loading */
+    uint64_t pending_ns;             /* Unanswered input write, or 0 */
+    uint64_t bytes_received;
+} replay_session_t;
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    replay_event_t *events;
+    size_t count;
+    replay_session_t **sessions;
+    size_t session_count;
+    loadgen_hist_t response_us;
+    uint64_t lag_max_us;
+    uint64_t opened;
+    uint64_t failed;
+    uint64_t inputs;
+    uint64_t input_bytes;
+    uint64_t resizes;
+    uint64_t unanswered;
+} replay_worker_t;
+
+static const char *g_host = "127.0.0.1";
+static unsigned int g_port = 2222;
+static double g_speed = 1.0;
+static int g_threads = 4;
+static long g_server_pid;
+
+static replay_event_t *g_events;
+static size_t g_event_count;
+static unsigned char *g_input;
+static size_t g_input_len;
+static replay_session_t *g_sessions;
+static uint32_t g_session_slots;
+static uint64_t g_span_ms;
+static uint64_t g_start_ns;
+static atomic_size_t g_done_events;
+static atomic_int g_finished;
+
+static int grow(void **array, size_t *capacity, size_t need, size_t size) {
+    size_t next = *capacity ? *capacity : 1024;
+    void *grown;
+
+    if (need <= *capacity) {
+        return 0;
+    }
+    while (next < need) {
+        next *= 2;
+    }
+    grown = realloc(*array, next * size);
+    if (!grown) {
+        return -1;
+    }
+    memset((char *)grown + *capacity * size, 0, (next - *capacity) * size);
+    *array = grown;
+    *capacity = next;
+    return 0;
+}
+
+/* Read every record, turning per-session deltas into absolute times. */
+static int load_capture(const char *path) {
+    capture_reader_t *reader = malloc(sizeof(*reader));
+    capture_record_t rec;
+    size_t event_cap = 0;
+    size_t input_cap = 0;
+    size_t session_cap = 0;
+    size_t orphans = 0;
+    FILE *fp = fopen(path, "rb");
+    int rc;
+
+    if (!reader || !fp) {
+        fprintf(stderr, "tnt_replay: cannot open %s\n", path);
+        free(reader);
+        if (fp) {
+            fclose(fp);
+        }
+        return -1;
+    }
+    if (capture_reader_open(reader, fp) < 0) {
+        fprintf(stderr, "tnt_replay: %s is not a capture file\n", path);
+        free(reader);
+        fclose(fp);
+        return -1;
+    }
+
+    while ((rc = capture_reader_next(reader, &rec)) == 1) {
+        replay_session_t *session;
+        replay_event_t *event;
+
+        if (rec.session == 0 || rec.session >= REPLAY_MAX_SESSIONS ||
+            grow((void **)&g_sessions, &session_cap, rec.session + 1,
+                 sizeof(*g_sessions)) < 0) {
+            rc = -1;
+            break;
+        }
+        session = &g_sessions[rec.session];
+        if (rec.type == CAPTURE_REC_OPEN) {
+            session->id = rec.session;
+            session->seen = true;
+            session->last_ms = rec.delta_ms;
+        } else if (!session->seen) {
+            orphans++;
+            continue;
+        } else {
+            session->last_ms += rec.delta_ms;
+        }
+        if (session->last_ms > g_span_ms) {
+            g_span_ms = session->last_ms;
+        }
+
+        if (grow((void **)&g_events, &event_cap, g_event_count + 1,
+                 sizeof(*g_events)) < 0 ||
+            grow((void **)&g_input, &input_cap, g_input_len + rec.len + 1,
+                 1) < 0) {
+            rc = -1;
+            break;
+        }
+        event = &g_events[g_event_count];
+        event->at_ms = session->last_ms;
+        event->seq = g_event_count;
+        event->session = rec.session;
+        event->type = rec.type;
+        event->width = rec.width;
+        event->height = rec.height;
+        event->offset = g_input_len;
+        event->len = rec.len;
+        if (rec.len > 0) {
+            memcpy(g_input + g_input_len, rec.data, rec.len);
+            g_input_len += rec.len;
+        }
+        g_event_count++;
+    }
+    free(reader);
+    fclose(fp);
+    g_session_slots = (uint32_t)session_cap;
+
+    if (rc < 0) {
+        /* A capture cut off by the size limit may end mid-record. */
+        fprintf(stderr, "tnt_replay: %s: corrupt or truncated record after "
+                "%zu events; replaying those\n", path, g_event_count);
+    }
+    if (orphans > 0) {
+        fprintf(stderr, "tnt_replay: skipped %zu records of unknown "
+                "sessions\n", orphans);
+    }
+    return g_event_count > 0 ? 0 : -1;
+}
+
+static int event_cmp(const void *a, const void *b) {
+    const replay_event_t *x = a;
+    const replay_event_t *y = b;
+
+    if (x->at_ms != y->at_ms) {
+        return x->at_ms < y->at_ms ? -1 : 1;
+    }
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static void session_close(replay_session_t *session) {
+    if (session->channel) {
+        ssh_channel_send_eof(session->channel);
+        ssh_channel_close(session->channel);
+        ssh_channel_free(session->channel);
+        session->channel = NULL;
+    }
+    if (session->session) {
+        ssh_disconnect(session->session);
+        ssh_free(session->session);
+        session->session = NULL;
+    }
+    session->open = false;
+}
+
+static int session_connect(replay_session_t *session, int width,
+                           int height) {
+    char user[32];
+    long timeout_s = 10;
+    int verbosity = SSH_LOG_NOLOG;
+    int rc;
+
+    snprintf(user, sizeof(user), "replay%u", session->id);
+    session->session = ssh_new();
+    if (!session->session) {
+        return -1;
+    }
+    ssh_options_set(session->session, SSH_OPTIONS_HOST, g_host);
+    ssh_options_set(session->session, SSH_OPTIONS_PORT, &g_port);
+    ssh_options_set(session->session, SSH_OPTIONS_USER, user);
+    ssh_options_set(session->session, SSH_OPTIONS_TIMEOUT, &timeout_s);
+    ssh_options_set(session->session, SSH_OPTIONS_LOG_VERBOSITY, &verbosity);
+
+    if (ssh_connect(session->session) != SSH_OK) {
+        fprintf(stderr, "tnt_replay: %s: connect: %s\n", user,
+                ssh_get_error(session->session));
+        return -1;
+    }
+    rc = ssh_userauth_none(session->session, NULL);
+    if (rc != SSH_AUTH_SUCCESS) {
+        rc = ssh_userauth_password(session->session, NULL, "");
+    }
+    if (rc != SSH_AUTH_SUCCESS) {
+        fprintf(stderr, "tnt_replay: %s: authentication refused\n", user);
+        return -1;
+    }
+
+    session->channel = ssh_channel_new(session->session);
+    if (!session->channel ||
+        ssh_channel_open_session(session->channel) != SSH_OK ||
+        ssh_channel_request_pty_size(session->channel, "xterm-256color",
+                                     width, height) != SSH_OK ||
+        ssh_channel_request_shell(session->channel) != SSH_OK) {
+        fprintf(stderr, "tnt_replay: %s: shell: %s\n", user,
+                ssh_get_error(session->session));
+        return -1;
+    }
+    session->open = true;
+    return 0;
+}
+
+static void run_event(replay_worker_t *worker, const replay_event_t *event) {
+    replay_session_t *session = &g_sessions[event->session];
+
+    switch (event->type) {
+        case CAPTURE_REC_OPEN:
+            if (session_connect(session, event->width, event->height) == 0) {
+                worker->opened++;
+            } else {
+                session_close(session);
+                worker->failed++;
+            }
+            break;
+        case CAPTURE_REC_INPUT:
+            if (!session->open) {
+                break;
+            }
+            if (session->pending_ns != 0) {
+                worker->unanswered++;
+            }
+            session->pending_ns = now_ns();
+            if (ssh_channel_write(session->channel, g_input + event->offset,
+                                  (uint32_t)event->len) < 0) {
+                session_close(session);
+                break;
+            }
+            worker->inputs++;
+            worker->input_bytes += event->len;
+            break;
+        case CAPTURE_REC_RESIZE:
+            if (session->open &&
+                ssh_channel_change_pty_size(session->channel, event->width,
+                                            event->height) == SSH_OK) {
+                worker->resizes++;
+            }
+            break;
+        case CAPTURE_REC_CLOSE:
+            if (session->pending_ns != 0) {
+                worker->unanswered++;
+                session->pending_ns = 0;
+            }
+            session_close(session);
+            break;
+    }
+}
+
+/* Read whatever output is ready; wait up to `wait_ms` if there was none. */
+static void pump_output(replay_worker_t *worker, struct pollfd *fds,
+                        char *chunk, int wait_ms) {
+    bool any = false;
+    int nfds = 0;
+
+    for (size_t i = 0; i < worker->session_count; i++) {
+        replay_session_t *session = worker->sessions[i];
+        int n;
+
+        if (!session->open) {
+            continue;
+        }
+        while ((n = ssh_channel_read_nonblocking(session->channel, chunk,
+                                                 REPLAY_READ_CHUNK, 0)) > 0) {
+            session->bytes_received += (uint64_t)n;
+            if (session->pending_ns != 0) {
+                hist_add(&worker->response_us,
+                         (now_ns() - session->pending_ns) / 1000u);
+                session->pending_ns = 0;
+            }
+            any = true;
+        }
+        if (n == SSH_ERROR || ssh_channel_is_eof(session->channel)) {
+            session_close(session);
+            continue;
+        }
+        fds[nfds].fd = ssh_get_fd(session->session);
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+
+    if (!any && wait_ms > 0) {
+        if (nfds > 0) {
+            poll(fds, (nfds_t)nfds, wait_ms);
+        } else {
+            sleep_ms(wait_ms);
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    replay_worker_t *worker = arg;
+    struct pollfd *fds = calloc(worker->session_count + 1, sizeof(*fds));
+    char *chunk = malloc(REPLAY_READ_CHUNK);
+    uint64_t drain_until;
+    size_t next = 0;
+
+    if (!fds || !chunk) {
+        fprintf(stderr, "tnt_replay: out of memory\n");
+        free(chunk);
+        free(fds);
+        atomic_fetch_add(&g_finished, 1);
+        return NULL;
+    }
+
+    while (next < worker->count) {
+        const replay_event_t *event = &worker->events[next];
+        uint64_t due = g_speed > 0
+                       ? g_start_ns + (uint64_t)((double)event->at_ms *
+                                                 1e6 / g_speed)
+                       : 0;
+        uint64_t now = now_ns();
+
+        if (now >= due) {
+            if (due > 0 && (now - due) / 1000u > worker->lag_max_us) {
+                worker->lag_max_us = (now - due) / 1000u;
+            }
+            run_event(worker, event);
+            next++;
+            atomic_fetch_add(&g_done_events, 1);
+            pump_output(worker, fds, chunk, 0);
+            continue;
+        }
+        pump_output(worker, fds, chunk,
+                    (due - now) / 1000000u < 10
+                        ? (int)((due - now) / 1000000u) : 10);
+    }
+
+    drain_until = now_ns() + (uint64_t)REPLAY_DRAIN_MS * 1000000u;
+    while (now_ns() < drain_until) {
+        pump_output(worker, fds, chunk, 10);
+    }
+    for (size_t i = 0; i < worker->session_count; i++) {
+        session_close(worker->sessions[i]);
+    }
+    free(chunk);
+    free(fds);
+    atomic_fetch_add(&g_finished, 1);
+    return NULL;
+}
+
+/* Sessions go to workers by id; each worker keeps its events in time
+ * order. */
+static int assign_workers(replay_worker_t *workers) {
+    size_t *events = calloc((size_t)g_threads, sizeof(*events));
+    size_t *sessions = calloc((size_t)g_threads, sizeof(*sessions));
+
+    if (!events || !sessions) {
+        free(events);
+        free(sessions);
+        return -1;
+    }
+    for (size_t i = 0; i < g_event_count; i++) {
+        events[g_events[i].session % (uint32_t)g_threads]++;
+    }
+    for (uint32_t id = 1; id < g_session_slots; id++) {
+        if (g_sessions[id].seen) {
+            sessions[id % (uint32_t)g_threads]++;
+        }
+    }
+    for (int t = 0; t < g_threads; t++) {
+        workers[t].id = t;
+        workers[t].events = calloc(events[t] + 1, sizeof(replay_event_t));
+        workers[t].sessions = calloc(sessions[t] + 1,
+                                     sizeof(replay_session_t *));
+        if (!workers[t].events || !workers[t].sessions) {
+            free(events);
+            free(sessions);
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < g_event_count; i++) {
+        replay_worker_t *worker =
+            &workers[g_events[i].session % (uint32_t)g_threads];
+
+        worker->events[worker->count++] = g_events[i];
+    }
+    for (uint32_t id = 1; id < g_session_slots; id++) {
+        if (g_sessions[id].seen) {
+            replay_worker_t *worker = &workers[id % (uint32_t)g_threads];
+
+            worker->sessions[worker->session_count++] = &g_sessions[id];
+        }
+    }
+    free(events);
+    free(sessions);
+    return 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-H host] [-p port] [-x speed] [-t threads]\n"
+            "       [-s server_pid] FILE\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    replay_worker_t *workers;
+    loadgen_hist_t response_us = {0};
+    server_sample_t first_sample = {0};
+    server_sample_t last_sample = {0};
+    long clk_tck = sysconf(_SC_CLK_TCK);
+    long rss_max = 0;
+    bool sampling = false;
+    double wall_seconds;
+    uint64_t lag_max_us = 0;
+    uint64_t opened = 0;
+    uint64_t failed = 0;
+    uint64_t inputs = 0;
+    uint64_t input_bytes = 0;
+    uint64_t resizes = 0;
+    uint64_t unanswered = 0;
+    uint64_t bytes_total = 0;
+    uint32_t session_total = 0;
+    int opt;
+    long value;
+
+    while ((opt = getopt(argc, argv, "H:p:x:t:s:h")) != -1) {
+        switch (opt) {
+            case 'H':
+                g_host = optarg;
+                break;
+            case 'p':
+                if (parse_positive(optarg, 65535, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_port = (unsigned int)value;
+                break;
+            case 'x':
+                g_speed = atof(optarg);
+                if (g_speed < 0 || g_speed > 100000) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 't':
+                if (parse_positive(optarg, 1024, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_threads = (int)value;
+                break;
+            case 's':
+                if (parse_positive(optarg, 1L << 30, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_server_pid = value;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (load_capture(argv[optind]) < 0) {
+        return 1;
+    }
+    qsort(g_events, g_event_count, sizeof(*g_events), event_cmp);
+    for (uint32_t id = 1; id < g_session_slots; id++) {
+        session_total += g_sessions[id].seen ? 1 : 0;
+    }
+    if ((uint32_t)g_threads > session_total) {
+        g_threads = (int)session_total;
+    }
+
+    workers = calloc((size_t)g_threads, sizeof(*workers));
+    if (!workers || assign_workers(workers) < 0) {
+        fprintf(stderr, "tnt_replay: out of memory\n");
+        return 1;
+    }
+    if (ssh_init() != SSH_OK) {
+        fprintf(stderr, "tnt_replay: ssh_init failed\n");
+        return 1;
+    }
+
+    printf("sessions=%u events=%zu input_bytes=%zu span_seconds=%.1f "
+           "speed=%.2f threads=%d target=%s:%u\n",
+           session_total, g_event_count, g_input_len,
+           (double)g_span_ms / 1000.0, g_speed, g_threads, g_host, g_port);
+    fflush(stdout);
+
+    if (g_server_pid > 0 &&
+        read_server_sample(g_server_pid, &first_sample) == 0) {
+        sampling = true;
+        last_sample = first_sample;
+        rss_max = first_sample.rss_kb;
+    }
+
+    g_start_ns = now_ns();
+    for (int t = 0; t < g_threads; t++) {
+        if (pthread_create(&workers[t].thread, NULL, worker_main,
+                           &workers[t]) != 0) {
+            fprintf(stderr, "tnt_replay: cannot start worker thread\n");
+            return 1;
+        }
+    }
+
+    for (int second = 1;; second++) {
+        server_sample_t sample;
+
+        while (atomic_load(&g_finished) < g_threads &&
+               now_ns() < g_start_ns + (uint64_t)second * 1000000000u) {
+            sleep_ms(20);
+        }
+        if (atomic_load(&g_finished) == g_threads) {
+            break;
+        }
+        if (sampling && read_server_sample(g_server_pid, &sample) == 0) {
+            double cpu_pct = (double)(sample.cpu_ticks -
+                                      last_sample.cpu_ticks) * 100.0 /
+                             (double)clk_tck;
+
+            printf("t=%ds events=%zu server_rss_kb=%ld "
+                   "server_cpu_pct=%.1f\n",
+                   second, atomic_load(&g_done_events), sample.rss_kb,
+                   cpu_pct);
+            if (sample.rss_kb > rss_max) {
+                rss_max = sample.rss_kb;
+            }
+            last_sample = sample;
+        } else {
+            printf("t=%ds events=%zu\n", second,
+                   atomic_load(&g_done_events));
+        }
+        fflush(stdout);
+    }
+    wall_seconds = (double)(now_ns() - g_start_ns) / 1e9;
+    if (sampling) {
+        server_sample_t sample;
+
+        if (read_server_sample(g_server_pid, &sample) == 0) {
+            if (sample.rss_kb > rss_max) {
+                rss_max = sample.rss_kb;
+            }
+            last_sample = sample;
+        }
+    }
+
+    for (int t = 0; t < g_threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        hist_merge(&response_us, &workers[t].response_us);
+        if (workers[t].lag_max_us > lag_max_us) {
+            lag_max_us = workers[t].lag_max_us;
+        }
+        opened += workers[t].opened;
+        failed += workers[t].failed;
+        inputs += workers[t].inputs;
+        input_bytes += workers[t].input_bytes;
+        resizes += workers[t].resizes;
+        unanswered += workers[t].unanswered;
+    }
+    for (uint32_t id = 1; id < g_session_slots; id++) {
+        bytes_total += g_sessions[id].bytes_received;
+    }
+
+    printf("opened=%llu failed=%llu inputs=%llu input_bytes=%llu "
+           "resizes=%llu wall_seconds=%.2f\n",
+           (unsigned long long)opened, (unsigned long long)failed,
+           (unsigned long long)inputs, (unsigned long long)input_bytes,
+           (unsigned long long)resizes, wall_seconds);
+    printf("schedule_lag_ms max=%.1f\n", (double)lag_max_us / 1000.0);
+    printf("response_ms p50=%.1f p90=%.1f p99=%.1f max=%.1f "
+           "responses=%llu unanswered=%llu\n",
+           hist_quantile_ms(&response_us, 0.50),
+           hist_quantile_ms(&response_us, 0.90),
+           hist_quantile_ms(&response_us, 0.99),
+           (double)response_us.max_us / 1000.0,
+           (unsigned long long)response_us.total,
+           (unsigned long long)unanswered);
+    printf("bytes_received total=%llu per_session=%llu\n",
+           (unsigned long long)bytes_total,
+           (unsigned long long)(opened > 0 ? bytes_total / opened : 0));
+    if (sampling) {
+        double cpu_seconds = (double)(last_sample.cpu_ticks -
+                                      first_sample.cpu_ticks) /
+                             (double)clk_tck;
+
+        printf("server rss_kb_max=%ld cpu_seconds=%.2f cpu_pct_avg=%.1f\n",
+               rss_max, cpu_seconds,
+               wall_seconds > 0 ? cpu_seconds * 100.0 / wall_seconds : 0.0);
+    }
+
+    ssh_finalize();
+    for (int t = 0; t < g_threads; t++) {
+        free(workers[t].events);
+        free(workers[t].sessions);
+    }
+    free(workers);
+    free(g_sessions);
+    free(g_input);
+    free(g_events);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+/* Allocation budget for the steady-state hot paths.
+ *
+ * Built with -DTNT_ALLOC_COUNT (`make alloc-test`), so alloc_count.c counts
+ * every malloc, calloc and realloc the calling thread makes.  Each test
+ * warms a path up once, which may size per-client buffers, and then checks
+ * that repeating it makes no heap allocation at all: full-screen render in
+ * each view, input-line render, broadcast, mention delivery and outbox
+ * flush.  Sessions use in-memory channels, so no sockets are involved. */
+
+#include "alloc_count.h"
+#include "chat_room.h"
+#include "channel_fake.h"
+#include "client.h"
+#include "input.h"
+#include "message.h"
+#include "post_limit.h"
+#include "ratelimit.h"
+#include "system_message.h"
+#include "theme.h"
+#include "tui.h"
+#include <assert.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+#define BUDGET_COLS 100
+#define BUDGET_ROWS 40
+#define BUDGET_REPEAT 20
+
+static int tests_passed = 0;
+
+typedef struct {
+    client_t *client;
+    tnt_fake_channel_t fake;
+} budget_session_t;
+
+static budget_session_t g_alice;
+static budget_session_t g_bob;
+
+static uint64_t allocs_now(void) {
+    tnt_alloc_counts_t counts;
+
+    tnt_alloc_count_get(&counts);
+    return counts.allocs;
+}
+
+/* Mirror the client setup bootstrap.c and input_run_session() do for an
+ * interactive session that has joined the room. */
+static void session_start(budget_session_t *session, const char *name,
+                          uint32_t window) {
+    client_t *client;
+
+    assert(tnt_fake_channel_init(&session->fake, window, 0) == 0);
+    client = client_new();
+    assert(client);
+    client->width = BUDGET_COLS;
+    client->height = BUDGET_ROWS;
+    client->ref_count = 1;
+    client->theme_index = (int)theme_default_index();
+    client->mode = MODE_INSERT;
+    client->follow_tail = true;
+    client->ui_lang = UI_LANG_EN;
+    client->connected = true;
+    pthread_mutex_init(&client->ref_lock, NULL);
+    pthread_mutex_init(&client->io_lock, NULL);
+    pthread_mutex_init(&client->whisper_lock, NULL);
+    snprintf(client->username, sizeof(client->username), "%s", name);
+    snprintf(client->client_ip, sizeof(client->client_ip), "10.0.0.1");
+    tnt_channel_use_fake(&client->io, &session->fake);
+    assert(room_add_client(g_room, client) == 0);
+    session->client = client;
+}
+
+static void post(const char *user, const char *content) {
+    message_t msg = { .timestamp = time(NULL) };
+
+    snprintf(msg.username, sizeof(msg.username), "%s", user);
+    snprintf(msg.content, sizeof(msg.content), "%s", content);
+    room_broadcast(g_room, &msg);
+}
+
+/* Keep the fake channel's window open, as a reading client would. */
+static void drain(budget_session_t *session) {
+    tnt_fake_channel_ack(&session->fake, UINT32_MAX);
+}
+
+TEST(render_screen_latest) {
+    client_t *client = g_alice.client;
+    uint64_t before;
+
+    tui_render_screen(client);
+    drain(&g_alice);
+
+    before = allocs_now();
+    for (int i = 0; i < BUDGET_REPEAT; i++) {
+        post("bob", "steady state message with a bit of text in it");
+        tui_render_screen(client);
+        drain(&g_alice);
+    }
+    assert(allocs_now() == before);
+}
+
+TEST(render_screen_scrolled_and_muted) {
+    client_t *client = g_alice.client;
+    message_t join;
+    uint64_t before;
+
+    system_message_make_join(&join, "carol", UI_LANG_EN);
+    room_broadcast(g_room, &join);
+    client->mode = MODE_NORMAL;
+    client->follow_tail = false;
+    client->scroll_pos = 3;
+    client->mute_joins = true;
+    tui_render_screen(client);
+    drain(&g_alice);
+
+    before = allocs_now();
+    for (int i = 0; i < BUDGET_REPEAT; i++) {
+        room_broadcast(g_room, &join);
+        client->scroll_pos = i % 5;
+        tui_render_screen(client);
+        client->follow_tail = true;
+        tui_render_screen(client);
+        client->follow_tail = false;
+        drain(&g_alice);
+    }
+    assert(allocs_now() == before);
+
+    client->mode = MODE_INSERT;
+    client->follow_tail = true;
+    client->mute_joins = false;
+}
+
+TEST(render_input_line) {
+    client_t *client = g_alice.client;
+    char input[64] = "";
+    uint64_t before;
+
+    tui_render_screen(client);
+    tui_render_input(client, "warm");
+    drain(&g_alice);
+
+    before = allocs_now();
+    for (int i = 0; i < BUDGET_REPEAT; i++) {
+        size_t len = strlen(input);
+
+        input[len] = (char)('a' + i % 26);
+        input[len + 1] = '\0';
+        tui_render_input(client, input);
+        drain(&g_alice);
+    }
+    assert(allocs_now() == before);
+}
+
+TEST(broadcast_and_mentions) {
+    int unread = g_bob.client->unread_mentions;
+    uint64_t before = allocs_now();
+
+    for (int i = 0; i < BUDGET_REPEAT; i++) {
+        post("alice", "hey @bob, look at this");
+        notify_mentions("hey @bob, look at this", g_alice.client);
+    }
+    assert(allocs_now() == before);
+    assert(g_bob.client->unread_mentions == unread + BUDGET_REPEAT);
+    assert(g_alice.client->unread_mentions == 0);
+}
+
+TEST(flush_backlog) {
+    budget_session_t slow;
+    client_t *client;
+    uint64_t before;
+
+    /* A window smaller than one frame leaves most of it in the outbox. */
+    session_start(&slow, "slow", 512);
+    client = slow.client;
+    tui_render_screen(client);
+    while (client->outbox_len > client->outbox_pos) {
+        tnt_fake_channel_ack(&slow.fake, 512);
+        assert(client_flush_output(client) == 0);
+    }
+
+    before = allocs_now();
+    for (int i = 0; i < BUDGET_REPEAT; i++) {
+        post("bob", "another line for the slow reader");
+        tui_render_screen(client);
+        assert(client->outbox_len > client->outbox_pos);
+        while (client->outbox_len > client->outbox_pos) {
+            tnt_fake_channel_ack(&slow.fake, 512);
+            assert(client_flush_output(client) == 0);
+        }
+    }
+    assert(allocs_now() == before);
+
+    room_remove_client(g_room, client);
+}
+
+static void remove_state_dir(const char *path) {
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+    char file[PATH_MAX];
+
+    if (!dir) {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+int main(void) {
+    char state_dir[] = "/tmp/tnt-alloc-budget.XXXXXX";
+
+    printf("Running allocation budget tests...\n\n");
+    if (!tnt_alloc_count_enabled()) {
+        printf("skipped: allocation counting needs a glibc build with "
+               "-DTNT_ALLOC_COUNT\n");
+        return 0;
+    }
+
+    assert(mkdtemp(state_dir));
+    setenv("TNT_STATE_DIR", state_dir, 1);
+    setenv("TNT_POST_RATE", "0", 1);
+    setenv("TNT_POST_IP_RATE", "0", 1);
+    assert(tnt_ensure_state_dir() == 0);
+    message_init();
+    g_room = room_create();
+    assert(g_room);
+    ratelimit_init();
+    post_limit_init();
+    input_init();
+
+    session_start(&g_alice, "alice", UINT32_MAX);
+    session_start(&g_bob, "bob", UINT32_MAX);
+    for (int i = 0; i < MAX_MESSAGES; i++) {
+        post(i % 2 ? "alice" : "bob", "history to fill the room");
+    }
+
+    RUN_TEST(render_screen_latest);
+    RUN_TEST(render_screen_scrolled_and_muted);
+    RUN_TEST(render_input_line);
+    RUN_TEST(broadcast_and_mentions);
+    RUN_TEST(flush_backlog);
+
+    remove_state_dir(state_dir);
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,483 @@
+/* In-process session simulator.
+ * Usage: ./tnt_sim [-c sessions] [-d virtual_seconds] [-r posts_per_second]
+ *                  [-s slow_sessions] [-b slow_ack_bytes] [-w window_bytes]
+ *
+ * Runs `sessions` copies of input_run_session() over in-memory channels
+ * (channel_fake.h) against a real room, message log and timer wheel, with
+ * no sockets and no libssh traffic.  Time is virtual: each tick advances
+ * the timer service by one wheel tick, feeds the scripted input, acks
+ * every channel's window and then lets each session run once, in order,
+ * until it is idle again.  Runs are therefore repeatable, and their cost
+ * is the wall time sessions spend in their turns.
+ *
+ * Sessions join as simN and post in rotation at the given total rate.  The
+ * last `slow_sessions` only ack `slow_ack_bytes` of output per tick, so
+ * their outboxes back up the way a slow SSH link's would. */
+
+#include "chat_room.h"
+#include "client.h"
+#include "channel_fake.h"
+#include "config_defaults.h"
+#include "input.h"
+#include "message.h"
+#include "post_limit.h"
+#include "ratelimit.h"
+#include "theme.h"
+#include "timer_wheel.h"
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIM_COLS 100
+#define SIM_ROWS 40
+#define SIM_TICK_MS TNT_TIMER_DEFAULT_TICK_MS
+/* Virtual clock at the first tick. */
+#define SIM_CLOCK_START_MS 1000
+
+typedef struct {
+    int index;
+    pthread_t thread;
+    client_t *client;
+    tnt_fake_channel_t fake;
+    pthread_cond_t cond;
+    bool slow;
+    bool turn;                     /* The session may run; g_sched_lock */
+    bool done;                     /* input_run_session() returned */
+    uint64_t done_ms;              /* Virtual time it ended on its own */
+} sim_session_t;
+
+static int g_sessions = 200;
+static int g_seconds = 20;
+static double g_rate = 20.0;
+static int g_slow = 0;
+static long g_slow_ack = 256;
+static long g_window = 65536;
+
+static pthread_mutex_t g_sched_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_sched_cond = PTHREAD_COND_INITIALIZER;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Hand the turn back to the simulator and wait for the next one. */
+static void sim_yield(tnt_fake_channel_t *fake, void *arg) {
+    sim_session_t *session = arg;
+
+    (void)fake;
+    pthread_mutex_lock(&g_sched_lock);
+    session->turn = false;
+    pthread_cond_signal(&g_sched_cond);
+    while (!session->turn) {
+        pthread_cond_wait(&session->cond, &g_sched_lock);
+    }
+    pthread_mutex_unlock(&g_sched_lock);
+}
+
+static void *sim_session_main(void *arg) {
+    sim_session_t *session = arg;
+
+    pthread_mutex_lock(&g_sched_lock);
+    while (!session->turn) {
+        pthread_cond_wait(&session->cond, &g_sched_lock);
+    }
+    pthread_mutex_unlock(&g_sched_lock);
+
+    input_run_session(session->client);
+
+    pthread_mutex_lock(&g_sched_lock);
+    session->done = true;
+    session->turn = false;
+    pthread_cond_signal(&g_sched_cond);
+    pthread_mutex_unlock(&g_sched_lock);
+    return NULL;
+}
+
+/* Run one session until it yields.  Returns the wall time it took. */
+static uint64_t sim_run_turn(sim_session_t *session) {
+    uint64_t start = now_ns();
+
+    pthread_mutex_lock(&g_sched_lock);
+    if (session->done) {
+        pthread_mutex_unlock(&g_sched_lock);
+        return 0;
+    }
+    session->turn = true;
+    pthread_cond_signal(&session->cond);
+    while (session->turn) {
+        pthread_cond_wait(&g_sched_cond, &g_sched_lock);
+    }
+    pthread_mutex_unlock(&g_sched_lock);
+    return now_ns() - start;
+}
+
+/* Mirror the client setup bootstrap.c does for an interactive session. */
+static int sim_session_start(sim_session_t *session, pthread_attr_t *attr) {
+    client_t *client;
+    char name[32];
+    int len;
+
+    if (tnt_fake_channel_init(&session->fake, (uint32_t)g_window, 0) < 0) {
+        return -1;
+    }
+    pthread_cond_init(&session->cond, NULL);
+    tnt_fake_channel_set_yield(&session->fake, sim_yield, session);
+
+    client = client_new();
+    if (!client) {
+        return -1;
+    }
+    client->width = SIM_COLS;
+    client->height = SIM_ROWS;
+    client->ref_count = 1;
+    client->theme_index = (int)theme_default_index();
+    pthread_mutex_init(&client->ref_lock, NULL);
+    pthread_mutex_init(&client->io_lock, NULL);
+    pthread_mutex_init(&client->whisper_lock, NULL);
+    snprintf(client->client_ip, sizeof(client->client_ip), "10.%d.%d.%d",
+             (session->index >> 16) & 0xff, (session->index >> 8) & 0xff,
+             session->index & 0xff);
+    tnt_channel_use_fake(&client->io, &session->fake);
+    /* Keep the counters readable after the session ends. */
+    client_addref(client);
+    session->client = client;
+
+    len = snprintf(name, sizeof(name), "sim%d\r", session->index);
+    if (tnt_fake_channel_feed(&session->fake, name, (size_t)len) < 0) {
+        return -1;
+    }
+    if (pthread_create(&session->thread, attr, sim_session_main,
+                       session) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double quantile_us(const uint64_t *sorted, size_t count, double q) {
+    if (count == 0) {
+        return 0.0;
+    }
+    return (double)sorted[(size_t)(q * (double)(count - 1))] / 1000.0;
+}
+
+static void remove_state_dir(const char *path) {
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+    char file[PATH_MAX];
+
+    if (!dir) {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static int parse_number(const char *text, long min, long max, long *out) {
+    char *end = NULL;
+    long value = strtol(text, &end, 10);
+
+    if (!end || end == text || *end != '\0' || value < min || value > max) {
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-c sessions] [-d virtual_seconds] [-r posts_per_second]\n"
+            "       [-s slow_sessions] [-b slow_ack_bytes] [-w window_bytes]\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    sim_session_t *sessions;
+    uint64_t *turns;
+    size_t turn_count = 0;
+    size_t turn_capacity;
+    pthread_attr_t attr;
+    size_t stack_size;
+    char state_dir[] = "/tmp/tnt-sim.XXXXXX";
+    bool own_state_dir = false;
+    char value_text[32];
+    tnt_timer_wheel_t *wheel;
+    uint64_t clock_ms = SIM_CLOCK_START_MS;
+    uint64_t run_start;
+    uint64_t turn_total_ns = 0;
+    double post_credit = 0.0;
+    int ticks;
+    int next_poster = 0;
+    int in_room;
+    uint64_t drop_first_ms = UINT64_MAX;
+    uint64_t drop_last_ms = 0;
+    int posted = 0;
+    int dropped_fast = 0;
+    int dropped_slow = 0;
+    uint64_t bytes_total = 0;
+    uint64_t writes_total = 0;
+    uint64_t frames_total = 0;
+    uint64_t keepalives_total = 0;
+    uint64_t bytes_min = UINT64_MAX;
+    uint64_t bytes_max = 0;
+    int opt;
+    long value;
+
+    while ((opt = getopt(argc, argv, "c:d:r:s:b:w:h")) != -1) {
+        switch (opt) {
+            case 'c':
+                if (parse_number(optarg, 1, TNT_MAX_CONFIGURED_CLIENTS,
+                                 &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_sessions = (int)value;
+                break;
+            case 'd':
+                if (parse_number(optarg, 1, 86400, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_seconds = (int)value;
+                break;
+            case 'r':
+                g_rate = atof(optarg);
+                if (g_rate < 0 || g_rate > 100000) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 's':
+                if (parse_number(optarg, 0, TNT_MAX_CONFIGURED_CLIENTS,
+                                 &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_slow = (int)value;
+                break;
+            case 'b':
+                if (parse_number(optarg, 0, 1L << 30, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_slow_ack = value;
+                break;
+            case 'w':
+                if (parse_number(optarg, 1, 1L << 30, &value) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                g_window = value;
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (g_slow > g_sessions) {
+        g_slow = g_sessions;
+    }
+    ticks = (int)((uint64_t)g_seconds * 1000 / SIM_TICK_MS);
+
+    /* A private state directory, a room sized for every session and no
+     * posting limits unless the caller asked for them. */
+    if (!getenv("TNT_STATE_DIR")) {
+        if (!mkdtemp(state_dir)) {
+            perror("tnt_sim: mkdtemp");
+            return 1;
+        }
+        setenv("TNT_STATE_DIR", state_dir, 1);
+        own_state_dir = true;
+    }
+    snprintf(value_text, sizeof(value_text), "%d", g_sessions);
+    setenv("TNT_MAX_CONNECTIONS", value_text, 1);
+    setenv("TNT_POST_RATE", "0", 0);
+    setenv("TNT_POST_IP_RATE", "0", 0);
+
+    if (tnt_ensure_state_dir() < 0) {
+        fprintf(stderr, "tnt_sim: cannot create state directory %s\n",
+                tnt_state_dir());
+        return 1;
+    }
+    message_init();
+    g_room = room_create();
+    if (!g_room) {
+        fprintf(stderr, "tnt_sim: failed to create chat room\n");
+        return 1;
+    }
+    ratelimit_init();
+    post_limit_init();
+    input_init();
+    if (tnt_timer_service_start_manual(clock_ms) < 0) {
+        return 1;
+    }
+    wheel = tnt_timer_service();
+
+    sessions = calloc((size_t)g_sessions, sizeof(*sessions));
+    turn_capacity = (size_t)g_sessions * (size_t)(ticks + 2);
+    turns = malloc(turn_capacity * sizeof(*turns));
+    if (!sessions || !turns) {
+        fprintf(stderr, "tnt_sim: out of memory\n");
+        return 1;
+    }
+
+    stack_size = (size_t)tnt_config_env_int(&TNT_CONFIG_SESSION_STACK_KB) * 1024;
+    if (stack_size < (size_t)PTHREAD_STACK_MIN) {
+        stack_size = (size_t)PTHREAD_STACK_MIN;
+    }
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack_size);
+
+    printf("sessions=%d slow=%d rate=%.1f/s virtual_seconds=%d ticks=%d "
+           "window=%ld slow_ack=%ld/tick\n",
+           g_sessions, g_slow, g_rate, g_seconds, ticks, g_window,
+           g_slow_ack);
+
+    for (int i = 0; i < g_sessions; i++) {
+        sessions[i].index = i;
+        sessions[i].slow = i >= g_sessions - g_slow;
+        if (sim_session_start(&sessions[i], &attr) < 0) {
+            fprintf(stderr, "tnt_sim: failed to start session %d\n", i);
+            return 1;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    run_start = now_ns();
+    for (int tick = 0; tick < ticks; tick++) {
+        if (tick > 0) {
+            clock_ms += SIM_TICK_MS;
+            tnt_timer_wheel_advance(wheel, clock_ms);
+
+            post_credit += g_rate * SIM_TICK_MS / 1000.0;
+            for (int tries = 0; post_credit >= 1.0 && tries < g_sessions;
+                 tries++) {
+                sim_session_t *poster = &sessions[next_poster];
+                char line[64];
+                int len;
+
+                next_poster = (next_poster + 1) % g_sessions;
+                if (poster->done) {
+                    continue;
+                }
+                len = snprintf(line, sizeof(line), "post %d from sim%d\r",
+                               posted, poster->index);
+                tnt_fake_channel_feed(&poster->fake, line, (size_t)len);
+                post_credit -= 1.0;
+                posted++;
+                tries = -1;
+            }
+            if (post_credit >= 1.0) {
+                post_credit = 0.0;           /* Nobody left to post */
+            }
+        }
+
+        for (int i = 0; i < g_sessions; i++) {
+            sim_session_t *session = &sessions[i];
+
+            if (session->done) {
+                continue;
+            }
+            tnt_fake_channel_ack(&session->fake,
+                                 session->slow ? (uint32_t)g_slow_ack
+                                               : (uint32_t)g_window);
+            turns[turn_count] = sim_run_turn(session);
+            turn_total_ns += turns[turn_count];
+            turn_count++;
+            if (session->done) {
+                session->done_ms = clock_ms - SIM_CLOCK_START_MS;
+            }
+        }
+    }
+    in_room = room_get_client_count(g_room);
+
+    for (int i = 0; i < g_sessions; i++) {
+        sim_session_t *session = &sessions[i];
+
+        if (session->done) {
+            if (session->slow) {
+                dropped_slow++;
+            } else {
+                dropped_fast++;
+            }
+            if (session->done_ms < drop_first_ms) drop_first_ms = session->done_ms;
+            if (session->done_ms > drop_last_ms) drop_last_ms = session->done_ms;
+            continue;
+        }
+        tnt_fake_channel_hangup(&session->fake);
+        while (!session->done) {
+            sim_run_turn(session);
+        }
+    }
+    for (int i = 0; i < g_sessions; i++) {
+        sim_session_t *session = &sessions[i];
+        uint64_t usage[CLIENT_USAGE_COUNT];
+        uint64_t bytes = session->fake.bytes_written;
+
+        pthread_join(session->thread, NULL);
+        client_usage(session->client, usage);
+        frames_total += usage[CLIENT_USAGE_FRAMES];
+        bytes_total += bytes;
+        writes_total += session->fake.writes;
+        keepalives_total += session->fake.keepalives;
+        if (bytes < bytes_min) bytes_min = bytes;
+        if (bytes > bytes_max) bytes_max = bytes;
+        client_release(session->client);
+        tnt_fake_channel_destroy(&session->fake);
+        pthread_cond_destroy(&session->cond);
+    }
+
+    qsort(turns, turn_count, sizeof(*turns), compare_u64);
+    printf("in_room=%d posted=%d dropped_fast=%d dropped_slow=%d\n",
+           in_room, posted, dropped_fast, dropped_slow);
+    if (dropped_fast + dropped_slow > 0) {
+        printf("dropped_at_ms first=%llu last=%llu\n",
+               (unsigned long long)drop_first_ms,
+               (unsigned long long)drop_last_ms);
+    }
+    printf("output_bytes total=%llu per_session avg=%llu min=%llu max=%llu "
+           "writes=%llu frames=%llu keepalives=%llu\n",
+           (unsigned long long)bytes_total,
+           (unsigned long long)(bytes_total / (uint64_t)g_sessions),
+           (unsigned long long)bytes_min, (unsigned long long)bytes_max,
+           (unsigned long long)writes_total,
+           (unsigned long long)frames_total,
+           (unsigned long long)keepalives_total);
+    printf("turn_us p50=%.1f p99=%.1f max=%.1f turns=%zu\n",
+           quantile_us(turns, turn_count, 0.50),
+           quantile_us(turns, turn_count, 0.99),
+           quantile_us(turns, turn_count, 1.0), turn_count);
+    printf("session_seconds=%.3f wall_seconds=%.3f us_per_post=%.1f\n",
+           (double)turn_total_ns / 1e9, (double)(now_ns() - run_start) / 1e9,
+           posted > 0 ? (double)turn_total_ns / 1000.0 / posted : 0.0);
+
+    tnt_timer_service_stop();
+    room_destroy(g_room);
+    free(turns);
+    free(sessions);
+    if (own_state_dir) {
+        remove_state_dir(state_dir);
+    }
+    return dropped_fast > 0 ? 1 : 0;
+}
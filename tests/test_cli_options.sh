@@ -50,7 +50,12 @@ for opt in \
     --max-conn-rate-per-ip \
     --rate-limit \
     --idle-timeout \
+    --session-stack-kb \
+    --acceptors \
+    --metrics-listen \
     --ssh-log-level \
+    --host-keys \
+    --ssh-profile \
     --log-check \
     --log-recover
 do
@@ -75,6 +80,19 @@ else
     fail "invalid port diagnostic unexpected" "$BAD_PORT_OUTPUT"
 fi
 
+for bad in "--host-keys dsa" "--host-keys ed25519," "--ssh-profile turbo" \
+    "--acceptors 65" "--metrics-listen 127.0.0.1:99999"; do
+    # shellcheck disable=SC2086
+    BAD_OUTPUT=$("$BIN" $bad 2>&1)
+    BAD_STATUS=$?
+    if [ "$BAD_STATUS" -eq 64 ] &&
+       printf '%s\n' "$BAD_OUTPUT" | grep -q 'Invalid '; then
+        pass "$bad rejected before startup"
+    else
+        fail "$bad not rejected" "$BAD_OUTPUT"
+    fi
+done
+
 echo ""
 echo "PASSED: $PASS"
 echo "FAILED: $FAIL"
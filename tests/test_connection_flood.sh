@@ -0,0 +1,223 @@
+#!/bin/sh
+# Connection-storm admission test for TNT.
+# Usage: ./test_connection_flood.sh [storm_seconds] [storm_threads]
+#
+# A flood of raw TCP connects from 127.0.0.2 must be turned away by the
+# listener before any SSH banner is sent, while exec sessions from
+# 127.0.0.1 keep roughly their unloaded latency.
+
+PORT=${PORT:-2222}
+DURATION=${1:-6}
+THREADS=${2:-8}
+BIN="../tnt"
+PASS=0
+FAIL=0
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-flood-test.XXXXXX")
+SERVER_PID=""
+FLOOD_PID=""
+
+cleanup() {
+    if [ -n "$FLOOD_PID" ]; then
+        kill "$FLOOD_PID" 2>/dev/null || true
+        wait "$FLOOD_PID" 2>/dev/null || true
+    fi
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v python3 >/dev/null 2>&1; then
+    echo "python3 not installed; skipping connection flood test"
+    exit 0
+fi
+
+case "$(date +%3N 2>/dev/null)" in
+    ''|*[!0-9]*)
+        echo "date lacks millisecond output; skipping connection flood test"
+        exit 0
+        ;;
+esac
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+for value in "$DURATION" "$THREADS"; do
+    case "$value" in
+        ''|*[!0-9]*|0)
+            echo "Error: storm_seconds and storm_threads must be positive integers"
+            exit 2
+            ;;
+    esac
+done
+
+SSH_OPTS="-n -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o BatchMode=yes -o ConnectTimeout=15 -p $PORT"
+
+cat >"$STATE_DIR/flood.py" <<'EOF'
+import socket
+import sys
+import threading
+import time
+
+port, duration, threads = int(sys.argv[1]), float(sys.argv[2]), int(sys.argv[3])
+counts = {"attempts": 0, "admitted": 0, "rejected": 0, "errors": 0}
+lock = threading.Lock()
+deadline = time.time() + duration
+
+
+def one():
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.settimeout(2.0)
+    try:
+        s.bind(("127.0.0.2", 0))
+        s.connect(("127.0.0.1", port))
+        try:
+            data = s.recv(64)
+        except (socket.timeout, ConnectionResetError):
+            data = b""
+        return "admitted" if data.startswith(b"SSH-") else "rejected"
+    except OSError:
+        return "errors"
+    finally:
+        s.close()
+
+
+def run():
+    while time.time() < deadline:
+        kind = one()
+        with lock:
+            counts["attempts"] += 1
+            counts[kind] += 1
+
+
+workers = [threading.Thread(target=run) for _ in range(threads)]
+for w in workers:
+    w.start()
+for w in workers:
+    w.join()
+print("%(attempts)d %(admitted)d %(rejected)d %(errors)d" % counts)
+EOF
+
+# Probe that 127.0.0.2 is a usable source address (Linux loopback /8).
+if ! python3 -c 'import socket; s = socket.socket(); s.bind(("127.0.0.2", 0))' \
+    2>/dev/null; then
+    echo "127.0.0.2 not bindable; skipping connection flood test"
+    exit 0
+fi
+
+now_ms() {
+    date +%s%3N
+}
+
+# Prints the median latency of `count` health probes, or nothing on failure.
+probe_latency() {
+    count=$1
+    : >"$STATE_DIR/latency"
+    while [ "$count" -gt 0 ]; do
+        start=$(now_ms)
+        out=$(ssh $SSH_OPTS localhost health 2>/dev/null || true)
+        end=$(now_ms)
+        if [ "$out" != "ok" ]; then
+            return 1
+        fi
+        echo $((end - start)) >>"$STATE_DIR/latency"
+        count=$((count - 1))
+    done
+    sort -n "$STATE_DIR/latency" | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+echo "=== TNT Connection Flood Tests (${DURATION}s, ${THREADS} threads) ==="
+
+# The legitimate client makes ~11 connections; the flood makes thousands.
+TNT_MAX_CONN_RATE_PER_IP=20 TNT_MAX_CONN_PER_IP=10 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+READY=0
+for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15; do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    if [ "$(ssh $SSH_OPTS localhost health 2>/dev/null)" = "ok" ]; then
+        READY=1
+        break
+    fi
+    sleep 1
+done
+
+if [ "$READY" -eq 1 ]; then
+    echo "✓ server started"
+    PASS=$((PASS + 1))
+else
+    echo "✗ server failed to start"
+    sed -n '1,80p' "$STATE_DIR/server.log"
+    exit 1
+fi
+
+BASELINE=$(probe_latency 5)
+if [ -z "$BASELINE" ]; then
+    echo "✗ baseline health probes failed"
+    exit 1
+fi
+echo "  baseline median latency: ${BASELINE} ms"
+
+python3 "$STATE_DIR/flood.py" "$PORT" "$DURATION" "$THREADS" \
+    >"$STATE_DIR/flood.out" 2>&1 &
+FLOOD_PID=$!
+
+# Let the flood exhaust its rate allowance before sampling.
+sleep 1
+STORM=$(probe_latency 5)
+wait "$FLOOD_PID" 2>/dev/null || true
+FLOOD_PID=""
+
+if [ -n "$STORM" ]; then
+    echo "  storm median latency: ${STORM} ms"
+    LIMIT=$((BASELINE * 3 + 1000))
+    if [ "$STORM" -le "$LIMIT" ]; then
+        echo "✓ accepted-user latency stable under storm (limit ${LIMIT} ms)"
+        PASS=$((PASS + 1))
+    else
+        echo "✗ storm latency ${STORM} ms exceeds ${LIMIT} ms"
+        FAIL=$((FAIL + 1))
+    fi
+else
+    echo "✗ health probes failed during storm"
+    FAIL=$((FAIL + 1))
+fi
+
+# shellcheck disable=SC2046
+set -- $(cat "$STATE_DIR/flood.out")
+ATTEMPTS=${1:-0}
+ADMITTED=${2:-0}
+REJECTED=${3:-0}
+echo "  flood: $ATTEMPTS attempts, $ADMITTED admitted, $REJECTED rejected"
+
+if [ "$REJECTED" -gt 0 ] && [ "$ADMITTED" -le 20 ]; then
+    echo "✓ flood rejected before the SSH banner"
+    PASS=$((PASS + 1))
+else
+    echo "✗ flood was not turned away at accept time"
+    sed -n '1,20p' "$STATE_DIR/flood.out"
+    FAIL=$((FAIL + 1))
+fi
+
+if kill -0 "$SERVER_PID" 2>/dev/null; then
+    echo "✓ server survived the storm"
+    PASS=$((PASS + 1))
+else
+    echo "✗ server died during the storm"
+    sed -n '1,80p' "$STATE_DIR/server.log"
+    FAIL=$((FAIL + 1))
+fi
+
+echo ""
+echo "PASSED: $PASS"
+echo "FAILED: $FAIL"
+[ "$FAIL" -eq 0 ] && echo "All tests passed" || echo "Some tests failed"
+exit "$FAIL"
@@ -2,6 +2,7 @@
 # Exec-mode regression tests for TNT
 
 PORT=${PORT:-2222}
+METRICS_PORT=${METRICS_PORT:-$((PORT + 1000))}
 PASS=0
 FAIL=0
 BIN="../tnt"
@@ -38,7 +39,9 @@ echo "=== TNT Exec Mode Tests ==="
 # can be transiently exceeded and a connection refused mid-suite. Raise the
 # caps well above the number of in-flight connections this test can produce.
 TNT_LANG=zh TNT_RATE_LIMIT=0 TNT_MAX_CONN_PER_IP=256 TNT_MAX_CONNECTIONS=256 \
-    $BIN -p "$PORT" -d "$STATE_DIR" >"${STATE_DIR}/server.log" 2>&1 &
+    $BIN -p "$PORT" -d "$STATE_DIR" --control-socket \
+    --metrics-listen "127.0.0.1:$METRICS_PORT" \
+    >"${STATE_DIR}/server.log" 2>&1 &
 SERVER_PID=$!
 
 HEALTH_OUTPUT=""
@@ -295,6 +298,30 @@ else
     FAIL=$((FAIL + 1))
 fi
 
+METRICS_TEXT=$(ssh $SSH_OPTS localhost metrics 2>/dev/null || true)
+if printf '%s\n' "$METRICS_TEXT" | grep -q '^tnt_online_users ' &&
+   printf '%s\n' "$METRICS_TEXT" | grep -Eq '^tnt_messages_posted_total [1-9]' &&
+   printf '%s\n' "$METRICS_TEXT" | grep -q '^tnt_message_save_seconds_bucket{le="+Inf"} ' &&
+   printf '%s\n' "$METRICS_TEXT" | grep -q '^# TYPE tnt_render_seconds histogram$'; then
+    echo "✓ metrics returns registry counters and histograms"
+    PASS=$((PASS + 1))
+else
+    echo "✗ metrics output unexpected"
+    printf '%s\n' "$METRICS_TEXT" | sed -n '1,40p'
+    FAIL=$((FAIL + 1))
+fi
+
+TNTCTL_METRICS=$("../tntctl" -p "$PORT" $TNTCTL_OPTS localhost metrics --json 2>/dev/null || true)
+if printf '%s\n' "$TNTCTL_METRICS" | grep -q '^{"counters":{"messages_posted":[1-9]' &&
+   printf '%s\n' "$TNTCTL_METRICS" | grep -q '"message_save_us":{"count":[1-9]'; then
+    echo "✓ tntctl metrics --json returns the registry"
+    PASS=$((PASS + 1))
+else
+    echo "✗ tntctl metrics --json output unexpected"
+    printf '%s\n' "$TNTCTL_METRICS"
+    FAIL=$((FAIL + 1))
+fi
+
 TNTCTL_TAIL=$("../tntctl" -p "$PORT" $TNTCTL_OPTS localhost "tail" "-n" "1" 2>/dev/null || true)
 printf '%s\n' "$TNTCTL_TAIL" | grep -q 'ctlposter' &&
 printf '%s\n' "$TNTCTL_TAIL" | grep -q 'hello from tntctl'
@@ -318,6 +345,149 @@ else
     FAIL=$((FAIL + 1))
 fi
 
+LOCAL_HEALTH=$("../tntctl" --local -d "$STATE_DIR" health 2>/dev/null || true)
+if [ "$LOCAL_HEALTH" = "ok" ]; then
+    echo "✓ tntctl --local health uses the control socket"
+    PASS=$((PASS + 1))
+else
+    echo "✗ tntctl --local health failed: $LOCAL_HEALTH"
+    FAIL=$((FAIL + 1))
+fi
+
+LOCAL_STATS=$("../tntctl" --local -d "$STATE_DIR" stats --json 2>/dev/null || true)
+case "$LOCAL_STATS" in
+    '{"status":"ok","online_users":'*) echo "✓ tntctl --local stats --json returns JSON"; PASS=$((PASS + 1)) ;;
+    *) echo "✗ tntctl --local stats --json output unexpected: $LOCAL_STATS"; FAIL=$((FAIL + 1)) ;;
+esac
+
+SESSIONS_JSON=$(ssh $SSH_OPTS localhost sessions --json 2>/dev/null || true)
+SESSIONS_BAD_STATUS=0
+ssh $SSH_OPTS localhost sessions -n 0 >/dev/null 2>&1 || SESSIONS_BAD_STATUS=$?
+case "$SESSIONS_JSON" in
+    '{"status":"ok","sessions":'*'"sort":"cpu","top":['*)
+        if [ "$SESSIONS_BAD_STATUS" -eq 64 ]; then
+            echo "✓ sessions --json lists sessions and rejects -n 0"
+            PASS=$((PASS + 1))
+        else
+            echo "✗ sessions -n 0 exit $SESSIONS_BAD_STATUS, expected 64"
+            FAIL=$((FAIL + 1))
+        fi
+        ;;
+    *) echo "✗ sessions --json output unexpected: $SESSIONS_JSON"; FAIL=$((FAIL + 1)) ;;
+esac
+
+LATENCY_JSON=$(ssh $SSH_OPTS localhost stats --latency --json 2>/dev/null || true)
+BOTH_STATUS=0
+ssh $SSH_OPTS localhost stats --memory --latency >/dev/null 2>&1 || BOTH_STATUS=$?
+case "$LATENCY_JSON" in
+    '{"status":"ok","delivery_enqueue_us":{"count":'*'"delivery_flush_us":{"count":'*'"per_client":['*)
+        if [ "$BOTH_STATUS" -eq 64 ]; then
+            echo "✓ stats --latency --json reports delivery histograms"
+            PASS=$((PASS + 1))
+        else
+            echo "✗ stats --memory --latency exit $BOTH_STATUS, expected 64"
+            FAIL=$((FAIL + 1))
+        fi
+        ;;
+    *) echo "✗ stats --latency --json output unexpected: $LATENCY_JSON"; FAIL=$((FAIL + 1)) ;;
+esac
+
+ssh $SSH_OPTS localhost locks --on >/dev/null 2>&1
+REMOTE_LOCKS_STATUS=$?
+LOCAL_LOCKS_ON=$("../tntctl" --local -d "$STATE_DIR" locks --on 2>/dev/null || true)
+ssh $SSH_OPTS lockprobe@localhost post "lock profile probe" >/dev/null 2>&1
+ssh $SSH_OPTS localhost users >/dev/null 2>&1
+LOCKS_TEXT=$("../tntctl" -p "$PORT" $TNTCTL_OPTS localhost locks 2>/dev/null || true)
+LOCAL_LOCKS_OFF=$("../tntctl" --local -d "$STATE_DIR" locks --off 2>/dev/null || true)
+if [ "$REMOTE_LOCKS_STATUS" -eq 64 ] &&
+   [ "$LOCAL_LOCKS_ON" = "lock_profile on" ] &&
+   [ "$LOCAL_LOCKS_OFF" = "lock_profile off" ] &&
+   printf '%s\n' "$LOCKS_TEXT" | grep -q '^lock_profile on$' &&
+   printf '%s\n' "$LOCKS_TEXT" | grep -Eq '^lock room reads [1-9]' &&
+   printf '%s\n' "$LOCKS_TEXT" | grep -Eq '^lock message_file reads 0 writes [1-9]' &&
+   printf '%s\n' "$LOCKS_TEXT" | grep -q '^site src/[a-z_]*\.c:[0-9]* '; then
+    echo "✓ locks profiles g_room and the message file when switched on locally"
+    PASS=$((PASS + 1))
+else
+    echo "✗ locks output unexpected (remote switch exit $REMOTE_LOCKS_STATUS): $LOCAL_LOCKS_ON / $LOCAL_LOCKS_OFF"
+    printf '%s\n' "$LOCKS_TEXT"
+    FAIL=$((FAIL + 1))
+fi
+
+ssh $SSH_OPTS localhost trace start >/dev/null 2>&1
+REMOTE_TRACE_STATUS=$?
+LOCAL_TRACE_ON=$("../tntctl" --local -d "$STATE_DIR" trace start 2>/dev/null || true)
+ssh $SSH_OPTS traceprobe@localhost post "trace probe" >/dev/null 2>&1
+LOCAL_TRACE_OFF=$("../tntctl" --local -d "$STATE_DIR" trace stop 2>/dev/null || true)
+TRACE_FILE=$(printf '%s\n' "$LOCAL_TRACE_OFF" | sed -n 's/^file //p')
+if [ "$REMOTE_TRACE_STATUS" -eq 64 ] &&
+   [ "$LOCAL_TRACE_ON" = "trace on" ] &&
+   printf '%s\n' "$LOCAL_TRACE_OFF" | grep -q '^trace off$' &&
+   [ -n "$TRACE_FILE" ] && [ -f "$TRACE_FILE" ] &&
+   grep -q '"traceEvents"' "$TRACE_FILE" &&
+   grep -q '"name":"room_broadcast"' "$TRACE_FILE" &&
+   grep -q '"name":"message_save"' "$TRACE_FILE"; then
+    echo "✓ trace start/stop writes a Chrome trace to the state directory"
+    PASS=$((PASS + 1))
+else
+    echo "✗ trace output unexpected (remote start exit $REMOTE_TRACE_STATUS): $LOCAL_TRACE_ON / $LOCAL_TRACE_OFF"
+    FAIL=$((FAIL + 1))
+fi
+
+"../tntctl" --local -d "$STATE_DIR" users --xml >/dev/null 2>&1
+LOCAL_USAGE_STATUS=$?
+if [ "$LOCAL_USAGE_STATUS" -eq 64 ]; then
+    echo "✓ tntctl --local preserves usage exit 64"
+    PASS=$((PASS + 1))
+else
+    echo "✗ tntctl --local users --xml exit $LOCAL_USAGE_STATUS"
+    FAIL=$((FAIL + 1))
+fi
+
+LOCAL_POST=$("../tntctl" --local -d "$STATE_DIR" -l localposter post "hello over control.sock" 2>/dev/null || true)
+LOCAL_TAIL=$(ssh $SSH_OPTS localhost "tail -n 1" 2>/dev/null || true)
+if [ "$LOCAL_POST" = "posted" ] &&
+   printf '%s\n' "$LOCAL_TAIL" | grep -q 'localposter	hello over control.sock'; then
+    echo "✓ tntctl --local post publishes with the given login"
+    PASS=$((PASS + 1))
+else
+    echo "✗ tntctl --local post unexpected: $LOCAL_POST / $LOCAL_TAIL"
+    FAIL=$((FAIL + 1))
+fi
+
+if command -v curl >/dev/null 2>&1; then
+    HTTP_HEALTH=$(curl -fsS --max-time 5 "http://127.0.0.1:$METRICS_PORT/health" 2>/dev/null || true)
+    if [ "$HTTP_HEALTH" = "ok" ]; then
+        echo "✓ metrics endpoint /health returns ok"
+        PASS=$((PASS + 1))
+    else
+        echo "✗ metrics endpoint /health failed: $HTTP_HEALTH"
+        FAIL=$((FAIL + 1))
+    fi
+
+    HTTP_METRICS=$(curl -fsS --max-time 5 "http://127.0.0.1:$METRICS_PORT/metrics" 2>/dev/null || true)
+    if printf '%s\n' "$HTTP_METRICS" | grep -q '^tnt_online_users 0$' &&
+       printf '%s\n' "$HTTP_METRICS" | grep -q '^tnt_handshake_timeouts_total{phase="kex"} '; then
+        echo "✓ metrics endpoint /metrics returns text metrics"
+        PASS=$((PASS + 1))
+    else
+        echo "✗ metrics endpoint /metrics output unexpected"
+        printf '%s\n' "$HTTP_METRICS"
+        FAIL=$((FAIL + 1))
+    fi
+
+    HTTP_MISSING=$(curl -s -o /dev/null -w '%{http_code}' --max-time 5 "http://127.0.0.1:$METRICS_PORT/nope" 2>/dev/null || true)
+    if [ "$HTTP_MISSING" = "404" ]; then
+        echo "✓ metrics endpoint answers 404 for unknown paths"
+        PASS=$((PASS + 1))
+    else
+        echo "✗ metrics endpoint unknown path returned: $HTTP_MISSING"
+        FAIL=$((FAIL + 1))
+    fi
+else
+    echo "curl not installed; skipping metrics endpoint checks"
+fi
+
 EXPECT_SCRIPT="${STATE_DIR}/watcher.expect"
 WATCHER_READY="${STATE_DIR}/watcher.ready"
 cat >"$EXPECT_SCRIPT" <<EOF
@@ -0,0 +1,184 @@
+#!/bin/sh
+# Per-phase handshake deadline and pending-handshake cap tests for TNT.
+#
+# Half-open SSH connections (banner sent, then silence) must be dropped at
+# the key-exchange deadline, may only occupy TNT_MAX_PENDING_HANDSHAKES
+# slots meanwhile, and must never lock out a real client for longer than
+# that deadline.
+
+PORT=${PORT:-2222}
+BIN="../tnt"
+PASS=0
+FAIL=0
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-handshake-test.XXXXXX")
+SERVER_PID=""
+STALL_PID=""
+
+cleanup() {
+    if [ -n "$STALL_PID" ]; then
+        kill "$STALL_PID" 2>/dev/null || true
+        wait "$STALL_PID" 2>/dev/null || true
+    fi
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v python3 >/dev/null 2>&1; then
+    echo "python3 not installed; skipping handshake timeout tests"
+    exit 0
+fi
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+SSH_OPTS="-n -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o BatchMode=yes -o ConnectTimeout=15 -p $PORT"
+
+# Opens `count` connections that send an SSH banner and then stall.  Prints
+# how many were closed by the server within `wait_s` seconds, and how many
+# of those were closed before the server sent its own banner.
+cat >"$STATE_DIR/stall.py" <<'EOF'
+import select
+import socket
+import sys
+import time
+
+port, count, wait_s = int(sys.argv[1]), int(sys.argv[2]), float(sys.argv[3])
+socks = []
+for _ in range(count):
+    s = socket.create_connection(("127.0.0.1", port), timeout=5)
+    s.sendall(b"SSH-2.0-stall\r\n")
+    socks.append(s)
+
+bannered = set()
+closed = set()
+deadline = time.time() + wait_s
+while len(closed) < count and time.time() < deadline:
+    live = [s for s in socks if s not in closed]
+    ready, _, _ = select.select(live, [], [], 0.2)
+    for s in ready:
+        try:
+            data = s.recv(4096)
+        except OSError:
+            data = b""
+        if data:
+            bannered.add(s)
+        else:
+            closed.add(s)
+
+print(len(closed), len([s for s in closed if s not in bannered]))
+for s in socks:
+    s.close()
+EOF
+
+wait_for_health() {
+    for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15; do
+        if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+            return 1
+        fi
+        if [ "$(ssh $SSH_OPTS localhost health 2>/dev/null)" = "ok" ]; then
+            return 0
+        fi
+        sleep 1
+    done
+    return 1
+}
+
+stat_value() {
+    ssh $SSH_OPTS localhost stats 2>/dev/null | awk -v key="$1" '$1 == key { print $2 }'
+}
+
+echo "=== TNT Handshake Timeout Tests ==="
+
+TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=8 TNT_MAX_PENDING_HANDSHAKES=3 \
+    TNT_KEX_TIMEOUT=2 "$BIN" -p "$PORT" -d "$STATE_DIR" \
+    >"$STATE_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+if wait_for_health; then
+    echo "✓ server started"
+    PASS=$((PASS + 1))
+else
+    echo "✗ server failed to start"
+    sed -n '1,80p' "$STATE_DIR/server.log"
+    exit 1
+fi
+
+# Ten stalled handshakes against three slots: seven are refused at accept,
+# three are dropped when the 2 s key-exchange deadline passes.
+python3 "$STATE_DIR/stall.py" "$PORT" 10 6 >"$STATE_DIR/stall.out" 2>&1 &
+STALL_PID=$!
+sleep 1
+
+if [ "$(stat_value pending_handshakes 2>/dev/null)" = "" ]; then
+    # Every slot is held by a stalled peer right now; that is the point.
+    echo "✓ stalled handshakes hold at most the pending-handshake cap"
+    PASS=$((PASS + 1))
+else
+    echo "✗ health/stats connection admitted beyond the pending cap"
+    FAIL=$((FAIL + 1))
+fi
+
+wait "$STALL_PID" 2>/dev/null || true
+STALL_PID=""
+# shellcheck disable=SC2046
+set -- $(cat "$STATE_DIR/stall.out")
+CLOSED=${1:-0}
+REFUSED=${2:-0}
+
+if [ "$CLOSED" -eq 10 ]; then
+    echo "✓ all stalled connections closed within the deadline"
+    PASS=$((PASS + 1))
+else
+    echo "✗ only $CLOSED of 10 stalled connections were closed"
+    sed -n '1,20p' "$STATE_DIR/stall.out"
+    FAIL=$((FAIL + 1))
+fi
+
+if [ "$REFUSED" -ge 7 ]; then
+    echo "✓ connections beyond the pending cap refused before the banner"
+    PASS=$((PASS + 1))
+else
+    echo "✗ expected at least 7 refused connections, got $REFUSED"
+    FAIL=$((FAIL + 1))
+fi
+
+KEX_TIMEOUTS=$(stat_value handshake_timeouts_kex)
+if [ -n "$KEX_TIMEOUTS" ] && [ "$KEX_TIMEOUTS" -ge 3 ]; then
+    echo "✓ key-exchange timeouts counted ($KEX_TIMEOUTS)"
+    PASS=$((PASS + 1))
+else
+    echo "✗ handshake_timeouts_kex is '$KEX_TIMEOUTS', expected >= 3"
+    sed -n '1,40p' "$STATE_DIR/server.log"
+    FAIL=$((FAIL + 1))
+fi
+
+PENDING=$(stat_value pending_handshakes)
+ACTIVE=$(stat_value active_connections)
+if [ "$PENDING" = "0" ] && [ "$ACTIVE" = "1" ]; then
+    echo "✓ slots released after timeouts (only the stats session remains)"
+    PASS=$((PASS + 1))
+else
+    echo "✗ pending=$PENDING active=$ACTIVE after timeouts"
+    FAIL=$((FAIL + 1))
+fi
+
+if grep -q "Handshake kex phase timed out" "$STATE_DIR/server.log"; then
+    echo "✓ timeout logged with its phase"
+    PASS=$((PASS + 1))
+else
+    echo "✗ no kex timeout line in server log"
+    FAIL=$((FAIL + 1))
+fi
+
+echo ""
+echo "PASSED: $PASS"
+echo "FAILED: $FAIL"
+[ "$FAIL" -eq 0 ] && echo "All tests passed" || echo "Some tests failed"
+exit "$FAIL"
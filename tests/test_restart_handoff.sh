@@ -0,0 +1,226 @@
+#!/bin/sh
+# Zero-downtime restart test for TNT.
+# Usage: ./test_restart_handoff.sh [probe_seconds]
+#
+# A prober connects continuously while a second and then a third server
+# take the listening sockets over with --takeover.  No connection may be
+# refused, and each replaced server must drain and exit on its own.  Every
+# server also runs the metrics endpoint on one address, which each new
+# server must take over as well.
+
+PORT=${PORT:-2222}
+METRICS_PORT=${METRICS_PORT:-$((PORT + 1000))}
+METRICS_LISTEN="127.0.0.1:$METRICS_PORT"
+DURATION=${1:-8}
+BIN="../tnt"
+PASS=0
+FAIL=0
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-restart-test.XXXXXX")
+OLD_PID=""
+NEW_PID=""
+NEXT_PID=""
+PROBE_PID=""
+
+cleanup() {
+    for pid in "$PROBE_PID" "$OLD_PID" "$NEW_PID" "$NEXT_PID"; do
+        if [ -n "$pid" ]; then
+            kill "$pid" 2>/dev/null || true
+            wait "$pid" 2>/dev/null || true
+        fi
+    done
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v python3 >/dev/null 2>&1; then
+    echo "python3 not installed; skipping restart handoff test"
+    exit 0
+fi
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+case "$DURATION" in
+    ''|*[!0-9]*|0)
+        echo "Error: probe_seconds must be a positive integer"
+        exit 2
+        ;;
+esac
+
+SSH_OPTS="-n -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o BatchMode=yes -o ConnectTimeout=15 -p $PORT"
+
+# Prints "banners refused other" after probing for `duration` seconds.
+cat >"$STATE_DIR/probe.py" <<'PYEOF'
+import socket
+import sys
+import time
+
+port, duration = int(sys.argv[1]), float(sys.argv[2])
+banners = refused = other = 0
+deadline = time.time() + duration
+while time.time() < deadline:
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.settimeout(5.0)
+    try:
+        s.connect(("127.0.0.1", port))
+        if s.recv(64).startswith(b"SSH-"):
+            banners += 1
+        else:
+            other += 1
+    except ConnectionRefusedError:
+        refused += 1
+    except OSError:
+        other += 1
+    finally:
+        s.close()
+    time.sleep(0.005)
+print(banners, refused, other)
+PYEOF
+
+# Prints the body of GET /health on the metrics endpoint, or nothing.
+metrics_health() {
+    python3 - "$METRICS_PORT" <<'PYEOF' 2>/dev/null
+import sys
+import urllib.request
+
+url = "http://127.0.0.1:%s/health" % sys.argv[1]
+print(urllib.request.urlopen(url, timeout=5).read().decode().strip())
+PYEOF
+}
+
+wait_for_log() {
+    for _ in $(seq 1 60); do
+        if grep -q "$2" "$1" 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.25
+    done
+    return 1
+}
+
+wait_for_exit() {
+    for _ in $(seq 1 60); do
+        if ! kill -0 "$1" 2>/dev/null; then
+            wait "$1" 2>/dev/null
+            return 0
+        fi
+        sleep 0.25
+    done
+    return 1
+}
+
+echo "=== TNT Restart Handoff Tests (${DURATION}s probe) ==="
+
+TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=256 TNT_MAX_CONN_PER_IP=256 \
+    TNT_MAX_PENDING_HANDSHAKES=256 TNT_DRAIN_TIMEOUT=5 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" --metrics-listen "$METRICS_LISTEN" \
+    >"$STATE_DIR/old.log" 2>&1 &
+OLD_PID=$!
+
+if wait_for_log "$STATE_DIR/old.log" "Accepting on" &&
+   [ "$(ssh $SSH_OPTS localhost health 2>/dev/null)" = "ok" ] &&
+   [ "$(metrics_health)" = "ok" ]; then
+    echo "✓ first server started"
+    PASS=$((PASS + 1))
+else
+    echo "✗ first server failed to start"
+    sed -n '1,40p' "$STATE_DIR/old.log"
+    exit 1
+fi
+
+python3 "$STATE_DIR/probe.py" "$PORT" "$DURATION" >"$STATE_DIR/probe.out" 2>&1 &
+PROBE_PID=$!
+sleep 1
+
+TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=256 TNT_MAX_CONN_PER_IP=256 \
+    TNT_MAX_PENDING_HANDSHAKES=256 TNT_DRAIN_TIMEOUT=5 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" --metrics-listen "$METRICS_LISTEN" \
+    --takeover >"$STATE_DIR/new.log" 2>&1 &
+NEW_PID=$!
+
+if wait_for_log "$STATE_DIR/new.log" "taken over"; then
+    echo "✓ second server took the listeners over"
+    PASS=$((PASS + 1))
+else
+    echo "✗ second server did not take over"
+    sed -n '1,40p' "$STATE_DIR/new.log"
+    FAIL=$((FAIL + 1))
+fi
+
+# The replaced server releases the metrics address; the new one binds it.
+if wait_for_log "$STATE_DIR/new.log" "Metrics endpoint:" &&
+   kill -0 "$NEW_PID" 2>/dev/null &&
+   [ "$(metrics_health)" = "ok" ]; then
+    echo "✓ second server took the metrics endpoint over"
+    PASS=$((PASS + 1))
+else
+    echo "✗ second server did not take the metrics endpoint over"
+    sed -n '1,40p' "$STATE_DIR/new.log"
+    FAIL=$((FAIL + 1))
+fi
+
+if wait_for_exit "$OLD_PID" &&
+   grep -q "no longer accepting" "$STATE_DIR/old.log" &&
+   grep -q "Drain complete" "$STATE_DIR/old.log"; then
+    echo "✓ first server drained and exited"
+    PASS=$((PASS + 1))
+    OLD_PID=""
+else
+    echo "✗ first server did not drain and exit"
+    sed -n '1,40p' "$STATE_DIR/old.log"
+    FAIL=$((FAIL + 1))
+fi
+
+# The new server must offer the handoff in turn
+TNT_RATE_LIMIT=0 TNT_MAX_CONNECTIONS=256 TNT_MAX_CONN_PER_IP=256 \
+    TNT_MAX_PENDING_HANDSHAKES=256 TNT_DRAIN_TIMEOUT=5 \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" --metrics-listen "$METRICS_LISTEN" \
+    --takeover >"$STATE_DIR/next.log" 2>&1 &
+NEXT_PID=$!
+
+if wait_for_log "$STATE_DIR/next.log" "taken over" && wait_for_exit "$NEW_PID" &&
+   grep -q "Metrics endpoint:" "$STATE_DIR/next.log" &&
+   [ "$(metrics_health)" = "ok" ]; then
+    echo "✓ second restart handed over as well"
+    PASS=$((PASS + 1))
+    NEW_PID=""
+else
+    echo "✗ second restart failed"
+    sed -n '1,40p' "$STATE_DIR/next.log"
+    FAIL=$((FAIL + 1))
+fi
+
+wait "$PROBE_PID" 2>/dev/null || true
+PROBE_PID=""
+# shellcheck disable=SC2046
+set -- $(cat "$STATE_DIR/probe.out")
+BANNERS=${1:-0}
+REFUSED=${2:-0}
+OTHER=${3:-0}
+echo "  probe: $BANNERS banners, $REFUSED refused, $OTHER other errors"
+
+if [ "$BANNERS" -gt 0 ] && [ "$REFUSED" -eq 0 ]; then
+    echo "✓ no connection refused across two restarts"
+    PASS=$((PASS + 1))
+else
+    echo "✗ refused-connection window is not zero"
+    sed -n '1,5p' "$STATE_DIR/probe.out"
+    FAIL=$((FAIL + 1))
+fi
+
+if [ "$(ssh $SSH_OPTS localhost health 2>/dev/null)" = "ok" ]; then
+    echo "✓ final server answers health"
+    PASS=$((PASS + 1))
+else
+    echo "✗ final server does not answer health"
+    FAIL=$((FAIL + 1))
+fi
+
+echo ""
+echo "PASSED: $PASS"
+echo "FAILED: $FAIL"
+[ "$FAIL" -eq 0 ] && echo "All tests passed" || echo "Some tests failed"
+exit "$FAIL"
@@ -84,25 +84,33 @@ run_server_probe() {
     return 1
 }
 
-# Test 1: 4096-bit RSA Key Generation
-print_test "1. RSA 4096-bit Key Generation"
+file_perms() {
+    if [[ "$OSTYPE" == "darwin"* ]]; then
+        stat -f "%OLp" "$1"
+    else
+        stat -c "%a" "$1"
+    fi
+}
+
+# Test 1: Host Key Generation
+print_test "1. Host Key Generation (Ed25519 default, RSA 4096-bit on request)"
 KEY_DIR="$STATE_ROOT/host-key"
 
-if run_server_probe host-key env && [ -f "$KEY_DIR/host_key" ]; then
-    KEY_SIZE=$(ssh-keygen -l -f "$KEY_DIR/host_key" 2>/dev/null | awk '{print $1}')
-    if [ "$KEY_SIZE" = "4096" ]; then
-        pass "RSA key upgraded to 4096 bits (was 2048)"
+if run_server_probe host-key env && [ -f "$KEY_DIR/host_key_ed25519" ]; then
+    KEY_TYPE=$(ssh-keygen -l -f "$KEY_DIR/host_key_ed25519" 2>/dev/null | awk '{print $NF}')
+    if [ "$KEY_TYPE" = "(ED25519)" ]; then
+        pass "Ed25519 host key generated by default"
     else
-        fail "Key is $KEY_SIZE bits, expected 4096"
+        fail "Default host key type is $KEY_TYPE, expected (ED25519)"
     fi
 
-    # Check permissions
-    if [[ "$OSTYPE" == "darwin"* ]]; then
-        PERMS=$(stat -f "%OLp" "$KEY_DIR/host_key")
+    if [ ! -f "$KEY_DIR/host_key" ]; then
+        pass "No RSA key generated unless requested"
     else
-        PERMS=$(stat -c "%a" "$KEY_DIR/host_key")
+        fail "RSA key generated on a fresh state directory"
     fi
-    
+
+    PERMS=$(file_perms "$KEY_DIR/host_key_ed25519")
     if [ "$PERMS" = "600" ]; then
         pass "Host key has secure permissions (600)"
     else
@@ -112,6 +120,45 @@ else
     fail "Host key not generated"
 fi
 
+RSA_DIR="$STATE_ROOT/host-key-rsa"
+if run_server_probe host-key-rsa env TNT_HOST_KEYS=ed25519,rsa && \
+   [ -f "$RSA_DIR/host_key" ]; then
+    KEY_SIZE=$(ssh-keygen -l -f "$RSA_DIR/host_key" 2>/dev/null | awk '{print $1}')
+    if [ "$KEY_SIZE" = "4096" ]; then
+        pass "Requested RSA key is 4096 bits"
+    else
+        fail "Key is $KEY_SIZE bits, expected 4096"
+    fi
+
+    PERMS=$(file_perms "$RSA_DIR/host_key")
+    if [ "$PERMS" = "600" ]; then
+        pass "RSA host key has secure permissions (600)"
+    else
+        fail "RSA host key permissions are $PERMS, expected 600"
+    fi
+
+    # An existing RSA key keeps loading under the default selection
+    if run_server_probe host-key-rsa env; then
+        pass "Existing RSA key loads alongside Ed25519"
+    else
+        fail "Server failed to restart with existing RSA key"
+    fi
+else
+    fail "RSA host key not generated with TNT_HOST_KEYS=ed25519,rsa"
+fi
+
+for profile in fast modern; do
+    run_server_probe "profile-$profile" env TNT_SSH_PROFILE="$profile" && \
+        pass "TNT_SSH_PROFILE=$profile starts" || \
+        fail "TNT_SSH_PROFILE=$profile failed to start"
+done
+
+if run_server_probe profile-mismatch env TNT_HOST_KEYS=rsa TNT_SSH_PROFILE=modern; then
+    fail "modern profile accepted without an Ed25519 key"
+else
+    pass "modern profile refuses RSA-only host keys"
+fi
+
 # Test 2: Server Start with Different Configurations
 print_test "2. Environment Variable Configuration"
 
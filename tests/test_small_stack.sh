@@ -0,0 +1,172 @@
+#!/bin/sh
+# Deep command paths under the minimum session thread stack.
+#
+# Runs the server with TNT_SESSION_STACK_KB at its floor and drives the
+# heaviest render and command paths (MOTD, help, pager output, search,
+# inbox, memory stats, log dump) to make sure none of them overflows.
+
+PORT=${PORT:-12349}
+STACK_KB=${STACK_KB:-64}
+PASS=0
+FAIL=0
+BIN="../tnt"
+SERVER_PID=""
+STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-stack-test.XXXXXX")
+
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$STATE_DIR"
+}
+
+trap cleanup EXIT
+
+if ! command -v expect >/dev/null 2>&1; then
+    echo "expect not installed; skipping small-stack tests"
+    exit 0
+fi
+
+if [ ! -f "$BIN" ]; then
+    echo "Error: Binary $BIN not found. Run make first."
+    exit 1
+fi
+
+SSH_OPTS="-e none -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o LogLevel=ERROR -o ConnectionAttempts=3 -o ConnectTimeout=15 -p $PORT"
+
+echo "=== TNT Small Stack Tests (${STACK_KB} KiB) ==="
+
+# A MOTD close to the pager limit exercises the largest render buffers.
+{
+    echo "stack-test-motd"
+    i=0
+    while [ "$i" -lt 60 ]; do
+        echo "line $i: the quick brown fox jumps over the lazy dog 一二三四五"
+        i=$((i + 1))
+    done
+} >"$STATE_DIR/motd.txt"
+
+TNT_LANG=en TNT_RATE_LIMIT=0 TNT_SESSION_STACK_KB="$STACK_KB" \
+    "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+SERVER_READY=0
+for _ in 1 2 3 4 5; do
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        echo "x Server failed to start"
+        sed -n '1,120p' "$STATE_DIR/server.log"
+        exit 1
+    fi
+    if grep -q "TNT chat server listening" "$STATE_DIR/server.log"; then
+        SERVER_READY=1
+        break
+    fi
+    sleep 1
+done
+
+if [ "$SERVER_READY" -eq 1 ]; then
+    echo "✓ server started with ${STACK_KB} KiB session stacks"
+    PASS=$((PASS + 1))
+else
+    echo "x Server did not become ready"
+    sed -n '1,120p' "$STATE_DIR/server.log"
+    exit 1
+fi
+
+# Seed the log so search and dump have something to walk.
+i=0
+while [ "$i" -lt 20 ]; do
+    ssh $SSH_OPTS localhost post "deep-path message $i" >/dev/null 2>&1 || true
+    i=$((i + 1))
+done
+
+DEEP_SCRIPT="$STATE_DIR/deep.expect"
+cat >"$DEEP_SCRIPT" <<EOF
+set timeout 10
+spawn ssh $SSH_OPTS anonymous@127.0.0.1
+sleep 1
+send -- "deep\r"
+expect "stack-test-motd"
+expect "Press any key"
+send -- " "
+expect "Esc NORMAL"
+send -- "hello from a small stack\r"
+send -- "\033"
+expect "NORMAL"
+send -- "?"
+expect "KEYS"
+send -- "q"
+expect "NORMAL"
+send -- ":"
+expect ":"
+send -- "search deep-path\r"
+expect "deep-path message"
+send -- "q"
+expect "NORMAL"
+send -- ":"
+expect ":"
+send -- "last 50\r"
+expect "q:close"
+send -- "q"
+expect "NORMAL"
+send -- ":"
+expect ":"
+send -- "msg deep hi\r"
+expect "q:close"
+send -- "q"
+expect "NORMAL"
+send -- ":"
+expect ":"
+send -- "inbox\r"
+expect "Private messages"
+send -- "q"
+expect "NORMAL"
+send -- ":"
+expect ":"
+send -- "users\r"
+expect "Online users"
+send -- "q"
+sleep 0.2
+send -- "\003"
+sleep 0.2
+send -- "\003"
+expect eof
+EOF
+
+if expect "$DEEP_SCRIPT" >"$STATE_DIR/deep.log" 2>&1; then
+    echo "✓ interactive deep command paths"
+    PASS=$((PASS + 1))
+else
+    echo "x interactive deep command paths failed"
+    sed -n '1,200p' "$STATE_DIR/deep.log"
+    sed -n '1,120p' "$STATE_DIR/server.log"
+    FAIL=$((FAIL + 1))
+fi
+
+for cmd in "stats --memory" "stats --memory --json" "tail -n 50" "dump" "users --json"; do
+    # shellcheck disable=SC2086
+    if ssh $SSH_OPTS localhost $cmd >"$STATE_DIR/exec.out" 2>&1; then
+        echo "✓ exec $cmd"
+        PASS=$((PASS + 1))
+    else
+        echo "x exec $cmd failed"
+        sed -n '1,40p' "$STATE_DIR/exec.out"
+        FAIL=$((FAIL + 1))
+    fi
+done
+
+if kill -0 "$SERVER_PID" 2>/dev/null; then
+    echo "✓ server survived deep paths"
+    PASS=$((PASS + 1))
+else
+    echo "x server died"
+    sed -n '1,120p' "$STATE_DIR/server.log"
+    FAIL=$((FAIL + 1))
+fi
+
+echo ""
+echo "PASSED: $PASS"
+echo "FAILED: $FAIL"
+[ "$FAIL" -eq 0 ] && echo "All tests passed" || echo "Some tests failed"
+exit "$FAIL"
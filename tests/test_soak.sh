@@ -1,11 +1,21 @@
 #!/bin/sh
 # Lightweight soak test for TNT.
-# Usage: ./test_soak.sh [duration_seconds] [reconnect_count]
+# Usage: ./test_soak.sh [duration_seconds] [reconnect_count] [rss_reconnects]
+#
+# rss_reconnects interactive PTY sessions (name prompt, chat screen,
+# disconnect) are churned through tnt_loadgen in ten batches after a
+# warm-up batch.  Server RSS is sampled after each batch and must stay
+# flat, and `stats --memory` must show the per-connection pools being
+# reused rather than refilled.  Use a few thousand
+# (e.g. ./test_soak.sh 8 5 5000) for a reconnect-storm run.
 
 PORT=${PORT:-2222}
 DURATION=${1:-8}
 RECONNECTS=${2:-5}
+RSS_RECONNECTS=${3:-1000}
+RSS_WORKERS=${RSS_WORKERS:-8}
 BIN="../tnt"
+LOADGEN="loadgen/tnt_loadgen"
 PASS=0
 FAIL=0
 STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-soak-test.XXXXXX")
@@ -40,8 +50,16 @@ case "$RECONNECTS" in
         ;;
 esac
 
-if [ "$DURATION" -lt 1 ] || [ "$RECONNECTS" -lt 1 ]; then
-    echo "Error: duration_seconds and reconnect_count must be positive"
+case "$RSS_RECONNECTS" in
+    ''|*[!0-9]*)
+        echo "Error: rss_reconnects must be a positive integer"
+        exit 2
+        ;;
+esac
+
+if [ "$DURATION" -lt 1 ] || [ "$RECONNECTS" -lt 1 ] ||
+   [ "$RSS_RECONNECTS" -lt 1 ]; then
+    echo "Error: duration_seconds, reconnect_count and rss_reconnects must be positive"
     exit 2
 fi
 
@@ -50,6 +68,11 @@ if [ ! -f "$BIN" ]; then
     exit 1
 fi
 
+if [ ! -x "$LOADGEN" ]; then
+    echo "Error: $LOADGEN not found. Run make loadgen."
+    exit 1
+fi
+
 if ! command -v expect >/dev/null 2>&1; then
     echo "expect not installed; skipping soak test"
     exit 0
@@ -71,8 +94,38 @@ wait_for_health() {
     return 1
 }
 
+server_rss_kb() {
+    if [ -r "/proc/$SERVER_PID/status" ]; then
+        awk '/^VmRSS:/ { print $2 }' "/proc/$SERVER_PID/status"
+    else
+        ps -o rss= -p "$SERVER_PID" 2>/dev/null | tr -d ' '
+    fi
+}
+
+# Log $1 interactive sessions in and out across RSS_WORKERS threads and
+# add the failures to CHURN_ERRORS.
+churn_interactive_sessions() {
+    "$LOADGEN" -H 127.0.0.1 -p "$PORT" -C "$1" -t "$RSS_WORKERS" \
+        >"$STATE_DIR/churn.out" 2>>"$STATE_DIR/churn.log"
+    failed=$(sed -n 's/^churned=[0-9]* failed=\([0-9]*\).*/\1/p' \
+        "$STATE_DIR/churn.out")
+    CHURN_ERRORS=$((CHURN_ERRORS + ${failed:-$1}))
+}
+
+# Print "<allocated> <reused>" for object pool $1 from stats --memory.
+pool_counters() {
+    ssh $SSH_OPTS localhost stats --memory 2>/dev/null |
+        awk -v name="$1" '$1 == "pool" && $2 == name {
+            for (i = 3; i <= NF; i++) {
+                split($i, kv, "=")
+                v[kv[1]] = kv[2]
+            }
+            print v["allocated"], v["reused"]
+        }'
+}
+
 echo "=== TNT Soak Test ==="
-echo "duration=${DURATION}s reconnects=$RECONNECTS port=$PORT"
+echo "duration=${DURATION}s reconnects=$RECONNECTS rss_reconnects=$RSS_RECONNECTS port=$PORT"
 
 TNT_LANG=zh "$BIN" \
     --bind 127.0.0.1 \
@@ -211,6 +264,81 @@ fi
 wait "$IDLE_PID" 2>/dev/null || FAIL=$((FAIL + 1))
 IDLE_PID=""
 
+# RSS over time: one warm-up batch fills the object pools and malloc
+# arenas, then ten measured batches must not keep growing the process.
+RSS_BATCH=$(( (RSS_RECONNECTS + 9) / 10 ))
+CHURN_ERRORS=0
+churn_interactive_sessions "$RSS_BATCH"
+CHURN_ERRORS=0
+POOLS="client session_context channel_callbacks"
+POOL_BASE=""
+for pool in $POOLS; do
+    POOL_BASE="$POOL_BASE $pool:$(pool_counters "$pool" | tr ' ' ':')"
+done
+RSS_BASE=$(server_rss_kb)
+RSS_MAX=${RSS_BASE:-0}
+RSS_DONE=0
+echo "rss_kb reconnects=0 rss=$RSS_BASE"
+for _ in 1 2 3 4 5 6 7 8 9 10; do
+    churn_interactive_sessions "$RSS_BATCH"
+    RSS_DONE=$((RSS_DONE + RSS_BATCH))
+    RSS_NOW=$(server_rss_kb)
+    echo "rss_kb reconnects=$RSS_DONE rss=$RSS_NOW"
+    if [ -n "$RSS_NOW" ] && [ "$RSS_NOW" -gt "$RSS_MAX" ]; then
+        RSS_MAX=$RSS_NOW
+    fi
+done
+
+if [ "$CHURN_ERRORS" -le $((RSS_DONE / 100)) ]; then
+    echo "✓ reconnect churn completed ($CHURN_ERRORS/$RSS_DONE failed)"
+    PASS=$((PASS + 1))
+else
+    echo "✗ reconnect churn failed $CHURN_ERRORS/$RSS_DONE sessions"
+    sed -n '1,40p' "$STATE_DIR/churn.log"
+    FAIL=$((FAIL + 1))
+fi
+
+# Once warm, every session should come from the pools: fresh allocations
+# are bounded by the sessions alive at once, and nearly every completed
+# login must be a reuse.
+CHURN_OK=$((RSS_DONE - CHURN_ERRORS))
+for entry in $POOL_BASE; do
+    pool=${entry%%:*}
+    base=${entry#*:}
+    base_allocated=${base%%:*}
+    base_reused=${base#*:}
+    set -- $(pool_counters "$pool")
+    if [ -z "$base_allocated" ] || [ -z "$base_reused" ] || [ $# -ne 2 ]; then
+        echo "✗ pool $pool missing from stats --memory"
+        FAIL=$((FAIL + 1))
+        continue
+    fi
+    grown=$(($1 - base_allocated))
+    reused=$(($2 - base_reused))
+    if [ "$grown" -le "$RSS_WORKERS" ] &&
+       [ "$reused" -ge $((CHURN_OK * 9 / 10)) ]; then
+        echo "✓ pool $pool reused across churn (reused=$reused allocated+=$grown)"
+        PASS=$((PASS + 1))
+    else
+        echo "✗ pool $pool not reused across churn (reused=$reused allocated+=$grown for $CHURN_OK sessions)"
+        FAIL=$((FAIL + 1))
+    fi
+done
+
+if [ -z "$RSS_BASE" ]; then
+    echo "RSS unavailable on this platform; skipping flat-memory check"
+else
+    RSS_SLACK=$((RSS_BASE / 4))
+    [ "$RSS_SLACK" -lt 8192 ] && RSS_SLACK=8192
+    if [ "$RSS_MAX" -le $((RSS_BASE + RSS_SLACK)) ]; then
+        echo "✓ RSS stayed flat across $RSS_DONE reconnects (${RSS_BASE} -> max ${RSS_MAX} KiB)"
+        PASS=$((PASS + 1))
+    else
+        echo "✗ RSS grew across reconnects (${RSS_BASE} -> max ${RSS_MAX} KiB)"
+        FAIL=$((FAIL + 1))
+    fi
+fi
+
 if kill -0 "$SERVER_PID" 2>/dev/null; then
     echo "✓ server survived soak test"
     PASS=$((PASS + 1))
@@ -1,11 +1,17 @@
 #!/bin/sh
 # Lightweight concurrent-client stress test for TNT.
 # Usage: ./test_stress.sh [num_clients] [duration_seconds]
+#
+# While the clients idle, one extra client floods the room.  The posting
+# rate limit must refuse most of it, and message delivery to other
+# interactive sessions (timed with loadgen/tnt_loadgen) must stay close to
+# a run without the flood.
 
 PORT=${PORT:-2222}
 CLIENTS=${1:-10}
 DURATION=${2:-30}
 BIN="../tnt"
+LOADGEN="loadgen/tnt_loadgen"
 PASS=0
 FAIL=0
 STATE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tnt-stress-test.XXXXXX")
@@ -31,6 +37,11 @@ if [ ! -f "$BIN" ]; then
     exit 1
 fi
 
+if [ ! -x "$LOADGEN" ]; then
+    echo "Error: $LOADGEN not found. Run make loadgen."
+    exit 1
+fi
+
 case "$CLIENTS" in
     ''|*[!0-9]*)
         echo "Error: num_clients must be a positive integer"
@@ -68,8 +79,11 @@ wait_for_health() {
 echo "=== TNT Stress Test ==="
 echo "clients=$CLIENTS duration=${DURATION}s port=$PORT"
 
-MAX_CONN_PER_IP=$((CLIENTS + 5))
+MAX_CONN_PER_IP=$((CLIENTS + 16))
+# All sessions share 127.0.0.1, so only the per-user posting bucket is on;
+# a per-IP bucket would throttle the latency sessions along with the flood.
 TNT_LANG=zh TNT_RATE_LIMIT=0 TNT_MAX_CONN_PER_IP=$MAX_CONN_PER_IP \
+    TNT_POST_IP_RATE=0 \
     "$BIN" -p "$PORT" -d "$STATE_DIR" >"$STATE_DIR/server.log" 2>&1 &
 SERVER_PID=$!
 
@@ -94,6 +108,10 @@ expect "请输入用户名"
 send -- "stress$i\r"
 exec touch "$ready"
 sleep $DURATION
+# Stay until the flood and latency checks below have read their stats.
+while {![file exists "$STATE_DIR/checks.done"]} {
+    sleep 1
+}
 send -- "\003"
 expect eof
 EOF
@@ -121,6 +139,155 @@ else
     FAIL=$((FAIL + 1))
 fi
 
+# Delivery latency seen by interactive sessions: loadgen/tnt_loadgen posts
+# markers from LATENCY_CLIENTS PTY sessions and times their arrival in the
+# others' frames.  One run without a flood sets the baseline; the second
+# runs while a client floods the room, and its p99 must stay within
+# 2 x baseline + FLOOD_SLACK_MS.
+LATENCY_CLIENTS=${LATENCY_CLIENTS:-4}
+LATENCY_SECONDS=${LATENCY_SECONDS:-5}
+FLOOD_SLACK_MS=${FLOOD_SLACK_MS:-50}
+
+run_latency() {
+    "$LOADGEN" -H 127.0.0.1 -p "$PORT" -c "$LATENCY_CLIENTS" \
+        -d "$LATENCY_SECONDS" -r 2 -t 1 >"$1" 2>&1
+}
+
+# latency_field FILE LINE KEY: value of KEY=... on the line starting LINE.
+latency_field() {
+    awk -v line="$2" -v key="$3" '$1 == line || index($1, line "=") == 1 {
+        for (i = 1; i <= NF; i++) {
+            if (index($i, key "=") == 1) {
+                print substr($i, length(key) + 2)
+            }
+        }
+    }' "$1"
+}
+
+run_latency "$STATE_DIR/latency-base.txt"
+BASE_P99=$(latency_field "$STATE_DIR/latency-base.txt" delivery_ms p99)
+
+# The flooder sends as fast as its pty allows until the second latency run
+# is over; the posting token bucket should refuse most of it.
+flood_script="$STATE_DIR/flooder.expect"
+cat >"$flood_script" <<EOF
+log_user 0
+set timeout 30
+spawn ssh -o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -p $PORT flooder@localhost
+expect "请输入用户名"
+send -- "flooder\r"
+set i 0
+exec touch "$STATE_DIR/flooder.started"
+while {![file exists "$STATE_DIR/flood.stop"]} {
+    for {set j 0} {\$j < 20} {incr j} {
+        send -- "flood \$i\r"
+        incr i
+    }
+    expect -timeout 0 -re {.+} {exp_continue} timeout {}
+    after 5
+}
+exec echo \$i > "$STATE_DIR/flooder.sent"
+send -- "\003"
+expect eof
+EOF
+expect "$flood_script" >"$STATE_DIR/flooder.log" 2>&1 &
+FLOOD_PID=$!
+CLIENT_PIDS="$CLIENT_PIDS $FLOOD_PID"
+
+for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15; do
+    [ -f "$STATE_DIR/flooder.started" ] && break
+    sleep 1
+done
+# Let the flooder spend its burst so the run sees the throttled steady state.
+sleep 2
+
+run_latency "$STATE_DIR/latency-flood.txt"
+touch "$STATE_DIR/flood.stop"
+FLOOD_P99=$(latency_field "$STATE_DIR/latency-flood.txt" delivery_ms p99)
+FLOOD_POSTED=$(latency_field "$STATE_DIR/latency-flood.txt" posted posted)
+FLOOD_DELIVERED=$(latency_field "$STATE_DIR/latency-flood.txt" posted deliveries)
+FLOOD_EXPECTED=$(latency_field "$STATE_DIR/latency-flood.txt" posted expected)
+
+if [ -z "$BASE_P99" ] || [ -z "$FLOOD_P99" ]; then
+    echo "✗ latency runs did not report delivery_ms"
+    cat "$STATE_DIR/latency-base.txt" "$STATE_DIR/latency-flood.txt"
+    FAIL=$((FAIL + 1))
+elif [ "${FLOOD_POSTED:-0}" -eq 0 ] ||
+     [ "$FLOOD_DELIVERED" != "$FLOOD_EXPECTED" ]; then
+    echo "✗ markers lost during flood ($FLOOD_DELIVERED of $FLOOD_EXPECTED delivered)"
+    cat "$STATE_DIR/latency-flood.txt"
+    FAIL=$((FAIL + 1))
+elif awk -v base="$BASE_P99" -v flood="$FLOOD_P99" -v slack="$FLOOD_SLACK_MS" \
+         'BEGIN { exit !(flood <= 2 * base + slack) }'; then
+    echo "✓ delivery p99 during flood ${FLOOD_P99}ms (baseline ${BASE_P99}ms)"
+    PASS=$((PASS + 1))
+else
+    echo "✗ delivery p99 during flood ${FLOOD_P99}ms exceeds 2 x ${BASE_P99}ms + ${FLOOD_SLACK_MS}ms"
+    cat "$STATE_DIR/latency-base.txt" "$STATE_DIR/latency-flood.txt"
+    FAIL=$((FAIL + 1))
+fi
+
+# Wait for the flooder to report how many lines it sent.
+for _ in 1 2 3 4 5 6 7 8 9 10; do
+    [ -f "$STATE_DIR/flooder.sent" ] && break
+    sleep 1
+done
+FLOOD_SENT=$(cat "$STATE_DIR/flooder.sent" 2>/dev/null || echo "?")
+
+THROTTLED=$(ssh -n $SSH_OPTS localhost stats 2>/dev/null |
+    awk '$1 == "posts_throttled_public" { print $2 }')
+case "$THROTTLED" in
+    ''|*[!0-9]*|0)
+        echo "✗ flood was not throttled (posts_throttled_public=$THROTTLED)"
+        FAIL=$((FAIL + 1))
+        ;;
+    *)
+        echo "✓ flood throttled ($THROTTLED of $FLOOD_SENT posts refused)"
+        PASS=$((PASS + 1))
+        ;;
+esac
+
+# The idle clients received the flood, so delivery latency was recorded.
+LATENCY=$(ssh -n $SSH_OPTS localhost stats --latency 2>/dev/null || true)
+ENQUEUED=$(printf '%s\n' "$LATENCY" |
+    awk '$1 == "delivery_enqueue_us" { print $3 }')
+case "$ENQUEUED" in
+    ''|*[!0-9]*|0)
+        echo "✗ no delivery latency recorded"
+        printf '%s\n' "$LATENCY"
+        FAIL=$((FAIL + 1))
+        ;;
+    *)
+        if printf '%s\n' "$LATENCY" |
+           grep -Eq '^client stress1 .* worst_delivery_us=[1-9]'; then
+            echo "✓ delivery latency recorded ($ENQUEUED frame deliveries)"
+            PASS=$((PASS + 1))
+        else
+            echo "✗ per-client worst delivery latency missing"
+            printf '%s\n' "$LATENCY"
+            FAIL=$((FAIL + 1))
+        fi
+        ;;
+esac
+
+# Every idle client has been sent frames; the top three are listed.
+SESSIONS=$(ssh -n $SSH_OPTS localhost sessions 3 --net 2>/dev/null || true)
+SESSION_LINES=$(printf '%s\n' "$SESSIONS" | grep -c '^session ' || true)
+if [ "$CLIENTS" -ge 3 ] && [ "$SESSION_LINES" -eq 3 ] &&
+   printf '%s\n' "$SESSIONS" |
+   grep -Eq '^session [a-z0-9]+ [0-9a-f.:]+ age_s=[0-9]+ cpu_us=[0-9]+ bytes_received=[1-9][0-9]* bytes_sent=[1-9]'; then
+    echo "✓ sessions ranks clients by traffic"
+    PASS=$((PASS + 1))
+elif [ "$CLIENTS" -lt 3 ]; then
+    echo "✓ sessions check skipped for fewer than 3 clients"
+    PASS=$((PASS + 1))
+else
+    echo "✗ sessions output unexpected"
+    printf '%s\n' "$SESSIONS"
+    FAIL=$((FAIL + 1))
+fi
+
+touch "$STATE_DIR/checks.done"
 for pid in $CLIENT_PIDS; do
     wait "$pid" 2>/dev/null || FAIL=$((FAIL + 1))
 done
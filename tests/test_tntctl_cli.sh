@@ -167,6 +167,68 @@ else
     FAIL=$((FAIL + 1))
 fi
 
+rm -f "$SSH_LOG"
+PATH="$FAKE_BIN:$PATH" TNTCTL_SSH_LOG="$SSH_LOG" "$BIN" --local -d "$STATE_DIR" health >/dev/null 2>&1
+LOCAL_STATUS=$?
+if [ "$LOCAL_STATUS" -eq 69 ] && [ ! -f "$SSH_LOG" ]; then
+    echo "✓ --local without a control socket is unavailable, ssh not used"
+    PASS=$((PASS + 1))
+else
+    echo "✗ --local without a control socket: exit $LOCAL_STATUS"
+    [ -f "$SSH_LOG" ] && echo "fake ssh was invoked"
+    FAIL=$((FAIL + 1))
+fi
+
+if command -v python3 >/dev/null 2>&1; then
+    # Stub control socket: records the request and answers with status 0
+    cat >"$STATE_DIR/control.py" <<'STUB'
+import socket
+import sys
+
+path = sys.argv[1]
+srv = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+srv.bind(path)
+srv.listen(1)
+open(path + ".ready", "w").close()
+conn, _ = srv.accept()
+data = b""
+while data.count(b"\n") < 2:
+    chunk = conn.recv(4096)
+    if not chunk:
+        break
+    data += chunk
+with open(sys.argv[2], "wb") as f:
+    f.write(data)
+conn.sendall(b"0\nstub-ok\n")
+conn.close()
+STUB
+    python3 "$STATE_DIR/control.py" "$STATE_DIR/control.sock" \
+        "$STATE_DIR/control.req" &
+    STUB_PID=$!
+    for _ in 1 2 3 4 5 6 7 8 9 10; do
+        [ -f "$STATE_DIR/control.sock.ready" ] && break
+        sleep 0.2
+    done
+    rm -f "$SSH_LOG"
+    LOCAL_OUT=$(PATH="$FAKE_BIN:$PATH" TNTCTL_SSH_LOG="$SSH_LOG" "$BIN" --local -d "$STATE_DIR" -l operator dump -n 1 2>&1)
+    LOCAL_STATUS=$?
+    wait "$STUB_PID" 2>/dev/null || true
+    if [ "$LOCAL_STATUS" -eq 0 ] && [ "$LOCAL_OUT" = "stub-ok" ] &&
+       [ ! -f "$SSH_LOG" ] &&
+       [ "$(cat "$STATE_DIR/control.req")" = "TNT-CONTROL 1 operator
+dump -n 1" ]; then
+        echo "✓ --local sends login and command over control.sock"
+        PASS=$((PASS + 1))
+    else
+        echo "✗ --local request unexpected (exit $LOCAL_STATUS): $LOCAL_OUT"
+        cat "$STATE_DIR/control.req" 2>/dev/null
+        FAIL=$((FAIL + 1))
+    fi
+else
+    echo "python3 not installed; skipping --local round trip"
+fi
+
+run_usage "rejects unknown command in --local mode" "$BIN" --local localhost health
 run_usage "rejects login starting with dash" "$BIN" -l -V example.com health
 run_usage "rejects host starting with dash" "$BIN" -bad health
 run_usage "rejects unknown command locally" "$BIN" example.com 'health;id'
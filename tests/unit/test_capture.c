@@ -0,0 +1,286 @@
+/* Unit tests for session input capture */
+
+#include "../../include/capture.h"
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+
+static void anonymize(capture_session_t *session, client_mode_t mode,
+                      char *text) {
+    capture_anonymize(session, mode, (unsigned char *)text, strlen(text));
+}
+
+/* Same character classes over the length of `orig`. */
+static void assert_same_shape(const char *orig, const char *anon) {
+    assert(strlen(anon) >= strlen(orig));
+    for (size_t i = 0; orig[i]; i++) {
+        unsigned char a = (unsigned char)orig[i];
+        unsigned char b = (unsigned char)anon[i];
+
+        if (a >= 'a' && a <= 'z') assert(b >= 'a' && b <= 'z');
+        else if (a >= 'A' && a <= 'Z') assert(b >= 'A' && b <= 'Z');
+        else if (a >= '0' && a <= '9') assert(b >= '0' && b <= '9');
+        else if (a < 0x80) assert(a == b);
+    }
+}
+
+/* Find the single capture file in `dir`. */
+static void capture_file_in(const char *dir, char *path, size_t size) {
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+    int found = 0;
+
+    assert(d);
+    while ((entry = readdir(d)) != NULL) {
+        if (strncmp(entry->d_name, "capture-", 8) == 0) {
+            snprintf(path, size, "%s/%s", dir, entry->d_name);
+            found++;
+        }
+    }
+    closedir(d);
+    assert(found == 1);
+}
+
+TEST(insert_text_keeps_shape_not_words) {
+    capture_session_t session = {.rng = 42};
+    const char *orig = "Hello, World 2024! ok?";
+    char text[64];
+    char cjk[] = "\xe4\xbd\xa0\xe5\xa5\xbd\xc3\xbc\xf0\x9f\x8e\x89";
+
+    strcpy(text, orig);
+    anonymize(&session, MODE_INSERT, text);
+    assert(strlen(text) == strlen(orig));
+    assert_same_shape(orig, text);
+    assert(strcmp(orig, text) != 0);
+
+    /* 你好 ü 🎉 -> fixed characters of the same byte lengths */
+    anonymize(&session, MODE_INSERT, cjk);
+    assert(strcmp(cjk, "\xe4\xb8\xad\xe4\xb8\xad\xc3\xa9\xf0\x9f\x98\x80")
+           == 0);
+}
+
+TEST(escape_sequences_pass_through) {
+    capture_session_t session = {.rng = 7};
+    char keys[] = "\033[A\033OB\033[1;5C\033x";
+    char paste[] = "\033[200~abc\r\ndef\033[201~";
+
+    anonymize(&session, MODE_INSERT, keys);
+    assert(strcmp(keys, "\033[A\033OB\033[1;5C\033x") == 0);
+
+    anonymize(&session, MODE_INSERT, paste);
+    assert(strncmp(paste, "\033[200~", 6) == 0);
+    assert(strcmp(paste + strlen(paste) - 6, "\033[201~") == 0);
+    assert_same_shape("abc\r\ndef", paste + 6);
+    assert(strncmp(paste + 6, "abc", 3) != 0 ||
+           strncmp(paste + 11, "def", 3) != 0);
+
+    /* A sequence split across reads */
+    char head[] = "\033[";
+    char tail[] = "Bq";
+    anonymize(&session, MODE_INSERT, head);
+    anonymize(&session, MODE_INSERT, tail);
+    assert(tail[0] == 'B');
+    assert(tail[1] >= 'a' && tail[1] <= 'z');
+}
+
+TEST(commands_keep_name_hide_arguments) {
+    capture_session_t session = {.rng = 9};
+    char colon[] = ":";
+    char command[] = "nick alice";
+    char key[] = "j";
+
+    anonymize(&session, MODE_NORMAL, colon);
+    assert(strcmp(colon, ":") == 0);
+    anonymize(&session, MODE_COMMAND, command);
+    assert(strncmp(command, "nick ", 5) == 0);
+    assert(strlen(command) == 10);
+    assert_same_shape("alice", command + 5);
+
+    anonymize(&session, MODE_NORMAL, key);
+    assert(strcmp(key, "j") == 0);
+
+    /* The next command starts over at its name */
+    char next[] = "help";
+    anonymize(&session, MODE_COMMAND, next);
+    assert(strcmp(next, "help") == 0);
+
+    /* Mode switches inside one read */
+    char pasted[] = "j:nick bob\rk/word";
+    anonymize(&session, MODE_NORMAL, pasted);
+    assert(strlen(pasted) == 17);
+    assert(strncmp(pasted, "j:nick ", 7) == 0);
+    assert_same_shape("bob\rk/word", pasted + 7);
+    assert(strncmp(pasted + 10, "\rk/", 3) == 0);
+}
+
+TEST(disabled_by_default) {
+    capture_session_t session;
+
+    unsetenv("TNT_CAPTURE");
+    assert(capture_init() == 0);
+    assert(!capture_active());
+    capture_session_open(&session, 80, 24);
+    assert(session.id == 0);
+    capture_session_input(&session, MODE_INSERT, "x", 1);
+    capture_session_close(&session);
+}
+
+TEST(file_round_trip) {
+    char dir[] = "/tmp/tnt-capture-test.XXXXXX";
+    char path[512];
+    capture_session_t session;
+    capture_reader_t reader;
+    capture_record_t rec;
+    FILE *fp;
+
+    assert(mkdtemp(dir));
+    setenv("TNT_STATE_DIR", dir, 1);
+    setenv("TNT_CAPTURE", "1", 1);
+    assert(capture_init() == 0);
+    assert(capture_active());
+
+    capture_session_open(&session, 80, 24);
+    assert(session.id == 1);
+    capture_session_input(&session, MODE_INSERT, "hello", 5);
+    capture_session_resize(&session, 120, 40);
+    capture_session_input(&session, MODE_NORMAL, "j", 1);
+    capture_session_close(&session);
+    capture_shutdown();
+    assert(!capture_active());
+
+    capture_file_in(dir, path, sizeof(path));
+    fp = fopen(path, "rb");
+    assert(fp);
+    assert(capture_reader_open(&reader, fp) == 0);
+
+    assert(capture_reader_next(&reader, &rec) == 1);
+    assert(rec.type == CAPTURE_REC_OPEN && rec.session == 1);
+    assert(rec.width == 80 && rec.height == 24);
+
+    assert(capture_reader_next(&reader, &rec) == 1);
+    assert(rec.type == CAPTURE_REC_INPUT && rec.len == 5);
+    for (size_t i = 0; i < rec.len; i++) {
+        assert(rec.data[i] >= 'a' && rec.data[i] <= 'z');
+    }
+
+    assert(capture_reader_next(&reader, &rec) == 1);
+    assert(rec.type == CAPTURE_REC_RESIZE);
+    assert(rec.width == 120 && rec.height == 40);
+
+    assert(capture_reader_next(&reader, &rec) == 1);
+    assert(rec.type == CAPTURE_REC_INPUT && rec.len == 1);
+    assert(rec.data[0] == 'j');
+
+    assert(capture_reader_next(&reader, &rec) == 1);
+    assert(rec.type == CAPTURE_REC_CLOSE && rec.session == 1);
+    assert(capture_reader_next(&reader, &rec) == 0);
+    fclose(fp);
+
+    unlink(path);
+    rmdir(dir);
+    unsetenv("TNT_CAPTURE");
+    unsetenv("TNT_STATE_DIR");
+}
+
+TEST(size_limit_stops_capture) {
+    char dir[] = "/tmp/tnt-capture-test.XXXXXX";
+    char path[512];
+    char keys[4096];
+    capture_session_t session;
+    FILE *fp;
+    long size;
+
+    assert(mkdtemp(dir));
+    setenv("TNT_STATE_DIR", dir, 1);
+    setenv("TNT_CAPTURE", "1", 1);
+    setenv("TNT_CAPTURE_MAX_MB", "1", 1);
+    assert(capture_init() == 0);
+
+    memset(keys, 'j', sizeof(keys));
+    capture_session_open(&session, 80, 24);
+    for (int i = 0; i < 300 && capture_active(); i++) {
+        capture_session_input(&session, MODE_NORMAL, keys, sizeof(keys));
+    }
+    assert(!capture_active());
+
+    /* Sessions opened afterwards are not captured */
+    capture_session_t late;
+    capture_session_open(&late, 80, 24);
+    assert(late.id == 0);
+    capture_session_close(&session);
+    capture_shutdown();
+
+    capture_file_in(dir, path, sizeof(path));
+    fp = fopen(path, "rb");
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+    assert(size > (1L << 20) - 4096 && size <= (1L << 20));
+
+    unlink(path);
+    rmdir(dir);
+    unsetenv("TNT_CAPTURE");
+    unsetenv("TNT_CAPTURE_MAX_MB");
+    unsetenv("TNT_STATE_DIR");
+}
+
+TEST(reader_rejects_bad_input) {
+    capture_reader_t reader;
+    capture_record_t rec;
+    FILE *fp = tmpfile();
+
+    assert(fp);
+    fputs("NOTCAPT\n", fp);
+    rewind(fp);
+    assert(capture_reader_open(&reader, fp) < 0);
+    fclose(fp);
+
+    /* An INPUT record that promises more bytes than follow */
+    fp = tmpfile();
+    assert(fp);
+    fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, fp);
+    fwrite("\x02\x01\x00\x05" "ab", 1, 6, fp);
+    rewind(fp);
+    assert(capture_reader_open(&reader, fp) == 0);
+    assert(capture_reader_next(&reader, &rec) < 0);
+    fclose(fp);
+
+    /* Unknown record type */
+    fp = tmpfile();
+    assert(fp);
+    fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, fp);
+    fwrite("\x09\x01\x00", 1, 3, fp);
+    rewind(fp);
+    assert(capture_reader_open(&reader, fp) == 0);
+    assert(capture_reader_next(&reader, &rec) < 0);
+    fclose(fp);
+}
+
+int main(void) {
+    printf("Running capture unit tests...\n\n");
+
+    RUN_TEST(insert_text_keeps_shape_not_words);
+    RUN_TEST(escape_sequences_pass_through);
+    RUN_TEST(commands_keep_name_hide_arguments);
+    RUN_TEST(disabled_by_default);
+    RUN_TEST(file_round_trip);
+    RUN_TEST(size_limit_stops_capture);
+    RUN_TEST(reader_rejects_bad_input);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
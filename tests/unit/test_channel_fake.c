@@ -0,0 +1,207 @@
+/* Unit tests for the in-memory channel backend */
+
+#include "../../include/channel_fake.h"
+#include "../../include/timer_wheel.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+
+typedef struct {
+    int calls;
+    uint64_t step_ms;                /* Virtual time per yield */
+    const char *feed;                /* Input to deliver on the first yield */
+} yield_probe_t;
+
+static void probe_yield(tnt_fake_channel_t *fake, void *arg) {
+    yield_probe_t *probe = arg;
+    tnt_timer_wheel_t *wheel = tnt_timer_service();
+
+    probe->calls++;
+    if (wheel && probe->step_ms > 0) {
+        tnt_timer_wheel_advance(wheel,
+                                tnt_timer_wheel_now_ms(wheel) + probe->step_ms);
+    }
+    if (probe->feed) {
+        tnt_fake_channel_feed(fake, probe->feed, strlen(probe->feed));
+        probe->feed = NULL;
+    }
+}
+
+TEST(feed_then_read_in_order) {
+    tnt_fake_channel_t fake;
+    tnt_channel_t channel;
+    char buf[8];
+
+    assert(tnt_fake_channel_init(&fake, 1024, 0) == 0);
+    tnt_channel_use_fake(&channel, &fake);
+
+    assert(tnt_channel_poll_timeout(&channel, 250) == 0);
+    assert(tnt_channel_read_timeout(&channel, buf, sizeof(buf), 0) ==
+           TNT_CHANNEL_AGAIN);
+
+    assert(tnt_fake_channel_feed(&fake, "hello", 5) == 0);
+    assert(tnt_channel_poll_timeout(&channel, 250) == 5);
+    assert(tnt_channel_read(&channel, buf, 2) == 2);
+    assert(memcmp(buf, "he", 2) == 0);
+    assert(tnt_fake_channel_feed(&fake, "!", 1) == 0);
+    assert(tnt_fake_channel_pending(&fake) == 4);
+    assert(tnt_channel_read(&channel, buf, sizeof(buf)) == 4);
+    assert(memcmp(buf, "llo!", 4) == 0);
+    assert(tnt_fake_channel_pending(&fake) == 0);
+
+    tnt_fake_channel_destroy(&fake);
+}
+
+TEST(writes_stop_at_window_until_acked) {
+    tnt_fake_channel_t fake;
+    tnt_channel_t channel;
+
+    assert(tnt_fake_channel_init(&fake, 10, 0) == 0);
+    tnt_channel_use_fake(&channel, &fake);
+
+    assert(tnt_channel_window_size(&channel) == 10);
+    assert(tnt_channel_write(&channel, "abcdef", 6) == 6);
+    assert(tnt_channel_write(&channel, "ghijkl", 6) == 4);
+    assert(tnt_channel_window_size(&channel) == 0);
+    assert(tnt_channel_write(&channel, "m", 1) == 0);
+
+    tnt_fake_channel_ack(&fake, 3);
+    assert(tnt_channel_window_size(&channel) == 3);
+    tnt_fake_channel_ack(&fake, 100);
+    assert(tnt_channel_window_size(&channel) == 10);
+
+    assert(fake.bytes_written == 10);
+    assert(fake.writes == 3);
+    tnt_fake_channel_destroy(&fake);
+}
+
+TEST(capture_keeps_newest_output) {
+    tnt_fake_channel_t fake;
+    tnt_channel_t channel;
+    char out[16];
+
+    assert(tnt_fake_channel_init(&fake, 1024, 8) == 0);
+    tnt_channel_use_fake(&channel, &fake);
+
+    assert(tnt_channel_write(&channel, "abc", 3) == 3);
+    assert(tnt_fake_channel_captured(&fake, out, sizeof(out)) == 3);
+    assert(strcmp(out, "abc") == 0);
+
+    assert(tnt_channel_write(&channel, "defghij", 7) == 7);
+    assert(tnt_fake_channel_captured(&fake, out, sizeof(out)) == 8);
+    assert(strcmp(out, "cdefghij") == 0);
+
+    assert(tnt_channel_write(&channel, "0123456789", 10) == 10);
+    assert(tnt_fake_channel_captured(&fake, out, sizeof(out)) == 8);
+    assert(strcmp(out, "23456789") == 0);
+
+    assert(tnt_fake_channel_captured(&fake, out, 4) == 3);
+    assert(strcmp(out, "789") == 0);
+    tnt_fake_channel_destroy(&fake);
+}
+
+TEST(idle_poll_yields_on_second_call) {
+    tnt_fake_channel_t fake;
+    tnt_channel_t channel;
+    yield_probe_t probe = {0};
+
+    assert(tnt_fake_channel_init(&fake, 1024, 0) == 0);
+    tnt_channel_use_fake(&channel, &fake);
+    tnt_fake_channel_set_yield(&fake, probe_yield, &probe);
+
+    /* One idle pass per turn, then hand the turn back */
+    assert(tnt_channel_poll_timeout(&channel, 250) == 0);
+    assert(probe.calls == 0);
+    assert(tnt_channel_poll_timeout(&channel, 250) == 0);
+    assert(probe.calls == 1);
+    assert(tnt_channel_poll_timeout(&channel, 250) == 0);
+    assert(probe.calls == 2);
+
+    /* Input that arrives during the yield is reported straight away */
+    probe.feed = "x";
+    assert(tnt_channel_poll_timeout(&channel, 250) == 1);
+    assert(probe.calls == 3);
+
+    tnt_fake_channel_destroy(&fake);
+}
+
+TEST(read_timeout_follows_virtual_clock) {
+    tnt_fake_channel_t fake;
+    tnt_channel_t channel;
+    yield_probe_t probe = {.step_ms = 50};
+    char buf[4];
+
+    assert(tnt_timer_service_start_manual(0) == 0);
+    assert(tnt_fake_channel_init(&fake, 1024, 0) == 0);
+    tnt_channel_use_fake(&channel, &fake);
+    tnt_fake_channel_set_yield(&fake, probe_yield, &probe);
+
+    assert(tnt_channel_read_timeout(&channel, buf, 1, 200) ==
+           TNT_CHANNEL_AGAIN);
+    assert(probe.calls == 4);
+    assert(tnt_timer_wheel_now_ms(tnt_timer_service()) == 200);
+
+    probe.feed = "y";
+    assert(tnt_channel_read_timeout(&channel, buf, 1, 60000) == 1);
+    assert(buf[0] == 'y');
+    assert(probe.calls == 5);
+
+    tnt_fake_channel_destroy(&fake);
+    tnt_timer_service_stop();
+}
+
+TEST(hangup_and_close_end_the_stream) {
+    tnt_fake_channel_t fake;
+    tnt_channel_t channel;
+    char buf[4];
+
+    assert(tnt_fake_channel_init(&fake, 1024, 0) == 0);
+    tnt_channel_use_fake(&channel, &fake);
+    assert(tnt_channel_is_open(&channel));
+    assert(tnt_channel_keepalive(&channel) == 0);
+
+    /* Pending input is still readable after a hangup */
+    assert(tnt_fake_channel_feed(&fake, "z", 1) == 0);
+    tnt_fake_channel_hangup(&fake);
+    assert(!tnt_channel_is_open(&channel));
+    assert(tnt_channel_poll_timeout(&channel, 0) == TNT_CHANNEL_ERROR);
+    assert(tnt_channel_read(&channel, buf, sizeof(buf)) == 1);
+    assert(tnt_channel_read(&channel, buf, sizeof(buf)) == 0);
+    assert(tnt_channel_write(&channel, "a", 1) == TNT_CHANNEL_ERROR);
+    assert(tnt_channel_window_size(&channel) == 0);
+    assert(tnt_channel_keepalive(&channel) != 0);
+    assert(fake.keepalives == 2);
+    tnt_fake_channel_destroy(&fake);
+
+    assert(tnt_fake_channel_init(&fake, 1024, 0) == 0);
+    tnt_channel_use_fake(&channel, &fake);
+    tnt_channel_close(&channel);
+    assert(channel.ops == NULL);
+    assert(!tnt_channel_is_open(&channel));
+    assert(!tnt_fake_channel_is_open(&fake));
+    tnt_fake_channel_destroy(&fake);
+}
+
+int main(void) {
+    printf("Running fake channel tests...\n\n");
+
+    RUN_TEST(feed_then_read_in_order);
+    RUN_TEST(writes_stop_at_window_until_acked);
+    RUN_TEST(capture_keeps_newest_output);
+    RUN_TEST(idle_poll_yields_on_second_call);
+    RUN_TEST(read_timeout_follows_virtual_clock);
+    RUN_TEST(hangup_and_close_end_the_stream);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
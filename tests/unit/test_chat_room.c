@@ -91,6 +91,35 @@ TEST(room_broadcast_increments_seq) {
     room_destroy(room);
 }
 
+TEST(room_broadcast_stamps_follow_seq) {
+    chat_room_t *room = room_create();
+    uint64_t stamps[ROOM_BROADCAST_STAMPS];
+    uint64_t base = room_get_update_seq(room);
+    message_t msg = make_msg("bob", "hi");
+    int count;
+
+    for (int i = 0; i < 3; i++) {
+        room_broadcast(room, &msg);
+    }
+    count = room_broadcast_stamps(room, base, base + 3, stamps,
+                                  ROOM_BROADCAST_STAMPS);
+    assert(count == 3);
+    assert(stamps[0] > 0 && stamps[0] <= stamps[1] && stamps[1] <= stamps[2]);
+    assert(room_broadcast_stamps(room, base + 1, base + 3, stamps, 1) == 1);
+    assert(room_broadcast_stamps(room, base + 3, base + 3, stamps,
+                                 ROOM_BROADCAST_STAMPS) == 0);
+
+    /* Only the newest ROOM_BROADCAST_STAMPS updates keep a stamp */
+    for (int i = 0; i < ROOM_BROADCAST_STAMPS + 10; i++) {
+        room_broadcast(room, &msg);
+    }
+    count = room_broadcast_stamps(room, base, room_get_update_seq(room),
+                                  stamps, ROOM_BROADCAST_STAMPS);
+    assert(count == ROOM_BROADCAST_STAMPS);
+
+    room_destroy(room);
+}
+
 TEST(room_get_message_valid) {
     chat_room_t *room = room_create();
     message_t msg = make_msg("carol", "test");
@@ -125,6 +154,31 @@ TEST(room_get_message_null_args) {
     room_destroy(room);
 }
 
+static void count_wake(client_t *client) {
+    client->dummy++;
+}
+
+TEST(room_broadcast_wakes_members) {
+    chat_room_t *room = room_create();
+    client_t c1 = {0};
+    client_t c2 = {0};
+    message_t m = make_msg("alice", "hi");
+
+    room_broadcast(room, &m);
+    room->wake_client = count_wake;
+    assert(room_add_client(room, &c1) == 0);
+    assert(room_add_client(room, &c2) == 0);
+    room_broadcast(room, &m);
+    room_broadcast(room, &m);
+    assert(c1.dummy == 2 && c2.dummy == 2);
+
+    room_remove_client(room, &c1);
+    room_broadcast(room, &m);
+    assert(c1.dummy == 2 && c2.dummy == 3);
+    room_remove_client(room, &c2);
+    room_destroy(room);
+}
+
 TEST(room_client_count) {
     chat_room_t *room = room_create();
     assert(room_get_client_count(room) == 0);
@@ -213,9 +267,11 @@ int main(void) {
     RUN_TEST(room_add_message_single);
     RUN_TEST(room_add_message_overflow);
     RUN_TEST(room_broadcast_increments_seq);
+    RUN_TEST(room_broadcast_stamps_follow_seq);
     RUN_TEST(room_get_message_valid);
     RUN_TEST(room_get_message_invalid_index);
     RUN_TEST(room_get_message_null_args);
+    RUN_TEST(room_broadcast_wakes_members);
     RUN_TEST(room_client_count);
     RUN_TEST(room_remove_nonexistent_client);
     RUN_TEST(room_add_client_full);
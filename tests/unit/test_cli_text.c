@@ -16,7 +16,7 @@
 static int tests_passed = 0;
 
 TEST(help_matches_language) {
-    char output[2048] = {0};
+    char output[4096] = {0};
     size_t pos = 0;
 
     cli_text_append_help(output, sizeof(output), &pos, "tnt", UI_LANG_EN);
@@ -26,6 +26,8 @@ TEST(help_matches_language) {
     assert(strstr(output, "--max-connections N") != NULL);
     assert(strstr(output, "--log-check FILE") != NULL);
     assert(strstr(output, "--log-recover FILE") != NULL);
+    assert(strstr(output, "--host-keys LIST") != NULL);
+    assert(strstr(output, "--ssh-profile NAME") != NULL);
     assert(strstr(output, "TNT_LANG") != NULL);
 
     memset(output, 0, sizeof(output));
@@ -41,6 +43,11 @@ TEST(help_matches_language) {
     assert(strstr(output, "[选项]") == NULL);
     assert(strstr(output, "--public-host HOST") != NULL);
     assert(strstr(output, "--idle-timeout SECONDS") != NULL);
+    assert(strstr(output, "--session-stack-kb KB") != NULL);
+    assert(strstr(output, "--acceptors N") != NULL);
+    assert(strstr(output, "--takeover") != NULL);
+    assert(strstr(output, "--control-socket") != NULL);
+    assert(strstr(output, "--metrics-listen ADDR") != NULL);
     assert(strstr(output, "--log-check FILE") != NULL);
     assert(strstr(output, "TNT_LANG") != NULL);
 }
@@ -39,6 +39,36 @@ TEST(parse_uses_spec_ranges) {
     assert(tnt_config_parse_int("0", &TNT_CONFIG_IDLE_TIMEOUT, &out));
     assert(out == 0);
     assert(!tnt_config_parse_int("86401", &TNT_CONFIG_IDLE_TIMEOUT, &out));
+
+    /* Handshake deadlines cannot be disabled */
+    assert(!tnt_config_parse_int("0", &TNT_CONFIG_KEX_TIMEOUT, &out));
+    assert(tnt_config_parse_int("600", &TNT_CONFIG_AUTH_TIMEOUT, &out));
+    assert(!tnt_config_parse_int("601", &TNT_CONFIG_CHANNEL_TIMEOUT, &out));
+    assert(!tnt_config_parse_int("0", &TNT_CONFIG_MAX_PENDING_HANDSHAKES,
+                                 &out));
+
+    /* Prefixes stay within the address family */
+    assert(tnt_config_parse_int("24", &TNT_CONFIG_RATE_LIMIT_V4_PREFIX, &out));
+    assert(!tnt_config_parse_int("33", &TNT_CONFIG_RATE_LIMIT_V4_PREFIX,
+                                 &out));
+    assert(tnt_config_parse_int("64", &TNT_CONFIG_RATE_LIMIT_V6_PREFIX, &out));
+    assert(!tnt_config_parse_int("129", &TNT_CONFIG_RATE_LIMIT_V6_PREFIX,
+                                 &out));
+    assert(!tnt_config_parse_int("255", &TNT_CONFIG_RATE_LIMIT_TABLE_SIZE,
+                                 &out));
+
+    /* Posting rates can be switched off; bursts cannot */
+    assert(tnt_config_parse_int("0", &TNT_CONFIG_POST_RATE, &out));
+    assert(tnt_config_parse_int("0", &TNT_CONFIG_POST_IP_RATE, &out));
+    assert(!tnt_config_parse_int("0", &TNT_CONFIG_POST_BURST, &out));
+    assert(!tnt_config_parse_int("10001", &TNT_CONFIG_POST_IP_BURST, &out));
+
+    assert(tnt_config_parse_int("1", &TNT_CONFIG_LOCK_PROFILE, &out));
+    assert(!tnt_config_parse_int("2", &TNT_CONFIG_LOCK_PROFILE, &out));
+
+    assert(tnt_config_parse_int("1", &TNT_CONFIG_CAPTURE, &out));
+    assert(!tnt_config_parse_int("2", &TNT_CONFIG_CAPTURE, &out));
+    assert(!tnt_config_parse_int("0", &TNT_CONFIG_CAPTURE_MAX_MB, &out));
 }
 
 TEST(env_reader_uses_fallback_and_range) {
@@ -0,0 +1,198 @@
+/* Unit tests for the local control socket protocol */
+
+#include "../../include/control.h"
+#include "../../include/unix_socket.h"
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+#define BIG_OUTPUT_LEN 100000
+
+static int tests_passed = 0;
+static char socket_path[256];
+
+/* "echo ARGS" writes back "LOGIN ARGS\n"; "big" writes BIG_OUTPUT_LEN
+ * bytes in small pieces; anything else fails with status 64. */
+static int fake_handler(const char *login, const char *command,
+                        control_write_fn write_fn, void *sink, void *ctx) {
+    (void)ctx;
+
+    if (strncmp(command, "echo ", 5) == 0) {
+        const char *who = login ? login : "(none)";
+        assert(write_fn(sink, who, strlen(who)) == 0);
+        assert(write_fn(sink, " ", 1) == 0);
+        assert(write_fn(sink, command + 5, strlen(command + 5)) == 0);
+        assert(write_fn(sink, "\n", 1) == 0);
+        return 0;
+    }
+    if (strcmp(command, "big") == 0) {
+        char chunk[1000];
+
+        memset(chunk, 'x', sizeof(chunk));
+        for (int i = 0; i < BIG_OUTPUT_LEN / (int)sizeof(chunk); i++) {
+            assert(write_fn(sink, chunk, sizeof(chunk)) == 0);
+        }
+        return 0;
+    }
+    write_fn(sink, "unknown\n", 8);
+    return 64;
+}
+
+/* Runs one request against `path` and returns its exit status; output
+ * lands in `out`. */
+static int request_at(const char *path, const char *login,
+                      const char *command, char *out, size_t out_size) {
+    int pipefd[2];
+    int status;
+    ssize_t n;
+    size_t got = 0;
+
+    assert(pipe(pipefd) == 0);
+    status = control_request(path, login, command, pipefd[1]);
+    close(pipefd[1]);
+    while (got + 1 < out_size &&
+           (n = read(pipefd[0], out + got, out_size - 1 - got)) > 0) {
+        got += (size_t)n;
+    }
+    out[got] = '\0';
+    close(pipefd[0]);
+    return status;
+}
+
+static int request(const char *login, const char *command, char *out,
+                   size_t out_size) {
+    return request_at(socket_path, login, command, out, out_size);
+}
+
+TEST(request_without_server_fails) {
+    unlink(socket_path);
+    assert(control_request(socket_path, NULL, "health", STDOUT_FILENO) == -1);
+}
+
+TEST(status_and_output_round_trip) {
+    char out[256];
+
+    assert(control_server_start(socket_path, fake_handler, NULL) == 0);
+
+    assert(request("alice", "echo hello world", out, sizeof(out)) == 0);
+    assert(strcmp(out, "alice hello world\n") == 0);
+
+    assert(request(NULL, "echo anon", out, sizeof(out)) == 0);
+    assert(strcmp(out, "(none) anon\n") == 0);
+
+    assert(request("bob", "nope", out, sizeof(out)) == 64);
+    assert(strcmp(out, "unknown\n") == 0);
+}
+
+TEST(large_output_is_complete) {
+    static char out[BIG_OUTPUT_LEN + 16];
+
+    /* Small pipe buffers would block the copy, so use a temp file */
+    FILE *tmp = tmpfile();
+    assert(tmp != NULL);
+    assert(control_request(socket_path, NULL, "big", fileno(tmp)) == 0);
+    rewind(tmp);
+    assert(fread(out, 1, sizeof(out), tmp) == BIG_OUTPUT_LEN);
+    for (size_t i = 0; i < BIG_OUTPUT_LEN; i++) {
+        assert(out[i] == 'x');
+    }
+    fclose(tmp);
+}
+
+TEST(malformed_requests_are_rejected) {
+    char out[64];
+    int sock;
+
+    /* Newlines would break the two-line framing */
+    assert(control_request(socket_path, NULL, "echo a\nb", STDOUT_FILENO) == -1);
+    assert(control_request(socket_path, "x\ny", "echo a", STDOUT_FILENO) == -1);
+    assert(control_request(socket_path, "", "echo a", STDOUT_FILENO) == -1);
+
+    /* A client speaking another protocol is dropped without a reply */
+    sock = tnt_unix_connect(socket_path);
+    assert(sock >= 0);
+    assert(write(sock, "GET / HTTP/1.0\r\n\r\n", 18) == 18);
+    assert(read(sock, out, sizeof(out)) == 0);
+    close(sock);
+
+    /* and the server keeps answering afterwards */
+    assert(request("carol", "echo still here", out, sizeof(out)) == 0);
+    assert(strcmp(out, "carol still here\n") == 0);
+}
+
+#define FILLER_MAX 256
+
+TEST(accept_survives_descriptor_exhaustion) {
+    struct timespec pause = { 0, 50 * 1000000L };
+    struct rlimit saved;
+    struct rlimit low;
+    int fillers[FILLER_MAX];
+    int filler_count = 0;
+    char path[sizeof(socket_path) + 4];
+    char out[64];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s.fd", socket_path);
+    assert(getrlimit(RLIMIT_NOFILE, &saved) == 0);
+    low = saved;
+    low.rlim_cur = 64;
+    assert(setrlimit(RLIMIT_NOFILE, &low) == 0);
+
+    /* Leave one descriptor for the listener, so the server thread's
+     * accept() starts out failing with EMFILE. */
+    while ((fd = dup(STDERR_FILENO)) >= 0) {
+        assert(filler_count < FILLER_MAX);
+        fillers[filler_count++] = fd;
+    }
+    close(fillers[--filler_count]);
+    assert(control_server_start(path, fake_handler, NULL) == 0);
+    nanosleep(&pause, NULL);
+
+    /* Once descriptors free up (one for the accept, three for the
+     * request's pipe and socket) the same server answers. */
+    for (int i = 0; i < 4; i++) {
+        close(fillers[--filler_count]);
+    }
+    assert(request_at(path, "dave", "echo after EMFILE", out,
+                      sizeof(out)) == 0);
+    assert(strcmp(out, "dave after EMFILE\n") == 0);
+
+    while (filler_count > 0) {
+        close(fillers[--filler_count]);
+    }
+    assert(setrlimit(RLIMIT_NOFILE, &saved) == 0);
+    unlink(path);
+}
+
+int main(void) {
+    const char *tmp = getenv("TMPDIR");
+
+    printf("Running control socket unit tests...\n\n");
+
+    signal(SIGPIPE, SIG_IGN);
+    snprintf(socket_path, sizeof(socket_path), "%s/tnt-control-test.%ld.sock",
+             tmp && tmp[0] ? tmp : "/tmp", (long)getpid());
+
+    RUN_TEST(request_without_server_fails);
+    RUN_TEST(status_and_output_round_trip);
+    RUN_TEST(large_output_is_complete);
+    RUN_TEST(malformed_requests_are_rejected);
+    RUN_TEST(accept_survives_descriptor_exhaustion);
+
+    unlink(socket_path);
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
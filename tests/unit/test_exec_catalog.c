@@ -28,6 +28,7 @@ TEST(generates_localized_exec_help) {
     assert(strstr(en, "TNT exec interface") != NULL);
     assert(strstr(en, "Commands:") != NULL);
     assert(strstr(en, "users [--json]") != NULL);
+    assert(strstr(en, "metrics [--json]") != NULL);
     assert(strstr(en, "dump [N]") != NULL);
     assert(strstr(en, "post MESSAGE") != NULL);
     assert(strstr(en, "support") == NULL);
@@ -63,6 +64,10 @@ TEST(matches_exec_commands_and_args) {
     assert(id == TNT_EXEC_COMMAND_USERS);
     assert(strcmp(args, "--json") == 0);
 
+    assert(exec_catalog_match("sessions 5 --net --json", &id, &args));
+    assert(id == TNT_EXEC_COMMAND_SESSIONS);
+    assert(strcmp(args, "5 --net --json") == 0);
+
     assert(exec_catalog_match("tail -n 20", &id, &args));
     assert(id == TNT_EXEC_COMMAND_TAIL);
     assert(strcmp(args, "-n 20") == 0);
@@ -96,6 +101,21 @@ TEST(validates_argument_shapes) {
     assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_USERS, NULL));
     assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_USERS, "--json"));
     assert(!exec_catalog_args_valid(TNT_EXEC_COMMAND_USERS, "--xml"));
+    assert(!exec_catalog_args_valid(TNT_EXEC_COMMAND_USERS, "--memory"));
+
+    assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_STATS, NULL));
+    assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_STATS, "--json"));
+    assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_STATS, "--memory"));
+    assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_STATS,
+                                   "--memory --json"));
+    assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_STATS,
+                                   "--json --memory"));
+    assert(!exec_catalog_args_valid(TNT_EXEC_COMMAND_STATS,
+                                    "--memory --memory"));
+    assert(!exec_catalog_args_valid(TNT_EXEC_COMMAND_STATS, "--mem"));
+    assert(exec_catalog_has_flag("--json --memory", "--memory"));
+    assert(!exec_catalog_has_flag("--memoryx", "--memory"));
+    assert(!exec_catalog_has_flag(NULL, "--json"));
 
     assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_TAIL, NULL));
     assert(exec_catalog_args_valid(TNT_EXEC_COMMAND_TAIL, "-n 20"));
@@ -136,7 +156,7 @@ TEST(generates_unique_command_list) {
     exec_catalog_append_command_list(output, sizeof(output), &pos);
 
     assert(strcmp(output,
-                  "help, health, users, stats, tail, dump, post, exit") == 0);
+                  "help, health, users, sessions, stats, metrics, locks, trace, tail, dump, post, exit") == 0);
 }
 
 int main(void) {
@@ -0,0 +1,213 @@
+/* Unit tests for descriptor passing and the listener handoff protocol */
+
+#include "../../include/handoff.h"
+#include "../../include/unix_socket.h"
+#include <assert.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+static char socket_path[256];
+static int exported_pipe[2];
+static atomic_int done_calls;
+
+static int export_pipe(int *fds, int max, void *ctx) {
+    (void)ctx;
+    assert(max >= 1);
+    fds[0] = exported_pipe[1];
+    return 1;
+}
+
+static void mark_done(void *ctx) {
+    (void)ctx;
+    atomic_fetch_add(&done_calls, 1);
+}
+
+static void wait_for_done(int expected) {
+    struct timespec delay = { 0, 10 * 1000000L };
+
+    for (int i = 0; i < 200 && atomic_load(&done_calls) < expected; i++) {
+        nanosleep(&delay, NULL);
+    }
+}
+
+/* The received descriptor must refer to the same pipe as the original. */
+static void assert_same_pipe(int received_write_end) {
+    char byte = 0;
+
+    assert(write(received_write_end, "x", 1) == 1);
+    assert(read(exported_pipe[0], &byte, 1) == 1);
+    assert(byte == 'x');
+}
+
+TEST(fds_pass_over_socketpair) {
+    int pair[2];
+    int pipes[2][2];
+    int sent[2];
+    int got[2] = { -1, -1 };
+    char byte = 0;
+
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    assert(pipe(pipes[0]) == 0);
+    assert(pipe(pipes[1]) == 0);
+    sent[0] = pipes[0][1];
+    sent[1] = pipes[1][1];
+
+    assert(tnt_unix_send_fds(pair[0], sent, 2) == 0);
+    assert(tnt_unix_recv_fds(pair[1], got, 2) == 2);
+    assert(got[0] != sent[0] && got[1] != sent[1]);
+
+    assert(write(got[1], "b", 1) == 1);
+    assert(read(pipes[1][0], &byte, 1) == 1 && byte == 'b');
+
+    /* A short receive buffer keeps what fits and closes the rest */
+    assert(tnt_unix_send_fds(pair[0], sent, 2) == 0);
+    close(got[0]);
+    close(got[1]);
+    assert(tnt_unix_recv_fds(pair[1], got, 1) == 1);
+    close(got[0]);
+
+    assert(tnt_unix_send_fds(pair[0], sent, 0) == -1);
+    assert(tnt_unix_peer_is_self(pair[1]));
+
+    for (int i = 0; i < 2; i++) {
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+    close(pair[0]);
+    close(pair[1]);
+}
+
+TEST(request_without_server_fails) {
+    int fds[4];
+
+    unlink(socket_path);
+    assert(handoff_request(socket_path, fds, 4) == -1);
+    assert(tnt_unix_listen("", 0600) == -1);
+}
+
+TEST(unacknowledged_handoff_keeps_serving) {
+    int sock;
+    int fds[4];
+
+    atomic_store(&done_calls, 0);
+    assert(handoff_server_start(socket_path, export_pipe, mark_done, NULL) == 0);
+
+    /* A new process that dies before acknowledging changes nothing */
+    sock = tnt_unix_connect(socket_path);
+    assert(sock >= 0);
+    assert(write(sock, "TNT-HANDOFF 1\n", 14) == 14);
+    assert(tnt_unix_recv_fds(sock, fds, 4) == 1);
+    close(fds[0]);
+    close(sock);
+
+    /* Nor does a client speaking the wrong protocol */
+    sock = tnt_unix_connect(socket_path);
+    assert(sock >= 0);
+    assert(write(sock, "GET / HTTP/1.0\n", 15) == 15);
+    close(sock);
+
+    assert(atomic_load(&done_calls) == 0);
+
+    assert(handoff_request(socket_path, fds, 4) == 1);
+    assert_same_pipe(fds[0]);
+    close(fds[0]);
+    wait_for_done(1);
+    assert(atomic_load(&done_calls) == 1);
+}
+
+TEST(server_stops_after_one_handoff) {
+    int fds[4];
+
+    /* The previous test completed a handoff; nobody listens any more */
+    assert(handoff_request(socket_path, fds, 4) == -1);
+
+    atomic_store(&done_calls, 0);
+    assert(handoff_server_start(socket_path, export_pipe, mark_done, NULL) == 0);
+    assert(handoff_request(socket_path, fds, 4) == 1);
+    close(fds[0]);
+    wait_for_done(1);
+    assert(atomic_load(&done_calls) == 1);
+    assert(handoff_request(socket_path, fds, 4) == -1);
+}
+
+#define FILLER_MAX 256
+
+TEST(accept_survives_descriptor_exhaustion) {
+    struct timespec pause = { 0, 50 * 1000000L };
+    struct rlimit saved;
+    struct rlimit low;
+    int fillers[FILLER_MAX];
+    int filler_count = 0;
+    int fds[4];
+    int fd;
+
+    assert(getrlimit(RLIMIT_NOFILE, &saved) == 0);
+    low = saved;
+    low.rlim_cur = 64;
+    assert(setrlimit(RLIMIT_NOFILE, &low) == 0);
+
+    /* Leave one descriptor for the listener, so the handoff thread's
+     * accept() starts out failing with EMFILE. */
+    while ((fd = dup(STDERR_FILENO)) >= 0) {
+        assert(filler_count < FILLER_MAX);
+        fillers[filler_count++] = fd;
+    }
+    close(fillers[--filler_count]);
+    atomic_store(&done_calls, 0);
+    assert(handoff_server_start(socket_path, export_pipe, mark_done, NULL) == 0);
+    nanosleep(&pause, NULL);
+
+    /* One descriptor for the accept, two for the request's socket and
+     * the received listener. */
+    for (int i = 0; i < 3; i++) {
+        close(fillers[--filler_count]);
+    }
+    assert(handoff_request(socket_path, fds, 4) == 1);
+    close(fds[0]);
+    wait_for_done(1);
+    assert(atomic_load(&done_calls) == 1);
+
+    while (filler_count > 0) {
+        close(fillers[--filler_count]);
+    }
+    assert(setrlimit(RLIMIT_NOFILE, &saved) == 0);
+}
+
+int main(void) {
+    const char *tmp = getenv("TMPDIR");
+
+    printf("Running listener handoff unit tests...\n\n");
+
+    signal(SIGPIPE, SIG_IGN);
+    snprintf(socket_path, sizeof(socket_path), "%s/tnt-handoff-test.%ld.sock",
+             tmp && tmp[0] ? tmp : "/tmp", (long)getpid());
+    assert(pipe(exported_pipe) == 0);
+
+    RUN_TEST(fds_pass_over_socketpair);
+    RUN_TEST(request_without_server_fails);
+    RUN_TEST(unacknowledged_handoff_keeps_serving);
+    RUN_TEST(server_stops_after_one_handoff);
+    RUN_TEST(accept_survives_descriptor_exhaustion);
+
+    unlink(socket_path);
+    close(exported_pipe[0]);
+    close(exported_pipe[1]);
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "../../include/input_render.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("ok\n"); \
+    tests_passed++; \
+} while (0)
+
+static int tests_passed = 0;
+
+static void drawn(tnt_input_render_state_t *state, const char *input,
+                  int width, int cols, int rows) {
+    tnt_input_render_full(state, input, strlen(input), width, cols, rows);
+}
+
+TEST(fresh_state_requires_full_repaint) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+
+    tnt_input_render_plan_t plan =
+        tnt_input_render_plan(&state, "hi", 2, 80, 24);
+    assert(plan.op == TNT_INPUT_RENDER_FULL);
+}
+
+TEST(appended_ascii_is_incremental) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+    drawn(&state, "hell", 4, 80, 24);
+
+    tnt_input_render_plan_t plan =
+        tnt_input_render_plan(&state, "hello", 5, 80, 24);
+    assert(plan.op == TNT_INPUT_RENDER_APPEND);
+    assert(plan.offset == 4);
+    assert(plan.width == 1);
+
+    tnt_input_render_apply(&state, &plan, "hello", 5);
+    assert(state.valid);
+    assert(state.shown_len == 5);
+    assert(state.shown_width == 5);
+    assert(strcmp(state.shown, "hello") == 0);
+}
+
+TEST(appended_wide_glyph_counts_two_columns) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+    drawn(&state, "a", 1, 80, 24);
+
+    const char *input = "a\xe4\xbd\xa0";  /* a + U+4F60 */
+    tnt_input_render_plan_t plan =
+        tnt_input_render_plan(&state, input, strlen(input), 80, 24);
+    assert(plan.op == TNT_INPUT_RENDER_APPEND);
+    assert(plan.width == 2);
+
+    tnt_input_render_apply(&state, &plan, input, strlen(input));
+    assert(state.shown_width == 3);
+}
+
+TEST(trailing_erase_reports_columns) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+    const char *shown = "ok \xe4\xbd\xa0\xe5\xa5\xbd";  /* ok + 2 CJK */
+    drawn(&state, shown, 7, 80, 24);
+
+    tnt_input_render_plan_t plan =
+        tnt_input_render_plan(&state, "ok ", 3, 80, 24);
+    assert(plan.op == TNT_INPUT_RENDER_ERASE);
+    assert(plan.offset == 3);
+    assert(plan.width == 4);
+
+    tnt_input_render_apply(&state, &plan, "ok ", 3);
+    assert(state.valid);
+    assert(state.shown_width == 3);
+    assert(strcmp(state.shown, "ok ") == 0);
+
+    plan = tnt_input_render_plan(&state, "", 0, 80, 24);
+    assert(plan.op == TNT_INPUT_RENDER_ERASE);
+    assert(plan.width == 3);
+}
+
+TEST(unchanged_input_emits_nothing) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+    drawn(&state, "same", 4, 80, 24);
+
+    tnt_input_render_plan_t plan =
+        tnt_input_render_plan(&state, "same", 4, 80, 24);
+    assert(plan.op == TNT_INPUT_RENDER_UNCHANGED);
+}
+
+TEST(replaced_prefix_forces_full_repaint) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+    drawn(&state, "first", 5, 80, 24);
+
+    assert(tnt_input_render_plan(&state, "other", 5, 80, 24).op ==
+           TNT_INPUT_RENDER_FULL);
+    assert(tnt_input_render_plan(&state, "second line", 11, 80, 24).op ==
+           TNT_INPUT_RENDER_FULL);
+    assert(tnt_input_render_plan(&state, "fir_", 4, 80, 24).op ==
+           TNT_INPUT_RENDER_FULL);
+}
+
+TEST(resize_forces_full_repaint) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+    drawn(&state, "abc", 3, 80, 24);
+
+    assert(tnt_input_render_plan(&state, "abcd", 4, 100, 24).op ==
+           TNT_INPUT_RENDER_FULL);
+    assert(tnt_input_render_plan(&state, "abcd", 4, 80, 30).op ==
+           TNT_INPUT_RENDER_FULL);
+}
+
+TEST(scrolling_line_is_never_incremental) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+
+    /* 10 columns leave 7 for text. */
+    drawn(&state, "abcdef", 6, 10, 24);
+    assert(state.valid);
+    tnt_input_render_plan_t plan =
+        tnt_input_render_plan(&state, "abcdefg", 7, 10, 24);
+    assert(plan.op == TNT_INPUT_RENDER_APPEND);
+    tnt_input_render_apply(&state, &plan, "abcdefg", 7);
+
+    assert(tnt_input_render_plan(&state, "abcdefgh", 8, 10, 24).op ==
+           TNT_INPUT_RENDER_FULL);
+
+    drawn(&state, "abcdefgh", 8, 10, 24);
+    assert(!state.valid);
+}
+
+TEST(gauge_threshold_disables_incremental_updates) {
+    tnt_input_render_state_t state;
+    char input[MAX_MESSAGE_LEN];
+    size_t threshold = (MAX_MESSAGE_LEN * 8) / 10;
+
+    memset(input, 'x', threshold);
+    input[threshold] = '\0';
+    tnt_input_render_reset(&state);
+    drawn(&state, input, (int)threshold, 4096, 24);
+    assert(state.valid);
+
+    input[threshold] = 'y';
+    input[threshold + 1] = '\0';
+    assert(tnt_input_render_wants_gauge(threshold + 1));
+    assert(tnt_input_render_plan(&state, input, threshold + 1, 4096, 24).op ==
+           TNT_INPUT_RENDER_FULL);
+
+    drawn(&state, input, (int)threshold + 1, 4096, 24);
+    assert(!state.valid);
+}
+
+TEST(reset_invalidates_state) {
+    tnt_input_render_state_t state;
+    tnt_input_render_reset(&state);
+    drawn(&state, "abc", 3, 80, 24);
+    tnt_input_render_reset(&state);
+
+    assert(tnt_input_render_plan(&state, "abcd", 4, 80, 24).op ==
+           TNT_INPUT_RENDER_FULL);
+}
+
+int main(void) {
+    printf("Running input render tests...\n\n");
+
+    RUN_TEST(fresh_state_requires_full_repaint);
+    RUN_TEST(appended_ascii_is_incremental);
+    RUN_TEST(appended_wide_glyph_counts_two_columns);
+    RUN_TEST(trailing_erase_reports_columns);
+    RUN_TEST(unchanged_input_emits_nothing);
+    RUN_TEST(replaced_prefix_forces_full_repaint);
+    RUN_TEST(resize_forces_full_repaint);
+    RUN_TEST(scrolling_line_is_never_incremental);
+    RUN_TEST(gauge_threshold_disables_incremental_updates);
+    RUN_TEST(reset_invalidates_state);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "../../include/line_history.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("ok\n"); \
+    tests_passed++; \
+} while (0)
+
+static int tests_passed = 0;
+
+TEST(empty_history_owns_no_entries) {
+    tnt_line_history_t history = {0};
+
+    assert(history.count == 0);
+    assert(tnt_line_history_get(&history, 0) == NULL);
+    assert(tnt_line_history_bytes(&history) == 0);
+    tnt_line_history_clear(&history);
+}
+
+TEST(push_stores_right_sized_copies) {
+    tnt_line_history_t history = {0};
+    char line[8] = "hello";
+
+    assert(tnt_line_history_push(&history, line, 1024) == 0);
+    line[0] = 'j';
+    assert(history.count == 1);
+    assert(history.pos == 1);
+    assert(strcmp(tnt_line_history_get(&history, 0), "hello") == 0);
+    assert(tnt_line_history_bytes(&history) == 6);
+
+    tnt_line_history_clear(&history);
+    assert(history.count == 0);
+    assert(history.pos == 0);
+}
+
+TEST(full_history_drops_oldest) {
+    tnt_line_history_t history = {0};
+    char line[16];
+
+    for (int i = 0; i < TNT_LINE_HISTORY_SIZE + 3; i++) {
+        snprintf(line, sizeof(line), "line %d", i);
+        assert(tnt_line_history_push(&history, line, 256) == 0);
+    }
+
+    assert(history.count == TNT_LINE_HISTORY_SIZE);
+    assert(history.pos == TNT_LINE_HISTORY_SIZE);
+    assert(strcmp(tnt_line_history_get(&history, 0), "line 3") == 0);
+    snprintf(line, sizeof(line), "line %d", TNT_LINE_HISTORY_SIZE + 2);
+    assert(strcmp(tnt_line_history_get(&history,
+                                       TNT_LINE_HISTORY_SIZE - 1),
+                  line) == 0);
+    assert(tnt_line_history_get(&history, TNT_LINE_HISTORY_SIZE) == NULL);
+    assert(tnt_line_history_get(&history, -1) == NULL);
+
+    tnt_line_history_clear(&history);
+}
+
+TEST(push_truncates_on_utf8_boundary) {
+    tnt_line_history_t history = {0};
+
+    /* "ab" + U+4F60 is five bytes; a 5-byte limit keeps 4 bytes, which
+     * would split the codepoint, so only "ab" survives. */
+    assert(tnt_line_history_push(&history, "ab\xe4\xbd\xa0", 5) == 0);
+    assert(strcmp(tnt_line_history_get(&history, 0), "ab") == 0);
+
+    assert(tnt_line_history_push(&history, "abcdef", 4) == 0);
+    assert(strcmp(tnt_line_history_get(&history, 1), "abc") == 0);
+
+    tnt_line_history_clear(&history);
+}
+
+TEST(push_resets_recall_cursor) {
+    tnt_line_history_t history = {0};
+
+    tnt_line_history_push(&history, "one", 16);
+    tnt_line_history_push(&history, "two", 16);
+    history.pos = 0;
+    tnt_line_history_push(&history, "three", 16);
+    assert(history.pos == 3);
+
+    tnt_line_history_clear(&history);
+}
+
+int main(void) {
+    printf("Running line history tests...\n\n");
+
+    RUN_TEST(empty_history_owns_no_entries);
+    RUN_TEST(push_stores_right_sized_copies);
+    RUN_TEST(full_history_drops_oldest);
+    RUN_TEST(push_truncates_on_utf8_boundary);
+    RUN_TEST(push_resets_recall_cursor);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
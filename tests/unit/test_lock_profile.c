@@ -0,0 +1,146 @@
+/* Unit tests for lock contention profiling */
+
+#include "../../include/lock_profile.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+static pthread_mutex_t g_test_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t g_test_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+static void sleep_us(long us) {
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+
+    nanosleep(&ts, NULL);
+}
+
+static void report(char *out, size_t size) {
+    size_t pos = 0;
+
+    out[0] = '\0';
+    lock_profile_append_text(out, size, &pos);
+}
+
+TEST(disabled_records_nothing) {
+    char out[4096];
+
+    lock_profile_reset();
+    lock_profile_set_enabled(false);
+    LOCK_PROFILE_RDLOCK(&g_test_rwlock, LOCK_ID_ROOM);
+    LOCK_PROFILE_RWUNLOCK(&g_test_rwlock);
+    LOCK_PROFILE_MUTEX_LOCK(&g_test_mutex, LOCK_ID_MESSAGE_FILE);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_test_mutex);
+    assert(t_lock_profile_depth == 0);
+
+    report(out, sizeof(out));
+    assert(strncmp(out, "lock_profile off\n", 17) == 0);
+    assert(strstr(out, "lock room reads 0 writes 0 "));
+    assert(strstr(out, "site ") == NULL);
+}
+
+TEST(records_reads_writes_and_hold_time) {
+    char out[4096];
+
+    lock_profile_reset();
+    lock_profile_set_enabled(true);
+    LOCK_PROFILE_RDLOCK(&g_test_rwlock, LOCK_ID_ROOM);
+    LOCK_PROFILE_RDLOCK(&g_test_rwlock, LOCK_ID_ROOM);
+    assert(t_lock_profile_depth == 2);
+    LOCK_PROFILE_RWUNLOCK(&g_test_rwlock);
+    LOCK_PROFILE_RWUNLOCK(&g_test_rwlock);
+    LOCK_PROFILE_WRLOCK(&g_test_rwlock, LOCK_ID_ROOM);
+    sleep_us(3000);
+    LOCK_PROFILE_RWUNLOCK(&g_test_rwlock);
+    assert(t_lock_profile_depth == 0);
+
+    report(out, sizeof(out));
+    assert(strncmp(out, "lock_profile on\n", 16) == 0);
+    assert(strstr(out, "lock room reads 2 writes 1 "));
+    assert(strstr(out, "lock message_file reads 0 writes 0 "));
+    /* The write hold lasted at least the 3 ms sleep */
+    {
+        const char *max = strstr(out, "hold_us_max ");
+        unsigned long long us = 0;
+
+        assert(max && sscanf(max, "hold_us_max %llu", &us) == 1);
+        assert(us >= 3000);
+    }
+    assert(strstr(out, "site tests/unit/test_lock_profile.c:") ||
+           strstr(out, "site test_lock_profile.c:"));
+    lock_profile_set_enabled(false);
+}
+
+static void *contender(void *arg) {
+    (void)arg;
+    LOCK_PROFILE_MUTEX_LOCK(&g_test_mutex, LOCK_ID_MESSAGE_FILE);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_test_mutex);
+    return NULL;
+}
+
+TEST(contended_site_ranks_first) {
+    char out[8192];
+    size_t pos = 0;
+    pthread_t thread;
+
+    lock_profile_reset();
+    lock_profile_set_enabled(true);
+    LOCK_PROFILE_MUTEX_LOCK(&g_test_mutex, LOCK_ID_MESSAGE_FILE);
+    assert(pthread_create(&thread, NULL, contender, NULL) == 0);
+    sleep_us(20000);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_test_mutex);
+    pthread_join(thread, NULL);
+
+    lock_profile_append_json(out, sizeof(out), &pos);
+    assert(strncmp(out, "{\"enabled\":true,\"locks\":[{\"name\":\"room\",", 40)
+           == 0);
+    /* The waiting thread's site is listed first with the 20 ms wait */
+    {
+        const char *site = strstr(out, "\"sites\":[{\"site\":\"");
+        const char *wait = site ? strstr(site, "\"wait_us_total\":") : NULL;
+        unsigned long long us = 0;
+
+        assert(site && wait);
+        assert(strstr(site, "\"lock\":\"message_file\""));
+        assert(sscanf(wait, "\"wait_us_total\":%llu", &us) == 1);
+        assert(us >= 10000);
+    }
+    assert(strstr(out, "\"sites_dropped\":0}\n"));
+    lock_profile_set_enabled(false);
+}
+
+TEST(toggle_while_held_keeps_stack_balanced) {
+    lock_profile_reset();
+    lock_profile_set_enabled(true);
+    LOCK_PROFILE_MUTEX_LOCK(&g_test_mutex, LOCK_ID_MESSAGE_FILE);
+    lock_profile_set_enabled(false);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_test_mutex);
+    assert(t_lock_profile_depth == 0);
+
+    LOCK_PROFILE_MUTEX_LOCK(&g_test_mutex, LOCK_ID_MESSAGE_FILE);
+    lock_profile_set_enabled(true);
+    LOCK_PROFILE_MUTEX_UNLOCK(&g_test_mutex);
+    assert(t_lock_profile_depth == 0);
+    lock_profile_set_enabled(false);
+}
+
+int main(void) {
+    printf("Running lock profile unit tests...\n\n");
+
+    RUN_TEST(disabled_records_nothing);
+    RUN_TEST(records_reads_writes_and_hold_time);
+    RUN_TEST(contended_site_ranks_first);
+    RUN_TEST(toggle_while_held_keeps_stack_balanced);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/* Unit tests for history line formatting and mention matching */
+
+#include "../../include/message_format.h"
+#include "../../include/utf8.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+
+static message_t make_msg(const char *user, const char *content) {
+    message_t msg = { .timestamp = time(NULL) };
+    snprintf(msg.username, sizeof(msg.username), "%s", user);
+    snprintf(msg.content, sizeof(msg.content), "%s", content);
+    return msg;
+}
+
+TEST(mentions_match_at_sign_and_name) {
+    assert(message_mentions_user("hi @alice", "alice"));
+    assert(message_mentions_user("@bob: 你好", "bob"));
+    assert(!message_mentions_user("hi alice", "alice"));
+    assert(!message_mentions_user("hi @al", "alice"));
+    assert(!message_mentions_user("hi @alice", ""));
+    assert(!message_mentions_user(NULL, "alice"));
+}
+
+TEST(own_message_gets_gutter_marker) {
+    const theme_t *theme = theme_default();
+    message_t msg = make_msg("alice", "hello");
+    char out[MAX_MESSAGE_LEN + 512];
+
+    message_format_colored(&msg, out, sizeof(out), 80, "alice", theme);
+    assert(strncmp(out, theme->accent, strlen(theme->accent)) == 0);
+    assert(strstr(out, "alice\033[0m: hello"));
+
+    message_format_colored(&msg, out, sizeof(out), 80, "bob", theme);
+    assert(out[0] == ' ');
+}
+
+TEST(mention_is_highlighted) {
+    message_t msg = make_msg("alice", "ping @bob");
+    char out[MAX_MESSAGE_LEN + 512];
+
+    message_format_colored(&msg, out, sizeof(out), 80, "bob", theme_default());
+    assert(strstr(out, ": \033[1;33mping @bob\033[0m"));
+
+    message_format_colored(&msg, out, sizeof(out), 80, "carol",
+                           theme_default());
+    assert(strstr(out, ": ping @bob"));
+}
+
+TEST(long_line_fits_width) {
+    char content[MAX_MESSAGE_LEN];
+    message_t msg;
+    char out[MAX_MESSAGE_LEN + 512];
+
+    content[0] = '\0';
+    for (int i = 0; i < 40; i++) {
+        strcat(content, "中文");
+    }
+    msg = make_msg("alice", content);
+    message_format_colored(&msg, out, sizeof(out), 40, NULL, theme_default());
+    assert(utf8_ansi_string_width(out) <= 40);
+}
+
+int main(void) {
+    printf("Running message format unit tests...\n\n");
+
+    RUN_TEST(mentions_match_at_sign_and_name);
+    RUN_TEST(own_message_gets_gutter_marker);
+    RUN_TEST(mention_is_highlighted);
+    RUN_TEST(long_line_fits_width);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
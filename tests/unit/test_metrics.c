@@ -0,0 +1,170 @@
+/* Unit tests for the sharded metrics registry */
+
+#include "../../include/metrics.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+
+#define WORKERS 8
+#define ADDS_PER_WORKER 100000
+
+static void *add_worker(void *arg) {
+    (void)arg;
+    for (int i = 0; i < ADDS_PER_WORKER; i++) {
+        metrics_inc(METRIC_CLIENT_BYTES_QUEUED);
+        metrics_observe(METRIC_HIST_RENDER_US, 30);
+    }
+    return NULL;
+}
+
+TEST(counters_sum_across_thread_shards) {
+    pthread_t threads[WORKERS];
+    metrics_snapshot_t snap;
+
+    metrics_reset();
+    for (int i = 0; i < WORKERS; i++) {
+        assert(pthread_create(&threads[i], NULL, add_worker, NULL) == 0);
+    }
+    for (int i = 0; i < WORKERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    metrics_add(METRIC_CLIENT_BYTES_QUEUED, 5);
+
+    metrics_snapshot(&snap);
+    assert(snap.counters[METRIC_CLIENT_BYTES_QUEUED] ==
+           (uint64_t)WORKERS * ADDS_PER_WORKER + 5);
+    assert(snap.hists[METRIC_HIST_RENDER_US].count ==
+           (uint64_t)WORKERS * ADDS_PER_WORKER);
+    assert(snap.hists[METRIC_HIST_RENDER_US].sum ==
+           (uint64_t)WORKERS * ADDS_PER_WORKER * 30);
+    assert(snap.counters[METRIC_MESSAGES_POSTED] == 0);
+}
+
+TEST(gauges_set_and_keep_high_water) {
+    metrics_snapshot_t snap;
+
+    metrics_reset();
+    metrics_gauge_max(METRIC_GAUGE_OUTBOX_HIGH_WATER, 4096);
+    metrics_gauge_max(METRIC_GAUGE_OUTBOX_HIGH_WATER, 100);
+    metrics_gauge_set(METRIC_GAUGE_MODULE_QUEUE_DEPTH, 7);
+    metrics_gauge_set(METRIC_GAUGE_MODULE_QUEUE_DEPTH, 2);
+
+    metrics_snapshot(&snap);
+    assert(snap.gauges[METRIC_GAUGE_OUTBOX_HIGH_WATER] == 4096);
+    assert(snap.gauges[METRIC_GAUGE_MODULE_QUEUE_DEPTH] == 2);
+}
+
+TEST(histogram_buckets_use_inclusive_upper_bounds) {
+    metrics_snapshot_t snap;
+
+    metrics_reset();
+    metrics_observe(METRIC_HIST_RENDER_BYTES, 0);
+    metrics_observe(METRIC_HIST_RENDER_BYTES, 256);
+    metrics_observe(METRIC_HIST_RENDER_BYTES, 257);
+    metrics_observe(METRIC_HIST_RENDER_BYTES, 10000000);
+
+    metrics_snapshot(&snap);
+    assert(snap.hists[METRIC_HIST_RENDER_BYTES].buckets[0] == 2);
+    assert(snap.hists[METRIC_HIST_RENDER_BYTES].buckets[1] == 1);
+    assert(snap.hists[METRIC_HIST_RENDER_BYTES].buckets[METRICS_HIST_BOUNDS]
+           == 1);
+    assert(snap.hists[METRIC_HIST_RENDER_BYTES].count == 4);
+}
+
+TEST(prometheus_output_is_cumulative_and_labelled) {
+    metrics_snapshot_t snap;
+    char out[32768];
+    size_t pos = 0;
+
+    metrics_reset();
+    metrics_inc(METRIC_CONN_REJECTED_RATE);
+    metrics_inc(METRIC_CONN_REJECTED_RATE);
+    metrics_observe(METRIC_HIST_MESSAGE_SAVE_US, 20);
+    metrics_observe(METRIC_HIST_MESSAGE_SAVE_US, 1500000);
+    metrics_snapshot(&snap);
+    metrics_append_prometheus(&snap, out, sizeof(out), &pos);
+
+    assert(pos < sizeof(out) - 1);
+    assert(strstr(out, "tnt_connections_rejected_total{reason=\"rate\"} 2\n"));
+    assert(strstr(out, "tnt_connections_rejected_total{reason=\"global\"} 0\n"));
+    /* HELP/TYPE appear once for a labelled family */
+    assert(strstr(out, "# TYPE tnt_connections_rejected_total counter\n"));
+    assert(strstr(strstr(out, "# TYPE tnt_connections_rejected_total") + 1,
+                  "# TYPE tnt_connections_rejected_total") == NULL);
+    assert(strstr(out, "# TYPE tnt_message_save_seconds histogram\n"));
+    assert(strstr(out, "tnt_message_save_seconds_bucket{le=\"0.000010\"} 0\n"));
+    assert(strstr(out, "tnt_message_save_seconds_bucket{le=\"0.000025\"} 1\n"));
+    assert(strstr(out, "tnt_message_save_seconds_bucket{le=\"0.250000\"} 1\n"));
+    assert(strstr(out, "tnt_message_save_seconds_bucket{le=\"+Inf\"} 2\n"));
+    assert(strstr(out, "tnt_message_save_seconds_sum 1.500020\n"));
+    assert(strstr(out, "tnt_message_save_seconds_count 2\n"));
+    assert(strstr(out, "tnt_render_frame_bytes_bucket{le=\"256\"} 0\n"));
+    assert(strstr(out, "tnt_client_outbox_high_water_bytes 0\n"));
+}
+
+TEST(json_output_has_all_sections) {
+    metrics_snapshot_t snap;
+    char out[16384];
+    size_t pos = 0;
+
+    metrics_reset();
+    metrics_add(METRIC_CLIENT_BYTES_FLUSHED, 123);
+    metrics_observe(METRIC_HIST_RENDER_BYTES, 300);
+    metrics_snapshot(&snap);
+    metrics_append_json(&snap, out, sizeof(out), &pos);
+
+    assert(strncmp(out, "{\"counters\":{\"messages_posted\":0,", 33) == 0);
+    assert(strstr(out, "\"client_bytes_flushed\":123"));
+    assert(strstr(out, "},\"gauges\":{\"client_outbox_high_water\":0,"));
+    assert(strstr(out, "\"render_bytes\":{\"count\":1,\"sum\":300,"
+                       "\"le\":[256,512,"));
+    assert(strstr(out, "\"buckets\":[0,1,0,0,0,0,0,0,0,0,0,0,0]}"));
+    assert(strcmp(out + pos - 3, "}}\n") == 0);
+}
+
+TEST(quantiles_report_bucket_upper_bounds) {
+    metrics_snapshot_t snap;
+
+    metrics_reset();
+    metrics_snapshot(&snap);
+    assert(metrics_hist_quantile(&snap, METRIC_HIST_DELIVERY_FLUSH_US,
+                                 0.5) == 0);
+
+    for (int i = 0; i < 98; i++) {
+        metrics_observe(METRIC_HIST_DELIVERY_FLUSH_US, 80);
+    }
+    metrics_observe(METRIC_HIST_DELIVERY_FLUSH_US, 3000);
+    metrics_observe(METRIC_HIST_DELIVERY_FLUSH_US, 5000000);
+    metrics_snapshot(&snap);
+    assert(metrics_hist_quantile(&snap, METRIC_HIST_DELIVERY_FLUSH_US,
+                                 0.5) == 100);
+    assert(metrics_hist_quantile(&snap, METRIC_HIST_DELIVERY_FLUSH_US,
+                                 0.99) == 5000);
+    assert(metrics_hist_quantile(&snap, METRIC_HIST_DELIVERY_FLUSH_US,
+                                 1.0) == UINT64_MAX);
+}
+
+int main(void) {
+    printf("Running metrics unit tests...\n\n");
+
+    RUN_TEST(counters_sum_across_thread_shards);
+    RUN_TEST(gauges_set_and_keep_high_water);
+    RUN_TEST(histogram_buckets_use_inclusive_upper_bounds);
+    RUN_TEST(prometheus_output_is_cumulative_and_labelled);
+    RUN_TEST(json_output_has_all_sections);
+    RUN_TEST(quantiles_report_bucket_upper_bounds);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
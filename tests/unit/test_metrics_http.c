@@ -0,0 +1,256 @@
+/* Unit tests for the built-in health/metrics HTTP responder */
+
+#include "../../include/metrics_http.h"
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+static int handler_calls = 0;
+
+static int fake_handler(const char *path, char *body, size_t body_size,
+                        size_t *body_len, void *ctx) {
+    (void)ctx;
+    handler_calls++;
+    if (strcmp(path, "/health") == 0) {
+        *body_len = (size_t)snprintf(body, body_size, "ok\n");
+        return 200;
+    }
+    if (strcmp(path, "/metrics") == 0) {
+        *body_len = (size_t)snprintf(body, body_size, "tnt_test_gauge %d\n",
+                                     handler_calls);
+        return 200;
+    }
+    return 404;
+}
+
+static int connect_endpoint(void) {
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct timeval timeout = { 5, 0 };
+
+    assert(fd >= 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)metrics_http_bound_port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static void send_text(int fd, const char *text) {
+    assert(write(fd, text, strlen(text)) == (ssize_t)strlen(text));
+}
+
+/* Read one response: headers plus Content-Length bytes of body. */
+static void read_response(int fd, char *out, size_t out_size) {
+    size_t got = 0;
+    const char *body;
+    size_t content_length = 0;
+
+    out[0] = '\0';
+    while (!(body = strstr(out, "\r\n\r\n"))) {
+        ssize_t n = read(fd, out + got, 1);
+        assert(n == 1);
+        got++;
+        out[got] = '\0';
+        assert(got + 1 < out_size);
+    }
+    body += 4;
+    {
+        const char *cl = strstr(out, "Content-Length: ");
+        assert(cl != NULL);
+        sscanf(cl + 16, "%zu", &content_length);
+    }
+    assert((size_t)(body - out) + content_length < out_size);
+    while (got < (size_t)(body - out) + content_length) {
+        ssize_t n = read(fd, out + got,
+                         (size_t)(body - out) + content_length - got);
+        assert(n > 0);
+        got += (size_t)n;
+        out[got] = '\0';
+    }
+}
+
+TEST(parse_listen_addresses) {
+    char host[64];
+    int port = -1;
+
+    assert(metrics_http_parse_listen("127.0.0.1:9100", host, sizeof(host),
+                                     &port) == 0);
+    assert(strcmp(host, "127.0.0.1") == 0 && port == 9100);
+
+    assert(metrics_http_parse_listen("[::1]:9101", host, sizeof(host),
+                                     &port) == 0);
+    assert(strcmp(host, "::1") == 0 && port == 9101);
+
+    assert(metrics_http_parse_listen("9102", host, sizeof(host), &port) == 0);
+    assert(strcmp(host, "127.0.0.1") == 0 && port == 9102);
+
+    assert(metrics_http_parse_listen("localhost:0", host, sizeof(host),
+                                     &port) == 0);
+    assert(strcmp(host, "localhost") == 0 && port == 0);
+
+    assert(metrics_http_parse_listen("127.0.0.1:", host, sizeof(host),
+                                     &port) < 0);
+    assert(metrics_http_parse_listen(":9100", host, sizeof(host), &port) < 0);
+    assert(metrics_http_parse_listen("127.0.0.1:65536", host, sizeof(host),
+                                     &port) < 0);
+    assert(metrics_http_parse_listen("127.0.0.1:-1", host, sizeof(host),
+                                     &port) < 0);
+    assert(metrics_http_parse_listen("::1:9100", host, sizeof(host),
+                                     &port) < 0);
+    assert(metrics_http_parse_listen("[::1]9100", host, sizeof(host),
+                                     &port) < 0);
+    assert(metrics_http_parse_listen("", host, sizeof(host), &port) < 0);
+    assert(metrics_http_parse_listen(NULL, host, sizeof(host), &port) < 0);
+}
+
+TEST(health_and_metrics_on_one_connection) {
+    char response[1024];
+    int fd;
+
+    assert(metrics_http_start("127.0.0.1:0", fake_handler, NULL) == 0);
+    assert(metrics_http_bound_port() > 0);
+
+    fd = connect_endpoint();
+    send_text(fd, "GET /health HTTP/1.1\r\nHost: x\r\n\r\n");
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    assert(strstr(response, "Connection: keep-alive\r\n") != NULL);
+    assert(strstr(response, "\r\n\r\nok\n") != NULL);
+
+    /* The connection stays open for the next scrape */
+    send_text(fd, "GET /metrics?x=1 HTTP/1.1\r\nHost: x\r\n\r\n");
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    assert(strstr(response, "text/plain; version=0.0.4") != NULL);
+    assert(strstr(response, "tnt_test_gauge ") != NULL);
+    close(fd);
+}
+
+TEST(pipelined_requests_and_connection_close) {
+    char response[1024];
+    char byte;
+    int fd = connect_endpoint();
+
+    send_text(fd,
+              "GET /nope HTTP/1.1\r\n\r\n"
+              "GET /health HTTP/1.1\r\nconnection: Close\r\n\r\n");
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 404 Not Found\r\n", 24) == 0);
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    assert(strstr(response, "Connection: close\r\n") != NULL);
+    assert(read(fd, &byte, 1) == 0);
+    close(fd);
+}
+
+TEST(http10_head_and_bad_methods) {
+    char response[1024];
+    char byte;
+    int fd = connect_endpoint();
+
+    /* HTTP/1.0 closes by default; HEAD sends headers only */
+    send_text(fd, "HEAD /health HTTP/1.0\r\n\r\n");
+    assert(read(fd, response, sizeof(response) - 1) > 0);
+    assert(strncmp(response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    assert(strstr(response, "Content-Length: 3\r\n") != NULL);
+    assert(read(fd, &byte, 1) == 0);
+    close(fd);
+
+    fd = connect_endpoint();
+    send_text(fd, "POST /health HTTP/1.1\r\nContent-Length: 2\r\n\r\nhi");
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 405 ", 13) == 0);
+    assert(read(fd, &byte, 1) == 0);
+    close(fd);
+
+    fd = connect_endpoint();
+    send_text(fd, "garbage\r\n\r\n");
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 400 ", 13) == 0);
+    close(fd);
+}
+
+TEST(oversized_request_is_rejected) {
+    char line[4096];
+    char response[1024];
+    int fd = connect_endpoint();
+
+    memset(line, 'a', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    send_text(fd, "GET /health HTTP/1.1\r\nX-Pad: ");
+    send_text(fd, line);
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 431 ", 13) == 0);
+    close(fd);
+
+    /* and the endpoint keeps serving */
+    fd = connect_endpoint();
+    send_text(fd, "GET /health HTTP/1.1\r\n\r\n");
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    close(fd);
+}
+
+TEST(busy_address_fails_to_start) {
+    char spec[32];
+
+    snprintf(spec, sizeof(spec), "127.0.0.1:%d", metrics_http_bound_port());
+    assert(metrics_http_start(spec, fake_handler, NULL) == -1);
+    assert(metrics_http_start("not an address", fake_handler, NULL) == -1);
+}
+
+TEST(stop_releases_the_address) {
+    char spec[32];
+    char response[1024];
+    int fd;
+
+    snprintf(spec, sizeof(spec), "127.0.0.1:%d", metrics_http_bound_port());
+    /* A second endpoint is refused while one runs... */
+    assert(metrics_http_start("127.0.0.1:0", fake_handler, NULL) == -1);
+
+    /* ...and a stopped one gives its port back at once. */
+    metrics_http_stop();
+    metrics_http_stop();
+    assert(metrics_http_start(spec, fake_handler, NULL) == 0);
+    fd = connect_endpoint();
+    send_text(fd, "GET /health HTTP/1.1\r\n\r\n");
+    read_response(fd, response, sizeof(response));
+    assert(strncmp(response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    close(fd);
+    metrics_http_stop();
+}
+
+int main(void) {
+    printf("Running metrics endpoint unit tests...\n\n");
+
+    signal(SIGPIPE, SIG_IGN);
+
+    RUN_TEST(parse_listen_addresses);
+    RUN_TEST(health_and_metrics_on_one_connection);
+    RUN_TEST(pipelined_requests_and_connection_close);
+    RUN_TEST(http10_head_and_bad_methods);
+    RUN_TEST(oversized_request_is_rejected);
+    RUN_TEST(busy_address_fails_to_start);
+    RUN_TEST(stop_releases_the_address);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
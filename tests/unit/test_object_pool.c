@@ -0,0 +1,161 @@
+#include "../../include/object_pool.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("ok\n"); \
+    tests_passed++; \
+} while (0)
+
+static int tests_passed = 0;
+
+typedef struct {
+    char payload[200];
+    int value;
+} sample_t;
+
+static const tnt_pool_stats_t *find_stats(tnt_pool_stats_t *stats, int count,
+                                          const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(stats[i].name, name) == 0) {
+            return &stats[i];
+        }
+    }
+    return NULL;
+}
+
+TEST(alloc_returns_zeroed_objects_and_reuses_them) {
+    static tnt_pool_t pool = TNT_POOL_INITIALIZER("sample", sample_t, 4);
+
+    sample_t *first = tnt_pool_alloc(&pool);
+    assert(first);
+    assert(first->value == 0);
+    first->value = 42;
+    memset(first->payload, 'x', sizeof(first->payload));
+    tnt_pool_free(&pool, first);
+
+    sample_t *second = tnt_pool_alloc(&pool);
+    assert(second == first);
+    assert(second->value == 0);
+    assert(second->payload[0] == '\0');
+    assert(second->payload[sizeof(second->payload) - 1] == '\0');
+    tnt_pool_free(&pool, second);
+}
+
+TEST(free_list_is_bounded) {
+    static tnt_pool_t pool = TNT_POOL_INITIALIZER("bounded", sample_t, 2);
+    void *objects[5];
+
+    for (int i = 0; i < 5; i++) {
+        objects[i] = tnt_pool_alloc(&pool);
+        assert(objects[i]);
+    }
+    for (int i = 0; i < 5; i++) {
+        tnt_pool_free(&pool, objects[i]);
+    }
+
+    tnt_pool_stats_t stats[32];
+    int count = tnt_pool_collect_stats(stats, 32);
+    const tnt_pool_stats_t *entry = find_stats(stats, count, "bounded");
+    assert(entry);
+    assert(entry->free_count == 2);
+    assert(entry->in_use == 0);
+    assert(entry->allocated == 5);
+}
+
+TEST(churn_stays_on_the_free_list) {
+    static tnt_pool_t pool = TNT_POOL_INITIALIZER("churn", sample_t, 8);
+
+    for (int i = 0; i < 10000; i++) {
+        void *a = tnt_pool_alloc(&pool);
+        void *b = tnt_pool_alloc(&pool);
+        assert(a && b);
+        tnt_pool_free(&pool, a);
+        tnt_pool_free(&pool, b);
+    }
+
+    tnt_pool_stats_t stats[32];
+    int count = tnt_pool_collect_stats(stats, 32);
+    const tnt_pool_stats_t *entry = find_stats(stats, count, "churn");
+    assert(entry);
+    assert(entry->allocated == 2);
+    assert(entry->reused == 19998);
+}
+
+TEST(buffers_round_up_to_size_classes) {
+    size_t capacity = 0;
+    char *small = tnt_buffer_pool_alloc(100, &capacity);
+    assert(small);
+    assert(capacity == TNT_BUFFER_POOL_MIN);
+    tnt_buffer_pool_free(small, capacity);
+
+    char *mid = tnt_buffer_pool_alloc(40000, &capacity);
+    assert(mid);
+    assert(capacity == 64 * 1024);
+    tnt_buffer_pool_free(mid, capacity);
+
+    char *reused = tnt_buffer_pool_alloc(33000, &capacity);
+    assert(reused == mid);
+    assert(capacity == 64 * 1024);
+    tnt_buffer_pool_free(reused, capacity);
+
+    char *large = tnt_buffer_pool_alloc(TNT_BUFFER_POOL_MAX + 1, &capacity);
+    assert(large);
+    assert(capacity == TNT_BUFFER_POOL_MAX + 1);
+    tnt_buffer_pool_free(large, capacity);
+}
+
+TEST(resize_preserves_kept_prefix) {
+    size_t capacity = 0;
+    char *buffer = tnt_buffer_pool_alloc(10, &capacity);
+    assert(buffer);
+    memcpy(buffer, "queued", 6);
+
+    size_t grown_capacity = 0;
+    char *grown = tnt_buffer_pool_resize(buffer, capacity, 6, 9000,
+                                         &grown_capacity);
+    assert(grown);
+    assert(grown_capacity == 16 * 1024);
+    assert(memcmp(grown, "queued", 6) == 0);
+    tnt_buffer_pool_free(grown, grown_capacity);
+}
+
+TEST(fits_keeps_buffers_within_their_class) {
+    /* Small frames stay in the smallest class however little they use. */
+    assert(tnt_buffer_pool_fits(TNT_BUFFER_POOL_MIN, 1));
+    assert(tnt_buffer_pool_fits(TNT_BUFFER_POOL_MIN, 1500));
+    assert(tnt_buffer_pool_fits(TNT_BUFFER_POOL_MIN, TNT_BUFFER_POOL_MIN));
+    assert(!tnt_buffer_pool_fits(TNT_BUFFER_POOL_MIN,
+                                 TNT_BUFFER_POOL_MIN + 1));
+
+    assert(tnt_buffer_pool_fits(64 * 1024, 33000));
+    assert(!tnt_buffer_pool_fits(64 * 1024, 32 * 1024));
+    assert(!tnt_buffer_pool_fits(64 * 1024, 100));
+    assert(!tnt_buffer_pool_fits(0, 1));
+
+    /* Oversized malloc buffers shrink once half of them would do. */
+    assert(tnt_buffer_pool_fits(TNT_BUFFER_POOL_MAX * 3,
+                                TNT_BUFFER_POOL_MAX * 2));
+    assert(!tnt_buffer_pool_fits(TNT_BUFFER_POOL_MAX * 3,
+                                 TNT_BUFFER_POOL_MAX + 1));
+    assert(!tnt_buffer_pool_fits(TNT_BUFFER_POOL_MAX * 3, 100));
+}
+
+int main(void) {
+    printf("Running object pool tests...\n\n");
+
+    RUN_TEST(alloc_returns_zeroed_objects_and_reuses_them);
+    RUN_TEST(free_list_is_bounded);
+    RUN_TEST(churn_stays_on_the_free_list);
+    RUN_TEST(buffers_round_up_to_size_classes);
+    RUN_TEST(resize_preserves_kept_prefix);
+    RUN_TEST(fits_keeps_buffers_within_their_class);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,134 @@
+/* Unit tests for per-user and per-IP posting token buckets */
+
+#include "../../include/post_limit.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+static uint64_t fake_now = 1000000;
+
+static uint64_t fake_clock(void) {
+    return fake_now;
+}
+
+static void configure(const char *rate, const char *burst,
+                      const char *ip_rate, const char *ip_burst) {
+    setenv("TNT_POST_RATE", rate, 1);
+    setenv("TNT_POST_BURST", burst, 1);
+    setenv("TNT_POST_IP_RATE", ip_rate, 1);
+    setenv("TNT_POST_IP_BURST", ip_burst, 1);
+    post_limit_init();
+}
+
+TEST(user_burst_then_steady_rate) {
+    configure("60", "3", "0", "1");
+
+    for (int i = 0; i < 3; i++) {
+        assert(post_limit_allow(POST_KIND_PUBLIC, "alice", "10.0.0.1"));
+    }
+    assert(!post_limit_allow(POST_KIND_PUBLIC, "alice", "10.0.0.1"));
+    assert(post_limit_rejected(POST_KIND_PUBLIC) == 1);
+
+    /* 60 per minute refills one post per second, not before */
+    fake_now += 999;
+    assert(!post_limit_allow(POST_KIND_PUBLIC, "alice", "10.0.0.1"));
+    fake_now += 1;
+    assert(post_limit_allow(POST_KIND_PUBLIC, "alice", "10.0.0.1"));
+    assert(!post_limit_allow(POST_KIND_PUBLIC, "alice", "10.0.0.1"));
+
+    /* Other users keep their own bucket */
+    assert(post_limit_allow(POST_KIND_PUBLIC, "bob", "10.0.0.1"));
+    assert(post_limit_rejected(POST_KIND_PUBLIC) == 3);
+}
+
+TEST(slow_rates_refill_without_rounding_loss) {
+    configure("1", "1", "0", "1");
+
+    assert(post_limit_allow(POST_KIND_PUBLIC, "slow", NULL));
+    /* Asking every 50 ms must not keep resetting the refill */
+    for (int i = 0; i < 1199; i++) {
+        fake_now += 50;
+        assert(!post_limit_allow(POST_KIND_PUBLIC, "slow", NULL));
+    }
+    fake_now += 50;
+    assert(post_limit_allow(POST_KIND_PUBLIC, "slow", NULL));
+}
+
+TEST(ip_bucket_spans_users_and_refunds_user_token) {
+    configure("60", "2", "60", "3");
+
+    assert(post_limit_allow(POST_KIND_PUBLIC, "u1", "192.0.2.7"));
+    assert(post_limit_allow(POST_KIND_WHISPER, "u2", "192.0.2.7"));
+    assert(post_limit_allow(POST_KIND_EXEC, "u3", "192.0.2.7"));
+    /* IP is empty; u4's own token is given back */
+    assert(!post_limit_allow(POST_KIND_PUBLIC, "u4", "192.0.2.7"));
+    assert(post_limit_rejected(POST_KIND_PUBLIC) == 1);
+    assert(post_limit_allow(POST_KIND_PUBLIC, "u4", "192.0.2.8"));
+    assert(post_limit_allow(POST_KIND_PUBLIC, "u4", "192.0.2.9"));
+    assert(!post_limit_allow(POST_KIND_PUBLIC, "u4", "192.0.2.10"));
+
+    /* No IP (local control socket, modules) only checks the user */
+    assert(post_limit_allow(POST_KIND_MODULE, "module:echo", NULL));
+    assert(post_limit_allow(POST_KIND_MODULE, "module:echo", ""));
+    assert(!post_limit_allow(POST_KIND_MODULE, "module:echo", NULL));
+    assert(post_limit_rejected(POST_KIND_MODULE) == 1);
+    assert(post_limit_rejected(POST_KIND_WHISPER) == 0);
+}
+
+TEST(zero_rate_disables_bucket) {
+    configure("0", "1", "0", "1");
+
+    for (int i = 0; i < 1000; i++) {
+        assert(post_limit_allow(POST_KIND_PUBLIC, "flooder", "10.0.0.2"));
+    }
+    assert(post_limit_rejected(POST_KIND_PUBLIC) == 0);
+}
+
+TEST(many_posters_recycle_idle_buckets) {
+    char name[32];
+
+    configure("60", "1", "0", "1");
+
+    /* Far more posters than slots: each still gets its first post */
+    for (int i = 0; i < 20000; i++) {
+        snprintf(name, sizeof(name), "user%d", i);
+        fake_now += 1000;
+        assert(post_limit_allow(POST_KIND_PUBLIC, name, NULL));
+    }
+    /* A recent poster is still remembered */
+    assert(!post_limit_allow(POST_KIND_PUBLIC, "user19999", NULL));
+}
+
+TEST(kind_names_are_stable) {
+    assert(strcmp(post_limit_kind_name(POST_KIND_PUBLIC), "public") == 0);
+    assert(strcmp(post_limit_kind_name(POST_KIND_WHISPER), "whisper") == 0);
+    assert(strcmp(post_limit_kind_name(POST_KIND_EXEC), "exec") == 0);
+    assert(strcmp(post_limit_kind_name(POST_KIND_MODULE), "module") == 0);
+    assert(strcmp(post_limit_kind_name(POST_KIND_COUNT), "unknown") == 0);
+}
+
+int main(void) {
+    printf("Running post limit unit tests...\n\n");
+
+    post_limit_set_time_source(fake_clock);
+
+    RUN_TEST(user_burst_then_steady_rate);
+    RUN_TEST(slow_rates_refill_without_rounding_loss);
+    RUN_TEST(ip_bucket_spans_users_and_refunds_user_token);
+    RUN_TEST(zero_rate_disables_bucket);
+    RUN_TEST(many_posters_recycle_idle_buckets);
+    RUN_TEST(kind_names_are_stable);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
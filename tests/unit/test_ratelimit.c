@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #define TEST(name) static void test_##name()
 #define RUN_TEST(name) do { \
@@ -14,6 +15,16 @@
 } while(0)
 
 static int tests_passed = 0;
+static time_t fake_now = 1000000;
+
+static time_t fake_clock(void) {
+    return fake_now;
+}
+
+static void format_ipv4(unsigned int n, char *buf, size_t size) {
+    snprintf(buf, size, "10.%u.%u.%u", (n >> 16) & 0xff, (n >> 8) & 0xff,
+             n & 0xff);
+}
 
 TEST(per_ip_concurrent_limit_blocks_second_active_connection) {
     const char *ip = "203.0.113.10";
@@ -59,12 +70,140 @@ TEST(global_limit_tracks_active_total) {
     ratelimit_decrement_total();
 }
 
+TEST(tracks_one_hundred_thousand_addresses) {
+    char ip[32];
+
+    setenv("TNT_RATE_LIMIT", "0", 1);
+    setenv("TNT_MAX_CONN_PER_IP", "1", 1);
+    setenv("TNT_RATE_LIMIT_TABLE_SIZE", "262144", 1);
+    ratelimit_init();
+
+    for (unsigned int i = 0; i < 100000; i++) {
+        format_ipv4(i, ip, sizeof(ip));
+        assert(ratelimit_check_ip(ip) == true);
+    }
+    assert(ratelimit_tracked_entries() == 100000);
+
+    /* Every address kept its own counter */
+    format_ipv4(0, ip, sizeof(ip));
+    assert(ratelimit_check_ip(ip) == false);
+    format_ipv4(99999, ip, sizeof(ip));
+    assert(ratelimit_check_ip(ip) == false);
+
+    for (unsigned int i = 0; i < 100000; i++) {
+        format_ipv4(i, ip, sizeof(ip));
+        ratelimit_release_ip(ip);
+    }
+    format_ipv4(12345, ip, sizeof(ip));
+    assert(ratelimit_check_ip(ip) == true);
+    ratelimit_release_ip(ip);
+
+    unsetenv("TNT_RATE_LIMIT_TABLE_SIZE");
+}
+
+TEST(small_table_never_evicts_active_connections) {
+    char ip[32];
+
+    setenv("TNT_RATE_LIMIT", "0", 1);
+    setenv("TNT_MAX_CONN_PER_IP", "1", 1);
+    setenv("TNT_RATE_LIMIT_TABLE_SIZE", "256", 1);
+    ratelimit_init();
+
+    for (unsigned int i = 0; i < 48; i++) {
+        format_ipv4(i, ip, sizeof(ip));
+        assert(ratelimit_check_ip(ip) == true);
+    }
+
+    /* Far more short-lived peers than the table holds */
+    for (unsigned int i = 1000; i < 6000; i++) {
+        format_ipv4(i, ip, sizeof(ip));
+        assert(ratelimit_check_ip(ip) == true);
+        ratelimit_release_ip(ip);
+    }
+    assert(ratelimit_tracked_entries() <= ratelimit_table_capacity());
+
+    for (unsigned int i = 0; i < 48; i++) {
+        format_ipv4(i, ip, sizeof(ip));
+        assert(ratelimit_check_ip(ip) == false);
+        ratelimit_release_ip(ip);
+    }
+
+    unsetenv("TNT_RATE_LIMIT_TABLE_SIZE");
+}
+
+TEST(idle_entries_expire_after_ttl) {
+    setenv("TNT_RATE_LIMIT", "1", 1);
+    setenv("TNT_MAX_CONN_PER_IP", "10", 1);
+    setenv("TNT_MAX_CONN_RATE_PER_IP", "10", 1);
+    setenv("TNT_RATE_LIMIT_TTL", "60", 1);
+    ratelimit_set_time_source(fake_clock);
+    ratelimit_init();
+
+    assert(ratelimit_check_ip("192.0.2.1") == true);
+    assert(ratelimit_tracked_entries() == 1);
+
+    /* Active connections pin the entry regardless of age */
+    fake_now += 3600;
+    assert(ratelimit_tracked_entries() == 1);
+
+    ratelimit_release_ip("192.0.2.1");
+    fake_now += 59;
+    assert(ratelimit_tracked_entries() == 1);
+    fake_now += 1;
+    assert(ratelimit_tracked_entries() == 0);
+
+    ratelimit_set_time_source(NULL);
+    unsetenv("TNT_RATE_LIMIT_TTL");
+}
+
+TEST(ipv4_prefix_aggregates_rotating_addresses) {
+    setenv("TNT_RATE_LIMIT", "1", 1);
+    setenv("TNT_MAX_CONN_PER_IP", "100", 1);
+    setenv("TNT_MAX_CONN_RATE_PER_IP", "3", 1);
+    setenv("TNT_RATE_LIMIT_V4_PREFIX", "24", 1);
+    ratelimit_init();
+
+    assert(ratelimit_check_ip("198.51.100.1") == true);
+    assert(ratelimit_check_ip("198.51.100.2") == true);
+    assert(ratelimit_check_ip("198.51.100.3") == true);
+    assert(ratelimit_check_ip("198.51.100.4") == false);
+    assert(ratelimit_check_ip("198.51.101.1") == true);
+    assert(ratelimit_tracked_entries() == 2);
+
+    unsetenv("TNT_RATE_LIMIT_V4_PREFIX");
+}
+
+TEST(ipv6_keys_and_prefix_aggregation) {
+    setenv("TNT_RATE_LIMIT", "0", 1);
+    setenv("TNT_MAX_CONN_PER_IP", "2", 1);
+    setenv("TNT_RATE_LIMIT_V6_PREFIX", "64", 1);
+    ratelimit_init();
+
+    assert(ratelimit_check_ip("2001:db8:1:2::1") == true);
+    assert(ratelimit_check_ip("2001:db8:1:2:ffff::9") == true);
+    assert(ratelimit_check_ip("2001:db8:1:2:abcd::1") == false);
+    assert(ratelimit_check_ip("2001:db8:1:3::1") == true);
+
+    /* A v4-mapped address is the same peer as its dotted form */
+    assert(ratelimit_check_ip("192.0.2.7") == true);
+    assert(ratelimit_check_ip("::ffff:192.0.2.7") == true);
+    assert(ratelimit_check_ip("192.0.2.7") == false);
+    assert(ratelimit_tracked_entries() == 3);
+
+    unsetenv("TNT_RATE_LIMIT_V6_PREFIX");
+}
+
 int main(void) {
     printf("Running rate-limit unit tests...\n\n");
 
     RUN_TEST(per_ip_concurrent_limit_blocks_second_active_connection);
     RUN_TEST(rate_limit_allows_configured_burst_then_blocks);
     RUN_TEST(global_limit_tracks_active_total);
+    RUN_TEST(tracks_one_hundred_thousand_addresses);
+    RUN_TEST(small_table_never_evicts_active_connections);
+    RUN_TEST(idle_entries_expire_after_ttl);
+    RUN_TEST(ipv4_prefix_aggregates_rotating_addresses);
+    RUN_TEST(ipv6_keys_and_prefix_aggregation);
 
     printf("\n✓ All %d tests passed!\n", tests_passed);
     return 0;
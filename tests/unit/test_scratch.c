@@ -0,0 +1,122 @@
+#include "../../include/scratch.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("ok\n"); \
+    tests_passed++; \
+} while (0)
+
+static int tests_passed = 0;
+
+TEST(alloc_is_aligned_and_released_to_mark) {
+    tnt_scratch_mark_t mark = tnt_scratch_mark();
+    char *a = tnt_scratch_alloc(3);
+    char *b = tnt_scratch_alloc(100);
+
+    assert(a && b);
+    assert(((uintptr_t)a % 16) == 0);
+    assert(((uintptr_t)b % 16) == 0);
+    assert(b >= a + 3);
+    assert(tnt_scratch_used() == mark + 16 + 112);
+
+    tnt_scratch_release(mark);
+    assert(tnt_scratch_used() == mark);
+    assert(tnt_scratch_alloc(3) == a);
+    tnt_scratch_release(mark);
+}
+
+TEST(nested_marks_unwind_in_order) {
+    tnt_scratch_mark_t outer = tnt_scratch_mark();
+    char *outer_buf = tnt_scratch_alloc(8192);
+    assert(outer_buf);
+    memset(outer_buf, 'o', 8192);
+
+    tnt_scratch_mark_t inner = tnt_scratch_mark();
+    char *inner_buf = tnt_scratch_alloc(4096);
+    assert(inner_buf);
+    memset(inner_buf, 'i', 4096);
+    tnt_scratch_release(inner);
+
+    assert(outer_buf[0] == 'o' && outer_buf[8191] == 'o');
+    assert(tnt_scratch_alloc(4096) == inner_buf);
+    tnt_scratch_release(outer);
+    assert(tnt_scratch_used() == outer);
+}
+
+TEST(exhaustion_returns_null_without_corrupting_state) {
+    tnt_scratch_mark_t mark = tnt_scratch_mark();
+
+    assert(tnt_scratch_alloc(0) == NULL);
+    assert(tnt_scratch_alloc(TNT_SCRATCH_CAPACITY + 1) == NULL);
+    char *big = tnt_scratch_alloc(TNT_SCRATCH_CAPACITY - 64);
+    assert(big);
+    assert(tnt_scratch_alloc(128) == NULL);
+    assert(tnt_scratch_alloc(32) != NULL);
+    tnt_scratch_release(mark);
+    assert(tnt_scratch_used() == mark);
+    assert(tnt_scratch_high_water() >= TNT_SCRATCH_CAPACITY - 64);
+}
+
+TEST(trim_only_when_idle) {
+    tnt_scratch_mark_t mark = tnt_scratch_mark();
+    char *held = tnt_scratch_alloc(64);
+    assert(held);
+    memset(held, 'x', 64);
+
+    tnt_scratch_trim();  /* outstanding allocation: must keep the arena */
+    assert(held[63] == 'x');
+    tnt_scratch_release(mark);
+
+    tnt_scratch_trim();
+    assert(tnt_scratch_used() == 0);
+    assert(tnt_scratch_alloc(64) != NULL);
+    tnt_scratch_release(0);
+}
+
+static void *thread_main(void *arg) {
+    char **out = arg;
+
+    *out = tnt_scratch_alloc(1024);
+    if (*out) {
+        memset(*out, 't', 1024);
+    }
+    /* Left outstanding on purpose: thread exit frees the arena. */
+    return NULL;
+}
+
+TEST(arenas_are_per_thread) {
+    pthread_t thread;
+    char *theirs = NULL;
+    tnt_scratch_mark_t mark = tnt_scratch_mark();
+    char *mine = tnt_scratch_alloc(1024);
+
+    assert(mine);
+    memset(mine, 'm', 1024);
+    assert(pthread_create(&thread, NULL, thread_main, &theirs) == 0);
+    pthread_join(thread, NULL);
+
+    assert(theirs != NULL);
+    assert(theirs != mine);
+    assert(mine[0] == 'm' && mine[1023] == 'm');
+    tnt_scratch_release(mark);
+}
+
+int main(void) {
+    printf("Running scratch arena tests...\n\n");
+
+    RUN_TEST(alloc_is_aligned_and_released_to_mark);
+    RUN_TEST(nested_marks_unwind_in_order);
+    RUN_TEST(exhaustion_returns_null_without_corrupting_state);
+    RUN_TEST(trim_only_when_idle);
+    RUN_TEST(arenas_are_per_thread);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
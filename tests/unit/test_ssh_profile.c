@@ -0,0 +1,112 @@
+/* Unit tests for host key selection and SSH algorithm profiles */
+
+#include "../../include/ssh_profile.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+
+TEST(host_key_table_prefers_cheap_signatures) {
+    assert(tnt_host_key_info_count() == 3);
+    assert(tnt_host_key_info_at(0)->kind == TNT_HOST_KEY_ED25519);
+    assert(strcmp(tnt_host_key_info_at(0)->file_name, "host_key_ed25519") == 0);
+    /* RSA keeps the historical file name so existing fingerprints survive */
+    assert(tnt_host_key_info_at(2)->kind == TNT_HOST_KEY_RSA);
+    assert(strcmp(tnt_host_key_info_at(2)->file_name, "host_key") == 0);
+    assert(tnt_host_key_info_at(3) == NULL);
+}
+
+TEST(host_keys_auto_requires_only_ed25519) {
+    unsigned int required = 0;
+    unsigned int optional = 0;
+
+    assert(tnt_host_keys_parse("auto", &required, &optional));
+    assert(required == TNT_HOST_KEY_ED25519);
+    assert(optional == (TNT_HOST_KEY_ECDSA | TNT_HOST_KEY_RSA));
+}
+
+TEST(host_keys_explicit_list) {
+    unsigned int required = 0;
+    unsigned int optional = 1;
+
+    assert(tnt_host_keys_parse("rsa", &required, &optional));
+    assert(required == TNT_HOST_KEY_RSA);
+    assert(optional == 0);
+
+    assert(tnt_host_keys_parse("ed25519,ecdsa,rsa", &required, &optional));
+    assert(required == TNT_HOST_KEY_ALL);
+
+    assert(tnt_host_keys_parse("rsa,ed25519,rsa", &required, &optional));
+    assert(required == (TNT_HOST_KEY_RSA | TNT_HOST_KEY_ED25519));
+}
+
+TEST(host_keys_reject_malformed_lists) {
+    unsigned int required = 0;
+    unsigned int optional = 0;
+
+    assert(!tnt_host_keys_parse("", &required, &optional));
+    assert(!tnt_host_keys_parse("dsa", &required, &optional));
+    assert(!tnt_host_keys_parse("ed25519,", &required, &optional));
+    assert(!tnt_host_keys_parse(",rsa", &required, &optional));
+    assert(!tnt_host_keys_parse("ed25519 rsa", &required, &optional));
+    assert(!tnt_host_keys_parse("rsa4096", &required, &optional));
+    assert(!tnt_host_keys_parse(NULL, &required, &optional));
+}
+
+TEST(profiles_lookup) {
+    const tnt_ssh_profile_t *def = tnt_ssh_profile_find("default");
+    const tnt_ssh_profile_t *fast = tnt_ssh_profile_find("fast");
+
+    assert(def != NULL);
+    assert(def->key_exchange == NULL);
+    assert(def->hostkey_algorithms == NULL);
+    assert(tnt_ssh_profile_at(0) == def);
+
+    assert(fast != NULL);
+    assert(strncmp(fast->key_exchange, "curve25519-sha256", 17) == 0);
+    assert(strncmp(fast->hostkey_algorithms, "ssh-ed25519", 11) == 0);
+    assert(strstr(fast->hostkey_algorithms, "rsa-sha2-256") != NULL);
+
+    assert(tnt_ssh_profile_find("modern") != NULL);
+    assert(tnt_ssh_profile_find("FAST") == NULL);
+    assert(tnt_ssh_profile_find(NULL) == NULL);
+    assert(tnt_ssh_profile_at(tnt_ssh_profile_count()) == NULL);
+}
+
+TEST(profiles_check_loaded_host_keys) {
+    const tnt_ssh_profile_t *modern = tnt_ssh_profile_find("modern");
+    const tnt_ssh_profile_t *fast = tnt_ssh_profile_find("fast");
+    const tnt_ssh_profile_t *def = tnt_ssh_profile_find("default");
+
+    assert(tnt_ssh_profile_accepts_host_keys(def, TNT_HOST_KEY_RSA));
+    assert(!tnt_ssh_profile_accepts_host_keys(def, 0));
+    assert(tnt_ssh_profile_accepts_host_keys(fast, TNT_HOST_KEY_RSA));
+    assert(tnt_ssh_profile_accepts_host_keys(fast, TNT_HOST_KEY_ECDSA));
+    assert(tnt_ssh_profile_accepts_host_keys(modern, TNT_HOST_KEY_ED25519));
+    assert(!tnt_ssh_profile_accepts_host_keys(modern, TNT_HOST_KEY_RSA));
+    assert(!tnt_ssh_profile_accepts_host_keys(
+        modern, TNT_HOST_KEY_RSA | TNT_HOST_KEY_ECDSA));
+}
+
+int main(void) {
+    printf("Running SSH profile unit tests...\n\n");
+
+    RUN_TEST(host_key_table_prefers_cheap_signatures);
+    RUN_TEST(host_keys_auto_requires_only_ed25519);
+    RUN_TEST(host_keys_explicit_list);
+    RUN_TEST(host_keys_reject_malformed_lists);
+    RUN_TEST(profiles_lookup);
+    RUN_TEST(profiles_check_loaded_host_keys);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
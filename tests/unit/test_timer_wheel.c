@@ -0,0 +1,329 @@
+#include "../../include/timer_wheel.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("ok\n"); \
+    tests_passed++; \
+} while (0)
+
+static int tests_passed = 0;
+
+typedef struct {
+    int calls;
+    uint64_t last_ms;
+    uint64_t rearm_ms;
+} probe_t;
+
+static uint64_t probe_fire(void *arg, uint64_t now_ms) {
+    probe_t *probe = arg;
+
+    probe->calls++;
+    probe->last_ms = now_ms;
+    return probe->rearm_ms;
+}
+
+/* Advance in `step_ms` increments until the probe fires or `limit_ms`. */
+static uint64_t run_until_fired(tnt_timer_wheel_t *wheel, probe_t *probe,
+                                uint64_t start_ms, uint64_t step_ms,
+                                uint64_t limit_ms) {
+    int calls = probe->calls;
+
+    for (uint64_t now = start_ms; now <= limit_ms; now += step_ms) {
+        tnt_timer_wheel_advance(wheel, now);
+        if (probe->calls != calls) {
+            return now;
+        }
+    }
+    return 0;
+}
+
+TEST(fires_at_deadline_not_before) {
+    tnt_timer_wheel_t wheel;
+    probe_t probe = {0};
+    tnt_timer_t timer;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 1000) == 0);
+    tnt_timer_init(&timer, probe_fire, &probe);
+    tnt_timer_arm(&wheel, &timer, 120);
+    assert(tnt_timer_wheel_pending(&wheel) == 1);
+
+    uint64_t fired_at = run_until_fired(&wheel, &probe, 1000, 10, 2000);
+    assert(fired_at >= 1120);
+    assert(fired_at <= 1120 + 50);
+    assert(probe.calls == 1);
+    assert(tnt_timer_wheel_pending(&wheel) == 0);
+
+    tnt_timer_wheel_advance(&wheel, 5000);
+    assert(probe.calls == 1);
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+TEST(long_delays_cascade_from_higher_levels) {
+    static const uint64_t delays[] = {
+        3 * 1000, 15 * 1000, 30 * 1000, 300 * 1000, 3600 * 1000,
+        5 * 3600 * 1000
+    };
+
+    for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        tnt_timer_wheel_t wheel;
+        probe_t probe = {0};
+        tnt_timer_t timer;
+
+        assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+        /* Start mid-block so cascades are not tick-aligned with arming. */
+        tnt_timer_wheel_advance(&wheel, 1234);
+        tnt_timer_init(&timer, probe_fire, &probe);
+        tnt_timer_arm(&wheel, &timer, delays[i]);
+
+        uint64_t fired_at = run_until_fired(&wheel, &probe, 1234, 50,
+                                            1234 + delays[i] + 1000);
+        assert(fired_at >= 1234 + delays[i]);
+        assert(fired_at <= 1234 + delays[i] + 100);
+        tnt_timer_wheel_destroy(&wheel);
+    }
+}
+
+TEST(cancel_prevents_callback) {
+    tnt_timer_wheel_t wheel;
+    probe_t probe = {0};
+    tnt_timer_t timer;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+    tnt_timer_init(&timer, probe_fire, &probe);
+    tnt_timer_arm(&wheel, &timer, 500);
+    assert(tnt_timer_cancel(&wheel, &timer));
+    assert(!tnt_timer_cancel(&wheel, &timer));
+    tnt_timer_wheel_advance(&wheel, 10000);
+    assert(probe.calls == 0);
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+TEST(rearm_moves_deadline) {
+    tnt_timer_wheel_t wheel;
+    probe_t probe = {0};
+    tnt_timer_t timer;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+    tnt_timer_init(&timer, probe_fire, &probe);
+    tnt_timer_arm(&wheel, &timer, 200);
+    tnt_timer_wheel_advance(&wheel, 100);
+    tnt_timer_arm(&wheel, &timer, 1000);
+    assert(tnt_timer_wheel_pending(&wheel) == 1);
+
+    uint64_t fired_at = run_until_fired(&wheel, &probe, 100, 10, 3000);
+    assert(fired_at >= 1100);
+    assert(fired_at <= 1150);
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+TEST(callback_return_value_rearms) {
+    tnt_timer_wheel_t wheel;
+    probe_t probe = { .rearm_ms = 1000 };
+    tnt_timer_t timer;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+    tnt_timer_init(&timer, probe_fire, &probe);
+    tnt_timer_arm(&wheel, &timer, 1000);
+
+    for (uint64_t now = 0; now <= 10050; now += 50) {
+        tnt_timer_wheel_advance(&wheel, now);
+    }
+    assert(probe.calls == 10);
+    assert(tnt_timer_wheel_pending(&wheel) == 1);
+
+    probe.rearm_ms = 0;
+    tnt_timer_wheel_advance(&wheel, 20000);
+    assert(probe.calls == 11);
+    assert(tnt_timer_wheel_pending(&wheel) == 0);
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+TEST(rearm_after_stall_counts_from_now) {
+    tnt_timer_wheel_t wheel;
+    probe_t probe = { .rearm_ms = 500 };
+    tnt_timer_t timer;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+    tnt_timer_init(&timer, probe_fire, &probe);
+    tnt_timer_arm(&wheel, &timer, 100);
+
+    /* One late advance catches up without a burst of periodic fires. */
+    tnt_timer_wheel_advance(&wheel, 5000);
+    assert(probe.calls == 1);
+    assert(probe.last_ms == 5000);
+
+    tnt_timer_wheel_advance(&wheel, 5400);
+    assert(probe.calls == 1);
+    tnt_timer_wheel_advance(&wheel, 5600);
+    assert(probe.calls == 2);
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+TEST(many_timers_fire_once_each) {
+    enum { COUNT = 2000 };
+    static tnt_timer_t timers[COUNT];
+    static probe_t probes[COUNT];
+    tnt_timer_wheel_t wheel;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+    for (int i = 0; i < COUNT; i++) {
+        memset(&probes[i], 0, sizeof(probes[i]));
+        tnt_timer_init(&timers[i], probe_fire, &probes[i]);
+        tnt_timer_arm(&wheel, &timers[i], (uint64_t)(i * 37) % 600000);
+    }
+    assert(tnt_timer_wheel_pending(&wheel) == COUNT);
+
+    for (uint64_t now = 0; now <= 601000; now += 250) {
+        tnt_timer_wheel_advance(&wheel, now);
+    }
+    for (int i = 0; i < COUNT; i++) {
+        assert(probes[i].calls == 1);
+        assert(probes[i].last_ms >= (uint64_t)(i * 37) % 600000);
+    }
+    assert(tnt_timer_wheel_pending(&wheel) == 0);
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+TEST(manual_service_moves_only_when_advanced) {
+    tnt_timer_wheel_t *wheel;
+    tnt_timer_t timer;
+    probe_t probe = {0};
+
+    assert(tnt_timer_service() == NULL);
+    assert(tnt_timer_service_start_manual(1000) == 0);
+    wheel = tnt_timer_service();
+    assert(wheel);
+    assert(tnt_timer_wheel_now_ms(wheel) == 1000);
+
+    tnt_timer_init(&timer, probe_fire, &probe);
+    tnt_timer_arm(wheel, &timer, 100);
+    assert(run_until_fired(wheel, &probe, 1000, 50, 1200) == 1100);
+    assert(tnt_timer_wheel_now_ms(wheel) == 1100);
+
+    tnt_timer_service_stop();
+    assert(tnt_timer_service() == NULL);
+}
+
+TEST(next_due_finds_earliest_work) {
+    tnt_timer_wheel_t wheel;
+    probe_t near = {0};
+    probe_t far = {0};
+    tnt_timer_t near_timer;
+    tnt_timer_t far_timer;
+    uint64_t due;
+    int wakeups = 0;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+    assert(tnt_timer_wheel_next_due_ms(&wheel) == UINT64_MAX);
+
+    tnt_timer_init(&near_timer, probe_fire, &near);
+    tnt_timer_init(&far_timer, probe_fire, &far);
+    tnt_timer_arm(&wheel, &near_timer, 120);
+    tnt_timer_arm(&wheel, &far_timer, 300 * 1000);
+    assert(tnt_timer_wheel_next_due_ms(&wheel) == 150);
+
+    /* Sleeping until each next_due reaches the far timer in a few steps. */
+    while ((due = tnt_timer_wheel_next_due_ms(&wheel)) != UINT64_MAX) {
+        assert(++wakeups < 10);
+        tnt_timer_wheel_advance(&wheel, due);
+    }
+    assert(near.calls == 1 && near.last_ms == 150);
+    assert(far.calls == 1);
+    assert(far.last_ms >= 300 * 1000 && far.last_ms <= 300 * 1000 + 50);
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+TEST(advancing_only_at_next_due_fires_everything_on_time) {
+    enum { COUNT = 2000 };
+    static tnt_timer_t timers[COUNT];
+    static probe_t probes[COUNT];
+    tnt_timer_wheel_t wheel;
+    uint64_t due;
+
+    assert(tnt_timer_wheel_init(&wheel, 50, 0) == 0);
+    tnt_timer_wheel_advance(&wheel, 777);
+    for (int i = 0; i < COUNT; i++) {
+        memset(&probes[i], 0, sizeof(probes[i]));
+        tnt_timer_init(&timers[i], probe_fire, &probes[i]);
+        tnt_timer_arm(&wheel, &timers[i], (uint64_t)(i * 7919) % 4000000);
+    }
+
+    while ((due = tnt_timer_wheel_next_due_ms(&wheel)) != UINT64_MAX) {
+        tnt_timer_wheel_advance(&wheel, due);
+    }
+    for (int i = 0; i < COUNT; i++) {
+        uint64_t deadline = 777 + (uint64_t)(i * 7919) % 4000000;
+
+        assert(probes[i].calls == 1);
+        assert(probes[i].last_ms >= deadline);
+        assert(probes[i].last_ms <= deadline + 100);
+    }
+    tnt_timer_wheel_destroy(&wheel);
+}
+
+static atomic_int g_service_fired;
+
+static uint64_t service_probe_fire(void *arg, uint64_t now_ms) {
+    (void)arg;
+    (void)now_ms;
+    atomic_fetch_add(&g_service_fired, 1);
+    return 0;
+}
+
+TEST(service_wakes_early_for_sooner_timer) {
+    tnt_timer_wheel_t *wheel;
+    tnt_timer_t far_timer;
+    tnt_timer_t near_timer;
+    struct timespec pause = { 0, 20 * 1000000L };
+    uint64_t start;
+
+    assert(tnt_timer_service_start() == 0);
+    wheel = tnt_timer_service();
+    assert(wheel);
+
+    /* The thread goes to sleep until the far timer... */
+    tnt_timer_init(&far_timer, service_probe_fire, NULL);
+    tnt_timer_arm(wheel, &far_timer, 60 * 1000);
+    nanosleep(&pause, NULL);
+
+    /* ...and a sooner one must wake it. */
+    start = tnt_monotonic_ms();
+    tnt_timer_init(&near_timer, service_probe_fire, NULL);
+    tnt_timer_arm(wheel, &near_timer, 100);
+    while (atomic_load(&g_service_fired) == 0 &&
+           tnt_monotonic_ms() - start < 2000) {
+        nanosleep(&pause, NULL);
+    }
+    assert(atomic_load(&g_service_fired) == 1);
+    assert(tnt_monotonic_ms() - start >= 100);
+
+    assert(tnt_timer_cancel(wheel, &far_timer));
+    tnt_timer_service_stop();
+}
+
+int main(void) {
+    printf("Running timer wheel tests...\n\n");
+
+    RUN_TEST(fires_at_deadline_not_before);
+    RUN_TEST(long_delays_cascade_from_higher_levels);
+    RUN_TEST(cancel_prevents_callback);
+    RUN_TEST(rearm_moves_deadline);
+    RUN_TEST(callback_return_value_rearms);
+    RUN_TEST(rearm_after_stall_counts_from_now);
+    RUN_TEST(many_timers_fire_once_each);
+    RUN_TEST(manual_service_moves_only_when_advanced);
+    RUN_TEST(next_due_finds_earliest_work);
+    RUN_TEST(advancing_only_at_next_due_fires_everything_on_time);
+    RUN_TEST(service_wakes_early_for_sooner_timer);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}
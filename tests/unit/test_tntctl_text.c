@@ -26,12 +26,15 @@ TEST(usage_matches_language) {
 
     assert(strstr(en, "Usage: tntctl [options] host command [args...]") != NULL);
     assert(strstr(en, "--host-key-checking MODE") != NULL);
+    assert(strstr(en, "tntctl --local [-d DIR]") != NULL);
+    assert(strstr(en, "-d, --state-dir DIR") != NULL);
     assert(strstr(en,
-                  "help, health, users, stats, tail, dump, post, exit") != NULL);
+                  "help, health, users, sessions, stats, metrics, locks, trace, tail, dump, post, exit") != NULL);
     assert(strstr(zh, "用法: tntctl [options] host command [args...]") != NULL);
     assert(strstr(zh, "OpenSSH 主机密钥模式") != NULL);
+    assert(strstr(zh, "tntctl --local [-d DIR]") != NULL);
     assert(strstr(zh,
-                  "help, health, users, stats, tail, dump, post, exit") != NULL);
+                  "help, health, users, sessions, stats, metrics, locks, trace, tail, dump, post, exit") != NULL);
 }
 
 TEST(errors_match_language) {
@@ -0,0 +1,185 @@
+/* Unit tests for the trace ring buffers */
+
+#include "../../include/trace.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    printf("Running %s... ", #name); \
+    test_##name(); \
+    printf("✓\n"); \
+    tests_passed++; \
+} while(0)
+
+static int tests_passed = 0;
+
+/* Render the current trace into a heap string. */
+static char *trace_json(void) {
+    char *text = NULL;
+    size_t size = 0;
+    FILE *fp = open_memstream(&text, &size);
+
+    assert(fp);
+    assert(trace_write_json(fp) == 0);
+    fclose(fp);
+    return text;
+}
+
+static size_t count_of(const char *text, const char *needle) {
+    size_t count = 0;
+
+    for (const char *p = strstr(text, needle); p; p = strstr(p + 1, needle)) {
+        count++;
+    }
+    return count;
+}
+
+TEST(off_records_nothing) {
+    trace_status_t status;
+
+    assert(!trace_active());
+    assert(trace_begin() == 0);
+    trace_end(TRACE_EV_RENDER, trace_begin(), 100);
+    trace_instant(TRACE_EV_ROOM_JOIN, 0);
+
+    trace_get_status(&status);
+    assert(!status.active);
+    assert(status.events == 0);
+}
+
+TEST(spans_and_instants_become_chrome_events) {
+    trace_status_t status;
+    uint64_t start;
+    char *json;
+
+    assert(trace_start());
+    assert(!trace_start());
+    start = trace_begin();
+    assert(start != 0);
+    trace_end(TRACE_EV_RENDER, start, 2048);
+    trace_instant(TRACE_EV_ROOM_JOIN, 0);
+    assert(trace_stop());
+    assert(!trace_stop());
+
+    /* Recording stops with the trace */
+    trace_end(TRACE_EV_FLUSH, start, 1);
+
+    trace_get_status(&status);
+    assert(status.events == 2 && status.rings == 1);
+    assert(status.overwritten == 0 && status.untraced == 0);
+
+    json = trace_json();
+    assert(strncmp(json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", 40)
+           == 0);
+    assert(strstr(json, "{\"name\":\"render\",\"cat\":\"tnt\",\"ph\":\"X\","));
+    assert(strstr(json, "\"args\":{\"bytes\":2048}}"));
+    assert(strstr(json, "{\"name\":\"room_join\",\"cat\":\"tnt\",\"ph\":\"i\","));
+    assert(!strstr(json, "outbox_flush"));
+    assert(strcmp(json + strlen(json) - 4, "\n]}\n") == 0);
+    free(json);
+}
+
+TEST(restart_discards_previous_events) {
+    trace_status_t status;
+    char *json;
+
+    assert(trace_start());
+    trace_end(TRACE_EV_MESSAGE_SAVE, trace_begin(), 0);
+    trace_stop();
+
+    trace_get_status(&status);
+    assert(status.events == 1);
+    json = trace_json();
+    assert(strstr(json, "message_save"));
+    assert(!strstr(json, "\"render\""));
+    free(json);
+}
+
+TEST(ring_keeps_newest_events) {
+    trace_status_t status;
+
+    assert(trace_start());
+    for (int i = 0; i < TRACE_RING_EVENTS + 10; i++) {
+        trace_end(TRACE_EV_BROADCAST, trace_begin(), 0);
+    }
+    trace_stop();
+
+    trace_get_status(&status);
+    assert(status.events == TRACE_RING_EVENTS);
+    assert(status.overwritten == 10);
+}
+
+#define TRACE_WORKERS 4
+#define TRACE_WORKER_EVENTS 100
+
+static void *trace_worker(void *arg) {
+    (void)arg;
+    for (int i = 0; i < TRACE_WORKER_EVENTS; i++) {
+        trace_end(TRACE_EV_FLUSH, trace_begin(), (uint64_t)i);
+    }
+    return NULL;
+}
+
+TEST(threads_get_their_own_rings) {
+    pthread_t threads[TRACE_WORKERS];
+    trace_status_t status;
+    char *json;
+
+    assert(trace_start());
+    for (int i = 0; i < TRACE_WORKERS; i++) {
+        assert(pthread_create(&threads[i], NULL, trace_worker, NULL) == 0);
+    }
+    for (int i = 0; i < TRACE_WORKERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    trace_stop();
+
+    trace_get_status(&status);
+    assert(status.events == TRACE_WORKERS * TRACE_WORKER_EVENTS);
+    json = trace_json();
+    assert(count_of(json, "\"name\":\"outbox_flush\"") ==
+           TRACE_WORKERS * TRACE_WORKER_EVENTS);
+    free(json);
+}
+
+TEST(dump_writes_to_state_dir) {
+    char dir[] = "/tmp/tnt-trace-test.XXXXXX";
+    char path[512];
+    FILE *fp;
+    char head[16] = {0};
+
+    assert(mkdtemp(dir));
+    setenv("TNT_STATE_DIR", dir, 1);
+    assert(trace_dump(path, sizeof(path)) == 0);
+    assert(strncmp(path, dir, strlen(dir)) == 0);
+    assert(strstr(path, "/trace-") && strstr(path, ".json"));
+
+    fp = fopen(path, "r");
+    assert(fp);
+    assert(fread(head, 1, sizeof(head) - 1, fp) > 0);
+    fclose(fp);
+    assert(strncmp(head, "{\"displayTimeUn", 15) == 0);
+
+    unlink(path);
+    rmdir(dir);
+    unsetenv("TNT_STATE_DIR");
+}
+
+int main(void) {
+    printf("Running trace unit tests...\n\n");
+
+    RUN_TEST(off_records_nothing);
+    RUN_TEST(spans_and_instants_become_chrome_events);
+    RUN_TEST(restart_discards_previous_events);
+    RUN_TEST(ring_keeps_newest_events);
+    RUN_TEST(threads_get_their_own_rings);
+    RUN_TEST(dump_writes_to_state_dir);
+
+    printf("\n✓ All %d tests passed!\n", tests_passed);
+    return 0;
+}